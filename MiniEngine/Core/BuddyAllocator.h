@@ -16,22 +16,26 @@
 // When a block is de-allocated an attempt is made to merge it with it's 
 // neighbour (buddy) if it is contiguous and free.
 // Based on reference implementation by Bill Kristiansen
+//
+// The free blocks are tracked by a BuddyTree, which needs no memory allocation per
+// operation and can be used from several threads at once.
 //  
 
 #pragma once
 
 #include "GpuBuffer.h"
+#include "BuddyTree.h"
+#include <atomic>
 #include <vector>
 #include <queue>
 #include <mutex>
-#include <set>
 
 // Unfortunately the api restricts the minimum size of a placed buffer resource to 64k
 #define MIN_PLACED_BUFFER_SIZE (64 * 1024)
 
 #if defined(PROFILE) || defined(_DEBUG)
-#define INCREASE_BUDDY_COUNTER(A, B) (A = A + B);
-#define DECREASE_BUDDY_COUNTER(A, B) (A = A - B);
+#define INCREASE_BUDDY_COUNTER(A, B) (A += B);
+#define DECREASE_BUDDY_COUNTER(A, B) (A -= B);
 #else
 #define INCREASE_BUDDY_COUNTER(A, B)
 #define DECREASE_BUDDY_COUNTER(A, B)
@@ -96,24 +100,24 @@ public:
 
     inline void Reset()
     {
-        // Clear the free blocks collection  
-        m_freeBlocks.clear();
-
         // Initialize the pool with a free inner block of max inner block size  
-        m_freeBlocks.resize(m_maxOrder + 1);
-        m_freeBlocks[m_maxOrder].insert((size_t)0);
+        m_Tree.Reset(m_maxOrder);
     }
 
     void CleanUpAllocations();
 
+    // Free space and how fragmented it is, in units of the minimum block size
+    BuddyTree::Stats GetStats() const { return m_Tree.GetStats(); }
+
 private:
     ID3D12Heap* m_pBackingHeap;
     ByteAddressBuffer m_BackingResource;
 
     const D3D12_HEAP_TYPE m_heapType;
 
+    std::mutex m_deferredDeletionMutex;
     std::queue<BuddyBlock*> m_deferredDeletionQueue;
-    std::vector<std::set<size_t>> m_freeBlocks;
+    BuddyTree m_Tree;
     UINT m_maxOrder;
     const size_t m_baseOffset;
     const size_t m_maxBlockSize;
@@ -131,19 +135,12 @@ private:
         return Math::Log2(size); // Log2 rounds up fractions to next whole value
     }
 
-    inline size_t GetBuddyOffset(const size_t &offset, const size_t &size)
-    {
-        return offset ^ size;
-    }
-
     void DeallocateInternal(BuddyBlock* pBlock);
 
     size_t OrderToUnitSize(UINT order) const { return ((size_t)1) << order; }
-    size_t AllocateBlock(UINT order);
-    void DeallocateBlock(size_t offset, UINT order);
 
 #if defined(PROFILE) || defined(_DEBUG)
-    size_t m_SpaceUsed;
-    size_t m_InternalFragmentation;
+    std::atomic<size_t> m_SpaceUsed;
+    std::atomic<size_t> m_InternalFragmentation;
 #endif
 };
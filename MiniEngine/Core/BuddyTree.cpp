@@ -0,0 +1,239 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// This file has no engine dependencies so that it can also be built into the standalone
+// buddy allocator stress test and benchmark (see Tools/BuddyBenchmark).
+
+#include "BuddyTree.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+BuddyTree::BuddyTree(uint32_t maxOrder, uint32_t numCachedOrders)
+    : m_NumCachedOrders(numCachedOrders < kMaxCachedOrders ? numCachedOrders : kMaxCachedOrders)
+{
+    for (uint32_t order = 0; order < kMaxCachedOrders; ++order)
+    {
+        for (uint32_t slot = 0; slot < kCacheSlots; ++slot)
+            m_Cache[order][slot] = kEmptySlot;
+    }
+    Reset(maxOrder);
+}
+
+void BuddyTree::Reset(uint32_t maxOrder)
+{
+    assert(maxOrder <= kMaxOrder);
+
+    m_MaxOrder = maxOrder;
+    m_FreeUnits = 1u << maxOrder;
+    m_CachedUnits = 0;
+    m_NumAllocations = 0;
+
+    for (uint32_t order = 0; order < kMaxCachedOrders; ++order)
+    {
+        for (uint32_t slot = 0; slot < kCacheSlots; ++slot)
+            m_Cache[order][slot] = kEmptySlot;
+    }
+
+    // Every node starts out entirely free
+    const uint32_t numNodes = 2u << maxOrder;
+    m_Nodes.reset(new uint8_t[numNodes]);
+    m_Nodes[0] = 0;
+    for (uint32_t depth = 0, node = 1; depth <= maxOrder; ++depth)
+    {
+        for (uint32_t end = node * 2; node < end; ++node)
+            m_Nodes[node] = (uint8_t)(maxOrder - depth + 1);
+    }
+}
+
+uint32_t BuddyTree::GetOrder(uint64_t units)
+{
+    uint32_t order = 0;
+    while ((1ull << order) < units)
+        ++order;
+    return order;
+}
+
+uint32_t BuddyTree::Allocate(uint32_t order)
+{
+    if (order > m_MaxOrder)
+        return kInvalidOffset;
+
+    uint32_t offset;
+    if (PopCached(order, offset))
+    {
+        m_NumAllocations.fetch_add(1, memory_order_relaxed);
+        return offset;
+    }
+
+    lock_guard<mutex> lock(m_Mutex);
+
+    offset = AllocateLocked(order);
+    if (offset == kInvalidOffset && m_CachedUnits.load(memory_order_relaxed) > 0)
+    {
+        FlushCacheLocked();
+        offset = AllocateLocked(order);
+    }
+
+    if (offset != kInvalidOffset)
+        m_NumAllocations.fetch_add(1, memory_order_relaxed);
+    return offset;
+}
+
+void BuddyTree::Free(uint32_t offset, uint32_t order)
+{
+    assert(order <= m_MaxOrder && (offset & ((1u << order) - 1)) == 0 && offset < (1u << m_MaxOrder));
+
+    m_NumAllocations.fetch_sub(1, memory_order_relaxed);
+
+    if (PushCached(offset, order))
+        return;
+
+    lock_guard<mutex> lock(m_Mutex);
+    FreeLocked(offset, order);
+}
+
+void BuddyTree::FlushCache()
+{
+    lock_guard<mutex> lock(m_Mutex);
+    FlushCacheLocked();
+}
+
+BuddyTree::Stats BuddyTree::GetStats() const
+{
+    lock_guard<mutex> lock(m_Mutex);
+
+    Stats stats;
+    stats.TotalUnits = 1u << m_MaxOrder;
+    stats.CachedUnits = m_CachedUnits.load(memory_order_relaxed);
+    stats.FreeUnits = m_FreeUnits + stats.CachedUnits;
+    stats.LargestFreeBlock = m_Nodes[1] == 0 ? 0 : 1u << (m_Nodes[1] - 1);
+    stats.NumAllocations = m_NumAllocations.load(memory_order_relaxed);
+    return stats;
+}
+
+uint32_t BuddyTree::AllocateLocked(uint32_t order)
+{
+    const uint32_t needed = order + 1;
+    if (m_Nodes[1] < needed)
+        return kInvalidOffset;
+
+    // Walk down to a node of the requested order, preferring the tighter fit
+    uint32_t node = 1;
+    for (uint32_t nodeOrder = m_MaxOrder; nodeOrder > order; --nodeOrder)
+    {
+        const uint32_t left = node * 2;
+        const uint8_t leftLargest = m_Nodes[left], rightLargest = m_Nodes[left + 1];
+
+        if (leftLargest >= needed && (rightLargest < needed || leftLargest <= rightLargest))
+            node = left;
+        else
+            node = left + 1;
+    }
+
+    assert(m_Nodes[node] == needed);
+    m_Nodes[node] = 0;
+    m_FreeUnits -= 1u << order;
+    UpdateAncestors(node, order);
+
+    return (node - (1u << (m_MaxOrder - order))) << order;
+}
+
+void BuddyTree::FreeLocked(uint32_t offset, uint32_t order)
+{
+    // The subtree below an allocated node still reads as free, so restoring the node's own
+    // value is enough to make the whole block available again
+    const uint32_t node = (1u << (m_MaxOrder - order)) + (offset >> order);
+    assert(m_Nodes[node] == 0);
+
+    m_Nodes[node] = (uint8_t)(order + 1);
+    m_FreeUnits += 1u << order;
+    UpdateAncestors(node, order);
+}
+
+void BuddyTree::UpdateAncestors(uint32_t node, uint32_t order)
+{
+    for (; node > 1; node /= 2)
+    {
+        const uint8_t left = m_Nodes[node & ~1u], right = m_Nodes[node | 1u];
+        ++order;
+
+        // Two entirely free buddies merge into an entirely free parent
+        const uint8_t value = left == order && right == order ? (uint8_t)(order + 1) : max(left, right);
+        if (m_Nodes[node / 2] == value)
+            break;
+        m_Nodes[node / 2] = value;
+    }
+}
+
+bool BuddyTree::PopCached(uint32_t order, uint32_t& offset)
+{
+    if (order >= m_NumCachedOrders || m_CachedUnits.load(memory_order_relaxed) == 0)
+        return false;
+
+    for (uint32_t slot = 0; slot < kCacheSlots; ++slot)
+    {
+        uint32_t cached = m_Cache[order][slot].load(memory_order_relaxed);
+        if (cached != kEmptySlot && m_Cache[order][slot].compare_exchange_strong(cached, kEmptySlot, memory_order_acquire))
+        {
+            m_CachedUnits.fetch_sub(1u << order, memory_order_relaxed);
+            offset = cached;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BuddyTree::PushCached(uint32_t offset, uint32_t order)
+{
+    if (order >= m_NumCachedOrders)
+        return false;
+
+    for (uint32_t slot = 0; slot < kCacheSlots; ++slot)
+    {
+        uint32_t empty = kEmptySlot;
+        if (m_Cache[order][slot].load(memory_order_relaxed) == kEmptySlot &&
+            m_Cache[order][slot].compare_exchange_strong(empty, offset, memory_order_release))
+        {
+            m_CachedUnits.fetch_add(1u << order, memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void BuddyTree::FlushCacheLocked()
+{
+    for (uint32_t order = 0; order < m_NumCachedOrders; ++order)
+    {
+        for (uint32_t slot = 0; slot < kCacheSlots; ++slot)
+        {
+            const uint32_t cached = m_Cache[order][slot].exchange(kEmptySlot, memory_order_acquire);
+            if (cached != kEmptySlot)
+            {
+                m_CachedUnits.fetch_sub(1u << order, memory_order_relaxed);
+                FreeLocked(cached, order);
+            }
+        }
+    }
+}
@@ -0,0 +1,112 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+//
+// The block bookkeeping of BuddyAllocator: hands out power-of-two runs of units, aligned to
+// their size, from a range of 2^maxOrder units.
+//
+// The buddy tree is implicit. Node 1 covers the whole range and node n has children 2n and
+// 2n+1. Each node stores one plus the order of the largest free block in its subtree, zero
+// when it has none, so a node of order k is entirely free when it stores k+1. Allocation walks
+// down from the root and frees walk up from the block, merging buddies on the way, which makes
+// both O(maxOrder) without any memory allocation. Allocation descends into the child whose
+// largest free block is the smallest that fits, so exact fits are used before larger blocks
+// are split.
+//
+// The tree is guarded by a mutex. Blocks of the smallest orders, the ones allocated and freed
+// most often, also go through a small lock-free cache: a free of such a block parks it in an
+// empty cache slot, and an allocation of that order takes one from there without locking.
+// Cached blocks do not merge with their buddies, so the cache is flushed back into the tree
+// when an allocation would otherwise fail.
+//
+class BuddyTree
+{
+public:
+    static const uint32_t kInvalidOffset = 0xFFFFFFFF;
+    static const uint32_t kMaxOrder = 30;
+    static const uint32_t kMaxCachedOrders = 4;
+    static const uint32_t kCacheSlots = 8;
+
+    struct Stats
+    {
+        uint32_t TotalUnits = 0;
+        uint32_t FreeUnits = 0;          // Including cached blocks
+        uint32_t CachedUnits = 0;
+        uint32_t LargestFreeBlock = 0;   // In units, not counting cached blocks
+        uint32_t NumAllocations = 0;
+
+        // Share of the free units outside the largest free block, zero when all free space
+        // is one block
+        float GetFragmentation() const
+        {
+            return FreeUnits == 0 ? 0.0f : 1.0f - (float)LargestFreeBlock / FreeUnits;
+        }
+    };
+
+    // 'numCachedOrders' orders starting at zero go through the lock-free cache
+    explicit BuddyTree(uint32_t maxOrder = 0, uint32_t numCachedOrders = kMaxCachedOrders);
+
+    // Frees every block. Must not run concurrently with any other call.
+    void Reset(uint32_t maxOrder);
+
+    // Returns the unit offset of a free block of 2^order units, or kInvalidOffset
+    uint32_t Allocate(uint32_t order);
+
+    // Frees a block returned by Allocate() with the same order
+    void Free(uint32_t offset, uint32_t order);
+
+    // Returns every cached block to the tree so that it can merge with its buddy
+    void FlushCache();
+
+    Stats GetStats() const;
+
+    uint32_t GetMaxOrder() const { return m_MaxOrder; }
+
+    // The order of the smallest block that holds 'units' units
+    static uint32_t GetOrder(uint64_t units);
+
+private:
+    static const uint32_t kEmptySlot = 0xFFFFFFFF;
+
+    uint32_t AllocateLocked(uint32_t order);
+    void FreeLocked(uint32_t offset, uint32_t order);
+    void UpdateAncestors(uint32_t node, uint32_t order);
+    bool PopCached(uint32_t order, uint32_t& offset);
+    bool PushCached(uint32_t offset, uint32_t order);
+    void FlushCacheLocked();
+
+    uint32_t m_MaxOrder;
+    uint32_t m_NumCachedOrders;
+    std::unique_ptr<uint8_t[]> m_Nodes;
+    uint32_t m_FreeUnits;
+
+    mutable std::mutex m_Mutex;
+    std::atomic<uint32_t> m_Cache[kMaxCachedOrders][kCacheSlots];
+    std::atomic<uint32_t> m_CachedUnits;
+    std::atomic<uint32_t> m_NumAllocations;
+};
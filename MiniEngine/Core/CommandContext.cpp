@@ -487,6 +487,18 @@ void CommandContext::InitializeTexture( GpuResource& Dest, UINT NumSubresources,
     InitContext.Finish(true);
 }
 
+void CommandContext::UpdateTexture( GpuResource& Dest, UINT FirstSubresource, UINT NumSubresources, const D3D12_SUBRESOURCE_DATA SubData[] )
+{
+    UINT64 uploadBufferSize = GetRequiredIntermediateSize(Dest.GetResource(), FirstSubresource, NumSubresources);
+
+    // Other allocations may share the page, so this one needs texture placement alignment
+    DynAlloc mem = m_CpuLinearAllocator.Allocate(uploadBufferSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+    TransitionResource(Dest, D3D12_RESOURCE_STATE_COPY_DEST, true);
+    UpdateSubresources(m_CommandList, Dest.GetResource(), mem.Buffer.GetResource(), mem.Offset,
+        FirstSubresource, NumSubresources, SubData);
+}
+
 void CommandContext::CopySubresource(GpuResource& Dest, UINT DestSubIndex, GpuResource& Src, UINT SrcSubIndex)
 {
     FlushResourceBarriers();
@@ -559,7 +571,9 @@ uint32_t CommandContext::ReadbackTexture(ReadbackBuffer& DstBuffer, PixelBuffer&
     g_Device->GetCopyableFootprints(&SrcBuffer.GetResource()->GetDesc(), 0, 1, 0,
         &PlacedFootprint, nullptr, nullptr, &CopySize);
 
-    DstBuffer.Create(L"Readback", (uint32_t)CopySize, 1);
+    // Reuse the destination when it is large enough, so that recurring readbacks don't reallocate
+    if (DstBuffer.GetResource() == nullptr || DstBuffer.GetBufferSize() < CopySize)
+        DstBuffer.Create(L"Readback", (uint32_t)CopySize, 1);
 
     TransitionResource(SrcBuffer, D3D12_RESOURCE_STATE_COPY_SOURCE, true);
 
@@ -0,0 +1,80 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// This file has no engine dependencies so that it can also be built into the standalone
+// file format checks (see MiniEngine/Tools/MiniFileCheck and XeSSPipelineCacheCheck).
+
+#include "Crc32c.h"
+
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE4_2__)
+#define ENABLE_SSE_CRC32C 1
+#include <nmmintrin.h>
+#else
+#define ENABLE_SSE_CRC32C 0
+#endif
+
+namespace
+{
+#if !ENABLE_SSE_CRC32C
+    struct Crc32cTable
+    {
+        uint32_t entries[256];
+
+        Crc32cTable()
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; ++bit)
+                    crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+                entries[i] = crc;
+            }
+        }
+    };
+#endif
+}
+
+uint32_t Utility::ComputeCrc32c(const void* data, size_t size, uint32_t crc)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    crc = ~crc;
+
+#if ENABLE_SSE_CRC32C
+    uint64_t crc64 = crc;
+    for (; size >= 8; size -= 8, bytes += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = (uint32_t)crc64;
+    for (; size > 0; --size)
+        crc = _mm_crc32_u8(crc, *bytes++);
+#else
+    static const Crc32cTable s_Table;
+    for (; size > 0; --size)
+        crc = s_Table.entries[(crc ^ *bytes++) & 0xFF] ^ (crc >> 8);
+#endif
+
+    return ~crc;
+}
@@ -966,27 +966,26 @@ static HRESULT CreateD3DResources( _In_ ID3D12Device* d3dDevice,
 }
 
 //--------------------------------------------------------------------------------------
-static HRESULT CreateTextureFromDDS( _In_ ID3D12Device* d3dDevice,
-                                     _In_ const DDS_HEADER* header,
-                                     _In_reads_bytes_(bitSize) const uint8_t* bitData,
-                                     _In_ size_t bitSize,
-                                     _In_ size_t maxsize,
-                                     _In_ bool forceSRGB,
-                                     _Outptr_opt_ ID3D12Resource** texture,
-                                     _In_ D3D12_CPU_DESCRIPTOR_HANDLE textureView )
+static HRESULT GetTextureInfo( _In_ const DDS_HEADER* header,
+                               _Out_ uint32_t& resDim,
+                               _Out_ UINT& width,
+                               _Out_ UINT& height,
+                               _Out_ UINT& depth,
+                               _Out_ size_t& mipCount,
+                               _Out_ UINT& arraySize,
+                               _Out_ DXGI_FORMAT& format,
+                               _Out_ bool& isCubeMap )
 {
-    HRESULT hr = S_OK;
+    width = header->width;
+    height = header->height;
+    depth = header->depth;
 
-    UINT width = header->width;
-    UINT height = header->height;
-    UINT depth = header->depth;
+    resDim = D3D12_RESOURCE_DIMENSION_UNKNOWN;
+    arraySize = 1;
+    format = DXGI_FORMAT_UNKNOWN;
+    isCubeMap = false;
 
-    uint32_t resDim = D3D12_RESOURCE_DIMENSION_UNKNOWN;
-    UINT arraySize = 1;
-    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
-    bool isCubeMap = false;
-
-    size_t mipCount = header->mipMapCount;
+    mipCount = header->mipMapCount;
     if (0 == mipCount)
     {
         mipCount = 1;
@@ -1142,6 +1141,31 @@ static HRESULT CreateTextureFromDDS( _In_ ID3D12Device* d3dDevice,
         return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
     }
 
+    return S_OK;
+}
+
+//--------------------------------------------------------------------------------------
+static HRESULT CreateTextureFromDDS( _In_ ID3D12Device* d3dDevice,
+                                     _In_ const DDS_HEADER* header,
+                                     _In_reads_bytes_(bitSize) const uint8_t* bitData,
+                                     _In_ size_t bitSize,
+                                     _In_ size_t maxsize,
+                                     _In_ bool forceSRGB,
+                                     _Outptr_opt_ ID3D12Resource** texture,
+                                     _In_ D3D12_CPU_DESCRIPTOR_HANDLE textureView )
+{
+    uint32_t resDim;
+    UINT width, height, depth, arraySize;
+    size_t mipCount;
+    DXGI_FORMAT format;
+    bool isCubeMap;
+
+    HRESULT hr = GetTextureInfo( header, resDim, width, height, depth, mipCount, arraySize, format, isCubeMap );
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
     {
         // Create the texture
         UINT subresourceCount = static_cast<UINT>(mipCount) * arraySize;
@@ -1222,6 +1246,50 @@ static DDS_ALPHA_MODE GetAlphaMode( _In_ const DDS_HEADER* header )
 }
 
 
+//--------------------------------------------------------------------------------------
+static HRESULT ReadDDSHeader( _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+                              _In_ size_t ddsDataSize,
+                              _Out_ const DDS_HEADER** header,
+                              _Out_ size_t* offset )
+{
+    // Validate DDS file in memory
+    if (ddsDataSize < (sizeof(uint32_t) + sizeof(DDS_HEADER)))
+    {
+        return E_FAIL;
+    }
+
+    uint32_t dwMagicNumber = *( const uint32_t* )( ddsData );
+    if (dwMagicNumber != DDS_MAGIC)
+    {
+        return E_FAIL;
+    }
+
+    *header = reinterpret_cast<const DDS_HEADER*>( ddsData + sizeof( uint32_t ) );
+
+    // Verify header to validate DDS file
+    if ((*header)->size != sizeof(DDS_HEADER) ||
+        (*header)->ddspf.size != sizeof(DDS_PIXELFORMAT))
+    {
+        return E_FAIL;
+    }
+
+    *offset = sizeof(DDS_HEADER) + sizeof(uint32_t);
+
+    // Check for extensions
+    if ((*header)->ddspf.flags & DDS_FOURCC)
+    {
+        if (MAKEFOURCC( 'D', 'X', '1', '0' ) == (*header)->ddspf.fourCC)
+            *offset += sizeof(DDS_HEADER_DXT10);
+    }
+
+    // Must be long enough for all headers and magic value
+    if (ddsDataSize < *offset)
+        return E_FAIL;
+
+    return S_OK;
+}
+
+
 _Use_decl_annotations_
 HRESULT CreateDDSTextureFromMemory(
     ID3D12Device* d3dDevice,
@@ -1248,40 +1316,13 @@ HRESULT CreateDDSTextureFromMemory(
         return E_INVALIDARG;
     }
 
-    // Validate DDS file in memory
-    if (ddsDataSize < (sizeof(uint32_t) + sizeof(DDS_HEADER)))
+    const DDS_HEADER* header;
+    size_t offset;
+    if (FAILED( ReadDDSHeader( ddsData, ddsDataSize, &header, &offset ) ))
     {
         return E_FAIL;
     }
 
-    uint32_t dwMagicNumber = *( const uint32_t* )( ddsData );
-    if (dwMagicNumber != DDS_MAGIC)
-    {
-        return E_FAIL;
-    }
-
-    auto header = reinterpret_cast<const DDS_HEADER*>( ddsData + sizeof( uint32_t ) );
-
-    // Verify header to validate DDS file
-    if (header->size != sizeof(DDS_HEADER) ||
-        header->ddspf.size != sizeof(DDS_PIXELFORMAT))
-    {
-        return E_FAIL;
-    }
-
-    size_t offset = sizeof(DDS_HEADER) + sizeof(uint32_t);
-
-    // Check for extensions
-    if (header->ddspf.flags & DDS_FOURCC)
-    {
-        if (MAKEFOURCC( 'D', 'X', '1', '0' ) == header->ddspf.fourCC)
-            offset += sizeof(DDS_HEADER_DXT10);
-    }
-
-    // Must be long enough for all headers and magic value
-    if (ddsDataSize < offset)
-        return E_FAIL;
-
     HRESULT hr = CreateTextureFromDDS( d3dDevice,
                                        header, ddsData + offset, ddsDataSize - offset, maxsize,
                                        forceSRGB, texture, textureView );
@@ -1348,3 +1389,134 @@ HRESULT CreateDDSTextureFromFile(
 
     return hr;
 }
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT GetDDSTextureLayout(
+    const uint8_t* ddsData,
+    size_t ddsDataSize,
+    DDS_TEXTURE_LAYOUT* layout )
+{
+    static_assert(DDS_MAX_HEADER_SIZE == sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10),
+        "DDS_MAX_HEADER_SIZE covers every header");
+
+    if (!ddsData || !layout)
+    {
+        return E_INVALIDARG;
+    }
+
+    const DDS_HEADER* header;
+    size_t offset;
+    if (FAILED( ReadDDSHeader( ddsData, ddsDataSize, &header, &offset ) ))
+    {
+        return E_FAIL;
+    }
+
+    UINT width, height, depth, arraySize;
+    size_t mipCount;
+    HRESULT hr = GetTextureInfo( header, layout->resDim, width, height, depth, mipCount, arraySize,
+                                 layout->format, layout->isCubeMap );
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    layout->width = width;
+    layout->height = height;
+    layout->depth = depth;
+    layout->mipCount = static_cast<uint32_t>( mipCount );
+    layout->arraySize = arraySize;
+
+    size_t w = width;
+    size_t h = height;
+    size_t d = depth;
+    for( size_t i = 0; i < mipCount; i++ )
+    {
+        size_t NumBytes = 0;
+        GetSurfaceInfo( w, h, layout->format, &NumBytes, nullptr, nullptr );
+
+        layout->mipOffset[i] = offset;
+        offset += NumBytes * d;
+
+        w = std::max<size_t>( w >> 1, 1 );
+        h = std::max<size_t>( h >> 1, 1 );
+        d = std::max<size_t>( d >> 1, 1 );
+    }
+    layout->mipOffset[mipCount] = offset;
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT CreateDDSTextureMips(
+    ID3D12Device* d3dDevice,
+    const DDS_TEXTURE_LAYOUT& layout,
+    size_t firstMip,
+    bool forceSRGB,
+    ID3D12Resource** texture,
+    D3D12_CPU_DESCRIPTOR_HANDLE textureView )
+{
+    if (!d3dDevice || !texture)
+    {
+        return E_INVALIDARG;
+    }
+
+    *texture = nullptr;
+
+    if (layout.resDim != D3D12_RESOURCE_DIMENSION_TEXTURE2D || layout.arraySize != 1 || firstMip >= layout.mipCount)
+    {
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+    }
+
+    HRESULT hr = CreateD3DResources( d3dDevice, layout.resDim,
+                                     std::max<size_t>( layout.width >> firstMip, 1 ),
+                                     std::max<size_t>( layout.height >> firstMip, 1 ),
+                                     1, layout.mipCount - firstMip, 1,
+                                     layout.format, forceSRGB, false, texture, textureView );
+    if (SUCCEEDED(hr))
+    {
+        (*texture)->SetName(L"DDSTextureLoader (streamed)");
+    }
+
+    return hr;
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT GetDDSMipData(
+    const DDS_TEXTURE_LAYOUT& layout,
+    size_t firstMip,
+    size_t endMip,
+    const uint8_t* mipData,
+    size_t mipDataSize,
+    D3D12_SUBRESOURCE_DATA* subresources )
+{
+    if (!mipData || !subresources || firstMip >= endMip || endMip > layout.mipCount)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (layout.mipOffset[endMip] - layout.mipOffset[firstMip] > mipDataSize)
+    {
+        return HRESULT_FROM_WIN32( ERROR_HANDLE_EOF );
+    }
+
+    for (size_t i = firstMip; i < endMip; ++i)
+    {
+        size_t NumBytes = 0;
+        size_t RowBytes = 0;
+        GetSurfaceInfo( std::max<size_t>( layout.width >> i, 1 ), std::max<size_t>( layout.height >> i, 1 ),
+                        layout.format, &NumBytes, &RowBytes, nullptr );
+
+        D3D12_SUBRESOURCE_DATA& data = subresources[i - firstMip];
+        data.pData = mipData + (layout.mipOffset[i] - layout.mipOffset[firstMip]);
+        data.RowPitch = static_cast<LONG_PTR>( RowBytes );
+        data.SlicePitch = static_cast<LONG_PTR>( NumBytes );
+    }
+
+    return S_OK;
+}
@@ -56,3 +56,48 @@ HRESULT __cdecl CreateDDSTextureFromFile( _In_ ID3D12Device* d3dDevice,
                                             );
 
 size_t BitsPerPixel(_In_ DXGI_FORMAT fmt);
+
+//
+// Loading a texture a few mips at a time.  GetDDSTextureLayout() only needs the headers, at most
+// DDS_MAX_HEADER_SIZE bytes from the start of the file, to tell where each mip is.  Reading the
+// file from mipOffset[firstMip] to mipOffset[endMip] gives mips [firstMip, endMip) of the first
+// array item.  Only 2D textures without an array can be created from a range of mips.
+//
+const size_t DDS_MAX_HEADER_SIZE = 148;
+
+struct DDS_TEXTURE_LAYOUT
+{
+    uint32_t resDim;            // D3D12_RESOURCE_DIMENSION
+    DXGI_FORMAT format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    uint32_t mipCount;
+    uint32_t arraySize;         // Six per cube
+    bool isCubeMap;
+    size_t mipOffset[D3D12_REQ_MIP_LEVELS + 1];     // From the start of the file, one past the last mip
+};
+
+HRESULT __cdecl GetDDSTextureLayout( _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+                                        _In_ size_t ddsDataSize,
+                                        _Out_ DDS_TEXTURE_LAYOUT* layout
+                                    );
+
+// Creates a texture holding mips [firstMip, mipCount) and its SRV.  The texture is left in the
+// COPY_DEST state for the caller to fill, see GetDDSMipData().
+HRESULT __cdecl CreateDDSTextureMips( _In_ ID3D12Device* d3dDevice,
+                                        _In_ const DDS_TEXTURE_LAYOUT& layout,
+                                        _In_ size_t firstMip,
+                                        _In_ bool forceSRGB,
+                                        _Outptr_ ID3D12Resource** texture,
+                                        _In_ D3D12_CPU_DESCRIPTOR_HANDLE textureView
+                                    );
+
+// Describes mips [firstMip, endMip) in 'mipData', the file contents from mipOffset[firstMip]
+HRESULT __cdecl GetDDSMipData( _In_ const DDS_TEXTURE_LAYOUT& layout,
+                                _In_ size_t firstMip,
+                                _In_ size_t endMip,
+                                _In_reads_bytes_(mipDataSize) const uint8_t* mipData,
+                                _In_ size_t mipDataSize,
+                                _Out_writes_(endMip - firstMip) D3D12_SUBRESOURCE_DATA* subresources
+                            );
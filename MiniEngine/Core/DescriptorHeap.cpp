@@ -18,6 +18,19 @@
 
 using namespace Graphics;
 
+namespace
+{
+    bool IsFenceComplete(uint64_t FenceValue)
+    {
+        return g_CommandManager.IsFenceComplete(FenceValue);
+    }
+
+    uint64_t GetDefaultFreeFence(void)
+    {
+        return g_CommandManager.GetGraphicsQueue().GetNextFenceValue();
+    }
+}
+
 //
 // DescriptorAllocator implementation
 //
@@ -26,13 +39,20 @@ std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> DescriptorAllocator::s
 
 void DescriptorAllocator::DestroyAll(void)
 {
+    std::lock_guard<std::mutex> LockGuard(sm_AllocationMutex);
+
+    for (uint32_t Type = 0; Type < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++Type)
+    {
+        g_DescriptorAllocator[Type].m_Heaps.clear();
+        g_DescriptorAllocator[Type].m_NumInUse = 0;
+    }
+
     sm_DescriptorHeapPool.clear();
 }
 
+// Called with sm_AllocationMutex held
 ID3D12DescriptorHeap* DescriptorAllocator::RequestNewHeap(D3D12_DESCRIPTOR_HEAP_TYPE Type)
 {
-    std::lock_guard<std::mutex> LockGuard(sm_AllocationMutex);
-
     D3D12_DESCRIPTOR_HEAP_DESC Desc;
     Desc.Type = Type;
     Desc.NumDescriptors = sm_NumDescriptorsPerHeap;
@@ -47,22 +67,84 @@ ID3D12DescriptorHeap* DescriptorAllocator::RequestNewHeap(D3D12_DESCRIPTOR_HEAP_
 
 D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocator::Allocate( uint32_t Count )
 {
-    if (m_CurrentHeap == nullptr || m_RemainingFreeHandles < Count)
+    ASSERT(Count > 0 && Count <= sm_NumDescriptorsPerHeap, "Descriptor range does not fit in one heap");
+
+    std::lock_guard<std::mutex> LockGuard(sm_AllocationMutex);
+
+    if (m_DescriptorSize == 0)
+        m_DescriptorSize = Graphics::g_Device->GetDescriptorHandleIncrementSize(m_Type);
+
+    // Reuse freed descriptors before creating another heap
+    HeapRanges* Target = nullptr;
+    for (HeapRanges& Heap : m_Heaps)
     {
-        m_CurrentHeap = RequestNewHeap(m_Type);
-        m_CurrentHandle = m_CurrentHeap->GetCPUDescriptorHandleForHeapStart();
-        m_RemainingFreeHandles = sm_NumDescriptorsPerHeap;
+        if (Heap.Ranges.HasPending())
+            m_NumInUse -= Heap.Ranges.ReleaseCompleted(IsFenceComplete);
 
-        if (m_DescriptorSize == 0)
-            m_DescriptorSize = Graphics::g_Device->GetDescriptorHandleIncrementSize(m_Type);
+        if (Target == nullptr && Heap.Ranges.CanAllocate(Count))
+            Target = &Heap;
     }
 
-    D3D12_CPU_DESCRIPTOR_HANDLE ret = m_CurrentHandle;
-    m_CurrentHandle.ptr += Count * m_DescriptorSize;
-    m_RemainingFreeHandles -= Count;
+    if (Target == nullptr)
+    {
+        HeapRanges NewHeap;
+        NewHeap.Start = RequestNewHeap(m_Type)->GetCPUDescriptorHandleForHeapStart();
+        NewHeap.Ranges.Reset(sm_NumDescriptorsPerHeap);
+        m_Heaps.push_back(NewHeap);
+        Target = &m_Heaps.back();
+    }
+
+    uint32_t Offset = Target->Ranges.Allocate(Count);
+    ASSERT(Offset != RangeAllocator::kInvalidOffset);
+
+    m_NumInUse += Count;
+    m_PeakAllocated = std::max(m_PeakAllocated, m_NumInUse);
+
+    D3D12_CPU_DESCRIPTOR_HANDLE ret = Target->Start;
+    ret.ptr += (size_t)Offset * m_DescriptorSize;
     return ret;
 }
 
+void DescriptorAllocator::Free( D3D12_CPU_DESCRIPTOR_HANDLE Handle, uint32_t Count, uint64_t FenceValue )
+{
+    std::lock_guard<std::mutex> LockGuard(sm_AllocationMutex);
+
+    if (FenceValue == 0)
+        FenceValue = GetDefaultFreeFence();
+
+    const size_t HeapSize = (size_t)sm_NumDescriptorsPerHeap * m_DescriptorSize;
+    for (HeapRanges& Heap : m_Heaps)
+    {
+        if (Handle.ptr >= Heap.Start.ptr && Handle.ptr < Heap.Start.ptr + HeapSize)
+        {
+            Heap.Ranges.FreeDeferred((uint32_t)((Handle.ptr - Heap.Start.ptr) / m_DescriptorSize), Count, FenceValue);
+            return;
+        }
+    }
+
+    // Heaps are forgotten by DestroyAll, anything freed later has already been released
+    ASSERT(m_Heaps.empty(), "Freeing a descriptor that was not allocated here");
+}
+
+RangeAllocator::Stats DescriptorAllocator::GetStats( void ) const
+{
+    std::lock_guard<std::mutex> LockGuard(sm_AllocationMutex);
+
+    RangeAllocator::Stats Totals;
+    for (const HeapRanges& Heap : m_Heaps)
+    {
+        RangeAllocator::Stats HeapStats = Heap.Ranges.GetStats();
+        Totals.Capacity += HeapStats.Capacity;
+        Totals.Allocated += HeapStats.Allocated;
+        Totals.Pending += HeapStats.Pending;
+        Totals.NumAllocations += HeapStats.NumAllocations;
+        Totals.NumFreeRanges += HeapStats.NumFreeRanges;
+        Totals.LargestFreeRange = std::max(Totals.LargestFreeRange, HeapStats.LargestFreeRange);
+    }
+    Totals.PeakAllocated = m_PeakAllocated;
+    return Totals;
+}
+
 //
 // DescriptorHeap implementation
 //
@@ -83,20 +165,58 @@ void DescriptorHeap::Create( const std::wstring& Name, D3D12_DESCRIPTOR_HEAP_TYP
 #endif
 
     m_DescriptorSize = g_Device->GetDescriptorHandleIncrementSize(m_HeapDesc.Type);
-    m_NumFreeDescriptors = m_HeapDesc.NumDescriptors;
+    std::lock_guard<std::mutex> LockGuard(m_RangeMutex);
+    m_Ranges.Reset(m_HeapDesc.NumDescriptors);
     m_FirstHandle = DescriptorHandle(
         m_Heap->GetCPUDescriptorHandleForHeapStart(),
         m_Heap->GetGPUDescriptorHandleForHeapStart());
-    m_NextFreeHandle = m_FirstHandle;
+}
+
+void DescriptorHeap::Destroy(void)
+{
+    std::lock_guard<std::mutex> LockGuard(m_RangeMutex);
+    m_Heap = nullptr;
+    m_Ranges.Reset(0);
+}
+
+bool DescriptorHeap::HasAvailableSpace( uint32_t Count ) const
+{
+    std::lock_guard<std::mutex> LockGuard(m_RangeMutex);
+    return m_Ranges.CanAllocate(Count);
+}
+
+RangeAllocator::Stats DescriptorHeap::GetStats( void ) const
+{
+    std::lock_guard<std::mutex> LockGuard(m_RangeMutex);
+    return m_Ranges.GetStats();
 }
 
 DescriptorHandle DescriptorHeap::Alloc( uint32_t Count )
 {
-    ASSERT(HasAvailableSpace(Count), "Descriptor Heap out of space.  Increase heap size.");
-    DescriptorHandle ret = m_NextFreeHandle;
-    m_NextFreeHandle += Count * m_DescriptorSize;
-    m_NumFreeDescriptors -= Count;
-    return ret;
+    std::lock_guard<std::mutex> LockGuard(m_RangeMutex);
+
+    if (m_Ranges.HasPending())
+        m_Ranges.ReleaseCompleted(IsFenceComplete);
+
+    uint32_t Offset = m_Ranges.Allocate(Count);
+    ASSERT(Offset != RangeAllocator::kInvalidOffset, "Descriptor Heap out of space.  Increase heap size.");
+    return m_FirstHandle + Offset * m_DescriptorSize;
+}
+
+void DescriptorHeap::Free( const DescriptorHandle& DHandle, uint32_t Count, uint64_t FenceValue )
+{
+    std::lock_guard<std::mutex> LockGuard(m_RangeMutex);
+
+    // Nothing to return once the heap is destroyed
+    if (m_Heap == nullptr)
+        return;
+
+    ASSERT(ValidateHandle(DHandle));
+
+    if (FenceValue == 0)
+        FenceValue = GetDefaultFreeFence();
+
+    m_Ranges.FreeDeferred(GetOffsetOfHandle(DHandle), Count, FenceValue);
 }
 
 bool DescriptorHeap::ValidateHandle( const DescriptorHandle& DHandle ) const
@@ -13,6 +13,7 @@
 
 #pragma once
 
+#include "RangeAllocator.h"
 #include <mutex>
 #include <vector>
 #include <queue>
@@ -21,17 +22,26 @@
 // This is an unbounded resource descriptor allocator.  It is intended to provide space for CPU-visible
 // resource descriptors as resources are created.  For those that need to be made shader-visible, they
 // will need to be copied to a DescriptorHeap or a DynamicDescriptorHeap.
+//
+// Descriptors can be freed.  Freed ranges are reused once the fence they were freed with has completed,
+// filling holes in existing heaps before a new heap is created.
 class DescriptorAllocator
 {
 public:
     DescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE Type) : 
-        m_Type(Type), m_CurrentHeap(nullptr), m_DescriptorSize(0)
+        m_Type(Type), m_DescriptorSize(0), m_NumInUse(0), m_PeakAllocated(0)
     {
-        m_CurrentHandle.ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
     }
 
     D3D12_CPU_DESCRIPTOR_HANDLE Allocate( uint32_t Count );
 
+    // CPU descriptors are only read by the copies a command list makes while it is recorded, so by
+    // default they are reused once the graphics command list being recorded now has completed.
+    void Free( D3D12_CPU_DESCRIPTOR_HANDLE Handle, uint32_t Count = 1, uint64_t FenceValue = 0 );
+
+    // Totals over every heap.  LargestFreeRange is the largest in any one heap.
+    RangeAllocator::Stats GetStats( void ) const;
+
     static void DestroyAll(void);
 
 protected:
@@ -41,11 +51,17 @@ protected:
     static std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> sm_DescriptorHeapPool;
     static ID3D12DescriptorHeap* RequestNewHeap( D3D12_DESCRIPTOR_HEAP_TYPE Type );
 
+    struct HeapRanges
+    {
+        D3D12_CPU_DESCRIPTOR_HANDLE Start;
+        RangeAllocator Ranges;
+    };
+
     D3D12_DESCRIPTOR_HEAP_TYPE m_Type;
-    ID3D12DescriptorHeap* m_CurrentHeap;
-    D3D12_CPU_DESCRIPTOR_HANDLE m_CurrentHandle;
     uint32_t m_DescriptorSize;
-    uint32_t m_RemainingFreeHandles;
+    uint32_t m_NumInUse;        // Allocated or waiting on a fence
+    uint32_t m_PeakAllocated;
+    std::vector<HeapRanges> m_Heaps;
 };
 
 // This handle refers to a descriptor or a descriptor table (contiguous descriptors) that is shader visible.
@@ -109,11 +125,19 @@ public:
     ~DescriptorHeap(void) { Destroy(); }
 
     void Create( const std::wstring& DebugHeapName, D3D12_DESCRIPTOR_HEAP_TYPE Type, uint32_t MaxCount );
-    void Destroy(void) { m_Heap = nullptr; }
+    void Destroy(void);
 
-    bool HasAvailableSpace( uint32_t Count ) const { return Count <= m_NumFreeDescriptors; }
+    // Alloc and Free may be called from any thread, for example by models that are loaded or
+    // released away from the render thread.
+    bool HasAvailableSpace( uint32_t Count ) const;
     DescriptorHandle Alloc( uint32_t Count = 1 );
 
+    // Shader visible descriptors are read by the GPU, so they are reused once FenceValue has completed.
+    // By default that is the graphics command list being recorded now.
+    void Free( const DescriptorHandle& DHandle, uint32_t Count = 1, uint64_t FenceValue = 0 );
+
+    RangeAllocator::Stats GetStats( void ) const;
+
     DescriptorHandle operator[] (uint32_t arrayIdx) const { return m_FirstHandle + arrayIdx * m_DescriptorSize; }
 
     uint32_t GetOffsetOfHandle(const DescriptorHandle& DHandle ) {
@@ -130,7 +154,7 @@ private:
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_Heap;
     D3D12_DESCRIPTOR_HEAP_DESC m_HeapDesc;
     uint32_t m_DescriptorSize;
-    uint32_t m_NumFreeDescriptors;
+    mutable std::mutex m_RangeMutex;    // Guards m_Ranges, and m_Heap against Destroy
+    RangeAllocator m_Ranges;
     DescriptorHandle m_FirstHandle;
-    DescriptorHandle m_NextFreeHandle;
 };
@@ -23,6 +23,9 @@
 #include "GpuTimeManager.h"
 #include "CommandContext.h"
 #include "VRS.h"
+#include "ProfileCapture.h"
+#include "Utility.h"
+#include <fstream>
 #include <vector>
 #include <unordered_map>
 #include <array>
@@ -36,6 +39,11 @@ using namespace std;
 namespace EngineProfiling
 {
     bool Paused = false;
+
+    // GPU scopes are written as their own timeline. Windows thread IDs are multiples of four,
+    // so this never collides with a CPU thread.
+    const uint32_t kGpuTimelineId = 1;
+    ProfileCapture::Recorder s_Recorder;
 }
 
 class StatHistory
@@ -288,6 +296,7 @@ public:
     void StartTiming( CommandContext* Context )
     {
         m_StartTick = SystemTime::GetCurrentTick();
+        EngineProfiling::s_Recorder.BeginScope(m_Name.c_str(), m_StartTick);
         if (Context == nullptr)
             return;
 
@@ -299,6 +308,7 @@ public:
     void StopTiming( CommandContext* Context )
     {
         m_EndTick = SystemTime::GetCurrentTick();
+        EngineProfiling::s_Recorder.EndScope(m_EndTick);
         if (Context == nullptr)
             return;
 
@@ -322,9 +332,18 @@ public:
         m_CpuTime.RecordStat(FrameIndex, 1000.0f * (float)SystemTime::TimeBetweenTicks(m_StartTick, m_EndTick));
         m_GpuTime.RecordStat(FrameIndex, 1000.0f * m_GpuTimer.GetTime());
 
+        int64_t GpuStart, GpuEnd;
+        bool CaptureGpu = EngineProfiling::s_Recorder.IsCapturing() && this != &sm_RootScope
+            && GpuTimeManager::GetTimeStamps(m_GpuTimer.GetTimerIndex(), GpuStart, GpuEnd);
+        if (CaptureGpu)
+            EngineProfiling::s_Recorder.Record(m_Name.c_str(), GpuStart, EngineProfiling::kGpuTimelineId, ProfileCapture::kBegin);
+
         for (auto node : m_Children)
             node->GatherTimes(FrameIndex);
 
+        if (CaptureGpu)
+            EngineProfiling::s_Recorder.Record(nullptr, GpuEnd, EngineProfiling::kGpuTimelineId, ProfileCapture::kEnd);
+
         m_StartTick = 0;
         m_EndTick = 0;
     }
@@ -429,7 +448,33 @@ namespace EngineProfiling
     BoolVar DrawProfiler("Display Profiler", false);
     //BoolVar DrawPerfGraph("Display Performance Graph", false);
     const bool DrawPerfGraph = false;
-    
+    BoolVar CaptureProfile("Capture Profile", false);
+
+    // Writes profile_<time>.json for chrome://tracing and profile_<time>.csv with per-scope
+    // statistics next to the executable
+    void WriteCapture(const ProfileCapture::Capture& Capture)
+    {
+        time_t t;
+        time(&t);
+        tm LocalTime;
+        char TimeBuf[64] = "0";
+        if (localtime_s(&LocalTime, &t) == 0)
+            strftime(TimeBuf, sizeof(TimeBuf), "%Y-%m-%d_%H_%M_%S", &LocalTime);
+
+        wstring BasePath = Utility::GetProgramDirectory() + L"profile_" + Utility::UTF8ToWideString(TimeBuf);
+
+        std::ofstream TraceFile(BasePath + L".json", std::ios::out | std::ios::trunc);
+        std::ofstream StatsFile(BasePath + L".csv", std::ios::out | std::ios::trunc);
+        if (!ProfileCapture::WriteChromeTrace(TraceFile, Capture) || !ProfileCapture::WriteScopeStatistics(StatsFile, Capture))
+        {
+            Utility::Printf(L"Failed to write profile capture %ls\n", BasePath.c_str());
+            return;
+        }
+
+        Utility::Printf(L"Wrote profile capture %ls (%zu events, %llu dropped)\n", BasePath.c_str(),
+            Capture.Events.size(), (unsigned long long)Capture.DroppedEvents);
+    }
+
     void Update( void )
     {
         if (GameInput::IsFirstPressed( GameInput::kStartButton ) 
@@ -438,6 +483,20 @@ namespace EngineProfiling
             Paused = !Paused;
         }
         NestedTimingTree::UpdateTimes();
+
+        // Between frames, so no scope is open while capturing starts or stops
+        if (CaptureProfile && !s_Recorder.IsCapturing())
+        {
+            s_Recorder.Start(SystemTime::TicksToSeconds(1) * 1000000.0);
+            s_Recorder.SetThreadName(ProfileCapture::GetCurrentThreadId(), "Main");
+            s_Recorder.SetThreadName(kGpuTimelineId, "GPU");
+        }
+        else if (!CaptureProfile && s_Recorder.IsCapturing())
+        {
+            ProfileCapture::Capture Capture;
+            s_Recorder.Stop(Capture);
+            WriteCapture(Capture);
+        }
     }
 
     void BeginBlock(const wstring& name, CommandContext* Context)
@@ -469,7 +528,7 @@ namespace EngineProfiling
         {
             Text.DrawFormattedString("1x1: %.2f%%  ", VRS::Percents.num1x1);
             Text.DrawFormattedString("1x2: %.2f%%  ", VRS::Percents.num1x2);
-            Text.DrawFormattedString("2x1: %.2f%%\n", VRS::Percents.num1x2);
+            Text.DrawFormattedString("2x1: %.2f%%\n", VRS::Percents.num2x1);
             Text.DrawFormattedString("2x2: %.2f%%  ", VRS::Percents.num2x2);
             Text.DrawFormattedString("2x4: %.2f%%  ", VRS::Percents.num2x4);
             Text.DrawFormattedString("4x2: %.2f%%\n", VRS::Percents.num4x2);
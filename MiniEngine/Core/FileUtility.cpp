@@ -15,7 +15,7 @@
 #include "FileUtility.h"
 #include <fstream>
 #include <mutex>
-#include <zlib.h> // From NuGet package 
+#include "StreamingInflate.h"
 
 using namespace std;
 using namespace Utility;
@@ -55,69 +55,18 @@ ByteArray ReadFileHelperEx( shared_ptr<wstring> fileName)
     return ReadFileHelper(*fileName);
 }
 
-ByteArray Inflate(ByteArray CompressedSource, int& err, uint32_t ChunkSize = 0x100000 ) 
-{
-    // Create a dynamic buffer to hold compressed blocks
-    vector<unique_ptr<byte> > blocks;
-
-    z_stream strm  = {};
-    strm.data_type = Z_BINARY;
-    strm.total_in  = strm.avail_in  = (uInt)CompressedSource->size();
-    strm.next_in   = CompressedSource->data();
-
-    err = inflateInit2(&strm, (15 + 32)); //15 window bits, and the +32 tells zlib to to detect if using gzip or zlib
-
-    while (err == Z_OK || err == Z_BUF_ERROR)
-    {
-        strm.avail_out = ChunkSize;
-        strm.next_out = (byte*)malloc(ChunkSize);
-        blocks.emplace_back(strm.next_out);
-        err = inflate(&strm, Z_NO_FLUSH);
-    }
-
-    if (err != Z_STREAM_END) 
-    {
-        inflateEnd(&strm);
-        return NullFile;
-    }
-
-    ASSERT(strm.total_out > 0, "Nothing to decompress");
-
-    Utility::ByteArray byteArray = make_shared<vector<byte> >( strm.total_out );
-
-    // Allocate actual memory for this.
-    // copy the bits into that RAM.
-    // Free everything else up!!
-    void* curDest = byteArray->data();
-    size_t remaining = byteArray->size();
-
-    for (size_t i = 0; i < blocks.size(); ++i)
-    {
-        ASSERT(remaining > 0);
-
-        size_t CopySize = remaining < ChunkSize ? remaining : ChunkSize;
-
-        memcpy(curDest, blocks[i].get(), CopySize);
-        curDest = (byte*)curDest + CopySize;
-        remaining -= CopySize;
-    }
-
-    inflateEnd(&strm);
-
-    return byteArray;
-}
-
 ByteArray DecompressZippedFile( wstring& fileName )
 {
     ByteArray CompressedFile = ReadFileHelper(fileName);
     if (CompressedFile == NullFile)
         return NullFile;
 
-    int error;
-    ByteArray DecompressedFile = Inflate(CompressedFile, error);
-    if (DecompressedFile->size() == 0)
+    // Decodes straight into the result, sized by the gzip trailer
+    ByteArray DecompressedFile = make_shared<vector<byte> >();
+    StreamingInflate::Status status = StreamingInflate::InflateToBuffer(CompressedFile->data(), CompressedFile->size(), *DecompressedFile);
+    if (status != StreamingInflate::kSuccess || DecompressedFile->size() == 0)
     {
-        LOG_ERRORF("Couldn't unzip file %s:  Error = %d.", Utility::WideStringToUTF8(fileName).c_str(), error);
+        LOG_ERRORF("Couldn't unzip file %s:  %s.", Utility::WideStringToUTF8(fileName).c_str(), StreamingInflate::GetStatusName(status));
         return NullFile;
     }
 
@@ -134,3 +83,45 @@ task<ByteArray> Utility::ReadFileAsync(const wstring& fileName)
     shared_ptr<wstring> SharedPtr = make_shared<wstring>(fileName);
     return create_task( [=] { return ReadFileHelperEx(SharedPtr); } );
 }
+
+bool Utility::ReadFileChunks(const wstring& fileName, const ChunkConsumer& consumer)
+{
+    wstring zippedFileName = fileName + L".gz";
+    ByteArray CompressedFile = ReadFileHelper(zippedFileName);
+    if (CompressedFile != NullFile)
+    {
+        StreamingInflate::Status status = StreamingInflate::InflateChunks(CompressedFile->data(), CompressedFile->size(), consumer);
+        if (status != StreamingInflate::kSuccess && status != StreamingInflate::kAborted)
+            LOG_ERRORF("Couldn't unzip file %s:  %s.", Utility::WideStringToUTF8(zippedFileName).c_str(), StreamingInflate::GetStatusName(status));
+
+        return status == StreamingInflate::kSuccess;
+    }
+
+    ifstream file( fileName, ios::in | ios::binary );
+    if (!file)
+        return false;
+
+    vector<byte> chunk(StreamingInflate::kDefaultChunkSize);
+    while (file)
+    {
+        file.read( (char*)chunk.data(), chunk.size() );
+        size_t count = (size_t)file.gcount();
+        if (count > 0 && !consumer(chunk.data(), count))
+            return false;
+    }
+
+    return file.eof();
+}
+
+ByteArray Utility::ReadFileRange(const wstring& fileName, size_t offset, size_t size)
+{
+    ifstream file( fileName, ios::in | ios::binary );
+    if (!file || !file.seekg( offset ))
+        return NullFile;
+
+    ByteArray byteArray = make_shared<vector<byte> >( size );
+    file.read( (char*)byteArray->data(), byteArray->size() );
+    byteArray->resize( (size_t)file.gcount() );
+
+    return byteArray;
+}
@@ -16,6 +16,7 @@
 #include "pch.h"
 #include <vector>
 #include <string>
+#include <functional>
 #include <ppl.h>
 
 namespace Utility
@@ -34,4 +35,16 @@ namespace Utility
     // Same as previous except that it does not block but instead returns a task.
     task<ByteArray> ReadFileAsync(const wstring& fileName);
 
+    // Returns false from the consumer to stop reading
+    typedef function<bool(const byte* data, size_t size)> ChunkConsumer;
+
+    // Passes the contents of a file to 'consumer' in consecutive pieces so that it can be parsed
+    // while it is being read.  Like ReadFileSync, a ".gz" version is preferred and decompressed
+    // on the fly.  Returns false if the file could not be read or the consumer stopped early.
+    bool ReadFileChunks(const wstring& fileName, const ChunkConsumer& consumer);
+
+    // Reads up to 'size' bytes starting at 'offset', fewer if the file ends first.  There is no
+    // ".gz" fallback as a compressed file cannot be read from the middle.  Blocks like ReadFileSync.
+    ByteArray ReadFileRange(const wstring& fileName, size_t offset, size_t size);
+
 } // namespace Utility
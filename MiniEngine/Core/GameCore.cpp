@@ -23,6 +23,7 @@
 #include "CommandContext.h"
 #include "PostEffects.h"
 #include "Display.h"
+#include "TextureManager.h"
 #include "Util/CommandLineArg.h"
 #include "ImGuiModule.h"
 #include <shellapi.h>
@@ -73,6 +74,7 @@ namespace GameCore
     
         GameInput::Update(DeltaTime);
         EngineTuning::Update(DeltaTime);
+        TextureManager::UpdateStreaming();
         
         game.Update(DeltaTime);
         game.RenderScene();
@@ -39,6 +39,9 @@ namespace
     uint64_t sm_ValidTimeStart = 0;
     uint64_t sm_ValidTimeEnd = 0;
     double sm_GpuTickDelta = 0.0;
+    double sm_CpuTicksPerGpuTick = 0.0;
+    uint64_t sm_CalibrationGpuTick = 0;
+    uint64_t sm_CalibrationCpuTick = 0;
 #ifdef PATCH_UNINITIALIZED_QUERIES
     uint32_t m_LastTimerIdx = UINT32_MAX;
 #endif
@@ -50,6 +53,10 @@ void GpuTimeManager::Initialize(uint32_t MaxNumTimers)
     Graphics::g_CommandManager.GetCommandQueue()->GetTimestampFrequency(&GpuFrequency);
     sm_GpuTickDelta = 1.0 / static_cast<double>(GpuFrequency);
 
+    LARGE_INTEGER CpuFrequency;
+    QueryPerformanceFrequency(&CpuFrequency);
+    sm_CpuTicksPerGpuTick = static_cast<double>(CpuFrequency.QuadPart) * sm_GpuTickDelta;
+
     D3D12_HEAP_PROPERTIES HeapProps;
     HeapProps.Type = D3D12_HEAP_TYPE_READBACK;
     HeapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
@@ -143,6 +150,14 @@ void GpuTimeManager::BeginReadBack(void)
         sm_ValidTimeStart = 0ull;
         sm_ValidTimeEnd = 0ull;
     }
+
+    // Pairs a GPU and a CPU tick so that time stamps can be placed on the CPU timeline. Taking
+    // it every frame keeps the clocks from drifting apart.
+    if (FAILED(Graphics::g_CommandManager.GetCommandQueue()->GetClockCalibration(&sm_CalibrationGpuTick, &sm_CalibrationCpuTick)))
+    {
+        sm_CalibrationGpuTick = 0;
+        sm_CalibrationCpuTick = 0;
+    }
 }
 
 void GpuTimeManager::EndReadBack(void)
@@ -182,3 +197,19 @@ float GpuTimeManager::GetTime(uint32_t TimerIdx)
 
     return static_cast<float>(sm_GpuTickDelta * (TimeStamp2 - TimeStamp1));
 }
+
+bool GpuTimeManager::GetTimeStamps(uint32_t TimerIdx, int64_t& StartTick, int64_t& StopTick)
+{
+    ASSERT(sm_TimeStampBuffer != nullptr, "Time stamp readback buffer is not mapped");
+    ASSERT(TimerIdx < sm_NumTimers, "Invalid GPU timer index");
+
+    uint64_t TimeStamp1 = sm_TimeStampBuffer[TimerIdx * 2];
+    uint64_t TimeStamp2 = sm_TimeStampBuffer[TimerIdx * 2 + 1];
+
+    if (TimeStamp1 < sm_ValidTimeStart || TimeStamp2 > sm_ValidTimeEnd || TimeStamp2 <= TimeStamp1 || sm_CalibrationCpuTick == 0)
+        return false;
+
+    StartTick = (int64_t)sm_CalibrationCpuTick + (int64_t)(sm_CpuTicksPerGpuTick * ((double)TimeStamp1 - (double)sm_CalibrationGpuTick));
+    StopTick = (int64_t)sm_CalibrationCpuTick + (int64_t)(sm_CpuTicksPerGpuTick * ((double)TimeStamp2 - (double)sm_CalibrationGpuTick));
+    return true;
+}
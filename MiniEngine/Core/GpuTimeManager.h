@@ -36,4 +36,8 @@ namespace GpuTimeManager
 
     // Returns the time in milliseconds between start and stop queries
     float GetTime(uint32_t TimerIdx);
+
+    // Returns the start and stop queries converted to CPU ticks (SystemTime::GetCurrentTick),
+    // or false when the timer did not run in the frame being read back
+    bool GetTimeStamps(uint32_t TimerIdx, int64_t& StartTick, int64_t& StopTick);
 }
@@ -0,0 +1,215 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+//
+// A cache of objects keyed by a state hash (see Utility::HashState), used for pipeline state
+// objects and root signatures.
+//
+// Lookups of entries that are already built take no lock. The first thread to ask for a hash
+// builds its object, and other threads that ask for the same hash meanwhile sleep until it is
+// published instead of spinning. Entries are neither moved nor removed before Clear(), so
+// references to cached values stay valid.
+//
+// Each table is open addressed and probes a bounded run of slots. When that run is full the
+// search continues in a chained table of twice the size. Slots are only ever filled, never
+// emptied, so every thread that looks for a hash walks the same slots and finds or claims the
+// same one.
+//
+// This file has no engine dependencies so that it can also be built into the standalone
+// cache stress test (see Tools/HashCacheBenchmark).
+//
+namespace Utility
+{
+    template <typename T>
+    class HashCache
+    {
+    public:
+        explicit HashCache(size_t initialCapacity = 256)
+        {
+            m_InitialCapacity = 16;
+            while (m_InitialCapacity < initialCapacity)
+                m_InitialCapacity *= 2;
+            m_Head.reset(new Table(m_InitialCapacity));
+        }
+
+        // Returns the value cached for 'hash'. If there is none yet, the calling thread builds it
+        // with 'create()' while other threads asking for the same hash wait for the result.
+        template <typename CreateFunction>
+        const T& GetOrCreate(size_t hash, CreateFunction create)
+        {
+            bool claimed = false;
+            Slot& slot = *Locate(hash, &claimed);
+
+            if (claimed)
+            {
+                slot.Value = create();
+                slot.Ready.store(true, std::memory_order_release);
+
+                // Taking the lock orders the store against waiters that are about to sleep
+                {
+                    std::lock_guard<std::mutex> lock(m_WaitMutex);
+                }
+                m_WaitCondition.notify_all();
+            }
+            else if (!slot.Ready.load(std::memory_order_acquire))
+            {
+                std::unique_lock<std::mutex> lock(m_WaitMutex);
+                ++m_NumWaits;
+                m_WaitCondition.wait(lock, [&slot]() { return slot.Ready.load(std::memory_order_acquire); });
+            }
+
+            return slot.Value;
+        }
+
+        // Returns the value cached for 'hash', or nullptr if there is none or it is still being
+        // built. Never blocks.
+        const T* Find(size_t hash) const
+        {
+            const Slot* slot = const_cast<HashCache*>(this)->Locate(hash, nullptr);
+            if (slot == nullptr || !slot->Ready.load(std::memory_order_acquire))
+                return nullptr;
+            return &slot->Value;
+        }
+
+        // Destroys every entry. Must not run concurrently with any other call.
+        void Clear()
+        {
+            m_Head.reset(new Table(m_InitialCapacity));
+            m_Size = 0;
+            m_NumWaits = 0;
+        }
+
+        // Number of entries, including those still being built
+        size_t GetSize() const { return m_Size.load(std::memory_order_relaxed); }
+
+        // Number of times a thread slept on a build started by another thread
+        size_t GetNumWaits() const
+        {
+            std::lock_guard<std::mutex> lock(m_WaitMutex);
+            return m_NumWaits;
+        }
+
+        // Number of chained tables, which grows as the cache fills
+        size_t GetNumTables() const
+        {
+            size_t count = 0;
+            for (const Table* table = m_Head.get(); table != nullptr; table = table->Next.load(std::memory_order_acquire))
+                ++count;
+            return count;
+        }
+
+    private:
+        // Slots with this key are empty. A hash of zero is stored as ~0 instead, so the two
+        // share an entry like any other pair of colliding hashes.
+        static const size_t kEmptyKey = 0;
+        static const size_t kMaxProbes = 16;
+
+        struct Slot
+        {
+            Slot() : Key(kEmptyKey), Ready(false), Value() {}
+
+            std::atomic<size_t> Key;
+            std::atomic<bool> Ready;
+            T Value;
+        };
+
+        struct Table
+        {
+            explicit Table(size_t capacity) : Mask(capacity - 1), Slots(new Slot[capacity]), Next(nullptr) {}
+            ~Table() { delete Next.load(std::memory_order_relaxed); }
+
+            const size_t Mask;
+            std::unique_ptr<Slot[]> Slots;
+            std::atomic<Table*> Next;
+        };
+
+        // Finds the slot holding 'hash'. With 'claimed' set, the first empty slot on the probe
+        // sequence is claimed when there is none, and 'claimed' reports whether that happened.
+        Slot* Locate(size_t hash, bool* claimed)
+        {
+            const size_t key = hash == kEmptyKey ? ~kEmptyKey : hash;
+
+            // Spread the bits that select the home slot, CRC values are not well mixed
+            const size_t mixed = (size_t)(((uint64_t)key * 0x9E3779B97F4A7C15ull) >> 32) ^ key;
+
+            Table* table = m_Head.get();
+            for (;;)
+            {
+                const size_t numProbes = std::min(kMaxProbes, table->Mask + 1);
+                for (size_t i = 0; i < numProbes; ++i)
+                {
+                    Slot& slot = table->Slots[(mixed + i) & table->Mask];
+                    size_t current = slot.Key.load(std::memory_order_acquire);
+
+                    if (current == kEmptyKey)
+                    {
+                        if (claimed == nullptr)
+                            return nullptr;
+
+                        if (slot.Key.compare_exchange_strong(current, key, std::memory_order_acq_rel))
+                        {
+                            m_Size.fetch_add(1, std::memory_order_relaxed);
+                            *claimed = true;
+                            return &slot;
+                        }
+                        // Lost the race, 'current' now holds the winner's key
+                    }
+
+                    if (current == key)
+                        return &slot;
+                }
+
+                // The run is full of other keys, continue in the next table
+                Table* next = table->Next.load(std::memory_order_acquire);
+                if (next == nullptr)
+                {
+                    if (claimed == nullptr)
+                        return nullptr;
+
+                    Table* grown = new Table((table->Mask + 1) * 2);
+                    if (table->Next.compare_exchange_strong(next, grown, std::memory_order_acq_rel))
+                        next = grown;
+                    else
+                        delete grown;
+                }
+                table = next;
+            }
+        }
+
+        std::unique_ptr<Table> m_Head;
+        size_t m_InitialCapacity;
+        std::atomic<size_t> m_Size{ 0 };
+
+        mutable std::mutex m_WaitMutex;
+        std::condition_variable m_WaitCondition;
+        size_t m_NumWaits = 0;
+    };
+}
@@ -0,0 +1,523 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+// This file has no engine dependencies so that it can also be built into the
+// standalone ImageMetrics tool (see Tools/ImageMetrics).
+
+#include "ImageMetrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define IMAGE_METRICS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const uint32_t kNumChannels = 3;        // Color channels compared, the fourth is ignored
+    const uint32_t kBlockSize = 4;          // Moments are gathered per 4x4 block
+    const uint32_t kBandBlockRows = 16;     // Each band of work covers 64 pixel rows
+    const uint32_t kHashSize = 32;          // Intensity is reduced to 32x32 before the DCT
+    const uint32_t kHashCells = kHashSize * kHashSize;
+
+    const double kSsimC1 = (0.01 * 255.0) * (0.01 * 255.0);
+    const double kSsimC2 = (0.03 * 255.0) * (0.03 * 255.0);
+
+    struct ChannelMoments
+    {
+        uint64_t A = 0, B = 0, AA = 0, BB = 0, AB = 0;
+    };
+
+    // Sums over one 4x4 block; a block's squared sums fit comfortably in 32 bits
+    struct BlockMoments
+    {
+        uint32_t A[kNumChannels];
+        uint32_t B[kNumChannels];
+        uint32_t AA[kNumChannels];
+        uint32_t BB[kNumChannels];
+        uint32_t AB[kNumChannels];
+    };
+
+    struct BandResult
+    {
+        uint64_t DiffPixels = 0;
+        uint64_t SumAbs = 0;
+        uint64_t SumSq = 0;
+        uint32_t MaxAbs = 0;
+        ChannelMoments Moments[kNumChannels];
+        double SsimSum = 0.0;
+        uint64_t SsimWindows = 0;
+        std::vector<double> HashRef;
+        std::vector<double> HashTest;
+        std::vector<uint32_t> HashCount;
+    };
+
+    struct CompareJob
+    {
+        const ImageMetrics::Image* Ref;
+        const ImageMetrics::Image* Test;
+        uint8_t* Diff;
+        uint32_t BlocksWide;
+        uint32_t BlocksHigh;
+        uint32_t NumBands;
+    };
+
+    inline const uint8_t* Row(const ImageMetrics::Image& image, uint32_t y)
+    {
+        return image.Pixels + (size_t)y * image.RowPitch;
+    }
+
+    void AccumulatePixelErrors(const uint8_t* a, const uint8_t* b, uint32_t count, BandResult& result)
+    {
+        for (uint32_t i = 0; i < count; ++i, a += 4, b += 4)
+        {
+            bool differs = false;
+            for (uint32_t c = 0; c < kNumChannels; ++c)
+            {
+                uint32_t d = (uint32_t)std::abs((int)a[c] - (int)b[c]);
+                result.SumAbs += d;
+                result.SumSq += d * d;
+                result.MaxAbs = std::max(result.MaxAbs, d);
+                differs |= d != 0;
+            }
+            result.DiffPixels += differs ? 1 : 0;
+        }
+    }
+
+    // AE, MAE, MSE and PAE for one row. The SSE2 path handles four pixels per step.
+    void AccumulateRowErrors(const uint8_t* a, const uint8_t* b, uint32_t width, BandResult& result)
+    {
+        uint32_t x = 0;
+
+#ifdef IMAGE_METRICS_SSE2
+        static const uint8_t kEqualPixelsToDiffCount[16] = { 4, 3, 3, 2, 3, 2, 2, 1, 3, 2, 2, 1, 2, 1, 1, 0 };
+
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ones = _mm_set1_epi32(-1);
+        const __m128i colorMask = _mm_set1_epi32(0x00FFFFFF);
+        __m128i sumAbs = _mm_setzero_si128();
+        __m128i sumSq = _mm_setzero_si128();
+        __m128i maxAbs = _mm_setzero_si128();
+        uint64_t diffPixels = 0;
+
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i va = _mm_loadu_si128((const __m128i*)(a + x * 4));
+            __m128i vb = _mm_loadu_si128((const __m128i*)(b + x * 4));
+            __m128i ad = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+            ad = _mm_and_si128(ad, colorMask);
+
+            sumAbs = _mm_add_epi64(sumAbs, _mm_sad_epu8(ad, zero));
+            maxAbs = _mm_max_epu8(maxAbs, ad);
+
+            // Each 32-bit lane gains at most 4 * 255^2 per step, so a row of 16k pixels can't overflow
+            __m128i lo = _mm_unpacklo_epi8(ad, zero);
+            __m128i hi = _mm_unpackhi_epi8(ad, zero);
+            sumSq = _mm_add_epi32(sumSq, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+
+            __m128i equal = _mm_cmpeq_epi32(_mm_cmpeq_epi8(ad, zero), ones);
+            diffPixels += kEqualPixelsToDiffCount[_mm_movemask_ps(_mm_castsi128_ps(equal))];
+        }
+
+        alignas(16) uint64_t abs64[2];
+        alignas(16) uint32_t sq32[4];
+        alignas(16) uint8_t max8[16];
+        _mm_store_si128((__m128i*)abs64, sumAbs);
+        _mm_store_si128((__m128i*)sq32, sumSq);
+        _mm_store_si128((__m128i*)max8, maxAbs);
+
+        result.SumAbs += abs64[0] + abs64[1];
+        result.SumSq += (uint64_t)sq32[0] + sq32[1] + sq32[2] + sq32[3];
+        for (uint32_t i = 0; i < 16; ++i)
+            result.MaxAbs = std::max(result.MaxAbs, (uint32_t)max8[i]);
+        result.DiffPixels += diffPixels;
+#endif
+
+        AccumulatePixelErrors(a + x * 4, b + x * 4, width - x, result);
+    }
+
+    void AccumulatePixelMoments(const uint8_t* a, const uint8_t* b, uint32_t count, ChannelMoments* moments)
+    {
+        for (uint32_t i = 0; i < count; ++i, a += 4, b += 4)
+        {
+            for (uint32_t c = 0; c < kNumChannels; ++c)
+            {
+                uint32_t va = a[c], vb = b[c];
+                moments[c].A += va;
+                moments[c].B += vb;
+                moments[c].AA += va * va;
+                moments[c].BB += vb * vb;
+                moments[c].AB += va * vb;
+            }
+        }
+    }
+
+    void ComputeBlockRow(const CompareJob& job, uint32_t by, std::vector<BlockMoments>& blocks)
+    {
+        memset(blocks.data(), 0, blocks.size() * sizeof(BlockMoments));
+
+        for (uint32_t row = 0; row < kBlockSize; ++row)
+        {
+            const uint8_t* a = Row(*job.Ref, by * kBlockSize + row);
+            const uint8_t* b = Row(*job.Test, by * kBlockSize + row);
+
+            for (uint32_t bx = 0; bx < job.BlocksWide; ++bx)
+            {
+                BlockMoments& block = blocks[bx];
+                for (uint32_t col = 0; col < kBlockSize; ++col, a += 4, b += 4)
+                {
+                    for (uint32_t c = 0; c < kNumChannels; ++c)
+                    {
+                        uint32_t va = a[c], vb = b[c];
+                        block.A[c] += va;
+                        block.B[c] += vb;
+                        block.AA[c] += va * va;
+                        block.BB[c] += vb * vb;
+                        block.AB[c] += va * vb;
+                    }
+                }
+            }
+        }
+    }
+
+    // SSIM of the 8x8 window made of four neighboring blocks, averaged over the channels
+    double WindowSsim(const BlockMoments& b00, const BlockMoments& b01, const BlockMoments& b10, const BlockMoments& b11)
+    {
+        const double invN = 1.0 / 64.0;
+        double ssim = 0.0;
+
+        for (uint32_t c = 0; c < kNumChannels; ++c)
+        {
+            double muA = (b00.A[c] + b01.A[c] + b10.A[c] + b11.A[c]) * invN;
+            double muB = (b00.B[c] + b01.B[c] + b10.B[c] + b11.B[c]) * invN;
+            double varA = (b00.AA[c] + b01.AA[c] + b10.AA[c] + b11.AA[c]) * invN - muA * muA;
+            double varB = (b00.BB[c] + b01.BB[c] + b10.BB[c] + b11.BB[c]) * invN - muB * muB;
+            double cov = (b00.AB[c] + b01.AB[c] + b10.AB[c] + b11.AB[c]) * invN - muA * muB;
+
+            ssim += ((2.0 * muA * muB + kSsimC1) * (2.0 * cov + kSsimC2)) /
+                ((muA * muA + muB * muB + kSsimC1) * (varA + varB + kSsimC2));
+        }
+
+        return ssim / kNumChannels;
+    }
+
+    void WriteDiffRow(const uint8_t* a, const uint8_t* b, uint32_t width, uint8_t* dest)
+    {
+        for (uint32_t x = 0; x < width; ++x, a += 4, b += 4, dest += 4)
+        {
+            if (a[0] != b[0] || a[1] != b[1] || a[2] != b[2])
+            {
+                dest[0] = 255;
+                dest[1] = 0;
+                dest[2] = 0;
+            }
+            else
+            {
+                dest[0] = (uint8_t)((a[0] + 4 * 255) / 5);
+                dest[1] = (uint8_t)((a[1] + 4 * 255) / 5);
+                dest[2] = (uint8_t)((a[2] + 4 * 255) / 5);
+            }
+            dest[3] = 255;
+        }
+    }
+
+    void ProcessBand(const CompareJob& job, uint32_t band, BandResult& result)
+    {
+        const ImageMetrics::Image& ref = *job.Ref;
+        const ImageMetrics::Image& test = *job.Test;
+
+        const uint32_t by0 = band * kBandBlockRows;
+        const uint32_t by1 = std::min(by0 + kBandBlockRows, job.BlocksHigh);
+        const uint32_t y0 = by0 * kBlockSize;
+        const uint32_t y1 = band == job.NumBands - 1 ? ref.Height : by1 * kBlockSize;
+        const uint32_t blockedRows = job.BlocksHigh * kBlockSize;
+        const uint32_t blockedCols = job.BlocksWide * kBlockSize;
+
+        // Per pixel error metrics
+        for (uint32_t y = y0; y < y1; ++y)
+        {
+            AccumulateRowErrors(Row(ref, y), Row(test, y), ref.Width, result);
+
+            if (job.Diff != nullptr)
+                WriteDiffRow(Row(ref, y), Row(test, y), ref.Width, job.Diff + (size_t)y * ref.Width * 4);
+        }
+
+        // Block moments feed NCC, SSIM and the perceptual hash. The first block row of the next
+        // band is recomputed here so that windows straddling the band boundary are covered.
+        if (job.BlocksWide > 0 && by0 < by1)
+        {
+            result.HashRef.assign(kHashCells, 0.0);
+            result.HashTest.assign(kHashCells, 0.0);
+            result.HashCount.assign(kHashCells, 0);
+
+            std::vector<BlockMoments> prev(job.BlocksWide), curr(job.BlocksWide);
+            const uint32_t lastBlockRow = std::min(by1 + 1, job.BlocksHigh);
+
+            for (uint32_t by = by0; by < lastBlockRow; ++by)
+            {
+                ComputeBlockRow(job, by, curr);
+
+                if (by < by1)
+                {
+                    const uint32_t cy = ((by * kBlockSize + kBlockSize / 2) * kHashSize) / ref.Height;
+
+                    for (uint32_t bx = 0; bx < job.BlocksWide; ++bx)
+                    {
+                        const BlockMoments& block = curr[bx];
+                        double intensityA = 0.0, intensityB = 0.0;
+
+                        for (uint32_t c = 0; c < kNumChannels; ++c)
+                        {
+                            result.Moments[c].A += block.A[c];
+                            result.Moments[c].B += block.B[c];
+                            result.Moments[c].AA += block.AA[c];
+                            result.Moments[c].BB += block.BB[c];
+                            result.Moments[c].AB += block.AB[c];
+                            intensityA += block.A[c];
+                            intensityB += block.B[c];
+                        }
+
+                        const uint32_t cx = ((bx * kBlockSize + kBlockSize / 2) * kHashSize) / ref.Width;
+                        result.HashRef[cy * kHashSize + cx] += intensityA;
+                        result.HashTest[cy * kHashSize + cx] += intensityB;
+                        result.HashCount[cy * kHashSize + cx]++;
+                    }
+                }
+
+                if (by > by0)
+                {
+                    for (uint32_t bx = 0; bx + 1 < job.BlocksWide; ++bx)
+                        result.SsimSum += WindowSsim(prev[bx], prev[bx + 1], curr[bx], curr[bx + 1]);
+                    result.SsimWindows += job.BlocksWide - 1;
+                }
+
+                std::swap(prev, curr);
+            }
+        }
+
+        // Pixels outside the block grid only contribute to the global moments
+        for (uint32_t y = y0; y < std::min(y1, blockedRows); ++y)
+        {
+            AccumulatePixelMoments(Row(ref, y) + blockedCols * 4, Row(test, y) + blockedCols * 4,
+                ref.Width - blockedCols, result.Moments);
+        }
+        for (uint32_t y = std::max(y0, blockedRows); y < y1; ++y)
+            AccumulatePixelMoments(Row(ref, y), Row(test, y), ref.Width, result.Moments);
+    }
+
+    uint64_t ComputePerceptualHash(const std::vector<double>& cells)
+    {
+        const double kPi = 3.14159265358979323846;
+
+        // Separable DCT-II, only the 8x8 lowest frequencies are needed
+        double rows[kHashSize][8];
+        for (uint32_t y = 0; y < kHashSize; ++y)
+        {
+            for (uint32_t u = 0; u < 8; ++u)
+            {
+                double sum = 0.0;
+                for (uint32_t x = 0; x < kHashSize; ++x)
+                    sum += cells[y * kHashSize + x] * cos((2.0 * x + 1.0) * u * kPi / (2.0 * kHashSize));
+                rows[y][u] = sum;
+            }
+        }
+
+        double coeffs[64];
+        for (uint32_t v = 0; v < 8; ++v)
+        {
+            for (uint32_t u = 0; u < 8; ++u)
+            {
+                double sum = 0.0;
+                for (uint32_t y = 0; y < kHashSize; ++y)
+                    sum += rows[y][u] * cos((2.0 * y + 1.0) * v * kPi / (2.0 * kHashSize));
+                coeffs[v * 8 + u] = sum;
+            }
+        }
+
+        // The DC term is excluded from the median so that brightness shifts don't dominate
+        double sorted[63];
+        std::copy(coeffs + 1, coeffs + 64, sorted);
+        std::nth_element(sorted, sorted + 31, sorted + 63);
+        const double median = sorted[31];
+
+        uint64_t hash = 0;
+        for (uint32_t i = 0; i < 64; ++i)
+        {
+            if (coeffs[i] > median)
+                hash |= 1ull << i;
+        }
+        return hash;
+    }
+
+    uint32_t CountBits(uint64_t value)
+    {
+        uint32_t count = 0;
+        for (; value != 0; value &= value - 1)
+            ++count;
+        return count;
+    }
+
+    double ChannelCorrelation(const ChannelMoments& m, double n)
+    {
+        double muA = m.A / n, muB = m.B / n;
+        double varA = m.AA / n - muA * muA;
+        double varB = m.BB / n - muB * muB;
+        double cov = m.AB / n - muA * muB;
+
+        if (varA <= 0.0 || varB <= 0.0)
+            return (varA <= 0.0 && varB <= 0.0 && m.A == m.B) ? 1.0 : 0.0;
+
+        return cov / sqrt(varA * varB);
+    }
+}
+
+bool ImageMetrics::Compare(const Image& reference, const Image& test, Results& results,
+    std::vector<uint8_t>* diffImage, uint32_t numThreads)
+{
+    if (reference.Pixels == nullptr || test.Pixels == nullptr ||
+        reference.Width != test.Width || reference.Height != test.Height ||
+        reference.Width == 0 || reference.Height == 0 ||
+        reference.RowPitch < reference.Width * 4 || test.RowPitch < test.Width * 4)
+    {
+        return false;
+    }
+
+    if (diffImage != nullptr)
+        diffImage->resize((size_t)reference.Width * reference.Height * 4);
+
+    CompareJob job;
+    job.Ref = &reference;
+    job.Test = &test;
+    job.Diff = diffImage != nullptr ? diffImage->data() : nullptr;
+    job.BlocksWide = reference.Width / kBlockSize;
+    job.BlocksHigh = reference.Height / kBlockSize;
+    job.NumBands = std::max(1u, (job.BlocksHigh + kBandBlockRows - 1) / kBandBlockRows);
+
+    std::vector<BandResult> bands(job.NumBands);
+
+    if (numThreads == 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    numThreads = std::min(numThreads, job.NumBands);
+
+    std::atomic<uint32_t> nextBand(0);
+    auto WorkerFunc = [&]()
+    {
+        for (uint32_t band = nextBand++; band < job.NumBands; band = nextBand++)
+            ProcessBand(job, band, bands[band]);
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < numThreads; ++i)
+        threads.push_back(std::thread(WorkerFunc));
+    WorkerFunc();
+    std::for_each(threads.begin(), threads.end(), [](std::thread& t) { t.join(); });
+
+    // Reduce in band order so the results are independent of scheduling
+    BandResult total;
+    std::vector<double> hashRef(kHashCells, 0.0), hashTest(kHashCells, 0.0);
+    std::vector<uint32_t> hashCount(kHashCells, 0);
+
+    for (const BandResult& band : bands)
+    {
+        total.DiffPixels += band.DiffPixels;
+        total.SumAbs += band.SumAbs;
+        total.SumSq += band.SumSq;
+        total.MaxAbs = std::max(total.MaxAbs, band.MaxAbs);
+        total.SsimSum += band.SsimSum;
+        total.SsimWindows += band.SsimWindows;
+
+        for (uint32_t c = 0; c < kNumChannels; ++c)
+        {
+            total.Moments[c].A += band.Moments[c].A;
+            total.Moments[c].B += band.Moments[c].B;
+            total.Moments[c].AA += band.Moments[c].AA;
+            total.Moments[c].BB += band.Moments[c].BB;
+            total.Moments[c].AB += band.Moments[c].AB;
+        }
+
+        if (!band.HashCount.empty())
+        {
+            for (uint32_t i = 0; i < kHashCells; ++i)
+            {
+                hashRef[i] += band.HashRef[i];
+                hashTest[i] += band.HashTest[i];
+                hashCount[i] += band.HashCount[i];
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < kHashCells; ++i)
+    {
+        if (hashCount[i] > 0)
+        {
+            hashRef[i] /= hashCount[i];
+            hashTest[i] /= hashCount[i];
+        }
+    }
+
+    const double numPixels = (double)reference.Width * reference.Height;
+    const double numSamples = numPixels * kNumChannels;
+
+    results.AE = total.DiffPixels;
+    results.MAE = total.SumAbs / (numSamples * 255.0);
+    results.MSE = total.SumSq / (numSamples * 255.0 * 255.0);
+    results.RMSE = sqrt(results.MSE);
+    results.PAE = total.MaxAbs / 255.0;
+    results.PSNR = results.MSE > 0.0 ? 10.0 * log10(1.0 / results.MSE) : std::numeric_limits<double>::infinity();
+    results.FUZZ = results.RMSE;
+    results.MEPP = total.SumAbs / numSamples;
+    results.MEPPNormalizedMean = results.MAE;
+    results.MEPPNormalizedMax = results.PAE;
+
+    results.NCC = 0.0;
+    for (uint32_t c = 0; c < kNumChannels; ++c)
+        results.NCC += ChannelCorrelation(total.Moments[c], numPixels);
+    results.NCC /= kNumChannels;
+
+    if (total.SsimWindows > 0)
+        results.SSIM = total.SsimSum / total.SsimWindows;
+    else
+        results.SSIM = total.DiffPixels == 0 ? 1.0 : 0.0;
+    results.DSSIM = (1.0 - results.SSIM) * 0.5;
+
+    results.PHASH = CountBits(ComputePerceptualHash(hashRef) ^ ComputePerceptualHash(hashTest));
+
+    return true;
+}
+
+std::string ImageMetrics::ToString(const Results& results)
+{
+    char buffer[1024];
+    snprintf(buffer, sizeof(buffer),
+        "AE: %llu\nDSSIM: %g\nFUZZ: %g\nMAE: %g\nMEPP: %g (%g; %g)\nMSE: %g\nNCC: %g\n"
+        "PAE: %g\nPHASH: %u\nRMSE: %g\nSSIM: %g\nPSNR: %g\n",
+        (unsigned long long)results.AE, results.DSSIM, results.FUZZ, results.MAE,
+        results.MEPP, results.MEPPNormalizedMean, results.MEPPNormalizedMax,
+        results.MSE, results.NCC, results.PAE, results.PHASH, results.RMSE,
+        results.SSIM, results.PSNR);
+    return buffer;
+}
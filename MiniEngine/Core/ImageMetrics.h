@@ -0,0 +1,85 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//
+// In-process replacement for the "magick compare -metric X" invocations used by VRSTest.
+// All metrics are produced by a single tiled pass over two 8-bit, four channel images
+// (RGBA or BGRA, the fourth channel is ignored). The image is split into horizontal
+// bands which are processed on worker threads; per-band partial sums are reduced in band
+// order so the results do not depend on the thread count.
+//
+// Metric definitions follow ImageMagick's normalized output where it has one:
+//  AE      number of pixels that differ in any color channel
+//  MAE     mean absolute channel error, normalized to [0,1]
+//  MSE     mean squared channel error, normalized to [0,1]
+//  RMSE    sqrt(MSE)
+//  PAE     peak absolute channel error, normalized to [0,1]
+//  PSNR    10*log10(1/MSE) in dB (infinite for identical images)
+//  FUZZ    RMS color distance, which for equally weighted channels equals RMSE
+//  MEPP    mean error per pixel in 8-bit units, plus normalized mean and max
+//  NCC     normalized cross correlation averaged over the color channels
+//  SSIM    structural similarity over 8x8 windows with a stride of 4, averaged over channels
+//  DSSIM   (1 - SSIM) / 2
+//  PHASH   Hamming distance between 64-bit DCT perceptual hashes of the luma (0 to 64)
+//
+namespace ImageMetrics
+{
+    struct Image
+    {
+        const uint8_t* Pixels = nullptr;
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+        uint32_t RowPitch = 0;      // In bytes, must be at least Width * 4
+    };
+
+    struct Results
+    {
+        uint64_t AE = 0;
+        double MAE = 0.0;
+        double MSE = 0.0;
+        double RMSE = 0.0;
+        double PAE = 0.0;
+        double PSNR = 0.0;
+        double FUZZ = 0.0;
+        double MEPP = 0.0;
+        double MEPPNormalizedMean = 0.0;
+        double MEPPNormalizedMax = 0.0;
+        double NCC = 0.0;
+        double SSIM = 0.0;
+        double DSSIM = 0.0;
+        uint32_t PHASH = 0;
+    };
+
+    // Compares 'test' against 'reference'. Both images must have the same dimensions.
+    // When 'diffImage' is provided it receives a tightly packed RGBA visualization with
+    // differing pixels in red over a faded copy of the reference, like "magick compare".
+    // A thread count of zero uses every hardware thread.
+    bool Compare(const Image& reference, const Image& test, Results& results,
+        std::vector<uint8_t>* diffImage = nullptr, uint32_t numThreads = 0);
+
+    // Formats a result set as "NAME: value" lines in the order VRSTest writes them.
+    std::string ToString(const Results& results);
+}
@@ -0,0 +1,245 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+// This file has no engine dependencies so that it can also be built into the
+// standalone culling benchmark (see Tools/CullBenchmark).
+
+#include "SphereCulling.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define ENABLE_SSE_CULLING 1
+#include <xmmintrin.h>
+#if defined(__AVX__)
+#define ENABLE_AVX_CULLING 1
+#include <immintrin.h>
+#else
+#define ENABLE_AVX_CULLING 0
+#endif
+#else
+#define ENABLE_SSE_CULLING 0
+#define ENABLE_AVX_CULLING 0
+#endif
+
+using namespace Math;
+using namespace Math::SphereCulling;
+
+uint32_t SphereCulling::TransformAndCullScalar(const float (*spheres)[4], const float (*xforms)[4], uint32_t count,
+    const ViewTransform& view, const FrustumPlanes& frustum, bool cullEnabled,
+    uint32_t baseIndex, uint32_t* visible, float* distances)
+{
+    const float (*c)[4] = view.Columns;
+    uint32_t numVisible = 0;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const float scale = xforms[i][3];
+        const float wx = spheres[i][0] * scale + xforms[i][0];
+        const float wy = spheres[i][1] * scale + xforms[i][1];
+        const float wz = spheres[i][2] * scale + xforms[i][2];
+        const float r = spheres[i][3] * scale;
+
+        // Same operation order as XMVector3TransformNormal followed by the translation
+        const float vx = ((wz * c[2][0] + wy * c[1][0]) + wx * c[0][0]) + c[3][0];
+        const float vy = ((wz * c[2][1] + wy * c[1][1]) + wx * c[0][1]) + c[3][1];
+        const float vz = ((wz * c[2][2] + wy * c[1][2]) + wx * c[0][2]) + c[3][2];
+
+        distances[i] = -vz - r;
+
+        bool inside = true;
+        for (int p = 0; cullEnabled && p < 6; ++p)
+        {
+            const float* plane = frustum.Planes[p];
+            if (((vx * plane[0] + vy * plane[1]) + vz * plane[2]) + plane[3] + r < 0.0f)
+                inside = false;
+        }
+
+        if (inside)
+            visible[numVisible++] = baseIndex + i;
+    }
+
+    return numVisible;
+}
+
+#if ENABLE_SSE_CULLING
+
+namespace
+{
+    struct SoA4
+    {
+        __m128 x, y, z, w;
+    };
+
+    inline SoA4 LoadTransposed(const float (*aos)[4])
+    {
+        SoA4 r;
+        r.x = _mm_loadu_ps(aos[0]);
+        r.y = _mm_loadu_ps(aos[1]);
+        r.z = _mm_loadu_ps(aos[2]);
+        r.w = _mm_loadu_ps(aos[3]);
+        _MM_TRANSPOSE4_PS(r.x, r.y, r.z, r.w);
+        return r;
+    }
+
+    uint32_t TransformAndCull4(const float (*spheres)[4], const float (*xforms)[4], uint32_t count,
+        const ViewTransform& view, const FrustumPlanes& frustum, bool cullEnabled,
+        uint32_t baseIndex, uint32_t* visible, float* distances)
+    {
+        const float (*c)[4] = view.Columns;
+        const __m128 signBit = _mm_set1_ps(-0.0f);
+        const __m128 zero = _mm_setzero_ps();
+        uint32_t numVisible = 0;
+
+        for (uint32_t i = 0; i < count; i += 4)
+        {
+            SoA4 s = LoadTransposed(spheres + i);
+            SoA4 t = LoadTransposed(xforms + i);
+
+            __m128 wx = _mm_add_ps(_mm_mul_ps(s.x, t.w), t.x);
+            __m128 wy = _mm_add_ps(_mm_mul_ps(s.y, t.w), t.y);
+            __m128 wz = _mm_add_ps(_mm_mul_ps(s.z, t.w), t.z);
+            __m128 r = _mm_mul_ps(s.w, t.w);
+
+            __m128 v[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                __m128 sum = _mm_add_ps(_mm_mul_ps(wz, _mm_set1_ps(c[2][k])), _mm_mul_ps(wy, _mm_set1_ps(c[1][k])));
+                sum = _mm_add_ps(sum, _mm_mul_ps(wx, _mm_set1_ps(c[0][k])));
+                v[k] = _mm_add_ps(sum, _mm_set1_ps(c[3][k]));
+            }
+
+            _mm_storeu_ps(distances + i, _mm_sub_ps(_mm_xor_ps(v[2], signBit), r));
+
+            int mask = 0xF;
+            for (int p = 0; cullEnabled && p < 6; ++p)
+            {
+                const float* plane = frustum.Planes[p];
+                __m128 d = _mm_add_ps(_mm_mul_ps(v[0], _mm_set1_ps(plane[0])), _mm_mul_ps(v[1], _mm_set1_ps(plane[1])));
+                d = _mm_add_ps(d, _mm_mul_ps(v[2], _mm_set1_ps(plane[2])));
+                d = _mm_add_ps(_mm_add_ps(d, _mm_set1_ps(plane[3])), r);
+
+                // "Not less than" keeps NaN distances visible, like the scalar test
+                mask &= _mm_movemask_ps(_mm_cmpnlt_ps(d, zero));
+            }
+
+            for (uint32_t k = 0; k < 4; ++k)
+            {
+                if (mask & (1 << k))
+                    visible[numVisible++] = baseIndex + i + k;
+            }
+        }
+
+        return numVisible;
+    }
+
+#if ENABLE_AVX_CULLING
+    inline __m256 Combine(__m128 lo, __m128 hi)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+    }
+
+    uint32_t TransformAndCull8(const float (*spheres)[4], const float (*xforms)[4], uint32_t count,
+        const ViewTransform& view, const FrustumPlanes& frustum, bool cullEnabled,
+        uint32_t baseIndex, uint32_t* visible, float* distances)
+    {
+        const float (*c)[4] = view.Columns;
+        const __m256 signBit = _mm256_set1_ps(-0.0f);
+        const __m256 zero = _mm256_setzero_ps();
+        uint32_t numVisible = 0;
+
+        for (uint32_t i = 0; i < count; i += 8)
+        {
+            SoA4 s0 = LoadTransposed(spheres + i), s1 = LoadTransposed(spheres + i + 4);
+            SoA4 t0 = LoadTransposed(xforms + i), t1 = LoadTransposed(xforms + i + 4);
+
+            __m256 scale = Combine(t0.w, t1.w);
+            __m256 wx = _mm256_add_ps(_mm256_mul_ps(Combine(s0.x, s1.x), scale), Combine(t0.x, t1.x));
+            __m256 wy = _mm256_add_ps(_mm256_mul_ps(Combine(s0.y, s1.y), scale), Combine(t0.y, t1.y));
+            __m256 wz = _mm256_add_ps(_mm256_mul_ps(Combine(s0.z, s1.z), scale), Combine(t0.z, t1.z));
+            __m256 r = _mm256_mul_ps(Combine(s0.w, s1.w), scale);
+
+            __m256 v[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                __m256 sum = _mm256_add_ps(_mm256_mul_ps(wz, _mm256_set1_ps(c[2][k])), _mm256_mul_ps(wy, _mm256_set1_ps(c[1][k])));
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(wx, _mm256_set1_ps(c[0][k])));
+                v[k] = _mm256_add_ps(sum, _mm256_set1_ps(c[3][k]));
+            }
+
+            _mm256_storeu_ps(distances + i, _mm256_sub_ps(_mm256_xor_ps(v[2], signBit), r));
+
+            int mask = 0xFF;
+            for (int p = 0; cullEnabled && p < 6; ++p)
+            {
+                const float* plane = frustum.Planes[p];
+                __m256 d = _mm256_add_ps(_mm256_mul_ps(v[0], _mm256_set1_ps(plane[0])), _mm256_mul_ps(v[1], _mm256_set1_ps(plane[1])));
+                d = _mm256_add_ps(d, _mm256_mul_ps(v[2], _mm256_set1_ps(plane[2])));
+                d = _mm256_add_ps(_mm256_add_ps(d, _mm256_set1_ps(plane[3])), r);
+                mask &= _mm256_movemask_ps(_mm256_cmp_ps(d, zero, _CMP_NLT_UQ));
+            }
+
+            for (uint32_t k = 0; k < 8; ++k)
+            {
+                if (mask & (1 << k))
+                    visible[numVisible++] = baseIndex + i + k;
+            }
+        }
+
+        return numVisible;
+    }
+#endif
+}
+
+#endif // ENABLE_SSE_CULLING
+
+uint32_t SphereCulling::GetBatchWidth()
+{
+#if ENABLE_AVX_CULLING
+    return 8;
+#elif ENABLE_SSE_CULLING
+    return 4;
+#else
+    return 1;
+#endif
+}
+
+uint32_t SphereCulling::TransformAndCull(const float (*spheres)[4], const float (*xforms)[4], uint32_t count,
+    const ViewTransform& view, const FrustumPlanes& frustum, bool cullEnabled,
+    uint32_t baseIndex, uint32_t* visible, float* distances)
+{
+    uint32_t numBatched = 0;
+    uint32_t numVisible = 0;
+
+#if ENABLE_SSE_CULLING
+    numBatched = count - count % GetBatchWidth();
+#endif
+
+#if ENABLE_AVX_CULLING
+    numVisible = TransformAndCull8(spheres, xforms, numBatched, view, frustum, cullEnabled,
+        baseIndex, visible, distances);
+#elif ENABLE_SSE_CULLING
+    numVisible = TransformAndCull4(spheres, xforms, numBatched, view, frustum, cullEnabled,
+        baseIndex, visible, distances);
+#endif
+
+    numVisible += TransformAndCullScalar(spheres + numBatched, xforms + numBatched, count - numBatched,
+        view, frustum, cullEnabled, baseIndex + numBatched, visible + numVisible, distances + numBatched);
+
+    return numVisible;
+}
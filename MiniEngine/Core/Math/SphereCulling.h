@@ -0,0 +1,71 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+
+//
+// Batched bounding sphere culling. Spheres are transposed to structure-of-arrays form and
+// tested against the frustum four at a time with SSE, or eight at a time when the compiler
+// targets AVX. The math follows Model::Render's scalar path step for step:
+//
+//  world  = object sphere * ScaleAndTranslation
+//  view   = view transform * world center, radius unchanged
+//  result = Frustum::IntersectSphere(view), distance = -view.z - radius
+//
+// These are plain float structures rather than Math types so that the kernel can be built
+// into the standalone benchmark (see Tools/CullBenchmark). The engine fills them from a
+// Frustum and the camera's view matrix.
+//
+namespace Math
+{
+    namespace SphereCulling
+    {
+        // Plane equations (a, b, c, d) with normals pointing into the frustum
+        struct FrustumPlanes
+        {
+            float Planes[6][4];
+        };
+
+        // Basis X, Y, Z and translation columns of an affine transform; w is ignored
+        struct ViewTransform
+        {
+            float Columns[4][4];
+        };
+
+        // 'spheres' holds (x, y, z, radius) and 'xforms' holds (tx, ty, tz, scale) for each of
+        // 'count' spheres. The view-space distance to the near side of every sphere is written
+        // to 'distances'. The indices of visible spheres, plus 'baseIndex', are written to
+        // 'visible' in ascending order and their number is returned. When 'cullEnabled' is
+        // false every sphere is visible.
+        uint32_t TransformAndCull(const float (*spheres)[4], const float (*xforms)[4], uint32_t count,
+            const ViewTransform& view, const FrustumPlanes& frustum, bool cullEnabled,
+            uint32_t baseIndex, uint32_t* visible, float* distances);
+
+        // One sphere at a time, for reference and for the tail of a batch
+        uint32_t TransformAndCullScalar(const float (*spheres)[4], const float (*xforms)[4], uint32_t count,
+            const ViewTransform& view, const FrustumPlanes& frustum, bool cullEnabled,
+            uint32_t baseIndex, uint32_t* visible, float* distances);
+
+        // Spheres per SIMD step, 8 with AVX and 4 otherwise
+        uint32_t GetBatchWidth();
+    }
+}
@@ -0,0 +1,335 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+// This file has no engine dependencies so that it can also be built into the
+// standalone capture check (see Tools/ProfileCaptureCheck).
+
+#include "ProfileCapture.h"
+#include "Utf8.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace ProfileCapture;
+
+namespace
+{
+    // Generations are unique across recorders so a cached buffer is never used by the wrong one
+    atomic<uint32_t> s_NextGeneration(1);
+
+    struct ThreadCache
+    {
+        const void* Owner = nullptr;
+        uint32_t Generation = 0;
+        void* Buffer = nullptr;
+    };
+    thread_local ThreadCache t_Cache;
+    thread_local uint32_t t_ThreadId = 0;
+
+    // UTF-8 of a wide string, with JSON or CSV escaping
+    void AppendEscaped(string& out, const wchar_t* text, bool json)
+    {
+        while (text != nullptr && *text != 0)
+        {
+            const uint32_t c = Utility::NextCodePoint(text);
+            if (json && (c == '"' || c == '\\'))
+            {
+                out += '\\';
+                out += (char)c;
+            }
+            else if (json && c < 0x20)
+            {
+                char escape[8];
+                snprintf(escape, sizeof(escape), "\\u%04x", c);
+                out += escape;
+            }
+            else if (!json && c == '"')
+            {
+                out += "\"\"";
+            }
+            else
+            {
+                Utility::AppendUTF8(out, c);
+            }
+        }
+    }
+
+    void AppendString(string& out, const string& text, bool json)
+    {
+        for (char c : text)
+        {
+            if (json && (c == '"' || c == '\\'))
+                out += '\\';
+            else if (!json && c == '"')
+                out += '"';
+            out += c;
+        }
+    }
+
+    // Events of one thread ID in record order
+    map<uint32_t, vector<const Event*>> GroupByThread(const Capture& capture)
+    {
+        map<uint32_t, vector<const Event*>> threads;
+        for (const Event& e : capture.Events)
+            threads[e.ThreadId].push_back(&e);
+        return threads;
+    }
+
+    // Nearest rank percentile of sorted values
+    double Percentile(const vector<double>& sorted, double p)
+    {
+        size_t rank = (size_t)ceil(p * sorted.size());
+        return sorted[min(max(rank, (size_t)1), sorted.size()) - 1];
+    }
+}
+
+uint32_t ProfileCapture::GetCurrentThreadId()
+{
+    if (t_ThreadId == 0)
+    {
+#ifdef _WIN32
+        t_ThreadId = (uint32_t)::GetCurrentThreadId();
+#else
+        t_ThreadId = (uint32_t)syscall(SYS_gettid);
+#endif
+    }
+    return t_ThreadId;
+}
+
+Recorder::Recorder()
+    : m_Capturing(false), m_Generation(0), m_EventsPerThread(0), m_MicrosecondsPerTick(1.0)
+{
+}
+
+Recorder::~Recorder()
+{
+    m_Capturing = false;
+}
+
+void Recorder::Start(double microsecondsPerTick, uint32_t eventsPerThread)
+{
+    lock_guard<mutex> lock(m_Mutex);
+
+    // The previous capture's buffers, kept since Stop() in case a thread was still writing
+    m_Buffers.clear();
+    m_ThreadNames.clear();
+    m_EventsPerThread = max(eventsPerThread, 1u);
+    m_MicrosecondsPerTick = microsecondsPerTick;
+    m_Generation.store(s_NextGeneration++, memory_order_relaxed);
+    m_Capturing.store(true, memory_order_release);
+}
+
+void Recorder::Stop(Capture& capture)
+{
+    m_Capturing.store(false, memory_order_release);
+
+    lock_guard<mutex> lock(m_Mutex);
+
+    capture.Events.clear();
+    capture.ThreadNames = m_ThreadNames;
+    capture.MicrosecondsPerTick = m_MicrosecondsPerTick;
+    capture.DroppedEvents = 0;
+
+    for (const unique_ptr<ThreadBuffer>& buffer : m_Buffers)
+    {
+        const uint32_t count = min(buffer->Count.load(memory_order_acquire), buffer->Capacity);
+        capture.Events.insert(capture.Events.end(), buffer->Events.get(), buffer->Events.get() + count);
+        capture.DroppedEvents += buffer->Dropped.load(memory_order_relaxed);
+    }
+}
+
+void Recorder::Record(const wchar_t* name, int64_t tick, uint32_t threadId, EventType type)
+{
+    if (!m_Capturing.load(memory_order_acquire))
+        return;
+
+    ThreadBuffer* buffer = GetThreadBuffer();
+    if (buffer == nullptr)
+        return;
+
+    // Only this thread writes to the buffer, so the count needs no read-modify-write
+    const uint32_t index = buffer->Count.load(memory_order_relaxed);
+    if (index >= buffer->Capacity)
+    {
+        buffer->Dropped.store(buffer->Dropped.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        return;
+    }
+
+    Event& e = buffer->Events[index];
+    e.Name = name;
+    e.Tick = tick;
+    e.ThreadId = threadId;
+    e.Type = type;
+    buffer->Count.store(index + 1, memory_order_release);
+}
+
+void Recorder::SetThreadName(uint32_t threadId, const string& name)
+{
+    lock_guard<mutex> lock(m_Mutex);
+    m_ThreadNames[threadId] = name;
+}
+
+Recorder::ThreadBuffer* Recorder::GetThreadBuffer()
+{
+    const uint32_t generation = m_Generation.load(memory_order_relaxed);
+    if (t_Cache.Owner == this && t_Cache.Generation == generation)
+        return static_cast<ThreadBuffer*>(t_Cache.Buffer);
+
+    unique_ptr<ThreadBuffer> buffer(new ThreadBuffer);
+    buffer->Events.reset(new Event[m_EventsPerThread]);
+    buffer->Capacity = m_EventsPerThread;
+    buffer->Count.store(0, memory_order_relaxed);
+    buffer->Dropped.store(0, memory_order_relaxed);
+    buffer->ThreadId = GetThreadId();
+
+    lock_guard<mutex> lock(m_Mutex);
+
+    // Stop() may have collected the buffers since Record() checked, and a buffer added now
+    // would never be read
+    if (!m_Capturing.load(memory_order_relaxed) || m_Generation.load(memory_order_relaxed) != generation)
+        return nullptr;
+
+    t_Cache.Owner = this;
+    t_Cache.Generation = generation;
+    t_Cache.Buffer = buffer.get();
+
+    m_Buffers.push_back(move(buffer));
+    return static_cast<ThreadBuffer*>(t_Cache.Buffer);
+}
+
+uint32_t Recorder::GetThreadId()
+{
+    return ProfileCapture::GetCurrentThreadId();
+}
+
+bool ProfileCapture::WriteChromeTrace(ostream& stream, const Capture& capture)
+{
+    string line;
+    bool first = true;
+
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    for (const auto& thread : capture.ThreadNames)
+    {
+        line = first ? "" : ",\n";
+        line += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + to_string(thread.first) + ",\"args\":{\"name\":\"";
+        AppendString(line, thread.second, true);
+        line += "\"}}";
+        stream << line;
+        first = false;
+    }
+
+    char number[64];
+    for (const auto& thread : GroupByThread(capture))
+    {
+        for (const Event* e : thread.second)
+        {
+            snprintf(number, sizeof(number), "%.3f", e->Tick * capture.MicrosecondsPerTick);
+
+            line = first ? "" : ",\n";
+            if (e->Type == kBegin)
+            {
+                line += "{\"name\":\"";
+                AppendEscaped(line, e->Name, true);
+                line += "\",\"ph\":\"B\",";
+            }
+            else
+            {
+                line += "{\"ph\":\"E\",";
+            }
+            line += "\"ts\":";
+            line += number;
+            line += ",\"pid\":1,\"tid\":" + to_string(thread.first) + "}";
+            stream << line;
+            first = false;
+        }
+    }
+
+    stream << "\n]}\n";
+    return stream.good();
+}
+
+bool ProfileCapture::WriteScopeStatistics(ostream& stream, const Capture& capture)
+{
+    // Scope paths like "Frame/Render/Shadows", so equal names under different parents stay apart
+    map<pair<uint32_t, string>, vector<double>> durations;
+
+    for (const auto& thread : GroupByThread(capture))
+    {
+        vector<pair<string, int64_t>> open;
+        for (const Event* e : thread.second)
+        {
+            if (e->Type == kBegin)
+            {
+                string path = open.empty() ? string() : open.back().first + "/";
+                AppendEscaped(path, e->Name, false);
+                open.emplace_back(move(path), e->Tick);
+            }
+            else if (!open.empty())
+            {
+                durations[make_pair(thread.first, open.back().first)].push_back(
+                    (e->Tick - open.back().second) * capture.MicrosecondsPerTick / 1000.0);
+                open.pop_back();
+            }
+        }
+    }
+
+    stream << "thread,scope,count,total_ms,mean_ms,min_ms,p50_ms,p95_ms,p99_ms,max_ms\n";
+
+    char row[256];
+    for (auto& scope : durations)
+    {
+        vector<double>& values = scope.second;
+        sort(values.begin(), values.end());
+
+        double total = 0.0;
+        for (double v : values)
+            total += v;
+
+        auto name = capture.ThreadNames.find(scope.first.first);
+        string thread = name != capture.ThreadNames.end() ? name->second : to_string(scope.first.first);
+
+        string line = "\"";
+        AppendString(line, thread, false);
+        line += "\",\"" + scope.first.second + "\",";
+
+        snprintf(row, sizeof(row), "%zu,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n", values.size(), total,
+            total / values.size(), values.front(), Percentile(values, 0.50), Percentile(values, 0.95),
+            Percentile(values, 0.99), values.back());
+        stream << line << row;
+    }
+
+    return stream.good();
+}
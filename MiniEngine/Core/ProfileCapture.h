@@ -0,0 +1,130 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//
+// Records profiling scope begin and end events for offline analysis and writes them as
+// Chrome trace event JSON (chrome://tracing, Perfetto) and as per-scope CSV statistics.
+//
+// Every thread appends to its own fixed size buffer, registered with the recorder the first
+// time the thread records during a capture. After that, recording is a few stores and one
+// release store of the event count: no locks and no allocation. Events that do not fit are
+// counted as dropped.
+//
+// Ticks are opaque to the recorder; the writers convert them with the tick period given to
+// Start(). Names are not copied, so they must stay valid until the capture has been written.
+// This has no engine dependencies so that it can be tested headless (see
+// Tools/ProfileCaptureCheck).
+//
+namespace ProfileCapture
+{
+    enum EventType : uint8_t
+    {
+        kBegin,
+        kEnd
+    };
+
+    struct Event
+    {
+        const wchar_t* Name;    // Null for kEnd, which closes the innermost open scope
+        int64_t Tick;
+        uint32_t ThreadId;
+        EventType Type;
+    };
+
+    struct Capture
+    {
+        std::vector<Event> Events;                      // In record order per thread
+        std::map<uint32_t, std::string> ThreadNames;    // Optional, by thread ID
+        double MicrosecondsPerTick = 1.0;
+        uint64_t DroppedEvents = 0;
+    };
+
+    // The calling thread's OS thread ID
+    uint32_t GetCurrentThreadId();
+
+    class Recorder
+    {
+    public:
+        Recorder();
+        ~Recorder();
+
+        Recorder(const Recorder&) = delete;
+        Recorder& operator=(const Recorder&) = delete;
+
+        // Start must not race with scopes being recorded on other threads, so call it between
+        // frames. Each thread can record 'eventsPerThread' events. Stop may be called while
+        // other threads record; what they record after it is ignored. The thread buffers stay
+        // allocated until the next Start or the destruction of the recorder, because a thread
+        // may still be writing to its buffer when Stop collects it.
+        void Start(double microsecondsPerTick, uint32_t eventsPerThread = 1 << 18);
+        void Stop(Capture& capture);
+
+        bool IsCapturing() const { return m_Capturing.load(std::memory_order_relaxed); }
+
+        // Record on the calling thread's timeline
+        void BeginScope(const wchar_t* name, int64_t tick) { Record(name, tick, GetThreadId(), kBegin); }
+        void EndScope(int64_t tick) { Record(nullptr, tick, GetThreadId(), kEnd); }
+
+        // Record on another timeline, such as a GPU queue. Scopes must nest per thread ID.
+        void Record(const wchar_t* name, int64_t tick, uint32_t threadId, EventType type);
+
+        void SetThreadName(uint32_t threadId, const std::string& name);
+
+    private:
+        struct ThreadBuffer
+        {
+            std::unique_ptr<Event[]> Events;
+            uint32_t Capacity = 0;
+            std::atomic<uint32_t> Count;
+            std::atomic<uint32_t> Dropped;
+            uint32_t ThreadId = 0;
+        };
+
+        ThreadBuffer* GetThreadBuffer();     // Null if the capture has stopped
+        uint32_t GetThreadId();
+
+        std::atomic<bool> m_Capturing;
+        std::atomic<uint32_t> m_Generation;
+        uint32_t m_EventsPerThread;
+        double m_MicrosecondsPerTick;
+
+        std::mutex m_Mutex;     // Guards the lists below, taken once per thread per capture
+        std::vector<std::unique_ptr<ThreadBuffer>> m_Buffers;
+        std::map<uint32_t, std::string> m_ThreadNames;
+    };
+
+    // Begin and end events ('B' and 'E') grouped by thread, plus thread name metadata
+    bool WriteChromeTrace(std::ostream& stream, const Capture& capture);
+
+    // One row per scope path and thread: count, total, mean, min, p50, p95, p99 and max in
+    // milliseconds. Unmatched begin and end events are ignored.
+    bool WriteScopeStatistics(std::ostream& stream, const Capture& capture);
+}
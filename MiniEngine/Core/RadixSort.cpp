@@ -0,0 +1,256 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+// This file has no engine dependencies so that it can also be built into the
+// standalone sort benchmark (see Tools/SortBenchmark).
+
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+    // Fewer keys than this per thread are not worth the synchronization
+    const size_t kMinKeysPerThread = 16384;
+    const uint32_t kMaxThreads = 64;
+
+    class Barrier
+    {
+    public:
+        explicit Barrier(uint32_t count) : m_Count(count), m_Waiting(0), m_Generation(0) {}
+
+        void Wait()
+        {
+            if (m_Count == 1)
+                return;
+
+            unique_lock<mutex> lock(m_Mutex);
+            uint32_t generation = m_Generation;
+            if (++m_Waiting == m_Count)
+            {
+                m_Waiting = 0;
+                ++m_Generation;
+                m_Condition.notify_all();
+            }
+            else
+            {
+                m_Condition.wait(lock, [&]() { return generation != m_Generation; });
+            }
+        }
+
+    private:
+        mutex m_Mutex;
+        condition_variable m_Condition;
+        uint32_t m_Count;
+        uint32_t m_Waiting;
+        uint32_t m_Generation;
+    };
+
+    inline uint32_t DigitValue(uint64_t key, const RadixSort::Digit& digit)
+    {
+        return (uint32_t)(key >> digit.Shift) & ((1u << digit.Bits) - 1);
+    }
+}
+
+void RadixSort::Sort(uint64_t* keys, size_t count, const Digit* digits, uint32_t numDigits,
+    Scratch& scratch, uint32_t numThreads, Stats* stats)
+{
+    assert(numDigits <= kMaxDigits);
+
+    if (numThreads == 0)
+        numThreads = max(thread::hardware_concurrency(), 1u);
+    numThreads = min(numThreads, kMaxThreads);
+    numThreads = (uint32_t)max<size_t>(1, min<size_t>(numThreads, count / kMinKeysPerThread));
+
+    if (stats != nullptr)
+    {
+        *stats = Stats();
+        stats->NumThreads = numThreads;
+    }
+
+    if (count < 2)
+        return;
+
+    // Histogram layout: per thread, the buckets of every digit back to back
+    uint32_t digitBase[kMaxDigits];
+    uint64_t prefixMasks[kMaxDigits];
+    uint32_t bucketsPerThread = 0;
+    uint64_t prefixMask = 0;
+
+    for (uint32_t j = 0; j < numDigits; ++j)
+    {
+        assert(digits[j].Bits > 0 && digits[j].Bits <= kMaxDigitBits);
+        digitBase[j] = bucketsPerThread;
+        bucketsPerThread += 1u << digits[j].Bits;
+
+        prefixMask |= ((1ull << digits[j].Bits) - 1) << digits[j].Shift;
+        prefixMasks[j] = prefixMask;
+    }
+
+    scratch.Keys.resize(count);
+    scratch.Histograms.assign((size_t)bucketsPerThread * numThreads, 0);
+
+    uint32_t sortedFlags[kMaxThreads];  // Per thread, bit j set while sorted on prefixMasks[j]
+    uint32_t passes[kMaxDigits];        // Digits that need a pass, decided by thread 0
+    uint32_t numPasses = 0;
+    Barrier barrier(numThreads);
+
+    auto chunkStart = [&](uint32_t t) { return (size_t)((uint64_t)count * t / numThreads); };
+
+    auto worker = [&](uint32_t t)
+    {
+        const size_t start = chunkStart(t), end = chunkStart(t + 1);
+        uint32_t* hist = scratch.Histograms.data() + (size_t)bucketsPerThread * t;
+
+        // Histograms of every digit, and which digit prefixes are already in order
+        uint32_t sorted = (1u << numDigits) - 1;
+        for (size_t i = start; i < end; ++i)
+        {
+            const uint64_t key = keys[i];
+            for (uint32_t j = 0; j < numDigits; ++j)
+                ++hist[digitBase[j] + DigitValue(key, digits[j])];
+
+            if (sorted != 0 && i > 0)
+            {
+                const uint64_t prev = keys[i - 1];
+                for (uint32_t s = sorted; s != 0; s &= s - 1)
+                {
+                    uint32_t j = 0;
+                    while (((s >> j) & 1) == 0)
+                        ++j;
+
+                    if ((prev & prefixMasks[j]) > (key & prefixMasks[j]))
+                        sorted &= ~(1u << j);
+                }
+            }
+        }
+        sortedFlags[t] = sorted;
+
+        barrier.Wait();
+
+        if (t == 0)
+        {
+            uint32_t allSorted = sorted;
+            for (uint32_t i = 1; i < numThreads; ++i)
+                allSorted &= sortedFlags[i];
+
+            // The longest run of least significant digits that needs no pass
+            uint32_t firstDigit = 0;
+            for (uint32_t j = 0; j < numDigits; ++j)
+            {
+                if (allSorted & (1u << j))
+                    firstDigit = j + 1;
+            }
+
+            for (uint32_t j = firstDigit; j < numDigits; ++j)
+            {
+                const uint32_t bucket = digitBase[j] + DigitValue(keys[0], digits[j]);
+                size_t total = 0;
+                for (uint32_t i = 0; i < numThreads; ++i)
+                    total += scratch.Histograms[(size_t)bucketsPerThread * i + bucket];
+
+                if (total == count)
+                {
+                    if (stats != nullptr)
+                        ++stats->PassesSkippedUniform;
+                }
+                else
+                    passes[numPasses++] = j;
+            }
+
+            if (stats != nullptr)
+            {
+                stats->PassesSkippedPresorted = firstDigit;
+                stats->PassesRun = numPasses;
+            }
+        }
+
+        barrier.Wait();
+
+        uint64_t* src = keys;
+        uint64_t* dst = scratch.Keys.data();
+
+        for (uint32_t p = 0; p < numPasses; ++p)
+        {
+            const Digit& digit = digits[passes[p]];
+            const uint32_t numBuckets = 1u << digit.Bits;
+            uint32_t* digitHist = hist + digitBase[passes[p]];
+
+            // The first histograms were taken of the unsorted keys. After a scatter the multiset
+            // is the same, so a single thread can keep using them, but each thread's range now
+            // holds different keys.
+            if (p > 0 && numThreads > 1)
+            {
+                memset(digitHist, 0, numBuckets * sizeof(uint32_t));
+                for (size_t i = start; i < end; ++i)
+                    ++digitHist[DigitValue(src[i], digit)];
+
+                barrier.Wait();
+            }
+
+            // Turn counts into output offsets, ordered by bucket, then by thread for stability
+            if (t == 0)
+            {
+                uint32_t offset = 0;
+                for (uint32_t b = 0; b < numBuckets; ++b)
+                {
+                    for (uint32_t i = 0; i < numThreads; ++i)
+                    {
+                        uint32_t& entry = scratch.Histograms[(size_t)bucketsPerThread * i + digitBase[passes[p]] + b];
+                        uint32_t n = entry;
+                        entry = offset;
+                        offset += n;
+                    }
+                }
+            }
+
+            barrier.Wait();
+
+            for (size_t i = start; i < end; ++i)
+            {
+                const uint64_t key = src[i];
+                dst[digitHist[DigitValue(key, digit)]++] = key;
+            }
+
+            barrier.Wait();
+
+            swap(src, dst);
+        }
+
+        if (src != keys)
+            memcpy(keys + start, src + start, (end - start) * sizeof(uint64_t));
+    };
+
+    vector<thread> workers;
+    workers.reserve(numThreads - 1);
+    for (uint32_t t = 1; t < numThreads; ++t)
+        workers.emplace_back(worker, t);
+    worker(0);
+
+    for (thread& w : workers)
+        w.join();
+}
@@ -0,0 +1,72 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//
+// Least significant digit radix sort for 64-bit keys, used by Renderer::MeshSorter.
+//
+// The caller describes the key as a list of digits so that digit boundaries can follow the
+// fields packed into the key. A single read pass builds the histograms of every digit, then:
+//
+//  - digits whose value is the same in every key are skipped
+//  - leading (least significant) digits are skipped while the keys are already in order on
+//    all the bits they cover, e.g. an object index that was assigned in insertion order
+//
+// The sort is stable, so the result is identical to std::sort for any input.
+//
+namespace RadixSort
+{
+    // A field of 'Bits' bits starting at bit 'Shift'. At most kMaxDigitBits wide.
+    struct Digit
+    {
+        uint8_t Shift;
+        uint8_t Bits;
+    };
+
+    static const uint32_t kMaxDigitBits = 12;
+    static const uint32_t kMaxDigits = 16;
+
+    // Buffers kept between sorts so that steady state sorting does not allocate
+    struct Scratch
+    {
+        std::vector<uint64_t> Keys;
+        std::vector<uint32_t> Histograms;
+    };
+
+    struct Stats
+    {
+        uint32_t NumThreads = 0;
+        uint32_t PassesRun = 0;
+        uint32_t PassesSkippedUniform = 0;
+        uint32_t PassesSkippedPresorted = 0;
+    };
+
+    // Sorts 'keys' in ascending order. 'digits' must be listed from least to most significant
+    // and together cover every bit that can differ between keys. With more than one thread,
+    // histograms and scatters are split into contiguous ranges, one per thread. A thread
+    // count of zero uses every hardware thread.
+    void Sort(uint64_t* keys, size_t count, const Digit* digits, uint32_t numDigits,
+        Scratch& scratch, uint32_t numThreads = 1, Stats* stats = nullptr);
+}
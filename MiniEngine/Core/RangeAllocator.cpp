@@ -0,0 +1,158 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// This file has no engine dependencies so that it can also be built into the standalone
+// allocator fuzz test and benchmark (see Tools/RangeAllocatorBenchmark).
+
+#include "RangeAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+using namespace std;
+
+void RangeAllocator::Reset(uint32_t capacity)
+{
+    m_Capacity = capacity;
+    m_Allocated = 0;
+    m_NumPending = 0;
+    m_PeakAllocated = 0;
+    m_NumAllocations = 0;
+
+    m_FreeByOffset.clear();
+    m_FreeBySize.clear();
+    m_Pending.clear();
+
+    if (capacity > 0)
+        AddFreeRange(0, capacity);
+}
+
+uint32_t RangeAllocator::Allocate(uint32_t count)
+{
+    if (count == 0)
+        return kInvalidOffset;
+
+    auto best = m_FreeBySize.lower_bound(make_pair(count, 0u));
+    if (best == m_FreeBySize.end())
+        return kInvalidOffset;
+
+    const uint32_t size = best->first;
+    const uint32_t offset = best->second;
+
+    RemoveFreeRange(m_FreeByOffset.find(offset));
+    if (size > count)
+        AddFreeRange(offset + count, size - count);
+
+    m_Allocated += count;
+    m_PeakAllocated = max(m_PeakAllocated, m_Allocated + m_NumPending);
+    ++m_NumAllocations;
+    return offset;
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t count)
+{
+    assert(count > 0 && count <= m_Allocated && offset + count <= m_Capacity);
+
+    m_Allocated -= count;
+    --m_NumAllocations;
+
+    // Merge with the free neighbours on either side
+    auto next = m_FreeByOffset.lower_bound(offset);
+    assert(next == m_FreeByOffset.end() || next->first >= offset + count);
+
+    if (next != m_FreeByOffset.begin())
+    {
+        auto prev = std::prev(next);
+        assert(prev->first + prev->second <= offset);
+
+        if (prev->first + prev->second == offset)
+        {
+            offset = prev->first;
+            count += prev->second;
+            RemoveFreeRange(prev);
+        }
+    }
+
+    if (next != m_FreeByOffset.end() && next->first == offset + count)
+    {
+        count += next->second;
+        RemoveFreeRange(next);
+    }
+
+    AddFreeRange(offset, count);
+}
+
+void RangeAllocator::FreeDeferred(uint32_t offset, uint32_t count, uint64_t fenceValue)
+{
+    assert(count > 0 && count <= m_Allocated && offset + count <= m_Capacity);
+
+    m_Allocated -= count;
+    m_NumPending += count;
+
+    PendingRange range = { offset, count, fenceValue };
+    m_Pending.push_back(range);
+}
+
+uint32_t RangeAllocator::ReleaseCompleted(const function<bool(uint64_t)>& isFenceComplete)
+{
+    uint32_t released = 0;
+
+    while (!m_Pending.empty() && isFenceComplete(m_Pending.front().FenceValue))
+    {
+        const PendingRange range = m_Pending.front();
+        m_Pending.pop_front();
+
+        // Free() expects the range to count as allocated
+        m_NumPending -= range.Count;
+        m_Allocated += range.Count;
+        Free(range.Offset, range.Count);
+
+        released += range.Count;
+    }
+
+    return released;
+}
+
+RangeAllocator::Stats RangeAllocator::GetStats() const
+{
+    Stats stats;
+    stats.Capacity = m_Capacity;
+    stats.Allocated = m_Allocated;
+    stats.PeakAllocated = m_PeakAllocated;
+    stats.Pending = m_NumPending;
+    stats.NumAllocations = m_NumAllocations - (uint32_t)m_Pending.size();
+    stats.NumFreeRanges = (uint32_t)m_FreeByOffset.size();
+    stats.LargestFreeRange = m_FreeBySize.empty() ? 0 : m_FreeBySize.rbegin()->first;
+    return stats;
+}
+
+void RangeAllocator::AddFreeRange(uint32_t offset, uint32_t count)
+{
+    m_FreeByOffset.emplace(offset, count);
+    m_FreeBySize.emplace(count, offset);
+}
+
+void RangeAllocator::RemoveFreeRange(map<uint32_t, uint32_t>::iterator range)
+{
+    m_FreeBySize.erase(make_pair(range->second, range->first));
+    m_FreeByOffset.erase(range);
+}
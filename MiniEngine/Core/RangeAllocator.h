@@ -0,0 +1,118 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <set>
+#include <utility>
+
+//
+// Allocates contiguous ranges of slots, e.g. descriptors, out of a fixed capacity and reuses
+// them once they are freed. The allocator only hands out offsets. The caller owns whatever
+// the slots refer to, such as a descriptor heap.
+//
+// Free ranges are kept both by offset, so that a freed range merges with free neighbours,
+// and by size, so that allocation picks the smallest free range that fits (lowest offset
+// among equals). Single descriptors, the common case, then fill holes left by earlier frees
+// before they split a large range.
+//
+// Ranges the GPU may still read are freed with a fence value. They are kept in submission
+// order until ReleaseCompleted() sees that fence complete.
+//
+class RangeAllocator
+{
+public:
+    static const uint32_t kInvalidOffset = 0xFFFFFFFF;
+
+    struct Stats
+    {
+        uint32_t Capacity = 0;
+        uint32_t Allocated = 0;          // Slots in live allocations
+        uint32_t PeakAllocated = 0;      // Most slots allocated at once, including pending ones
+        uint32_t Pending = 0;            // Slots freed but waiting on a fence
+        uint32_t NumAllocations = 0;
+        uint32_t NumFreeRanges = 0;
+        uint32_t LargestFreeRange = 0;
+
+        uint32_t GetFree() const { return Capacity - Allocated - Pending; }
+
+        // Share of the free slots that are not in the largest free range, zero when all free
+        // space is contiguous
+        float GetFragmentation() const
+        {
+            return GetFree() == 0 ? 0.0f : 1.0f - (float)LargestFreeRange / GetFree();
+        }
+    };
+
+    explicit RangeAllocator(uint32_t capacity = 0) { Reset(capacity); }
+
+    // Forgets every allocation and makes the whole capacity one free range
+    void Reset(uint32_t capacity);
+
+    // Returns the offset of 'count' contiguous slots, or kInvalidOffset if no free range is
+    // large enough
+    uint32_t Allocate(uint32_t count);
+
+    // Makes a range returned by Allocate() available again immediately
+    void Free(uint32_t offset, uint32_t count);
+
+    // Makes a range available once 'fenceValue' has completed. Fence values should be passed
+    // in increasing order, as ReleaseCompleted() stops at the first incomplete one.
+    void FreeDeferred(uint32_t offset, uint32_t count, uint64_t fenceValue);
+
+    // Frees the deferred ranges whose fence 'isFenceComplete' reports as done. Returns the
+    // number of slots released.
+    uint32_t ReleaseCompleted(const std::function<bool(uint64_t)>& isFenceComplete);
+
+    bool CanAllocate(uint32_t count) const
+    {
+        return count > 0 && !m_FreeBySize.empty() && m_FreeBySize.rbegin()->first >= count;
+    }
+
+    bool HasPending() const { return !m_Pending.empty(); }
+
+    Stats GetStats() const;
+
+private:
+    struct PendingRange
+    {
+        uint32_t Offset;
+        uint32_t Count;
+        uint64_t FenceValue;
+    };
+
+    void AddFreeRange(uint32_t offset, uint32_t count);
+    void RemoveFreeRange(std::map<uint32_t, uint32_t>::iterator range);
+
+    uint32_t m_Capacity;
+    uint32_t m_Allocated;
+    uint32_t m_NumPending;
+    uint32_t m_PeakAllocated;
+    uint32_t m_NumAllocations;
+
+    std::map<uint32_t, uint32_t> m_FreeByOffset;                // offset -> count
+    std::set<std::pair<uint32_t, uint32_t>> m_FreeBySize;       // (count, offset)
+    std::deque<PendingRange> m_Pending;
+};
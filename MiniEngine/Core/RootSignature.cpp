@@ -15,19 +15,17 @@
 #include "RootSignature.h"
 #include "GraphicsCore.h"
 #include "Hash.h"
-#include <map>
-#include <thread>
-#include <mutex>
+#include "HashCache.h"
 
 using namespace Graphics;
 using namespace std;
 using Microsoft::WRL::ComPtr;
 
-static std::map< size_t, ComPtr<ID3D12RootSignature> > s_RootSignatureHashMap;
+static Utility::HashCache< ComPtr<ID3D12RootSignature> > s_RootSignatureCache;
 
 void RootSignature::DestroyAll(void)
 {
-    s_RootSignatureHashMap.clear();
+    s_RootSignatureCache.Clear();
 }
 
 void RootSignature::InitStaticSampler(
@@ -131,44 +129,21 @@ void RootSignature::Finalize(const std::wstring& name, D3D12_ROOT_SIGNATURE_FLAG
             HashCode = Utility::HashState( &RootParam, 1, HashCode );
     }
 
-    ID3D12RootSignature** RSRef = nullptr;
-    bool firstCompile = false;
-    {
-        static mutex s_HashMapMutex;
-        lock_guard<mutex> CS(s_HashMapMutex);
-        auto iter = s_RootSignatureHashMap.find(HashCode);
-
-        // Reserve space so the next inquiry will find that someone got here first.
-        if (iter == s_RootSignatureHashMap.end())
-        {
-            RSRef = s_RootSignatureHashMap[HashCode].GetAddressOf();
-            firstCompile = true;
-        }
-        else
-            RSRef = iter->second.GetAddressOf();
-    }
-
-    if (firstCompile)
+    const ComPtr<ID3D12RootSignature>& RSRef = s_RootSignatureCache.GetOrCreate(HashCode, [&]()
     {
         ComPtr<ID3DBlob> pOutBlob, pErrorBlob;
+        ComPtr<ID3D12RootSignature> NewSignature;
 
         ASSERT_SUCCEEDED( D3D12SerializeRootSignature(&RootDesc, D3D_ROOT_SIGNATURE_VERSION_1,
             pOutBlob.GetAddressOf(), pErrorBlob.GetAddressOf()));
 
         ASSERT_SUCCEEDED( g_Device->CreateRootSignature(1, pOutBlob->GetBufferPointer(), pOutBlob->GetBufferSize(),
-            MY_IID_PPV_ARGS(&m_Signature)) );
-
-        m_Signature->SetName(name.c_str());
+            MY_IID_PPV_ARGS(NewSignature.GetAddressOf())) );
 
-        s_RootSignatureHashMap[HashCode].Attach(m_Signature);
-        ASSERT(*RSRef == m_Signature);
-    }
-    else
-    {
-        while (*RSRef == nullptr)
-            this_thread::yield();
-        m_Signature = *RSRef;
-    }
+        NewSignature->SetName(name.c_str());
+        return NewSignature;
+    });
+    m_Signature = RSRef.Get();
 
     m_Finalized = TRUE;
 }
@@ -0,0 +1,192 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+// This file has no engine dependencies so that it can also be built into the
+// standalone VRS statistics benchmark (see Tools/VRSStatsBenchmark).
+
+#include "ShadingRateHistogram.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define ENABLE_SSE_HISTOGRAM 1
+#include <emmintrin.h>
+#else
+#define ENABLE_SSE_HISTOGRAM 0
+#endif
+
+using namespace ShadingRateHistogram;
+
+namespace
+{
+    void Finalize(Histogram& histogram, uint64_t total)
+    {
+        uint64_t known = 0;
+        for (uint32_t r = 0; r < kNumRates; ++r)
+            known += histogram.Counts[r];
+
+        histogram.Total = total;
+        histogram.Other = total - known;
+    }
+
+    inline void CountScalar(const uint8_t* tiles, uint32_t count, Histogram& histogram)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            for (uint32_t r = 0; r < kNumRates; ++r)
+            {
+                if (tiles[i] == kRateValues[r])
+                {
+                    ++histogram.Counts[r];
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void ShadingRateHistogram::BuildScalar(const uint8_t* tiles, uint32_t width, uint32_t height, uint32_t rowPitch,
+    Histogram& histogram)
+{
+    memset(&histogram, 0, sizeof(histogram));
+
+    for (uint32_t y = 0; y < height; ++y)
+        CountScalar(tiles + (size_t)y * rowPitch, width, histogram);
+
+    Finalize(histogram, (uint64_t)width * height);
+}
+
+void ShadingRateHistogram::Build(const uint8_t* tiles, uint32_t width, uint32_t height, uint32_t rowPitch,
+    Histogram& histogram)
+{
+#if ENABLE_SSE_HISTOGRAM
+    memset(&histogram, 0, sizeof(histogram));
+
+    // A tightly packed image is one long row
+    if (rowPitch == width)
+    {
+        width *= height;
+        height = height > 0 ? 1 : 0;
+    }
+
+    __m128i values[kNumRates];
+    __m128i counters[kNumRates];
+    for (uint32_t r = 0; r < kNumRates; ++r)
+    {
+        values[r] = _mm_set1_epi8((char)kRateValues[r]);
+        counters[r] = _mm_setzero_si128();
+    }
+
+    // Byte counters are widened with SAD against zero every 255 steps
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t wide[kNumRates] = {};
+    uint32_t steps = 0;
+
+    auto flush = [&]()
+    {
+        for (uint32_t r = 0; r < kNumRates; ++r)
+        {
+            __m128i sums = _mm_sad_epu8(counters[r], zero);
+            wide[r] += (uint64_t)_mm_cvtsi128_si32(sums) + (uint64_t)_mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+            counters[r] = _mm_setzero_si128();
+        }
+        steps = 0;
+    };
+
+    const uint32_t vectorWidth = width & ~15u;
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint8_t* row = tiles + (size_t)y * rowPitch;
+
+        for (uint32_t x = 0; x < vectorWidth; x += 16)
+        {
+            const __m128i block = _mm_loadu_si128((const __m128i*)(row + x));
+
+            // Matches are -1, so subtracting them counts up
+            for (uint32_t r = 0; r < kNumRates; ++r)
+                counters[r] = _mm_sub_epi8(counters[r], _mm_cmpeq_epi8(block, values[r]));
+
+            if (++steps == 255)
+                flush();
+        }
+
+        CountScalar(row + vectorWidth, width - vectorWidth, histogram);
+    }
+
+    flush();
+
+    for (uint32_t r = 0; r < kNumRates; ++r)
+        histogram.Counts[r] += wide[r];
+
+    Finalize(histogram, (uint64_t)width * height);
+#else
+    BuildScalar(tiles, width, height, rowPitch, histogram);
+#endif
+}
+
+void RollingAverage::Reset()
+{
+    memset(m_Sums, 0, sizeof(m_Sums));
+    m_Window = 16;
+    m_NumSamples = 0;
+    m_Next = 0;
+}
+
+void RollingAverage::SetWindow(uint32_t window)
+{
+    window = std::min(std::max(window, 1u), kMaxWindow);
+    if (window == m_Window)
+        return;
+
+    // Samples are not kept in window order, so start over
+    Reset();
+    m_Window = window;
+}
+
+void RollingAverage::Add(const Histogram& histogram)
+{
+    float* sample = m_Samples[m_Next];
+
+    if (m_NumSamples == m_Window)
+    {
+        for (uint32_t r = 0; r < kNumRates; ++r)
+            m_Sums[r] -= sample[r];
+    }
+    else
+    {
+        ++m_NumSamples;
+    }
+
+    const double scale = histogram.Total > 0 ? 100.0 / histogram.Total : 0.0;
+    for (uint32_t r = 0; r < kNumRates; ++r)
+    {
+        sample[r] = (float)(histogram.Counts[r] * scale);
+        m_Sums[r] += sample[r];
+    }
+
+    m_Next = (m_Next + 1) % m_Window;
+}
+
+float RollingAverage::GetPercent(Rate rate) const
+{
+    return m_NumSamples > 0 ? (float)(m_Sums[rate] / m_NumSamples) : 0.0f;
+}
@@ -0,0 +1,81 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+
+//
+// Counts the shading rates in a readback of the VRS Tier 2 shading rate image.
+//
+// Each tile is one byte holding a D3D12_SHADING_RATE value. The counting kernel compares 16
+// tiles at a time against every rate with SSE2, accumulates matches in byte counters and
+// widens them before they can overflow. Bytes that are not a known rate are counted as other.
+//
+// This has no D3D12 dependency so that it can be built into the standalone benchmark (see
+// Tools/VRSStatsBenchmark). VRS.cpp checks that the encodings below match D3D12_SHADING_RATE.
+//
+namespace ShadingRateHistogram
+{
+    enum Rate
+    {
+        k1x1, k1x2, k2x1, k2x2, k2x4, k4x2, k4x4,
+        kNumRates
+    };
+
+    // The D3D12_SHADING_RATE value of each Rate
+    constexpr uint8_t kRateValues[kNumRates] = { 0x0, 0x1, 0x4, 0x5, 0x6, 0x9, 0xA };
+
+    struct Histogram
+    {
+        uint64_t Counts[kNumRates];
+        uint64_t Other;
+        uint64_t Total;
+    };
+
+    // Counts the 'width' x 'height' tiles of an image whose rows start 'rowPitch' bytes apart
+    void Build(const uint8_t* tiles, uint32_t width, uint32_t height, uint32_t rowPitch, Histogram& histogram);
+
+    // One tile at a time, for reference
+    void BuildScalar(const uint8_t* tiles, uint32_t width, uint32_t height, uint32_t rowPitch, Histogram& histogram);
+
+    // Percentage of each rate averaged over the last 'window' histograms, up to kMaxWindow
+    class RollingAverage
+    {
+    public:
+        static const uint32_t kMaxWindow = 64;
+
+        RollingAverage() { Reset(); }
+
+        void Reset();
+        void SetWindow(uint32_t window);
+        void Add(const Histogram& histogram);
+
+        uint32_t GetSampleCount() const { return m_NumSamples; }
+        float GetPercent(Rate rate) const;
+
+    private:
+        float m_Samples[kMaxWindow][kNumRates];
+        double m_Sums[kNumRates];
+        uint32_t m_Window;
+        uint32_t m_NumSamples;
+        uint32_t m_Next;
+    };
+}
@@ -0,0 +1,183 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// This file has no engine dependencies so that it can also be built into the
+// standalone inflate benchmark (see Tools/InflateBenchmark).
+
+#include "StreamingInflate.h"
+
+#include <algorithm>
+#include <zlib.h>
+
+using namespace std;
+using namespace StreamingInflate;
+
+namespace
+{
+    // zlib counts bytes in 32-bit uInts, so longer buffers are fed in slices
+    const size_t kMaxSlice = 1u << 30;
+
+    // Deflate can't do much better than 1032:1, so a larger trailer size is not trusted
+    const uint64_t kMaxCompressionRatio = 1032;
+
+    // Without a trusted size the destination starts at this multiple of the compressed size
+    const uint64_t kDefaultExpansion = 4;
+
+    class Inflater
+    {
+    public:
+        Inflater(const uint8_t* source, size_t sourceSize) : m_Source(source), m_SourceSize(sourceSize), m_Consumed(0)
+        {
+            m_Stream = {};
+            m_Stream.data_type = Z_BINARY;
+
+            // 15 window bits, and +32 detects whether the stream is zlib or gzip
+            m_Status = inflateInit2(&m_Stream, 15 + 32);
+            m_Initialized = m_Status == Z_OK;
+        }
+
+        ~Inflater()
+        {
+            if (m_Initialized)
+                inflateEnd(&m_Stream);
+        }
+
+        // Decodes as much as fits into 'dest'. Returns the number of bytes written, and
+        // afterwards IsRunning() is false once the stream ended or failed.
+        size_t Decode(uint8_t* dest, size_t destSize)
+        {
+            if (m_Stream.avail_in == 0)
+            {
+                const size_t slice = min(m_SourceSize - m_Consumed, kMaxSlice);
+                m_Stream.next_in = const_cast<Bytef*>(m_Source + m_Consumed);
+                m_Stream.avail_in = (uInt)slice;
+                m_Consumed += slice;
+            }
+
+            destSize = min(destSize, kMaxSlice);
+            m_Stream.next_out = dest;
+            m_Stream.avail_out = (uInt)destSize;
+            m_Status = inflate(&m_Stream, Z_NO_FLUSH);
+
+            // No progress was possible because the current input slice ran out
+            if (m_Status == Z_BUF_ERROR && m_Consumed < m_SourceSize)
+                m_Status = Z_OK;
+
+            return destSize - m_Stream.avail_out;
+        }
+
+        bool IsRunning() const { return m_Status == Z_OK; }
+
+        Status GetStatus() const
+        {
+            switch (m_Status)
+            {
+            case Z_OK:
+            case Z_STREAM_END:  return kSuccess;
+            case Z_BUF_ERROR:   return kTruncated;
+            case Z_MEM_ERROR:   return kOutOfMemory;
+            default:            return kCorruptData;
+            }
+        }
+
+    private:
+        z_stream m_Stream;
+        const uint8_t* m_Source;
+        size_t m_SourceSize;
+        size_t m_Consumed;
+        int m_Status;
+        bool m_Initialized;
+    };
+}
+
+const char* StreamingInflate::GetStatusName(Status status)
+{
+    switch (status)
+    {
+    case kSuccess:      return "success";
+    case kCorruptData:  return "corrupt data";
+    case kTruncated:    return "truncated";
+    case kAborted:      return "aborted";
+    case kOutOfMemory:  return "out of memory";
+    default:            return "unknown";
+    }
+}
+
+uint32_t StreamingInflate::GetGzipSize(const uint8_t* source, size_t sourceSize)
+{
+    // A 10 byte header, an empty deflate block at the least, then CRC-32 and ISIZE
+    if (sourceSize < 20 || source[0] != 0x1F || source[1] != 0x8B)
+        return 0;
+
+    const uint8_t* isize = source + sourceSize - 4;
+    return (uint32_t)isize[0] | (uint32_t)isize[1] << 8 | (uint32_t)isize[2] << 16 | (uint32_t)isize[3] << 24;
+}
+
+Status StreamingInflate::InflateToBuffer(const uint8_t* source, size_t sourceSize, vector<uint8_t>& destination)
+{
+    Inflater inflater(source, sourceSize);
+    if (!inflater.IsRunning())
+        return inflater.GetStatus();
+
+    uint64_t capacity = GetGzipSize(source, sourceSize);
+    if (capacity == 0 || capacity > sourceSize * kMaxCompressionRatio)
+        capacity = sourceSize * kDefaultExpansion;
+
+    destination.resize((size_t)max<uint64_t>(capacity, 1));
+
+    size_t written = 0;
+    while (inflater.IsRunning())
+    {
+        // Only reached when the trailer was missing or wrong
+        if (written == destination.size())
+            destination.resize(destination.size() * 2);
+
+        written += inflater.Decode(destination.data() + written, destination.size() - written);
+    }
+
+    // Shrinking keeps the allocation, so a wrong estimate costs memory but never a copy
+    destination.resize(written);
+
+    return inflater.GetStatus();
+}
+
+Status StreamingInflate::InflateChunks(const uint8_t* source, size_t sourceSize, const ChunkCallback& callback,
+    size_t chunkSize)
+{
+    Inflater inflater(source, sourceSize);
+
+    vector<uint8_t> chunk(max<size_t>(min(chunkSize, kMaxSlice), 1));
+    size_t filled = 0;
+
+    while (inflater.IsRunning())
+    {
+        filled += inflater.Decode(chunk.data() + filled, chunk.size() - filled);
+
+        if (filled == chunk.size() || (!inflater.IsRunning() && filled > 0))
+        {
+            if (!callback(chunk.data(), filled))
+                return kAborted;
+            filled = 0;
+        }
+    }
+
+    return inflater.GetStatus();
+}
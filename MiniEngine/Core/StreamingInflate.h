@@ -0,0 +1,71 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+//
+// Streaming zlib/gzip decompression, used by Utility::ReadFileSync for ".gz" files.
+//
+// InflateToBuffer decodes straight into the destination vector. For gzip streams the size
+// stored in the trailer (the uncompressed size modulo 2^32) sizes the destination up front,
+// so a well formed file is decoded with a single allocation and no intermediate copies. The
+// trailer is only a hint: the buffer still grows if it was wrong and is trimmed at the end.
+//
+// InflateChunks decodes through one reusable buffer and hands every filled chunk to a
+// callback, so a consumer can parse the data while it is being decoded without ever holding
+// all of it.
+//
+namespace StreamingInflate
+{
+    enum Status
+    {
+        kSuccess,
+        kCorruptData,       // Not a zlib or gzip stream, or a checksum mismatch
+        kTruncated,         // The input ended before the end of the stream
+        kAborted,           // The chunk callback returned false
+        kOutOfMemory,
+    };
+
+    const char* GetStatusName(Status status);
+
+    // Returns the uncompressed size from the trailer of a gzip stream, or zero when 'source'
+    // is not a gzip stream. Sizes of 4 GB and more are truncated to 32 bits.
+    uint32_t GetGzipSize(const uint8_t* source, size_t sourceSize);
+
+    // Replaces the contents of 'destination' with the decompressed data. On failure the
+    // contents are unspecified.
+    Status InflateToBuffer(const uint8_t* source, size_t sourceSize, std::vector<uint8_t>& destination);
+
+    // Returns false from the callback to stop decoding
+    typedef std::function<bool(const uint8_t* data, size_t size)> ChunkCallback;
+
+    static const size_t kDefaultChunkSize = 256 * 1024;
+
+    // Calls 'callback' with consecutive pieces of the decompressed data, each at most
+    // 'chunkSize' bytes. The data is only valid for the duration of the call.
+    Status InflateChunks(const uint8_t* source, size_t sourceSize, const ChunkCallback& callback,
+        size_t chunkSize = kDefaultChunkSize);
+}
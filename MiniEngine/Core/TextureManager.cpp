@@ -19,111 +19,222 @@
 #include "FileUtility.h"
 #include "GraphicsCommon.h"
 #include "CommandContext.h"
-#include <map>
-#include <thread>
+#include "CommandListManager.h"
+#include "TextureRegistry.h"
+#include "TextureResidency.h"
+#include "Util/CommandLineArg.h"
+#include <atomic>
+#include <deque>
 
 using namespace std;
 using namespace Graphics;
 using Utility::ByteArray;
+using Microsoft::WRL::ComPtr;
 
 //
 // A ManagedTexture allows for multiple threads to request a Texture load of the same
-// file.  It also contains a reference count of the Texture so that it can be freed
+// file.  The TextureRegistry it belongs to counts its references so that it can be freed
 // when it is no longer referenced.
 //
 // Raw ManagedTexture pointers are not exposed to clients.  
 //
-class ManagedTexture : public Texture
+class ManagedTexture : public Texture, public TextureRegistry::Entry
 {
     friend class TextureRef;
 
 public:
-    ManagedTexture( const wstring& FileName );
+    ManagedTexture();
+    ~ManagedTexture();
 
-    void WaitForLoad(void) const;
     void CreateFromMemory(ByteArray memory, eDefaultTexture fallback, bool sRGB);
 
+    // Loads the mip tail of a DDS file and registers the texture for streaming.  Returns false,
+    // leaving the texture as it was, if the file cannot be streamed.
+    bool CreateStreamed(const wstring& filePath, bool sRGB);
+
+    // Replaces the resource with one holding mips [firstMip, mipCount).  Mips that are not
+    // resident yet come from 'mipData', the file contents from firstMip on; the others are copied
+    // on the GPU.  The old resource is returned in 'replaced' to be released after 'context'.
+    bool SetResidentMips(CommandContext& context, uint32_t firstMip, const uint8_t* mipData, size_t mipDataSize,
+        ComPtr<ID3D12Resource>& replaced);
+
+    void AddCoverageHint(float pixels);
+    float TakeCoverageHint(void);
+
+    const DDS_TEXTURE_LAYOUT& GetLayout(void) const { return *m_Layout; }
+    const wstring& GetFilePath(void) const { return m_FilePath; }
+
 private:
 
     bool IsValid(void) const { return m_IsValid; }
-    void Unload();
 
-    std::wstring m_MapKey;		// For deleting from the map later
     bool m_IsValid;
-    bool m_IsLoading;
-    size_t m_ReferenceCount;
+    bool m_OwnsDescriptor;      // False when the SRV is a shared default texture
+
+    // Streaming
+    std::unique_ptr<DDS_TEXTURE_LAYOUT> m_Layout;   // Null unless streamed
+    std::wstring m_FilePath;
+    bool m_ForceSRGB;
+    uint32_t m_FirstMip;                    // Most detailed mip in m_pResource
+    uint32_t m_ResidencyHandle;
+    std::atomic<uint32_t> m_CoverageHint;   // Bits of the largest float hint this frame
 };
 
 namespace TextureManager
 {
     wstring s_RootPath = L"";
-    map<wstring, std::unique_ptr<ManagedTexture>> s_TextureCache;
+    TextureRegistry s_TextureRegistry;
+
+    // Mips up to this size are loaded up front and never evicted
+    const uint32_t kStreamingTailSize = 128;
+
+    // A read of mips for a streamed texture, completed on a worker thread
+    struct StreamingRead
+    {
+        uint32_t Handle;
+        uint32_t FirstMip;
+        uint32_t EndMip;
+        size_t Size;
+        ByteArray Data;
+        atomic<bool> Done;
+    };
+
+    // Guards the streaming state below.  Textures unregister when their last reference is
+    // released, so this is never held while calling into s_TextureRegistry.
+    mutex s_StreamingMutex;
+    bool s_StreamingEnabled = false;
+    TextureResidency s_Residency;
+    vector<ManagedTexture*> s_StreamedTextures;             // By residency handle
+    vector<shared_ptr<StreamingRead>> s_Reads;
+    deque<pair<uint64_t, ComPtr<ID3D12Resource>>> s_RetiredResources;
+    vector<TextureResidency::Load> s_Loads;
+    vector<TextureResidency::Eviction> s_Evictions;
+    uint64_t s_StreamingFrame = 0;
+    atomic<uint32_t> s_StreamingGeneration(0);
 
     void Initialize( const wstring& TextureLibRoot )
     {
         s_RootPath = TextureLibRoot;
+
+        uint32_t budgetMB = 0;
+        CommandLineArgs::GetInteger(L"texture_streaming_mb", budgetMB);
+        s_StreamingEnabled = budgetMB > 0;
+
+        TextureResidency::Settings settings;
+        settings.BudgetBytes = (uint64_t)budgetMB << 20;
+        s_Residency.SetSettings(settings);
     }
 
     void Shutdown( void )
     {
-        s_TextureCache.clear();
-    }
+        if (s_StreamingEnabled)
+        {
+            TextureResidency::Stats stats = s_Residency.GetStats();
+            LOG_INFOF("Texture streaming: %u loads of %llu MB, %u mips evicted, %u failed loads.", stats.Loads,
+                (unsigned long long)(stats.LoadedBytes >> 20), stats.Evictions, stats.FailedLoads);
+        }
+
+        TextureRegistry::Stats registryStats = s_TextureRegistry.GetStats();
+        LOG_INFOF("Texture registry: %llu hits, %llu misses, %llu waits for %.1f ms.", (unsigned long long)registryStats.Hits,
+            (unsigned long long)registryStats.Misses, (unsigned long long)registryStats.Waits, registryStats.WaitMs);
+
+        s_TextureRegistry.Clear();
 
-    mutex s_Mutex;
+        lock_guard<mutex> Guard(s_StreamingMutex);
+        s_Reads.clear();
+        s_RetiredResources.clear();
+    }
 
-    ManagedTexture* FindOrLoadTexture( const wstring& fileName, eDefaultTexture fallback, bool forceSRGB )
+    uint32_t RegisterStreamedTexture( ManagedTexture* tex, const TextureResidency::TextureDesc& desc )
     {
-        ManagedTexture* tex = nullptr;
+        lock_guard<mutex> Guard(s_StreamingMutex);
 
-        {
-            lock_guard<mutex> Guard(s_Mutex);
+        uint32_t handle = s_Residency.AddTexture(desc);
+        if (handle >= s_StreamedTextures.size())
+            s_StreamedTextures.resize(handle + 1);
+        s_StreamedTextures[handle] = tex;
+        return handle;
+    }
 
-            wstring key = fileName;
-            if (forceSRGB)
-                key += L"_sRGB";
+    void UnregisterStreamedTexture( uint32_t handle )
+    {
+        lock_guard<mutex> Guard(s_StreamingMutex);
 
-            // Search for an existing managed texture
-            auto iter = s_TextureCache.find(key);
-            if (iter != s_TextureCache.end())
+        // A read in flight finishes into its StreamingRead, which is then forgotten
+        for (size_t i = 0; i < s_Reads.size(); )
+        {
+            if (s_Reads[i]->Handle == handle)
             {
-                // If a texture was already created make sure it has finished loading before
-                // returning a point to it.
-                tex = iter->second.get();
-                tex->WaitForLoad();
-                return tex;
+                s_Reads[i] = s_Reads.back();
+                s_Reads.pop_back();
             }
             else
-            {
-                // If it's not found, create a new managed texture and start loading it
-                tex = new ManagedTexture(key);
-                s_TextureCache[key].reset(tex);
-            }
+                ++i;
         }
 
-        Utility::ByteArray ba = Utility::ReadFileSync( s_RootPath + fileName );
-        tex->CreateFromMemory(ba, fallback, forceSRGB);
-
-        // This was the first time it was requested, so indicate that the caller must read the file
-        return tex;
+        s_Residency.RemoveTexture(handle);
+        s_StreamedTextures[handle] = nullptr;
     }
 
-    void DestroyTexture(const wstring& key)
+    TextureRef FindOrLoadTexture( const wstring& fileName, eDefaultTexture fallback, bool forceSRGB,
+        Utility::ByteArray fileData = nullptr, bool stream = false )
     {
-        lock_guard<mutex> Guard(s_Mutex);
+        wstring key = fileName;
+        if (forceSRGB)
+            key += L"_sRGB";
+        if (stream)
+            key += L"_streamed";
+
+        bool created;
+        ManagedTexture* tex = static_cast<ManagedTexture*>(
+            s_TextureRegistry.Acquire(key, [] { return new ManagedTexture; }, created));
+
+        // Hand the reference from Acquire over to the TextureRef
+        TextureRef ref(tex);
+        s_TextureRegistry.Release(*tex);
+
+        // If a texture was already created make sure it has finished loading before
+        // returning a reference to it.
+        if (!created)
+        {
+            s_TextureRegistry.WaitForLoad(*tex);
+            return ref;
+        }
+
+        // This was the first time it was requested, so the caller must read the file
+        if (!stream || !tex->CreateStreamed(s_RootPath + fileName, forceSRGB))
+        {
+            if (fileData == nullptr)
+                fileData = Utility::ReadFileSync( s_RootPath + fileName );
+
+            tex->CreateFromMemory(fileData, fallback, forceSRGB);
+        }
 
-        auto iter = s_TextureCache.find(key);
-        if (iter != s_TextureCache.end())
-            s_TextureCache.erase(iter);
+        s_TextureRegistry.MarkLoaded(*tex);
+        return ref;
     }
 
 } // namespace TextureManager
 
-ManagedTexture::ManagedTexture( const wstring& FileName )
-    : m_MapKey(FileName), m_IsValid(false), m_IsLoading(true), m_ReferenceCount(0)
+ManagedTexture::ManagedTexture()
+    : m_IsValid(false), m_OwnsDescriptor(false), m_ForceSRGB(false), m_FirstMip(0),
+    m_ResidencyHandle(TextureResidency::kInvalidHandle), m_CoverageHint(0)
 {
     m_hCpuDescriptorHandle.ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
 }
 
+ManagedTexture::~ManagedTexture()
+{
+    // First, so that UpdateStreaming() no longer sees this texture
+    if (m_ResidencyHandle != TextureResidency::kInvalidHandle)
+        TextureManager::UnregisterStreamedTexture(m_ResidencyHandle);
+
+    // Streamed out textures return their SRV for reuse.  After Graphics::Shutdown the
+    // descriptor heaps are already gone.
+    if (m_OwnsDescriptor && g_Device != nullptr)
+        FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_hCpuDescriptorHandle);
+}
+
 void ManagedTexture::CreateFromMemory(ByteArray ba, eDefaultTexture fallback, bool forceSRGB)
 {
     if (ba->size() == 0)
@@ -134,6 +245,7 @@ void ManagedTexture::CreateFromMemory(ByteArray ba, eDefaultTexture fallback, bo
     {
         // We probably have a texture to load, so let's allocate a new descriptor
         m_hCpuDescriptorHandle = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        m_OwnsDescriptor = true;
 
         if ( SUCCEEDED( CreateDDSTextureFromMemory( g_Device, (const uint8_t*)ba->data(), ba->size(),
             0, forceSRGB, m_pResource.GetAddressOf(), m_hCpuDescriptorHandle) ) )
@@ -150,56 +262,178 @@ void ManagedTexture::CreateFromMemory(ByteArray ba, eDefaultTexture fallback, bo
                 D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
         }
     }
+}
+
+bool ManagedTexture::CreateStreamed(const wstring& filePath, bool forceSRGB)
+{
+    using namespace TextureManager;
+
+    ByteArray header = Utility::ReadFileRange(filePath, 0, DDS_MAX_HEADER_SIZE);
+    std::unique_ptr<DDS_TEXTURE_LAYOUT> layout(new DDS_TEXTURE_LAYOUT);
+    if (FAILED(GetDDSTextureLayout((const uint8_t*)header->data(), header->size(), layout.get())) ||
+        layout->resDim != D3D12_RESOURCE_DIMENSION_TEXTURE2D || layout->arraySize != 1 ||
+        layout->mipCount > TextureResidency::kMaxMips)
+    {
+        return false;
+    }
 
-    m_IsLoading = false;
+    uint32_t tailMip = 0;
+    while (tailMip + 1 < layout->mipCount && max(layout->width >> tailMip, layout->height >> tailMip) > kStreamingTailSize)
+        ++tailMip;
+
+    // Nothing to stream, or a mip that would become the top one has rounded dimensions, which
+    // block compressed formats cannot start with
+    const uint32_t alignMask = (1u << tailMip) - 1;
+    if (tailMip == 0 || (layout->width & alignMask) != 0 || (layout->height & alignMask) != 0)
+        return false;
+
+    const size_t tailOffset = layout->mipOffset[tailMip];
+    const size_t tailSize = layout->mipOffset[layout->mipCount] - tailOffset;
+    ByteArray tail = Utility::ReadFileRange(filePath, tailOffset, tailSize);
+    if (tail->size() != tailSize)
+        return false;
+
+    D3D12_CPU_DESCRIPTOR_HANDLE srv = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    m_hCpuDescriptorHandle = srv;
+    m_Layout = std::move(layout);
+    m_FilePath = filePath;
+    m_ForceSRGB = forceSRGB;
+    m_FirstMip = m_Layout->mipCount;
+
+    ComPtr<ID3D12Resource> replaced;
+    CommandContext& context = CommandContext::Begin(L"Texture Streaming");
+    bool succeeded = SetResidentMips(context, tailMip, (const uint8_t*)tail->data(), tail->size(), replaced);
+    context.Finish();
+
+    if (!succeeded)
+    {
+        FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, srv);
+        m_hCpuDescriptorHandle.ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
+        m_Layout = nullptr;
+        return false;
+    }
+
+    TextureResidency::TextureDesc desc;
+    desc.Width = m_Layout->width;
+    desc.Height = m_Layout->height;
+    desc.NumMips = m_Layout->mipCount;
+    desc.TailMip = tailMip;
+    for (uint32_t mip = 0; mip < m_Layout->mipCount; ++mip)
+        desc.MipBytes[mip] = m_Layout->mipOffset[mip + 1] - m_Layout->mipOffset[mip];
+
+    m_OwnsDescriptor = true;
+    m_IsValid = true;
+    m_Width = m_Layout->width;
+    m_Height = m_Layout->height;
+    m_Depth = 1;
+    m_ResidencyHandle = RegisterStreamedTexture(this, desc);
+    return true;
 }
 
-void ManagedTexture::WaitForLoad( void ) const
+bool ManagedTexture::SetResidentMips(CommandContext& context, uint32_t firstMip, const uint8_t* mipData, size_t mipDataSize,
+    ComPtr<ID3D12Resource>& replaced)
 {
-    while ((volatile bool&)m_IsLoading)
-        this_thread::yield();
+    const DDS_TEXTURE_LAYOUT& layout = *m_Layout;
+
+    // Mips [firstMip, uploadEnd) come from the file, the rest from the current resource
+    const uint32_t uploadEnd = mipData != nullptr ? m_FirstMip : firstMip;
+    ASSERT(firstMip < layout.mipCount && uploadEnd <= layout.mipCount);
+
+    D3D12_SUBRESOURCE_DATA subresources[D3D12_REQ_MIP_LEVELS];
+    if (uploadEnd > firstMip &&
+        FAILED(GetDDSMipData(layout, firstMip, uploadEnd, mipData, mipDataSize, subresources)))
+    {
+        return false;
+    }
+
+    ComPtr<ID3D12Resource> resource;
+    if (FAILED(CreateDDSTextureMips(g_Device, layout, firstMip, m_ForceSRGB, resource.GetAddressOf(),
+        m_hCpuDescriptorHandle)))
+    {
+        return false;
+    }
+
+    // Streamed textures are always left in GENERIC_READ, which includes COPY_SOURCE
+    GpuResource previous(m_pResource.Get(), D3D12_RESOURCE_STATE_GENERIC_READ);
+    const uint32_t previousFirstMip = m_FirstMip;
+
+    m_pResource = resource;
+    m_UsageState = D3D12_RESOURCE_STATE_COPY_DEST;
+    m_TransitioningState = (D3D12_RESOURCE_STATES)-1;
+    m_FirstMip = firstMip;
+    ++m_VersionID;
+
+    if (uploadEnd > firstMip)
+        context.UpdateTexture(*this, 0, uploadEnd - firstMip, subresources);
+
+    for (uint32_t mip = max(firstMip, previousFirstMip); mip < layout.mipCount; ++mip)
+        context.CopySubresource(*this, mip - firstMip, previous, mip - previousFirstMip);
+
+    context.TransitionResource(*this, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+    replaced = previous.GetResource();
+    ++TextureManager::s_StreamingGeneration;
+    return true;
 }
 
-void ManagedTexture::Unload()
+void ManagedTexture::AddCoverageHint(float pixels)
 {
-    TextureManager::DestroyTexture(m_MapKey);
+    if (!(pixels > 0.0f))
+        return;
+
+    // Positive floats order the same as their bits
+    uint32_t bits;
+    memcpy(&bits, &pixels, sizeof(bits));
+
+    uint32_t current = m_CoverageHint.load(memory_order_relaxed);
+    while (bits > current && !m_CoverageHint.compare_exchange_weak(current, bits, memory_order_relaxed))
+        ;
+}
+
+float ManagedTexture::TakeCoverageHint(void)
+{
+    uint32_t bits = m_CoverageHint.exchange(0, memory_order_relaxed);
+    float pixels;
+    memcpy(&pixels, &bits, sizeof(pixels));
+    return pixels;
 }
 
 TextureRef::TextureRef( const TextureRef& ref ) : m_ref(ref.m_ref)
 {
     if (m_ref != nullptr)
-        ++m_ref->m_ReferenceCount;
+        TextureManager::s_TextureRegistry.AddRef(*m_ref);
 }
 
 TextureRef::TextureRef( ManagedTexture* tex ) : m_ref(tex)
 {
     if (m_ref != nullptr)
-        ++m_ref->m_ReferenceCount;
+        TextureManager::s_TextureRegistry.AddRef(*m_ref);
 }
 
 TextureRef::~TextureRef()
 {
-    if (m_ref != nullptr && --m_ref->m_ReferenceCount == 0)
-        m_ref->Unload();
+    if (m_ref != nullptr)
+        TextureManager::s_TextureRegistry.Release(*m_ref);
 }
 
 void TextureRef::operator= (std::nullptr_t)
 {
     if (m_ref != nullptr)
-        --m_ref->m_ReferenceCount;
+        TextureManager::s_TextureRegistry.Release(*m_ref);
 
     m_ref = nullptr;
 }
 
 void TextureRef::operator= (TextureRef& rhs)
 {
+    // Add first in case both refer to the same texture
+    if (rhs.m_ref != nullptr)
+        TextureManager::s_TextureRegistry.AddRef(*rhs.m_ref);
+
     if (m_ref != nullptr)
-        --m_ref->m_ReferenceCount;
+        TextureManager::s_TextureRegistry.Release(*m_ref);
 
     m_ref = rhs.m_ref;
-
-    if (m_ref != nullptr)
-        ++m_ref->m_ReferenceCount;
 }
 
 bool TextureRef::IsValid() const
@@ -218,6 +452,12 @@ const Texture* TextureRef::operator->( void ) const
     return m_ref;
 }
 
+void TextureRef::SetCoverageHint( float pixels ) const
+{
+    if (m_ref != nullptr && m_ref->m_ResidencyHandle != TextureResidency::kInvalidHandle)
+        m_ref->AddCoverageHint(pixels);
+}
+
 D3D12_CPU_DESCRIPTOR_HANDLE TextureRef::GetSRV() const
 {
     if (m_ref != nullptr)
@@ -236,3 +476,121 @@ TextureRef TextureManager::LoadDDSFromFile( const string& filePath, eDefaultText
 {
     return LoadDDSFromFile(Utility::UTF8ToWideString(filePath), fallback, forceSRGB);
 }
+
+TextureRef TextureManager::LoadDDSFromMemory( const wstring& filePath, ByteArray fileData, eDefaultTexture fallback, bool forceSRGB )
+{
+    return FindOrLoadTexture(filePath, fallback, forceSRGB, fileData);
+}
+
+bool TextureManager::IsStreamingEnabled( void )
+{
+    return s_StreamingEnabled;
+}
+
+TextureRef TextureManager::StreamDDSFromFile( const wstring& filePath, eDefaultTexture fallback, bool forceSRGB )
+{
+    return FindOrLoadTexture(filePath, fallback, forceSRGB, nullptr, s_StreamingEnabled);
+}
+
+uint32_t TextureManager::GetStreamingGeneration( void )
+{
+    return s_StreamingGeneration;
+}
+
+void TextureManager::UpdateStreaming( void )
+{
+    if (!s_StreamingEnabled)
+        return;
+
+    lock_guard<mutex> Guard(s_StreamingMutex);
+    ++s_StreamingFrame;
+
+    // Resources replaced in earlier frames are released once the GPU is done with them
+    while (!s_RetiredResources.empty() && g_CommandManager.IsFenceComplete(s_RetiredResources.front().first))
+        s_RetiredResources.pop_front();
+
+    for (uint32_t handle = 0; handle < (uint32_t)s_StreamedTextures.size(); ++handle)
+    {
+        if (s_StreamedTextures[handle] == nullptr)
+            continue;
+
+        float pixels = s_StreamedTextures[handle]->TakeCoverageHint();
+        if (pixels > 0.0f)
+            s_Residency.SetCoverage(handle, pixels, s_StreamingFrame);
+    }
+
+    // One context for every texture that changes this frame
+    CommandContext* context = nullptr;
+    vector<ComPtr<ID3D12Resource>> replaced;
+    auto setResidentMips = [&](uint32_t handle, uint32_t firstMip, const uint8_t* mipData, size_t mipDataSize)
+    {
+        if (context == nullptr)
+            context = &CommandContext::Begin(L"Texture Streaming");
+
+        replaced.emplace_back();
+        return s_StreamedTextures[handle]->SetResidentMips(*context, firstMip, mipData, mipDataSize, replaced.back());
+    };
+
+    for (size_t i = 0; i < s_Reads.size(); )
+    {
+        StreamingRead& read = *s_Reads[i];
+        if (!read.Done.load(memory_order_acquire))
+        {
+            ++i;
+            continue;
+        }
+
+        bool succeeded = read.Data->size() == read.Size &&
+            setResidentMips(read.Handle, read.FirstMip, (const uint8_t*)read.Data->data(), read.Data->size());
+        if (!succeeded)
+        {
+            LOG_ERRORF("Couldn't stream mips %u to %u of %s.", read.FirstMip, read.EndMip - 1,
+                Utility::WideStringToUTF8(s_StreamedTextures[read.Handle]->GetFilePath()).c_str());
+        }
+        s_Residency.CompleteLoad(read.Handle, succeeded);
+
+        s_Reads[i] = s_Reads.back();
+        s_Reads.pop_back();
+    }
+
+    s_Residency.Update(s_StreamingFrame, s_Loads, s_Evictions);
+
+    // If a smaller resource cannot be created, the texture keeps its mips and the next update
+    // tries again
+    for (const TextureResidency::Eviction& eviction : s_Evictions)
+    {
+        if (!setResidentMips(eviction.Handle, eviction.FirstMip, nullptr, 0))
+            s_Residency.CancelEviction(eviction);
+    }
+
+    for (const TextureResidency::Load& load : s_Loads)
+    {
+        const ManagedTexture& tex = *s_StreamedTextures[load.Handle];
+        const size_t offset = tex.GetLayout().mipOffset[load.FirstMip];
+
+        shared_ptr<StreamingRead> read = make_shared<StreamingRead>();
+        read->Handle = load.Handle;
+        read->FirstMip = load.FirstMip;
+        read->EndMip = load.EndMip;
+        read->Size = tex.GetLayout().mipOffset[load.EndMip] - offset;
+        read->Done = false;
+        s_Reads.push_back(read);
+
+        wstring filePath = tex.GetFilePath();
+        concurrency::create_task( [read, filePath, offset]
+        {
+            read->Data = Utility::ReadFileRange(filePath, offset, read->Size);
+            read->Done.store(true, memory_order_release);
+        } );
+    }
+
+    if (context != nullptr)
+    {
+        uint64_t fence = context->Finish();
+        for (ComPtr<ID3D12Resource>& resource : replaced)
+        {
+            if (resource != nullptr)
+                s_RetiredResources.emplace_back(fence, std::move(resource));
+        }
+    }
+}
@@ -18,6 +18,7 @@
 #include "Utility.h"
 #include "Texture.h"
 #include "GraphicsCommon.h"
+#include "FileUtility.h"
 
 // A referenced-counted pointer to a Texture.  See methods below.
 class TextureRef;
@@ -40,6 +41,32 @@ namespace TextureManager
     // texture cannot be found, ref->IsValid() will return false.
     TextureRef LoadDDSFromFile( const std::wstring& filePath, eDefaultTexture fallback = kMagenta2D, bool sRGB = false );
     TextureRef LoadDDSFromFile( const std::string& filePath, eDefaultTexture fallback = kMagenta2D, bool sRGB = false );
+
+    // Same as LoadDDSFromFile, but for a file the caller has already read, e.g. on a worker
+    // thread.  The texture is cached under 'filePath'; if it is already loaded, 'fileData' is
+    // ignored.
+    TextureRef LoadDDSFromMemory( const std::wstring& filePath, Utility::ByteArray fileData,
+        eDefaultTexture fallback = kMagenta2D, bool sRGB = false );
+
+    //
+    // Texture streaming, enabled with -texture_streaming_mb <budget>.
+    //
+    // A streamed texture starts with only its small mips.  Finer mips are read in the background
+    // as TextureRef::SetCoverageHint() asks for them, and evicted again to keep within the budget.
+    // Each change replaces the texture's resource and rewrites its SRV, so descriptors copied from
+    // the SRV must be copied again when its version (GpuResource::GetVersionID) changes.
+    //
+    bool IsStreamingEnabled( void );
+
+    // Same as LoadDDSFromFile when streaming is disabled or the file cannot be streamed, e.g.
+    // because it has no mips, is not a plain 2D texture or is only found zipped.
+    TextureRef StreamDDSFromFile( const std::wstring& filePath, eDefaultTexture fallback = kMagenta2D, bool sRGB = false );
+
+    // Call once per frame before rendering.  Adds mips that have been read and starts new reads.
+    void UpdateStreaming( void );
+
+    // Changes whenever a streamed texture does, to skip checking each one
+    uint32_t GetStreamingGeneration( void );
 }
 
 // Forward declaration; private implementation
@@ -47,8 +74,8 @@ class ManagedTexture;
 
 //
 // A handle to a ManagedTexture.  Constructors and destructors modify the reference
-// count.  When the last reference is destroyed, the TextureManager is informed that
-// the texture should be deleted.
+// count, atomically so that references can be copied and dropped on any thread.  When
+// the last reference is destroyed, the TextureManager deletes the texture.
 //
 class TextureRef
 {
@@ -72,6 +99,10 @@ public:
     // null pointers.
     const Texture* Get( void ) const;
 
+    // Hints how many pixels the texture covers on screen this frame; the largest hint counts.
+    // Streamed textures load the mips that this many pixels need.
+    void SetCoverageHint( float pixels ) const;
+
     const Texture* operator->( void ) const;
 
 private:
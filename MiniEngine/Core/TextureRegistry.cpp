@@ -0,0 +1,170 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// This file has no engine dependencies so that it can also be built into the standalone
+// stress test and benchmark (see Tools/TextureRegistryStress).
+
+#include "TextureRegistry.h"
+
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+using namespace std;
+
+TextureRegistry::TextureRegistry(uint32_t numShards)
+    : m_Shards(new Shard[numShards > 0 ? numShards : 1]), m_NumShards(numShards > 0 ? numShards : 1)
+{
+}
+
+TextureRegistry::~TextureRegistry()
+{
+    Clear();
+}
+
+TextureRegistry::Shard& TextureRegistry::GetShard(const wstring& key, uint32_t& index)
+{
+    index = (uint32_t)(hash<wstring>()(key) % m_NumShards);
+    return m_Shards[index];
+}
+
+TextureRegistry::Entry* TextureRegistry::Acquire(const wstring& key, const Factory& factory, bool& created)
+{
+    uint32_t index;
+    Shard& shard = GetShard(key, index);
+
+    lock_guard<mutex> guard(shard.Mutex);
+
+    auto iter = shard.Entries.find(key);
+    if (iter != shard.Entries.end())
+    {
+        // A release of what was the last reference may be waiting for this lock.  It then sees
+        // the new reference and keeps the entry.
+        iter->second->m_RefCount.fetch_add(1, memory_order_relaxed);
+        ++shard.Hits;
+        created = false;
+        return iter->second;
+    }
+
+    Entry* entry = factory();
+    entry->m_Key = key;
+    entry->m_Shard = index;
+    entry->m_RefCount.store(1, memory_order_relaxed);
+    shard.Entries.emplace(key, entry);
+    ++shard.Misses;
+    created = true;
+    return entry;
+}
+
+void TextureRegistry::MarkLoaded(Entry& entry)
+{
+    Shard& shard = m_Shards[entry.m_Shard];
+
+    // Setting the flag under the lock keeps a waiter from missing the notification between
+    // checking the flag and starting to wait
+    {
+        lock_guard<mutex> guard(shard.Mutex);
+        entry.m_Loaded.store(true, memory_order_release);
+    }
+    shard.Loaded.notify_all();
+}
+
+void TextureRegistry::WaitForLoad(const Entry& entry)
+{
+    if (entry.IsLoaded())
+        return;
+
+    Shard& shard = m_Shards[entry.m_Shard];
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    unique_lock<mutex> lock(shard.Mutex);
+    shard.Loaded.wait(lock, [&entry] { return entry.IsLoaded(); });
+
+    ++shard.Waits;
+    shard.WaitTicks += (uint64_t)(chrono::steady_clock::now() - start).count();
+}
+
+void TextureRegistry::AddRef(Entry& entry)
+{
+    assert(entry.m_RefCount.load(memory_order_relaxed) > 0);
+    entry.m_RefCount.fetch_add(1, memory_order_relaxed);
+}
+
+void TextureRegistry::Release(Entry& entry)
+{
+    // Another reference remains, so the entry cannot go away
+    uint32_t count = entry.m_RefCount.load(memory_order_relaxed);
+    while (count > 1)
+    {
+        if (entry.m_RefCount.compare_exchange_weak(count, count - 1, memory_order_release, memory_order_relaxed))
+            return;
+    }
+
+    // Possibly the last reference.  Under the lock no one can find the entry and add one.
+    Shard& shard = m_Shards[entry.m_Shard];
+    {
+        lock_guard<mutex> guard(shard.Mutex);
+        if (entry.m_RefCount.fetch_sub(1, memory_order_acq_rel) != 1)
+            return;
+
+        shard.Entries.erase(entry.m_Key);
+        ++shard.Removals;
+    }
+
+    delete &entry;
+}
+
+void TextureRegistry::Clear(void)
+{
+    vector<Entry*> entries;
+    for (uint32_t i = 0; i < m_NumShards; ++i)
+    {
+        Shard& shard = m_Shards[i];
+        lock_guard<mutex> guard(shard.Mutex);
+        for (auto& iter : shard.Entries)
+            entries.push_back(iter.second);
+        shard.Entries.clear();
+    }
+
+    // Outside the locks, as deleting an entry may release other resources
+    for (Entry* entry : entries)
+        delete entry;
+}
+
+TextureRegistry::Stats TextureRegistry::GetStats(void) const
+{
+    Stats stats;
+    uint64_t waitTicks = 0;
+    for (uint32_t i = 0; i < m_NumShards; ++i)
+    {
+        const Shard& shard = m_Shards[i];
+        lock_guard<mutex> guard(shard.Mutex);
+        stats.NumEntries += (uint32_t)shard.Entries.size();
+        stats.Hits += shard.Hits;
+        stats.Misses += shard.Misses;
+        stats.Waits += shard.Waits;
+        stats.Removals += shard.Removals;
+        waitTicks += shard.WaitTicks;
+    }
+
+    stats.WaitMs = chrono::duration<double, milli>(chrono::steady_clock::duration(waitTicks)).count();
+    return stats;
+}
@@ -0,0 +1,131 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+//
+// A reference counted map from file names to loaded textures, safe to use from many loader
+// threads at once. The keys are spread over shards, each with its own mutex, so requests for
+// different textures rarely contend. A lock is only held to find or insert an entry, never
+// while a texture loads.
+//
+// The first Acquire() of a key creates the entry and the caller loads it, then calls
+// MarkLoaded(). Other threads that acquire the same key in the meantime block in
+// WaitForLoad() on a condition variable until then, rather than spinning.
+//
+// Reference counts are atomic. Only the release of the last reference takes the shard lock,
+// to remove the entry before another thread can find it, and deletes the entry.
+//
+// This is a pure CPU component; TextureManager derives its textures from Entry.
+//
+class TextureRegistry
+{
+public:
+    static const uint32_t kDefaultShards = 16;
+
+    class Entry
+    {
+    public:
+        Entry() : m_Shard(0), m_RefCount(0), m_Loaded(false) {}
+        virtual ~Entry() {}
+
+        const std::wstring& GetKey(void) const { return m_Key; }
+        bool IsLoaded(void) const { return m_Loaded.load(std::memory_order_acquire); }
+        uint32_t GetRefCount(void) const { return m_RefCount.load(std::memory_order_relaxed); }
+
+    private:
+        friend class TextureRegistry;
+
+        std::wstring m_Key;
+        uint32_t m_Shard;
+        std::atomic<uint32_t> m_RefCount;
+        std::atomic<bool> m_Loaded;
+    };
+
+    struct Stats
+    {
+        uint32_t NumEntries = 0;
+        uint64_t Hits = 0;              // Acquires that found the key
+        uint64_t Misses = 0;            // Acquires that created the entry
+        uint64_t Waits = 0;             // WaitForLoad calls that had to block
+        double WaitMs = 0.0;            // Time spent blocked in WaitForLoad
+        uint64_t Removals = 0;          // Entries deleted by their last release
+    };
+
+    // Creates the entry for a key that is not in the cache
+    typedef std::function<Entry*(void)> Factory;
+
+    explicit TextureRegistry(uint32_t numShards = kDefaultShards);
+    ~TextureRegistry();
+
+    TextureRegistry(const TextureRegistry&) = delete;
+    TextureRegistry& operator=(const TextureRegistry&) = delete;
+
+    // Returns the entry for 'key' with a reference added for the caller. If it is not in the
+    // cache, it is created with 'factory' and 'created' is set; the caller must then load it
+    // and call MarkLoaded(). Otherwise call WaitForLoad() before using it.
+    Entry* Acquire(const std::wstring& key, const Factory& factory, bool& created);
+
+    // Wakes the threads waiting for the entry, whether or not its load succeeded
+    void MarkLoaded(Entry& entry);
+
+    // Blocks until MarkLoaded() has been called for the entry
+    void WaitForLoad(const Entry& entry);
+
+    // The caller must already hold a reference
+    void AddRef(Entry& entry);
+
+    // Removes and deletes the entry when this was its last reference
+    void Release(Entry& entry);
+
+    // Deletes every entry. References must not be used or released afterwards.
+    void Clear(void);
+
+    Stats GetStats(void) const;
+
+private:
+    struct Shard
+    {
+        mutable std::mutex Mutex;
+        std::condition_variable Loaded;
+        std::unordered_map<std::wstring, Entry*> Entries;
+        uint64_t Hits = 0;
+        uint64_t Misses = 0;
+        uint64_t Waits = 0;
+        uint64_t WaitTicks = 0;         // std::chrono::steady_clock
+        uint64_t Removals = 0;
+        char Padding[64];               // Keeps neighboring shards' locks off this cache line
+    };
+
+    Shard& GetShard(const std::wstring& key, uint32_t& index);
+
+    std::unique_ptr<Shard[]> m_Shards;
+    uint32_t m_NumShards;
+};
@@ -0,0 +1,327 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// This file has no engine dependencies so that it can also be built into the standalone
+// streaming simulation (see Tools/TextureStreamingSim).
+
+#include "TextureResidency.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+using namespace std;
+
+namespace
+{
+    // A load may only evict mips with less than half its priority. Once evicted, a mip needs
+    // more than twice the priority of the load to come back, so the two cannot alternate.
+    const float kEvictionPriorityRatio = 2.0f;
+}
+
+uint32_t TextureResidency::AddTexture(const TextureDesc& desc)
+{
+    assert(desc.NumMips > 0 && desc.NumMips <= kMaxMips);
+
+    uint32_t handle;
+    if (!m_FreeHandles.empty())
+    {
+        handle = m_FreeHandles.back();
+        m_FreeHandles.pop_back();
+    }
+    else
+    {
+        handle = (uint32_t)m_Textures.size();
+        m_Textures.emplace_back();
+    }
+
+    Texture& tex = m_Textures[handle];
+    tex.NumMips = max(desc.NumMips, 1u);
+    if (tex.NumMips > kMaxMips)
+        tex.NumMips = kMaxMips;
+    tex.TailMip = min(desc.TailMip, tex.NumMips - 1);
+    tex.ResidentMip = tex.TailMip;
+    tex.PendingMip = kNoLoad;
+    tex.WantedMip = tex.TailMip;
+    tex.Coverage = 0.0f;
+    tex.HintFrame = 0;
+    tex.Live = true;
+    tex.Failed = false;
+    tex.PlanMip = tex.ResidentMip;
+    tex.Evicted = false;
+    tex.Loading = false;
+
+    tex.BytesFrom[tex.NumMips] = 0;
+    for (uint32_t mip = tex.NumMips; mip-- > 0; )
+    {
+        tex.BytesFrom[mip] = tex.BytesFrom[mip + 1] + desc.MipBytes[mip];
+        tex.Texels[mip] = (double)max(desc.Width >> mip, 1u) * (double)max(desc.Height >> mip, 1u);
+    }
+
+    ++m_Stats.NumTextures;
+    m_Stats.ResidentBytes += tex.BytesFrom[tex.TailMip];
+    m_Stats.TailBytes += tex.BytesFrom[tex.TailMip];
+
+    return handle;
+}
+
+void TextureResidency::RemoveTexture(uint32_t handle)
+{
+    Texture& tex = m_Textures[handle];
+    assert(tex.Live);
+
+    if (tex.PendingMip != kNoLoad)
+    {
+        m_Stats.PendingBytes -= tex.BytesFrom[tex.PendingMip] - tex.BytesFrom[tex.ResidentMip];
+        --m_Stats.NumPendingLoads;
+    }
+
+    --m_Stats.NumTextures;
+    m_Stats.ResidentBytes -= tex.BytesFrom[tex.ResidentMip];
+    m_Stats.TailBytes -= tex.BytesFrom[tex.TailMip];
+
+    tex.Live = false;
+    m_FreeHandles.push_back(handle);
+}
+
+void TextureResidency::SetCoverage(uint32_t handle, float pixels, uint64_t frame)
+{
+    Texture& tex = m_Textures[handle];
+    if (tex.HintFrame != frame || pixels > tex.Coverage)
+    {
+        tex.Coverage = pixels;
+        tex.HintFrame = frame;
+    }
+}
+
+bool TextureResidency::EvictFor(uint64_t bytes, float maxPriority, bool partial)
+{
+    if (!partial && maxPriority <= m_ShortPriority && bytes > m_ShortBytes)
+        return false;
+
+    if (!m_VictimsSorted)
+    {
+        // Lowest priority first. A texture's finer mips have a lower priority, so they come
+        // before its coarser ones and each eviction takes the finest mip left.
+        sort(m_Victims.begin(), m_Victims.end(), [](const Candidate& a, const Candidate& b)
+        {
+            if (a.Priority != b.Priority)
+                return a.Priority < b.Priority;
+            return a.Mip != b.Mip ? a.Mip < b.Mip : a.Handle < b.Handle;
+        });
+        m_VictimsSorted = true;
+    }
+
+    // Victims before m_NextVictim were evicted or belong to textures that started loading
+    uint64_t freed = 0;
+    size_t next = m_NextVictim;
+    for (; next < m_Victims.size() && freed < bytes && m_Victims[next].Priority < maxPriority; ++next)
+    {
+        const Candidate& victim = m_Victims[next];
+        Texture& tex = m_Textures[victim.Handle];
+        if (tex.Loading || victim.Mip != tex.PlanMip)
+            continue;
+
+        freed += GetMipBytes(tex, victim.Mip);
+        tex.PlanMip = victim.Mip + 1;
+        tex.Evicted = true;
+    }
+
+    if (freed < bytes && !partial)
+    {
+        // Put back what was taken, finest mips last
+        for (size_t v = next; v-- > m_NextVictim; )
+        {
+            const Candidate& victim = m_Victims[v];
+            Texture& tex = m_Textures[victim.Handle];
+            if (!tex.Loading && victim.Mip + 1 == tex.PlanMip)
+            {
+                tex.PlanMip = victim.Mip;
+                tex.Evicted = tex.PlanMip != tex.ResidentMip;
+            }
+        }
+        m_ShortPriority = maxPriority;
+        m_ShortBytes = freed;
+        return false;
+    }
+
+    m_NextVictim = next;
+    m_Committed -= freed;
+    return freed >= bytes;
+}
+
+void TextureResidency::Update(uint64_t frame, vector<Load>& loads, vector<Eviction>& evictions)
+{
+    loads.clear();
+    evictions.clear();
+    m_Loads.clear();
+    m_Victims.clear();
+    m_NextVictim = 0;
+    m_VictimsSorted = false;
+    m_Committed = m_Stats.ResidentBytes + m_Stats.PendingBytes;
+    m_ShortPriority = 0.0f;
+    m_ShortBytes = 0;
+
+    const float bias = exp2f(2.0f * m_Settings.LodBias);
+    const uint64_t hintFrames = max(m_Settings.HintFrames, 1u);
+    const uint64_t budget = m_Settings.BudgetBytes;
+    uint64_t wantedBytes = 0;
+
+    for (uint32_t handle = 0; handle < (uint32_t)m_Textures.size(); ++handle)
+    {
+        Texture& tex = m_Textures[handle];
+        if (!tex.Live)
+            continue;
+
+        const float coverage = frame - tex.HintFrame < hintFrames ? tex.Coverage * bias : 0.0f;
+
+        uint32_t wanted = 0;
+        while (wanted < tex.TailMip && tex.Texels[wanted] > coverage)
+            ++wanted;
+
+        tex.WantedMip = wanted;
+        tex.PlanMip = tex.ResidentMip;
+        tex.Evicted = false;
+        tex.Loading = false;
+        wantedBytes += tex.BytesFrom[wanted];
+
+        // A texture with a load in flight changes when it completes
+        if (tex.PendingMip != kNoLoad)
+            continue;
+
+        for (uint32_t mip = tex.ResidentMip; mip < tex.TailMip; ++mip)
+            m_Victims.push_back({ coverage / (float)tex.Texels[mip], handle, mip });
+
+        if (!tex.Failed)
+        {
+            for (uint32_t mip = wanted; mip < tex.ResidentMip; ++mip)
+                m_Loads.push_back({ coverage / (float)tex.Texels[mip], handle, mip });
+        }
+    }
+    m_Stats.WantedBytes = wantedBytes;
+
+    // A smaller budget evicts whatever it takes
+    if (m_Committed > budget)
+        EvictFor(m_Committed - budget, FLT_MAX, true);
+
+    // Highest priority first, and a texture's coarser mips before its finer ones
+    sort(m_Loads.begin(), m_Loads.end(), [](const Candidate& a, const Candidate& b)
+    {
+        if (a.Priority != b.Priority)
+            return a.Priority > b.Priority;
+        return a.Mip != b.Mip ? a.Mip > b.Mip : a.Handle < b.Handle;
+    });
+
+    uint32_t numLoading = m_Stats.NumPendingLoads;
+    for (const Candidate& load : m_Loads)
+    {
+        Texture& tex = m_Textures[load.Handle];
+
+        // Resident mips stay contiguous, so nothing finer loads once a mip did not fit
+        if (tex.Evicted || load.Mip + 1 != tex.PlanMip)
+            continue;
+
+        if (!tex.Loading && numLoading >= m_Settings.MaxPendingLoads)
+            continue;
+
+        const uint64_t bytes = GetMipBytes(tex, load.Mip);
+        if (m_Committed + bytes > budget &&
+            !EvictFor(m_Committed + bytes - budget, load.Priority / kEvictionPriorityRatio, false))
+        {
+            continue;
+        }
+
+        tex.PlanMip = load.Mip;
+        m_Committed += bytes;
+        if (!tex.Loading)
+        {
+            tex.Loading = true;
+            ++numLoading;
+        }
+    }
+
+    for (uint32_t handle = 0; handle < (uint32_t)m_Textures.size(); ++handle)
+    {
+        Texture& tex = m_Textures[handle];
+        if (!tex.Live)
+            continue;
+
+        if (tex.Evicted)
+        {
+            const uint64_t bytes = tex.BytesFrom[tex.ResidentMip] - tex.BytesFrom[tex.PlanMip];
+            m_Stats.ResidentBytes -= bytes;
+            m_Stats.EvictedBytes += bytes;
+            m_Stats.Evictions += tex.PlanMip - tex.ResidentMip;
+            evictions.push_back({ handle, tex.PlanMip, tex.ResidentMip });
+            tex.ResidentMip = tex.PlanMip;
+        }
+        else if (tex.Loading)
+        {
+            m_Stats.PendingBytes += tex.BytesFrom[tex.PlanMip] - tex.BytesFrom[tex.ResidentMip];
+            ++m_Stats.NumPendingLoads;
+            ++m_Stats.Loads;
+            tex.PendingMip = tex.PlanMip;
+            loads.push_back({ handle, tex.PlanMip, tex.ResidentMip });
+        }
+    }
+}
+
+void TextureResidency::CompleteLoad(uint32_t handle, bool succeeded)
+{
+    Texture& tex = m_Textures[handle];
+    assert(tex.Live && tex.PendingMip != kNoLoad);
+
+    const uint64_t bytes = tex.BytesFrom[tex.PendingMip] - tex.BytesFrom[tex.ResidentMip];
+    m_Stats.PendingBytes -= bytes;
+    --m_Stats.NumPendingLoads;
+
+    if (succeeded)
+    {
+        tex.ResidentMip = tex.PendingMip;
+        m_Stats.ResidentBytes += bytes;
+        m_Stats.LoadedBytes += bytes;
+    }
+    else
+    {
+        tex.Failed = true;
+        ++m_Stats.FailedLoads;
+    }
+
+    tex.PendingMip = kNoLoad;
+}
+
+void TextureResidency::CancelEviction(const Eviction& eviction)
+{
+    Texture& tex = m_Textures[eviction.Handle];
+    assert(tex.Live && tex.PendingMip == kNoLoad && tex.ResidentMip == eviction.FirstMip);
+
+    const uint64_t bytes = tex.BytesFrom[eviction.EvictedMip] - tex.BytesFrom[eviction.FirstMip];
+    m_Stats.ResidentBytes += bytes;
+    m_Stats.EvictedBytes -= bytes;
+    m_Stats.Evictions -= eviction.FirstMip - eviction.EvictedMip;
+    tex.ResidentMip = eviction.EvictedMip;
+}
+
+TextureResidency::Stats TextureResidency::GetStats() const
+{
+    return m_Stats;
+}
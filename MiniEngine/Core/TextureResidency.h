@@ -0,0 +1,188 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//
+// Decides which mips of streamed textures should be resident under a memory budget. Every
+// texture keeps its mip tail, the small mips from TailMip on, resident at all times. Finer
+// mips are loaded and evicted as a contiguous range, so the resident mips of a texture are
+// always [ResidentMip, NumMips).
+//
+// Once per frame the renderer passes a screen coverage hint, in pixels, for the textures it
+// draws. A mip is wanted when it has no more texels than the texture covers pixels, so a
+// 1024x1024 texture covering a quarter of a 1080p screen wants mip 1. The priority of a mip
+// is its coverage per texel: coarse mips of large textures up close come first. Hints lapse
+// after HintFrames, so textures that are no longer drawn become the first to be evicted.
+//
+// Update() issues loads in priority order while they fit the budget, counting the bytes of
+// loads still in flight. When the budget is full a load may evict the finest resident mips
+// of other textures, but only mips of a much lower priority so that two textures cannot
+// take turns evicting each other. If the budget shrinks, mips are evicted in ascending
+// priority until it fits again.
+//
+// This is a pure CPU component; the caller reads files and creates GPU resources for the
+// loads and evictions it returns. It is not thread safe.
+//
+class TextureResidency
+{
+public:
+    static const uint32_t kMaxMips = 16;
+    static const uint32_t kInvalidHandle = 0xFFFFFFFF;
+
+    struct Settings
+    {
+        uint64_t BudgetBytes = 256ull << 20;    // Resident plus in flight
+        uint32_t MaxPendingLoads = 8;           // Textures with a load in flight
+        uint32_t HintFrames = 60;               // Frames a coverage hint stays valid
+        float LodBias = 0.0f;                   // Positive values want sharper mips
+    };
+
+    struct TextureDesc
+    {
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+        uint32_t NumMips = 0;
+        uint32_t TailMip = 0;                   // This and coarser mips are always resident
+        uint64_t MipBytes[kMaxMips] = {};
+    };
+
+    // Read mips [FirstMip, EndMip) and add them to the texture, then call CompleteLoad()
+    struct Load
+    {
+        uint32_t Handle;
+        uint32_t FirstMip;
+        uint32_t EndMip;
+    };
+
+    // Drop the mips finer than FirstMip, which are [EvictedMip, FirstMip)
+    struct Eviction
+    {
+        uint32_t Handle;
+        uint32_t FirstMip;
+        uint32_t EvictedMip;
+    };
+
+    struct Stats
+    {
+        uint32_t NumTextures = 0;
+        uint32_t NumPendingLoads = 0;
+        uint64_t ResidentBytes = 0;
+        uint64_t PendingBytes = 0;
+        uint64_t TailBytes = 0;                 // Part of ResidentBytes that cannot be evicted
+        uint64_t WantedBytes = 0;               // Resident bytes with exactly the wanted mips, as of Update()
+        uint64_t LoadedBytes = 0;               // Totals since creation
+        uint64_t EvictedBytes = 0;
+        uint32_t Loads = 0;
+        uint32_t Evictions = 0;                 // Mips, not textures
+        uint32_t FailedLoads = 0;
+    };
+
+    TextureResidency() {}
+    explicit TextureResidency(const Settings& settings) : m_Settings(settings) {}
+
+    // Takes effect on the next Update(). A smaller budget evicts then.
+    void SetSettings(const Settings& settings) { m_Settings = settings; }
+    const Settings& GetSettings() const { return m_Settings; }
+
+    // Starts with the mip tail resident. Returns a handle for the other calls.
+    uint32_t AddTexture(const TextureDesc& desc);
+
+    // Forgets the texture and its bytes, including a load in flight. Do not call CompleteLoad()
+    // for that load, as the handle may be reused.
+    void RemoveTexture(uint32_t handle);
+
+    // Sets the number of pixels the texture covers, keeping the largest hint of a frame
+    void SetCoverage(uint32_t handle, float pixels, uint64_t frame);
+
+    // Replaces 'loads' and 'evictions' with the changes to make this frame. Evictions take
+    // effect immediately; loads are pending until CompleteLoad().
+    void Update(uint64_t frame, std::vector<Load>& loads, std::vector<Eviction>& evictions);
+
+    // Finishes the pending load of a texture. A texture whose load failed is not loaded again.
+    void CompleteLoad(uint32_t handle, bool succeeded);
+
+    // Puts back the mips of an eviction from the last Update() that the caller could not make.
+    // Loads planned for the bytes it would have freed may exceed the budget until the next
+    // Update() evicts again.
+    void CancelEviction(const Eviction& eviction);
+
+    uint32_t GetResidentMip(uint32_t handle) const { return m_Textures[handle].ResidentMip; }
+    uint32_t GetWantedMip(uint32_t handle) const { return m_Textures[handle].WantedMip; }
+    bool IsLoadPending(uint32_t handle) const { return m_Textures[handle].PendingMip != kNoLoad; }
+
+    Stats GetStats() const;
+
+private:
+    static const uint32_t kNoLoad = 0xFFFFFFFF;
+
+    struct Texture
+    {
+        uint32_t NumMips;
+        uint32_t TailMip;
+        uint32_t ResidentMip;
+        uint32_t PendingMip;                    // kNoLoad, or the first mip of the load in flight
+        uint32_t WantedMip;
+        float Coverage;
+        uint64_t HintFrame;
+        bool Live;
+        bool Failed;
+        uint64_t BytesFrom[kMaxMips + 1];       // Bytes of mips [m, NumMips)
+        double Texels[kMaxMips];
+
+        // Scratch of Update()
+        uint32_t PlanMip;
+        bool Evicted;
+        bool Loading;
+    };
+
+    // A mip that could be loaded or evicted
+    struct Candidate
+    {
+        float Priority;
+        uint32_t Handle;
+        uint32_t Mip;
+    };
+
+    uint64_t GetMipBytes(const Texture& tex, uint32_t mip) const { return tex.BytesFrom[mip] - tex.BytesFrom[mip + 1]; }
+
+    // Evicts victims below 'maxPriority', lowest first, until 'bytes' are freed. Unless
+    // 'partial' is set nothing is evicted when that is not enough. Returns whether it was.
+    bool EvictFor(uint64_t bytes, float maxPriority, bool partial);
+
+    Settings m_Settings;
+    std::vector<Texture> m_Textures;
+    std::vector<uint32_t> m_FreeHandles;
+    Stats m_Stats;
+
+    // Scratch of Update(), kept to avoid allocations
+    std::vector<Candidate> m_Loads;
+    std::vector<Candidate> m_Victims;
+    size_t m_NextVictim = 0;
+    bool m_VictimsSorted = false;
+    uint64_t m_Committed = 0;               // Resident plus pending bytes as planned so far
+    float m_ShortPriority = 0.0f;           // The last EvictFor() that failed found only
+    uint64_t m_ShortBytes = 0;              // this much below this priority
+};
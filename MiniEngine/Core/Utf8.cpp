@@ -0,0 +1,74 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// This file has no engine dependencies so that it can also be built into the standalone
+// checks of the code that uses it (see MiniEngine/Tools).
+
+#include "Utf8.h"
+
+uint32_t Utility::NextCodePoint(const wchar_t*& text)
+{
+    uint32_t c = (uint32_t)*text++;
+
+    // A lone surrogate is passed through and encodes as three bytes, as WTF-8 does
+    if (sizeof(wchar_t) == 2 && c >= 0xD800 && c < 0xDC00 && (uint32_t)*text >= 0xDC00 && (uint32_t)*text < 0xE000)
+        c = 0x10000 + ((c - 0xD800) << 10) + ((uint32_t)*text++ - 0xDC00);
+
+    return c;
+}
+
+void Utility::AppendUTF8(std::string& out, uint32_t c)
+{
+    if (c < 0x80)
+    {
+        out += (char)c;
+    }
+    else if (c < 0x800)
+    {
+        out += (char)(0xC0 | (c >> 6));
+        out += (char)(0x80 | (c & 0x3F));
+    }
+    else if (c < 0x10000)
+    {
+        out += (char)(0xE0 | (c >> 12));
+        out += (char)(0x80 | ((c >> 6) & 0x3F));
+        out += (char)(0x80 | (c & 0x3F));
+    }
+    else
+    {
+        out += (char)(0xF0 | ((c >> 18) & 0x07));
+        out += (char)(0x80 | ((c >> 12) & 0x3F));
+        out += (char)(0x80 | ((c >> 6) & 0x3F));
+        out += (char)(0x80 | (c & 0x3F));
+    }
+}
+
+std::string Utility::WideToUTF8(const std::wstring& wstr)
+{
+    std::string utf8;
+    utf8.reserve(wstr.size());
+
+    // The terminator after the last character ends a trailing lone surrogate
+    const wchar_t* end = wstr.c_str() + wstr.size();
+    for (const wchar_t* text = wstr.c_str(); text < end; )
+        AppendUTF8(utf8, NextCodePoint(text));
+    return utf8;
+}
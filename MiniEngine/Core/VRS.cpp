@@ -31,6 +31,7 @@
 #include "Utility.h"
 #include "DepthOfField.h"
 #include "GpuResource.h"
+#include "ShadingRateHistogram.h"
 
 #include "CompiledShaders/VRSScreenSpace_RGB_CS.h"
 #include "CompiledShaders/VRSScreenSpace_RGB2_CS.h"
@@ -47,8 +48,25 @@ namespace VRS
 {
     D3D12_QUERY_DATA_PIPELINE_STATISTICS PipelineStatistics;
     ShadingRatePercents Percents;
-    ReadbackBuffer VRSReadbackBuffer;
     BoolVar CalculatePercents("VRS/VRS Debug/Calculate %s", true);
+    NumVar PercentsWindow("VRS/VRS Debug/Frames Averaged", 16, 1, ShadingRateHistogram::RollingAverage::kMaxWindow, 1);
+
+    // Shading rate image copies are read back a few frames later instead of waiting on the GPU.
+    // A copy is skipped while its slot is still in flight.
+    const uint32_t kNumReadbacks = 4;
+
+    struct ShadingRateReadback
+    {
+        ReadbackBuffer Buffer;
+        uint64_t FenceValue = 0;
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+        uint32_t RowPitch = 0;
+        bool Pending = false;
+    };
+    ShadingRateReadback Readbacks[kNumReadbacks];
+    uint32_t NextReadback = 0;
+    ShadingRateHistogram::RollingAverage RollingPercents;
     BoolVar UseHighResVelocityBuffer("VRS/Use High Res Velocity Buffer", true);
 
     const char* VRSLabels[] = { "1X1", "1X2", "2X1", "2X2", "2X4", "4X2", "4X4" };
@@ -220,7 +238,6 @@ void VRS::Initialize()
 #undef CreatePSO
 
     g_VRSTier2Buffer.SetClearColor(Color(D3D12_SHADING_RATE_1X1));
-    VRSReadbackBuffer.Create(L"VRS Readback", g_VRSTier2Buffer.GetWidth() * g_VRSTier2Buffer.GetHeight(), sizeof(uint8_t));
 }
 
 void VRS::CheckHardwareSupport()
@@ -366,7 +383,11 @@ D3D12_SHADING_RATE VRS::GetCurrentTier1ShadingRate(int shadingRate)
 }
 
 void VRS::Shutdown(void) {
-    VRSReadbackBuffer.Destroy();
+    for (ShadingRateReadback& readback : Readbacks)
+    {
+        readback.Buffer.Destroy();
+        readback.Pending = false;
+    }
 }
 
 bool VRS::IsVRSSupported() {
@@ -489,69 +510,69 @@ void VRS::Render(ComputeContext& Context, bool upscaledOverlay)
 
 void VRS::CalculateShadingRatePercentages(CommandContext& Context)
 {
-    uint8_t* vrsreadbackptr = nullptr;
-    uint32_t vrsRowPitchInBytes = 0;
-
-    int vrsHeight = g_VRSTier2Buffer.GetHeight();
-    int vrsWidth = g_VRSTier2Buffer.GetWidth();
+    using namespace ShadingRateHistogram;
 
-    vrsRowPitchInBytes = Context.ReadbackTexture(VRSReadbackBuffer, g_VRSTier2Buffer);
-    Context.TransitionResource(g_VRSTier2Buffer, D3D12_RESOURCE_STATE_SHADING_RATE_SOURCE, true);
-    Context.Finish(true);
-    
-    Percents.num1x1 = 0;
-    Percents.num1x2 = 0;
-    Percents.num2x1 = 0;
-    Percents.num2x2 = 0;
-    Percents.num2x4 = 0;
-    Percents.num4x2 = 0;
-    Percents.num4x4 = 0;
+    static_assert(kRateValues[k1x1] == D3D12_SHADING_RATE_1X1 && kRateValues[k1x2] == D3D12_SHADING_RATE_1X2 &&
+        kRateValues[k2x1] == D3D12_SHADING_RATE_2X1 && kRateValues[k2x2] == D3D12_SHADING_RATE_2X2 &&
+        kRateValues[k2x4] == D3D12_SHADING_RATE_2X4 && kRateValues[k4x2] == D3D12_SHADING_RATE_4X2 &&
+        kRateValues[k4x4] == D3D12_SHADING_RATE_4X4, "ShadingRateHistogram encodings don't match D3D12_SHADING_RATE");
 
     if (!(bool)VRS::Enable)
     {
+        Context.Finish();
+
+        for (ShadingRateReadback& readback : Readbacks)
+            readback.Pending = false;
+        RollingPercents.Reset();
+
+        Percents = ShadingRatePercents();
         Percents.num1x1 = 100;
         return;
     }
 
-    vrsreadbackptr = (uint8_t*)VRSReadbackBuffer.Map();
+    RollingPercents.SetWindow((uint32_t)(float)PercentsWindow);
 
-    int totalPixels = vrsHeight * vrsWidth;
-    for (int yy = 0; yy < vrsHeight; yy++)
+    // Copy this frame's shading rate image unless the slot is still waiting for the GPU
+    ShadingRateReadback& target = Readbacks[NextReadback];
+    if (!target.Pending)
     {
-        for (int xx = 0; xx < vrsWidth; xx++)
-        {
-            uint8_t currentPixel = vrsreadbackptr[yy * vrsRowPitchInBytes + xx];
-            switch (currentPixel)
-            {
-            case D3D12_SHADING_RATE_1X1:
-                Percents.num1x1++;
-                break;
-            case D3D12_SHADING_RATE_1X2:
-                Percents.num1x2++;
-                break;
-            case D3D12_SHADING_RATE_2X1:
-                Percents.num2x1++;
-                break;
-            case D3D12_SHADING_RATE_2X2:
-                Percents.num2x2++;
-                break;
-            case D3D12_SHADING_RATE_2X4:
-                Percents.num2x4++;
-                break;
-            case D3D12_SHADING_RATE_4X2:
-                Percents.num4x2++;
-                break;
-            case D3D12_SHADING_RATE_4X4:
-                Percents.num4x4++;
-            }
-        }
+        target.RowPitch = Context.ReadbackTexture(target.Buffer, g_VRSTier2Buffer);
+        target.Width = g_VRSTier2Buffer.GetWidth();
+        target.Height = g_VRSTier2Buffer.GetHeight();
+        Context.TransitionResource(g_VRSTier2Buffer, D3D12_RESOURCE_STATE_SHADING_RATE_SOURCE, true);
+        target.FenceValue = Context.Finish();
+        target.Pending = true;
+        NextReadback = (NextReadback + 1) % kNumReadbacks;
+    }
+    else
+    {
+        Context.Finish();
+    }
+
+    // Consume completed copies, oldest first
+    for (uint32_t i = 0; i < kNumReadbacks; ++i)
+    {
+        ShadingRateReadback& readback = Readbacks[(NextReadback + i) % kNumReadbacks];
+        if (!readback.Pending || !g_CommandManager.IsFenceComplete(readback.FenceValue))
+            continue;
+
+        Histogram histogram;
+        const uint8_t* tiles = (const uint8_t*)readback.Buffer.Map();
+        Build(tiles, readback.Width, readback.Height, readback.RowPitch, histogram);
+        readback.Buffer.Unmap();
+        readback.Pending = false;
+
+        RollingPercents.Add(histogram);
     }
-    Percents.num1x1 = ((float)Percents.num1x1 / (float)totalPixels) * 100.0f;
-    Percents.num1x2 = ((float)Percents.num1x2 / (float)totalPixels) * 100.0f;
-    Percents.num2x1 = ((float)Percents.num2x1 / (float)totalPixels) * 100.0f;
-    Percents.num2x2 = ((float)Percents.num2x2 / (float)totalPixels) * 100.0f;
-    Percents.num2x4 = ((float)Percents.num2x4 / (float)totalPixels) * 100.0f;
-    Percents.num4x2 = ((float)Percents.num4x2 / (float)totalPixels) * 100.0f;
-    Percents.num4x4 = ((float)Percents.num4x4 / (float)totalPixels) * 100.0f;
-    VRSReadbackBuffer.Unmap();
+
+    if (RollingPercents.GetSampleCount() == 0)
+        return;
+
+    Percents.num1x1 = RollingPercents.GetPercent(k1x1);
+    Percents.num1x2 = RollingPercents.GetPercent(k1x2);
+    Percents.num2x1 = RollingPercents.GetPercent(k2x1);
+    Percents.num2x2 = RollingPercents.GetPercent(k2x2);
+    Percents.num2x4 = RollingPercents.GetPercent(k2x4);
+    Percents.num4x2 = RollingPercents.GetPercent(k4x2);
+    Percents.num4x4 = RollingPercents.GetPercent(k4x4);
 }
\ No newline at end of file
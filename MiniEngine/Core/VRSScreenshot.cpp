@@ -109,6 +109,11 @@ void Screenshot::WriteToFile(const char* filename, int width, int height, int co
     }
 }
 
+void Screenshot::WriteRawToPNG(std::string filename, int width, int height, int comp, const char* Memory)
+{
+    WriteToFile(filename.c_str(), width, height, comp, Memory, width * comp);
+}
+
 void Screenshot::Shutdown()
 {
     readback.Unmap();
@@ -118,7 +123,8 @@ void Screenshot::Shutdown()
     tempBuffer.Destroy();
 }
 
-void Screenshot::TakeScreenshotAndExportVRSBuffer(const char* filename, ColorBuffer& source, const char* vrsfilename, ColorBuffer& vrsBuffer, CommandContext& context, bool exportBuffer)
+void Screenshot::TakeScreenshotAndExportVRSBuffer(const char* filename, ColorBuffer& source, const char* vrsfilename, ColorBuffer& vrsBuffer, CommandContext& context, bool exportBuffer,
+    std::vector<uint8_t>* capturedPixels)
 {
     Initialize(source, vrsBuffer);
     ConvertData(source, context);
@@ -128,7 +134,17 @@ void Screenshot::TakeScreenshotAndExportVRSBuffer(const char* filename, ColorBuf
     context.Finish(true);
     uint8_t* vrsreadbackptr = (uint8_t*)vrsreadback.Map();
 
-    WriteToFile(filename, sourceWidth, sourceHeight, 4, readback.Map(), sourceRowPitchInBytes);
+    const uint8_t* readbackptr = (const uint8_t*)readback.Map();
+
+    WriteToFile(filename, sourceWidth, sourceHeight, 4, readbackptr, sourceRowPitchInBytes);
+
+    if (capturedPixels != nullptr)
+    {
+        const size_t rowSize = (size_t)sourceWidth * 4;
+        capturedPixels->resize(rowSize * sourceHeight);
+        for (int y = 0; y < sourceHeight; ++y)
+            memcpy(capturedPixels->data() + y * rowSize, readbackptr + (size_t)y * sourceRowPitchInBytes, rowSize);
+    }
 
     if (exportBuffer)
     {
@@ -26,5 +26,7 @@ class CommandContext;
 namespace Screenshot
 {
     void WriteRawToPNG(std::string filename, int width, int height, int comp, const char* Memory);
-    void TakeScreenshotAndExportVRSBuffer(const char* filename, ColorBuffer& source, const char* vrsfilename, ColorBuffer& vrsBuffer, CommandContext& context, bool exportBuffer);
+    // When 'capturedPixels' is provided it also receives the tightly packed RGBA8 screenshot
+    void TakeScreenshotAndExportVRSBuffer(const char* filename, ColorBuffer& source, const char* vrsfilename, ColorBuffer& vrsBuffer, CommandContext& context, bool exportBuffer,
+        std::vector<uint8_t>* capturedPixels = nullptr);
 }
\ No newline at end of file
@@ -0,0 +1,170 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+// This file has no engine dependencies so that it can also be built into the
+// standalone culling benchmark (see Tools/CullBenchmark).
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    struct Job
+    {
+        const function<void(uint32_t)>* Task;
+        uint32_t NumTasks;
+        atomic<uint32_t> Next;
+        uint32_t NumHelpers;        // Pool threads inside RunTasks(), guarded by the pool mutex
+    };
+
+    class Pool
+    {
+    public:
+        Pool() : m_Quit(false)
+        {
+            const uint32_t numWorkers = max(thread::hardware_concurrency(), 1u) - 1;
+            m_Workers.reserve(numWorkers);
+            for (uint32_t i = 0; i < numWorkers; ++i)
+                m_Workers.emplace_back(&Pool::WorkerLoop, this);
+        }
+
+        ~Pool()
+        {
+            {
+                lock_guard<mutex> lock(m_Mutex);
+                m_Quit = true;
+            }
+            m_WorkAvailable.notify_all();
+            for (thread& worker : m_Workers)
+                worker.join();
+        }
+
+        uint32_t GetNumThreads() const
+        {
+            return (uint32_t)m_Workers.size() + 1;
+        }
+
+        void Run(uint32_t numTasks, const function<void(uint32_t)>& task)
+        {
+            if (numTasks <= 1 || m_Workers.empty())
+            {
+                for (uint32_t i = 0; i < numTasks; ++i)
+                    task(i);
+                return;
+            }
+
+            Job job;
+            job.Task = &task;
+            job.NumTasks = numTasks;
+            job.Next.store(0, memory_order_relaxed);
+            job.NumHelpers = 0;
+
+            {
+                lock_guard<mutex> lock(m_Mutex);
+                m_Jobs.push_back(&job);
+            }
+            if (numTasks - 1 >= m_Workers.size())
+                m_WorkAvailable.notify_all();
+            else
+            {
+                for (uint32_t i = 1; i < numTasks; ++i)
+                    m_WorkAvailable.notify_one();
+            }
+
+            RunTasks(job);
+
+            // Every task has been taken. Once no pool thread can pick up the job any more and
+            // those that did have left it, every task is done.
+            unique_lock<mutex> lock(m_Mutex);
+            RemoveJob(job);
+            m_JobDone.wait(lock, [&]() { return job.NumHelpers == 0; });
+        }
+
+    private:
+        static void RunTasks(Job& job)
+        {
+            for (uint32_t i = job.Next.fetch_add(1, memory_order_relaxed); i < job.NumTasks;
+                i = job.Next.fetch_add(1, memory_order_relaxed))
+            {
+                (*job.Task)(i);
+            }
+        }
+
+        void RemoveJob(Job& job)
+        {
+            auto it = find(m_Jobs.begin(), m_Jobs.end(), &job);
+            if (it != m_Jobs.end())
+                m_Jobs.erase(it);
+        }
+
+        void WorkerLoop()
+        {
+            unique_lock<mutex> lock(m_Mutex);
+            for (;;)
+            {
+                m_WorkAvailable.wait(lock, [&]() { return m_Quit || !m_Jobs.empty(); });
+                if (m_Quit)
+                    return;
+
+                Job& job = *m_Jobs.front();
+                ++job.NumHelpers;
+                lock.unlock();
+
+                RunTasks(job);
+
+                lock.lock();
+                RemoveJob(job);
+                if (--job.NumHelpers == 0)
+                    m_JobDone.notify_all();
+            }
+        }
+
+        mutex m_Mutex;
+        condition_variable m_WorkAvailable;
+        condition_variable m_JobDone;
+        vector<Job*> m_Jobs;
+        vector<thread> m_Workers;
+        bool m_Quit;
+    };
+
+    Pool& GetPool()
+    {
+        static Pool s_Pool;
+        return s_Pool;
+    }
+}
+
+uint32_t WorkerPool::GetNumThreads()
+{
+    return GetPool().GetNumThreads();
+}
+
+void WorkerPool::Run(uint32_t numTasks, const function<void(uint32_t)>& task)
+{
+    GetPool().Run(numTasks, task);
+}
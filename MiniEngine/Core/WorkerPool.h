@@ -0,0 +1,47 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+//
+// A fixed set of threads, started on first use and kept for the life of the process, for work
+// that is split every frame. Starting and joining threads each time costs more than most of
+// that work.
+//
+// Run() hands out task indices to the pool's threads and to the calling thread, which keeps
+// taking tasks until none are left and then waits for the ones still running. The caller
+// therefore never waits for a free thread, so Run() may be called from several threads at once
+// or from inside a task. Tasks must not wait on each other: they are not guaranteed to run at
+// the same time.
+//
+// This has no engine dependencies so that it can also be built into the standalone culling
+// benchmark (see Tools/CullBenchmark).
+//
+namespace WorkerPool
+{
+    // Threads that Run() can keep busy at once, counting the calling thread
+    uint32_t GetNumThreads();
+
+    // Calls task(i) for every i in [0, numTasks) and returns when all of them are done
+    void Run(uint32_t numTasks, const std::function<void(uint32_t)>& task);
+}
@@ -22,6 +22,9 @@
 // using the selected method.  Note that a curve does not have to be defined for
 // the entire animation.  Some property might only be animated for a portion of time.
 //
+// Cubic spline key frames are stored as three elements each: the in-tangent, the value and
+// the out-tangent.  Morph target weights are stored as floats, one per target.
+//
 struct AnimationCurve
 {
     enum { kTranslation, kRotation, kScale, kWeights }; // targetPath
@@ -31,9 +34,10 @@ struct AnimationCurve
     uint32_t targetNode : 28;           // Which node is being animated
     uint32_t targetPath : 2;            // What aspect of the transform is animated
     uint32_t interpolation : 2;         // The method of interpolation
-    uint32_t keyFrameOffset : 26;       // Byte offset to first key frame
+    uint32_t keyFrameOffset;            // Byte offset to first key frame
     uint32_t keyFrameFormat : 3;        // Data format for the key frames
-    uint32_t keyFrameStride : 3;        // Number of 4-byte words for one key frame
+    uint32_t keyFrameStride : 13;       // Number of 4-byte words for one key frame
+    uint32_t firstWeight : 16;          // Morph weights: index of the first weight in ModelInstance
     float numSegments;                  // Number of evenly-spaced gaps between keyframes
     float startTime;                    // Time stamp of the first key frame
     float rangeScale;                   // numSegments / (endTime - startTime)
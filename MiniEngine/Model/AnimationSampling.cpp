@@ -0,0 +1,421 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// This file has no engine dependencies so that it can also be built into the
+// standalone animation benchmark (see Tools/AnimationBenchmark).
+
+#include "AnimationSampling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define ENABLE_SSE_SAMPLING 1
+#include <xmmintrin.h>
+#else
+#define ENABLE_SSE_SAMPLING 0
+#endif
+
+using namespace std;
+using namespace AnimationSampling;
+
+namespace
+{
+    inline float ToFloat(int8_t x) { return max(x / 127.0f, -1.0f); }
+    inline float ToFloat(uint8_t x) { return x / 255.0f; }
+    inline float ToFloat(int16_t x) { return max(x / 32767.0f, -1.0f); }
+    inline float ToFloat(uint16_t x) { return x / 65535.0f; }
+
+    template <typename T>
+    inline void Decode(const uint8_t* src, uint32_t count, float* dest)
+    {
+        T values[4];
+        memcpy(values, src, count * sizeof(T));
+        for (uint32_t i = 0; i < count; ++i)
+            dest[i] = ToFloat(values[i]);
+    }
+
+    // Decodes up to four components of a key frame starting at 'first', zero filling the rest
+    inline void LoadComponents(const uint8_t* key, uint32_t format, uint32_t first, uint32_t count, float dest[4])
+    {
+        dest[0] = dest[1] = dest[2] = dest[3] = 0.0f;
+
+        switch (format)
+        {
+        case AnimationCurve::kSNorm8: Decode<int8_t>(key + first, count, dest); break;
+        case AnimationCurve::kUNorm8: Decode<uint8_t>(key + first, count, dest); break;
+        case AnimationCurve::kSNorm16: Decode<int16_t>(key + first * 2, count, dest); break;
+        case AnimationCurve::kUNorm16: Decode<uint16_t>(key + first * 2, count, dest); break;
+        default: memcpy(dest, key + first * 4, count * sizeof(float)); break;
+        }
+    }
+
+    // Catmull-Rom splines are not part of glTF and were never exported, so they blend linearly
+    inline uint32_t GetInterpolation(const AnimationCurve& curve)
+    {
+        return curve.interpolation == AnimationCurve::kCatmullRomSpline ? (uint32_t)AnimationCurve::kLinear : curve.interpolation;
+    }
+
+    inline bool IsLinearRotation(const AnimationCurve& curve)
+    {
+        return curve.targetPath == AnimationCurve::kRotation && GetInterpolation(curve) == AnimationCurve::kLinear;
+    }
+
+    // What every curve of a group shares at one point in time. A value is the weighted sum of
+    // NumKeys key frame elements: the two keys of the segment, or for cubic splines the first
+    // value, its out-tangent, the second value and its in-tangent.
+    struct Blend
+    {
+        uint32_t Interpolation;
+        uint32_t Segment;   // Key frame at the start of the segment
+        uint32_t Next;      // 1, or 0 when there is only one key frame
+        uint32_t NumKeys;
+        float T;
+        float Weights[4];
+    };
+
+    Blend ComputeBlend(uint32_t interpolation, float startTime, float rangeScale, float numSegments, float time)
+    {
+        Blend blend;
+        blend.Interpolation = interpolation;
+
+        const float progress = min(max((time - startTime) * rangeScale, 0.0f), numSegments);
+        uint32_t segment = (uint32_t)progress;
+
+        // The end of the last segment rather than the start of one past it
+        if (segment > 0 && (float)segment >= numSegments)
+            --segment;
+
+        const float t = progress - (float)segment;
+        blend.Segment = segment;
+        blend.Next = numSegments > 0.0f ? 1 : 0;
+        blend.T = t;
+
+        if (interpolation == AnimationCurve::kCubicSpline)
+        {
+            // Hermite basis. Tangents are per second, so they scale with the segment duration.
+            const float t2 = t * t, t3 = t2 * t;
+            const float duration = rangeScale > 0.0f ? 1.0f / rangeScale : 0.0f;
+            blend.NumKeys = 4;
+            blend.Weights[0] = 2.0f * t3 - 3.0f * t2 + 1.0f;
+            blend.Weights[1] = (t3 - 2.0f * t2 + t) * duration;
+            blend.Weights[2] = 3.0f * t2 - 2.0f * t3;
+            blend.Weights[3] = (t3 - t2) * duration;
+        }
+        else
+        {
+            const float w = interpolation == AnimationCurve::kStep ? (t >= 1.0f ? 1.0f : 0.0f) : t;
+            blend.NumKeys = 2;
+            blend.Weights[0] = 1.0f - w;
+            blend.Weights[1] = w;
+            blend.Weights[2] = blend.Weights[3] = 0.0f;
+        }
+
+        return blend;
+    }
+
+    // The key frame elements blended by 'blend', in the order of Blend::Weights
+    inline void GetKeys(const AnimationCurve& curve, const uint8_t* keyFrameData, const Blend& blend, const uint8_t* keys[4])
+    {
+        const size_t stride = curve.keyFrameStride * 4;
+        const uint8_t* base = keyFrameData + curve.keyFrameOffset;
+
+        if (blend.Interpolation == AnimationCurve::kCubicSpline)
+        {
+            const uint8_t* key0 = base + stride * 3 * blend.Segment;
+            const uint8_t* key1 = base + stride * 3 * (blend.Segment + blend.Next);
+            keys[0] = key0 + stride;
+            keys[1] = key0 + stride * 2;
+            keys[2] = key1 + stride;
+            keys[3] = key1;
+        }
+        else
+        {
+            keys[0] = base + stride * blend.Segment;
+            keys[1] = base + stride * (blend.Segment + blend.Next);
+            keys[2] = keys[3] = nullptr;
+        }
+    }
+
+    inline void NormalizeQuaternion(float* q)
+    {
+        const float lengthSq = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+        const float scale = lengthSq > 0.0f ? 1.0f / sqrtf(lengthSq) : 0.0f;
+        for (uint32_t i = 0; i < 4; ++i)
+            q[i] *= scale;
+    }
+
+    // Same as XMQuaternionSlerp followed by a normalize, like Math::Slerp
+    void SlerpScalar(const float* a, const float* b, float t, float* dest)
+    {
+        float cosOmega = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+        const float sign = cosOmega < 0.0f ? -1.0f : 1.0f;
+        cosOmega *= sign;
+
+        float w0 = 1.0f - t, w1 = t;
+        if (cosOmega < 1.0f - 0.00001f)
+        {
+            const float omega = acosf(cosOmega);
+            const float sinOmega = sinf(omega);
+            w0 = sinf(w0 * omega) / sinOmega;
+            w1 = sinf(w1 * omega) / sinOmega;
+        }
+        w1 *= sign;
+
+        for (uint32_t i = 0; i < 4; ++i)
+            dest[i] = a[i] * w0 + b[i] * w1;
+        NormalizeQuaternion(dest);
+    }
+
+    void SampleCurveScalar(const AnimationCurve& curve, const uint8_t* keyFrameData, const Blend& blend, float* output)
+    {
+        const uint8_t* keys[4];
+        GetKeys(curve, keyFrameData, blend, keys);
+
+        if (IsLinearRotation(curve))
+        {
+            float a[4], b[4];
+            LoadComponents(keys[0], curve.keyFrameFormat, 0, 4, a);
+            LoadComponents(keys[1], curve.keyFrameFormat, 0, 4, b);
+            SlerpScalar(a, b, blend.T, output);
+            return;
+        }
+
+        const uint32_t numComponents = GetNumComponents(curve);
+        for (uint32_t c = 0; c < numComponents; c += 4)
+        {
+            const uint32_t count = min(4u, numComponents - c);
+            float value[4] = {};
+            for (uint32_t k = 0; k < blend.NumKeys; ++k)
+            {
+                float key[4];
+                LoadComponents(keys[k], curve.keyFrameFormat, c, count, key);
+                for (uint32_t i = 0; i < 4; ++i)
+                    value[i] += key[i] * blend.Weights[k];
+            }
+            memcpy(output + c, value, sizeof(value));
+        }
+
+        if (curve.targetPath == AnimationCurve::kRotation)
+            NormalizeQuaternion(output);
+    }
+
+#if ENABLE_SSE_SAMPLING
+
+    inline __m128 LoadKey(const uint8_t* key, uint32_t format, uint32_t first, uint32_t count)
+    {
+        if (format == AnimationCurve::kFloat && count == 4)
+            return _mm_loadu_ps((const float*)key + first);
+
+        float values[4];
+        LoadComponents(key, format, first, count, values);
+        return _mm_loadu_ps(values);
+    }
+
+    inline __m128 Dot4(__m128 x0, __m128 y0, __m128 z0, __m128 w0, __m128 x1, __m128 y1, __m128 z1, __m128 w1)
+    {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x0, x1), _mm_mul_ps(y0, y1)), _mm_add_ps(_mm_mul_ps(z0, z1), _mm_mul_ps(w0, w1)));
+    }
+
+    // Up to four linear rotations of a group at once, one quaternion per lane. Slerp is
+    // approximated by a normalized lerp with a corrected blend factor (A. Kapoulkine,
+    // "Approximating slerp"), which avoids the inverse cosine and sines.
+    void SlerpBatch(const AnimationCurve* curves, const uint32_t* indices, uint32_t count,
+        const uint8_t* keyFrameData, const Blend& blend, const uint32_t* outputs, float* output)
+    {
+        __m128 a[4], b[4];
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            const AnimationCurve& curve = curves[indices[min(i, count - 1)]];
+            const uint8_t* keys[4];
+            GetKeys(curve, keyFrameData, blend, keys);
+            a[i] = LoadKey(keys[0], curve.keyFrameFormat, 0, 4);
+            b[i] = LoadKey(keys[1], curve.keyFrameFormat, 0, 4);
+        }
+        _MM_TRANSPOSE4_PS(a[0], a[1], a[2], a[3]);
+        _MM_TRANSPOSE4_PS(b[0], b[1], b[2], b[3]);
+
+        const float t = blend.T;
+        const __m128 signBit = _mm_set1_ps(-0.0f);
+        const __m128 cosOmega = Dot4(a[0], a[1], a[2], a[3], b[0], b[1], b[2], b[3]);
+        const __m128 d = _mm_andnot_ps(signBit, cosOmega);
+
+        // A * (t - 0.5)^2 + B, with A and B fitted as polynomials of |cos omega|
+        __m128 A = _mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(d, _mm_set1_ps(1.43519f)));
+        A = _mm_add_ps(_mm_set1_ps(-3.2452f), _mm_mul_ps(d, A));
+        A = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(d, A));
+        __m128 B = _mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(d, _mm_set1_ps(0.215638f)));
+        B = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(d, B));
+        const __m128 k = _mm_add_ps(_mm_mul_ps(A, _mm_set1_ps((t - 0.5f) * (t - 0.5f))), B);
+
+        const __m128 wb = _mm_add_ps(_mm_set1_ps(t), _mm_mul_ps(_mm_set1_ps(t * (t - 0.5f) * (t - 1.0f)), k));
+        const __m128 wa = _mm_sub_ps(_mm_set1_ps(1.0f), wb);
+        const __m128 wbSigned = _mm_xor_ps(wb, _mm_and_ps(cosOmega, signBit));
+
+        __m128 q[4];
+        for (uint32_t c = 0; c < 4; ++c)
+            q[c] = _mm_add_ps(_mm_mul_ps(a[c], wa), _mm_mul_ps(b[c], wbSigned));
+
+        const __m128 lengthSq = Dot4(q[0], q[1], q[2], q[3], q[0], q[1], q[2], q[3]);
+        const __m128 scale = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(lengthSq, _mm_set1_ps(1e-30f))));
+        for (uint32_t c = 0; c < 4; ++c)
+            q[c] = _mm_mul_ps(q[c], scale);
+
+        _MM_TRANSPOSE4_PS(q[0], q[1], q[2], q[3]);
+        for (uint32_t i = 0; i < count; ++i)
+            _mm_storeu_ps(output + outputs[indices[i]], q[i]);
+    }
+
+    void SampleCurveSSE(const AnimationCurve& curve, const uint8_t* keyFrameData, const Blend& blend, float* output)
+    {
+        const uint8_t* keys[4];
+        GetKeys(curve, keyFrameData, blend, keys);
+
+        __m128 weights[4];
+        for (uint32_t k = 0; k < 4; ++k)
+            weights[k] = _mm_set1_ps(blend.Weights[k]);
+
+        const uint32_t numComponents = GetNumComponents(curve);
+        __m128 value = _mm_setzero_ps();
+        for (uint32_t c = 0; c < numComponents; c += 4)
+        {
+            const uint32_t count = min(4u, numComponents - c);
+            value = _mm_setzero_ps();
+            for (uint32_t k = 0; k < blend.NumKeys; ++k)
+                value = _mm_add_ps(value, _mm_mul_ps(LoadKey(keys[k], curve.keyFrameFormat, c, count), weights[k]));
+            _mm_storeu_ps(output + c, value);
+        }
+
+        if (curve.targetPath == AnimationCurve::kRotation)
+        {
+            __m128 lengthSq = _mm_mul_ps(value, value);
+            lengthSq = _mm_add_ps(lengthSq, _mm_shuffle_ps(lengthSq, lengthSq, _MM_SHUFFLE(2, 3, 0, 1)));
+            lengthSq = _mm_add_ps(lengthSq, _mm_shuffle_ps(lengthSq, lengthSq, _MM_SHUFFLE(1, 0, 3, 2)));
+            const __m128 scale = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(lengthSq, _mm_set1_ps(1e-30f))));
+            _mm_storeu_ps(output, _mm_mul_ps(value, scale));
+        }
+    }
+
+#endif // ENABLE_SSE_SAMPLING
+}
+
+uint32_t AnimationSampling::GetNumComponents(const AnimationCurve& curve)
+{
+    switch (curve.targetPath)
+    {
+    case AnimationCurve::kRotation: return 4;
+    case AnimationCurve::kWeights: return curve.keyFrameStride;
+    default: return 3;
+    }
+}
+
+void AnimationSampling::BuildPlan(const AnimationCurve* curves, uint32_t numCurves, Plan& plan)
+{
+    plan.Groups.clear();
+    plan.Curves.resize(numCurves);
+    plan.Outputs.resize(numCurves);
+    plan.OutputSize = 0;
+
+    for (uint32_t i = 0; i < numCurves; ++i)
+    {
+        plan.Outputs[i] = plan.OutputSize;
+        plan.OutputSize += (GetNumComponents(curves[i]) + 3) & ~3u;
+    }
+
+    auto sameTiming = [&](const AnimationCurve& a, const AnimationCurve& b)
+    {
+        return GetInterpolation(a) == GetInterpolation(b) && a.startTime == b.startTime &&
+            a.rangeScale == b.rangeScale && a.numSegments == b.numSegments;
+    };
+
+    // Order by timing, then linear rotations first, then by curve index
+    iota(plan.Curves.begin(), plan.Curves.end(), 0u);
+    sort(plan.Curves.begin(), plan.Curves.end(), [&](uint32_t i, uint32_t j)
+    {
+        const AnimationCurve& a = curves[i];
+        const AnimationCurve& b = curves[j];
+        if (GetInterpolation(a) != GetInterpolation(b))
+            return GetInterpolation(a) < GetInterpolation(b);
+        if (a.startTime != b.startTime)
+            return a.startTime < b.startTime;
+        if (a.rangeScale != b.rangeScale)
+            return a.rangeScale < b.rangeScale;
+        if (a.numSegments != b.numSegments)
+            return a.numSegments < b.numSegments;
+        if (IsLinearRotation(a) != IsLinearRotation(b))
+            return IsLinearRotation(a);
+        return i < j;
+    });
+
+    for (uint32_t i = 0; i < numCurves; ++i)
+    {
+        const AnimationCurve& curve = curves[plan.Curves[i]];
+        if (plan.Groups.empty() || !sameTiming(curves[plan.Curves[plan.Groups.back().FirstCurve]], curve))
+        {
+            Group group;
+            group.StartTime = curve.startTime;
+            group.RangeScale = curve.rangeScale;
+            group.NumSegments = curve.numSegments;
+            group.Interpolation = GetInterpolation(curve);
+            group.FirstCurve = i;
+            group.NumCurves = 0;
+            group.NumRotations = 0;
+            plan.Groups.push_back(group);
+        }
+
+        Group& group = plan.Groups.back();
+        ++group.NumCurves;
+        if (IsLinearRotation(curve))
+            ++group.NumRotations;
+    }
+}
+
+void AnimationSampling::Sample(const Plan& plan, const AnimationCurve* curves, const uint8_t* keyFrameData,
+    float time, float* output)
+{
+    for (const Group& group : plan.Groups)
+    {
+        const Blend blend = ComputeBlend(group.Interpolation, group.StartTime, group.RangeScale, group.NumSegments, time);
+        const uint32_t* indices = plan.Curves.data() + group.FirstCurve;
+        uint32_t i = 0;
+
+#if ENABLE_SSE_SAMPLING
+        for (; i < group.NumRotations; i += 4)
+        {
+            SlerpBatch(curves, indices + i, min(4u, group.NumRotations - i), keyFrameData, blend,
+                plan.Outputs.data(), output);
+        }
+        for (i = group.NumRotations; i < group.NumCurves; ++i)
+            SampleCurveSSE(curves[indices[i]], keyFrameData, blend, output + plan.Outputs[indices[i]]);
+#else
+        for (; i < group.NumCurves; ++i)
+            SampleCurveScalar(curves[indices[i]], keyFrameData, blend, output + plan.Outputs[indices[i]]);
+#endif
+    }
+}
+
+void AnimationSampling::SampleCurve(const AnimationCurve& curve, const uint8_t* keyFrameData, float time, float* output)
+{
+    const Blend blend = ComputeBlend(GetInterpolation(curve), curve.startTime, curve.rangeScale, curve.numSegments, time);
+    SampleCurveScalar(curve, keyFrameData, blend, output);
+}
@@ -0,0 +1,81 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include "Animation.h"
+
+#include <cstdint>
+#include <vector>
+
+//
+// Samples the curves of an AnimationSet, used by ModelInstance::UpdateAnimations.
+//
+// Curves exported together usually share their key frame times, e.g. every joint of a
+// skeleton keyed on the same frames. A plan built once per animation groups the curves with
+// identical timing and interpolation, so the key frame segment and the blend weights are found
+// once per group instead of once per curve. Within a group, linear rotations are blended four
+// curves at a time in SSE registers, and other values four components at a time.
+//
+// Linear, step and glTF cubic spline interpolation are supported for translations, rotations,
+// scales and morph target weights. Cubic spline key frames hold an in-tangent, the value and an
+// out-tangent, in that order. Key frames are evenly spaced between the first and last time.
+//
+// This has no engine dependencies so that it can also be built into the standalone benchmark
+// (see Tools/AnimationBenchmark).
+//
+namespace AnimationSampling
+{
+    // Curves of one group share their key frame times and interpolation
+    struct Group
+    {
+        float StartTime;
+        float RangeScale;
+        float NumSegments;
+        uint32_t Interpolation;
+        uint32_t FirstCurve;    // Into Plan::Curves
+        uint32_t NumCurves;
+        uint32_t NumRotations;  // Linear rotations, listed first so they can be batched
+    };
+
+    struct Plan
+    {
+        std::vector<Group> Groups;
+        std::vector<uint32_t> Curves;   // Curve indices relative to AnimationSet::firstCurve, by group
+        std::vector<uint32_t> Outputs;  // Per curve (in curve order), offset of its value in floats
+        uint32_t OutputSize = 0;        // Floats written by Sample, a multiple of four
+    };
+
+    // 3 for translation and scale, 4 for rotation, one per morph target for weights
+    uint32_t GetNumComponents(const AnimationCurve& curve);
+
+    void BuildPlan(const AnimationCurve* curves, uint32_t numCurves, Plan& plan);
+
+    // Writes the value of every curve at 'time' to output + plan.Outputs[curve]. Rotations are
+    // normalized quaternions in x, y, z, w order. Each value is padded to a multiple of four
+    // floats, and the padding is overwritten.
+    void Sample(const Plan& plan, const AnimationCurve* curves, const uint8_t* keyFrameData,
+        float time, float* output);
+
+    // Samples a single curve without SIMD into a value padded like those of Sample. This is the
+    // reference for Sample, which blends linear rotations with a fast approximation of slerp.
+    void SampleCurve(const AnimationCurve& curve, const uint8_t* keyFrameData, float time, float* output);
+}
@@ -201,11 +201,18 @@ bool ModelH3D::BuildModel(ModelData& model, const std::wstring& basePath) const
         memcpy(prim.minPos, &mesh.boundingBox.GetMin(), 12);
         memcpy(prim.maxPos, &mesh.boundingBox.GetMax(), 12);
         prim.minIndex = 0;
-        prim.maxIndex = 0;
+
+        // The mesh builder relies on the largest index, like for glTF
+        glTFDecode::FindMaxIndex(IndexStream.dataPtr, IndexStream.stride, IndexStream.componentType, IndexStream.count, prim.maxIndex);
+        if (IndexStream.count > 0 && prim.maxIndex >= PosStream.count)
+        {
+            LOG_ERRORF("H3D mesh %u has index %u for %u vertices.", i, prim.maxIndex, PosStream.count);
+            return false;
+        }
 
         BoundingSphere sphereOS;
         AxisAlignedBox boxOS;
-        Renderer::CompileMesh(model.m_Meshes, model.m_GeometryData, gltfMesh, 0, Matrix4(kIdentity), sphereOS, boxOS); 
+        Renderer::CompileMesh(model.m_Meshes, model.m_GeometryData, model.m_Meshlets, gltfMesh, 0, Matrix4(kIdentity), sphereOS, boxOS); 
         model.m_BoundingSphere = model.m_BoundingSphere.Union(sphereOS);
         model.m_BoundingBox.AddBoundingBox(boxOS);
     }
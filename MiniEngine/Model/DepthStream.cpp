@@ -0,0 +1,97 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "DepthStream.h"
+#include "VertexDeduplicate.h"
+
+#include <cstring>
+
+bool DepthStream::Build(const uint32_t* indices, uint32_t indexCount, const uint8_t* vertices, uint32_t vertexCount,
+    uint32_t stride, const float* positions, uint32_t positionStride,
+    const VertexCacheOptimize::Settings& settings, Result& result)
+{
+    result.vertices.clear();
+    result.indices.clear();
+    result.vertexCount = 0;
+
+    if (indexCount == 0)
+        return false;
+
+    for (uint32_t i = 0; i < indexCount; ++i)
+    {
+        if (indices[i] >= vertexCount)
+            return false;
+    }
+
+    std::vector<uint8_t> welded((size_t)vertexCount * stride);
+    std::vector<uint32_t> remap(vertexCount);
+    const uint32_t weldedCount = VertexDeduplicate::Deduplicate(vertices, vertexCount, stride,
+        nullptr, 0, welded.data(), remap.data());
+
+    // Welded vertices can differ in position only where positions are quantized, and then by
+    // less than the quantization step, so any of them serves to reduce overdraw
+    std::vector<float> weldedPositions((size_t)weldedCount * 3);
+    for (uint32_t v = 0; v < vertexCount; ++v)
+        std::memcpy(&weldedPositions[(size_t)remap[v] * 3], (const uint8_t*)positions + (size_t)v * positionStride, 3 * sizeof(float));
+
+    std::vector<uint32_t> depthIndices;
+    depthIndices.reserve(indexCount);
+    for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        const uint32_t i0 = remap[indices[i]];
+        const uint32_t i1 = remap[indices[i + 1]];
+        const uint32_t i2 = remap[indices[i + 2]];
+        if (i0 == i1 || i1 == i2 || i2 == i0)
+            continue;
+
+        depthIndices.push_back(i0);
+        depthIndices.push_back(i1);
+        depthIndices.push_back(i2);
+    }
+
+    std::vector<uint32_t>& optimized = result.indices;
+    optimized.resize(depthIndices.size());
+    if (!depthIndices.empty())
+    {
+        VertexCacheOptimize::Reorder(settings, depthIndices.data(), depthIndices.size(), weldedPositions.data(),
+            weldedCount, 3 * sizeof(float), optimized.data());
+    }
+
+    const uint32_t kUnused = 0xFFFFFFFF;
+    std::vector<uint32_t> order(weldedCount, kUnused);
+    uint32_t depthVertexCount = 0;
+    for (uint32_t& index : optimized)
+    {
+        if (order[index] == kUnused)
+            order[index] = depthVertexCount++;
+        index = order[index];
+    }
+
+    result.vertexCount = depthVertexCount;
+    result.vertices.resize((size_t)depthVertexCount * stride);
+    for (uint32_t v = 0; v < weldedCount; ++v)
+    {
+        if (order[v] != kUnused)
+            std::memcpy(result.vertices.data() + (size_t)order[v] * stride, welded.data() + (size_t)v * stride, stride);
+    }
+
+    return true;
+}
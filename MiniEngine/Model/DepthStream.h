@@ -0,0 +1,58 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include "VertexCacheOptimize.h"
+
+#include <cstdint>
+#include <vector>
+
+//
+// Builds the depth-only stream of a primitive, used by OptimizeMesh.
+//
+// The depth pass reads fewer attributes than the main pass (the position, plus the UV when
+// alpha testing and the joints and weights when skinning), so vertices that differ only in
+// normals, tangents or other UVs become identical. They are welded, the triangles that lose
+// their area are dropped, and the rest are ordered for the post-transform cache with the
+// same settings as the main index buffer. The surviving vertices are renumbered in order of
+// first use.
+//
+// This has no engine dependencies so that it can also be built into the standalone check
+// (see Tools/DepthStreamCheck).
+//
+namespace DepthStream
+{
+    struct Result
+    {
+        std::vector<uint8_t> vertices;      // vertexCount vertices, 'stride' bytes apart
+        std::vector<uint32_t> indices;
+        uint32_t vertexCount = 0;
+    };
+
+    // 'vertices' holds the depth vertices of the primitive, 'positions' its float3 positions
+    // 'positionStride' bytes apart, used to reduce overdraw. Returns false when there are no
+    // indices or an index is out of range, so the depth pass has to share the main index
+    // buffer and vertices. Statistics in 'settings' are ignored.
+    bool Build(const uint32_t* indices, uint32_t indexCount, const uint8_t* vertices, uint32_t vertexCount,
+        uint32_t stride, const float* positions, uint32_t positionStride,
+        const VertexCacheOptimize::Settings& settings, Result& result);
+}
@@ -16,12 +16,16 @@
 
 // modified from original source to improve performance (especially in debug builds), memory allocations, etc.
 
-#include "../Core/Utility.h"
+// This file has no engine dependencies so that it can also be built into the
+// standalone vertex cache check (see Tools/VertexCacheCheck).
 
 #include <stdint.h>
-#include <ASSERT.h>
+#include <string.h>
+#include <assert.h>
 #include <math.h>
 #include <algorithm>
+#include <limits>
+#include <memory>
 
 #include "IndexOptimizePostTransform.h"
 
@@ -52,7 +56,7 @@ namespace
             }
             else
             {
-                ASSERT ( cachePosition < int(vertexCacheSize) );
+                assert( cachePosition < int(vertexCacheSize) );
                 // Points for being high in the cache.
                 const float scaler = 1.0f / ( vertexCacheSize - 3 );
                 score = 1.0f - ( cachePosition - 3 ) * scaler;
@@ -222,7 +226,7 @@ struct FaceValenceSort
 template <typename SrcIndexType, typename DstIndexType>
 void OptimizeFaces(const SrcIndexType* indexList, size_t indexCount, DstIndexType* newIndexList, size_t lruCacheSize)
 {
-    ASSERT(lruCacheSize <= kMaxVertexCacheSize);
+    assert(lruCacheSize <= kMaxVertexCacheSize);
 
     std::unique_ptr<OptimizeVertexData[]> vertexDataList(new OptimizeVertexData[indexCount]); // upper bounds on size is indexCount
     std::unique_ptr<uint32_t[]> vertexRemap(new uint32_t[indexCount]);
@@ -285,7 +289,7 @@ void OptimizeFaces(const SrcIndexType* indexList, size_t indexCount, DstIndexTyp
             vertexData.score = FindVertexScore(vertexData.activeFaceListSize, vertexData.cachePos0, lruCacheSize);
             vertexData.activeFaceListSize = 0;
         }
-        ASSERT(curActiveFaceListPos == indexCount);
+        assert(curActiveFaceListPos == indexCount);
     }
 
     // sort unprocessed faces by highest score
@@ -351,7 +355,7 @@ void OptimizeFaces(const SrcIndexType* indexList, size_t indexCount, DstIndexTyp
                     break; // we're searching a pre-sorted list, first one we find will be the best
                 }
             }
-            ASSERT(bestScore >= 0.0f);
+            assert(bestScore >= 0.0f);
         }
 
         processedFaceList[bestFace / 3] = 1;
@@ -377,11 +381,11 @@ void OptimizeFaces(const SrcIndexType* indexList, size_t indexCount, DstIndexTyp
                 }
             }
 
-            ASSERT(vertexData.activeFaceListSize > 0);
+            assert(vertexData.activeFaceListSize > 0);
             uint32_t* begin = activeFaceList.get() + vertexData.activeFaceListStart;
             uint32_t* end = begin + vertexData.activeFaceListSize;
             uint32_t* it = std::find(begin, end, bestFace);
-            ASSERT(it != end);
+            assert(it != end);
             std::swap(*it, *(end-1));
             --vertexData.activeFaceListSize;
             vertexData.score = FindVertexScore(vertexData.activeFaceListSize, vertexData.cachePos1, lruCacheSize);
@@ -392,10 +396,10 @@ void OptimizeFaces(const SrcIndexType* indexList, size_t indexCount, DstIndexTyp
                 uint32_t faceIndex = *fi / 3;
 
                 uint32_t n = faceReverseLookup[faceIndex];
-                ASSERT(faceSorted[n] == faceIndex);
+                assert(faceSorted[n] == faceIndex);
 
                 // found it, now move it up
-                for (n; n > 0; --n)
+                for (; n > 0; --n)
                 {
                     if (!faceValenceSort(n, n - 1))
                         break;
@@ -448,3 +452,19 @@ void OptimizeFaces(const SrcIndexType* indexList, size_t indexCount, DstIndexTyp
         entriesInCache0 = std::min(entriesInCache1, lruCacheSize);
     }
 }
+
+template void OptimizeFaces<int8_t, uint16_t>(const int8_t* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
+template void OptimizeFaces<int8_t, uint32_t>(const int8_t* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
+template void OptimizeFaces<uint8_t, uint16_t>(const uint8_t* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
+template void OptimizeFaces<uint8_t, uint32_t>(const uint8_t* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
+
+template void OptimizeFaces<int16_t, uint16_t>(const int16_t* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
+template void OptimizeFaces<int16_t, uint32_t>(const int16_t* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
+template void OptimizeFaces<uint16_t, uint16_t>(const uint16_t* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
+template void OptimizeFaces<uint16_t, uint32_t>(const uint16_t* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
+
+template void OptimizeFaces<uint32_t, uint16_t>(const uint32_t* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
+template void OptimizeFaces<uint32_t, uint32_t>(const uint32_t* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
+
+template void OptimizeFaces<float, uint16_t>(const float* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
+template void OptimizeFaces<float, uint32_t>(const float* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
@@ -17,6 +17,9 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
 //-----------------------------------------------------------------------------
 //  OptimizeFaces
 //-----------------------------------------------------------------------------
@@ -34,18 +37,18 @@
 template <typename SrcIndexType, typename DstIndexType>
 void OptimizeFaces(const SrcIndexType* indexList, size_t indexCount, DstIndexType* newIndexList, size_t lruCacheSize);
 
-template void OptimizeFaces<int8_t, uint16_t>(const int8_t* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
-template void OptimizeFaces<int8_t, uint32_t>(const int8_t* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
-template void OptimizeFaces<uint8_t, uint16_t>(const uint8_t* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
-template void OptimizeFaces<uint8_t, uint32_t>(const uint8_t* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
+extern template void OptimizeFaces<int8_t, uint16_t>(const int8_t* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
+extern template void OptimizeFaces<int8_t, uint32_t>(const int8_t* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
+extern template void OptimizeFaces<uint8_t, uint16_t>(const uint8_t* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
+extern template void OptimizeFaces<uint8_t, uint32_t>(const uint8_t* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
 
-template void OptimizeFaces<int16_t, uint16_t>(const int16_t* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
-template void OptimizeFaces<int16_t, uint32_t>(const int16_t* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
-template void OptimizeFaces<uint16_t, uint16_t>(const uint16_t* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
-template void OptimizeFaces<uint16_t, uint32_t>(const uint16_t* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
+extern template void OptimizeFaces<int16_t, uint16_t>(const int16_t* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
+extern template void OptimizeFaces<int16_t, uint32_t>(const int16_t* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
+extern template void OptimizeFaces<uint16_t, uint16_t>(const uint16_t* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
+extern template void OptimizeFaces<uint16_t, uint32_t>(const uint16_t* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
 
-template void OptimizeFaces<uint32_t, uint16_t>(const uint32_t* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
-template void OptimizeFaces<uint32_t, uint32_t>(const uint32_t* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
+extern template void OptimizeFaces<uint32_t, uint16_t>(const uint32_t* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
+extern template void OptimizeFaces<uint32_t, uint32_t>(const uint32_t* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
 
-template void OptimizeFaces<float, uint16_t>(const float* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
-template void OptimizeFaces<float, uint32_t>(const float* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
+extern template void OptimizeFaces<float, uint16_t>(const float* indexList, size_t indexCount, uint16_t* newIndexList, size_t lruCacheSize);
+extern template void OptimizeFaces<float, uint32_t>(const float* indexList, size_t indexCount, uint32_t* newIndexList, size_t lruCacheSize);
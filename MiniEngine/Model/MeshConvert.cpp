@@ -21,8 +21,10 @@
 #include "TextureConvert.h"
 #include "glTF.h"
 #include "Model.h"
-#include "IndexOptimizePostTransform.h"
+#include "DepthStream.h"
+#include "ModelLoader.h"
 #include "../Core/VectorMath.h"
+#include "../Core/SystemTime.h"
 #include "DirectXMesh.h"
 
 using namespace DirectX;
@@ -125,53 +127,154 @@ uint32_t GetMaxIndex(const glTF::Primitive& inPrim)
     return maxIndex;
 }
 
-void OptimizePrimitiveFaces(const glTF::Primitive& inPrim, bool b32BitIndices, Renderer::Primitive& outPrim)
+template <typename IndexType>
+static void ReadIndices(const void* src, uint32_t indexCount, uint32_t* dst)
 {
+    const IndexType* ib = (const IndexType*)src;
+    for (uint32_t k = 0; k < indexCount; ++k)
+        dst[k] = static_cast<uint32_t>(ib[k]);
+}
+
+void OptimizePrimitiveFaces(const glTF::Primitive& inPrim, uint32_t vertexCount, bool b32BitIndices,
+    const VertexCacheOptimize::Settings& settings, Renderer::Primitive& outPrim)
+{
+    using namespace VertexCacheOptimize;
+
+    const uint32_t indexCount = inPrim.indices->count;
+    const void* srcIndices = inPrim.indices->dataPtr;
+
+    // Every algorithm works on 32-bit indices, narrowed to 16 bits at the end when possible
+    std::vector<uint32_t> indices(indexCount);
+    std::vector<uint32_t> optimized(indexCount);
+
+    // The loaders have scanned the indices and rejected any that address no vertex
+    ASSERT(indexCount == 0 || inPrim.maxIndex < vertexCount, "Mesh index out of range");
+
     switch (inPrim.indices->componentType)
     {
-    case Accessor::kByte:
-        if (b32BitIndices)
-            OptimizeFaces((int8_t*)inPrim.indices->dataPtr, inPrim.indices->count, (uint32_t*)outPrim.IB->data(), 64);
-        else
-            OptimizeFaces((int8_t*)inPrim.indices->dataPtr, inPrim.indices->count, (uint16_t*)outPrim.IB->data(), 64);
-        break;
-    case Accessor::kUnsignedByte:
-        if (b32BitIndices)
-            OptimizeFaces((uint8_t*)inPrim.indices->dataPtr, inPrim.indices->count, (uint32_t*)outPrim.IB->data(), 64);
-        else
-            OptimizeFaces((uint8_t*)inPrim.indices->dataPtr, inPrim.indices->count, (uint16_t*)outPrim.IB->data(), 64);
-        break;
-    case Accessor::kShort:
-        if (b32BitIndices)
-            OptimizeFaces((int16_t*)inPrim.indices->dataPtr, inPrim.indices->count, (uint32_t*)outPrim.IB->data(), 64);
-        else
-            OptimizeFaces((int16_t*)inPrim.indices->dataPtr, inPrim.indices->count, (uint16_t*)outPrim.IB->data(), 64);
-        break;
-    case Accessor::kUnsignedShort:
-        if (b32BitIndices)
-            OptimizeFaces((uint16_t*)inPrim.indices->dataPtr, inPrim.indices->count, (uint32_t*)outPrim.IB->data(), 64);
-        else
-            OptimizeFaces((uint16_t*)inPrim.indices->dataPtr, inPrim.indices->count, (uint16_t*)outPrim.IB->data(), 64);
-        break;
-    case Accessor::kUnsignedInt:
-        if (b32BitIndices)
-            OptimizeFaces((uint32_t*)inPrim.indices->dataPtr, inPrim.indices->count, (uint32_t*)outPrim.IB->data(), 64);
-        else
-            OptimizeFaces((uint32_t*)inPrim.indices->dataPtr, inPrim.indices->count, (uint16_t*)outPrim.IB->data(), 64);
-        break;
-    case Accessor::kFloat:
-        if (b32BitIndices)
-            OptimizeFaces((float*)inPrim.indices->dataPtr, inPrim.indices->count, (uint32_t*)outPrim.IB->data(), 64);
-        else
-            OptimizeFaces((float*)inPrim.indices->dataPtr, inPrim.indices->count, (uint16_t*)outPrim.IB->data(), 64);
-        break;
+    case Accessor::kUnsignedByte:   ReadIndices<uint8_t>(srcIndices, indexCount, indices.data()); break;
+    case Accessor::kUnsignedShort:  ReadIndices<uint16_t>(srcIndices, indexCount, indices.data()); break;
+    case Accessor::kUnsignedInt:    ReadIndices<uint32_t>(srcIndices, indexCount, indices.data()); break;
     default:
         LOG_ERROR("Unsupported component type for mesh index.");
         return;
     }
+
+    Algorithm algorithm = settings.algorithm;
+    bool reduceOverdraw = settings.reduceOverdraw;
+    bool logStatistics = settings.logStatistics;
+
+    const Accessor& positionAccessor = *inPrim.attributes[glTF::Primitive::kPosition];
+    const float* positions = (const float*)positionAccessor.dataPtr;
+    const uint32_t positionStride = positionAccessor.stride != 0 ? positionAccessor.stride : 3 * sizeof(float);
+
+    // Overdraw is measured and reduced on float3 positions only.  Other position formats would
+    // be misread, and past the end of a tightly packed stream.
+    const bool floatPositions = positionAccessor.componentType == Accessor::kFloat && positionAccessor.type == Accessor::kVec3;
+    if (!floatPositions)
+        reduceOverdraw = false;
+    const bool logOverdraw = logStatistics && floatPositions;
+
+    CacheStatistics cacheBefore;
+    OverdrawStatistics overdrawBefore;
+    if (logStatistics)
+        cacheBefore = AnalyzeVertexCache(indices.data(), indexCount, vertexCount, kDefaultFifoCacheSize);
+    if (logOverdraw)
+        overdrawBefore = AnalyzeOverdraw(indices.data(), indexCount, positions, vertexCount, positionStride);
+
+    const int64_t startTick = SystemTime::GetCurrentTick();
+
+    Settings reorderSettings = settings;
+    reorderSettings.algorithm = algorithm;
+    reorderSettings.reduceOverdraw = reduceOverdraw;
+    Reorder(reorderSettings, indices.data(), indexCount, positions, vertexCount, positionStride, optimized.data());
+
+    const double optimizeTime = SystemTime::TimeBetweenTicks(startTick, SystemTime::GetCurrentTick());
+
+    if (b32BitIndices)
+    {
+        std::memcpy(outPrim.IB->data(), optimized.data(), indexCount * sizeof(uint32_t));
+    }
+    else
+    {
+        uint16_t* dst = (uint16_t*)outPrim.IB->data();
+        for (uint32_t k = 0; k < indexCount; ++k)
+            dst[k] = (uint16_t)optimized[k];
+    }
+
+    if (logStatistics)
+    {
+        const CacheStatistics cacheAfter = AnalyzeVertexCache(optimized.data(), indexCount, vertexCount, kDefaultFifoCacheSize);
+
+        char overdrawText[64] = "";
+        if (logOverdraw)
+        {
+            const OverdrawStatistics overdrawAfter = AnalyzeOverdraw(optimized.data(), indexCount, positions, vertexCount, positionStride);
+            snprintf(overdrawText, sizeof(overdrawText), ", overdraw %.3f -> %.3f", overdrawBefore.overdraw, overdrawAfter.overdraw);
+        }
+
+        LOG_INFOF("%s%s: %u triangles in %.2f ms. ACMR %.3f -> %.3f, ATVR %.3f -> %.3f%s",
+            GetAlgorithmName(algorithm), reduceOverdraw ? " + overdraw" : "", cacheBefore.triangles, optimizeTime * 1000.0,
+            cacheBefore.acmr, cacheAfter.acmr, cacheBefore.atvr, cacheAfter.atvr, overdrawText);
+    }
+}
+
+// Replaces the depth-only stream with its welded and reordered version, see DepthStream::Build
+static void BuildDepthStream(Renderer::Primitive& outPrim, uint32_t vertexCount, uint32_t depthStride,
+    const XMFLOAT3* positions, bool b32BitIndices, const VertexCacheOptimize::Settings& settings)
+{
+    using namespace VertexCacheOptimize;
+
+    const uint32_t indexCount = outPrim.primCount;
+    outPrim.depthVertexStride = (uint16_t)depthStride;
+
+    std::vector<uint32_t> indices(indexCount);
+    if (b32BitIndices)
+        ReadIndices<uint32_t>(outPrim.IB->data(), indexCount, indices.data());
+    else
+        ReadIndices<uint16_t>(outPrim.IB->data(), indexCount, indices.data());
+
+    const int64_t startTick = SystemTime::GetCurrentTick();
+
+    // Keep sharing the index buffer when it can't be remapped
+    DepthStream::Result depth;
+    if (!DepthStream::Build(indices.data(), indexCount, outPrim.DepthVB->data(), vertexCount, depthStride,
+        (const float*)positions, sizeof(XMFLOAT3), settings, depth))
+    {
+        outPrim.DepthIB = outPrim.IB;
+        outPrim.depthPrimCount = indexCount;
+        return;
+    }
+
+    outPrim.DepthVB = std::make_shared<std::vector<byte>>(depth.vertices.begin(), depth.vertices.end());
+
+    const uint32_t depthIndexCount = (uint32_t)depth.indices.size();
+    outPrim.depthPrimCount = depthIndexCount;
+    if (b32BitIndices)
+    {
+        outPrim.DepthIB = std::make_shared<std::vector<byte>>(depthIndexCount * sizeof(uint32_t));
+        std::memcpy(outPrim.DepthIB->data(), depth.indices.data(), depthIndexCount * sizeof(uint32_t));
+    }
+    else
+    {
+        outPrim.DepthIB = std::make_shared<std::vector<byte>>(depthIndexCount * sizeof(uint16_t));
+        uint16_t* dst = (uint16_t*)outPrim.DepthIB->data();
+        for (uint32_t k = 0; k < depthIndexCount; ++k)
+            dst[k] = (uint16_t)depth.indices[k];
+    }
+
+    if (settings.logStatistics)
+    {
+        const double buildTime = SystemTime::TimeBetweenTicks(startTick, SystemTime::GetCurrentTick());
+        const CacheStatistics cache = AnalyzeVertexCache(depth.indices.data(), depthIndexCount, depth.vertexCount, kDefaultFifoCacheSize);
+
+        LOG_INFOF("Depth stream: %u -> %u vertices, %u -> %u triangles in %.2f ms. ACMR %.3f, ATVR %.3f",
+            vertexCount, depth.vertexCount, indexCount / 3, depthIndexCount / 3, buildTime * 1000.0, cache.acmr, cache.atvr);
+    }
 }
 
-void OptimizeMesh(Renderer::Primitive& outPrim, const glTF::Primitive& inPrim, const Math::Matrix4& localToObject)
+void OptimizeMesh(Renderer::Primitive& outPrim, const glTF::Primitive& inPrim, const Math::Matrix4& localToObject,
+    const Renderer::MeshBuildSettings& settings)
 {
     ASSERT(inPrim.attributes[0] != nullptr, "Must have POSITION");
     uint32_t vertexCount = inPrim.attributes[0]->count;
@@ -239,7 +342,7 @@ void OptimizeMesh(Renderer::Primitive& outPrim, const glTF::Primitive& inPrim, c
 
         outPrim.IB = std::make_shared<std::vector<byte>>(indexSize * indexCount);
 
-        OptimizePrimitiveFaces(inPrim, b32BitIndices, outPrim);
+        OptimizePrimitiveFaces(inPrim, vertexCount, b32BitIndices, settings.vertexCache, outPrim);
 
         indices = outPrim.IB->data();
     }
@@ -340,6 +443,33 @@ void OptimizeMesh(Renderer::Primitive& outPrim, const glTF::Primitive& inPrim, c
         ASSERT(outPrim.m_BoundsOS.GetRadius() > 0.0f);
     }
 
+    // Meshlet bounds are in object space like the mesh bounds. Skinned meshes move away from
+    // their bind pose, so static meshlet bounds would be wrong for them.
+    if (settings.buildMeshlets && !HasSkin)
+    {
+        std::vector<uint32_t> meshletIndices(indexCount);
+        uint32_t maxIndex = 0;
+        for (uint32_t i = 0; i < indexCount; ++i)
+        {
+            meshletIndices[i] = b32BitIndices ? ((const uint32_t*)indices)[i] : ((const uint16_t*)indices)[i];
+            maxIndex = std::max(meshletIndices[i], maxIndex);
+        }
+
+        if (indexCount > 0 && maxIndex >= vertexCount)
+        {
+            LOG_WARN("Mesh indices are out of range. Skipping meshlets.");
+        }
+        else
+        {
+            std::vector<XMFLOAT3> positionOS(vertexCount);
+            for (uint32_t v = 0; v < vertexCount; ++v)
+                XMStoreFloat3(&positionOS[v], Vector3(localToObject * Vector4(Vector3(position[v]))));
+
+            Meshlets::Build(meshletIndices.data(), indexCount, (const float*)positionOS.data(), vertexCount, sizeof(XMFLOAT3),
+                settings.maxMeshletVertices, settings.maxMeshletTriangles, !material.twoSided, outPrim.meshlets);
+        }
+    }
+
     if (HasNormals)
     {
         ASSERT_SUCCEEDED(vbr.Read(normal.get(), "NORMAL", 0, vertexCount));
@@ -419,24 +549,39 @@ void OptimizeMesh(Renderer::Primitive& outPrim, const glTF::Primitive& inPrim, c
     }
 
     // Use VBWriter to generate a new, interleaved and compressed vertex buffer
+    using namespace VertexQuantization;
+    const Profile quantization = settings.vertexQuantization;
+    const bool quantize = quantization != kNone;
+
+    // Quantized vertices keep the tangent in the NORMAL element and its handedness in POSITION.w
+    const DXGI_FORMAT positionFormat = quantize ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R32G32B32_FLOAT;
+    const DXGI_FORMAT uvFormat = quantize ? DXGI_FORMAT_R16G16_UNORM : DXGI_FORMAT_R16G16_FLOAT;
+    DXGI_FORMAT normalFormat = DXGI_FORMAT_R10G10B10A2_UNORM;
+    if (quantize)
+        normalFormat = quantization == kCompact ? DXGI_FORMAT_R8G8B8A8_SNORM : DXGI_FORMAT_R16G16B16A16_SNORM;
+
     std::vector<D3D12_INPUT_ELEMENT_DESC> OutputElements;
+    uint32_t uvElement[2] = { kNotPresent, kNotPresent };
 
     outPrim.psoFlags = PSOFlags::kHasPosition | PSOFlags::kHasNormal;
-    OutputElements.push_back({"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT});
-    OutputElements.push_back({"NORMAL", 0, DXGI_FORMAT_R10G10B10A2_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT});
+    OutputElements.push_back({"POSITION", 0, positionFormat, 0, D3D12_APPEND_ALIGNED_ELEMENT});
+    OutputElements.push_back({"NORMAL", 0, normalFormat, 0, D3D12_APPEND_ALIGNED_ELEMENT});
     if (tangent.get())
     {
-        OutputElements.push_back({"TANGENT", 0, DXGI_FORMAT_R10G10B10A2_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT});
+        if (!quantize)
+            OutputElements.push_back({"TANGENT", 0, DXGI_FORMAT_R10G10B10A2_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT});
         outPrim.psoFlags |= PSOFlags::kHasTangent;
     }
     if (texcoord0.get())
     {
-        OutputElements.push_back({"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT});
+        uvElement[0] = (uint32_t)OutputElements.size();
+        OutputElements.push_back({"TEXCOORD", 0, uvFormat, 0, D3D12_APPEND_ALIGNED_ELEMENT});
         outPrim.psoFlags |= PSOFlags::kHasUV0;
     }
     if (texcoord1.get())
     {
-        OutputElements.push_back({"TEXCOORD", 1, DXGI_FORMAT_R16G16_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT});
+        uvElement[1] = (uint32_t)OutputElements.size();
+        OutputElements.push_back({"TEXCOORD", 1, uvFormat, 0, D3D12_APPEND_ALIGNED_ELEMENT});
         outPrim.psoFlags |= PSOFlags::kHasUV1;
     }
     if (HasSkin)
@@ -451,6 +596,10 @@ void OptimizeMesh(Renderer::Primitive& outPrim, const glTF::Primitive& inPrim, c
         outPrim.psoFlags |= PSOFlags::kAlphaTest;
     if (material.twoSided)
         outPrim.psoFlags |= PSOFlags::kTwoSided;
+    if (quantize)
+        outPrim.psoFlags |= PSOFlags::kQuantized;
+    if (quantization == kCompact)
+        outPrim.psoFlags |= PSOFlags::kCompactNormals;
 
     D3D12_INPUT_LAYOUT_DESC layout = {OutputElements.data(), (uint32_t)OutputElements.size()};
 
@@ -465,28 +614,68 @@ void OptimizeMesh(Renderer::Primitive& outPrim, const glTF::Primitive& inPrim, c
     outPrim.VB = std::make_shared<std::vector<byte>>(stride * vertexCount);
     ASSERT_SUCCEEDED(vbw.AddStream(outPrim.VB->data(), vertexCount, 0, stride));
 
-    vbw.Write( position.get(), "POSITION", 0, vertexCount );
-    vbw.Write( normal.get(), "NORMAL", 0, vertexCount, true );
-    if (tangent.get())
-        vbw.Write( tangent.get(), "TANGENT", 0, vertexCount, true );
-    if (texcoord0.get())
-        vbw.Write( texcoord0.get(), "TEXCOORD", 0, vertexCount );
-    if (texcoord1.get())
-        vbw.Write( texcoord1.get(), "TEXCOORD", 1, vertexCount );
+    // The same ranges serve the depth stream, where the alpha tested UVs may come from either set
+    Streams streams;
+    streams.vertexCount = vertexCount;
+    streams.positions = (const float*)position.get();
+    streams.normals = (const float*)normal.get();
+    streams.tangents = (const float*)tangent.get();
+    streams.uvs[0] = (const float*)texcoord0.get();
+    streams.uvs[1] = (const float*)texcoord1.get();
+
+    outPrim.dequantization = Dequantization();
+    if (quantize)
+        outPrim.dequantization = ComputeDequantization(streams);
+
+    Layout quantizedLayout = { stride, offsets[0], offsets[1], { kNotPresent, kNotPresent } };
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        if (uvElement[i] != kNotPresent)
+            quantizedLayout.uv[i] = offsets[uvElement[i]];
+    }
+
+    if (quantize)
+    {
+        Encode(streams, quantization, outPrim.dequantization, quantizedLayout, outPrim.VB->data());
+    }
+    else
+    {
+        vbw.Write( position.get(), "POSITION", 0, vertexCount );
+        vbw.Write( normal.get(), "NORMAL", 0, vertexCount, true );
+        if (tangent.get())
+            vbw.Write( tangent.get(), "TANGENT", 0, vertexCount, true );
+        if (texcoord0.get())
+            vbw.Write( texcoord0.get(), "TEXCOORD", 0, vertexCount );
+        if (texcoord1.get())
+            vbw.Write( texcoord1.get(), "TEXCOORD", 1, vertexCount );
+    }
     if (HasSkin)
     {
         vbw.Write(joints.get(), "BLENDINDICES", 0, vertexCount);
         vbw.Write(weights.get(), "BLENDWEIGHT", 0, vertexCount);
     }
 
+    if (quantize && settings.logQuantizationError)
+    {
+        const ErrorStatistics error = MeasureError(streams, outPrim.VB->data(), quantization, outPrim.dequantization,
+            quantizedLayout);
+
+        const uint32_t floatStride = 12 + 4 + (tangent.get() ? 4 : 0) + (texcoord0.get() ? 4 : 0) +
+            (texcoord1.get() ? 4 : 0) + (HasSkin ? 16 : 0);
+
+        LOG_INFOF("Vertex quantization %s: %u vertices, %u -> %u bytes each. Max error position %g (%g of extent), "
+            "normal %.3f deg, tangent %.3f deg, UV %g.", GetProfileName(quantization), vertexCount, floatStride, stride,
+            error.position, error.positionRelative, error.normalDegrees, error.tangentDegrees, error.uv);
+    }
+
     // Now write a VB for positions only (or positions and UV when alpha testing)
-    uint32_t depthStride = 12;
+    uint32_t depthStride = quantize ? kPositionSize : 12;
     std::vector<D3D12_INPUT_ELEMENT_DESC> DepthElements;
-    DepthElements.push_back({"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT});
+    DepthElements.push_back({"POSITION", 0, positionFormat, 0, D3D12_APPEND_ALIGNED_ELEMENT});
     if (material.alphaTest)
     {
         depthStride += 4;
-        DepthElements.push_back({"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT});
+        DepthElements.push_back({"TEXCOORD", 0, uvFormat, 0, D3D12_APPEND_ALIGNED_ELEMENT});
     }
     if (HasSkin)
     {
@@ -501,10 +690,24 @@ void OptimizeMesh(Renderer::Primitive& outPrim, const glTF::Primitive& inPrim, c
     outPrim.DepthVB = std::make_shared<std::vector<byte>>(depthStride * vertexCount);
     ASSERT_SUCCEEDED(dvbw.AddStream(outPrim.DepthVB->data(), vertexCount, 0, depthStride));
 
-    dvbw.Write( position.get(), "POSITION", 0, vertexCount );
-    if (material.alphaTest)
+    const XMFLOAT2* depthUVs = material.baseColorUV ? texcoord1.get() : texcoord0.get();
+    if (quantize)
     {
-        dvbw.Write(material.baseColorUV ? texcoord1.get() : texcoord0.get(), "TEXCOORD", 0, vertexCount);
+        Streams depthStreams;
+        depthStreams.vertexCount = vertexCount;
+        depthStreams.positions = streams.positions;
+        depthStreams.uvs[0] = (const float*)depthUVs;
+
+        const Layout depthLayout = { depthStride, 0, kNotPresent, { material.alphaTest ? kPositionSize : kNotPresent, kNotPresent } };
+        Encode(depthStreams, quantization, outPrim.dequantization, depthLayout, outPrim.DepthVB->data());
+    }
+    else
+    {
+        dvbw.Write( position.get(), "POSITION", 0, vertexCount );
+        if (material.alphaTest)
+        {
+            dvbw.Write(depthUVs, "TEXCOORD", 0, vertexCount);
+        }
     }
     if (HasSkin)
     {
@@ -520,6 +723,6 @@ void OptimizeMesh(Renderer::Primitive& outPrim, const glTF::Primitive& inPrim, c
 
     outPrim.primCount = indexCount;
 
-    // TODO:  Generate optimized depth-only streams
+    BuildDepthStream(outPrim, vertexCount, depthStride, position.get(), b32BitIndices, settings.vertexCache);
 }
 
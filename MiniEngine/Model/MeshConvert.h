@@ -14,6 +14,8 @@
 #pragma once
 
 #include "glTF.h"
+#include "Meshlets.h"
+#include "VertexQuantization.h"
 #include "../Core/Math/BoundingSphere.h"
 #include "../Core/Math/BoundingBox.h"
 
@@ -24,6 +26,8 @@ namespace Renderer
 {
     using namespace Math;
 
+    struct MeshBuildSettings;
+
     struct Primitive
     {
         BoundingSphere m_BoundsLS;  // local space bounds
@@ -32,8 +36,12 @@ namespace Renderer
         AxisAlignedBox m_BBoxOS;       // object space AABB
         Utility::ByteArray VB;
         Utility::ByteArray IB;
-        Utility::ByteArray DepthVB;
+        Utility::ByteArray DepthVB;     // Vertices welded by their depth-only attributes
+        Utility::ByteArray DepthIB;     // Same index size as IB
+        std::vector<Meshlets::Meshlet> meshlets;  // Relative to the start of IB
+        VertexQuantization::Dequantization dequantization;  // With PSOFlags::kQuantized
         uint32_t primCount;
+        uint32_t depthPrimCount;
         union
         {
             uint32_t hash;
@@ -44,7 +52,13 @@ namespace Renderer
             };
         };
         uint16_t vertexStride;
+        uint16_t depthVertexStride;
     };
 }
 
-void OptimizeMesh( Renderer::Primitive& outPrim, const glTF::Primitive& inPrim, const Math::Matrix4& localToObject );
\ No newline at end of file
+// 'settings' chooses how the triangles of the primitive are ordered for the post-transform
+// vertex cache, whether they are split into meshlets and how the vertices are quantized.
+// The depth-only stream welds vertices that differ only in attributes the depth pass does
+// not read and has its own index buffer, ordered with the same settings.
+void OptimizeMesh( Renderer::Primitive& outPrim, const glTF::Primitive& inPrim, const Math::Matrix4& localToObject,
+    const Renderer::MeshBuildSettings& settings );
\ No newline at end of file
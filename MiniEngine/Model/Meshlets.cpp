@@ -0,0 +1,349 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// This file has no engine dependencies so that it can also be built into the
+// standalone meshlet benchmark (see Tools/MeshletBenchmark).
+
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace std;
+
+namespace
+{
+    inline const float* GetPosition(const float* positions, uint32_t stride, uint32_t v)
+    {
+        return (const float*)((const uint8_t*)positions + (size_t)v * stride);
+    }
+
+    inline float DistanceSquared(const float* a, const float* b)
+    {
+        const float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    // Ritter's bounding sphere: start from the most distant pair of axis extremes, then grow
+    // to take in every point that is left outside
+    void ComputeBounds(const uint32_t* vertices, uint32_t count, const float* positions, uint32_t stride, float bounds[4])
+    {
+        uint32_t minVertex[3], maxVertex[3];
+        for (int k = 0; k < 3; ++k)
+            minVertex[k] = maxVertex[k] = vertices[0];
+
+        for (uint32_t i = 1; i < count; ++i)
+        {
+            const float* p = GetPosition(positions, stride, vertices[i]);
+            for (int k = 0; k < 3; ++k)
+            {
+                if (p[k] < GetPosition(positions, stride, minVertex[k])[k])
+                    minVertex[k] = vertices[i];
+                if (p[k] > GetPosition(positions, stride, maxVertex[k])[k])
+                    maxVertex[k] = vertices[i];
+            }
+        }
+
+        int axis = 0;
+        float spread = 0.0f;
+        for (int k = 0; k < 3; ++k)
+        {
+            const float d = DistanceSquared(GetPosition(positions, stride, minVertex[k]), GetPosition(positions, stride, maxVertex[k]));
+            if (d > spread)
+            {
+                spread = d;
+                axis = k;
+            }
+        }
+
+        const float* a = GetPosition(positions, stride, minVertex[axis]);
+        const float* b = GetPosition(positions, stride, maxVertex[axis]);
+        float center[3] = { (a[0] + b[0]) * 0.5f, (a[1] + b[1]) * 0.5f, (a[2] + b[2]) * 0.5f };
+        float radius = sqrt(spread) * 0.5f;
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const float* p = GetPosition(positions, stride, vertices[i]);
+            const float d = sqrt(DistanceSquared(p, center));
+            if (d > radius)
+            {
+                // Move the center toward the point just enough to reach it
+                const float newRadius = (radius + d) * 0.5f;
+                const float t = (newRadius - radius) / d;
+                for (int k = 0; k < 3; ++k)
+                    center[k] += (p[k] - center[k]) * t;
+                radius = newRadius;
+            }
+        }
+
+        // Rounding in the center update can leave a point just outside
+        float maxDistance = 0.0f;
+        for (uint32_t i = 0; i < count; ++i)
+            maxDistance = max(maxDistance, DistanceSquared(GetPosition(positions, stride, vertices[i]), center));
+
+        bounds[0] = center[0];
+        bounds[1] = center[1];
+        bounds[2] = center[2];
+        bounds[3] = max(radius, sqrt(maxDistance));
+    }
+
+    // The axis is the mean of the unit face normals. The spread 'sin(theta)' is derived from
+    // the widest angle 'theta' between the axis and a face normal, and is 1 when a face is 90
+    // degrees or more away from the axis.
+    void ComputeCone(const uint32_t* indices, uint32_t indexCount, const float* positions, uint32_t stride,
+        std::vector<float>& normals, float cone[4])
+    {
+        cone[0] = cone[1] = cone[2] = 0.0f;
+        cone[3] = 1.0f;
+
+        normals.clear();
+        float axis[3] = { 0.0f, 0.0f, 0.0f };
+
+        for (uint32_t i = 0; i < indexCount; i += 3)
+        {
+            const float* p0 = GetPosition(positions, stride, indices[i + 0]);
+            const float* p1 = GetPosition(positions, stride, indices[i + 1]);
+            const float* p2 = GetPosition(positions, stride, indices[i + 2]);
+
+            const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+
+            // Degenerate triangles produce no pixels, so they do not constrain the cone
+            const float length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (!(length > 0.0f))
+                continue;
+
+            for (int k = 0; k < 3; ++k)
+            {
+                n[k] /= length;
+                axis[k] += n[k];
+                normals.push_back(n[k]);
+            }
+        }
+
+        const float axisLength = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        if (normals.empty() || !(axisLength > 0.0f))
+            return;
+
+        for (int k = 0; k < 3; ++k)
+            axis[k] /= axisLength;
+
+        float minDot = 1.0f;
+        for (size_t i = 0; i < normals.size(); i += 3)
+            minDot = min(minDot, axis[0] * normals[i] + axis[1] * normals[i + 1] + axis[2] * normals[i + 2]);
+
+        cone[0] = axis[0];
+        cone[1] = axis[1];
+        cone[2] = axis[2];
+
+        // Widened slightly so that rounding never makes the test cull a visible meshlet
+        if (minDot > 0.0f)
+            cone[3] = min(1.0f, sqrt(1.0f - minDot * minDot) + 1e-4f);
+    }
+}
+
+uint32_t Meshlets::Build(const uint32_t* indices, size_t indexCount, const float* positions, uint32_t vertexCount,
+    uint32_t positionStride, uint32_t maxVertices, uint32_t maxTriangles, bool computeCones,
+    std::vector<Meshlet>& meshlets)
+{
+    assert(maxVertices >= 3 && maxTriangles >= 1);
+
+    const size_t firstMeshlet = meshlets.size();
+    const uint32_t faceIndexCount = (uint32_t)(indexCount / 3 * 3);
+
+    // The meshlet each vertex was last added to, plus one
+    vector<uint32_t> vertexMeshlet(vertexCount, 0);
+    vector<uint32_t> meshletVertices;
+    vector<float> normals;
+    meshletVertices.reserve(maxVertices);
+
+    uint32_t start = 0;
+    uint32_t stamp = 1;
+
+    auto finish = [&](uint32_t end)
+    {
+        Meshlet meshlet = {};
+        meshlet.startIndex = start;
+        meshlet.primCount = end - start;
+        meshlet.vertexCount = (uint32_t)meshletVertices.size();
+
+        ComputeBounds(meshletVertices.data(), meshlet.vertexCount, positions, positionStride, meshlet.bounds);
+        if (computeCones)
+            ComputeCone(indices + start, meshlet.primCount, positions, positionStride, normals, meshlet.cone);
+        else
+            meshlet.cone[3] = 1.0f;
+
+        meshlets.push_back(meshlet);
+        meshletVertices.clear();
+        start = end;
+        ++stamp;
+    };
+
+    for (uint32_t i = 0; i < faceIndexCount; i += 3)
+    {
+        uint32_t newVertices = 0;
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            const uint32_t v = indices[i + j];
+            assert(v < vertexCount);
+
+            // Repeated vertices within the triangle are only counted once
+            bool repeated = false;
+            for (uint32_t k = 0; k < j; ++k)
+                repeated |= indices[i + k] == v;
+
+            if (vertexMeshlet[v] != stamp && !repeated)
+                ++newVertices;
+        }
+
+        if (meshletVertices.size() + newVertices > maxVertices || (i - start) / 3 + 1 > maxTriangles)
+            finish(i);
+
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            const uint32_t v = indices[i + j];
+            if (vertexMeshlet[v] != stamp)
+            {
+                vertexMeshlet[v] = stamp;
+                meshletVertices.push_back(v);
+            }
+        }
+    }
+
+    if (faceIndexCount > start)
+        finish(faceIndexCount);
+
+    return (uint32_t)(meshlets.size() - firstMeshlet);
+}
+
+uint32_t Meshlets::Cull(const Meshlet* meshlets, uint32_t count, const float xform[12], const CullView& view,
+    bool cullBackFacing, uint32_t* visible, CullStats* stats)
+{
+    // A plane n.p + w of the view becomes (M^T n).p + (n.t + w) for points p of the bounds.
+    // It is not normalized, so the radius is scaled by the length of the new normal instead.
+    float planes[6][5];
+    for (int p = 0; p < 6; ++p)
+    {
+        const float* plane = view.planes[p];
+        for (int k = 0; k < 3; ++k)
+            planes[p][k] = plane[0] * xform[k] + plane[1] * xform[4 + k] + plane[2] * xform[8 + k];
+        planes[p][3] = plane[0] * xform[3] + plane[1] * xform[7] + plane[2] * xform[11] + plane[3];
+        planes[p][4] = sqrt(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+    }
+
+    // The camera in the space of the bounds, through the inverse of the 3x3 part. Back facing
+    // is preserved by any affine transform that does not mirror.
+    const float* m = xform;
+    const float adjugate[9] = {
+        m[5] * m[10] - m[6] * m[9], m[2] * m[9] - m[1] * m[10], m[1] * m[6] - m[2] * m[5],
+        m[6] * m[8] - m[4] * m[10], m[0] * m[10] - m[2] * m[8], m[2] * m[4] - m[0] * m[6],
+        m[4] * m[9] - m[5] * m[8], m[1] * m[8] - m[0] * m[9], m[0] * m[5] - m[1] * m[4] };
+    const float determinant = m[0] * adjugate[0] + m[1] * adjugate[3] + m[2] * adjugate[6];
+    cullBackFacing &= determinant > 0.0f;
+
+    float camera[3] = {};
+    if (cullBackFacing)
+    {
+        const float relative[3] = {
+            view.cameraPosition[0] - m[3], view.cameraPosition[1] - m[7], view.cameraPosition[2] - m[11] };
+        for (int k = 0; k < 3; ++k)
+        {
+            camera[k] = (adjugate[k * 3] * relative[0] + adjugate[k * 3 + 1] * relative[1] +
+                adjugate[k * 3 + 2] * relative[2]) / determinant;
+        }
+    }
+
+    uint32_t numVisible = 0;
+    uint32_t frustumCulled = 0;
+    uint32_t backFacing = 0;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const Meshlet& meshlet = meshlets[i];
+        const float* center = meshlet.bounds;
+        const float radius = meshlet.bounds[3];
+
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; ++p)
+        {
+            const float* plane = planes[p];
+            inside = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3] + radius * plane[4] >= 0.0f;
+        }
+
+        if (!inside)
+        {
+            ++frustumCulled;
+            continue;
+        }
+
+        // Every point of the sphere is seen within the spread of the cone from behind when
+        // the angle to the center plus the angle the sphere subtends stays below 90 degrees
+        // minus the cone angle. This checks a slightly stronger condition without the trig:
+        // cos(angle to center) >= sin(cone angle) + sin(subtended angle).
+        if (cullBackFacing && meshlet.cone[3] < 1.0f)
+        {
+            const float d[3] = { center[0] - camera[0], center[1] - camera[1], center[2] - camera[2] };
+            const float distance = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+            const float along = d[0] * meshlet.cone[0] + d[1] * meshlet.cone[1] + d[2] * meshlet.cone[2];
+
+            if (along >= meshlet.cone[3] * distance + radius)
+            {
+                ++backFacing;
+                continue;
+            }
+        }
+
+        visible[numVisible++] = i;
+    }
+
+    if (stats != nullptr)
+    {
+        stats->tested += count;
+        stats->frustumCulled += frustumCulled;
+        stats->backFacing += backFacing;
+    }
+
+    return numVisible;
+}
+
+uint32_t Meshlets::MergeRanges(const Meshlet* meshlets, const uint32_t* visible, uint32_t numVisible, IndexRange* ranges)
+{
+    uint32_t numRanges = 0;
+
+    for (uint32_t v = 0; v < numVisible; ++v)
+    {
+        const Meshlet& meshlet = meshlets[visible[v]];
+        if (numRanges > 0 && ranges[numRanges - 1].startIndex + ranges[numRanges - 1].indexCount == meshlet.startIndex)
+        {
+            ranges[numRanges - 1].indexCount += meshlet.primCount;
+        }
+        else
+        {
+            ranges[numRanges].startIndex = meshlet.startIndex;
+            ranges[numRanges].indexCount = meshlet.primCount;
+            ++numRanges;
+        }
+    }
+
+    return numRanges;
+}
@@ -0,0 +1,96 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//
+// Meshlets split the triangles of a draw into small clusters that can be culled on their own.
+//
+// A meshlet is a run of consecutive triangles in the draw's index buffer, so the vertex cache
+// order chosen by OptimizeMesh is kept, and visible meshlets that are next to each other can
+// be drawn with one DrawIndexed. Meshlets are closed as soon as the next triangle would go
+// over the vertex or triangle limit, which keeps them within what a mesh shader could consume.
+//
+// Each meshlet has a bounding sphere for frustum culling and a normal cone for back face
+// culling (see Cull). A meshlet whose triangles face too many directions, or that belongs to
+// a two-sided material, gets a cone that never culls.
+//
+namespace Meshlets
+{
+    static const uint32_t kDefaultMaxVertices = 64;
+    static const uint32_t kDefaultMaxTriangles = 124;
+
+    // Stored in .mini files, 48 bytes
+    struct Meshlet
+    {
+        float    bounds[4];     // Bounding sphere, in the same space as Mesh::bounds
+        float    cone[4];       // Normal cone axis and sine of its spread, 1 when never back facing
+        uint32_t startIndex;    // Offset to first index, relative to the draw's startIndex
+        uint32_t primCount;     // Number of indices = 3 * number of triangles
+        uint32_t vertexCount;   // Distinct vertices used
+        uint32_t reserved;
+    };
+
+    // Appends the meshlets of a triangle list to 'meshlets' and returns how many were added.
+    // 'positions' points to the first float3 position, 'positionStride' bytes apart. Every
+    // index must be less than 'vertexCount'. Cones are only computed with 'computeCones'.
+    uint32_t Build(const uint32_t* indices, size_t indexCount, const float* positions, uint32_t vertexCount,
+        uint32_t positionStride, uint32_t maxVertices, uint32_t maxTriangles, bool computeCones,
+        std::vector<Meshlet>& meshlets);
+
+    // Planes and camera are in the space that Cull's 'xform' maps the meshlet bounds to
+    struct CullView
+    {
+        float planes[6][4];         // Inside where dot(plane.xyz, p) + plane.w >= 0
+        float cameraPosition[3];
+    };
+
+    struct CullStats
+    {
+        uint32_t tested = 0;
+        uint32_t frustumCulled = 0;
+        uint32_t backFacing = 0;
+    };
+
+    // A range of indices to draw, relative to the draw's startIndex
+    struct IndexRange
+    {
+        uint32_t startIndex;
+        uint32_t indexCount;
+    };
+
+    // Writes the indices of the meshlets that may be visible to 'visible' and returns how many.
+    // 'xform' is the affine transform from the space of the bounds to that of the view, as the
+    // rows of a 3x4 matrix, and may rotate, scale and shear. The planes and camera are moved
+    // into the space of the bounds once, so every meshlet is tested against its own sphere and
+    // cone. Transforms that mirror skip back face culling, since they flip the winding.
+    // Statistics are added to 'stats' if given.
+    uint32_t Cull(const Meshlet* meshlets, uint32_t count, const float xform[12], const CullView& view,
+        bool cullBackFacing, uint32_t* visible, CullStats* stats = nullptr);
+
+    // Turns the output of Cull into index ranges, merging meshlets that are adjacent in the
+    // index buffer. 'ranges' needs room for 'numVisible' entries. Returns the number of ranges.
+    uint32_t MergeRanges(const Meshlet* meshlets, const uint32_t* visible, uint32_t numVisible, IndexRange* ranges);
+}
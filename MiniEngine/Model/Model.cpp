@@ -14,19 +14,157 @@
 #include "Model.h"
 #include "Renderer.h"
 #include "ConstantBuffers.h"
+#include "../Core/GraphicsCommon.h"
+#include "../Core/Math/SphereCulling.h"
+#include "../Core/WorkerPool.h"
+#include <thread>
 
 using namespace Math;
 using namespace Renderer;
 
+namespace
+{
+    BoolVar s_ParallelCulling("Renderer/Parallel Culling", true);
+    BoolVar s_ParallelSceneUpdate("Renderer/Parallel Scene Update", true);
+
+    // Below this many meshes per thread, handing them to the worker pool costs more than it saves
+    const uint32_t kMinMeshesPerCullThread = 4096;
+
+    // Below this many scene graph nodes in one level, or skeleton joints, per thread, starting
+    // threads costs more than it saves
+    const uint32_t kMinNodesPerUpdateThread = 1024;
+
+    // Scratch space reused across calls to avoid per-frame allocations
+    struct CullScratch
+    {
+        std::vector<const Mesh*> meshes;
+        std::vector<XMFLOAT4> spheres;
+        std::vector<XMFLOAT4> xforms;
+        std::vector<uint32_t> visible;
+        std::vector<float> distances;
+    };
+}
+
 void Model::Destroy()
 {
+    for (uint16_t table : m_TextureTables)
+        Renderer::s_TextureHeap.Free(Renderer::s_TextureHeap[table], kNumTextures);
+    m_TextureTables.clear();
+    m_MaterialTextures.clear();
+    m_TextureVersions.clear();
+
     m_BoundingSphere = BoundingSphere(kZero);
     m_DataBuffer.Destroy();
     m_MaterialConstants.Destroy();
     m_NumNodes = 0;
     m_NumMeshes = 0;
+    m_NumAnimations = 0;
+    m_NumJoints = 0;
+    m_NumMeshlets = 0;
+    m_NumMorphWeights = 0;
     m_MeshData = nullptr;
     m_SceneGraph = nullptr;
+    m_KeyFrameData = nullptr;
+    m_CurveData = nullptr;
+    m_Animations = nullptr;
+    m_JointIndices = nullptr;
+    m_JointIBMs = nullptr;
+    m_Meshlets = nullptr;
+    m_FileView = nullptr;
+    m_UpdateSchedule = SceneGraphSchedule::Schedule();
+    m_AnimationPlans.clear();
+}
+
+void Model::CopyTextureTable(uint32_t material, const DescriptorHandle& table) const
+{
+    static const eDefaultTexture kDefaultTextures[kNumTextures] =
+    {
+        kWhiteOpaque2D,
+        kWhiteOpaque2D,
+        kWhiteOpaque2D,
+        kBlackTransparent2D,
+        kDefaultNormalMap
+    };
+
+    uint32_t DestCount = kNumTextures;
+    uint32_t SourceCounts[kNumTextures] = { 1, 1, 1, 1, 1 };
+
+    D3D12_CPU_DESCRIPTOR_HANDLE SourceTextures[kNumTextures];
+    for (uint32_t j = 0; j < kNumTextures; ++j)
+    {
+        uint16_t textureIdx = m_MaterialTextures[material * kNumTextures + j];
+        if (textureIdx == 0xffff)
+            SourceTextures[j] = Graphics::GetDefaultTexture(kDefaultTextures[j]);
+        else
+            SourceTextures[j] = textures[textureIdx].GetSRV();
+    }
+
+    Graphics::g_Device->CopyDescriptors(1, &table, &DestCount,
+        DestCount, SourceTextures, SourceCounts, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+static uint32_t GetTextureVersion(const TextureRef& texture)
+{
+    const Texture* tex = texture.Get();
+    return tex != nullptr ? tex->GetVersionID() : 0;
+}
+
+void Model::RecordTextureVersions() const
+{
+    m_TextureGeneration = TextureManager::GetStreamingGeneration();
+    m_TextureVersions.resize(textures.size());
+    for (size_t ti = 0; ti < textures.size(); ++ti)
+        m_TextureVersions[ti] = GetTextureVersion(textures[ti]);
+}
+
+void Model::RefreshTextureTables() const
+{
+    const uint32_t generation = TextureManager::GetStreamingGeneration();
+    if (generation == m_TextureGeneration)
+        return;
+
+    m_TextureGeneration = generation;
+
+    std::vector<bool> changed(textures.size());
+    bool anyChanged = false;
+    for (size_t ti = 0; ti < textures.size(); ++ti)
+    {
+        uint32_t version = GetTextureVersion(textures[ti]);
+        changed[ti] = version != m_TextureVersions[ti];
+        m_TextureVersions[ti] = version;
+        anyChanged |= changed[ti];
+    }
+
+    if (!anyChanged)
+        return;
+
+    // Tables may still be in use by frames in flight, so each changed one moves to a new table
+    // and the old one is freed once the GPU is done with it
+    for (uint32_t matIdx = 0; matIdx < (uint32_t)m_TextureTables.size(); ++matIdx)
+    {
+        bool materialChanged = false;
+        for (uint32_t j = 0; j < kNumTextures; ++j)
+        {
+            uint16_t textureIdx = m_MaterialTextures[matIdx * kNumTextures + j];
+            materialChanged |= textureIdx != 0xffff && changed[textureIdx];
+        }
+
+        if (!materialChanged)
+            continue;
+
+        DescriptorHandle TextureHandles = Renderer::s_TextureHeap.Alloc(kNumTextures);
+        CopyTextureTable(matIdx, TextureHandles);
+        Renderer::s_TextureHeap.Free(Renderer::s_TextureHeap[m_TextureTables[matIdx]], kNumTextures);
+        m_TextureTables[matIdx] = (uint16_t)Renderer::s_TextureHeap.GetOffsetOfHandle(TextureHandles);
+    }
+
+    uint8_t* pMesh = m_MeshData;
+    for (uint32_t i = 0; i < m_NumMeshes; ++i)
+    {
+        Mesh& mesh = *(Mesh*)pMesh;
+        mesh.srvTable = m_TextureTables[mesh.materialCBV];
+        pMesh += sizeof(Mesh) + (mesh.numDraws - 1) * sizeof(Mesh::Draw);
+    }
 }
 
 void Model::Render(
@@ -35,32 +173,109 @@ void Model::Render(
     const ScaleAndTranslation sphereTransforms[],
     const Joint* skeleton ) const
 {
-    // Pointer to current mesh
-    const uint8_t* pMesh = m_MeshData.get();
+    static thread_local CullScratch scratch;
 
-    const Frustum& frustum = sorter.GetViewFrustum();
-    const AffineTransform& viewMat = (const AffineTransform&)sorter.GetViewMatrix();
+    RefreshTextureTables();
+
+    scratch.meshes.resize(m_NumMeshes);
+    scratch.spheres.resize(m_NumMeshes);
+    scratch.xforms.resize(m_NumMeshes);
+    scratch.visible.resize(m_NumMeshes);
+    scratch.distances.resize(m_NumMeshes);
 
+    // Mesh records are variable sized, so gather their bounds into arrays first
+    const uint8_t* pMesh = m_MeshData;
     for (uint32_t i = 0; i < m_NumMeshes; ++i)
     {
         const Mesh& mesh = *(const Mesh*)pMesh;
+        scratch.meshes[i] = &mesh;
+        scratch.spheres[i] = *(const XMFLOAT4*)mesh.bounds;
+        XMStoreFloat4(&scratch.xforms[i], XMVECTOR(Vector4(sphereTransforms[mesh.meshCBV].GetTranslation(),
+            sphereTransforms[mesh.meshCBV].GetScale())));
 
-        const ScaleAndTranslation& sphereXform = sphereTransforms[mesh.meshCBV];
-        BoundingSphere sphereLS((const XMFLOAT4*)mesh.bounds);
-        BoundingSphere sphereWS = sphereXform * sphereLS;
-        BoundingSphere sphereVS = BoundingSphere(viewMat * sphereWS.GetCenter(), sphereWS.GetRadius());
+        pMesh += sizeof(Mesh) + (mesh.numDraws - 1) * sizeof(Mesh::Draw);
+    }
+
+    SphereCulling::ViewTransform view;
+    const Matrix4& viewMat = sorter.GetViewMatrix();
+    XMStoreFloat4((XMFLOAT4*)view.Columns[0], viewMat.GetX());
+    XMStoreFloat4((XMFLOAT4*)view.Columns[1], viewMat.GetY());
+    XMStoreFloat4((XMFLOAT4*)view.Columns[2], viewMat.GetZ());
+    XMStoreFloat4((XMFLOAT4*)view.Columns[3], viewMat.GetW());
+
+    SphereCulling::FrustumPlanes planes;
+    const Frustum& frustum = sorter.GetViewFrustum();
+    for (int p = 0; p < 6; ++p)
+        XMStoreFloat4((XMFLOAT4*)planes.Planes[p], XMVECTOR(Vector4(frustum.GetFrustumPlane((Frustum::PlaneID)p))));
+
+    // The scratch space belongs to this thread, so pool threads only see it through these
+    const float (*spheres)[4] = (const float (*)[4])scratch.spheres.data();
+    const float (*xforms)[4] = (const float (*)[4])scratch.xforms.data();
+    uint32_t* visible = scratch.visible.data();
+    float* distances = scratch.distances.data();
+    const bool cullEnabled = sorter.IsCullEnabled();
+
+    uint32_t numThreads = 1;
+    if (s_ParallelCulling)
+        numThreads = std::min(WorkerPool::GetNumThreads(), m_NumMeshes / kMinMeshesPerCullThread);
+
+    uint32_t numVisible = 0;
+    if (numThreads <= 1)
+    {
+        numVisible = SphereCulling::TransformAndCull(spheres, xforms, m_NumMeshes, view, planes, cullEnabled,
+            0, visible, distances);
+    }
+    else
+    {
+        // Each task culls a contiguous range, then the visible lists are packed in order so
+        // that meshes reach the sorter in the same order as with a single thread
+        std::vector<uint32_t> rangeVisible(numThreads);
 
-        //if (frustum.IntersectSphere(sphereVS))
-        if (!sorter.IsCullEnabled() || frustum.IntersectSphere(sphereVS))
+        WorkerPool::Run(numThreads, [&](uint32_t t)
         {
-            float distance = -sphereVS.GetCenter().GetZ() - sphereVS.GetRadius();
-            sorter.AddMesh(mesh, distance,
-                meshConstants.GetGpuVirtualAddress() + sizeof(MeshConstants) * mesh.meshCBV,
-                m_MaterialConstants.GetGpuVirtualAddress() + sizeof(MaterialConstants) * mesh.materialCBV,
-                m_DataBuffer.GetGpuVirtualAddress(), skeleton);
+            uint32_t start = (uint32_t)((uint64_t)m_NumMeshes * t / numThreads);
+            uint32_t end = (uint32_t)((uint64_t)m_NumMeshes * (t + 1) / numThreads);
+            rangeVisible[t] = SphereCulling::TransformAndCull(spheres + start, xforms + start, end - start,
+                view, planes, cullEnabled, start, visible + start, distances + start);
+        });
+
+        for (uint32_t t = 0; t < numThreads; ++t)
+        {
+            uint32_t start = (uint32_t)((uint64_t)m_NumMeshes * t / numThreads);
+            std::copy_n(visible + start, rangeVisible[t], visible + numVisible);
+            numVisible += rangeVisible[t];
         }
+    }
 
-        pMesh += sizeof(Mesh) + (mesh.numDraws - 1) * sizeof(Mesh::Draw);
+    // Streamed textures load the mips for the screen area of the meshes using them, estimated
+    // from the projected bounding sphere
+    const bool hintCoverage = sorter.GetBatchType() == MeshSorter::kDefault && TextureManager::IsStreamingEnabled();
+    const float pixelsPerUnit = (float)sorter.GetProjMatrix().GetY().GetY() * sorter.GetViewport().Height * 0.5f;
+
+    for (uint32_t v = 0; v < numVisible; ++v)
+    {
+        const uint32_t i = visible[v];
+        const Mesh& mesh = *scratch.meshes[i];
+
+        if (hintCoverage)
+        {
+            const float radius = spheres[i][3] * xforms[i][3];
+            const float depth = std::max(distances[i] + radius, radius);
+            const float projectedRadius = radius * pixelsPerUnit / depth;
+            const float pixels = XM_PI * projectedRadius * projectedRadius;
+
+            for (uint32_t j = 0; j < kNumTextures; ++j)
+            {
+                uint16_t textureIdx = m_MaterialTextures[mesh.materialCBV * kNumTextures + j];
+                if (textureIdx != 0xffff)
+                    textures[textureIdx].SetCoverageHint(pixels);
+            }
+        }
+
+        sorter.AddMesh(mesh, distances[i],
+            meshConstants.GetGpuVirtualAddress() + sizeof(MeshConstants) * mesh.meshCBV,
+            m_MaterialConstants.GetGpuVirtualAddress() + sizeof(MaterialConstants) * mesh.materialCBV,
+            m_DataBuffer.GetGpuVirtualAddress(), skeleton);
     }
 }
 
@@ -82,28 +297,40 @@ ModelInstance::ModelInstance( std::shared_ptr<const Model> sourceModel )
     {
         m_MeshConstantsCPU.Destroy();
         m_MeshConstantsGPU.Destroy();
+        m_MeshConstantsCache = nullptr;
         m_BoundingSphereTransforms = nullptr;
         m_AnimGraph = nullptr;
         m_AnimState.clear();
+        m_AnimSamples.clear();
+        m_MorphWeights.clear();
         m_Skeleton = nullptr;
     }
     else
     {
         m_MeshConstantsCPU.Create(L"Mesh Constant Upload Buffer", sourceModel->m_NumNodes * sizeof(MeshConstants));
         m_MeshConstantsGPU.Create(L"Mesh Constant GPU Buffer", sourceModel->m_NumNodes, sizeof(MeshConstants));
+        m_MeshConstantsCache.reset(new MeshConstants[sourceModel->m_NumNodes]);
         m_BoundingSphereTransforms.reset(new __m128[sourceModel->m_NumNodes]);
         m_Skeleton.reset(new Joint[sourceModel->m_NumJoints]);
 
         if (sourceModel->m_NumAnimations > 0)
         {
             m_AnimGraph.reset(new GraphNode[sourceModel->m_NumNodes]);
-            std::memcpy(m_AnimGraph.get(), sourceModel->m_SceneGraph.get(), sourceModel->m_NumNodes * sizeof(GraphNode));
+            std::memcpy(m_AnimGraph.get(), sourceModel->m_SceneGraph, sourceModel->m_NumNodes * sizeof(GraphNode));
             m_AnimState.resize(sourceModel->m_NumAnimations);
+
+            uint32_t maxSamples = 0;
+            for (const AnimationSampling::Plan& plan : sourceModel->m_AnimationPlans)
+                maxSamples = std::max(maxSamples, plan.OutputSize);
+            m_AnimSamples.resize(maxSamples);
+            m_MorphWeights.assign(sourceModel->m_NumMorphWeights, 0.0f);
         }
         else
         {
             m_AnimGraph = nullptr;
             m_AnimState.clear();
+            m_AnimSamples.clear();
+            m_MorphWeights.clear();
         }
     }
 }
@@ -121,28 +348,40 @@ ModelInstance& ModelInstance::operator=( std::shared_ptr<const Model> sourceMode
     {
         m_MeshConstantsCPU.Destroy();
         m_MeshConstantsGPU.Destroy();
+        m_MeshConstantsCache = nullptr;
         m_BoundingSphereTransforms = nullptr;
         m_AnimGraph = nullptr;
         m_AnimState.clear();
+        m_AnimSamples.clear();
+        m_MorphWeights.clear();
         m_Skeleton = nullptr;
     }
     else
     {
         m_MeshConstantsCPU.Create(L"Mesh Constant Upload Buffer", sourceModel->m_NumNodes * sizeof(MeshConstants));
         m_MeshConstantsGPU.Create(L"Mesh Constant GPU Buffer", sourceModel->m_NumNodes, sizeof(MeshConstants));
+        m_MeshConstantsCache.reset(new MeshConstants[sourceModel->m_NumNodes]);
         m_BoundingSphereTransforms.reset(new __m128[sourceModel->m_NumNodes]);
         m_Skeleton.reset(new Joint[sourceModel->m_NumJoints]);
 
         if (sourceModel->m_NumAnimations > 0)
         {
             m_AnimGraph.reset(new GraphNode[sourceModel->m_NumNodes]);
-            std::memcpy(m_AnimGraph.get(), sourceModel->m_SceneGraph.get(), sourceModel->m_NumNodes * sizeof(GraphNode));
+            std::memcpy(m_AnimGraph.get(), sourceModel->m_SceneGraph, sourceModel->m_NumNodes * sizeof(GraphNode));
             m_AnimState.resize(sourceModel->m_NumAnimations);
+
+            uint32_t maxSamples = 0;
+            for (const AnimationSampling::Plan& plan : sourceModel->m_AnimationPlans)
+                maxSamples = std::max(maxSamples, plan.OutputSize);
+            m_AnimSamples.resize(maxSamples);
+            m_MorphWeights.assign(sourceModel->m_NumMorphWeights, 0.0f);
         }
         else
         {
             m_AnimGraph = nullptr;
             m_AnimState.clear();
+            m_AnimSamples.clear();
+            m_MorphWeights.clear();
         }
     }
     return *this;
@@ -153,47 +392,44 @@ void ModelInstance::Update(GraphicsContext& gfxContext, float deltaTime)
     if (m_Model == nullptr)
         return;
 
-    static const size_t kMaxStackDepth = 32;
+    if (m_AnimGraph)
+        UpdateAnimations(deltaTime);
 
-    size_t stackIdx = 0;
-    Matrix4 matrixStack[kMaxStackDepth];
-    Matrix4 ParentMatrix = Matrix4((AffineTransform)m_Locator);
+    const Matrix4 locatorMatrix = Matrix4((AffineTransform)m_Locator);
+    const SceneGraphSchedule::Schedule& schedule = m_Model->m_UpdateSchedule;
+    const uint32_t* parents = schedule.Parents.data();
 
+    GraphNode* animGraph = m_AnimGraph.get();
+    const GraphNode* sceneGraph = animGraph ? animGraph : m_Model->m_SceneGraph;
     ScaleAndTranslation* boundingSphereTransforms = (ScaleAndTranslation*)m_BoundingSphereTransforms.get();
-    MeshConstants* cb = (MeshConstants*)m_MeshConstantsCPU.Map();
+    MeshConstants* cache = m_MeshConstantsCache.get();
 
-    if (m_AnimGraph)
+    // Parents are a level above, so their world matrices are final by the time a node is
+    // visited. Every node writes only its own entries.
+    auto updateNodes = [&](const uint32_t* nodes, uint32_t count)
     {
-        UpdateAnimations(deltaTime);
-
-        for (uint32_t i = 0; i < m_Model->m_NumNodes; ++i)
+        for (uint32_t n = 0; n < count; ++n)
         {
-            GraphNode& node = m_AnimGraph[i];
+            const uint32_t nodeIdx = nodes[n];
 
             // Regenerate the 3x3 matrix if it has scale or rotation
-            if (node.staleMatrix)
+            if (animGraph != nullptr && animGraph[nodeIdx].staleMatrix)
             {
+                GraphNode& node = animGraph[nodeIdx];
                 node.staleMatrix = false;
                 node.xform.Set3x3(Matrix3(node.rotation) * Matrix3::MakeScale(node.scale));
             }
-        }
-    }
 
-    const GraphNode* sceneGraph = m_AnimGraph ? m_AnimGraph.get() : m_Model->m_SceneGraph.get();
+            const GraphNode& Node = sceneGraph[nodeIdx];
+            const uint32_t parentIdx = parents[nodeIdx];
+            const Matrix4& ParentMatrix = parentIdx == SceneGraphSchedule::kNoParent ?
+                locatorMatrix : cache[sceneGraph[parentIdx].matrixIdx].World;
 
-    // Traverse the scene graph in depth first order.  This is the same as linear order
-    // for how the nodes are stored in memory.  Uses a matrix stack instead of recursion.
-    for (const GraphNode* Node = sceneGraph; ; ++Node)
-    {
-        Matrix4 xform = Node->xform;
-        if (!Node->skeletonRoot)
-            xform = ParentMatrix * xform;
+            Matrix4 xform = Node.xform;
+            if (!Node.skeletonRoot)
+                xform = ParentMatrix * xform;
 
-        // Concatenate the transform with the parent's matrix and update the matrix list
-        {
-            // Scoped so that I don't forget that I'm pointing to write-combined memory and
-            // should not read from it.
-            MeshConstants& cbv = cb[Node->matrixIdx];
+            MeshConstants& cbv = cache[Node.matrixIdx];
             cbv.World = xform;
             cbv.WorldIT = InverseTranspose(xform.Get3x3());
 
@@ -201,39 +437,31 @@ void ModelInstance::Update(GraphicsContext& gfxContext, float deltaTime)
             Scalar scaleYSqr = LengthSquare((Vector3)ParentMatrix.GetY());
             Scalar scaleZSqr = LengthSquare((Vector3)ParentMatrix.GetZ());
             Scalar sphereScale = Sqrt(Max(Max(scaleXSqr, scaleYSqr), scaleZSqr));
-            boundingSphereTransforms[Node->matrixIdx] = ScaleAndTranslation((Vector3)ParentMatrix.GetW(), sphereScale);
+            boundingSphereTransforms[Node.matrixIdx] = ScaleAndTranslation((Vector3)ParentMatrix.GetW(), sphereScale);
         }
+    };
 
-        // If the next node will be a descendent, replace the parent matrix with our new matrix
-        if (Node->hasChildren)
+    // Update skeletal joints
+    auto updateJoints = [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
         {
-            // ...but if we have siblings, make sure to backup our current parent matrix on the stack
-            if (Node->hasSibling)
-            {
-                ASSERT(stackIdx < kMaxStackDepth, "Overflowed the matrix stack");
-                matrixStack[stackIdx++] = ParentMatrix;
-            }
-            ParentMatrix = xform;
+            Joint& joint = m_Skeleton[i];
+            joint.posXform = cache[m_Model->m_JointIndices[i]].World * m_Model->m_JointIBMs[i];
+            joint.nrmXform = InverseTranspose(joint.posXform.Get3x3());
         }
-        else if (!Node->hasSibling)
-        {
-            // There are no more siblings.  If the stack is empty, we are done.  Otherwise, pop
-            // a matrix off the stack and continue.
-            if (stackIdx == 0)
-                break;
+    };
 
-            ParentMatrix = matrixStack[--stackIdx];
-        }
-    }
+    uint32_t numThreads = 1;
+    if (s_ParallelSceneUpdate)
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
 
-    // Update skeletal joints
-    for (uint32_t i = 0; i < m_Model->m_NumJoints; ++i)
-    {
-        Joint& joint = m_Skeleton[i];
-        joint.posXform = cb[m_Model->m_JointIndices[i]].World * m_Model->m_JointIBMs[i];
-        joint.nrmXform = InverseTranspose(joint.posXform.Get3x3());
-    }
+    SceneGraphSchedule::Execute(schedule, numThreads, kMinNodesPerUpdateThread,
+        updateNodes, m_Model->m_NumJoints, updateJoints);
 
+    // Write-combined memory is written front to back in one pass and never read
+    MeshConstants* cb = (MeshConstants*)m_MeshConstantsCPU.Map();
+    std::memcpy(cb, cache, m_Model->m_NumNodes * sizeof(MeshConstants));
     m_MeshConstantsCPU.Unmap();
 
     gfxContext.TransitionResource(m_MeshConstantsGPU, D3D12_RESOURCE_STATE_COPY_DEST, true);
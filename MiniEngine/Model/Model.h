@@ -14,6 +14,7 @@
 #pragma once
 
 #include "Animation.h"
+#include "AnimationSampling.h"
 #include "../Core/GpuBuffer.h"
 #include "../Core/VectorMath.h"
 #include "../Core/Camera.h"
@@ -22,6 +23,11 @@
 #include "../Core/TextureManager.h"
 #include "../Core/Math/BoundingBox.h"
 #include "../Core/Math/BoundingSphere.h"
+#include "ModelFile.h"
+#include "ConstantBuffers.h"
+#include "SceneGraphSchedule.h"
+#include "Meshlets.h"
+#include "VertexQuantization.h"
 #include <cstdint>
 
 namespace Renderer
@@ -46,6 +52,8 @@ namespace PSOFlags
         kAlphaTest      = 0x040,
         kTwoSided       = 0x080,
         kHasSkin        = 0x100,  // Implies having indices and weights
+        kQuantized      = 0x200,  // 16-bit positions and UVs, octahedral normals and tangents
+        kCompactNormals = 0x400,  // 8-bit octahedral normals and tangents (with kQuantized)
     };
 }
 
@@ -58,6 +66,8 @@ struct Mesh
     uint32_t vbDepthSize;   // SizeInBytes
     uint32_t ibOffset;      // BufferLocation - Buffer.GpuVirtualAddress
     uint32_t ibSize;        // SizeInBytes
+    uint32_t ibDepthOffset; // BufferLocation - Buffer.GpuVirtualAddress
+    uint32_t ibDepthSize;   // SizeInBytes
     uint8_t  vbStride;      // StrideInBytes
     uint8_t  ibFormat;      // DXGI_FORMAT
     uint16_t meshCBV;       // Index of mesh constant buffer
@@ -75,6 +85,12 @@ struct Mesh
         uint32_t primCount;   // Number of indices = 3 * number of triangles
         uint32_t startIndex;  // Offset to first index in index buffer 
         uint32_t baseVertex;  // Offset to first vertex in vertex buffer
+        uint32_t startMeshlet; // Index of first meshlet in Model::m_Meshlets
+        uint32_t numMeshlets;  // Zero when the model was built without meshlets
+        uint32_t depthPrimCount;  // Like primCount, in the depth-only index buffer
+        uint32_t depthStartIndex; // Offset to first index in depth-only index buffer
+        uint32_t depthBaseVertex; // Offset to first vertex in depth-only vertex buffer
+        VertexQuantization::Dequantization dequantization; // Used with PSOFlags::kQuantized
     };
     Draw draw[1];           // Actually 1 or more draws
 };
@@ -117,17 +133,42 @@ public:
     uint32_t m_NumMeshes;
     uint32_t m_NumAnimations;
     uint32_t m_NumJoints;
-    std::unique_ptr<uint8_t[]> m_MeshData;
-    std::unique_ptr<GraphNode[]> m_SceneGraph;
+    uint32_t m_NumMeshlets;
+    uint32_t m_NumMorphWeights;             // Animated morph target weights of all nodes
     std::vector<TextureRef> textures;
-    std::unique_ptr<uint8_t[]> m_KeyFrameData;
-    std::unique_ptr<AnimationCurve[]> m_CurveData;
-    std::unique_ptr<AnimationSet[]> m_Animations;
-    std::unique_ptr<uint16_t[]> m_JointIndices;
-    std::unique_ptr<Math::Matrix4[]> m_JointIBMs;
+    std::vector<uint16_t> m_MaterialTextures;       // kNumTextures indices into 'textures' per material, 0xffff for defaults
+    mutable std::vector<uint16_t> m_TextureTables;  // One SRV table per material in Renderer::s_TextureHeap
+
+    // Streamed textures change their SRVs, so the tables are rebuilt when the versions change
+    mutable std::vector<uint32_t> m_TextureVersions;
+    mutable uint32_t m_TextureGeneration;
+
+    // These point directly into the memory mapped .mini file owned by m_FileView
+    uint8_t* m_MeshData;
+    const GraphNode* m_SceneGraph;
+    const uint8_t* m_KeyFrameData;
+    const AnimationCurve* m_CurveData;
+    const AnimationSet* m_Animations;
+    const uint16_t* m_JointIndices;
+    const Math::Matrix4* m_JointIBMs;
+    const Meshlets::Meshlet* m_Meshlets;
+    std::unique_ptr<Renderer::MiniFileView> m_FileView;
+
+    // Level order of m_SceneGraph for ModelInstance::Update
+    SceneGraphSchedule::Schedule m_UpdateSchedule;
+
+    // Per animation, the curves grouped by key frame times for ModelInstance::UpdateAnimations
+    std::vector<AnimationSampling::Plan> m_AnimationPlans;
+
+    // Copies the SRVs of a material's textures to 'table'
+    void CopyTextureTable(uint32_t material, const DescriptorHandle& table) const;
+
+    // Records the versions of 'textures' before their SRVs are copied to the tables
+    void RecordTextureVersions() const;
 
 protected:
     void Destroy();
+    void RefreshTextureTables() const;
 };
 
 class ModelInstance
@@ -164,14 +205,20 @@ public:
 
     const Model* GetModel() const { return m_Model.get(); }
 
+    // Indexed by AnimationCurve::firstWeight. Zero until an animation sets them.
+    const std::vector<float>& GetMorphWeights() const { return m_MorphWeights; }
+
 private:
     std::shared_ptr<const Model> m_Model;
     UploadBuffer m_MeshConstantsCPU;
     ByteAddressBuffer m_MeshConstantsGPU;
+    std::unique_ptr<MeshConstants[]> m_MeshConstantsCache;  // Built in cached memory, then streamed to m_MeshConstantsCPU
     std::unique_ptr<__m128[]> m_BoundingSphereTransforms;
     Math::UniformTransform m_Locator;
 
     std::unique_ptr<GraphNode[]> m_AnimGraph;   // A copy of the scene graph when instancing animation
     std::vector<AnimationState> m_AnimState;    // Per-animation (not per-curve)
+    std::vector<float> m_AnimSamples;           // Curve values of the animation being applied
+    std::vector<float> m_MorphWeights;
     std::unique_ptr<Joint[]> m_Skeleton;
 };
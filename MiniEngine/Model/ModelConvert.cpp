@@ -45,11 +45,13 @@ static inline Vector3 SafeNormalize(Vector3 x)
 void Renderer::CompileMesh(
     std::vector<Mesh*>& meshList,
     std::vector<byte>& bufferMemory,
+    std::vector<Meshlets::Meshlet>& meshletList,
     glTF::Mesh& srcMesh,
     uint32_t matrixIdx,
     const Matrix4& localToObject,
     BoundingSphere& boundingSphere,
-    AxisAlignedBox& boundingBox
+    AxisAlignedBox& boundingBox,
+    const MeshBuildSettings& buildSettings
     )
 {
     // We still have a lot of work to do.  Now that we know about all of the primitives in this mesh
@@ -67,7 +69,7 @@ void Renderer::CompileMesh(
     std::vector<Primitive> primitives(srcMesh.primitives.size());
     for (uint32_t i = 0; i < primitives.size(); ++i)
     {
-        OptimizeMesh(primitives[i], srcMesh.primitives[i], localToObject);
+        OptimizeMesh(primitives[i], srcMesh.primitives[i], localToObject, buildSettings);
         sphereOS = sphereOS.Union(primitives[i].m_BoundsOS);
         bboxOS.AddBoundingBox(primitives[i].m_BBoxOS);
     }
@@ -88,13 +90,15 @@ void Renderer::CompileMesh(
     for (auto& iter : renderMeshes)
     {
         uint32_t meshIndexSize = 0;
+        uint32_t meshDepthIndexSize = 0;
         // for each sub-mesh (a draw)
         for (auto& draw : iter.second)
         {
             meshIndexSize += (uint32_t)draw->IB->size();
+            meshDepthIndexSize += (uint32_t)draw->DepthIB->size();
         }
 
-        totalIndexSize += Math::AlignUp(meshIndexSize, 4);
+        totalIndexSize += Math::AlignUp(meshIndexSize, 4) + Math::AlignUp(meshDepthIndexSize, 4);
     }
 
     uint32_t totalBufferSize = (uint32_t)Math::AlignUp(totalVertexSize + totalDepthVertexSize, 4) + (uint32_t)totalIndexSize;
@@ -115,6 +119,7 @@ void Renderer::CompileMesh(
         size_t vbSize = 0;
         size_t vbDepthSize = 0;
         size_t ibSize = 0;
+        size_t ibDepthSize = 0;
 
         // Compute local space bounding sphere for all submeshes
         BoundingSphere collectiveSphere(kZero);
@@ -125,10 +130,12 @@ void Renderer::CompileMesh(
             vbSize += draw->VB->size();
             vbDepthSize += draw->DepthVB->size();
             ibSize += draw->IB->size();
+            ibDepthSize += draw->DepthIB->size();
             collectiveSphere = collectiveSphere.Union(draw->m_BoundsOS);
         }
 
         ibSize = (uint32_t)Math::AlignUp(ibSize, 4);
+        ibDepthSize = (uint32_t)Math::AlignUp(ibDepthSize, 4);
 
         mesh->bounds[0] = collectiveSphere.GetCenter().GetX();
         mesh->bounds[1] = collectiveSphere.GetCenter().GetY();
@@ -140,6 +147,8 @@ void Renderer::CompileMesh(
         mesh->vbDepthSize = (uint32_t)vbDepthSize;
         mesh->ibOffset = (uint32_t)bufferMemory.size() + curIBOffset;
         mesh->ibSize = (uint32_t)ibSize;
+        mesh->ibDepthOffset = mesh->ibOffset + (uint32_t)ibSize;
+        mesh->ibDepthSize = (uint32_t)ibDepthSize;
         mesh->vbStride = (uint8_t)iter.second[0]->vertexStride;
         mesh->ibFormat = uint8_t(iter.second[0]->index32 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT);
         mesh->meshCBV = (uint16_t)matrixIdx;
@@ -163,6 +172,7 @@ void Renderer::CompileMesh(
         uint32_t curVertOffset = 0;
         uint32_t curDepthVertOffset = 0;
         uint32_t curIndexOffset = 0;
+        uint32_t curDepthIndexOffset = 0;
 
         // for each sub-mesh (a draw)
         for (auto& draw : iter.second)
@@ -171,6 +181,13 @@ void Renderer::CompileMesh(
             d.primCount = draw->primCount;
             d.baseVertex = curVertOffset / draw->vertexStride;
             d.startIndex = curIndexOffset >> (draw->index32 + 1);
+            d.startMeshlet = (uint32_t)meshletList.size();
+            d.numMeshlets = (uint32_t)draw->meshlets.size();
+            d.depthPrimCount = draw->depthPrimCount;
+            d.depthStartIndex = curDepthIndexOffset >> (draw->index32 + 1);
+            d.depthBaseVertex = curDepthVertOffset / draw->depthVertexStride;
+            d.dequantization = draw->dequantization;
+            meshletList.insert(meshletList.end(), draw->meshlets.begin(), draw->meshlets.end());
 
             std::memcpy(uploadMem + curVBOffset + curVertOffset, draw->VB->data(), draw->VB->size());
             curVertOffset += (uint32_t)draw->VB->size();
@@ -180,11 +197,14 @@ void Renderer::CompileMesh(
 
             std::memcpy(uploadMem + curIBOffset + curIndexOffset, draw->IB->data(), draw->IB->size());
             curIndexOffset += (uint32_t)draw->IB->size();
+
+            std::memcpy(uploadMem + curIBOffset + ibSize + curDepthIndexOffset, draw->DepthIB->data(), draw->DepthIB->size());
+            curDepthIndexOffset += (uint32_t)draw->DepthIB->size();
         }
 
         curVBOffset += (uint32_t)vbSize;
         curDepthVBOffset += (uint32_t)vbDepthSize;
-        curIBOffset += (uint32_t)ibSize;
+        curIBOffset += (uint32_t)(ibSize + ibDepthSize);
 
         meshList.push_back(mesh);
     }
@@ -199,9 +219,11 @@ static uint32_t WalkGraph(
     AxisAlignedBox& modelBBox,
     std::vector<Mesh*>& meshList,
     std::vector<byte>& bufferMemory,
+    std::vector<Meshlets::Meshlet>& meshletList,
     const std::vector<glTF::Node*>& siblings,
     uint32_t curPos,
-    const Matrix4& xform
+    const Matrix4& xform,
+    const MeshBuildSettings& buildSettings
     )
 {
     size_t numSiblings = siblings.size();
@@ -239,7 +261,7 @@ static uint32_t WalkGraph(
         {
             BoundingSphere sphereOS;
             AxisAlignedBox boxOS;
-            CompileMesh(meshList, bufferMemory, *curNode->mesh, curPos, LocalXform, sphereOS, boxOS);
+            CompileMesh(meshList, bufferMemory, meshletList, *curNode->mesh, curPos, LocalXform, sphereOS, boxOS, buildSettings);
             modelBSphere = modelBSphere.Union(sphereOS);
             modelBBox.AddBoundingBox(boxOS);
         }
@@ -249,7 +271,8 @@ static uint32_t WalkGraph(
         if (curNode->children.size() > 0)
         {
             thisGraphNode.hasChildren = 1;
-            nextPos = WalkGraph(sceneGraph, modelBSphere, modelBBox, meshList, bufferMemory, curNode->children, nextPos, LocalXform);
+            nextPos = WalkGraph(sceneGraph, modelBSphere, modelBBox, meshList, bufferMemory, meshletList, curNode->children, nextPos, LocalXform,
+                buildSettings);
         }
 
         // Are there more siblings?
@@ -360,6 +383,22 @@ void BuildMaterials(ModelData& model, const glTF::Asset& asset)
     ASSERT(model.m_TextureOptions.size() == model.m_TextureNames.size());
 }
 
+// Reads one component of an animation output accessor, dequantizing normalized integers
+// Reads element 'index' of a scalar accessor, which may be strided
+static float ReadAnimationComponent(const glTF::Accessor& accessor, uint32_t index)
+{
+    const uint32_t bytesPerComponent = accessor.componentType / 2 + 1;
+    const byte* data = accessor.dataPtr + (size_t)index * (accessor.stride != 0 ? accessor.stride : bytesPerComponent);
+    switch (accessor.componentType)
+    {
+    case glTF::Accessor::kByte: return std::max(*(const int8_t*)data / 127.0f, -1.0f);
+    case glTF::Accessor::kUnsignedByte: return *(const uint8_t*)data / 255.0f;
+    case glTF::Accessor::kShort: return std::max(*(const int16_t*)data / 32767.0f, -1.0f);
+    case glTF::Accessor::kUnsignedShort: return *(const uint16_t*)data / 65535.0f;
+    default: return *(const float*)data;
+    }
+}
+
 void BuildAnimations(ModelData& model, const glTF::Asset& asset)
 {
     size_t numAnimations = asset.m_animations.size();
@@ -369,6 +408,10 @@ void BuildAnimations(ModelData& model, const glTF::Asset& asset)
     model.m_Animations.resize(numAnimations);
     uint32_t animIdx = 0;
 
+    // Every node with animated morph weights gets its own range of ModelInstance weights
+    std::map<uint32_t, std::pair<uint32_t, uint32_t>> nodeWeights;
+    uint32_t numMorphWeights = 0;
+
     for (const glTF::Animation& anim : asset.m_animations)
     {
         AnimationSet& animSet = model.m_Animations[animIdx++];
@@ -383,42 +426,77 @@ void BuildAnimations(ModelData& model, const glTF::Asset& asset)
 
             ASSERT(channel.m_target->linearIdx >= 0);
 
+            // Cubic splines store an in-tangent, the value and an out-tangent per key frame
+            const uint32_t numKeys = sampler.m_input->count;
+            const uint32_t elementsPerKey = sampler.m_interpolation == glTF::AnimSampler::kCubicSpline ? 3 : 1;
+            ASSERT(numKeys > 0);
+
             AnimationCurve curve;
             curve.targetNode = channel.m_target->linearIdx;
             curve.targetPath = channel.m_path;
             curve.interpolation = sampler.m_interpolation;
-            curve.keyFrameOffset = model.m_AnimationKeyFrameData.size();
+            curve.keyFrameOffset = (uint32_t)model.m_AnimationKeyFrameData.size();
             curve.keyFrameFormat = std::min<uint32_t>(sampler.m_output->componentType, AnimationCurve::kFloat);
-            curve.numSegments = sampler.m_output->count - 1.0f;
+            curve.firstWeight = 0;
+            curve.numSegments = numKeys - 1.0f;
 
-            // In glTF, stride==0 means "packed tightly"
-            if (sampler.m_output->stride == 0)
+            if (channel.m_path == glTF::AnimChannel::kWeights)
             {
-                uint32_t numComponents = sampler.m_output->type + 1;
-                uint32_t bytesPerComponent = sampler.m_output->componentType / 2 + 1;
-                curve.keyFrameStride = numComponents * bytesPerComponent / 4;
+                // One scalar per morph target, converted to floats so that each key frame is
+                // a whole number of words
+                const uint32_t numTargets = sampler.m_output->count / (numKeys * elementsPerKey);
+                ASSERT(numTargets > 0 && numTargets < 8192);
+
+                auto weights = nodeWeights.emplace(curve.targetNode, std::make_pair(numMorphWeights, numTargets));
+                if (weights.second)
+                    numMorphWeights += numTargets;
+                ASSERT(weights.first->second.second == numTargets, "Morph target count differs between animations");
+                ASSERT(weights.first->second.first < 0x10000);
+
+                curve.firstWeight = weights.first->second.first;
+                curve.keyFrameFormat = AnimationCurve::kFloat;
+                curve.keyFrameStride = numTargets;
+
+                for (uint32_t j = 0; j < sampler.m_output->count; ++j)
+                {
+                    const float value = ReadAnimationComponent(*sampler.m_output, j);
+                    const byte* bytes = (const byte*)&value;
+                    model.m_AnimationKeyFrameData.insert(model.m_AnimationKeyFrameData.end(), bytes, bytes + sizeof(float));
+                }
             }
             else
             {
-                ASSERT(sampler.m_output->stride <= 16 && sampler.m_output->stride % 4 == 0);
-                curve.keyFrameStride = sampler.m_output->stride / 4;
+                // In glTF, stride==0 means "packed tightly"
+                if (sampler.m_output->stride == 0)
+                {
+                    uint32_t numComponents = sampler.m_output->type + 1;
+                    uint32_t bytesPerComponent = sampler.m_output->componentType / 2 + 1;
+                    curve.keyFrameStride = numComponents * bytesPerComponent / 4;
+                }
+                else
+                {
+                    ASSERT(sampler.m_output->stride <= 16 && sampler.m_output->stride % 4 == 0);
+                    curve.keyFrameStride = sampler.m_output->stride / 4;
+                }
+
+                // Append this curve data
+                model.m_AnimationKeyFrameData.insert(
+                    model.m_AnimationKeyFrameData.end(),
+                    sampler.m_output->dataPtr,
+                    sampler.m_output->dataPtr + sampler.m_output->count * curve.keyFrameStride * 4);
             }
 
+            ASSERT(sampler.m_output->count == numKeys * elementsPerKey * (curve.targetPath == AnimationCurve::kWeights ? curve.keyFrameStride : 1));
+
             // Determine start and stop time stamps
             const float* timeStamps = (float*)sampler.m_input->dataPtr;
             curve.startTime = timeStamps[0];
 
-            const float endTime = timeStamps[sampler.m_output->count - 1];
-            curve.rangeScale = curve.numSegments / (endTime - curve.startTime);
+            const float endTime = timeStamps[numKeys - 1];
+            curve.rangeScale = endTime > curve.startTime ? curve.numSegments / (endTime - curve.startTime) : 0.0f;
 
             animSet.duration = std::max<float>(animSet.duration, endTime);
 
-            // Append this curve data
-            model.m_AnimationKeyFrameData.insert(
-                model.m_AnimationKeyFrameData.end(),
-                sampler.m_output->dataPtr,
-                sampler.m_output->dataPtr + sampler.m_output->count * curve.keyFrameStride * 4);
-
             model.m_AnimationCurves.push_back(curve);
         }
     }
@@ -466,7 +544,8 @@ void BuildSkins(ModelData& model, const glTF::Asset& asset)
     }
 }
 
-bool Renderer::BuildModel(ModelData& model, const glTF::Asset& asset, int sceneIdx)
+bool Renderer::BuildModel(ModelData& model, const glTF::Asset& asset, int sceneIdx,
+    const MeshBuildSettings& buildSettings)
 {
     BuildMaterials(model, asset);
 
@@ -481,22 +560,51 @@ bool Renderer::BuildModel(ModelData& model, const glTF::Asset& asset, int sceneI
 
     model.m_BoundingSphere = BoundingSphere(kZero);
     model.m_BoundingBox = AxisAlignedBox(kZero);
-    uint32_t numNodes = WalkGraph(model.m_SceneGraph, model.m_BoundingSphere, model.m_BoundingBox, model.m_Meshes, bufferMemory, scene->nodes, 0, Matrix4(kIdentity));
+    uint32_t numNodes = WalkGraph(model.m_SceneGraph, model.m_BoundingSphere, model.m_BoundingBox, model.m_Meshes, bufferMemory, model.m_Meshlets, scene->nodes, 0, Matrix4(kIdentity),
+        buildSettings);
     model.m_SceneGraph.resize(numNodes);
 
     BuildAnimations(model, asset);
     BuildSkins(model, asset);
 
+    model.m_BuildSettings = GetMiniBuildSettings(buildSettings);
+
     return true;
 }
 
+MiniBuildSettings Renderer::GetMiniBuildSettings(const MeshBuildSettings& settings)
+{
+    MiniBuildSettings result = {};
+    result.vertexQuantization = (uint32_t)settings.vertexQuantization;
+    result.vertexCacheAlgorithm = (uint32_t)settings.vertexCache.algorithm;
+    result.vertexCacheSize = settings.vertexCache.cacheSize;
+    result.reduceOverdraw = settings.vertexCache.reduceOverdraw ? 1 : 0;
+    if (settings.vertexCache.reduceOverdraw)
+        result.overdrawThreshold = settings.vertexCache.overdrawThreshold;
+    if (settings.buildMeshlets)
+    {
+        result.maxMeshletVertices = settings.maxMeshletVertices;
+        result.maxMeshletTriangles = settings.maxMeshletTriangles;
+    }
+    return result;
+}
+
+static_assert(sizeof(GraphNode) == kMiniElementSizes[kMiniSceneGraph], "Update kMiniElementSizes");
+static_assert(sizeof(MaterialConstantData) == kMiniElementSizes[kMiniMaterialConstants], "Update kMiniElementSizes");
+static_assert(sizeof(MaterialTextureData) == kMiniElementSizes[kMiniMaterialTextures], "Update kMiniElementSizes");
+static_assert(sizeof(AnimationCurve) == kMiniElementSizes[kMiniAnimationCurves], "Update kMiniElementSizes");
+static_assert(sizeof(AnimationSet) == kMiniElementSizes[kMiniAnimations], "Update kMiniElementSizes");
+static_assert(sizeof(uint16_t) == kMiniElementSizes[kMiniJointIndices], "Update kMiniElementSizes");
+static_assert(sizeof(Matrix4) == kMiniElementSizes[kMiniJointIBMs], "Update kMiniElementSizes");
+static_assert(sizeof(Meshlets::Meshlet) == kMiniElementSizes[kMiniMeshlets], "Update kMiniElementSizes");
+
 bool Renderer::SaveModel(const std::wstring& filePath, const ModelData& data)
 {
     std::ofstream outFile(filePath, std::ios::out | std::ios::binary);
     if (!outFile)
         return false;
 
-    FileHeader header;
+    FileHeader header = {};
     std::memcpy(header.id, "MINI", 4);
     header.version = CURRENT_MINI_FILE_VERSION;
     header.numNodes = (uint32_t)data.m_SceneGraph.size();
@@ -514,6 +622,8 @@ bool Renderer::SaveModel(const std::wstring& filePath, const ModelData& data)
     header.numAnimationCurves = (uint32_t)data.m_AnimationCurves.size();
     header.numAnimations = (uint32_t)data.m_Animations.size();
     header.numJoints = (uint32_t)data.m_JointIndices.size();
+    header.numMeshlets = (uint32_t)data.m_Meshlets.size();
+    header.buildSettings = data.m_BuildSettings;
     header.boundingSphere[0] = data.m_BoundingSphere.GetCenter().GetX();
     header.boundingSphere[1] = data.m_BoundingSphere.GetCenter().GetY();
     header.boundingSphere[2] = data.m_BoundingSphere.GetCenter().GetZ();
@@ -525,23 +635,53 @@ bool Renderer::SaveModel(const std::wstring& filePath, const ModelData& data)
     header.maxPos[1] = data.m_BoundingBox.GetMax().GetY();
     header.maxPos[2] = data.m_BoundingBox.GetMax().GetZ();
 
-    outFile.write((char*)&header, sizeof(FileHeader));
-    outFile.write((char*)data.m_GeometryData.data(), header.geometrySize);
-    outFile.write((char*)data.m_SceneGraph.data(), header.numNodes * sizeof(GraphNode));
+    MiniFileWriter writer(outFile);
+
+    writer.BeginSection(kMiniGeometry);
+    writer.Write(data.m_GeometryData.data(), header.geometrySize);
+    writer.EndSection();
+
+    writer.BeginSection(kMiniSceneGraph);
+    writer.Write(data.m_SceneGraph.data(), header.numNodes * sizeof(GraphNode));
+    writer.EndSection();
+
+    writer.BeginSection(kMiniMeshData);
     for (const Mesh* mesh : data.m_Meshes)
-        outFile.write((char*)mesh, sizeof(Mesh) + (mesh->numDraws - 1) * sizeof(Mesh::Draw));
-    outFile.write((char*)data.m_MaterialConstants.data(), header.numMaterials * sizeof(MaterialConstantData));
-    outFile.write((char*)data.m_MaterialTextures.data(), header.numMaterials * sizeof(MaterialTextureData));
+        writer.Write(mesh, sizeof(Mesh) + (mesh->numDraws - 1) * sizeof(Mesh::Draw));
+    writer.EndSection();
+
+    writer.BeginSection(kMiniMaterialConstants);
+    writer.Write(data.m_MaterialConstants.data(), header.numMaterials * sizeof(MaterialConstantData));
+    writer.EndSection();
+
+    writer.BeginSection(kMiniMaterialTextures);
+    writer.Write(data.m_MaterialTextures.data(), header.numMaterials * sizeof(MaterialTextureData));
+    writer.EndSection();
+
+    writer.BeginSection(kMiniStringTable);
     for (uint32_t i = 0; i < header.numTextures; ++i)
-        outFile << data.m_TextureNames[i] << '\0';
-    outFile.write((char*)data.m_TextureOptions.data(), header.numTextures * sizeof(uint8_t));
+        writer.Write(data.m_TextureNames[i].c_str(), data.m_TextureNames[i].size() + 1);
+    writer.EndSection();
+
+    writer.BeginSection(kMiniTextureOptions);
+    writer.Write(data.m_TextureOptions.data(), header.numTextures * sizeof(uint8_t));
+    writer.EndSection();
 
     if (header.numAnimations > 0)
     {
         ASSERT(header.keyFrameDataSize > 0 && header.numAnimationCurves > 0);
-        outFile.write((char*)data.m_AnimationKeyFrameData.data(), header.keyFrameDataSize);
-        outFile.write((char*)data.m_AnimationCurves.data(), header.numAnimationCurves * sizeof(AnimationCurve));
-        outFile.write((char*)data.m_Animations.data(), header.numAnimations * sizeof(AnimationSet));
+
+        writer.BeginSection(kMiniKeyFrameData);
+        writer.Write(data.m_AnimationKeyFrameData.data(), header.keyFrameDataSize);
+        writer.EndSection();
+
+        writer.BeginSection(kMiniAnimationCurves);
+        writer.Write(data.m_AnimationCurves.data(), header.numAnimationCurves * sizeof(AnimationCurve));
+        writer.EndSection();
+
+        writer.BeginSection(kMiniAnimations);
+        writer.Write(data.m_Animations.data(), header.numAnimations * sizeof(AnimationSet));
+        writer.EndSection();
     }
     else
     {
@@ -551,8 +691,27 @@ bool Renderer::SaveModel(const std::wstring& filePath, const ModelData& data)
     if (header.numJoints)
     {
         ASSERT(header.numJoints == (uint32_t)data.m_JointIBMs.size());
-        outFile.write((char*)data.m_JointIndices.data(), header.numJoints * sizeof(uint16_t));
-        outFile.write((char*)data.m_JointIBMs.data(), header.numJoints * sizeof(Matrix4));
+
+        writer.BeginSection(kMiniJointIndices);
+        writer.Write(data.m_JointIndices.data(), header.numJoints * sizeof(uint16_t));
+        writer.EndSection();
+
+        writer.BeginSection(kMiniJointIBMs);
+        writer.Write(data.m_JointIBMs.data(), header.numJoints * sizeof(Matrix4));
+        writer.EndSection();
+    }
+
+    if (header.numMeshlets > 0)
+    {
+        writer.BeginSection(kMiniMeshlets);
+        writer.Write(data.m_Meshlets.data(), header.numMeshlets * sizeof(Meshlets::Meshlet));
+        writer.EndSection();
+    }
+
+    if (!writer.Finish(header))
+    {
+        LOG_ERRORF("Error: Failed to write %s.", Utility::WideStringToUTF8(filePath).c_str());
+        return false;
     }
 
     return true;
@@ -0,0 +1,332 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "ModelFile.h"
+#include "../Core/Crc32c.h"
+#include "../Core/Utf8.h"
+
+#include <cstddef>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Renderer;
+
+namespace
+{
+    inline uint64_t AlignSection(uint64_t offset)
+    {
+        return (offset + kMiniSectionAlignment - 1) & ~(uint64_t)(kMiniSectionAlignment - 1);
+    }
+}
+
+uint64_t Renderer::GetExpectedSectionSize(const FileHeader& header, MiniSection section)
+{
+    uint32_t count = 0;
+    switch (section)
+    {
+    case kMiniGeometry:             count = header.geometrySize; break;
+    case kMiniSceneGraph:           count = header.numNodes; break;
+    case kMiniMeshData:             count = header.meshDataSize; break;
+    case kMiniMaterialConstants:    count = header.numMaterials; break;
+    case kMiniMaterialTextures:     count = header.numMaterials; break;
+    case kMiniStringTable:          count = header.stringTableSize; break;
+    case kMiniTextureOptions:       count = header.numTextures; break;
+    case kMiniKeyFrameData:         count = header.keyFrameDataSize; break;
+    case kMiniAnimationCurves:      count = header.numAnimationCurves; break;
+    case kMiniAnimations:           count = header.numAnimations; break;
+    case kMiniJointIndices:         count = header.numJoints; break;
+    case kMiniJointIBMs:            count = header.numJoints; break;
+    case kMiniMeshlets:             count = header.numMeshlets; break;
+    default: return 0;
+    }
+    return (uint64_t)count * kMiniElementSizes[section];
+}
+
+//
+// MiniFileWriter
+//
+
+MiniFileWriter::MiniFileWriter(std::ostream& out) : m_Out(out), m_Position(0), m_CurrentSection(kNumMiniSections)
+{
+    memset(&m_Sections, 0, sizeof(m_Sections));
+
+    // Reserve space for the header, it is written for real by Finish()
+    m_Out.write((const char*)&m_Sections, sizeof(FileHeader));
+    m_Position = sizeof(FileHeader);
+}
+
+void MiniFileWriter::BeginSection(MiniSection section)
+{
+    static const char kPadding[kMiniSectionAlignment] = {};
+
+    uint64_t aligned = AlignSection(m_Position);
+    m_Out.write(kPadding, (std::streamsize)(aligned - m_Position));
+    m_Position = aligned;
+
+    MiniSectionEntry& entry = m_Sections.sections[section];
+    entry.offset = (uint32_t)m_Position;
+    entry.size = 0;
+    entry.checksum = 0;
+    m_CurrentSection = section;
+}
+
+void MiniFileWriter::Write(const void* data, size_t size)
+{
+    if (size == 0 || m_CurrentSection == kNumMiniSections)
+        return;
+
+    MiniSectionEntry& entry = m_Sections.sections[m_CurrentSection];
+    entry.checksum = Utility::ComputeCrc32c(data, size, entry.checksum);
+    entry.size += (uint32_t)size;
+
+    m_Out.write((const char*)data, (std::streamsize)size);
+    m_Position += size;
+}
+
+void MiniFileWriter::EndSection()
+{
+    m_CurrentSection = kNumMiniSections;
+}
+
+bool MiniFileWriter::Finish(FileHeader& header)
+{
+    // Keep the file a whole number of sections long so the last one can be mapped safely
+    static const char kPadding[kMiniSectionAlignment] = {};
+    uint64_t aligned = AlignSection(m_Position);
+    m_Out.write(kPadding, (std::streamsize)(aligned - m_Position));
+    m_Position = aligned;
+
+    if (m_Position > UINT32_MAX)
+        return false;
+
+    memcpy(header.sections, m_Sections.sections, sizeof(header.sections));
+    header.fileSize = (uint32_t)m_Position;
+    header.headerChecksum = Utility::ComputeCrc32c(&header, offsetof(FileHeader, headerChecksum));
+
+    m_Out.seekp(0);
+    m_Out.write((const char*)&header, sizeof(FileHeader));
+    m_Out.flush();
+    return m_Out.good();
+}
+
+//
+// MappedFile
+//
+
+bool MappedFile::Open(const std::wstring& filePath)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr)
+        return false;
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (view == nullptr)
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    m_Handle = mapping;
+    m_Data = (uint8_t*)view;
+    m_Size = (size_t)fileSize.QuadPart;
+#else
+    int fd = open(Utility::WideToUTF8(filePath).c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED)
+        return false;
+
+    m_Data = (uint8_t*)view;
+    m_Size = (size_t)fileStat.st_size;
+#endif
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_Data == nullptr)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_Data);
+    CloseHandle((HANDLE)m_Handle);
+#else
+    munmap(m_Data, m_Size);
+#endif
+
+    m_Data = nullptr;
+    m_Size = 0;
+    m_Handle = nullptr;
+}
+
+//
+// MiniFileView
+//
+
+MiniFileView::Status MiniFileView::Open(const std::wstring& filePath, bool verifyChecksums)
+{
+    Close();
+
+    if (!m_File.Open(filePath))
+        return kMissing;
+
+    Status status = Attach(m_File.GetData(), m_File.GetSize(), verifyChecksums);
+    if (status != kOK)
+        m_File.Close();
+
+    return status;
+}
+
+MiniFileView::Status MiniFileView::Attach(uint8_t* data, size_t size, bool verifyChecksums)
+{
+    m_Header = nullptr;
+    m_Data = nullptr;
+    m_Size = 0;
+
+    // Old versions are smaller than the current header, so check the version first
+    if (size < 8 || strncmp((const char*)data, "MINI", 4) != 0)
+        return kNotMini;
+
+    uint32_t version;
+    memcpy(&version, data + 4, sizeof(version));
+    if (version != CURRENT_MINI_FILE_VERSION)
+        return kWrongVersion;
+
+    if (size < sizeof(FileHeader))
+        return kCorrupt;
+
+    const FileHeader* header = (const FileHeader*)data;
+    if (Utility::ComputeCrc32c(header, offsetof(FileHeader, headerChecksum)) != header->headerChecksum ||
+        header->fileSize > size)
+    {
+        return kCorrupt;
+    }
+
+    // Every count must describe its section exactly, so a nonzero count never meets an empty
+    // section and the loader can index the sections by the counts
+    for (uint32_t i = 0; i < kNumMiniSections; ++i)
+    {
+        const MiniSectionEntry& entry = header->sections[i];
+        if (entry.size != GetExpectedSectionSize(*header, (MiniSection)i))
+            return kCorrupt;
+        if (entry.size == 0)
+            continue;
+
+        if (entry.offset % kMiniSectionAlignment != 0 || entry.offset < sizeof(FileHeader) ||
+            (uint64_t)entry.offset + entry.size > header->fileSize)
+        {
+            return kCorrupt;
+        }
+    }
+
+    m_Header = header;
+    m_Data = data;
+    m_Size = size;
+
+    if (verifyChecksums)
+    {
+        for (uint32_t i = 0; i < kNumMiniSections; ++i)
+        {
+            if (!VerifySection((MiniSection)i))
+            {
+                m_Header = nullptr;
+                m_Data = nullptr;
+                m_Size = 0;
+                return kCorrupt;
+            }
+        }
+    }
+
+    return kOK;
+}
+
+void MiniFileView::Close()
+{
+    m_Header = nullptr;
+    m_Data = nullptr;
+    m_Size = 0;
+    m_File.Close();
+}
+
+uint8_t* MiniFileView::GetSection(MiniSection section) const
+{
+    const MiniSectionEntry& entry = m_Header->sections[section];
+    return entry.size > 0 ? m_Data + entry.offset : nullptr;
+}
+
+bool MiniFileView::VerifySection(MiniSection section) const
+{
+    const MiniSectionEntry& entry = m_Header->sections[section];
+    return Utility::ComputeCrc32c(m_Data + entry.offset, entry.size) == entry.checksum;
+}
+
+const char* MiniFileView::GetStatusString(Status status)
+{
+    switch (status)
+    {
+    case kOK: return "OK";
+    case kMissing: return "missing";
+    case kNotMini: return "not a .mini file";
+    case kWrongVersion: return "version deprecated";
+    case kCorrupt: return "corrupt";
+    default: return "unknown";
+    }
+}
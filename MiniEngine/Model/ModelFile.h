@@ -0,0 +1,220 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+//
+// On-disk layout of the .mini model format. This header and ModelFile.cpp have no D3D12
+// dependencies so the file format can be written, mapped and validated on any platform.
+//
+// Starting with version 14 every section is aligned to kMiniSectionAlignment and located
+// through the section table in the file header. A loader maps the file and points straight
+// at the sections instead of streaming them through intermediate buffers. Each section
+// carries a CRC-32C so that truncated or corrupt files are detected and rebuilt. Since
+// version 19 the header has its own CRC-32C, and every count in it must match the size of
+// the section it indexes. Version 20 records every mesh build setting that changes the
+// output, so a file built with other settings is rebuilt.
+//
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#define CURRENT_MINI_FILE_VERSION 20
+
+namespace Renderer
+{
+    enum MiniSection : uint32_t
+    {
+        kMiniGeometry,              // Vertex and index data uploaded to the GPU
+        kMiniSceneGraph,            // GraphNode[numNodes]
+        kMiniMeshData,              // Variable sized Mesh records, meshDataSize bytes
+        kMiniMaterialConstants,     // MaterialConstantData[numMaterials]
+        kMiniMaterialTextures,      // MaterialTextureData[numMaterials]
+        kMiniStringTable,           // numTextures null terminated UTF-8 texture names
+        kMiniTextureOptions,        // uint8_t[numTextures]
+        kMiniKeyFrameData,          // Animation key frames, keyFrameDataSize bytes
+        kMiniAnimationCurves,       // AnimationCurve[numAnimationCurves]
+        kMiniAnimations,            // AnimationSet[numAnimations]
+        kMiniJointIndices,          // uint16_t[numJoints]
+        kMiniJointIBMs,             // Matrix4[numJoints]
+        kMiniMeshlets,              // Meshlets::Meshlet[numMeshlets], referenced by Mesh::Draw
+
+        kNumMiniSections
+    };
+
+    // Large enough for any structure mapped in place (Matrix4 needs 16) and for cache lines
+    static const uint32_t kMiniSectionAlignment = 256;
+
+    // Bytes per element of each section, 1 where the header gives the size in bytes. The
+    // element types need the engine headers, so ModelConvert.cpp checks these at compile time.
+    static constexpr uint32_t kMiniElementSizes[kNumMiniSections] =
+    {
+        1,      // Geometry
+        96,     // GraphNode
+        1,      // Mesh data
+        44,     // MaterialConstantData
+        16,     // MaterialTextureData
+        1,      // String table
+        1,      // Texture options
+        1,      // Key frame data
+        24,     // AnimationCurve
+        12,     // AnimationSet
+        2,      // Joint index
+        64,     // Matrix4
+        48,     // Meshlets::Meshlet
+    };
+
+    struct MiniSectionEntry
+    {
+        uint32_t offset;    // From the start of the file, a multiple of kMiniSectionAlignment
+        uint32_t size;      // In bytes, excluding padding
+        uint32_t checksum;  // CRC-32C of the section contents
+        uint32_t reserved;
+    };
+
+    // The MeshBuildSettings a file was built with. Settings that had no effect are zero, so
+    // only a change to the output makes a file stale.
+    struct MiniBuildSettings
+    {
+        uint32_t vertexQuantization;    // VertexQuantization::Profile
+        uint32_t vertexCacheAlgorithm;  // VertexCacheOptimize::Algorithm
+        uint32_t vertexCacheSize;       // Zero for the default of the algorithm
+        uint32_t reduceOverdraw;
+        float    overdrawThreshold;     // Zero without reduceOverdraw
+        uint32_t maxMeshletVertices;    // Zero without meshlets
+        uint32_t maxMeshletTriangles;   // Zero without meshlets
+    };
+
+    struct FileHeader
+    {
+        char     id[4];   // "MINI"
+        uint32_t version; // CURRENT_MINI_FILE_VERSION
+        uint32_t numNodes;
+        uint32_t numMeshes;
+        uint32_t numMaterials;
+        uint32_t meshDataSize;
+        uint32_t numTextures;
+        uint32_t stringTableSize;
+        uint32_t geometrySize;
+        uint32_t keyFrameDataSize;      // Animation data
+        uint32_t numAnimationCurves;
+        uint32_t numAnimations;
+        uint32_t numJoints;     // All joints for all skins
+        uint32_t numMeshlets;   // All meshlets for all draws
+        MiniBuildSettings buildSettings;
+        float    boundingSphere[4];
+        float    minPos[3];
+        float    maxPos[3];
+        uint32_t fileSize;      // Total size including padding, used to detect truncation
+        MiniSectionEntry sections[kNumMiniSections];
+        uint32_t headerChecksum;    // CRC-32C of everything above
+    };
+
+    // The size in bytes that the counts in 'header' imply for a section
+    uint64_t GetExpectedSectionSize(const FileHeader& header, MiniSection section);
+
+    //
+    // Writes sections in order, padding each to kMiniSectionAlignment and recording its
+    // offset, size and checksum. Finish() fills in the section table and rewrites the header.
+    //
+    class MiniFileWriter
+    {
+    public:
+        MiniFileWriter(std::ostream& out);
+
+        void BeginSection(MiniSection section);
+        void Write(const void* data, size_t size);
+        void EndSection();
+
+        bool Finish(FileHeader& header);
+
+    private:
+        std::ostream& m_Out;
+        FileHeader m_Sections;
+        uint64_t m_Position;
+        uint32_t m_CurrentSection;
+    };
+
+    //
+    // A read-only, copy-on-write memory mapping of a whole file. Pages the loader patches
+    // (such as the PSO and descriptor table indices in the mesh records) become private
+    // copies; the file on disk is never modified.
+    //
+    class MappedFile
+    {
+    public:
+        MappedFile() : m_Data(nullptr), m_Size(0), m_Handle(nullptr) {}
+        ~MappedFile() { Close(); }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool Open(const std::wstring& filePath);
+        void Close();
+
+        uint8_t* GetData() const { return m_Data; }
+        size_t GetSize() const { return m_Size; }
+
+    private:
+        uint8_t* m_Data;
+        size_t m_Size;
+        void* m_Handle;
+    };
+
+    //
+    // Validates a mapped .mini file and hands out typed pointers into its sections.
+    //
+    class MiniFileView
+    {
+    public:
+        enum Status { kOK, kMissing, kNotMini, kWrongVersion, kCorrupt };
+
+        MiniFileView() : m_Header(nullptr), m_Data(nullptr), m_Size(0) {}
+
+        // Maps the file. Checksums are verified unless 'verifyChecksums' is false.
+        Status Open(const std::wstring& filePath, bool verifyChecksums = true);
+
+        // Validates an existing memory range, e.g. a buffer read without mapping. The header
+        // checksum and the section sizes are always verified.
+        Status Attach(uint8_t* data, size_t size, bool verifyChecksums = true);
+
+        void Close();
+
+        const FileHeader& GetHeader() const { return *m_Header; }
+
+        // Null for an empty section, which Attach() only allows when its count is zero
+        uint8_t* GetSection(MiniSection section) const;
+        uint32_t GetSectionSize(MiniSection section) const { return m_Header->sections[section].size; }
+
+        template <typename T>
+        T* GetSection(MiniSection section) const { return reinterpret_cast<T*>(GetSection(section)); }
+
+        bool VerifySection(MiniSection section) const;
+
+        static const char* GetStatusString(Status status);
+
+    private:
+        MappedFile m_File;
+        const FileHeader* m_Header;
+        uint8_t* m_Data;
+        size_t m_Size;
+    };
+}
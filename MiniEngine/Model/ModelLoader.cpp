@@ -21,9 +21,11 @@
 #include "ModelH3D.h"
 #include "TextureManager.h"
 #include "TextureConvert.h"
+#include "TexturePipeline.h"
 #include "GraphicsCommon.h"
 
-#include <fstream>
+#include <cstring>
+#include <sstream>
 #include <unordered_map>
 
 using namespace Renderer;
@@ -47,21 +49,70 @@ void LoadMaterials(Model& model,
 {
     static_assert((sizeof(MaterialConstants) % 256) == 0, "CBVs need 256 byte alignment");
 
-    // Load textures
+    // Load textures.  Conversion and file reads run on worker threads, textures are created
+    // on this thread as soon as their data is ready.
     const uint32_t numTextures = (uint32_t)textureNames.size();
     model.textures.resize(numTextures);
+
+    std::vector<TexturePipeline::Request> requests(numTextures);
     for (size_t ti = 0; ti < numTextures; ++ti)
     {
-        std::wstring originalFile = basePath + textureNames[ti];
-        CompileTextureOnDemand(originalFile, textureOptions[ti]);
+        requests[ti].File = basePath + textureNames[ti];
+        requests[ti].Flags = textureOptions[ti];
+    }
+
+    std::vector<TexturePipeline::Request> uniqueTextures;
+    std::vector<uint32_t> remap;
+    TexturePipeline::Deduplicate(requests, uniqueTextures, remap);
 
-        std::wstring ddsFile = Utility::RemoveExtension(originalFile) + L".dds";
-        model.textures[ti] = TextureManager::LoadDDSFromFile(ddsFile);
+    std::vector<TextureRef> loadedTextures(uniqueTextures.size());
+    std::vector<Utility::ByteArray> fileData(uniqueTextures.size());
+
+    auto ddsFileName = [&](uint32_t idx) { return Utility::RemoveExtension(uniqueTextures[idx].File) + L".dds"; };
+
+    TexturePipeline::Stages stages;
+    stages.Convert = [&](uint32_t idx)
+    {
+        CompileTextureOnDemand(uniqueTextures[idx].File, uniqueTextures[idx].Flags);
+    };
+    if (TextureManager::IsStreamingEnabled())
+    {
+        // Streamed textures read only what they need when they are created
+        stages.Finish = [&](uint32_t idx)
+        {
+            loadedTextures[idx] = TextureManager::StreamDDSFromFile(ddsFileName(idx));
+        };
+    }
+    else
+    {
+        stages.Read = [&](uint32_t idx)
+        {
+            fileData[idx] = Utility::ReadFileSync(ddsFileName(idx));
+        };
+        stages.Finish = [&](uint32_t idx)
+        {
+            loadedTextures[idx] = TextureManager::LoadDDSFromMemory(ddsFileName(idx), fileData[idx]);
+            fileData[idx] = nullptr;
+        };
     }
 
+    TexturePipeline::Stats textureStats;
+    TexturePipeline::Run(uniqueTextures, remap, stages, textureStats);
+
+    // The log formats into small fixed buffers, so write the report a line at a time
+    std::istringstream report(TexturePipeline::ToString(textureStats));
+    for (std::string line; std::getline(report, line); )
+        LOG_INFO(line.c_str());
+
+    for (size_t ti = 0; ti < numTextures; ++ti)
+        model.textures[ti] = loadedTextures[remap[ti]];
+
     // Generate descriptor tables and record offsets for each material
     const uint32_t numMaterials = (uint32_t)materialTextures.size();
     std::vector<uint32_t> tableOffsets(numMaterials);
+    model.m_TextureTables.resize(numMaterials);
+    model.m_MaterialTextures.resize(numMaterials * kNumTextures);
+    model.RecordTextureVersions();
 
     for (uint32_t matIdx = 0; matIdx < numMaterials; ++matIdx)
     {
@@ -69,30 +120,15 @@ void LoadMaterials(Model& model,
 
         DescriptorHandle TextureHandles = Renderer::s_TextureHeap.Alloc(kNumTextures);
         uint32_t SRVDescriptorTable = Renderer::s_TextureHeap.GetOffsetOfHandle(TextureHandles);
+        model.m_TextureTables[matIdx] = (uint16_t)SRVDescriptorTable;
 
-        uint32_t DestCount = kNumTextures;
-        uint32_t SourceCounts[kNumTextures] = { 1, 1, 1, 1, 1 };
-
-        D3D12_CPU_DESCRIPTOR_HANDLE DefaultTextures[kNumTextures] =
-        {
-            GetDefaultTexture(kWhiteOpaque2D),
-            GetDefaultTexture(kWhiteOpaque2D),
-            GetDefaultTexture(kWhiteOpaque2D),
-            GetDefaultTexture(kBlackTransparent2D),
-            GetDefaultTexture(kDefaultNormalMap)
-        };
-
-        D3D12_CPU_DESCRIPTOR_HANDLE SourceTextures[kNumTextures];
         for (uint32_t j = 0; j < kNumTextures; ++j)
-        {
-            if (srcMat.stringIdx[j] == 0xffff)
-                SourceTextures[j] = DefaultTextures[j];
-            else
-                SourceTextures[j] = model.textures[srcMat.stringIdx[j]].GetSRV();
-        }
+            model.m_MaterialTextures[matIdx * kNumTextures + j] = srcMat.stringIdx[j];
 
-        g_Device->CopyDescriptors(1, &TextureHandles, &DestCount,
-            DestCount, SourceTextures, SourceCounts, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        model.CopyTextureTable(matIdx, TextureHandles);
+
+        uint32_t DestCount = kNumTextures;
+        uint32_t SourceCounts[kNumTextures] = { 1, 1, 1, 1, 1 };
 
         // See if this combination of samplers has been used before.  If not, allocate more from the heap
         // and copy in the descriptors.
@@ -122,7 +158,7 @@ void LoadMaterials(Model& model,
     }
 
     // Update table offsets for each mesh
-    uint8_t* meshPtr = model.m_MeshData.get();
+    uint8_t* meshPtr = model.m_MeshData;
     for (uint32_t i = 0; i < model.m_NumMeshes; ++i)
     {
         Mesh& mesh = *(Mesh*)meshPtr;
@@ -134,15 +170,117 @@ void LoadMaterials(Model& model,
     }
 }
 
-std::shared_ptr<Model> Renderer::LoadModel(const std::wstring& filePath, bool forceRebuild)
+// MiniFileView has checked every section size against the header. This checks the indices
+// the records hold into other sections, which the loader and renderer follow unchecked. It
+// also returns how many morph weights the animations write, which sizes each instance's.
+bool ValidateModelData(const MiniFileView& miniFile, uint32_t& numMorphWeights)
+{
+    const FileHeader& header = miniFile.GetHeader();
+
+    const uint8_t* meshData = miniFile.GetSection(kMiniMeshData);
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < header.numMeshes; ++i)
+    {
+        if (offset + sizeof(Mesh) > header.meshDataSize)
+            return false;
+
+        const Mesh& mesh = *(const Mesh*)(meshData + offset);
+        if (mesh.numDraws == 0)
+            return false;
+
+        offset += sizeof(Mesh) + (mesh.numDraws - 1) * sizeof(Mesh::Draw);
+        if (offset > header.meshDataSize || mesh.materialCBV >= header.numMaterials || mesh.meshCBV >= header.numNodes ||
+            (uint64_t)mesh.vbOffset + mesh.vbSize > header.geometrySize ||
+            (uint64_t)mesh.vbDepthOffset + mesh.vbDepthSize > header.geometrySize ||
+            (uint64_t)mesh.ibOffset + mesh.ibSize > header.geometrySize ||
+            (uint64_t)mesh.ibDepthOffset + mesh.ibDepthSize > header.geometrySize ||
+            (uint32_t)mesh.startJoint + mesh.numJoints > header.numJoints)
+        {
+            return false;
+        }
+
+        for (uint32_t d = 0; d < mesh.numDraws; ++d)
+        {
+            if ((uint64_t)mesh.draw[d].startMeshlet + mesh.draw[d].numMeshlets > header.numMeshlets)
+                return false;
+        }
+    }
+    if (offset != header.meshDataSize)
+        return false;
+
+    // Every node, mesh and joint indexes the per-node constants and bounding sphere transforms
+    const GraphNode* sceneGraph = miniFile.GetSection<const GraphNode>(kMiniSceneGraph);
+    for (uint32_t i = 0; i < header.numNodes; ++i)
+    {
+        if (sceneGraph[i].matrixIdx >= header.numNodes)
+            return false;
+    }
+
+    const uint16_t* jointIndices = miniFile.GetSection<const uint16_t>(kMiniJointIndices);
+    for (uint32_t i = 0; i < header.numJoints; ++i)
+    {
+        if (jointIndices[i] >= header.numNodes)
+            return false;
+    }
+
+    const MaterialTextureData* materialTextures = miniFile.GetSection<const MaterialTextureData>(kMiniMaterialTextures);
+    for (uint32_t i = 0; i < header.numMaterials; ++i)
+    {
+        for (uint32_t j = 0; j < kNumTextures; ++j)
+        {
+            uint16_t stringIdx = materialTextures[i].stringIdx[j];
+            if (stringIdx != 0xffff && stringIdx >= header.numTextures)
+                return false;
+        }
+    }
+
+    // The sampler reads numSegments + 1 key frames of keyFrameStride words from keyFrameOffset,
+    // three times as many for cubic splines with their tangents
+    static const uint32_t kFormatSizes[] = { 1, 1, 2, 2, 4 };
+    numMorphWeights = 0;
+
+    const AnimationCurve* curves = miniFile.GetSection<const AnimationCurve>(kMiniAnimationCurves);
+    for (uint32_t i = 0; i < header.numAnimationCurves; ++i)
+    {
+        const AnimationCurve& curve = curves[i];
+        if (curve.targetNode >= header.numNodes || curve.keyFrameFormat > AnimationCurve::kFloat ||
+            !(curve.numSegments >= 0.0f && curve.numSegments < 16777216.0f) ||
+            curve.numSegments != (float)(uint32_t)curve.numSegments)
+        {
+            return false;
+        }
+
+        const uint32_t numComponents = AnimationSampling::GetNumComponents(curve);
+        if (numComponents == 0 || numComponents * kFormatSizes[curve.keyFrameFormat] > curve.keyFrameStride * 4u)
+            return false;
+
+        const uint64_t numKeys = ((uint64_t)curve.numSegments + 1) * (curve.interpolation == AnimationCurve::kCubicSpline ? 3 : 1);
+        if ((uint64_t)curve.keyFrameOffset + numKeys * curve.keyFrameStride * 4 > header.keyFrameDataSize)
+            return false;
+
+        if (curve.targetPath == AnimationCurve::kWeights)
+            numMorphWeights = std::max<uint32_t>(numMorphWeights, curve.firstWeight + curve.keyFrameStride);
+    }
+
+    const AnimationSet* animations = miniFile.GetSection<const AnimationSet>(kMiniAnimations);
+    for (uint32_t i = 0; i < header.numAnimations; ++i)
+    {
+        if ((uint64_t)animations[i].firstCurve + animations[i].numCurves > header.numAnimationCurves)
+            return false;
+    }
+
+    return true;
+}
+
+std::shared_ptr<Model> Renderer::LoadModel(const std::wstring& filePath, bool forceRebuild,
+    const MeshBuildSettings& buildSettings)
 {
     const std::wstring miniFileName = Utility::RemoveExtension(filePath) + L".mini";
     const std::wstring fileName = Utility::RemoveBasePath(filePath);
 
     struct _stat64 sourceFileStat;
     struct _stat64 miniFileStat;
-    std::ifstream inFile;
-    FileHeader header;
+    std::unique_ptr<MiniFileView> miniFile(new MiniFileView);
 
     bool sourceFileMissing = _wstat64(filePath.c_str(), &sourceFileStat) == -1;
     bool miniFileMissing = _wstat64(miniFileName.c_str(), &miniFileStat) == -1;
@@ -158,21 +296,41 @@ std::shared_ptr<Model> Renderer::LoadModel(const std::wstring& filePath, bool fo
 
     bool needBuild = forceRebuild;
 
+    const std::wstring fileExt = Utility::ToLower(Utility::GetFileExtension(filePath));
+    const bool isGltf = fileExt == L"gltf" || fileExt == L"glb";
+
     // Check if .mini file exists and it is newer than source file
     if (miniFileMissing || !sourceFileMissing && sourceFileStat.st_mtime > miniFileStat.st_mtime)
         needBuild = true;
 
-    // Check if it's an older version of .mini
+    // Check if it's an older version of .mini or if it has been damaged
     if (!needBuild)
     {
-        inFile = std::ifstream(miniFileName, std::ios::in | std::ios::binary);
-        inFile.read((char*)&header, sizeof(FileHeader));
-        if (strncmp(header.id, "MINI", 4) != 0 || header.version != CURRENT_MINI_FILE_VERSION)
+        MiniFileView::Status status = miniFile->Open(miniFileName);
+        if (status != MiniFileView::kOK)
         {
-            LOG_INFOF("Model version deprecated.  Rebuilding %s...", Utility::WideStringToUTF8(fileName).c_str());
+            LOG_INFOF("Model %s.  Rebuilding %s...", MiniFileView::GetStatusString(status), Utility::WideStringToUTF8(fileName).c_str());
             needBuild = true;
-            inFile.close();
         }
+        else if (isGltf && !sourceFileMissing)
+        {
+            // Only glTF meshes use the build settings, other sources always match the default
+            const MiniBuildSettings requested = GetMiniBuildSettings(buildSettings);
+            if (std::memcmp(&miniFile->GetHeader().buildSettings, &requested, sizeof(requested)) != 0)
+            {
+                LOG_INFOF("Model was built with different mesh settings.  Rebuilding %s...",
+                    Utility::WideStringToUTF8(fileName).c_str());
+                miniFile->Close();
+                needBuild = true;
+            }
+        }
+    }
+
+    // Statistics are gathered while meshes are built, so they need a rebuild to show up
+    if (!needBuild && isGltf && (buildSettings.vertexCache.logStatistics || buildSettings.logQuantizationError))
+    {
+        LOG_INFOF("Mesh statistics are only logged when a model is built.  Use -rebuild 1 to rebuild %s.",
+            Utility::WideStringToUTF8(fileName).c_str());
     }
 
     if (needBuild)
@@ -185,12 +343,10 @@ std::shared_ptr<Model> Renderer::LoadModel(const std::wstring& filePath, bool fo
 
         ModelData modelData;
 
-        const std::wstring fileExt = Utility::ToLower(Utility::GetFileExtension(filePath));
-
-        if (fileExt == L"gltf" || fileExt == L"glb")
+        if (isGltf)
         {
             glTF::Asset asset(filePath);
-            if (!BuildModel(modelData, asset))
+            if (!BuildModel(modelData, asset, -1, buildSettings))
                 return nullptr;
         }
         else if (fileExt == L"h3d")
@@ -209,64 +365,73 @@ std::shared_ptr<Model> Renderer::LoadModel(const std::wstring& filePath, bool fo
         if (!SaveModel(miniFileName, modelData))
             return nullptr;
 
-        inFile = std::ifstream(miniFileName, std::ios::in | std::ios::binary);
-        inFile.read((char*)&header, sizeof(FileHeader));
+        // The file was just written, there's no need to checksum it again
+        if (miniFile->Open(miniFileName, false) != MiniFileView::kOK)
+            return nullptr;
     }
 
-    if (!inFile)
-        return nullptr;
+    const FileHeader& header = miniFile->GetHeader();
 
-    ASSERT(strncmp(header.id, "MINI", 4) == 0 && header.version == CURRENT_MINI_FILE_VERSION);
+    uint32_t numMorphWeights = 0;
+    if (!ValidateModelData(*miniFile, numMorphWeights))
+    {
+        LOG_ERRORF("Error: %s has inconsistent mesh, node, material or animation records.", Utility::WideStringToUTF8(miniFileName).c_str());
+        return nullptr;
+    }
 
     std::wstring basePath = Utility::GetBasePath(filePath);
 
     std::shared_ptr<Model> model(new Model);
 
+    // Everything except GPU resources and the expanded material constants is used in place
     model->m_NumNodes = header.numNodes;
-    model->m_SceneGraph.reset(new GraphNode[header.numNodes]);
+    model->m_SceneGraph = miniFile->GetSection<const GraphNode>(kMiniSceneGraph);
+    SceneGraphSchedule::Build(model->m_SceneGraph, model->m_NumNodes, model->m_UpdateSchedule);
     model->m_NumMeshes = header.numMeshes;
-    model->m_MeshData.reset(new uint8_t[header.meshDataSize]);
-
-	if (header.geometrySize > 0)
-	{
-		UploadBuffer modelData;
-		modelData.Create(L"Model Data Upload", header.geometrySize);
-		inFile.read((char*)modelData.Map(), header.geometrySize);
-		modelData.Unmap();
-		model->m_DataBuffer.Create(L"Model Data", header.geometrySize, 1, modelData);
-	}
-
-    inFile.read((char*)model->m_SceneGraph.get(), header.numNodes * sizeof(GraphNode));
-    inFile.read((char*)model->m_MeshData.get(), header.meshDataSize);
-
-	if (header.numMaterials > 0)
-	{
-		UploadBuffer materialConstants;
-		materialConstants.Create(L"Material Constant Upload", header.numMaterials * sizeof(MaterialConstants));
-		MaterialConstants* materialCBV = (MaterialConstants*)materialConstants.Map();
-		for (uint32_t i = 0; i < header.numMaterials; ++i)
-		{
-			inFile.read((char*)materialCBV, sizeof(MaterialConstantData));
-			materialCBV++;
-		}
-		materialConstants.Unmap();
-		model->m_MaterialConstants.Create(L"Material Constants", header.numMaterials, sizeof(MaterialConstants), materialConstants);
-	}
+    model->m_MeshData = miniFile->GetSection(kMiniMeshData);
+
+    if (header.geometrySize > 0)
+        model->m_DataBuffer.Create(L"Model Data", header.geometrySize, 1, miniFile->GetSection(kMiniGeometry));
+
+    if (header.numMaterials > 0)
+    {
+        const MaterialConstantData* srcConstants = miniFile->GetSection<const MaterialConstantData>(kMiniMaterialConstants);
+
+        UploadBuffer materialConstants;
+        materialConstants.Create(L"Material Constant Upload", header.numMaterials * sizeof(MaterialConstants));
+        MaterialConstants* materialCBV = (MaterialConstants*)materialConstants.Map();
+        for (uint32_t i = 0; i < header.numMaterials; ++i)
+        {
+            std::memcpy(materialCBV, srcConstants + i, sizeof(MaterialConstantData));
+            materialCBV++;
+        }
+        materialConstants.Unmap();
+        model->m_MaterialConstants.Create(L"Material Constants", header.numMaterials, sizeof(MaterialConstants), materialConstants);
+    }
 
     // Read material texture and sampler properties so we can load the material
-    std::vector<MaterialTextureData> materialTextures(header.numMaterials);
-    inFile.read((char*)materialTextures.data(), header.numMaterials * sizeof(MaterialTextureData));
+    const MaterialTextureData* materialTextureData = miniFile->GetSection<const MaterialTextureData>(kMiniMaterialTextures);
+    std::vector<MaterialTextureData> materialTextures(materialTextureData, materialTextureData + header.numMaterials);
 
+    // Each name must end inside the section
     std::vector<std::wstring> textureNames(header.numTextures);
+    const char* stringTable = miniFile->GetSection<const char>(kMiniStringTable);
+    const char* stringTableEnd = stringTable + header.stringTableSize;
     for (uint32_t i = 0; i < header.numTextures; ++i)
     {
-        std::string utf8TextureName;
-        std::getline(inFile, utf8TextureName, '\0');
-        textureNames[i] = Utility::UTF8ToWideString(utf8TextureName);
+        const char* terminator = stringTable < stringTableEnd ?
+            (const char*)std::memchr(stringTable, '\0', stringTableEnd - stringTable) : nullptr;
+        if (terminator == nullptr)
+        {
+            LOG_ERRORF("Error: %s has a truncated texture name table.", Utility::WideStringToUTF8(miniFileName).c_str());
+            return nullptr;
+        }
+        textureNames[i] = Utility::UTF8ToWideString(std::string(stringTable, terminator));
+        stringTable = terminator + 1;
     }
 
-    std::vector<uint8_t> textureOptions(header.numTextures);
-    inFile.read((char*)textureOptions.data(), header.numTextures * sizeof(uint8_t));
+    const uint8_t* textureOptionData = miniFile->GetSection<const uint8_t>(kMiniTextureOptions);
+    std::vector<uint8_t> textureOptions(textureOptionData, textureOptionData + header.numTextures);
 
     LoadMaterials(*model, materialTextures, textureNames, textureOptions, basePath);
 
@@ -275,27 +440,44 @@ std::shared_ptr<Model> Renderer::LoadModel(const std::wstring& filePath, bool fo
 
     // Load animation data
     model->m_NumAnimations = header.numAnimations;
+    model->m_KeyFrameData = nullptr;
+    model->m_CurveData = nullptr;
+    model->m_Animations = nullptr;
+    model->m_NumMorphWeights = numMorphWeights;
 
     if (header.numAnimations > 0)
     {
         ASSERT(header.keyFrameDataSize > 0 && header.numAnimationCurves > 0);
-        model->m_KeyFrameData.reset(new uint8_t[header.keyFrameDataSize]);
-        inFile.read((char*)model->m_KeyFrameData.get(), header.keyFrameDataSize);
-        model->m_CurveData.reset(new AnimationCurve[header.numAnimationCurves]);
-        inFile.read((char*)model->m_CurveData.get(), header.numAnimationCurves * sizeof(AnimationCurve));
-        model->m_Animations.reset(new AnimationSet[header.numAnimations]);
-        inFile.read((char*)model->m_Animations.get(), header.numAnimations * sizeof(AnimationSet));
+        model->m_KeyFrameData = miniFile->GetSection<const uint8_t>(kMiniKeyFrameData);
+        model->m_CurveData = miniFile->GetSection<const AnimationCurve>(kMiniAnimationCurves);
+        model->m_Animations = miniFile->GetSection<const AnimationSet>(kMiniAnimations);
+
+        model->m_AnimationPlans.resize(header.numAnimations);
+        for (uint32_t i = 0; i < header.numAnimations; ++i)
+        {
+            const AnimationSet& animation = model->m_Animations[i];
+            AnimationSampling::BuildPlan(model->m_CurveData + animation.firstCurve, animation.numCurves,
+                model->m_AnimationPlans[i]);
+        }
     }
 
     model->m_NumJoints = header.numJoints;
+    model->m_JointIndices = nullptr;
+    model->m_JointIBMs = nullptr;
 
     if (header.numJoints > 0)
     {
-        model->m_JointIndices.reset(new uint16_t[header.numJoints]);
-        inFile.read((char*)model->m_JointIndices.get(), header.numJoints * sizeof(uint16_t));
-        model->m_JointIBMs.reset(new Matrix4[header.numJoints]);
-        inFile.read((char*)model->m_JointIBMs.get(), header.numJoints * sizeof(Matrix4));
+        model->m_JointIndices = miniFile->GetSection<const uint16_t>(kMiniJointIndices);
+        model->m_JointIBMs = miniFile->GetSection<const Matrix4>(kMiniJointIBMs);
     }
 
+    model->m_NumMeshlets = header.numMeshlets;
+    model->m_Meshlets = nullptr;
+
+    if (header.numMeshlets > 0)
+        model->m_Meshlets = miniFile->GetSection<const Meshlets::Meshlet>(kMiniMeshlets);
+
+    model->m_FileView = std::move(miniFile);
+
     return model;
 }
@@ -16,6 +16,10 @@
 #include "Model.h"
 #include "Animation.h"
 #include "ConstantBuffers.h"
+#include "ModelFile.h"
+#include "VertexCacheOptimize.h"
+#include "VertexQuantization.h"
+#include "Meshlets.h"
 #include "../Core/Math/BoundingSphere.h"
 #include "../Core/Math/BoundingBox.h"
 
@@ -24,8 +28,6 @@
 
 namespace glTF { class Asset; struct Mesh; }
 
-#define CURRENT_MINI_FILE_VERSION 13
-
 namespace Renderer
 {
     using namespace Math;
@@ -48,6 +50,17 @@ namespace Renderer
         uint32_t addressModes;
     };
 
+    // How meshes are processed when a .mini file is built, see OptimizeMesh
+    struct MeshBuildSettings
+    {
+        VertexCacheOptimize::Settings vertexCache;
+        bool buildMeshlets = false;
+        uint32_t maxMeshletVertices = Meshlets::kDefaultMaxVertices;
+        uint32_t maxMeshletTriangles = Meshlets::kDefaultMaxTriangles;
+        VertexQuantization::Profile vertexQuantization = VertexQuantization::kNone;
+        bool logQuantizationError = false;  // Decode every quantized primitive and log the worst error
+    };
+
     // All of the information that needs to be written to a .mini data file
     struct ModelData
     {
@@ -62,43 +75,33 @@ namespace Renderer
         std::vector<MaterialTextureData> m_MaterialTextures;
         std::vector<MaterialConstantData> m_MaterialConstants;
         std::vector<Mesh*> m_Meshes;
+        std::vector<Meshlets::Meshlet> m_Meshlets;
         std::vector<GraphNode> m_SceneGraph;
         std::vector<std::string> m_TextureNames;
         std::vector<uint8_t> m_TextureOptions;
-    };
-
-    struct FileHeader
-    {
-        char     id[4];   // "MINI"
-        uint32_t version; // CURRENT_MINI_FILE_VERSION
-        uint32_t numNodes;
-        uint32_t numMeshes;
-        uint32_t numMaterials;
-        uint32_t meshDataSize;
-        uint32_t numTextures;
-        uint32_t stringTableSize;
-        uint32_t geometrySize;
-        uint32_t keyFrameDataSize;      // Animation data
-        uint32_t numAnimationCurves;
-        uint32_t numAnimations;
-        uint32_t numJoints;     // All joints for all skins
-        float    boundingSphere[4];
-        float    minPos[3];
-        float    maxPos[3];
+        MiniBuildSettings m_BuildSettings = {};
     };
 
     void CompileMesh(
         std::vector<Mesh*>& meshList,
         std::vector<byte>& bufferMemory,
+        std::vector<Meshlets::Meshlet>& meshletList,
         glTF::Mesh& srcMesh,
         uint32_t matrixIdx,
         const Matrix4& localToObject,
         Math::BoundingSphere& boundingSphere,
-        Math::AxisAlignedBox& boundingBox
+        Math::AxisAlignedBox& boundingBox,
+        const MeshBuildSettings& buildSettings = MeshBuildSettings()
     );
 
-    bool BuildModel( ModelData& model, const glTF::Asset& asset, int sceneIdx = -1 );
+    bool BuildModel( ModelData& model, const glTF::Asset& asset, int sceneIdx = -1,
+        const MeshBuildSettings& buildSettings = MeshBuildSettings() );
     bool SaveModel( const std::wstring& filePath, const ModelData& model );
+
+    // What BuildModel records about 'settings' in the .mini header
+    MiniBuildSettings GetMiniBuildSettings( const MeshBuildSettings& settings );
     
-    std::shared_ptr<Model> LoadModel( const std::wstring& filePath, bool forceRebuild = false );
+    // 'buildSettings' only matters when the .mini file has to be (re)built
+    std::shared_ptr<Model> LoadModel( const std::wstring& filePath, bool forceRebuild = false,
+        const MeshBuildSettings& buildSettings = MeshBuildSettings() );
 }
\ No newline at end of file
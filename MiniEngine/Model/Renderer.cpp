@@ -24,6 +24,7 @@
 #include "../Core/GraphicsCommon.h"
 #include "../Core/BufferManager.h"
 #include "../Core/ShadowCamera.h"
+#include "../Core/RadixSort.h"
 
 #include "CompiledShaders/DefaultVS.h"
 #include "CompiledShaders/DefaultSkinVS.h"
@@ -37,11 +38,23 @@
 #include "CompiledShaders/DefaultNoTangentNoUV1VS.h"
 #include "CompiledShaders/DefaultNoTangentNoUV1SkinVS.h"
 #include "CompiledShaders/DefaultNoTangentNoUV1PS.h"
+#include "CompiledShaders/DefaultQuantizedVS.h"
+#include "CompiledShaders/DefaultQuantizedSkinVS.h"
+#include "CompiledShaders/DefaultNoUV1QuantizedVS.h"
+#include "CompiledShaders/DefaultNoUV1QuantizedSkinVS.h"
+#include "CompiledShaders/DefaultNoTangentQuantizedVS.h"
+#include "CompiledShaders/DefaultNoTangentQuantizedSkinVS.h"
+#include "CompiledShaders/DefaultNoTangentNoUV1QuantizedVS.h"
+#include "CompiledShaders/DefaultNoTangentNoUV1QuantizedSkinVS.h"
 #include "CompiledShaders/DepthOnlyVS.h"
 #include "CompiledShaders/DepthOnlySkinVS.h"
 #include "CompiledShaders/CutoutDepthVS.h"
 #include "CompiledShaders/CutoutDepthSkinVS.h"
 #include "CompiledShaders/CutoutDepthPS.h"
+#include "CompiledShaders/DepthOnlyQuantizedVS.h"
+#include "CompiledShaders/DepthOnlyQuantizedSkinVS.h"
+#include "CompiledShaders/CutoutDepthQuantizedVS.h"
+#include "CompiledShaders/CutoutDepthQuantizedSkinVS.h"
 #include "CompiledShaders/SkyboxVS.h"
 #include "CompiledShaders/SkyboxPS.h"
 
@@ -56,6 +69,7 @@ namespace Renderer
     float DebugFlag = 0.0f;
 
     BoolVar SeparateZPass("Renderer/Separate Z Pass", true);
+    BoolVar ParallelSort("Renderer/Parallel Sort", true);
 
     bool s_Initialized = false;
 
@@ -113,6 +127,7 @@ void Renderer::Initialize(void)
     m_RootSig[kCommonSRVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 10, 11, D3D12_SHADER_VISIBILITY_PIXEL);
     m_RootSig[kCommonCBV].InitAsConstantBuffer(1);
     m_RootSig[kSkinMatrices].InitAsBufferSRV(20, D3D12_SHADER_VISIBILITY_VERTEX);
+    m_RootSig[kVertexDequantization].InitAsConstants(2, sizeof(VertexQuantization::Dequantization) / 4, D3D12_SHADER_VISIBILITY_VERTEX);
     m_RootSig.Finalize(L"RootSig", D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
     DXGI_FORMAT ColorFormat = g_SceneColorBuffer.GetFormat();
@@ -269,6 +284,63 @@ void Renderer::Initialize(void)
 
     ASSERT(sm_PSOs.size() == 16);
 
+    // Quantized PSOs, the same as the 16 above with 16-bit positions and UVs
+
+    D3D12_INPUT_ELEMENT_DESC quantizedPosOnly[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    };
+
+    D3D12_INPUT_ELEMENT_DESC quantizedPosAndUV[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    };
+
+    D3D12_INPUT_ELEMENT_DESC quantizedSkinPos[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "BLENDINDICES", 0, DXGI_FORMAT_R16G16B16A16_UINT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "BLENDWEIGHT", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    };
+
+    D3D12_INPUT_ELEMENT_DESC quantizedSkinPosAndUV[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "BLENDINDICES", 0, DXGI_FORMAT_R16G16B16A16_UINT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "BLENDWEIGHT", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    };
+
+    // 16 - 31, indexed like 0 - 15 by alpha test (1), skinning (2), two-sided (4) and shadows (8)
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        GraphicsPSO QuantizedDepthPSO = sm_PSOs[i];
+        switch (i & 3)
+        {
+        case 0:
+            QuantizedDepthPSO.SetInputLayout(_countof(quantizedPosOnly), quantizedPosOnly);
+            QuantizedDepthPSO.SetVertexShader(g_pDepthOnlyQuantizedVS, sizeof(g_pDepthOnlyQuantizedVS));
+            break;
+        case 1:
+            QuantizedDepthPSO.SetInputLayout(_countof(quantizedPosAndUV), quantizedPosAndUV);
+            QuantizedDepthPSO.SetVertexShader(g_pCutoutDepthQuantizedVS, sizeof(g_pCutoutDepthQuantizedVS));
+            break;
+        case 2:
+            QuantizedDepthPSO.SetInputLayout(_countof(quantizedSkinPos), quantizedSkinPos);
+            QuantizedDepthPSO.SetVertexShader(g_pDepthOnlyQuantizedSkinVS, sizeof(g_pDepthOnlyQuantizedSkinVS));
+            break;
+        case 3:
+            QuantizedDepthPSO.SetInputLayout(_countof(quantizedSkinPosAndUV), quantizedSkinPosAndUV);
+            QuantizedDepthPSO.SetVertexShader(g_pCutoutDepthQuantizedSkinVS, sizeof(g_pCutoutDepthQuantizedSkinVS));
+            break;
+        }
+        QuantizedDepthPSO.Finalize();
+        sm_PSOs.push_back(QuantizedDepthPSO);
+    }
+
+    ASSERT(sm_PSOs.size() == 32);
+
     // Default PSO
 
     m_DefaultPSO.SetRootSignature(m_RootSig);
@@ -482,19 +554,27 @@ uint8_t Renderer::GetPSO(uint16_t psoFlags)
     uint16_t Requirements = kHasPosition | kHasNormal;
     ASSERT((psoFlags & Requirements) == Requirements);
 
+    // Quantized vertices keep the tangent in the NORMAL element, see VertexQuantization.h
+    const bool quantized = (psoFlags & kQuantized) != 0;
+    const DXGI_FORMAT positionFormat = quantized ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R32G32B32_FLOAT;
+    const DXGI_FORMAT uvFormat = quantized ? DXGI_FORMAT_R16G16_UNORM : DXGI_FORMAT_R16G16_FLOAT;
+    DXGI_FORMAT normalFormat = DXGI_FORMAT_R10G10B10A2_UNORM;
+    if (quantized)
+        normalFormat = (psoFlags & kCompactNormals) ? DXGI_FORMAT_R8G8B8A8_SNORM : DXGI_FORMAT_R16G16B16A16_SNORM;
+
     std::vector<D3D12_INPUT_ELEMENT_DESC> vertexLayout;
     if (psoFlags & kHasPosition)
-        vertexLayout.push_back({"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT});
+        vertexLayout.push_back({"POSITION", 0, positionFormat,                 0, D3D12_APPEND_ALIGNED_ELEMENT});
     if (psoFlags & kHasNormal)
-        vertexLayout.push_back({"NORMAL",   0, DXGI_FORMAT_R10G10B10A2_UNORM,  0, D3D12_APPEND_ALIGNED_ELEMENT});
-    if (psoFlags & kHasTangent)
+        vertexLayout.push_back({"NORMAL",   0, normalFormat,                   0, D3D12_APPEND_ALIGNED_ELEMENT});
+    if ((psoFlags & kHasTangent) && !quantized)
         vertexLayout.push_back({"TANGENT",  0, DXGI_FORMAT_R10G10B10A2_UNORM,  0, D3D12_APPEND_ALIGNED_ELEMENT});
     if (psoFlags & kHasUV0)
-        vertexLayout.push_back({"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,       0, D3D12_APPEND_ALIGNED_ELEMENT});
+        vertexLayout.push_back({"TEXCOORD", 0, uvFormat,                       0, D3D12_APPEND_ALIGNED_ELEMENT});
     else
-        vertexLayout.push_back({"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,       1, D3D12_APPEND_ALIGNED_ELEMENT});
+        vertexLayout.push_back({"TEXCOORD", 0, uvFormat,                       1, D3D12_APPEND_ALIGNED_ELEMENT});
     if (psoFlags & kHasUV1)
-        vertexLayout.push_back({"TEXCOORD", 1, DXGI_FORMAT_R16G16_FLOAT,       0, D3D12_APPEND_ALIGNED_ELEMENT});
+        vertexLayout.push_back({"TEXCOORD", 1, uvFormat,                       0, D3D12_APPEND_ALIGNED_ELEMENT});
     if (psoFlags & kHasSkin)
     {
         vertexLayout.push_back({ "BLENDINDICES", 0, DXGI_FORMAT_R16G16B16A16_UINT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
@@ -509,12 +589,18 @@ uint8_t Renderer::GetPSO(uint16_t psoFlags)
         {
             if (psoFlags & kHasUV1)
             {
-                ColorPSO.SetVertexShader(g_pDefaultSkinVS, sizeof(g_pDefaultSkinVS));
+                if (quantized)
+                    ColorPSO.SetVertexShader(g_pDefaultQuantizedSkinVS, sizeof(g_pDefaultQuantizedSkinVS));
+                else
+                    ColorPSO.SetVertexShader(g_pDefaultSkinVS, sizeof(g_pDefaultSkinVS));
                 ColorPSO.SetPixelShader(g_pDefaultPS, sizeof(g_pDefaultPS));
             }
             else
             {
-                ColorPSO.SetVertexShader(g_pDefaultNoUV1SkinVS, sizeof(g_pDefaultNoUV1SkinVS));
+                if (quantized)
+                    ColorPSO.SetVertexShader(g_pDefaultNoUV1QuantizedSkinVS, sizeof(g_pDefaultNoUV1QuantizedSkinVS));
+                else
+                    ColorPSO.SetVertexShader(g_pDefaultNoUV1SkinVS, sizeof(g_pDefaultNoUV1SkinVS));
                 ColorPSO.SetPixelShader(g_pDefaultNoUV1PS, sizeof(g_pDefaultNoUV1PS));
             }
         }
@@ -522,12 +608,18 @@ uint8_t Renderer::GetPSO(uint16_t psoFlags)
         {
             if (psoFlags & kHasUV1)
             {
-                ColorPSO.SetVertexShader(g_pDefaultNoTangentSkinVS, sizeof(g_pDefaultNoTangentSkinVS));
+                if (quantized)
+                    ColorPSO.SetVertexShader(g_pDefaultNoTangentQuantizedSkinVS, sizeof(g_pDefaultNoTangentQuantizedSkinVS));
+                else
+                    ColorPSO.SetVertexShader(g_pDefaultNoTangentSkinVS, sizeof(g_pDefaultNoTangentSkinVS));
                 ColorPSO.SetPixelShader(g_pDefaultNoTangentPS, sizeof(g_pDefaultNoTangentPS));
             }
             else
             {
-                ColorPSO.SetVertexShader(g_pDefaultNoTangentNoUV1SkinVS, sizeof(g_pDefaultNoTangentNoUV1SkinVS));
+                if (quantized)
+                    ColorPSO.SetVertexShader(g_pDefaultNoTangentNoUV1QuantizedSkinVS, sizeof(g_pDefaultNoTangentNoUV1QuantizedSkinVS));
+                else
+                    ColorPSO.SetVertexShader(g_pDefaultNoTangentNoUV1SkinVS, sizeof(g_pDefaultNoTangentNoUV1SkinVS));
                 ColorPSO.SetPixelShader(g_pDefaultNoTangentNoUV1PS, sizeof(g_pDefaultNoTangentNoUV1PS));
             }
         }
@@ -538,12 +630,18 @@ uint8_t Renderer::GetPSO(uint16_t psoFlags)
         {
             if (psoFlags & kHasUV1)
             {
-                ColorPSO.SetVertexShader(g_pDefaultVS, sizeof(g_pDefaultVS));
+                if (quantized)
+                    ColorPSO.SetVertexShader(g_pDefaultQuantizedVS, sizeof(g_pDefaultQuantizedVS));
+                else
+                    ColorPSO.SetVertexShader(g_pDefaultVS, sizeof(g_pDefaultVS));
                 ColorPSO.SetPixelShader(g_pDefaultPS, sizeof(g_pDefaultPS));
             }
             else
             {
-                ColorPSO.SetVertexShader(g_pDefaultNoUV1VS, sizeof(g_pDefaultNoUV1VS));
+                if (quantized)
+                    ColorPSO.SetVertexShader(g_pDefaultNoUV1QuantizedVS, sizeof(g_pDefaultNoUV1QuantizedVS));
+                else
+                    ColorPSO.SetVertexShader(g_pDefaultNoUV1VS, sizeof(g_pDefaultNoUV1VS));
                 ColorPSO.SetPixelShader(g_pDefaultNoUV1PS, sizeof(g_pDefaultNoUV1PS));
             }
         }
@@ -551,12 +649,18 @@ uint8_t Renderer::GetPSO(uint16_t psoFlags)
         {
             if (psoFlags & kHasUV1)
             {
-                ColorPSO.SetVertexShader(g_pDefaultNoTangentVS, sizeof(g_pDefaultNoTangentVS));
+                if (quantized)
+                    ColorPSO.SetVertexShader(g_pDefaultNoTangentQuantizedVS, sizeof(g_pDefaultNoTangentQuantizedVS));
+                else
+                    ColorPSO.SetVertexShader(g_pDefaultNoTangentVS, sizeof(g_pDefaultNoTangentVS));
                 ColorPSO.SetPixelShader(g_pDefaultNoTangentPS, sizeof(g_pDefaultNoTangentPS));
             }
             else
             {
-                ColorPSO.SetVertexShader(g_pDefaultNoTangentNoUV1VS, sizeof(g_pDefaultNoTangentNoUV1VS));
+                if (quantized)
+                    ColorPSO.SetVertexShader(g_pDefaultNoTangentNoUV1QuantizedVS, sizeof(g_pDefaultNoTangentNoUV1QuantizedVS));
+                else
+                    ColorPSO.SetVertexShader(g_pDefaultNoTangentNoUV1VS, sizeof(g_pDefaultNoTangentNoUV1VS));
                 ColorPSO.SetPixelShader(g_pDefaultNoTangentNoUV1PS, sizeof(g_pDefaultNoTangentNoUV1PS));
             }
         }
@@ -648,7 +752,9 @@ void MeshSorter::AddMesh( const Mesh& mesh, float distance,
     bool skinned = (mesh.psoFlags & PSOFlags::kHasSkin) == PSOFlags::kHasSkin;
     bool twoSided = (mesh.psoFlags & PSOFlags::kTwoSided) == PSOFlags::kTwoSided;
 
-    uint64_t depthPSO = (skinned ? 2 : 0) + (alphaTest ? 1 : 0) + (twoSided ? 4 : 0);
+    bool quantized = (mesh.psoFlags & PSOFlags::kQuantized) == PSOFlags::kQuantized;
+
+    uint64_t depthPSO = (skinned ? 2 : 0) + (alphaTest ? 1 : 0) + (twoSided ? 4 : 0) + (quantized ? 16 : 0);
     uint64_t shadowedDepthPSO = depthPSO + 8;
 
     union float_or_int { float f; uint32_t u; } dist;
@@ -702,8 +808,19 @@ void MeshSorter::AddMesh( const Mesh& mesh, float distance,
 
 void MeshSorter::Sort()
 {
-    struct { bool operator()(uint64_t a, uint64_t b) const { return a < b; } } Cmp;
-    std::sort(m_SortKeys.begin(), m_SortKeys.end(), Cmp);
+    // Digits follow the SortKey fields:  objectIdx (2 x 8 bits), psoIdx (12 bits), key (32 bits
+    // in 11, 11 and 10 bit digits) and passID (4 bits).  Object indices are assigned in the
+    // order keys are added, so their two passes are normally skipped.
+    static const RadixSort::Digit kSortKeyDigits[] =
+    {
+        { 0, 8 }, { 8, 8 }, { 16, 12 }, { 28, 11 }, { 39, 11 }, { 50, 10 }, { 60, 4 }
+    };
+
+    // Reused by every sorter on this thread so that sorting does not allocate each frame
+    static thread_local RadixSort::Scratch s_SortScratch;
+
+    RadixSort::Sort(m_SortKeys.data(), m_SortKeys.size(), kSortKeyDigits, _countof(kSortKeyDigits),
+        s_SortScratch, ParallelSort ? 0 : 1);
 }
 
 void MeshSorter::RenderMeshes(
@@ -833,6 +950,7 @@ void MeshSorter::RenderMeshes(
             key.value = m_SortKeys[m_CurrentDraw];
             const SortObject& object = m_SortObjects[key.objectIdx];
             const Mesh& mesh = *object.mesh;
+            const bool quantized = (mesh.psoFlags & PSOFlags::kQuantized) == PSOFlags::kQuantized;
 
             context.SetConstantBuffer(kMeshConstants, object.meshCBV);
             context.SetConstantBuffer(kMaterialConstants, object.materialCBV);
@@ -845,23 +963,38 @@ void MeshSorter::RenderMeshes(
             }
             context.SetPipelineState(sm_PSOs[key.psoIdx]);
 
-            if (m_CurrentPass == kZPass)
+            // Depth-only passes draw the welded depth vertices with their own indices
+            const bool depthOnly = m_CurrentPass == kZPass;
+            if (depthOnly)
             {
                 bool alphaTest = (mesh.psoFlags & PSOFlags::kAlphaTest) == PSOFlags::kAlphaTest;
-                uint32_t stride = alphaTest ? 16u : 12u;
+                uint32_t stride = quantized ? VertexQuantization::kPositionSize : 12u;
+                if (alphaTest)
+                    stride += 4;
                 if (mesh.numJoints > 0)
                     stride += 16;
                 context.SetVertexBuffer(0, {object.bufferPtr + mesh.vbDepthOffset, mesh.vbDepthSize, stride});
+                context.SetIndexBuffer({object.bufferPtr + mesh.ibDepthOffset, mesh.ibDepthSize, (DXGI_FORMAT)mesh.ibFormat});
             }
             else
             {
                 context.SetVertexBuffer(0, {object.bufferPtr + mesh.vbOffset, mesh.vbSize, mesh.vbStride});
+                context.SetIndexBuffer({object.bufferPtr + mesh.ibOffset, mesh.ibSize, (DXGI_FORMAT)mesh.ibFormat});
             }
 
-            context.SetIndexBuffer({object.bufferPtr + mesh.ibOffset, mesh.ibSize, (DXGI_FORMAT)mesh.ibFormat});
-
             for (uint32_t i = 0; i < mesh.numDraws; ++i)
-                context.DrawIndexed(mesh.draw[i].primCount, mesh.draw[i].startIndex, mesh.draw[i].baseVertex);
+            {
+                const Mesh::Draw& draw = mesh.draw[i];
+                if (quantized)
+                {
+                    context.SetConstantArray(kVertexDequantization, sizeof(VertexQuantization::Dequantization) / 4,
+                        &draw.dequantization);
+                }
+                if (depthOnly)
+                    context.DrawIndexed(draw.depthPrimCount, draw.depthStartIndex, draw.depthBaseVertex);
+                else
+                    context.DrawIndexed(draw.primCount, draw.startIndex, draw.baseVertex);
+            }
 
             ++m_CurrentDraw;
         }
@@ -61,6 +61,7 @@ namespace Renderer
         kCommonSRVs,
         kCommonCBV,
         kSkinMatrices,
+        kVertexDequantization,
 
         kNumRootBindings
     };
@@ -113,6 +114,9 @@ namespace Renderer
         const Frustum& GetWorldFrustum() const { return m_Camera->GetWorldSpaceFrustum(); }
         const Frustum& GetViewFrustum() const { return m_Camera->GetViewSpaceFrustum(); }
         const Matrix4& GetViewMatrix() const { return m_Camera->GetViewMatrix(); }
+        const Matrix4& GetProjMatrix() const { return m_Camera->GetProjMatrix(); }
+        const D3D12_VIEWPORT& GetViewport() const { return m_Viewport; }
+        BatchType GetBatchType() const { return m_BatchType; }
 
         void AddMesh( const Mesh& mesh, float distance,
             D3D12_GPU_VIRTUAL_ADDRESS meshCBV,
@@ -0,0 +1,170 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+// This file has no engine dependencies so that it can also be built into the
+// standalone scene graph check (see Tools/SceneGraphUpdateCheck).
+
+#include "SceneGraphSchedule.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+    class Barrier
+    {
+    public:
+        explicit Barrier(uint32_t count) : m_Count(count), m_Waiting(0), m_Generation(0) {}
+
+        void Wait()
+        {
+            if (m_Count == 1)
+                return;
+
+            unique_lock<mutex> lock(m_Mutex);
+            uint32_t generation = m_Generation;
+            if (++m_Waiting == m_Count)
+            {
+                m_Waiting = 0;
+                ++m_Generation;
+                m_Condition.notify_all();
+            }
+            else
+            {
+                m_Condition.wait(lock, [&]() { return generation != m_Generation; });
+            }
+        }
+
+    private:
+        mutex m_Mutex;
+        condition_variable m_Condition;
+        uint32_t m_Count;
+        uint32_t m_Waiting;
+        uint32_t m_Generation;
+    };
+
+    // The range of 'count' items that thread 't' of 'numThreads' handles, or all of them for
+    // thread 0 when the range is too small to split
+    void SplitRange(uint32_t count, uint32_t t, uint32_t numThreads, uint32_t minItemsPerThread,
+        uint32_t& begin, uint32_t& end)
+    {
+        const uint32_t numSplits = max(1u, min(numThreads, count / max(minItemsPerThread, 1u)));
+        if (t >= numSplits)
+        {
+            begin = end = 0;
+            return;
+        }
+        begin = (uint32_t)((uint64_t)count * t / numSplits);
+        end = (uint32_t)((uint64_t)count * (t + 1) / numSplits);
+    }
+}
+
+void SceneGraphSchedule::BuildLevels(uint32_t numScheduled, Schedule& schedule)
+{
+    // Parents come first, so depths resolve in one pass
+    vector<uint32_t> depths(numScheduled);
+    uint32_t numLevels = 0;
+    for (uint32_t i = 0; i < numScheduled; ++i)
+    {
+        const uint32_t parent = schedule.Parents[i];
+        depths[i] = parent == kNoParent ? 0 : depths[parent] + 1;
+        numLevels = max(numLevels, depths[i] + 1);
+    }
+
+    // Counting sort by depth keeps memory order within a level
+    schedule.LevelStarts.assign(numLevels + 1, 0);
+    for (uint32_t i = 0; i < numScheduled; ++i)
+        ++schedule.LevelStarts[depths[i] + 1];
+    for (uint32_t level = 0; level < numLevels; ++level)
+        schedule.LevelStarts[level + 1] += schedule.LevelStarts[level];
+
+    vector<uint32_t> next(schedule.LevelStarts.begin(), schedule.LevelStarts.end() - 1);
+    schedule.Order.resize(numScheduled);
+    for (uint32_t i = 0; i < numScheduled; ++i)
+        schedule.Order[next[depths[i]]++] = i;
+}
+
+void SceneGraphSchedule::Execute(const Schedule& schedule, uint32_t numThreads, uint32_t minItemsPerThread,
+    const function<void(const uint32_t* nodes, uint32_t count)>& visit,
+    uint32_t numFinishItems, const function<void(uint32_t begin, uint32_t end)>& finish)
+{
+    const uint32_t numLevels = schedule.GetNumLevels();
+
+    // Only start threads that at least one level or the finishing work can keep busy. A graph
+    // with no such level, which is most of them, is updated on the calling thread alone.
+    uint32_t maxItems = numFinishItems;
+    for (uint32_t level = 0; level < numLevels; ++level)
+        maxItems = max(maxItems, schedule.LevelStarts[level + 1] - schedule.LevelStarts[level]);
+    numThreads = max(1u, min(numThreads, maxItems / max(minItemsPerThread, 1u)));
+
+    if (numThreads == 1)
+    {
+        if (!schedule.Order.empty())
+            visit(schedule.Order.data(), (uint32_t)schedule.Order.size());
+        if (numFinishItems > 0)
+            finish(0, numFinishItems);
+        return;
+    }
+
+    // Levels too small to split run on thread 0 only. Between two of them, and between the
+    // last of them and finishing work that is not split either, no thread needs to wait.
+    auto isSplit = [&](uint32_t count) { return count / max(minItemsPerThread, 1u) > 1; };
+    vector<bool> waitAfter(numLevels);
+    for (uint32_t level = 0; level < numLevels; ++level)
+    {
+        const uint32_t nextCount = level + 1 < numLevels ?
+            schedule.LevelStarts[level + 2] - schedule.LevelStarts[level + 1] : numFinishItems;
+        waitAfter[level] = isSplit(schedule.LevelStarts[level + 1] - schedule.LevelStarts[level]) || isSplit(nextCount);
+    }
+
+    Barrier barrier(numThreads);
+
+    auto worker = [&](uint32_t t)
+    {
+        uint32_t begin, end;
+        for (uint32_t level = 0; level < numLevels; ++level)
+        {
+            const uint32_t levelStart = schedule.LevelStarts[level];
+            SplitRange(schedule.LevelStarts[level + 1] - levelStart, t, numThreads, minItemsPerThread, begin, end);
+            if (end > begin)
+                visit(schedule.Order.data() + levelStart + begin, end - begin);
+
+            if (waitAfter[level])
+                barrier.Wait();
+        }
+
+        SplitRange(numFinishItems, t, numThreads, minItemsPerThread, begin, end);
+        if (end > begin)
+            finish(begin, end);
+    };
+
+    vector<thread> workers;
+    workers.reserve(numThreads - 1);
+    for (uint32_t t = 1; t < numThreads; ++t)
+        workers.emplace_back(worker, t);
+    worker(0);
+
+    for (thread& w : workers)
+        w.join();
+}
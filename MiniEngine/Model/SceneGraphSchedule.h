@@ -0,0 +1,101 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+//
+// Level order schedule for updating a scene graph, used by ModelInstance::Update.
+//
+// Scene graph nodes are stored depth first, and each node only records whether the next node
+// is its first child and whether it has a later sibling. Walking that layout needs a stack and
+// is inherently serial. The schedule resolves it once per model into a parent index per node
+// and groups the nodes by depth, so every node of a level can be updated in parallel once the
+// level above is done. There is no limit on the depth of the graph.
+//
+// This has no engine dependencies so that it can also be built into the standalone check
+// (see Tools/SceneGraphUpdateCheck).
+//
+namespace SceneGraphSchedule
+{
+    static const uint32_t kNoParent = 0xFFFFFFFF;
+
+    struct Schedule
+    {
+        std::vector<uint32_t> Parents;      // Per node, the parent node or kNoParent
+        std::vector<uint32_t> Order;        // Scheduled nodes level by level, in memory order within a level
+        std::vector<uint32_t> LevelStarts;  // Offsets into Order, one per level plus the end
+
+        uint32_t GetNumLevels() const { return LevelStarts.empty() ? 0 : (uint32_t)LevelStarts.size() - 1; }
+    };
+
+    // Fills Order and LevelStarts from the first 'numScheduled' entries of Parents, which must
+    // list every parent before its children
+    void BuildLevels(uint32_t numScheduled, Schedule& schedule);
+
+    // Walks the depth first layout exactly like the original matrix stack traversal, which ends
+    // at the first node without children or later siblings once no ancestor has a sibling left.
+    // Nodes after that are not scheduled. NodeType needs hasChildren and hasSibling members.
+    template <typename NodeType>
+    void Build(const NodeType* nodes, uint32_t numNodes, Schedule& schedule)
+    {
+        schedule.Parents.assign(numNodes, kNoParent);
+
+        std::vector<uint32_t> stack;
+        uint32_t parent = kNoParent;
+        uint32_t numScheduled = numNodes;
+
+        for (uint32_t i = 0; i < numNodes; ++i)
+        {
+            schedule.Parents[i] = parent;
+
+            if (nodes[i].hasChildren)
+            {
+                if (nodes[i].hasSibling)
+                    stack.push_back(parent);
+                parent = i;
+            }
+            else if (!nodes[i].hasSibling)
+            {
+                if (stack.empty())
+                {
+                    numScheduled = i + 1;
+                    break;
+                }
+                parent = stack.back();
+                stack.pop_back();
+            }
+        }
+
+        BuildLevels(numScheduled, schedule);
+    }
+
+    // Calls 'visit' on ranges of Order, a level at a time. With more than one thread, each level
+    // is split into contiguous ranges and the next level starts only after all of them are done.
+    // Then 'finish' is called on ranges of [0, numFinishItems), for work that needs every node,
+    // such as skinning matrices. Ranges smaller than 'minItemsPerThread' are not split, and no
+    // threads are started unless some level or the finishing work is large enough to split.
+    void Execute(const Schedule& schedule, uint32_t numThreads, uint32_t minItemsPerThread,
+        const std::function<void(const uint32_t* nodes, uint32_t count)>& visit,
+        uint32_t numFinishItems, const std::function<void(uint32_t begin, uint32_t end)>& finish);
+}
@@ -28,6 +28,7 @@
     "DescriptorTable(SRV(t10, numDescriptors = 11), visibility = SHADER_VISIBILITY_PIXEL)," \
     "CBV(b1), " \
     "SRV(t20, visibility = SHADER_VISIBILITY_VERTEX), " \
+    "RootConstants(num32BitConstants = 12, b2, visibility = SHADER_VISIBILITY_VERTEX), " \
     "StaticSampler(s10, maxAnisotropy = 8, visibility = SHADER_VISIBILITY_PIXEL)," \
     "StaticSampler(s11, visibility = SHADER_VISIBILITY_PIXEL," \
         "addressU = TEXTURE_ADDRESS_CLAMP," \
@@ -44,6 +45,17 @@ SamplerComparisonState shadowSampler : register(s11);
 SamplerState cubeMapSampler : register(s12);
 SamplerState clampSampler : register(s13);
 
+// Inverse of the octahedral mapping used for quantized normals and tangents. Matches
+// VertexQuantization::OctahedralDecode on the CPU.
+float3 OctahedralDecode(float2 e)
+{
+    float3 v = float3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.x += v.x >= 0.0 ? -t : t;
+    v.y += v.y >= 0.0 ? -t : t;
+    return normalize(v);
+}
+
 #ifndef ENABLE_TRIANGLE_ID
     #define ENABLE_TRIANGLE_ID 0
 #endif
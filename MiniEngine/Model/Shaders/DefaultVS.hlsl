@@ -42,12 +42,27 @@ struct Joint
 StructuredBuffer<Joint> Joints : register(t20);
 #endif
 
+#ifdef ENABLE_QUANTIZATION
+// See VertexQuantization.h
+cbuffer VertexDequantization : register(b2)
+{
+    float3 PositionScale;
+    float3 PositionBias;
+    float4 UVScaleBias;
+}
+#endif
+
 struct VSInput
 {
+#ifdef ENABLE_QUANTIZATION
+    float4 position : POSITION;     // Tangent handedness in w
+    float4 frame : NORMAL;          // Octahedral normal in xy, tangent in zw
+#else
     float3 position : POSITION;
     float3 normal : NORMAL;
 #ifndef NO_TANGENT_FRAME
     float4 tangent : TANGENT;
+#endif
 #endif
     float2 uv0 : TEXCOORD0;
 #ifndef NO_SECOND_UV
@@ -79,11 +94,19 @@ VSOutput main(VSInput vsInput)
 {
     VSOutput vsOutput;
 
+#ifdef ENABLE_QUANTIZATION
+    float4 position = float4(vsInput.position.xyz * PositionScale + PositionBias, 1.0);
+    float3 normal = OctahedralDecode(vsInput.frame.xy);
+#ifndef NO_TANGENT_FRAME
+    float4 tangent = float4(OctahedralDecode(vsInput.frame.zw), vsInput.position.w * 2 - 1);
+#endif
+#else
     float4 position = float4(vsInput.position, 1.0);
     float3 normal = vsInput.normal * 2 - 1;
 #ifndef NO_TANGENT_FRAME
     float4 tangent = vsInput.tangent * 2 - 1;
 #endif
+#endif
 
 #ifdef ENABLE_SKINNING
     // I don't like this hack.  The weights should be normalized already, but something is fishy.
@@ -117,9 +140,16 @@ VSOutput main(VSInput vsInput)
 #ifndef NO_TANGENT_FRAME
     vsOutput.tangent = float4(mul(WorldIT, tangent.xyz), tangent.w);
 #endif
+#ifdef ENABLE_QUANTIZATION
+    vsOutput.uv0 = vsInput.uv0 * UVScaleBias.xy + UVScaleBias.zw;
+#ifndef NO_SECOND_UV
+    vsOutput.uv1 = vsInput.uv1 * UVScaleBias.xy + UVScaleBias.zw;
+#endif
+#else
     vsOutput.uv0 = vsInput.uv0;
 #ifndef NO_SECOND_UV
     vsOutput.uv1 = vsInput.uv1;
+#endif
 #endif
 
     return vsOutput;
@@ -38,9 +38,23 @@ struct Joint
 StructuredBuffer<Joint> Joints : register(t20);
 #endif
 
+#ifdef ENABLE_QUANTIZATION
+// See VertexQuantization.h
+cbuffer VertexDequantization : register(b2)
+{
+    float3 PositionScale;
+    float3 PositionBias;
+    float4 UVScaleBias;
+}
+#endif
+
 struct VSInput
 {
+#ifdef ENABLE_QUANTIZATION
+    float4 position : POSITION;
+#else
     float3 position : POSITION;
+#endif
 #ifdef ENABLE_ALPHATEST
     float2 uv0 : TEXCOORD0;
 #endif
@@ -63,7 +77,11 @@ VSOutput main(VSInput vsInput)
 {
     VSOutput vsOutput;
 
+#ifdef ENABLE_QUANTIZATION
+    float4 position = float4(vsInput.position.xyz * PositionScale + PositionBias, 1.0);
+#else
     float4 position = float4(vsInput.position, 1.0);
+#endif
 
 #ifdef ENABLE_SKINNING
     // I don't like this hack.  The weights should be normalized already, but something is fishy.
@@ -83,7 +101,11 @@ VSOutput main(VSInput vsInput)
     vsOutput.position = mul(ViewProjMatrix, float4(worldPos, 1.0));
 
 #ifdef ENABLE_ALPHATEST
+#ifdef ENABLE_QUANTIZATION
+    vsOutput.uv0 = vsInput.uv0 * UVScaleBias.xy + UVScaleBias.zw;
+#else
     vsOutput.uv0 = vsInput.uv0;
+#endif
 #endif
 
     return vsOutput;
@@ -0,0 +1,905 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// This file has no engine dependencies so that it can also be built into the
+// standalone texture cache check (see Tools/TextureCacheCheck).
+
+#include "TextureCache.h"
+#include "../Core/Utf8.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <direct.h>
+#include <process.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+    const size_t kChunkSize = 1 << 20;
+    const char* kIndexHeader = "TextureCache 2";
+    const char* kIndexHeaderV1 = "TextureCache 1";     // Entries only, still read
+
+    // Hashes of files are remembered for files last modified at least this long ago, so that
+    // a file rewritten within the resolution of its time stamp is not mistaken for the old one
+    const int64_t kSettledSeconds = 2;
+
+    // Files whose hash is remembered, the least recently used are forgotten first
+    const size_t kMaxKnownFiles = 1 << 16;
+
+    // Temporary files this old were left by a process that did not finish writing them
+    const int64_t kStaleTempSeconds = 60 * 60;
+
+    using Utility::WideToUTF8;
+
+#ifdef _WIN32
+    FILE* OpenFile(const wstring& path, const char* mode)
+    {
+        wstring wideMode(mode, mode + strlen(mode));
+        return _wfopen(path.c_str(), wideMode.c_str());
+    }
+
+    bool GetFileInfo(const wstring& path, uint64_t& size, int64_t& modified)
+    {
+        struct _stat64 info;
+        if (_wstat64(path.c_str(), &info) != 0 || (info.st_mode & _S_IFREG) == 0)
+            return false;
+        size = (uint64_t)info.st_size;
+        modified = (int64_t)info.st_mtime;
+        return true;
+    }
+
+    bool RemoveFile(const wstring& path) { return _wremove(path.c_str()) == 0; }
+
+    // Unlike rename on POSIX systems, _wrename does not replace an existing file
+    bool RenameFile(const wstring& from, const wstring& to)
+    {
+        _wremove(to.c_str());
+        return _wrename(from.c_str(), to.c_str()) == 0;
+    }
+
+    bool MakeDirectory(const wstring& path) { return _wmkdir(path.c_str()) == 0 || errno == EEXIST; }
+
+    uint32_t GetProcessId() { return (uint32_t)_getpid(); }
+
+    string GetFullPath(const wstring& path)
+    {
+        wchar_t* fullPath = _wfullpath(nullptr, path.c_str(), 0);
+        if (fullPath == nullptr)
+            return WideToUTF8(path);
+        const string utf8 = WideToUTF8(fullPath);
+        free(fullPath);
+        return utf8;
+    }
+
+    bool ListDirectory(const wstring& path, vector<wstring>& names)
+    {
+        WIN32_FIND_DATAW data;
+        HANDLE find = FindFirstFileW((path + L"/*").c_str(), &data);
+        if (find == INVALID_HANDLE_VALUE)
+            return false;
+        do
+        {
+            if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+                names.push_back(data.cFileName);
+        } while (FindNextFileW(find, &data));
+        FindClose(find);
+        return true;
+    }
+
+    // An exclusive lock on a file, held by one process at a time and released if it exits
+    class FileLock
+    {
+    public:
+        explicit FileLock(const wstring& path)
+        {
+            m_File = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            OVERLAPPED overlapped = {};
+            m_Locked = m_File != INVALID_HANDLE_VALUE && LockFileEx(m_File, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped);
+        }
+
+        ~FileLock()
+        {
+            if (m_Locked)
+            {
+                OVERLAPPED overlapped = {};
+                UnlockFileEx(m_File, 0, 1, 0, &overlapped);
+            }
+            if (m_File != INVALID_HANDLE_VALUE)
+                CloseHandle(m_File);
+        }
+
+    private:
+        HANDLE m_File;
+        bool m_Locked;
+    };
+#else
+    FILE* OpenFile(const wstring& path, const char* mode) { return fopen(WideToUTF8(path).c_str(), mode); }
+
+    bool GetFileInfo(const wstring& path, uint64_t& size, int64_t& modified)
+    {
+        struct stat info;
+        if (stat(WideToUTF8(path).c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+            return false;
+        size = (uint64_t)info.st_size;
+        modified = (int64_t)info.st_mtime;
+        return true;
+    }
+
+    bool RemoveFile(const wstring& path) { return remove(WideToUTF8(path).c_str()) == 0; }
+    bool RenameFile(const wstring& from, const wstring& to) { return rename(WideToUTF8(from).c_str(), WideToUTF8(to).c_str()) == 0; }
+    bool MakeDirectory(const wstring& path) { return mkdir(WideToUTF8(path).c_str(), 0777) == 0 || errno == EEXIST; }
+
+    uint32_t GetProcessId() { return (uint32_t)getpid(); }
+
+    string GetFullPath(const wstring& path)
+    {
+        const string utf8 = WideToUTF8(path);
+        char* fullPath = realpath(utf8.c_str(), nullptr);
+        if (fullPath == nullptr)
+            return utf8;
+        const string result = fullPath;
+        free(fullPath);
+        return result;
+    }
+
+    bool ListDirectory(const wstring& path, vector<wstring>& names)
+    {
+        DIR* dir = opendir(WideToUTF8(path).c_str());
+        if (dir == nullptr)
+            return false;
+
+        // Cache file names are ASCII, so other names only need to stay distinct from them
+        while (dirent* entry = readdir(dir))
+            names.push_back(wstring(entry->d_name, entry->d_name + strlen(entry->d_name)));
+        closedir(dir);
+        return true;
+    }
+
+    // An exclusive lock on a file, held by one process at a time and released if it exits
+    class FileLock
+    {
+    public:
+        explicit FileLock(const wstring& path)
+        {
+            m_File = open(WideToUTF8(path).c_str(), O_RDWR | O_CREAT, 0666);
+            while (m_File >= 0 && flock(m_File, LOCK_EX) != 0 && errno == EINTR)
+                ;
+        }
+
+        ~FileLock()
+        {
+            // Closing releases the lock
+            if (m_File >= 0)
+                close(m_File);
+        }
+
+    private:
+        int m_File;
+    };
+#endif
+
+    bool FileHasSize(const wstring& path, uint64_t size)
+    {
+        uint64_t actualSize;
+        int64_t modified;
+        return GetFileInfo(path, actualSize, modified) && actualSize == size;
+    }
+
+    // Creates every missing directory along the path
+    bool MakeDirectories(const wstring& path)
+    {
+        for (size_t i = 1; i < path.size(); ++i)
+        {
+            if ((path[i] == L'/' || path[i] == L'\\') && path[i - 1] != L':')
+                MakeDirectory(path.substr(0, i));
+        }
+        return MakeDirectory(path);
+    }
+
+    // Copies a file, hashing it the same way as HashFile. 'destination' is null to only hash.
+    bool CopyAndHash(const wstring& source, const wstring* destination, uint64_t& hash, uint64_t& size)
+    {
+        FILE* in = OpenFile(source, "rb");
+        if (in == nullptr)
+            return false;
+
+        FILE* out = destination ? OpenFile(*destination, "wb") : nullptr;
+        if (destination && out == nullptr)
+        {
+            fclose(in);
+            return false;
+        }
+
+        vector<uint8_t> buffer(kChunkSize);
+        bool succeeded = true;
+        hash = 0;
+        size = 0;
+
+        for (;;)
+        {
+            const size_t count = fread(buffer.data(), 1, buffer.size(), in);
+            if (count > 0)
+            {
+                hash = TextureCache::Hash(buffer.data(), count, hash);
+                size += count;
+                if (out && fwrite(buffer.data(), 1, count, out) != count)
+                {
+                    succeeded = false;
+                    break;
+                }
+            }
+            if (count < buffer.size())
+            {
+                succeeded = ferror(in) == 0;
+                break;
+            }
+        }
+
+        fclose(in);
+        if (out && fclose(out) != 0)
+            succeeded = false;
+        return succeeded;
+    }
+
+    const uint64_t kPrime1 = 11400714785074694791ull;
+    const uint64_t kPrime2 = 14029467366897019727ull;
+    const uint64_t kPrime3 = 1609587929392839161ull;
+    const uint64_t kPrime4 = 9650029242287828579ull;
+    const uint64_t kPrime5 = 2870177450012600261ull;
+
+    inline uint64_t RotateLeft(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    inline uint64_t Read64(const uint8_t* p) { uint64_t v; memcpy(&v, p, sizeof(v)); return v; }
+    inline uint32_t Read32(const uint8_t* p) { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+
+    inline uint64_t Round(uint64_t acc, uint64_t input)
+    {
+        acc += input * kPrime2;
+        return RotateLeft(acc, 31) * kPrime1;
+    }
+
+    inline uint64_t MergeRound(uint64_t acc, uint64_t value)
+    {
+        acc ^= Round(0, value);
+        return acc * kPrime1 + kPrime4;
+    }
+}
+
+TextureCache::TextureCache()
+    : m_MaxBytes(0), m_TotalBytes(0), m_UseCounter(0), m_TempCounter(0), m_Dirty(false)
+{
+}
+
+TextureCache::~TextureCache()
+{
+    Flush();
+}
+
+uint64_t TextureCache::Hash(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    const uint8_t* end = p + size;
+    uint64_t h;
+
+    if (size >= 32)
+    {
+        uint64_t v1 = seed + kPrime1 + kPrime2;
+        uint64_t v2 = seed + kPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kPrime1;
+
+        for (; p + 32 <= end; p += 32)
+        {
+            v1 = Round(v1, Read64(p));
+            v2 = Round(v2, Read64(p + 8));
+            v3 = Round(v3, Read64(p + 16));
+            v4 = Round(v4, Read64(p + 24));
+        }
+
+        h = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        h = MergeRound(h, v1);
+        h = MergeRound(h, v2);
+        h = MergeRound(h, v3);
+        h = MergeRound(h, v4);
+    }
+    else
+        h = seed + kPrime5;
+
+    h += (uint64_t)size;
+
+    for (; p + 8 <= end; p += 8)
+        h = RotateLeft(h ^ Round(0, Read64(p)), 27) * kPrime1 + kPrime4;
+    if (p + 4 <= end)
+    {
+        h = RotateLeft(h ^ (Read32(p) * kPrime1), 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+        h = RotateLeft(h ^ (*p * kPrime5), 11) * kPrime1;
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+bool TextureCache::HashFile(const wstring& file, uint64_t& hash, uint64_t& size)
+{
+    return CopyAndHash(file, nullptr, hash, size);
+}
+
+bool TextureCache::HashKnownFile(const wstring& file, uint64_t& size, int64_t modified, uint64_t& hash)
+{
+    const string fullPath = GetFullPath(file);
+    const uint64_t pathHash = Hash(fullPath.data(), fullPath.size());
+    {
+        lock_guard<mutex> lock(m_Mutex);
+
+        auto it = m_KnownFiles.find(pathHash);
+        if (it != m_KnownFiles.end() && it->second.Size == size && it->second.Modified == modified)
+        {
+            hash = it->second.Hash;
+            it->second.LastUse = ++m_UseCounter;
+            m_Dirty = true;
+            return true;
+        }
+    }
+
+    if (!HashFile(file, hash, size))
+        return false;
+
+    // A file that may still be written is hashed again next time
+    lock_guard<mutex> lock(m_Mutex);
+    ++m_Stats.FilesHashed;
+    if (!m_Directory.empty() && modified + kSettledSeconds < (int64_t)time(nullptr))
+    {
+        m_KnownFiles[pathHash] = { size, modified, hash, ++m_UseCounter };
+        m_Dirty = true;
+    }
+    return true;
+}
+
+wstring TextureCache::GetEntryName(const Key& key)
+{
+    char name[80];
+    snprintf(name, sizeof(name), "%016" PRIx64 "-%" PRIx64 "-%02x-%x.dds",
+        key.ContentHash, key.ContentSize, key.Flags, key.EncoderVersion);
+    return wstring(name, name + strlen(name));
+}
+
+wstring TextureCache::GetEntryPath(const wstring& name) const
+{
+    return m_Directory + L"/" + name;
+}
+
+bool TextureCache::Open(const wstring& directory, uint64_t maxBytes)
+{
+    lock_guard<mutex> lock(m_Mutex);
+
+    m_Directory = directory;
+    m_Entries.clear();
+    m_KnownFiles.clear();
+    m_MaxBytes = maxBytes;
+    m_TotalBytes = 0;
+    m_UseCounter = 0;
+    m_Dirty = false;
+    m_Stats = Stats();
+
+    if (maxBytes == 0 || !MakeDirectories(directory))
+    {
+        m_Directory.clear();
+        return false;
+    }
+
+    FileLock indexLock(GetEntryPath(L"index.lock"));
+
+    map<wstring, Entry> entries;
+    LoadIndex(entries, m_KnownFiles);
+    for (const auto& known : m_KnownFiles)
+        m_UseCounter = max(m_UseCounter, known.second.LastUse);
+
+    for (const auto& entry : entries)
+    {
+        if (FileHasSize(GetEntryPath(entry.first), entry.second.Size))
+        {
+            m_Entries.insert(entry);
+            m_TotalBytes += entry.second.Size;
+            m_UseCounter = max(m_UseCounter, entry.second.LastUse);
+        }
+        else
+            m_Dirty = true;
+    }
+
+    ReconcileLocked();
+    EvictLocked(0, wstring());
+    if (m_Dirty)
+        WriteIndexLocked();
+    return true;
+}
+
+void TextureCache::ReconcileLocked()
+{
+    vector<wstring> names;
+    if (!ListDirectory(m_Directory, names))
+        return;
+
+    const int64_t now = (int64_t)time(nullptr);
+    for (const wstring& name : names)
+    {
+        uint64_t size;
+        int64_t modified;
+        if (!GetFileInfo(GetEntryPath(name), size, modified))
+            continue;
+
+        // Left by a process that stopped while it was storing an entry or writing the index
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, L".tmp") == 0)
+        {
+            if (now - modified > kStaleTempSeconds)
+                RemoveFile(GetEntryPath(name));
+            continue;
+        }
+
+        // Stored by a process that stopped before it wrote the index, or whose index was
+        // replaced by another process that had not seen it. It is adopted as the least
+        // recently used entry.
+        const string narrowName(name.begin(), name.end());
+        unsigned long long contentHash, contentSize;
+        unsigned int flags, encoderVersion;
+        if (m_Entries.count(name) != 0 || sscanf(narrowName.c_str(), "%16llx-%llx-%x-%x.dds",
+            &contentHash, &contentSize, &flags, &encoderVersion) != 4)
+        {
+            continue;
+        }
+        const Key key = { contentHash, contentSize, flags, encoderVersion };
+
+        uint64_t outputHash, outputSize;
+        if (GetEntryName(key) != name || !CopyAndHash(GetEntryPath(name), nullptr, outputHash, outputSize))
+            continue;
+
+        m_Entries[name] = { outputSize, outputHash, 0 };
+        m_TotalBytes += outputSize;
+        ++m_Stats.Reconciled;
+        m_Dirty = true;
+    }
+}
+
+bool TextureCache::IsOpen() const
+{
+    lock_guard<mutex> lock(m_Mutex);
+    return !m_Directory.empty();
+}
+
+void TextureCache::Flush()
+{
+    lock_guard<mutex> lock(m_Mutex);
+    if (m_Dirty && !m_Directory.empty())
+        SaveIndexLocked();
+}
+
+const TextureCache::Entry* TextureCache::FindLocked(const wstring& name)
+{
+    auto it = m_Entries.find(name);
+    if (it == m_Entries.end())
+        return nullptr;
+
+    // Deleted or overwritten behind the cache's back
+    if (!FileHasSize(GetEntryPath(name), it->second.Size))
+    {
+        RemoveFile(GetEntryPath(name));
+        m_TotalBytes -= it->second.Size;
+        m_Entries.erase(it);
+        ++m_Stats.Invalidations;
+        m_Dirty = true;
+        return nullptr;
+    }
+
+    it->second.LastUse = ++m_UseCounter;
+    m_Dirty = true;
+    return &it->second;
+}
+
+void TextureCache::EvictLocked(uint64_t bytesNeeded, const wstring& keep)
+{
+    while (m_TotalBytes + bytesNeeded > m_MaxBytes)
+    {
+        auto oldest = m_Entries.end();
+        for (auto it = m_Entries.begin(); it != m_Entries.end(); ++it)
+        {
+            if (it->first != keep && (oldest == m_Entries.end() || it->second.LastUse < oldest->second.LastUse))
+                oldest = it;
+        }
+        if (oldest == m_Entries.end())
+            break;
+
+        RemoveFile(GetEntryPath(oldest->first));
+        m_TotalBytes -= oldest->second.Size;
+        m_Entries.erase(oldest);
+        ++m_Stats.Evictions;
+        m_Dirty = true;
+    }
+}
+
+bool TextureCache::LoadIndex(map<wstring, Entry>& entries, map<uint64_t, KnownFile>& knownFiles) const
+{
+    FILE* file = OpenFile(GetEntryPath(L"index.txt"), "r");
+    if (file == nullptr)
+        return false;
+
+    char line[256];
+    bool valid = fgets(line, sizeof(line), file) != nullptr && (strncmp(line, kIndexHeader, strlen(kIndexHeader)) == 0 ||
+        strncmp(line, kIndexHeaderV1, strlen(kIndexHeaderV1)) == 0);
+
+    while (valid && fgets(line, sizeof(line), file) != nullptr)
+    {
+        char name[128];
+        unsigned long long pathHash, size, hash, lastUse;
+        long long modified;
+        if (strncmp(line, "file ", 5) == 0)
+        {
+            if (sscanf(line + 5, "%llx %llu %lld %llx %llu", &pathHash, &size, &modified, &hash, &lastUse) == 5)
+                knownFiles[pathHash] = { size, modified, hash, lastUse };
+        }
+        else if (sscanf(line, "%127s %llu %llx %llu", name, &size, &hash, &lastUse) == 4)
+            entries[wstring(name, name + strlen(name))] = { size, hash, lastUse };
+    }
+
+    fclose(file);
+    return valid;
+}
+
+bool TextureCache::SaveIndexLocked()
+{
+    // Other processes sharing the directory wait until this one has written the index
+    FileLock indexLock(GetEntryPath(L"index.lock"));
+
+    // Keep what other users of the directory added since the index was read
+    map<wstring, Entry> onDisk;
+    map<uint64_t, KnownFile> knownOnDisk;
+    LoadIndex(onDisk, knownOnDisk);
+
+    for (const auto& known : knownOnDisk)
+    {
+        auto it = m_KnownFiles.find(known.first);
+        if (it == m_KnownFiles.end() || it->second.LastUse < known.second.LastUse)
+            m_KnownFiles[known.first] = known.second;
+        m_UseCounter = max(m_UseCounter, known.second.LastUse);
+    }
+
+    for (const auto& entry : onDisk)
+    {
+        auto it = m_Entries.find(entry.first);
+        if (it != m_Entries.end())
+            it->second.LastUse = max(it->second.LastUse, entry.second.LastUse);
+        else if (FileHasSize(GetEntryPath(entry.first), entry.second.Size))
+        {
+            m_Entries.insert(entry);
+            m_TotalBytes += entry.second.Size;
+        }
+        m_UseCounter = max(m_UseCounter, entry.second.LastUse);
+    }
+
+    EvictLocked(0, wstring());
+
+    if (m_KnownFiles.size() > kMaxKnownFiles)
+    {
+        vector<uint64_t> lastUses;
+        lastUses.reserve(m_KnownFiles.size());
+        for (const auto& known : m_KnownFiles)
+            lastUses.push_back(known.second.LastUse);
+        nth_element(lastUses.begin(), lastUses.end() - kMaxKnownFiles, lastUses.end());
+        const uint64_t oldestKept = *(lastUses.end() - kMaxKnownFiles);
+
+        for (auto it = m_KnownFiles.begin(); it != m_KnownFiles.end(); )
+            it = it->second.LastUse < oldestKept ? m_KnownFiles.erase(it) : next(it);
+    }
+
+    return WriteIndexLocked();
+}
+
+bool TextureCache::WriteIndexLocked()
+{
+    wchar_t suffix[32];
+    swprintf(suffix, 32, L".%u.%u.tmp", GetProcessId(), m_TempCounter++);
+    const wstring tempPath = GetEntryPath(L"index.txt") + suffix;
+
+    FILE* file = OpenFile(tempPath, "w");
+    if (file == nullptr)
+        return false;
+
+    bool succeeded = fprintf(file, "%s\n", kIndexHeader) > 0;
+    for (const auto& entry : m_Entries)
+    {
+        const string name(entry.first.begin(), entry.first.end());
+        succeeded &= fprintf(file, "%s %llu %016llx %llu\n", name.c_str(), (unsigned long long)entry.second.Size,
+            (unsigned long long)entry.second.OutputHash, (unsigned long long)entry.second.LastUse) > 0;
+    }
+    for (const auto& known : m_KnownFiles)
+    {
+        succeeded &= fprintf(file, "file %016llx %llu %lld %016llx %llu\n", (unsigned long long)known.first,
+            (unsigned long long)known.second.Size, (long long)known.second.Modified, (unsigned long long)known.second.Hash,
+            (unsigned long long)known.second.LastUse) > 0;
+    }
+    succeeded &= fclose(file) == 0;
+
+    if (!succeeded || !RenameFile(tempPath, GetEntryPath(L"index.txt")))
+    {
+        RemoveFile(tempPath);
+        return false;
+    }
+
+    m_Dirty = false;
+    return true;
+}
+
+bool TextureCache::Fetch(const Key& key, const wstring& outputFile)
+{
+    const wstring name = GetEntryName(key);
+    wstring entryPath;
+    Entry cached;
+    {
+        lock_guard<mutex> lock(m_Mutex);
+        if (m_Directory.empty())
+            return false;
+
+        const Entry* entry = FindLocked(name);
+        if (entry == nullptr)
+        {
+            ++m_Stats.Misses;
+            return false;
+        }
+        cached = *entry;
+        entryPath = GetEntryPath(name);
+    }
+
+    uint64_t hash, size;
+    if (CopyAndHash(entryPath, &outputFile, hash, size) && hash == cached.OutputHash && size == cached.Size)
+    {
+        lock_guard<mutex> lock(m_Mutex);
+        ++m_Stats.Hits;
+        return true;
+    }
+
+    // Damaged in place without changing size, so the copy is no good either
+    RemoveFile(outputFile);
+    Invalidate(key);
+    lock_guard<mutex> lock(m_Mutex);
+    ++m_Stats.Misses;
+    return false;
+}
+
+bool TextureCache::Store(const Key& key, const wstring& outputFile)
+{
+    const wstring name = GetEntryName(key);
+    wstring tempPath;
+    {
+        lock_guard<mutex> lock(m_Mutex);
+        if (m_Directory.empty())
+            return false;
+
+        wchar_t suffix[32];
+        swprintf(suffix, 32, L".%u.%u.tmp", GetProcessId(), m_TempCounter++);
+        tempPath = GetEntryPath(name) + suffix;
+    }
+
+    // Copy outside the lock so that other textures can be looked up meanwhile
+    uint64_t hash, size;
+    if (!CopyAndHash(outputFile, &tempPath, hash, size))
+    {
+        RemoveFile(tempPath);
+        return false;
+    }
+
+    lock_guard<mutex> lock(m_Mutex);
+
+    auto existing = m_Entries.find(name);
+    if (existing != m_Entries.end())
+    {
+        m_TotalBytes -= existing->second.Size;
+        m_Entries.erase(existing);
+    }
+
+    if (size > m_MaxBytes || !RenameFile(tempPath, GetEntryPath(name)))
+    {
+        RemoveFile(tempPath);
+        RemoveFile(GetEntryPath(name));
+        m_Dirty = true;
+        return false;
+    }
+
+    // The index is written by Flush. An entry stored after that is adopted by the next Open.
+    m_Entries[name] = { size, hash, ++m_UseCounter };
+    m_TotalBytes += size;
+    m_Dirty = true;
+    EvictLocked(0, name);
+    return true;
+}
+
+bool TextureCache::Contains(const Key& key) const
+{
+    lock_guard<mutex> lock(m_Mutex);
+    return m_Entries.find(GetEntryName(key)) != m_Entries.end();
+}
+
+void TextureCache::Invalidate(const Key& key)
+{
+    lock_guard<mutex> lock(m_Mutex);
+
+    auto it = m_Entries.find(GetEntryName(key));
+    if (it == m_Entries.end())
+        return;
+
+    RemoveFile(GetEntryPath(it->first));
+    m_TotalBytes -= it->second.Size;
+    m_Entries.erase(it);
+    ++m_Stats.Invalidations;
+    m_Dirty = true;
+}
+
+void TextureCache::Clear()
+{
+    lock_guard<mutex> lock(m_Mutex);
+    if (m_Directory.empty())
+        return;
+
+    FileLock indexLock(GetEntryPath(L"index.lock"));
+
+    // Entries other processes added are cleared too
+    map<wstring, Entry> onDisk;
+    map<uint64_t, KnownFile> knownOnDisk;
+    LoadIndex(onDisk, knownOnDisk);
+    onDisk.insert(m_Entries.begin(), m_Entries.end());
+
+    for (const auto& entry : onDisk)
+        RemoveFile(GetEntryPath(entry.first));
+
+    m_Entries.clear();
+    m_TotalBytes = 0;
+    WriteIndexLocked();
+}
+
+TextureCache::Stats TextureCache::GetStats() const
+{
+    lock_guard<mutex> lock(m_Mutex);
+
+    Stats stats = m_Stats;
+    stats.NumEntries = (uint32_t)m_Entries.size();
+    stats.TotalBytes = m_TotalBytes;
+    stats.MaxBytes = m_MaxBytes;
+    return stats;
+}
+
+TextureCache::Result TextureCache::Update(const wstring& sourceFile, const wstring& outputFile,
+    uint32_t flags, uint32_t encoderVersion, const function<bool()>& convert)
+{
+    uint64_t sourceSize = 0, outputSize = 0;
+    int64_t sourceTime = 0, outputTime = 0;
+    const bool haveSource = GetFileInfo(sourceFile, sourceSize, sourceTime);
+    const bool haveOutput = GetFileInfo(outputFile, outputSize, outputTime);
+
+    if (!haveSource)
+        return haveOutput ? Result::kSourceMissing : Result::kMissing;
+
+    Key key = { 0, sourceSize, flags, encoderVersion };
+    if (!IsOpen() || !HashKnownFile(sourceFile, key.ContentSize, sourceTime, key.ContentHash))
+    {
+        if (haveOutput && outputTime >= sourceTime)
+            return Result::kUpToDate;
+        return convert() ? Result::kConverted : Result::kFailed;
+    }
+
+    const wstring name = GetEntryName(key);
+    wstring entryPath;
+    Entry cached = {};
+    bool found = false;
+    bool staleOutput = false;
+    {
+        lock_guard<mutex> lock(m_Mutex);
+
+        const Entry* entry = FindLocked(name);
+        if (entry != nullptr)
+        {
+            cached = *entry;
+            entryPath = GetEntryPath(name);
+            found = true;
+            ++m_Stats.Hits;
+        }
+        else
+            ++m_Stats.Misses;
+    }
+
+    uint64_t outputHash = 0;
+    bool outputHashed = false;
+    auto hashOutput = [&]()
+    {
+        if (!outputHashed)
+            outputHashed = HashKnownFile(outputFile, outputSize, outputTime, outputHash);
+        return outputHashed;
+    };
+
+    if (found)
+    {
+        if (haveOutput && outputSize == cached.Size && hashOutput() && outputHash == cached.OutputHash)
+            return Result::kUpToDate;
+
+        uint64_t hash, size;
+        if (CopyAndHash(entryPath, &outputFile, hash, size) && hash == cached.OutputHash)
+            return Result::kRestored;
+
+        // The entry was corrupt, so convert again and replace it
+        Invalidate(key);
+    }
+    else if (haveOutput && outputTime >= sourceTime && hashOutput())
+    {
+        // An output newer than its source was most likely converted from it, unless the
+        // cache knows it came from the same contents with other flags or another encoder
+        lock_guard<mutex> lock(m_Mutex);
+
+        char prefix[40];
+        snprintf(prefix, sizeof(prefix), "%016" PRIx64 "-%" PRIx64 "-", key.ContentHash, key.ContentSize);
+        const wstring widePrefix(prefix, prefix + strlen(prefix));
+
+        for (auto it = m_Entries.lower_bound(widePrefix); it != m_Entries.end() &&
+            it->first.compare(0, widePrefix.size(), widePrefix) == 0; ++it)
+        {
+            staleOutput |= it->second.OutputHash == outputHash;
+        }
+    }
+
+    if (haveOutput && outputTime >= sourceTime && !found && outputHashed && !staleOutput)
+    {
+        Store(key, outputFile);
+        return Result::kAdopted;
+    }
+
+    if (!convert())
+        return Result::kFailed;
+
+    Store(key, outputFile);
+    return Result::kConverted;
+}
@@ -0,0 +1,164 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+//
+// Content addressed store of converted textures, used by CompileTextureOnDemand.
+//
+// Entries are keyed on a hash of the source file contents, the TexConversionFlags and an
+// encoder version, so touching a source file, switching branches or copying assets to
+// another machine does not force block compression to run again. Because the key does not
+// depend on the source path, one cache directory can serve any number of asset roots.
+//
+// The directory holds one file per entry plus an index file listing each entry's size, the
+// hash of the converted output and when it was last used. The total size is bounded, and the
+// least recently used entries are evicted first. Before the index is written it is merged
+// with the copy on disk, so several processes sharing the directory do not drop each
+// other's entries. A lock file makes them take turns at that. Open also adds entry files
+// the index does not list, as left by a process that stopped before writing it. Entries
+// whose file has gone missing or changed size are invalidated when they are looked up.
+//
+// The index also remembers the hash of each source and output file by its full path, size
+// and modification time, so files that have not changed are not read again on every load.
+//
+// This has no engine or DirectXTex dependencies so that it can also be built into the
+// standalone check (see Tools/TextureCacheCheck).
+//
+class TextureCache
+{
+public:
+    struct Key
+    {
+        uint64_t ContentHash;   // Hash of the source file
+        uint64_t ContentSize;
+        uint32_t Flags;         // TexConversionFlags
+        uint32_t EncoderVersion;
+    };
+
+    // What Update did to bring the output file up to date
+    enum class Result
+    {
+        kUpToDate,      // The output already matched the cached conversion
+        kRestored,      // The output was copied from the cache
+        kAdopted,       // An existing output newer than the source was added to the cache
+        kConverted,     // The source was converted and the output added to the cache
+        kSourceMissing, // Only the output exists, so it was kept as is
+        kMissing,       // Neither file exists
+        kFailed,        // The conversion failed
+    };
+
+    struct Stats
+    {
+        uint32_t NumEntries = 0;
+        uint64_t TotalBytes = 0;
+        uint64_t MaxBytes = 0;
+        uint32_t Hits = 0;
+        uint32_t Misses = 0;
+        uint32_t Evictions = 0;
+        uint32_t Invalidations = 0;
+        uint32_t Reconciled = 0;    // Entry files found by Open that the index did not list
+        uint32_t FilesHashed = 0;   // Sources and outputs whose hash was not known
+    };
+
+    TextureCache();
+    ~TextureCache();
+
+    // Creates the directory if needed and loads its index. Entries whose files are missing
+    // are dropped. A size limit of zero disables the cache.
+    bool Open(const std::wstring& directory, uint64_t maxBytes);
+    bool IsOpen() const;
+
+    // Writes the index if entries were used, stored or removed since it was last written.
+    // Store and Invalidate only update the index in memory, and the destructor flushes.
+    void Flush();
+
+    // Brings 'outputFile' up to date with 'sourceFile'. When the cache has no conversion of
+    // the source contents, 'convert' is called to write the output, which is then stored.
+    // Without an open cache this only compares modification times, like before the cache.
+    Result Update(const std::wstring& sourceFile, const std::wstring& outputFile,
+        uint32_t flags, uint32_t encoderVersion, const std::function<bool()>& convert);
+
+    // Copies the cached conversion for 'key' to 'outputFile'. False on a miss, or if the copy
+    // does not match the hash of the stored output, which also invalidates the entry.
+    bool Fetch(const Key& key, const std::wstring& outputFile);
+
+    // Copies 'outputFile' into the cache, evicting least recently used entries as needed.
+    // Files larger than the whole cache are not stored.
+    bool Store(const Key& key, const std::wstring& outputFile);
+
+    bool Contains(const Key& key) const;
+    void Invalidate(const Key& key);
+    void Clear();
+
+    Stats GetStats() const;
+
+    // File name of an entry within the cache directory
+    static std::wstring GetEntryName(const Key& key);
+
+    // 64-bit xxHash of a buffer, and of a whole file read in fixed size chunks
+    static uint64_t Hash(const void* data, size_t size, uint64_t seed = 0);
+    static bool HashFile(const std::wstring& file, uint64_t& hash, uint64_t& size);
+
+private:
+    struct Entry
+    {
+        uint64_t Size;          // Of the converted output
+        uint64_t OutputHash;    // Hash of the converted output
+        uint64_t LastUse;       // Larger is more recent
+    };
+
+    // The hash of a source or output file, valid while its size and modification time match
+    struct KnownFile
+    {
+        uint64_t Size;
+        int64_t Modified;
+        uint64_t Hash;
+        uint64_t LastUse;
+    };
+
+    std::wstring GetEntryPath(const std::wstring& name) const;
+    const Entry* FindLocked(const std::wstring& name);
+    void EvictLocked(uint64_t bytesNeeded, const std::wstring& keep);
+    bool HashKnownFile(const std::wstring& file, uint64_t& size, int64_t modified, uint64_t& hash);
+    void ReconcileLocked();
+    bool LoadIndex(std::map<std::wstring, Entry>& entries, std::map<uint64_t, KnownFile>& knownFiles) const;
+    bool SaveIndexLocked();
+    bool WriteIndexLocked();
+
+    mutable std::mutex m_Mutex;
+    std::wstring m_Directory;
+    std::map<std::wstring, Entry> m_Entries;
+    std::map<uint64_t, KnownFile> m_KnownFiles;    // By hash of the full path
+    uint64_t m_MaxBytes;
+    uint64_t m_TotalBytes;
+    uint64_t m_UseCounter;
+    uint32_t m_TempCounter;
+    bool m_Dirty;
+    Stats m_Stats;
+};
@@ -0,0 +1,471 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// This file has no engine dependencies so that it can also be built into the
+// standalone texture compression benchmark (see Tools/TextureCompressBenchmark).
+
+#include "TextureCompress.h"
+
+// The private DirectXTex headers provide the scanline loaders and block encoders that
+// DirectX::Compress uses, which is what keeps the output identical to it
+#include "DirectXTexP.h"
+#include "BC.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+using namespace DirectX;
+using namespace DirectX::Internal;
+
+namespace
+{
+    // Block rows are grouped into ranges of at least this many blocks
+    const uint32_t kBlocksPerRange = 256;
+
+    // Threads compressing right now, across all concurrent calls
+    std::atomic<uint32_t> s_ThreadsInFlight(0);
+
+    // The calling thread plus helpers for the cores no other call is using, at most 'maxThreads'
+    uint32_t ReserveThreads(uint32_t maxThreads)
+    {
+        const uint32_t numCores = std::max(1u, std::thread::hardware_concurrency());
+        uint32_t inFlight = s_ThreadsInFlight.load();
+        uint32_t numThreads;
+        do
+        {
+            const uint32_t idleCores = numCores > inFlight ? numCores - inFlight : 0;
+            numThreads = std::max(1u, std::min(maxThreads, idleCores));
+        } while (!s_ThreadsInFlight.compare_exchange_weak(inFlight, inFlight + numThreads));
+        return numThreads;
+    }
+
+    const char* kQualityNames[] = { "fast", "balanced", "exhaustive" };
+    static_assert(sizeof(kQualityNames) / sizeof(kQualityNames[0]) == (size_t)TextureCompress::Quality::kNumQualities, "Missing quality name");
+
+    enum ChannelMask : uint32_t
+    {
+        kRed = 1,
+        kGreen = 2,
+        kBlue = 4,
+        kAlpha = 8,
+        kRGB = kRed | kGreen | kBlue,
+        kRGBA = kRGB | kAlpha,
+    };
+
+    struct BlockCodec
+    {
+        BC_ENCODE Encode;           // nullptr for BC1, which takes an alpha threshold
+        BC_DECODE Decode;
+        size_t BlockSize;
+        TEX_FILTER_FLAGS ConvertFlags;
+        uint32_t Channels;
+        bool HDR;
+    };
+
+    // Matches DetermineEncoderSettings in DirectXTexCompress.cpp
+    bool GetCodec(DXGI_FORMAT format, BlockCodec& codec)
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:    codec = { nullptr,         D3DXDecodeBC1,   8,  TEX_FILTER_DEFAULT, kRGBA, false }; break;
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:    codec = { D3DXEncodeBC2,   D3DXDecodeBC2,   16, TEX_FILTER_DEFAULT, kRGBA, false }; break;
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:    codec = { D3DXEncodeBC3,   D3DXDecodeBC3,   16, TEX_FILTER_DEFAULT, kRGBA, false }; break;
+        case DXGI_FORMAT_BC4_UNORM:         codec = { D3DXEncodeBC4U,  D3DXDecodeBC4U,  8,  TEX_FILTER_RGB_COPY_RED, kRed, false }; break;
+        case DXGI_FORMAT_BC4_SNORM:         codec = { D3DXEncodeBC4S,  D3DXDecodeBC4S,  8,  TEX_FILTER_RGB_COPY_RED, kRed, false }; break;
+        case DXGI_FORMAT_BC5_UNORM:         codec = { D3DXEncodeBC5U,  D3DXDecodeBC5U,  16, TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_GREEN, kRed | kGreen, false }; break;
+        case DXGI_FORMAT_BC5_SNORM:         codec = { D3DXEncodeBC5S,  D3DXDecodeBC5S,  16, TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_GREEN, kRed | kGreen, false }; break;
+        case DXGI_FORMAT_BC6H_UF16:         codec = { D3DXEncodeBC6HU, D3DXDecodeBC6HU, 16, TEX_FILTER_DEFAULT, kRGB, true }; break;
+        case DXGI_FORMAT_BC6H_SF16:         codec = { D3DXEncodeBC6HS, D3DXDecodeBC6HS, 16, TEX_FILTER_DEFAULT, kRGB, true }; break;
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:    codec = { D3DXEncodeBC7,   D3DXDecodeBC7,   16, TEX_FILTER_DEFAULT, kRGBA, false }; break;
+        default:                            return false;
+        }
+        return true;
+    }
+
+    // A run of block rows in one image
+    struct BlockRange
+    {
+        uint32_t Image;
+        uint32_t FirstRow;
+        uint32_t NumRows;
+    };
+
+    struct RangeResult
+    {
+        double ColorError = 0.0;    // Sums of squared channel differences
+        double AlphaError = 0.0;
+        double ColorValues = 0.0;   // Number of color channel values in ColorError
+        float Peak = 0.0f;          // Largest color channel magnitude fed to the encoder
+    };
+
+    struct CompressJob
+    {
+        const Image* Src;
+        const Image* Dest;
+        BlockCodec Codec;
+        size_t SrcBytesPerPixel;
+        uint32_t EncodeFlags;
+        bool Measure;
+        std::vector<BlockRange> Ranges;
+        std::vector<RangeResult> Results;
+        std::atomic<bool> Failed;
+    };
+
+    // Loads the 4x4 block at (x, y) and pads partial blocks the way CompressBC does
+    bool LoadBlock(const Image& image, size_t sbpp, size_t x, size_t y, XMVECTOR block[NUM_PIXELS_PER_BLOCK],
+        size_t& pw, size_t& ph)
+    {
+        const uint8_t* pEnd = image.pixels + image.slicePitch;
+        const uint8_t* sptr = image.pixels + y * image.rowPitch + x * sbpp;
+
+        pw = std::min<size_t>(4, image.width - x);
+        ph = std::min<size_t>(4, image.height - y);
+
+        for (size_t t = 0; t < ph; ++t)
+        {
+            const uint8_t* row = sptr + t * image.rowPitch;
+            const size_t bytesToRead = std::min<size_t>(image.rowPitch, static_cast<size_t>(pEnd - row));
+            if (!LoadScanline(&block[t * 4], pw, row, bytesToRead, image.format))
+                return false;
+        }
+
+        static const size_t uSrc[] = { 0, 0, 0, 1 };
+
+        for (size_t t = 0; t < ph; ++t)
+        {
+            for (size_t s = pw; s < 4; ++s)
+                block[(t << 2) | s] = block[(t << 2) | uSrc[s]];
+        }
+
+        for (size_t t = ph; t < 4; ++t)
+        {
+            for (size_t s = 0; s < 4; ++s)
+                block[(t << 2) | s] = block[(uSrc[t] << 2) | s];
+        }
+
+        return true;
+    }
+
+    void CompressRange(CompressJob& job, uint32_t rangeIdx)
+    {
+        const BlockRange& range = job.Ranges[rangeIdx];
+        const Image& src = job.Src[range.Image];
+        const Image& dest = job.Dest[range.Image];
+        const BlockCodec& codec = job.Codec;
+        RangeResult& result = job.Results[rangeIdx];
+
+        XM_ALIGNED_DATA(16) XMVECTOR block[NUM_PIXELS_PER_BLOCK];
+        XM_ALIGNED_DATA(16) XMVECTOR decoded[NUM_PIXELS_PER_BLOCK];
+
+        for (uint32_t row = range.FirstRow; row < range.FirstRow + range.NumRows; ++row)
+        {
+            uint8_t* dptr = dest.pixels + row * dest.rowPitch;
+
+            for (size_t x = 0; x < src.width; x += 4, dptr += codec.BlockSize)
+            {
+                size_t pw, ph;
+                if (!LoadBlock(src, job.SrcBytesPerPixel, x, row * 4, block, pw, ph))
+                {
+                    job.Failed = true;
+                    return;
+                }
+
+                ConvertScanline(block, NUM_PIXELS_PER_BLOCK, dest.format, src.format, codec.ConvertFlags);
+
+                if (codec.Encode)
+                    codec.Encode(dptr, block, job.EncodeFlags);
+                else
+                    D3DXEncodeBC1(dptr, block, TEX_THRESHOLD_DEFAULT, job.EncodeFlags);
+
+                if (!job.Measure)
+                    continue;
+
+                codec.Decode(decoded, dptr);
+
+                // Only the pixels inside the image count, not the padding
+                for (size_t t = 0; t < ph; ++t)
+                {
+                    for (size_t s = 0; s < pw; ++s)
+                    {
+                        XMFLOAT4A a, b;
+                        XMStoreFloat4A(&a, block[t * 4 + s]);
+                        XMStoreFloat4A(&b, decoded[t * 4 + s]);
+
+                        if (codec.Encode == D3DXEncodeBC6HU)
+                        {
+                            // The unsigned encoder clamps negative values
+                            a.x = std::max(a.x, 0.0f);
+                            a.y = std::max(a.y, 0.0f);
+                            a.z = std::max(a.z, 0.0f);
+                        }
+
+                        const float ref[4] = { a.x, a.y, a.z, a.w };
+                        const float test[4] = { b.x, b.y, b.z, b.w };
+
+                        // BC1 stores no color for pixels below the alpha threshold, they decode to black
+                        const bool cutOut = !codec.Encode && ref[3] < TEX_THRESHOLD_DEFAULT;
+                        for (uint32_t c = 0; c < 3 && !cutOut; ++c)
+                        {
+                            if (codec.Channels & (1 << c))
+                            {
+                                const double diff = (double)ref[c] - test[c];
+                                result.ColorError += diff * diff;
+                                result.ColorValues += 1.0;
+                                result.Peak = std::max(result.Peak, fabsf(ref[c]));
+                            }
+                        }
+
+                        if (codec.Channels & kAlpha)
+                        {
+                            const double diff = (double)ref[3] - test[3];
+                            result.AlphaError += diff * diff;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    double ComputePSNR(double sumSq, double numValues, double peak)
+    {
+        if (numValues == 0.0)
+            return 0.0;
+        const double mse = sumSq / numValues;
+        return mse > 0.0 ? 10.0 * log10(peak * peak / mse) : std::numeric_limits<double>::infinity();
+    }
+}
+
+const char* TextureCompress::GetQualityName(Quality quality)
+{
+    return quality < Quality::kNumQualities ? kQualityNames[(uint32_t)quality] : "unknown";
+}
+
+bool TextureCompress::ParseQuality(const char* name, Quality& quality)
+{
+    for (uint32_t i = 0; i < (uint32_t)Quality::kNumQualities; ++i)
+    {
+        if (strcmp(name, kQualityNames[i]) == 0)
+        {
+            quality = (Quality)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+TEX_COMPRESS_FLAGS TextureCompress::GetCompressFlags(Quality quality)
+{
+    switch (quality)
+    {
+    case Quality::kFast:        return TEX_COMPRESS_BC7_QUICK;
+    case Quality::kExhaustive:  return TEX_COMPRESS_BC7_USE_3SUBSETS;
+    default:                    return TEX_COMPRESS_DEFAULT;
+    }
+}
+
+HRESULT TextureCompress::Compress(const Image* srcImages, size_t numImages, const TexMetadata& metadata,
+    DXGI_FORMAT format, Quality quality, ScratchImage& result, Report* report, uint32_t numThreads)
+{
+    if (!srcImages || !numImages)
+        return E_INVALIDARG;
+
+    if (IsCompressed(metadata.format) || !IsCompressed(format))
+        return E_INVALIDARG;
+
+    if (IsTypeless(format) || IsTypeless(metadata.format) || IsPlanar(metadata.format) || IsPalettized(metadata.format))
+        return HRESULT_E_NOT_SUPPORTED;
+
+    // We don't support compressing from monochrome (DXGI_FORMAT_R1_UNORM)
+    if (BitsPerPixel(metadata.format) < 8)
+        return HRESULT_E_NOT_SUPPORTED;
+
+    CompressJob job;
+    if (!GetCodec(format, job.Codec))
+        return HRESULT_E_NOT_SUPPORTED;
+
+    const auto startTime = std::chrono::steady_clock::now();
+
+    result.Release();
+
+    TexMetadata destMetadata = metadata;
+    destMetadata.format = format;
+    HRESULT hr = result.Initialize(destMetadata);
+    if (FAILED(hr))
+        return hr;
+
+    if (numImages != result.GetImageCount() || result.GetImages() == nullptr)
+    {
+        result.Release();
+        return E_FAIL;
+    }
+
+    job.Src = srcImages;
+    job.Dest = result.GetImages();
+    job.SrcBytesPerPixel = (BitsPerPixel(metadata.format) + 7) / 8;
+    job.EncodeFlags = (uint32_t)GetCompressFlags(quality);
+    job.Measure = report != nullptr;
+    job.Failed = false;
+
+    uint64_t numBlocks = 0;
+    for (size_t i = 0; i < numImages; ++i)
+    {
+        const Image& src = srcImages[i];
+        if (src.pixels == nullptr || src.format != metadata.format ||
+            src.width != job.Dest[i].width || src.height != job.Dest[i].height)
+        {
+            result.Release();
+            return E_FAIL;
+        }
+
+        const uint32_t blocksWide = (uint32_t)((src.width + 3) / 4);
+        const uint32_t blocksHigh = (uint32_t)((src.height + 3) / 4);
+        const uint32_t rowsPerRange = std::max(1u, kBlocksPerRange / blocksWide);
+
+        for (uint32_t row = 0; row < blocksHigh; row += rowsPerRange)
+            job.Ranges.push_back({ (uint32_t)i, row, std::min(rowsPerRange, blocksHigh - row) });
+
+        numBlocks += (uint64_t)blocksWide * blocksHigh;
+    }
+
+    const uint32_t numRanges = (uint32_t)job.Ranges.size();
+    job.Results.resize(numRanges);
+
+    // Callers that compress several textures at once, such as the texture pipeline's workers,
+    // share the cores instead of each starting a thread per core
+    if (numThreads == 0)
+        numThreads = ReserveThreads(numRanges);
+    else
+    {
+        numThreads = std::min(numThreads, numRanges);
+        s_ThreadsInFlight += numThreads;
+    }
+
+    std::atomic<uint32_t> nextRange(0);
+    auto WorkerFunc = [&]()
+    {
+        for (uint32_t range = nextRange++; range < numRanges && !job.Failed; range = nextRange++)
+            CompressRange(job, range);
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < numThreads; ++i)
+        threads.push_back(std::thread(WorkerFunc));
+    WorkerFunc();
+    std::for_each(threads.begin(), threads.end(), [](std::thread& t) { t.join(); });
+    s_ThreadsInFlight -= numThreads;
+
+    if (job.Failed)
+    {
+        result.Release();
+        return E_FAIL;
+    }
+
+    if (report == nullptr)
+        return S_OK;
+
+    report->NumThreads = numThreads;
+    report->NumBlocks = numBlocks;
+    report->Images.resize(numImages);
+
+    // Recover the mip level and item of each image from the ScratchImage layout
+    size_t index = 0;
+    if (metadata.dimension == TEX_DIMENSION_TEXTURE3D)
+    {
+        size_t depth = metadata.depth;
+        for (size_t level = 0; level < metadata.mipLevels; ++level)
+        {
+            for (size_t slice = 0; slice < depth && index < numImages; ++slice, ++index)
+            {
+                report->Images[index].MipLevel = (uint32_t)level;
+                report->Images[index].Item = (uint32_t)slice;
+            }
+            depth = std::max<size_t>(1, depth >> 1);
+        }
+    }
+    else
+    {
+        for (size_t item = 0; item < metadata.arraySize; ++item)
+        {
+            for (size_t level = 0; level < metadata.mipLevels && index < numImages; ++level, ++index)
+            {
+                report->Images[index].MipLevel = (uint32_t)level;
+                report->Images[index].Item = (uint32_t)item;
+            }
+        }
+    }
+
+    // Reduce in range order so the results are independent of scheduling
+    std::vector<RangeResult> imageResults(numImages);
+    float peak = 0.0f;
+    for (uint32_t i = 0; i < numRanges; ++i)
+    {
+        RangeResult& total = imageResults[job.Ranges[i].Image];
+        total.ColorError += job.Results[i].ColorError;
+        total.AlphaError += job.Results[i].AlphaError;
+        total.ColorValues += job.Results[i].ColorValues;
+        peak = std::max(peak, job.Results[i].Peak);
+    }
+
+    report->Peak = job.Codec.HDR && peak > 0.0f ? peak : 1.0;
+
+    const bool hasAlpha = (job.Codec.Channels & kAlpha) != 0;
+
+    double colorError = 0.0, alphaError = 0.0, allColorError = 0.0;
+    double numPixels = 0.0, numColorValues = 0.0, allNumColorValues = 0.0;
+
+    for (size_t i = 0; i < numImages; ++i)
+    {
+        ImageReport& image = report->Images[i];
+        const double pixels = (double)srcImages[i].width * srcImages[i].height;
+
+        image.Width = (uint32_t)srcImages[i].width;
+        image.Height = (uint32_t)srcImages[i].height;
+        image.PSNR = ComputePSNR(imageResults[i].ColorError, imageResults[i].ColorValues, report->Peak);
+        image.AlphaPSNR = hasAlpha ? ComputePSNR(imageResults[i].AlphaError, pixels, 1.0) : 0.0;
+
+        if (image.MipLevel == 0)
+        {
+            colorError += imageResults[i].ColorError;
+            alphaError += imageResults[i].AlphaError;
+            numPixels += pixels;
+            numColorValues += imageResults[i].ColorValues;
+        }
+
+        allColorError += imageResults[i].ColorError;
+        allNumColorValues += imageResults[i].ColorValues;
+    }
+
+    report->PSNR = ComputePSNR(colorError, numColorValues, report->Peak);
+    report->AlphaPSNR = hasAlpha ? ComputePSNR(alphaError, numPixels, 1.0) : 0.0;
+    report->AllMipsPSNR = ComputePSNR(allColorError, allNumColorValues, report->Peak);
+    report->Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    return S_OK;
+}
@@ -0,0 +1,101 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include "DirectXTex.h"
+
+#include <cstdint>
+#include <vector>
+
+//
+// Block compression of a whole texture on every core, replacing a single DirectX::Compress call.
+//
+// Every mip level and array slice is split into ranges of block rows, and worker threads take
+// ranges from one shared list, so the small mips do not leave cores idle at the end of each
+// level the way a per-image parallel loop would. Blocks are loaded, padded and encoded exactly
+// as DirectX::Compress does with the DirectXTex encoders, so the output is bit-identical to it
+// for the same flags, whatever the thread count.
+//
+// The quality tiers map onto the DirectXTex BC7 encoder:
+//  kFast        mode 6 only
+//  kBalanced    every mode except the rarely useful 3 subset modes 0 and 2 (the DirectXTex default)
+//  kExhaustive  every mode
+// The vendored BC6H encoder has a single search depth, so all three tiers produce the same
+// BC6H blocks, and the other formats ignore the tier.
+//
+// When a report is requested, each block is decoded again right after it is encoded and
+// compared with what the encoder was given, so the PSNR of every image comes at the cost of a
+// decode rather than a second pass over the texture. Partial sums are reduced in range order so
+// the report does not depend on the thread count either.
+//
+// This has no engine dependencies so that it can also be built into the standalone benchmark
+// (see Tools/TextureCompressBenchmark).
+//
+namespace TextureCompress
+{
+    enum class Quality : uint32_t
+    {
+        kFast,
+        kBalanced,
+        kExhaustive,
+
+        kNumQualities
+    };
+
+    struct ImageReport
+    {
+        uint32_t MipLevel = 0;
+        uint32_t Item = 0;          // Array slice, or depth slice of a volume texture
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+        double PSNR = 0.0;          // Over the color channels the format stores, in dB, leaving out
+                                    // the pixels BC1 cuts out by alpha
+        double AlphaPSNR = 0.0;     // Zero when the format has no alpha
+    };
+
+    struct Report
+    {
+        uint32_t NumThreads = 0;
+        uint64_t NumBlocks = 0;
+        double Milliseconds = 0.0;
+        double Peak = 1.0;          // 1 for UNORM formats, the largest source channel value for BC6H
+        double PSNR = 0.0;          // Mip 0, all items
+        double AlphaPSNR = 0.0;     // Mip 0, all items
+        double AllMipsPSNR = 0.0;   // Every image, weighted by pixel count
+        std::vector<ImageReport> Images;    // In DirectX::ScratchImage order
+    };
+
+    // "fast", "balanced" and "exhaustive"
+    const char* GetQualityName(Quality quality);
+    bool ParseQuality(const char* name, Quality& quality);
+
+    // The DirectXTex TEX_COMPRESS_FLAGS that DirectX::Compress would need for the same result
+    DirectX::TEX_COMPRESS_FLAGS GetCompressFlags(Quality quality);
+
+    // Compresses every image to 'format' (BC1 to BC7). Alpha is cut off at 0.5 for BC1, as
+    // DirectX::Compress does by default. A thread count of zero uses the calling thread plus one
+    // for each hardware thread that no other call is compressing on, so concurrent calls share
+    // the cores rather than each starting a thread per core.
+    HRESULT Compress(const DirectX::Image* srcImages, size_t numImages, const DirectX::TexMetadata& metadata,
+        DXGI_FORMAT format, Quality quality, DirectX::ScratchImage& result, Report* report = nullptr,
+        uint32_t numThreads = 0);
+}
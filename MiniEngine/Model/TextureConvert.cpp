@@ -15,36 +15,94 @@
 //
 
 #include "TextureConvert.h"
+#include "TextureCache.h"
+#include "TextureCompress.h"
 #include "../Core/Utility.h"
+#include "../Core/Util/CommandLineArg.h"
 #include "DirectXTex.h"
 
+#include <mutex>
+
 using namespace DirectX;
 
 #define GetFlag(f) ((Flags & f) != 0)
 
-void CompileTextureOnDemand(const std::wstring& originalFile, uint32_t flags)
+// Bump whenever ConvertToDDS produces different output for the same source and flags, so
+// that cached conversions are not reused
+static const uint32_t kTextureEncoderVersion = 1;
+
+namespace
 {
-    std::wstring ddsFile = Utility::RemoveExtension(originalFile) + L".dds";
+    TextureCache s_TextureCache;
+    std::once_flag s_TextureCacheOpened;
 
-    struct _stat64 ddsFileStat, srcFileStat;
+    // -texture_cache <directory> is shared by every asset root. -texture_cache_mb 0 disables it.
+    void OpenTextureCache()
+    {
+        std::wstring directory = L"TextureCache";
+        uint32_t sizeMB = 4096;
+        CommandLineArgs::GetString(L"texture_cache", directory);
+        CommandLineArgs::GetInteger(L"texture_cache_mb", sizeMB);
 
-    bool srcFileMissing = _wstat64(originalFile.c_str(), &srcFileStat) == -1;
-    bool ddsFileMissing = _wstat64(ddsFile.c_str(), &ddsFileStat) == -1;
+        if (s_TextureCache.Open(directory, (uint64_t)sizeMB << 20))
+        {
+            TextureCache::Stats stats = s_TextureCache.GetStats();
+            LOG_INFOF("Texture cache %s: %u entries, %llu of %u MB.", Utility::WideStringToUTF8(directory).c_str(),
+                stats.NumEntries, (unsigned long long)(stats.TotalBytes >> 20), sizeMB);
+        }
+    }
 
-    if (srcFileMissing && ddsFileMissing)
+    // -texture_quality fast|balanced|exhaustive selects how hard the BC7 encoder searches
+    TextureCompress::Quality GetCompressQuality()
     {
-        LOG_ERRORF("Texture %s is missing.", Utility::WideStringToUTF8(Utility::RemoveBasePath(originalFile)).c_str());
-        return;
+        static const TextureCompress::Quality s_Quality = []()
+        {
+            TextureCompress::Quality quality = TextureCompress::Quality::kBalanced;
+            std::wstring name;
+            if (CommandLineArgs::GetString(L"texture_quality", name) &&
+                !TextureCompress::ParseQuality(Utility::WideStringToUTF8(name).c_str(), quality))
+            {
+                LOG_ERRORF("Unknown texture quality \"%s\", using balanced.", Utility::WideStringToUTF8(name).c_str());
+            }
+            return quality;
+        }();
+        return s_Quality;
     }
 
-    // If we can find the source texture and the DDS file is older, reconvert.
-    if (ddsFileMissing || !srcFileMissing && ddsFileStat.st_mtime < srcFileStat.st_mtime)
+    // Whether ConvertToDDS picks BC7 for this file, the only format the quality tier changes
+    bool CompressesToBC7(const std::wstring& filePath, uint32_t Flags)
     {
-        LOG_INFOF("DDS texture %s missing or older than source.  Rebuilding.", Utility::WideStringToUTF8(Utility::RemoveBasePath(originalFile)).c_str());
-        ConvertToDDS(originalFile, flags);
+        const std::wstring ext = Utility::ToLower(Utility::GetFileExtension(filePath));
+        const bool isHDR = ext == L"hdr" || ext == L"exr";
+        return !isHDR && GetFlag(kDefaultBC) && GetFlag(kQualityBC);
     }
 }
 
+void CompileTextureOnDemand(const std::wstring& originalFile, uint32_t flags)
+{
+    std::call_once(s_TextureCacheOpened, OpenTextureCache);
+
+    std::wstring ddsFile = Utility::RemoveExtension(originalFile) + L".dds";
+    std::string name = Utility::WideStringToUTF8(Utility::RemoveBasePath(originalFile));
+
+    // DirectXTex changes can alter the output as much as our own. The quality tier only matters
+    // to BC7, so switching tiers does not rebuild BC6H or any other format.
+    uint32_t encoderVersion = kTextureEncoderVersion << 16 | DIRECTX_TEX_VERSION;
+    if (CompressesToBC7(originalFile, flags))
+        encoderVersion |= ((uint32_t)GetCompressQuality() + 1) << 24;
+
+    TextureCache::Result result = s_TextureCache.Update(originalFile, ddsFile, flags, encoderVersion, [&]()
+    {
+        LOG_INFOF("DDS texture %s missing or out of date and not in the texture cache.  Rebuilding.", name.c_str());
+        return ConvertToDDS(originalFile, flags);
+    });
+
+    if (result == TextureCache::Result::kMissing)
+        LOG_ERRORF("Texture %s is missing.", name.c_str());
+    else if (result == TextureCache::Result::kRestored)
+        LOG_INFOF("DDS texture %s restored from the texture cache.", name.c_str());
+}
+
 bool ConvertToDDS( const std::wstring& filePath, uint32_t Flags )
 {
     bool bInterpretAsSRGB =	GetFlag(kSRGB);
@@ -168,6 +226,7 @@ bool ConvertToDDS( const std::wstring& filePath, uint32_t Flags )
     }
     else if (bBlockCompress)
     {
+        // Keep CompressesToBC7 in step with this choice
         tformat = bInterpretAsSRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
         if (bUseBestBC)
             cformat = bInterpretAsSRGB ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
@@ -244,13 +303,20 @@ bool ConvertToDDS( const std::wstring& filePath, uint32_t Flags )
         {
             std::unique_ptr<ScratchImage> timage(new ScratchImage);
 
-            HRESULT hr = Compress( image->GetImages(), image->GetImageCount(), image->GetMetadata(), cformat, TEX_COMPRESS_DEFAULT, 0.5f, *timage );
+            TextureCompress::Report report;
+            TextureCompress::Quality quality = GetCompressQuality();
+
+            HRESULT hr = TextureCompress::Compress( image->GetImages(), image->GetImageCount(), image->GetMetadata(),
+                cformat, quality, *timage, &report );
             if (FAILED(hr))
             {
                 LOG_ERRORF( "Failing compressing \"%s\" (WIC: %08X).", Utility::WideStringToUTF8(filePath).c_str(), hr );
             }
             else
             {
+                LOG_INFOF( "Compressed \"%s\" (%s) in %.1f ms on %u threads.  PSNR %.2f dB, %.2f dB over all mips, alpha %.2f dB.",
+                    Utility::WideStringToUTF8(filePath).c_str(), TextureCompress::GetQualityName(quality), report.Milliseconds,
+                    report.NumThreads, report.PSNR, report.AllMipsPSNR, report.AlphaPSNR );
                 image.swap(timage);
             }
         }
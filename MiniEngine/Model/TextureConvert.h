@@ -32,12 +32,14 @@ inline uint8_t TextureOptions(bool sRGB, bool hasAlpha=false, bool invertY=false
     return (sRGB ? kSRGB : 0) | (hasAlpha ? kPreserveAlpha : 0) | (invertY ? kFlipVertical : 0);
 }
 
-// If the DDS version of the texture specified does not exist or is older than the source texture, reconvert it.
+// If the DDS version of the texture specified does not exist or is out of date, restore it from the
+// texture cache or reconvert it.  Conversions are cached by source contents, flags and encoder version.
 void CompileTextureOnDemand(const std::wstring& originalFile, uint32_t flags);
 
 // Loads a non-DDS texture such as TGA, PNG, or JPG, then converts it to a more optimal
 // DDS format with a full mip chain.  Resultant file has the same path with the file extension
-// changed to "DDS".
+// changed to "DDS".  Block compression runs on the cores that conversions on other threads
+// leave idle, and -texture_quality picks the BC7 search depth (see TextureCompress.h).
 bool ConvertToDDS(
     const std::wstring& filePath,	// UTF8-encoded path to source file
     uint32_t Flags                  // flags ORed together
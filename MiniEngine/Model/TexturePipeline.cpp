@@ -0,0 +1,221 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "TexturePipeline.h"
+#include "../Core/Utf8.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cwctype>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+using namespace std;
+
+namespace
+{
+    typedef chrono::high_resolution_clock Clock;
+
+    double ElapsedMs(Clock::time_point start, Clock::time_point end)
+    {
+        return chrono::duration<double, milli>(end - start).count();
+    }
+
+    // Paths are compared the way the file system would resolve them
+    wstring MakeKey(const wstring& file)
+    {
+        wstring key = file;
+        for (wchar_t& c : key)
+        {
+            if (c == L'\\')
+                c = L'/';
+#ifdef _WIN32
+            else
+                c = (wchar_t)towlower(c);
+#endif
+        }
+        return key;
+    }
+
+    wstring GetFileName(const wstring& file)
+    {
+        size_t lastSlash = file.find_last_of(L"/\\");
+        return lastSlash == wstring::npos ? file : file.substr(lastSlash + 1);
+    }
+}
+
+void TexturePipeline::Deduplicate(const vector<Request>& requests, vector<Request>& unique,
+    vector<uint32_t>& remap)
+{
+    unordered_map<wstring, uint32_t> lookup;
+    lookup.reserve(requests.size());
+
+    unique.clear();
+    remap.resize(requests.size());
+
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        auto result = lookup.emplace(MakeKey(requests[i].File), (uint32_t)unique.size());
+        if (result.second)
+            unique.push_back(requests[i]);
+
+        remap[i] = result.first->second;
+    }
+}
+
+void TexturePipeline::Run(const vector<Request>& unique, const vector<uint32_t>& remap,
+    const Stages& stages, Stats& stats, uint32_t numThreads)
+{
+    const Clock::time_point start = Clock::now();
+    const uint32_t numTextures = (uint32_t)unique.size();
+
+    stats.NumRequests = (uint32_t)remap.size();
+    stats.Textures.assign(numTextures, TextureTiming());
+
+    for (uint32_t i = 0; i < numTextures; ++i)
+    {
+        stats.Textures[i].File = unique[i].File;
+        stats.Textures[i].Flags = unique[i].Flags;
+    }
+
+    for (uint32_t idx : remap)
+    {
+        if (idx < numTextures)
+            ++stats.Textures[idx].NumReferences;
+    }
+
+    if (numThreads == 0)
+        numThreads = max(thread::hardware_concurrency(), 2u) - 1;
+    numThreads = min(numThreads, numTextures);
+    stats.NumThreads = numThreads;
+
+    if (numTextures == 0)
+    {
+        stats.TotalMs = ElapsedMs(start, Clock::now());
+        return;
+    }
+
+    vector<Clock::time_point> readyTimes(numTextures);
+    vector<uint32_t> readyQueue;
+    readyQueue.reserve(numTextures);
+    mutex readyMutex;
+    condition_variable readyCondition;
+    atomic<uint32_t> nextTexture(0);
+
+    auto worker = [&]()
+    {
+        for (;;)
+        {
+            const uint32_t idx = nextTexture.fetch_add(1);
+            if (idx >= numTextures)
+                break;
+
+            TextureTiming& timing = stats.Textures[idx];
+
+            Clock::time_point t0 = Clock::now();
+            if (stages.Convert)
+                stages.Convert(idx);
+
+            Clock::time_point t1 = Clock::now();
+            if (stages.Read)
+                stages.Read(idx);
+
+            Clock::time_point t2 = Clock::now();
+            timing.ConvertMs = ElapsedMs(t0, t1);
+            timing.ReadMs = ElapsedMs(t1, t2);
+            readyTimes[idx] = t2;
+
+            {
+                lock_guard<mutex> guard(readyMutex);
+                readyQueue.push_back(idx);
+            }
+            readyCondition.notify_one();
+        }
+    };
+
+    vector<thread> workers;
+    workers.reserve(numThreads);
+    for (uint32_t i = 0; i < numThreads; ++i)
+        workers.emplace_back(worker);
+
+    // Finish textures on this thread as they become ready
+    vector<uint32_t> batch;
+    for (uint32_t numFinished = 0; numFinished < numTextures; )
+    {
+        {
+            unique_lock<mutex> lock(readyMutex);
+            readyCondition.wait(lock, [&]() { return !readyQueue.empty(); });
+            batch.swap(readyQueue);
+        }
+
+        for (uint32_t idx : batch)
+        {
+            TextureTiming& timing = stats.Textures[idx];
+
+            Clock::time_point t0 = Clock::now();
+            if (stages.Finish)
+                stages.Finish(idx);
+
+            timing.QueuedMs = ElapsedMs(readyTimes[idx], t0);
+            timing.FinishMs = ElapsedMs(t0, Clock::now());
+        }
+
+        numFinished += (uint32_t)batch.size();
+        batch.clear();
+    }
+
+    for (thread& t : workers)
+        t.join();
+
+    stats.TotalMs = ElapsedMs(start, Clock::now());
+}
+
+string TexturePipeline::ToString(const Stats& stats)
+{
+    char line[512];
+    snprintf(line, sizeof(line), "%u texture requests, %u unique, %u worker threads, %.1f ms\n",
+        stats.NumRequests, (uint32_t)stats.Textures.size(), stats.NumThreads, stats.TotalMs);
+
+    string result = line;
+
+    vector<const TextureTiming*> sorted;
+    sorted.reserve(stats.Textures.size());
+    for (const TextureTiming& timing : stats.Textures)
+        sorted.push_back(&timing);
+
+    auto busyMs = [](const TextureTiming* t) { return t->ConvertMs + t->ReadMs + t->FinishMs; };
+    stable_sort(sorted.begin(), sorted.end(),
+        [&](const TextureTiming* a, const TextureTiming* b) { return busyMs(a) > busyMs(b); });
+
+    for (const TextureTiming* timing : sorted)
+    {
+        snprintf(line, sizeof(line),
+            "  convert %9.1f ms  read %7.1f ms  queued %7.1f ms  create %6.1f ms  x%u  %s\n",
+            timing->ConvertMs, timing->ReadMs, timing->QueuedMs, timing->FinishMs,
+            timing->NumReferences, Utility::WideToUTF8(GetFileName(timing->File)).c_str());
+        result += line;
+    }
+
+    return result;
+}
@@ -0,0 +1,92 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+//
+// Schedules the texture work of a model load. Each unique texture goes through three stages:
+//
+//  Convert     rebuild the DDS file if needed (worker thread)
+//  Read        load the DDS file into memory (worker thread)
+//  Finish      create the GPU resource (calling thread)
+//
+// Convert and Read run on a bounded pool of worker threads. Finish is called on the calling
+// thread in completion order, so GPU uploads overlap with the conversion of other textures
+// while device objects are only touched from one thread. The pipeline itself knows nothing
+// about DirectXTex or D3D12; the stages are supplied by the caller, which keeps the
+// scheduling, de-duplication and timing code buildable and testable on any platform.
+//
+namespace TexturePipeline
+{
+    struct Request
+    {
+        std::wstring File;
+        uint32_t Flags;     // TexConversionFlags
+    };
+
+    struct Stages
+    {
+        std::function<void(uint32_t uniqueIdx)> Convert;
+        std::function<void(uint32_t uniqueIdx)> Read;
+        std::function<void(uint32_t uniqueIdx)> Finish;
+    };
+
+    struct TextureTiming
+    {
+        std::wstring File;
+        uint32_t Flags = 0;
+        uint32_t NumReferences = 0;     // Requests that share this texture
+        double ConvertMs = 0.0;
+        double ReadMs = 0.0;
+        double QueuedMs = 0.0;          // Between Read finishing and Finish starting
+        double FinishMs = 0.0;
+    };
+
+    struct Stats
+    {
+        uint32_t NumRequests = 0;
+        uint32_t NumThreads = 0;
+        double TotalMs = 0.0;
+        std::vector<TextureTiming> Textures;    // One per unique texture
+    };
+
+    // Collapses requests for the same file. 'remap' receives, for every request, the index of
+    // its entry in 'unique'. Unique entries keep the order and flags of their first use; two
+    // conversions must never write the same DDS file concurrently, and a serial load would
+    // not have reconverted for the later request either.
+    void Deduplicate(const std::vector<Request>& requests, std::vector<Request>& unique,
+        std::vector<uint32_t>& remap);
+
+    // Runs every stage for each entry of 'unique' and returns once all Finish calls are done.
+    // 'remap' is the output of Deduplicate and is only used for the statistics. A thread count
+    // of zero uses all hardware threads but one, which is left to Finish. Missing stages are
+    // skipped.
+    void Run(const std::vector<Request>& unique, const std::vector<uint32_t>& remap,
+        const Stages& stages, Stats& stats, uint32_t numThreads = 0);
+
+    // One summary line followed by a line per texture, slowest first. Only file names are
+    // printed to keep the lines short.
+    std::string ToString(const Stats& stats);
+}
@@ -0,0 +1,550 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// This file has no engine dependencies so that it can also be built into the
+// standalone vertex cache check (see Tools/VertexCacheCheck).
+
+#include "VertexCacheOptimize.h"
+#include "IndexOptimizePostTransform.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const uint32_t kInvalidVertex = ~0u;
+    const uint32_t kOverdrawViewportSize = 256;
+
+    const char* s_AlgorithmNames[VertexCacheOptimize::kNumAlgorithms] = { "Forsyth", "Tipsify", "None" };
+
+    // FIFO cache model shared by Tipsify and the analyzers. A vertex is resident while fewer
+    // than 'cacheSize' misses happened since its own. Advancing the timestamp by more than the
+    // cache size flushes the cache.
+    class FifoCache
+    {
+    public:
+        FifoCache(uint32_t vertexCount, uint32_t cacheSize)
+            : m_CacheTime(vertexCount, 0), m_CacheSize(cacheSize), m_Timestamp(cacheSize + 1) {}
+
+        // Returns true on a miss
+        bool Access(uint32_t v)
+        {
+            if (m_Timestamp - m_CacheTime[v] > m_CacheSize)
+            {
+                m_CacheTime[v] = m_Timestamp++;
+                return true;
+            }
+            return false;
+        }
+
+        uint32_t AccessTriangle(const uint32_t* tri)
+        {
+            return (uint32_t)Access(tri[0]) + (uint32_t)Access(tri[1]) + (uint32_t)Access(tri[2]);
+        }
+
+        void Flush() { m_Timestamp += m_CacheSize + 1; }
+
+        // Age of a vertex in misses, larger than the cache size once evicted
+        uint32_t Age(uint32_t v) const { return m_Timestamp - m_CacheTime[v]; }
+
+    private:
+        vector<uint32_t> m_CacheTime;
+        uint32_t m_CacheSize;
+        uint32_t m_Timestamp;
+    };
+
+    inline const float* GetPosition(const float* positions, uint32_t stride, uint32_t v)
+    {
+        return (const float*)((const uint8_t*)positions + (size_t)v * stride);
+    }
+
+    // Top-left fill convention for counter-clockwise triangles, so that pixels centered on an
+    // edge shared by two triangles are only rasterized once
+    inline bool OwnsEdge(float dx, float dy)
+    {
+        return dy < 0.0f || (dy == 0.0f && dx > 0.0f);
+    }
+
+    struct RasterVertex
+    {
+        float x, y, z;
+    };
+
+    // Rasterizes a counter-clockwise triangle with a less-than depth test
+    void RasterizeTriangle(const RasterVertex& v0, const RasterVertex& v1, const RasterVertex& v2, float area,
+        float* depthBuffer, uint64_t& pixelsShaded)
+    {
+        const int size = (int)kOverdrawViewportSize;
+        const int minX = max(0, (int)floor(min(min(v0.x, v1.x), v2.x)));
+        const int minY = max(0, (int)floor(min(min(v0.y, v1.y), v2.y)));
+        const int maxX = min(size - 1, (int)ceil(max(max(v0.x, v1.x), v2.x)));
+        const int maxY = min(size - 1, (int)ceil(max(max(v0.y, v1.y), v2.y)));
+
+        const RasterVertex* verts[3] = { &v0, &v1, &v2 };
+        float dx[3], dy[3];
+        bool owns[3];
+        for (int e = 0; e < 3; ++e)
+        {
+            // Edge e is opposite vertex e
+            const RasterVertex& a = *verts[(e + 1) % 3];
+            const RasterVertex& b = *verts[(e + 2) % 3];
+            dx[e] = b.x - a.x;
+            dy[e] = b.y - a.y;
+            owns[e] = OwnsEdge(dx[e], dy[e]);
+        }
+
+        const float invArea = 1.0f / area;
+
+        for (int y = minY; y <= maxY; ++y)
+        {
+            const float py = (float)y + 0.5f;
+            for (int x = minX; x <= maxX; ++x)
+            {
+                const float px = (float)x + 0.5f;
+
+                float w[3];
+                bool inside = true;
+                for (int e = 0; e < 3 && inside; ++e)
+                {
+                    const RasterVertex& a = *verts[(e + 1) % 3];
+                    w[e] = dx[e] * (py - a.y) - dy[e] * (px - a.x);
+                    inside = w[e] > 0.0f || (w[e] == 0.0f && owns[e]);
+                }
+                if (!inside)
+                    continue;
+
+                const float z = (w[0] * v0.z + w[1] * v1.z + w[2] * v2.z) * invArea;
+                float& depth = depthBuffer[y * size + x];
+                if (z < depth)
+                {
+                    depth = z;
+                    ++pixelsShaded;
+                }
+            }
+        }
+    }
+}
+
+const char* VertexCacheOptimize::GetAlgorithmName(Algorithm algorithm)
+{
+    return algorithm < kNumAlgorithms ? s_AlgorithmNames[algorithm] : "Unknown";
+}
+
+VertexCacheOptimize::Algorithm VertexCacheOptimize::FindAlgorithm(const char* name)
+{
+    for (uint32_t a = 0; a < kNumAlgorithms; ++a)
+    {
+        const char* expected = s_AlgorithmNames[a];
+        size_t i = 0;
+        while (name[i] != '\0' && tolower((unsigned char)name[i]) == tolower((unsigned char)expected[i]))
+            ++i;
+
+        if (name[i] == '\0' && expected[i] == '\0')
+            return (Algorithm)a;
+    }
+    return kNumAlgorithms;
+}
+
+void VertexCacheOptimize::Reorder(const Settings& settings, uint32_t* indices, size_t indexCount, const float* positions,
+    uint32_t vertexCount, uint32_t positionStride, uint32_t* newIndices)
+{
+    uint32_t cacheSize = settings.cacheSize;
+    if (settings.algorithm == kForsyth)
+        cacheSize = cacheSize == 0 ? kMaxForsythCacheSize : min(cacheSize, kMaxForsythCacheSize);
+    else if (cacheSize == 0)
+        cacheSize = kDefaultFifoCacheSize;
+
+    switch (settings.algorithm)
+    {
+    case kForsyth:
+        OptimizeFaces(indices, indexCount, newIndices, cacheSize);
+        break;
+    case kTipsify:
+        Tipsify(indices, indexCount, vertexCount, cacheSize, newIndices);
+        break;
+    default:
+        memcpy(newIndices, indices, indexCount * sizeof(uint32_t));
+        break;
+    }
+
+    // The input order is no longer needed, so it receives the clustered order
+    if (settings.reduceOverdraw)
+    {
+        ReduceOverdraw(newIndices, indexCount, positions, vertexCount, positionStride, cacheSize,
+            settings.overdrawThreshold, indices);
+        memcpy(newIndices, indices, indexCount * sizeof(uint32_t));
+    }
+}
+
+void VertexCacheOptimize::Tipsify(const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize,
+    uint32_t* newIndices)
+{
+    assert(indices != newIndices);
+
+    const size_t faceCount = indexCount / 3;
+    const size_t faceIndexCount = faceCount * 3;
+
+    // Triangles around every vertex, and how many of them are still to be emitted
+    vector<uint32_t> liveCount(vertexCount, 0);
+    for (size_t i = 0; i < faceIndexCount; ++i)
+    {
+        assert(indices[i] < vertexCount);
+        ++liveCount[indices[i]];
+    }
+
+    vector<uint32_t> adjacencyStart(vertexCount + 1);
+    adjacencyStart[0] = 0;
+    for (uint32_t v = 0; v < vertexCount; ++v)
+        adjacencyStart[v + 1] = adjacencyStart[v] + liveCount[v];
+
+    vector<uint32_t> adjacency(faceIndexCount);
+    {
+        vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (size_t i = 0; i < faceIndexCount; ++i)
+            adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    FifoCache cache(vertexCount, cacheSize);
+    vector<uint8_t> emitted(faceCount, 0);
+    vector<uint32_t> deadEnds;
+    vector<uint32_t> candidates;
+    deadEnds.reserve(faceIndexCount);
+
+    uint32_t cursor = 0;
+    size_t numEmitted = 0;
+
+    // Vertices of recently emitted triangles are tried before falling back to the next vertex
+    // in index order
+    auto skipDeadEnd = [&]() -> uint32_t
+    {
+        while (!deadEnds.empty())
+        {
+            const uint32_t v = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveCount[v] > 0)
+                return v;
+        }
+
+        for (; cursor < vertexCount; ++cursor)
+        {
+            if (liveCount[cursor] > 0)
+                return cursor;
+        }
+
+        return kInvalidVertex;
+    };
+
+    uint32_t fan = skipDeadEnd();
+    while (fan != kInvalidVertex)
+    {
+        candidates.clear();
+
+        for (uint32_t k = adjacencyStart[fan]; k < adjacencyStart[fan + 1]; ++k)
+        {
+            const uint32_t face = adjacency[k];
+            if (emitted[face])
+                continue;
+
+            emitted[face] = 1;
+            for (uint32_t j = 0; j < 3; ++j)
+            {
+                const uint32_t v = indices[face * 3 + j];
+                newIndices[numEmitted++] = v;
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                --liveCount[v];
+                cache.Access(v);
+            }
+        }
+
+        // Prefer the oldest candidate that stays in the cache while its own fan is emitted,
+        // which adds at most two vertices per triangle
+        uint32_t next = kInvalidVertex;
+        int64_t bestPriority = -1;
+
+        for (uint32_t v : candidates)
+        {
+            if (liveCount[v] == 0)
+                continue;
+
+            int64_t priority = 0;
+            const uint32_t age = cache.Age(v);
+            if ((uint64_t)age + 2ull * liveCount[v] <= cacheSize)
+                priority = age;
+
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        fan = next != kInvalidVertex ? next : skipDeadEnd();
+    }
+
+    assert(numEmitted == faceIndexCount);
+
+    // A trailing partial triangle is left as it was
+    for (size_t i = faceIndexCount; i < indexCount; ++i)
+        newIndices[i] = indices[i];
+}
+
+void VertexCacheOptimize::ReduceOverdraw(const uint32_t* indices, size_t indexCount, const float* positions,
+    uint32_t vertexCount, uint32_t positionStride, uint32_t cacheSize, float threshold, uint32_t* newIndices)
+{
+    assert(indices != newIndices);
+
+    const uint32_t faceCount = (uint32_t)(indexCount / 3);
+    FifoCache cache(vertexCount, cacheSize);
+
+    // Triangles that miss on every vertex usually start a new patch of the mesh
+    vector<uint32_t> hardBoundaries;
+    for (uint32_t f = 0; f < faceCount; ++f)
+    {
+        if (cache.AccessTriangle(indices + f * 3) == 3 || f == 0)
+            hardBoundaries.push_back(f);
+    }
+    hardBoundaries.push_back(faceCount);
+
+    // Within a patch, start a new cluster as soon as the cluster so far has an ACMR within
+    // 'threshold' of the whole patch. Smaller clusters can be sorted more freely.
+    vector<uint32_t> clusters;
+    for (size_t h = 0; h + 1 < hardBoundaries.size(); ++h)
+    {
+        const uint32_t start = hardBoundaries[h];
+        const uint32_t end = hardBoundaries[h + 1];
+
+        cache.Flush();
+        uint32_t patchMisses = 0;
+        for (uint32_t f = start; f < end; ++f)
+            patchMisses += cache.AccessTriangle(indices + f * 3);
+
+        const float targetAcmr = threshold * (float)patchMisses / (float)(end - start);
+
+        clusters.push_back(start);
+        cache.Flush();
+
+        uint32_t misses = 0, faces = 0;
+        for (uint32_t f = start; f < end; ++f)
+        {
+            misses += cache.AccessTriangle(indices + f * 3);
+            ++faces;
+
+            if ((float)misses <= targetAcmr * (float)faces)
+            {
+                clusters.push_back(f + 1);
+                cache.Flush();
+                misses = faces = 0;
+            }
+        }
+
+        // The last cluster is whatever was left when the patch ended, and tends to have a poor
+        // ACMR on its own, so it is merged into the one before
+        if (clusters.back() != start)
+            clusters.pop_back();
+    }
+    clusters.push_back(faceCount);
+
+    const size_t numClusters = clusters.size() - 1;
+
+    // Area weighted centroids and normals of the clusters and of the whole mesh
+    vector<float> sortKeys(numClusters);
+    vector<float> clusterData(numClusters * 7, 0.0f);    // Centroid * area, area, normal
+    double meshCentroid[3] = { 0.0, 0.0, 0.0 };
+    double meshArea = 0.0;
+
+    for (size_t c = 0; c < numClusters; ++c)
+    {
+        float* data = &clusterData[c * 7];
+
+        for (uint32_t f = clusters[c]; f < clusters[c + 1]; ++f)
+        {
+            const float* p0 = GetPosition(positions, positionStride, indices[f * 3 + 0]);
+            const float* p1 = GetPosition(positions, positionStride, indices[f * 3 + 1]);
+            const float* p2 = GetPosition(positions, positionStride, indices[f * 3 + 2]);
+
+            const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            const float area = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (int k = 0; k < 3; ++k)
+            {
+                const float centroid = (p0[k] + p1[k] + p2[k]) / 3.0f;
+                data[k] += centroid * area;
+                data[4 + k] += n[k];
+                meshCentroid[k] += (double)centroid * area;
+            }
+            data[3] += area;
+            meshArea += area;
+        }
+    }
+
+    if (meshArea > 0.0)
+    {
+        for (int k = 0; k < 3; ++k)
+            meshCentroid[k] /= meshArea;
+    }
+
+    for (size_t c = 0; c < numClusters; ++c)
+    {
+        const float* data = &clusterData[c * 7];
+        const float normalLength = sqrt(data[4] * data[4] + data[5] * data[5] + data[6] * data[6]);
+
+        // Degenerate clusters have no direction and are drawn between front and back
+        float key = 0.0f;
+        if (data[3] > 0.0f && normalLength > 0.0f)
+        {
+            for (int k = 0; k < 3; ++k)
+                key += (data[k] / data[3] - (float)meshCentroid[k]) * data[4 + k];
+            key /= normalLength;
+        }
+        sortKeys[c] = key;
+    }
+
+    // Clusters facing away from the center are likely occluders, so they are drawn first
+    vector<uint32_t> order(numClusters);
+    for (uint32_t c = 0; c < numClusters; ++c)
+        order[c] = c;
+    stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    size_t numEmitted = 0;
+    for (uint32_t c : order)
+    {
+        const size_t first = (size_t)clusters[c] * 3;
+        const size_t count = (size_t)(clusters[c + 1] - clusters[c]) * 3;
+        memcpy(newIndices + numEmitted, indices + first, count * sizeof(uint32_t));
+        numEmitted += count;
+    }
+
+    for (size_t i = numEmitted; i < indexCount; ++i)
+        newIndices[i] = indices[i];
+}
+
+VertexCacheOptimize::CacheStatistics VertexCacheOptimize::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount,
+    uint32_t vertexCount, uint32_t cacheSize)
+{
+    CacheStatistics stats;
+    stats.triangles = (uint32_t)(indexCount / 3);
+
+    FifoCache cache(vertexCount, cacheSize);
+    vector<uint8_t> referenced(vertexCount, 0);
+
+    for (size_t i = 0; i < (size_t)stats.triangles * 3; ++i)
+    {
+        const uint32_t v = indices[i];
+        assert(v < vertexCount);
+
+        stats.transforms += cache.Access(v) ? 1 : 0;
+        if (!referenced[v])
+        {
+            referenced[v] = 1;
+            ++stats.vertices;
+        }
+    }
+
+    if (stats.triangles > 0)
+        stats.acmr = (float)stats.transforms / (float)stats.triangles;
+    if (stats.vertices > 0)
+        stats.atvr = (float)stats.transforms / (float)stats.vertices;
+
+    return stats;
+}
+
+VertexCacheOptimize::OverdrawStatistics VertexCacheOptimize::AnalyzeOverdraw(const uint32_t* indices, size_t indexCount,
+    const float* positions, uint32_t vertexCount, uint32_t positionStride)
+{
+    OverdrawStatistics stats;
+    const size_t faceIndexCount = indexCount / 3 * 3;
+    if (faceIndexCount == 0)
+        return stats;
+
+    const float kMax = numeric_limits<float>::max();
+    float minPos[3] = { kMax, kMax, kMax };
+    float maxPos[3] = { -kMax, -kMax, -kMax };
+    for (size_t i = 0; i < faceIndexCount; ++i)
+    {
+        assert(indices[i] < vertexCount);
+        const float* p = GetPosition(positions, positionStride, indices[i]);
+        for (int k = 0; k < 3; ++k)
+        {
+            minPos[k] = min(minPos[k], p[k]);
+            maxPos[k] = max(maxPos[k], p[k]);
+        }
+    }
+
+    const float extent = max(max(maxPos[0] - minPos[0], maxPos[1] - minPos[1]), maxPos[2] - minPos[2]);
+    if (!(extent > 0.0f))
+        return stats;
+
+    const float scale = (float)(kOverdrawViewportSize - 1) / extent;
+
+    vector<float> depthBuffer(kOverdrawViewportSize * kOverdrawViewportSize);
+    vector<RasterVertex> projected(vertexCount);
+
+    // Orthographic views down each axis from both sides. Mirroring the image for the negative
+    // direction keeps front faces counter-clockwise.
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const int u = (axis + 1) % 3, v = (axis + 2) % 3;
+
+        for (int side = 0; side < 2; ++side)
+        {
+            fill(depthBuffer.begin(), depthBuffer.end(), numeric_limits<float>::infinity());
+
+            for (size_t i = 0; i < faceIndexCount; ++i)
+            {
+                const uint32_t index = indices[i];
+                const float* p = GetPosition(positions, positionStride, index);
+                RasterVertex& r = projected[index];
+                r.x = (side == 0 ? p[u] - minPos[u] : maxPos[u] - p[u]) * scale;
+                r.y = (p[v] - minPos[v]) * scale;
+                r.z = side == 0 ? maxPos[axis] - p[axis] : p[axis] - minPos[axis];
+            }
+
+            for (size_t i = 0; i < faceIndexCount; i += 3)
+            {
+                const RasterVertex& v0 = projected[indices[i + 0]];
+                const RasterVertex& v1 = projected[indices[i + 1]];
+                const RasterVertex& v2 = projected[indices[i + 2]];
+
+                const float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+                if (area > 0.0f)
+                    RasterizeTriangle(v0, v1, v2, area, depthBuffer.data(), stats.pixelsShaded);
+            }
+
+            for (float depth : depthBuffer)
+                stats.pixelsCovered += depth != numeric_limits<float>::infinity() ? 1 : 0;
+        }
+    }
+
+    if (stats.pixelsCovered > 0)
+        stats.overdraw = (float)stats.pixelsShaded / (float)stats.pixelsCovered;
+
+    return stats;
+}
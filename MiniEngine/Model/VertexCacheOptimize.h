@@ -0,0 +1,118 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//
+// Post-transform vertex cache optimization and analysis for triangle lists.
+//
+// Two index orderings are available besides the Forsyth optimizer in
+// IndexOptimizePostTransform.h:
+//
+//  - Tipsify (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and
+//    Reduced Overdraw", 2007) fans around one vertex at a time and picks the next fanning
+//    vertex from the ones just used. It runs in linear time with no per-triangle score updates,
+//    at the cost of a slightly higher miss ratio than Forsyth.
+//  - ReduceOverdraw splits an already cache optimized order into clusters wherever locality
+//    allows, then draws the clusters facing away from the mesh center first, so that they
+//    tend to occlude the rest. Triangles keep their order within a cluster.
+//
+// The analyzers measure any ordering, so converters can report what an optimization bought:
+//
+//  - ACMR, the average cache miss ratio, is vertex shader invocations per triangle (0.5 is
+//    the limit for a large regular grid, 3 means no reuse at all).
+//  - ATVR, the average transform to vertex ratio, is invocations per referenced vertex
+//    (1 is optimal and independent of the mesh topology).
+//  - Overdraw is shaded pixels per covered pixel, measured by rasterizing the mesh with
+//    back face culling and a depth test from the six axis directions.
+//
+// The cache model is a FIFO, which is closer to how GPUs batch vertices than an LRU.
+//
+namespace VertexCacheOptimize
+{
+    enum Algorithm
+    {
+        kForsyth,
+        kTipsify,
+        kNone,
+        kNumAlgorithms
+    };
+
+    static const uint32_t kMaxForsythCacheSize = 64;    // LRU entries, also the default
+    static const uint32_t kDefaultFifoCacheSize = 16;   // Used by Tipsify and for reporting
+
+    // How OptimizeMesh orders the triangles of each primitive
+    struct Settings
+    {
+        Algorithm algorithm = kForsyth;
+        uint32_t cacheSize = 0;             // Zero selects the default of the algorithm
+        bool reduceOverdraw = false;
+        float overdrawThreshold = 1.05f;    // Tolerated ACMR increase to split clusters
+        bool logStatistics = false;         // Analyze and log every primitive before and after
+    };
+
+    struct CacheStatistics
+    {
+        uint32_t triangles = 0;
+        uint32_t vertices = 0;              // Distinct vertices referenced by the indices
+        uint32_t transforms = 0;            // Cache misses
+        float acmr = 0.0f;
+        float atvr = 0.0f;
+    };
+
+    struct OverdrawStatistics
+    {
+        uint64_t pixelsCovered = 0;
+        uint64_t pixelsShaded = 0;
+        float overdraw = 0.0f;
+    };
+
+    const char* GetAlgorithmName(Algorithm algorithm);
+
+    // Returns kNumAlgorithms when the name matches no algorithm (case insensitive)
+    Algorithm FindAlgorithm(const char* name);
+
+    // Orders the triangles with the algorithm, cache size and overdraw reduction of 'settings'
+    // (statistics are not logged). The result goes to 'newIndices' and 'indices' is clobbered.
+    // Every index must be less than 'vertexCount' unless the algorithm is kForsyth without
+    // overdraw reduction. 'positions' is only read to reduce overdraw.
+    void Reorder(const Settings& settings, uint32_t* indices, size_t indexCount, const float* positions,
+        uint32_t vertexCount, uint32_t positionStride, uint32_t* newIndices);
+
+    // Every index must be less than 'vertexCount'. 'newIndices' must not alias 'indices'.
+    void Tipsify(const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize,
+        uint32_t* newIndices);
+
+    // 'positions' points to the first float3 position, 'positionStride' bytes apart. The
+    // cache size should match the one the input order was optimized for.
+    void ReduceOverdraw(const uint32_t* indices, size_t indexCount, const float* positions,
+        uint32_t vertexCount, uint32_t positionStride, uint32_t cacheSize, float threshold,
+        uint32_t* newIndices);
+
+    CacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, uint32_t vertexCount,
+        uint32_t cacheSize);
+
+    OverdrawStatistics AnalyzeOverdraw(const uint32_t* indices, size_t indexCount, const float* positions,
+        uint32_t vertexCount, uint32_t positionStride);
+}
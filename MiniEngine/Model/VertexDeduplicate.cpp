@@ -0,0 +1,167 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+// This file has no engine dependencies so that it can also be built into the
+// standalone deduplication benchmark (see Tools/VertexDedupBenchmark).
+
+#include "VertexDeduplicate.h"
+
+#include <chrono>
+#include <cmath>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+    // 64-bit FNV-1a over whole words, finished with a murmur style mix so the low bits used
+    // for the table index depend on every input byte
+    uint64_t HashBytes(const uint8_t* data, uint32_t size)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+
+        for (; size >= 8; size -= 8, data += 8)
+        {
+            uint64_t word;
+            memcpy(&word, data, 8);
+            hash = (hash ^ word) * 0x100000001b3ull;
+        }
+        for (; size > 0; --size, ++data)
+            hash = (hash ^ *data) * 0x100000001b3ull;
+
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    // Replaces toleranced float components with their grid cell
+    void MakeKey(const uint8_t* vertex, uint32_t stride, const VertexDeduplicate::Tolerance* tolerances,
+        uint32_t numTolerances, uint8_t* key)
+    {
+        memcpy(key, vertex, stride);
+
+        for (uint32_t t = 0; t < numTolerances; ++t)
+        {
+            const VertexDeduplicate::Tolerance& tol = tolerances[t];
+            if (tol.epsilon <= 0.0f || tol.offset + tol.components * 4 > stride)
+                continue;
+
+            for (uint32_t c = 0; c < tol.components; ++c)
+            {
+                float value;
+                memcpy(&value, vertex + tol.offset + c * 4, 4);
+
+                // Non-finite values and values too large for the grid keep their bit pattern
+                double cell = std::floor((double)value / tol.epsilon);
+                if (cell >= -2147483648.0 && cell <= 2147483647.0)
+                {
+                    int32_t cellIndex = (int32_t)cell;
+                    memcpy(key + tol.offset + c * 4, &cellIndex, 4);
+                }
+            }
+        }
+    }
+}
+
+uint32_t VertexDeduplicate::Deduplicate(const uint8_t* vertices, uint32_t vertexCount, uint32_t stride,
+    const Tolerance* tolerances, uint32_t numTolerances,
+    uint8_t* uniqueVertices, uint32_t* remap, Stats* stats)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    bool snapping = false;
+    for (uint32_t t = 0; t < numTolerances; ++t)
+    {
+        if (tolerances[t].epsilon > 0.0f && tolerances[t].offset + tolerances[t].components * 4 <= stride)
+            snapping = true;
+    }
+
+    // Open addressing with linear probing. Slots hold a unique vertex index plus one.
+    uint32_t tableSize = 16;
+    while (tableSize < vertexCount * 2ull)
+        tableSize *= 2;
+
+    std::vector<uint32_t> table(tableSize, 0);
+    std::vector<uint64_t> uniqueHashes;
+    uniqueHashes.reserve(vertexCount);
+
+    // With snapping, keys differ from the vertex data, so the keys of unique vertices are kept
+    std::vector<uint8_t> uniqueKeys;
+    std::vector<uint8_t> key;
+    if (snapping)
+    {
+        uniqueKeys.resize((size_t)vertexCount * stride);
+        key.resize(stride);
+    }
+
+    uint32_t uniqueCount = 0;
+
+    for (uint32_t v = 0; v < vertexCount; ++v)
+    {
+        const uint8_t* vertex = vertices + (size_t)v * stride;
+        const uint8_t* vertexKey = vertex;
+        const uint8_t* keys = uniqueVertices;
+
+        if (snapping)
+        {
+            MakeKey(vertex, stride, tolerances, numTolerances, key.data());
+            vertexKey = key.data();
+            keys = uniqueKeys.data();
+        }
+
+        const uint64_t hash = HashBytes(vertexKey, stride);
+        uint32_t slot = (uint32_t)hash & (tableSize - 1);
+
+        for (;;)
+        {
+            const uint32_t entry = table[slot];
+            if (entry == 0)
+            {
+                // A new unique vertex
+                table[slot] = uniqueCount + 1;
+                uniqueHashes.push_back(hash);
+                memcpy(uniqueVertices + (size_t)uniqueCount * stride, vertex, stride);
+                if (snapping)
+                    memcpy(uniqueKeys.data() + (size_t)uniqueCount * stride, vertexKey, stride);
+                remap[v] = uniqueCount++;
+                break;
+            }
+
+            const uint32_t candidate = entry - 1;
+            if (uniqueHashes[candidate] == hash && memcmp(keys + (size_t)candidate * stride, vertexKey, stride) == 0)
+            {
+                remap[v] = candidate;
+                break;
+            }
+
+            slot = (slot + 1) & (tableSize - 1);
+        }
+    }
+
+    if (stats != nullptr)
+    {
+        stats->inputVertices = vertexCount;
+        stats->outputVertices = uniqueCount;
+        stats->milliseconds = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    return uniqueCount;
+}
@@ -0,0 +1,59 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <stdint.h>
+
+//
+// Hash based removal of duplicate vertices from an interleaved vertex stream.
+//
+// Unique vertices are emitted in order of first use, and every vertex is remapped to the
+// first vertex equal to it, which is exactly what the original pairwise memcmp search
+// produced, but in expected linear time.
+//
+// Float attributes can be given a tolerance. Each such component is snapped to a grid of
+// 'epsilon' sized cells before hashing and comparing, so vertices whose components share
+// cells are merged and keep the values of the first one. Vertices closer than epsilon but on
+// opposite sides of a cell boundary are left alone. Bytes outside toleranced attributes must
+// match exactly, and an epsilon of zero disables snapping for that attribute.
+//
+namespace VertexDeduplicate
+{
+    struct Tolerance
+    {
+        uint32_t offset;        // Byte offset of a float attribute within the vertex
+        uint32_t components;    // Number of 32-bit float components
+        float epsilon;
+    };
+
+    struct Stats
+    {
+        uint32_t inputVertices;
+        uint32_t outputVertices;
+        double milliseconds;
+    };
+
+    // Writes the unique vertices to 'uniqueVertices' (room for 'vertexCount' vertices) and
+    // the new index of every input vertex to 'remap'. Returns the number of unique vertices.
+    uint32_t Deduplicate(const uint8_t* vertices, uint32_t vertexCount, uint32_t stride,
+        const Tolerance* tolerances, uint32_t numTolerances,
+        uint8_t* uniqueVertices, uint32_t* remap, Stats* stats = nullptr);
+}
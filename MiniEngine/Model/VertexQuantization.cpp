@@ -0,0 +1,384 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+// This file has no engine dependencies so that it can also be built into the
+// standalone quantization check (see Tools/VertexQuantizationCheck).
+
+#include "VertexQuantization.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace std;
+using namespace VertexQuantization;
+
+namespace
+{
+    const char* s_ProfileNames[kNumProfiles] = { "None", "Standard", "Compact" };
+
+    inline uint16_t QuantizeUnorm16(float value, float scale, float bias)
+    {
+        if (!(scale > 0.0f))
+            return 0;
+
+        const float t = (value - bias) / scale;
+        return (uint16_t)(min(max(t, 0.0f), 1.0f) * 65535.0f + 0.5f);
+    }
+
+    inline float DecodeUnorm16(uint16_t code)
+    {
+        return code / 65535.0f;
+    }
+
+    // SNORM with 'bits' bits, as D3D decodes it
+    inline float DecodeSnorm(int32_t code, uint32_t bits)
+    {
+        const float maxCode = (float)((1 << (bits - 1)) - 1);
+        return max(code / maxCode, -1.0f);
+    }
+
+    inline void Normalize(float v[3])
+    {
+        const float length = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        if (length > 0.0f)
+        {
+            v[0] /= length;
+            v[1] /= length;
+            v[2] /= length;
+        }
+    }
+
+    // Of the four codes around the exact octahedral coordinates, the one decoding closest to 'v'
+    void EncodeFrameVector(const float v[3], uint32_t bits, int32_t code[2])
+    {
+        const float maxCode = (float)((1 << (bits - 1)) - 1);
+
+        float unit[3] = { v[0], v[1], v[2] };
+        Normalize(unit);
+
+        float x, y;
+        OctahedralEncode(unit, x, y);
+
+        const int32_t x0 = (int32_t)floor(x * maxCode);
+        const int32_t y0 = (int32_t)floor(y * maxCode);
+        float bestDot = -2.0f;
+
+        for (int32_t i = 0; i < 4; ++i)
+        {
+            const int32_t cx = min(max(x0 + (i & 1), -(int32_t)maxCode), (int32_t)maxCode);
+            const int32_t cy = min(max(y0 + (i >> 1), -(int32_t)maxCode), (int32_t)maxCode);
+
+            float decoded[3];
+            OctahedralDecode(DecodeSnorm(cx, bits), DecodeSnorm(cy, bits), decoded);
+            const float d = decoded[0] * unit[0] + decoded[1] * unit[1] + decoded[2] * unit[2];
+            if (d > bestDot)
+            {
+                bestDot = d;
+                code[0] = cx;
+                code[1] = cy;
+            }
+        }
+    }
+
+    // atan2 of the cross and dot products stays accurate for small angles, where acos of the
+    // dot product would be limited by float precision to about 0.03 degrees
+    inline float AngleDegrees(const float a[3], const float b[3])
+    {
+        const float cx = a[1] * b[2] - a[2] * b[1];
+        const float cy = a[2] * b[0] - a[0] * b[2];
+        const float cz = a[0] * b[1] - a[1] * b[0];
+        const float d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        return atan2(sqrt(cx * cx + cy * cy + cz * cz), d) * 57.29578f;
+    }
+}
+
+const char* VertexQuantization::GetProfileName(Profile profile)
+{
+    return profile < kNumProfiles ? s_ProfileNames[profile] : "Unknown";
+}
+
+Profile VertexQuantization::FindProfile(const char* name)
+{
+    for (uint32_t p = 0; p < kNumProfiles; ++p)
+    {
+        const char* expected = s_ProfileNames[p];
+        size_t i = 0;
+        while (name[i] != '\0' && tolower((unsigned char)name[i]) == tolower((unsigned char)expected[i]))
+            ++i;
+
+        if (name[i] == '\0' && expected[i] == '\0')
+            return (Profile)p;
+    }
+    return kNumProfiles;
+}
+
+void VertexQuantization::OctahedralEncode(const float v[3], float& x, float& y)
+{
+    const float l1 = fabs(v[0]) + fabs(v[1]) + fabs(v[2]);
+    if (!(l1 > 0.0f))
+    {
+        x = y = 0.0f;
+        return;
+    }
+
+    x = v[0] / l1;
+    y = v[1] / l1;
+
+    // Fold the lower hemisphere over the diagonals
+    if (v[2] < 0.0f)
+    {
+        const float fx = (1.0f - fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float fy = (1.0f - fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+}
+
+void VertexQuantization::OctahedralDecode(float x, float y, float v[3])
+{
+    // Same operations as OctahedralDecode in Common.hlsli
+    v[0] = x;
+    v[1] = y;
+    v[2] = 1.0f - fabs(x) - fabs(y);
+
+    const float t = max(-v[2], 0.0f);
+    v[0] += v[0] >= 0.0f ? -t : t;
+    v[1] += v[1] >= 0.0f ? -t : t;
+    Normalize(v);
+}
+
+Dequantization VertexQuantization::ComputeDequantization(const Streams& streams)
+{
+    Dequantization result = {};
+    if (streams.vertexCount == 0)
+        return result;
+
+    float minPos[3], maxPos[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        minPos[k] = numeric_limits<float>::max();
+        maxPos[k] = -numeric_limits<float>::max();
+    }
+
+    for (uint32_t v = 0; v < streams.vertexCount; ++v)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            minPos[k] = min(minPos[k], streams.positions[v * 3 + k]);
+            maxPos[k] = max(maxPos[k], streams.positions[v * 3 + k]);
+        }
+    }
+
+    for (int k = 0; k < 3; ++k)
+    {
+        result.positionScale[k] = maxPos[k] - minPos[k];
+        result.positionBias[k] = minPos[k];
+    }
+
+    float minUV[2] = { numeric_limits<float>::max(), numeric_limits<float>::max() };
+    float maxUV[2] = { -numeric_limits<float>::max(), -numeric_limits<float>::max() };
+    bool hasUVs = false;
+
+    for (int set = 0; set < 2; ++set)
+    {
+        if (streams.uvs[set] == nullptr)
+            continue;
+
+        hasUVs = true;
+        for (uint32_t v = 0; v < streams.vertexCount; ++v)
+        {
+            for (int k = 0; k < 2; ++k)
+            {
+                minUV[k] = min(minUV[k], streams.uvs[set][v * 2 + k]);
+                maxUV[k] = max(maxUV[k], streams.uvs[set][v * 2 + k]);
+            }
+        }
+    }
+
+    if (hasUVs)
+    {
+        result.uvScaleBias[0] = maxUV[0] - minUV[0];
+        result.uvScaleBias[1] = maxUV[1] - minUV[1];
+        result.uvScaleBias[2] = minUV[0];
+        result.uvScaleBias[3] = minUV[1];
+    }
+
+    return result;
+}
+
+void VertexQuantization::Encode(const Streams& streams, Profile profile, const Dequantization& dequantization,
+    const Layout& layout, uint8_t* vertices)
+{
+    assert(profile != kNone && profile < kNumProfiles);
+
+    const uint32_t frameBits = profile == kCompact ? 8 : 16;
+    const float* scale = dequantization.positionScale;
+    const float* bias = dequantization.positionBias;
+
+    for (uint32_t v = 0; v < streams.vertexCount; ++v)
+    {
+        uint8_t* vertex = vertices + (size_t)v * layout.stride;
+
+        if (layout.position != kNotPresent)
+        {
+            const float* p = streams.positions + v * 3;
+            const bool positiveHandedness = streams.tangents == nullptr || streams.tangents[v * 4 + 3] >= 0.0f;
+            const uint16_t code[4] = {
+                QuantizeUnorm16(p[0], scale[0], bias[0]),
+                QuantizeUnorm16(p[1], scale[1], bias[1]),
+                QuantizeUnorm16(p[2], scale[2], bias[2]),
+                (uint16_t)(positiveHandedness ? 65535 : 0) };
+            memcpy(vertex + layout.position, code, sizeof(code));
+        }
+
+        if (layout.frame != kNotPresent && streams.normals != nullptr)
+        {
+            int32_t code[4] = {};
+            EncodeFrameVector(streams.normals + v * 3, frameBits, code);
+            if (streams.tangents != nullptr)
+                EncodeFrameVector(streams.tangents + v * 4, frameBits, code + 2);
+
+            if (frameBits == 8)
+            {
+                const int8_t packed[4] = { (int8_t)code[0], (int8_t)code[1], (int8_t)code[2], (int8_t)code[3] };
+                memcpy(vertex + layout.frame, packed, sizeof(packed));
+            }
+            else
+            {
+                const int16_t packed[4] = { (int16_t)code[0], (int16_t)code[1], (int16_t)code[2], (int16_t)code[3] };
+                memcpy(vertex + layout.frame, packed, sizeof(packed));
+            }
+        }
+
+        for (int set = 0; set < 2; ++set)
+        {
+            if (layout.uv[set] == kNotPresent || streams.uvs[set] == nullptr)
+                continue;
+
+            const float* uv = streams.uvs[set] + v * 2;
+            const uint16_t code[2] = {
+                QuantizeUnorm16(uv[0], dequantization.uvScaleBias[0], dequantization.uvScaleBias[2]),
+                QuantizeUnorm16(uv[1], dequantization.uvScaleBias[1], dequantization.uvScaleBias[3]) };
+            memcpy(vertex + layout.uv[set], code, sizeof(code));
+        }
+    }
+}
+
+void VertexQuantization::Decode(const uint8_t* vertex, Profile profile, const Dequantization& dequantization,
+    const Layout& layout, Vertex& result)
+{
+    assert(profile != kNone && profile < kNumProfiles);
+
+    result = Vertex();
+    float handedness = 1.0f;
+
+    if (layout.position != kNotPresent)
+    {
+        uint16_t code[4];
+        memcpy(code, vertex + layout.position, sizeof(code));
+        for (int k = 0; k < 3; ++k)
+            result.position[k] = DecodeUnorm16(code[k]) * dequantization.positionScale[k] + dequantization.positionBias[k];
+        handedness = DecodeUnorm16(code[3]) * 2.0f - 1.0f;
+    }
+
+    if (layout.frame != kNotPresent)
+    {
+        float frame[4];
+        if (profile == kCompact)
+        {
+            int8_t code[4];
+            memcpy(code, vertex + layout.frame, sizeof(code));
+            for (int k = 0; k < 4; ++k)
+                frame[k] = DecodeSnorm(code[k], 8);
+        }
+        else
+        {
+            int16_t code[4];
+            memcpy(code, vertex + layout.frame, sizeof(code));
+            for (int k = 0; k < 4; ++k)
+                frame[k] = DecodeSnorm(code[k], 16);
+        }
+
+        OctahedralDecode(frame[0], frame[1], result.normal);
+        OctahedralDecode(frame[2], frame[3], result.tangent);
+        result.tangent[3] = handedness;
+    }
+
+    for (int set = 0; set < 2; ++set)
+    {
+        if (layout.uv[set] == kNotPresent)
+            continue;
+
+        uint16_t code[2];
+        memcpy(code, vertex + layout.uv[set], sizeof(code));
+        result.uv[set][0] = DecodeUnorm16(code[0]) * dequantization.uvScaleBias[0] + dequantization.uvScaleBias[2];
+        result.uv[set][1] = DecodeUnorm16(code[1]) * dequantization.uvScaleBias[1] + dequantization.uvScaleBias[3];
+    }
+}
+
+ErrorStatistics VertexQuantization::MeasureError(const Streams& streams, const uint8_t* vertices, Profile profile,
+    const Dequantization& dequantization, const Layout& layout)
+{
+    ErrorStatistics stats;
+
+    const float extent = max(dequantization.positionScale[0], max(dequantization.positionScale[1], dequantization.positionScale[2]));
+
+    for (uint32_t v = 0; v < streams.vertexCount; ++v)
+    {
+        Vertex decoded;
+        Decode(vertices + (size_t)v * layout.stride, profile, dequantization, layout, decoded);
+
+        if (layout.position != kNotPresent)
+        {
+            const float* p = streams.positions + v * 3;
+            const float dx = decoded.position[0] - p[0], dy = decoded.position[1] - p[1], dz = decoded.position[2] - p[2];
+            stats.position = max(stats.position, sqrt(dx * dx + dy * dy + dz * dz));
+        }
+
+        if (layout.frame != kNotPresent && streams.normals != nullptr)
+        {
+            stats.normalDegrees = max(stats.normalDegrees, AngleDegrees(decoded.normal, streams.normals + v * 3));
+
+            if (streams.tangents != nullptr)
+            {
+                const float* t = streams.tangents + v * 4;
+                stats.tangentDegrees = max(stats.tangentDegrees, AngleDegrees(decoded.tangent, t));
+                if (layout.position != kNotPresent && (t[3] < 0.0f) != (decoded.tangent[3] < 0.0f))
+                    ++stats.handednessErrors;
+            }
+        }
+
+        for (int set = 0; set < 2; ++set)
+        {
+            if (layout.uv[set] == kNotPresent || streams.uvs[set] == nullptr)
+                continue;
+
+            const float* uv = streams.uvs[set] + v * 2;
+            stats.uv = max(stats.uv, max(fabs(decoded.uv[set][0] - uv[0]), fabs(decoded.uv[set][1] - uv[1])));
+        }
+    }
+
+    stats.positionRelative = extent > 0.0f ? stats.position / extent : 0.0f;
+    return stats;
+}
@@ -0,0 +1,134 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+
+//
+// Quantized vertex formats for OptimizeMesh.
+//
+// Without quantization (kNone) positions are 32-bit floats, normals and tangents 10:10:10:2
+// and UVs half floats. The quantized profiles store:
+//
+//   POSITION   R16G16B16A16_UNORM    xyz within the bounds of the primitive, w the tangent
+//                                    handedness (0 for -1, 1 for +1)
+//   NORMAL     R16G16B16A16_SNORM    octahedral normal in xy and octahedral tangent in zw,
+//              or R8G8B8A8_SNORM     16 bits per component for kStandard, 8 for kCompact
+//   TEXCOORDn  R16G16_UNORM          within the UV range of the primitive
+//
+// The vertex shader maps positions and UVs back with the scale and bias in Dequantization.
+// Both UV sets share one range so that the alpha tested depth stream can reuse it for
+// either set. A vertex with a tangent and one UV set shrinks from 24 bytes to 20 (kStandard)
+// or 16 (kCompact).
+//
+// Octahedral encoding (Cigolle et al., "A Survey of Efficient Representations for
+// Independent Unit Vectors", 2014) picks, of the four nearest codes, the one that decodes
+// closest to the source vector.
+//
+namespace VertexQuantization
+{
+    enum Profile
+    {
+        kNone,
+        kStandard,
+        kCompact,
+        kNumProfiles
+    };
+
+    const char* GetProfileName(Profile profile);
+
+    // Returns kNumProfiles when the name matches no profile (case insensitive)
+    Profile FindProfile(const char* name);
+
+    static const uint32_t kPositionSize = 8;
+
+    // Size of the NORMAL element, which holds the tangent as well
+    inline uint32_t GetFrameSize(Profile profile) { return profile == kCompact ? 4 : 8; }
+
+    // Laid out like the VertexDequantization constants of the vertex shaders
+    struct Dequantization
+    {
+        float positionScale[4];     // Bounds extent, w unused
+        float positionBias[4];      // Bounds minimum, w unused
+        float uvScaleBias[4];       // UV range extent in xy and minimum in zw
+    };
+
+    // Float attributes of a primitive. Only positions are required.
+    struct Streams
+    {
+        uint32_t vertexCount = 0;
+        const float* positions = nullptr;   // float3
+        const float* normals = nullptr;     // float3
+        const float* tangents = nullptr;    // float4, w is the handedness
+        const float* uvs[2] = {};           // float2
+    };
+
+    static const uint32_t kNotPresent = ~0u;
+
+    // Byte offsets of the quantized attributes within a vertex, or kNotPresent
+    struct Layout
+    {
+        uint32_t stride;
+        uint32_t position;
+        uint32_t frame;
+        uint32_t uv[2];
+    };
+
+    // A vertex as the vertex shader reconstructs it
+    struct Vertex
+    {
+        float position[3];
+        float normal[3];
+        float tangent[4];
+        float uv[2][2];
+    };
+
+    struct ErrorStatistics
+    {
+        float position = 0.0f;          // Largest distance to the source position
+        float positionRelative = 0.0f;  // The same, relative to the largest bounds extent
+        float normalDegrees = 0.0f;
+        float tangentDegrees = 0.0f;
+        float uv = 0.0f;                // Largest difference of a UV component
+        uint32_t handednessErrors = 0;
+    };
+
+    // Bounds and UV range of the streams
+    Dequantization ComputeDequantization(const Streams& streams);
+
+    // Writes the quantized attributes listed in 'layout' for every vertex. Other bytes of the
+    // vertices are left alone, so that attributes such as joint indices can be written
+    // before or after. Tangents go in the frame only when the normals do.
+    void Encode(const Streams& streams, Profile profile, const Dequantization& dequantization,
+        const Layout& layout, uint8_t* vertices);
+
+    // Attributes not in 'layout' are set to zero
+    void Decode(const uint8_t* vertex, Profile profile, const Dequantization& dequantization,
+        const Layout& layout, Vertex& result);
+
+    // Decodes every vertex and compares it with the source
+    ErrorStatistics MeasureError(const Streams& streams, const uint8_t* vertices, Profile profile,
+        const Dequantization& dequantization, const Layout& layout);
+
+    // Maps a vector to the [-1, 1] square, zero to the center, and back to a unit vector
+    void OctahedralEncode(const float v[3], float& x, float& y);
+    void OctahedralDecode(float x, float y, float v[3]);
+}
@@ -33,7 +33,7 @@ void ReadFloats( json& list, float flt_array[] )
         flt_array[i++] = flt;
 }
 
-void glTF::Asset::ProcessNodes( json& nodes )
+bool glTF::Asset::ProcessNodes( json& nodes )
 {
     m_nodes.resize(nodes.size());
 
@@ -50,18 +50,29 @@ void glTF::Asset::ProcessNodes( json& nodes )
 
         if (thisNode.find("camera") != thisNode.end())
         {
-            node.camera = &m_cameras[thisNode.at("camera")];
+            node.camera = &m_cameras.at(thisNode.at("camera"));
             node.pointsToCamera = true;
         }
         else if (thisNode.find("mesh") != thisNode.end())
         {
-            node.mesh = &m_meshes[thisNode.at("mesh")];
+            node.mesh = &m_meshes.at(thisNode.at("mesh"));
         }
 
         if (thisNode.find("skin") != thisNode.end())
         {
-            ASSERT(node.mesh != nullptr);
-            node.mesh->skin = thisNode.at("skin");
+            // Skins are only read through the node's mesh
+            const uint32_t skin = thisNode.at("skin");
+            if (node.mesh == nullptr)
+            {
+                LOG_ERRORF("glTF node %u has a skin but no mesh.", nodeIdx - 1);
+                return false;
+            }
+            if (skin >= m_skins.size())
+            {
+                LOG_ERRORF("glTF node %u has skin %u of %zu.", nodeIdx - 1, skin, m_skins.size());
+                return false;
+            }
+            node.mesh->skin = skin;
         }
 
         if (thisNode.find("children") != thisNode.end())
@@ -69,7 +80,7 @@ void glTF::Asset::ProcessNodes( json& nodes )
             json& children = thisNode["children"];
             node.children.reserve(children.size());
             for (auto& child : children)
-                node.children.push_back(&m_nodes[child]);
+                node.children.push_back(&m_nodes.at(child));
         }
 
         if (thisNode.find("matrix") != thisNode.end())
@@ -119,6 +130,8 @@ void glTF::Asset::ProcessNodes( json& nodes )
             }
         }
     }
+
+    return true;
 }
 
 void glTF::Asset::ProcessScenes( json& scenes )
@@ -135,7 +148,7 @@ void glTF::Asset::ProcessScenes( json& scenes )
             json& nodes = thisScene["nodes"];
             scene.nodes.reserve(nodes.size());
             for (auto& node : nodes)
-                scene.nodes.push_back(&m_nodes[node]);
+                scene.nodes.push_back(&m_nodes.at(node));
         }
 
         m_scenes.push_back(scene);
@@ -189,30 +202,72 @@ uint16_t TypeToEnum( const char type[] )
         return Accessor::kScalar;
 }
 
-void glTF::Asset::ProcessAccessors( json& accessors )
+bool glTF::Asset::ProcessAccessors( json& accessors )
 {
     m_accessors.reserve(accessors.size());
 
-    for (json::iterator it = accessors.begin(); it != accessors.end(); ++it)
+    std::vector<glTFDecode::BufferViewDesc> views(m_bufferViews.size());
+    for (size_t i = 0; i < m_bufferViews.size(); ++i)
+    {
+        const glTF::BufferView& bufferView = m_bufferViews[i];
+        views[i] = { bufferView.buffer, bufferView.byteOffset, bufferView.byteLength, bufferView.byteStride };
+    }
+
+    uint32_t accessorIdx = 0;
+    for (json::iterator it = accessors.begin(); it != accessors.end(); ++it, ++accessorIdx)
     {
-        glTF::Accessor accessor;
         json& thisAccessor = it.value();
 
-        glTF::BufferView& bufferView = m_bufferViews[thisAccessor.at("bufferView")];
-        accessor.dataPtr = m_buffers[bufferView.buffer]->data() + bufferView.byteOffset;
-        accessor.stride = bufferView.byteStride;
+        glTFDecode::AccessorDesc desc;
+        desc.Count = thisAccessor.at("count");
+        desc.ComponentType = thisAccessor.at("componentType").get<uint32_t>() - 5120;
+        desc.Type = TypeToEnum(thisAccessor.at("type").get<std::string>().c_str());
+
+        // Without a buffer view, the accessor is all zeros unless sparse values replace them
+        if (thisAccessor.find("bufferView") != thisAccessor.end())
+            desc.BufferView = thisAccessor.at("bufferView");
         if (thisAccessor.find("byteOffset") != thisAccessor.end())
-            accessor.dataPtr += thisAccessor.at("byteOffset");
-        accessor.count = thisAccessor.at("count");
-        accessor.componentType = thisAccessor.at("componentType").get<uint16_t>() - 5120;
+            desc.ByteOffset = thisAccessor.at("byteOffset");
 
-        char type[8];
-        strcpy_s(type, thisAccessor.at("type").get<std::string>().c_str());
+        if (thisAccessor.find("sparse") != thisAccessor.end())
+        {
+            json& sparse = thisAccessor.at("sparse");
+            json& indices = sparse.at("indices");
+            json& values = sparse.at("values");
+            desc.Sparse.Count = sparse.at("count");
+            desc.Sparse.IndicesView = indices.at("bufferView");
+            desc.Sparse.IndicesComponentType = indices.at("componentType").get<uint32_t>() - 5120;
+            desc.Sparse.ValuesView = values.at("bufferView");
+            if (indices.find("byteOffset") != indices.end())
+                desc.Sparse.IndicesOffset = indices.at("byteOffset");
+            if (values.find("byteOffset") != values.end())
+                desc.Sparse.ValuesOffset = values.at("byteOffset");
+        }
+
+        ByteArray storage = make_shared<vector<byte>>();
+        glTFDecode::ResolvedAccessor resolved;
+        glTFDecode::Status status = glTFDecode::ResolveAccessor(m_buffers, views, desc, *storage, resolved);
+        if (status != glTFDecode::kOK)
+        {
+            LOG_ERRORF("glTF accessor %u:  %s.", accessorIdx, glTFDecode::GetStatusString(status));
+            return false;
+        }
+
+        glTF::Accessor accessor;
+        accessor.dataPtr = (byte*)resolved.Data;
+        accessor.stride = resolved.Stride;
+        accessor.count = desc.Count;
+        accessor.componentType = (uint16_t)desc.ComponentType;
+        accessor.type = (uint16_t)desc.Type;
 
-        accessor.type = TypeToEnum(type);
+        // Sparse accessors and those without a buffer view were expanded into 'storage'
+        if (!storage->empty())
+            m_ownedData.push_back(storage);
 
         m_accessors.push_back(accessor);
     }
+
+    return true;
 }
 
 void glTF::Asset::FindAttribute( Primitive& prim, json& attributes, Primitive::eAttribType type, const string& name )
@@ -221,7 +276,7 @@ void glTF::Asset::FindAttribute( Primitive& prim, json& attributes, Primitive::e
     if (attrib != attributes.end())
     {
         prim.attribMask |= 1 << type;
-        prim.attributes[type] = &m_accessors[attrib.value()];
+        prim.attributes[type] = &m_accessors.at(attrib.value());
     }
     else
     {
@@ -229,7 +284,7 @@ void glTF::Asset::FindAttribute( Primitive& prim, json& attributes, Primitive::e
     }
 }
 
-void glTF::Asset::ProcessMeshes( json& meshes, json& accessors )
+bool glTF::Asset::ProcessMeshes( json& meshes, json& accessors )
 {
     m_meshes.resize(meshes.size());
 
@@ -260,8 +315,25 @@ void glTF::Asset::ProcessMeshes( json& meshes, json& accessors )
             FindAttribute(prim, attributes, Primitive::kJoints0, "JOINTS_0");
             FindAttribute(prim, attributes, Primitive::kWeights0, "WEIGHTS_0");
 
+            // Every attribute is read for as many vertices as there are positions
+            if (prim.attributes[Primitive::kPosition] == nullptr)
+            {
+                LOG_ERRORF("glTF mesh %u primitive %u has no positions.", curMesh, curSubMesh);
+                return false;
+            }
+            const uint32_t vertexCount = prim.attributes[Primitive::kPosition]->count;
+            for (uint32_t a = 0; a < Primitive::kNumAttribs; ++a)
+            {
+                if (prim.attributes[a] != nullptr && prim.attributes[a]->count < vertexCount)
+                {
+                    LOG_ERRORF("glTF mesh %u primitive %u has %u elements in attribute %u but %u vertices.",
+                        curMesh, curSubMesh, prim.attributes[a]->count, a, vertexCount);
+                    return false;
+                }
+            }
+
             // Read position AABB
-            json& positionAccessor = accessors[attributes.at("POSITION").get<uint32_t>()];
+            json& positionAccessor = accessors.at(attributes.at("POSITION").get<uint32_t>());
             ReadFloats(positionAccessor.at("min"), prim.minPos);
             ReadFloats(positionAccessor.at("max"), prim.maxPos);
 
@@ -278,24 +350,38 @@ void glTF::Asset::ProcessMeshes( json& meshes, json& accessors )
             if (thisPrim.find("indices") != thisPrim.end())
             {
                 uint32_t accessorIndex = thisPrim.at("indices");
-                json& indicesAccessor = accessors[accessorIndex];
-                prim.indices = &m_accessors[accessorIndex];
-                if (indicesAccessor.find("max") != indicesAccessor.end())
-                    prim.maxIndex = indicesAccessor.at("max")[0];
+                json& indicesAccessor = accessors.at(accessorIndex);
+                prim.indices = &m_accessors.at(accessorIndex);
                 if (indicesAccessor.find("min") != indicesAccessor.end())
                     prim.minIndex = indicesAccessor.at("min")[0];
+
+                // The optional "max" cannot be trusted, so the indices are scanned, in parallel
+                // when there are many.  The mesh builder uses this maximum instead of its own scan.
+                const Accessor& indices = *prim.indices;
+                if (!glTFDecode::FindMaxIndex(indices.dataPtr, indices.stride, indices.componentType, indices.count, prim.maxIndex))
+                {
+                    LOG_ERRORF("glTF mesh %u primitive %u has indices of component type %u.", curMesh, curSubMesh, indices.componentType + 5120);
+                    return false;
+                }
+                if (indices.count > 0 && prim.maxIndex >= vertexCount)
+                {
+                    LOG_ERRORF("glTF mesh %u primitive %u has index %u for %u vertices.", curMesh, curSubMesh, prim.maxIndex, vertexCount);
+                    return false;
+                }
             }
 
             if (thisPrim.find("material") != thisPrim.end())
-                prim.material = &m_materials[thisPrim.at("material")];
+                prim.material = &m_materials.at(thisPrim.at("material"));
 
             // TODO:  Add morph targets
             //if (thisPrim.find("targets") != thisPrim.end())
         }
     }
+
+    return true;
 }
 
-void glTF::Asset::ProcessSkins( json& skins )
+bool glTF::Asset::ProcessSkins( json& skins )
 {
     uint32_t skinIdx = 0;
 
@@ -308,20 +394,34 @@ void glTF::Asset::ProcessSkins( json& skins )
         skin.inverseBindMatrices = nullptr;
         skin.skeleton = nullptr;
 
-        if (thisSkin.find("inverseBindMatrices") != thisSkin.end())
-            skin.inverseBindMatrices = &m_accessors[thisSkin.at("inverseBindMatrices")];
-
         if (thisSkin.find("skeleton") != thisSkin.end())
         {
-            skin.skeleton = &m_nodes[thisSkin.at("skeleton")];
+            skin.skeleton = &m_nodes.at(thisSkin.at("skeleton"));
             skin.skeleton->skeletonRoot = true;
         }
 
         json& joints = thisSkin.at("joints");
         skin.joints.reserve(joints.size());
         for (auto& joint : joints)
-            skin.joints.push_back(&m_nodes[joint]);
+            skin.joints.push_back(&m_nodes.at(joint));
+
+        // Without them, every inverse bind matrix is the identity
+        if (thisSkin.find("inverseBindMatrices") != thisSkin.end())
+        {
+            skin.inverseBindMatrices = &m_accessors.at(thisSkin.at("inverseBindMatrices"));
+
+            const Accessor& matrices = *skin.inverseBindMatrices;
+            glTFDecode::Status status = glTFDecode::CheckInverseBindMatrices(
+                matrices.componentType, matrices.type, matrices.count, (uint32_t)skin.joints.size());
+            if (status != glTFDecode::kOK)
+            {
+                LOG_ERRORF("glTF skin %u inverse bind matrices:  %s.", skinIdx - 1, glTFDecode::GetStatusString(status));
+                return false;
+            }
+        }
     }
+
+    return true;
 }
 
 inline uint32_t floatToHalf( float f )
@@ -337,7 +437,7 @@ uint32_t glTF::Asset::ReadTextureInfo( json& info_json, glTF::Texture* &info )
     info = nullptr;
 
     if (info_json.find("index") != info_json.end())
-        info = &m_textures[info_json.at("index")];
+        info = &m_textures.at(info_json.at("index"));
 
     if (info_json.find("texCoord") != info_json.end())
         return info_json.at("texCoord");
@@ -345,12 +445,6 @@ uint32_t glTF::Asset::ReadTextureInfo( json& info_json, glTF::Texture* &info )
         return 0;
 }
 
-void Asset::DecodeURI( std::string& uri )
-{
-    // TODO: real URI decoding
-    nlohmann::detail::replace_substring(uri, "%20", " ");
-}
-
 void glTF::Asset::ProcessMaterials( json& materials )
 {
     m_materials.reserve(materials.size());
@@ -459,32 +553,90 @@ bool ReadFile(const wstring& fileName, void* Dest, size_t Size)
     return true;
 }
 
-void glTF::Asset::ProcessBuffers( json& buffers, ByteArray chunk1bin )
+bool glTF::Asset::MapFile( const wstring& filepath, glTFDecode::BufferRange& range )
+{
+    std::unique_ptr<Renderer::MappedFile> mappedFile(new Renderer::MappedFile);
+    if (mappedFile->Open(filepath))
+    {
+        range = { mappedFile->GetData(), mappedFile->GetSize() };
+        m_mappedFiles.push_back(std::move(mappedFile));
+        return true;
+    }
+
+    // A ".gz" version has to be decompressed into memory
+    ByteArray ba = ReadFileSync(filepath);
+    if (ba->size() == 0)
+        return false;
+
+    range = { ba->data(), ba->size() };
+    m_ownedData.push_back(ba);
+    return true;
+}
+
+bool glTF::Asset::ProcessBuffers( json& buffers, const glTFDecode::BufferRange& glbBin )
 {
     m_buffers.reserve(buffers.size());
 
     for (json::iterator it = buffers.begin(); it != buffers.end(); ++it)
     {
         json& thisBuffer = it.value();
+        uint64_t byteLength = thisBuffer.at("byteLength");
+        glTFDecode::BufferRange range = {};
 
         if (thisBuffer.find("uri") != thisBuffer.end())
         {
-            string uri = thisBuffer.at("uri");
-            DecodeURI(uri);
-
-            wstring filepath = m_basePath + Utility::UTF8ToWideString(uri);
-
-            ByteArray ba = ReadFileSync(filepath);
-            ASSERT(ba->size() > 0, "Missing bin file %ws", filepath.c_str());
-            m_buffers.push_back(ba);
+            const string& uri = thisBuffer.at("uri").get_ref<const string&>();
+            if (glTFDecode::IsDataURI(uri))
+            {
+                ByteArray ba = make_shared<vector<byte>>();
+                if (!glTFDecode::DecodeDataURI(uri, *ba))
+                {
+                    LOG_ERRORF("glTF buffer %u has an invalid data URI.", (uint32_t)m_buffers.size());
+                    return false;
+                }
+                range = { ba->data(), ba->size() };
+                m_ownedData.push_back(ba);
+            }
+            else
+            {
+                string path;
+                if (!glTFDecode::DecodeURI(uri, path))
+                {
+                    LOG_ERRORF("glTF buffer %u has an invalid URI:  %s.", (uint32_t)m_buffers.size(), uri.c_str());
+                    return false;
+                }
+
+                wstring filepath = m_basePath + Utility::UTF8ToWideString(path);
+                if (!MapFile(filepath, range))
+                {
+                    LOG_ERRORF("Missing glTF buffer file %s.", Utility::WideStringToUTF8(filepath).c_str());
+                    return false;
+                }
+            }
         }
         else
         {
-            ASSERT(it == buffers.begin(), "Only the 1st buffer allowed to be internal");
-            ASSERT(chunk1bin->size() > 0, "GLB chunk1 missing data or not a GLB file");
-            m_buffers.push_back(chunk1bin);
+            if (it != buffers.begin() || glbBin.Data == nullptr)
+            {
+                LOG_ERROR("Only the first glTF buffer may refer to the GLB binary chunk.");
+                return false;
+            }
+            range = glbBin;
+        }
+
+        // Buffer views are checked against what is actually there, but a short buffer is
+        // already a sign of a damaged file
+        if (range.Size < byteLength)
+        {
+            LOG_ERRORF("glTF buffer %u has %llu bytes of %llu.", (uint32_t)m_buffers.size(), range.Size, byteLength);
+            return false;
         }
+        range.Size = byteLength;
+
+        m_buffers.push_back(range);
     }
+
+    return true;
 }
 
 void glTF::Asset::ProcessBufferViews( json& bufferViews )
@@ -525,12 +677,17 @@ void glTF::Asset::ProcessImages( json& images )
     for (json::iterator it = images.begin(); it != images.end(); ++it)
     {
         json& thisImage = it.value();
+        glTF::Image& image = m_images[imageIdx++];
         if (thisImage.find("uri") != thisImage.end())
         {
-            string uri = thisImage.at("uri").get<string>();
-            DecodeURI(uri);
-
-            m_images[imageIdx++].path = uri;
+            const string& uri = thisImage.at("uri").get_ref<const string&>();
+            if (glTFDecode::IsDataURI(uri))
+                LOG_INFOF("Embedded glTF image %u with a data URI.", imageIdx - 1);
+            else if (!glTFDecode::DecodeURI(uri, image.path))
+            {
+                LOG_ERRORF("glTF image %u has an invalid URI:  %s.", imageIdx - 1, uri.c_str());
+                image.path.clear();
+            }
         }
         else if (thisImage.find("bufferView") != thisImage.end())
         {
@@ -621,14 +778,14 @@ void glTF::Asset::ProcessTextures( json& textures )
         texture.sampler = nullptr;
 
         if (thisTexture.find("source") != thisTexture.end())
-            texture.source = &m_images[thisTexture.at("source")];
+            texture.source = &m_images.at(thisTexture.at("source"));
 
         if (thisTexture.find("sampler") != thisTexture.end())
-            texture.sampler = &m_samplers[thisTexture.at("sampler")];
+            texture.sampler = &m_samplers.at(thisTexture.at("sampler"));
     }
 }
 
-void glTF::Asset::ProcessAnimations(json& animations)
+bool glTF::Asset::ProcessAnimations(json& animations)
 {
     m_animations.resize(animations.size());
     uint32_t animIdx = 0;
@@ -648,8 +805,8 @@ void glTF::Asset::ProcessAnimations(json& animations)
         {
             json& thisSampler = it2.value();
             glTF::AnimSampler& sampler = animation.m_samplers[samplerIdx++];
-            sampler.m_input = &m_accessors[thisSampler.at("input")];
-            sampler.m_output = &m_accessors[thisSampler.at("output")];
+            sampler.m_input = &m_accessors.at(thisSampler.at("input"));
+            sampler.m_output = &m_accessors.at(thisSampler.at("output"));
             sampler.m_interpolation = AnimSampler::kLinear;
             if (thisSampler.find("interpolation") != thisSampler.end())
             {
@@ -663,6 +820,15 @@ void glTF::Asset::ProcessAnimations(json& animations)
                 else if (interpolation == "CUBICSPLINE")
                     sampler.m_interpolation = AnimSampler::kCubicSpline;
             }
+
+            glTFDecode::Status status = glTFDecode::CheckAnimationSampler(sampler.m_input->componentType,
+                sampler.m_input->type, sampler.m_input->count, sampler.m_output->count,
+                sampler.m_interpolation == AnimSampler::kCubicSpline);
+            if (status != glTFDecode::kOK)
+            {
+                LOG_ERRORF("glTF animation %u sampler %u:  %s.", animIdx - 1, samplerIdx - 1, glTFDecode::GetStatusString(status));
+                return false;
+            }
         }
 
         // Process this animation's channels
@@ -674,9 +840,9 @@ void glTF::Asset::ProcessAnimations(json& animations)
         {
             json& thisChannel = it2.value();
             glTF::AnimChannel& channel = animation.m_channels[channelIdx++];
-            channel.m_sampler = &animation.m_samplers[thisChannel.at("sampler")];
+            channel.m_sampler = &animation.m_samplers.at(thisChannel.at("sampler"));
             json& thisTarget = thisChannel.at("target");
-            channel.m_target = &m_nodes[thisTarget.at("node")];
+            channel.m_target = &m_nodes.at(thisTarget.at("node"));
             const std::string& path = thisTarget.at("path");
             if (path == "translation")
                 channel.m_path = AnimChannel::kTranslation;
@@ -688,118 +854,112 @@ void glTF::Asset::ProcessAnimations(json& animations)
                 channel.m_path = AnimChannel::kWeights;
         }
     }
+
+    return true;
 }
 
-void glTF::Asset::Parse(const std::wstring& filepath)
+bool glTF::Asset::Parse(const std::wstring& filepath)
 {
-    // TODO:  add GLB support by extracting JSON section and BIN sections
     //https://github.com/KhronosGroup/glTF/blob/master/specification/2.0/README.md#glb-file-format-specification
 
+    m_scene = nullptr;
+
     ByteArray gltfFile;
-    ByteArray chunk1Bin;
+    const char* jsonText = nullptr;
+    size_t jsonSize = 0;
+    glTFDecode::BufferRange glbBin = {};
 
     std::wstring fileExt = Utility::ToLower(Utility::GetFileExtension(filepath));
 
     if (fileExt == L"glb")
     {
-        ifstream glbFile(filepath, ios::in | ios::binary);
-        struct GLBHeader
+        // The BIN chunk is used in place, so the whole file stays mapped
+        glTFDecode::BufferRange glbFile;
+        if (!MapFile(filepath, glbFile))
+            return false;
+
+        glTFDecode::GLBChunks chunks;
+        glTFDecode::Status status = glTFDecode::ParseGLB(glbFile.Data, (size_t)glbFile.Size, chunks);
+        if (status != glTFDecode::kOK)
         {
-            char magic[4];
-            uint32_t version;
-            uint32_t length;
-        } header;
-        glbFile.read((char*)&header, sizeof(GLBHeader));
-        if (strncmp(header.magic, "glTF", 4) != 0)
-        {
-            LOG_ERROR("Error:  Invalid glTF binary format.");
-            return;
-        }
-        if (header.version != 2)
-        {
-            LOG_ERROR("Error:  Only glTF 2.0 is supported.");
-            return;
+            LOG_ERRORF("Invalid glTF binary file %s:  %s.", Utility::WideStringToUTF8(filepath).c_str(), glTFDecode::GetStatusString(status));
+            return false;
         }
 
-        uint32_t chunk0Length;
-        char chunk0Type[4];
-        glbFile.read((char*)&chunk0Length, 4);
-        glbFile.read((char*)&chunk0Type, 4);
-        if (strncmp(chunk0Type, "JSON", 4) != 0)
-        {
-            LOG_ERROR("Error: Expected chunk0 to contain JSON.");
-            return;
-        }
-        gltfFile = make_shared<vector<byte>>( chunk0Length + 1 );
-        glbFile.read((char*)gltfFile->data(), chunk0Length);
-        (*gltfFile)[chunk0Length] = '\0';
-
-        uint32_t chunk1Length;
-        char chunk1Type[4];
-        glbFile.read((char*)&chunk1Length, 4);
-        glbFile.read((char*)&chunk1Type, 4);
-        if (strncmp(chunk1Type, "BIN", 3) != 0)
-        {
-            LOG_ERROR("Error: Expected chunk1 to contain BIN.");
-            return;
-       }
-
-        chunk1Bin = make_shared<vector<byte>>(chunk1Length);
-        glbFile.read((char*)chunk1Bin->data(), chunk1Length);
+        jsonText = chunks.Json;
+        jsonSize = chunks.JsonSize;
+        glbBin = { chunks.Bin, chunks.BinSize };
     }
     else 
     {
         ASSERT(fileExt == L"gltf");
 
-        // Null terminate the string (just in case)
         gltfFile = ReadFileSync(filepath);
         if (gltfFile->size() == 0)
-            return;
+            return false;
 
-        gltfFile->push_back('\0');
-        chunk1Bin = make_shared<vector<byte>>(0);
+        jsonText = (const char*)gltfFile->data();
+        jsonSize = gltfFile->size();
     }
 
-    json root = json::parse((const char*)gltfFile->data());
+    // Malformed JSON yields a discarded value instead of an exception
+    json root = json::parse(jsonText, jsonText + jsonSize, nullptr, false);
     if (!root.is_object())
     {
         LOG_ERRORF("Invalid glTF file: %s.", Utility::WideStringToUTF8(filepath).c_str());
-        return;
+        return false;
     }
 
     // Strip off file name to get root path to other related files
     m_basePath = Utility::GetBasePath(filepath);
 
-    // Parse all state
-
-    if (root.find("buffers") != root.end())
-        ProcessBuffers(root.at("buffers"), chunk1Bin);
-    if (root.find("bufferViews") != root.end())
-        ProcessBufferViews(root.at("bufferViews"));
-    if (root.find("accessors") != root.end())
-        ProcessAccessors(root.at("accessors"));
-    if (root.find("images") != root.end())
-        ProcessImages(root.at("images"));
-    if (root.find("samplers") != root.end())
-        ProcessSamplers(root.at("samplers"));
-    if (root.find("textures") != root.end())
-        ProcessTextures(root.at("textures"));
-    if (root.find("materials") != root.end())
-        ProcessMaterials(root.at("materials"));
-    if (root.find("meshes") != root.end())
-        ProcessMeshes(root.at("meshes"), root.at("accessors"));
-    if (root.find("cameras") != root.end())
-        ProcessCameras(root.at("cameras"));
-    if (root.find("skins") != root.end())
-        m_skins.resize(root.at("skins").size());
-    if (root.find("nodes") != root.end())
-        ProcessNodes(root.at("nodes"));
-    if (root.find("skins") != root.end())
-        ProcessSkins(root.at("skins"));
-    if (root.find("scenes") != root.end())
-        ProcessScenes(root.at("scenes"));
-    if (root.find("animations") != root.end())
-        ProcessAnimations(root.at("animations"));
-    if (root.find("scene") != root.end())
-        m_scene = &m_scenes[root.at("scene")];
+    // Parse all state.  Missing required properties and out of range indices throw.
+
+    bool succeeded = true;
+    try
+    {
+        if (root.find("buffers") != root.end())
+            succeeded = ProcessBuffers(root.at("buffers"), glbBin);
+        if (succeeded && root.find("bufferViews") != root.end())
+            ProcessBufferViews(root.at("bufferViews"));
+        if (succeeded && root.find("accessors") != root.end())
+            succeeded = ProcessAccessors(root.at("accessors"));
+        if (succeeded && root.find("images") != root.end())
+            ProcessImages(root.at("images"));
+        if (succeeded && root.find("samplers") != root.end())
+            ProcessSamplers(root.at("samplers"));
+        if (succeeded && root.find("textures") != root.end())
+            ProcessTextures(root.at("textures"));
+        if (succeeded && root.find("materials") != root.end())
+            ProcessMaterials(root.at("materials"));
+        if (succeeded && root.find("meshes") != root.end())
+            succeeded = ProcessMeshes(root.at("meshes"), root.at("accessors"));
+        if (succeeded && root.find("cameras") != root.end())
+            ProcessCameras(root.at("cameras"));
+        if (succeeded && root.find("skins") != root.end())
+            m_skins.resize(root.at("skins").size());
+        if (succeeded && root.find("nodes") != root.end())
+            succeeded = ProcessNodes(root.at("nodes"));
+        if (succeeded && root.find("skins") != root.end())
+            succeeded = ProcessSkins(root.at("skins"));
+        if (succeeded && root.find("scenes") != root.end())
+            ProcessScenes(root.at("scenes"));
+        if (succeeded && root.find("animations") != root.end())
+            succeeded = ProcessAnimations(root.at("animations"));
+        if (succeeded && root.find("scene") != root.end())
+            m_scene = &m_scenes.at(root.at("scene"));
+    }
+    catch (exception& e)
+    {
+        LOG_ERRORF("Invalid glTF file %s:  %s.", Utility::WideStringToUTF8(filepath).c_str(), e.what());
+        succeeded = false;
+    }
+
+    if (!succeeded)
+    {
+        m_scene = nullptr;
+        m_scenes.clear();
+    }
+
+    return succeeded;
 }
@@ -14,6 +14,8 @@
 #pragma once
 
 #include "../Core/FileUtility.h"
+#include "glTFDecode.h"
+#include "ModelFile.h"
 
 #ifndef _WIN32
 #define _WIN32
@@ -23,6 +25,7 @@
 #include "json.hpp"
 #pragma warning(pop)
 
+#include <memory>
 #include <string>
 
 namespace glTF
@@ -244,7 +247,8 @@ namespace glTF
         Asset(const std::wstring& filepath) : m_scene(nullptr) { Parse(filepath); }
         ~Asset() { m_meshes.clear(); }
 
-        void Parse(const std::wstring& filepath);
+        // Returns false and leaves m_scene null when the file is missing or malformed
+        bool Parse(const std::wstring& filepath);
 
         Scene* m_scene;
         std::wstring m_basePath;
@@ -258,27 +262,32 @@ namespace glTF
         std::vector<Accessor> m_accessors;
         std::vector<Skin> m_skins;
         std::vector<Material> m_materials;
-        std::vector<ByteArray> m_buffers;
+        std::vector<glTFDecode::BufferRange> m_buffers;  // Into m_mappedFiles or m_ownedData
         std::vector<BufferView> m_bufferViews;
         std::vector<Animation> m_animations;
 
     private:
-        void ProcessBuffers( json& buffers, ByteArray chunk1bin );
+        // Accessors point straight into mapped .glb and .bin files.  Compressed files, data
+        // URIs and expanded sparse accessors are held in m_ownedData instead.
+        std::vector<std::unique_ptr<Renderer::MappedFile>> m_mappedFiles;
+        std::vector<ByteArray> m_ownedData;
+
+        bool ProcessBuffers( json& buffers, const glTFDecode::BufferRange& glbBin );
         void ProcessBufferViews( json& bufferViews );
-        void ProcessAccessors( json& accessors );
+        bool ProcessAccessors( json& accessors );
         void ProcessMaterials( json& materials );
         void ProcessTextures( json& textures );
         void ProcessSamplers( json& samplers );
         void ProcessImages( json& images );
-        void ProcessSkins( json& skins );
-        void ProcessMeshes( json& meshes, json& accessors );
-        void ProcessNodes( json& nodes );
-        void ProcessAnimations( json& nodes );
+        bool ProcessSkins( json& skins );
+        bool ProcessMeshes( json& meshes, json& accessors );
+        bool ProcessNodes( json& nodes );
+        bool ProcessAnimations( json& nodes );
         void ProcessCameras( json& cameras );
         void ProcessScenes( json& scenes );
         void FindAttribute( Primitive& prim, json& attributes, Primitive::eAttribType type, const std::string& name);
         uint32_t ReadTextureInfo( json& info_json, glTF::Texture* &info );
-        void DecodeURI( std::string& uri );
+        bool MapFile( const std::wstring& filepath, glTFDecode::BufferRange& range );
     };
 
 
@@ -0,0 +1,493 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+// This file has no engine dependencies so that it can also be built into the standalone
+// glTF decoding check (see Tools/GLTFDecodeCheck).
+
+#include "glTFDecode.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+    const uint32_t kGLBMagic = 0x46546C67;      // "glTF"
+    const uint32_t kChunkJSON = 0x4E4F534A;     // "JSON"
+    const uint32_t kChunkBIN = 0x004E4942;      // "BIN\0"
+    const uint32_t kGLBHeaderSize = 12;
+    const uint32_t kChunkHeaderSize = 8;
+
+    // glTF limits vertex attribute strides to 252 bytes
+    const uint32_t kMaxByteStride = 252;
+
+    // The scan is bound by memory bandwidth at about a third of a nanosecond per index, so a
+    // thread needs milliseconds of work before it pays for its start and for sharing the bus.
+    // Only meshes of several million indices are split.
+    const uint32_t kMinIndicesPerThread = 1u << 21;
+
+    uint32_t ReadU32(const uint8_t* p)
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    int HexValue(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    int Base64Value(char c)
+    {
+        if (c >= 'A' && c <= 'Z')
+            return c - 'A';
+        if (c >= 'a' && c <= 'z')
+            return c - 'a' + 26;
+        if (c >= '0' && c <= '9')
+            return c - '0' + 52;
+        if (c == '+' || c == '-')
+            return 62;
+        if (c == '/' || c == '_')
+            return 63;
+        return -1;
+    }
+
+    uint32_t ReadIndex(const uint8_t* p, uint32_t componentSize)
+    {
+        switch (componentSize)
+        {
+        case 1: return *p;
+        case 2: { uint16_t v; memcpy(&v, p, 2); return v; }
+        default: return ReadU32(p);
+        }
+    }
+
+    // Range [offset, offset + size) of a buffer view, checked against the view and its buffer
+    glTFDecode::Status CheckRange(const vector<glTFDecode::BufferRange>& buffers,
+        const vector<glTFDecode::BufferViewDesc>& views, uint32_t view, uint64_t offset, uint64_t size,
+        uint8_t*& data)
+    {
+        if (view >= views.size() || views[view].Buffer >= buffers.size())
+            return glTFDecode::kBadIndex;
+
+        const glTFDecode::BufferViewDesc& desc = views[view];
+        const glTFDecode::BufferRange& buffer = buffers[desc.Buffer];
+
+        // Written to avoid overflow: every term is already known to fit
+        if (desc.ByteOffset > buffer.Size || desc.ByteLength > buffer.Size - desc.ByteOffset ||
+            offset > desc.ByteLength || size > desc.ByteLength - offset)
+            return glTFDecode::kTruncated;
+
+        data = buffer.Data + desc.ByteOffset + offset;
+        return glTFDecode::kOK;
+    }
+
+    void FindMaxIndexRange(const uint8_t* data, size_t stride, uint32_t componentSize,
+        uint32_t start, uint32_t end, uint32_t& maxIndex)
+    {
+        uint32_t result = 0;
+        const uint8_t* p = data + start * stride;
+        switch (componentSize)
+        {
+        case 1:
+            for (uint32_t i = start; i < end; ++i, p += stride)
+                result = max<uint32_t>(result, *p);
+            break;
+        case 2:
+            for (uint32_t i = start; i < end; ++i, p += stride)
+                result = max(result, ReadIndex(p, 2));
+            break;
+        default:
+            for (uint32_t i = start; i < end; ++i, p += stride)
+                result = max(result, ReadU32(p));
+            break;
+        }
+        maxIndex = result;
+    }
+}
+
+namespace glTFDecode
+{
+    const char* GetStatusString(Status status)
+    {
+        switch (status)
+        {
+        case kOK: return "OK";
+        case kTruncated: return "data out of range";
+        case kNotGLB: return "not a binary glTF file";
+        case kWrongVersion: return "unsupported glTF version";
+        case kMissingJSON: return "missing JSON chunk";
+        case kBadComponentType: return "invalid component type";
+        case kBadType: return "invalid accessor type";
+        case kBadIndex: return "missing buffer or buffer view";
+        case kBadStride: return "invalid byte stride";
+        case kBadSparseIndices: return "invalid sparse indices";
+        case kBadURI: return "invalid URI";
+        case kBadCount: return "accessor count does not match its use";
+        default: return "unknown error";
+        }
+    }
+
+    Status ParseGLB(uint8_t* data, size_t size, GLBChunks& chunks)
+    {
+        chunks = GLBChunks{};
+
+        if (size < kGLBHeaderSize)
+            return kTruncated;
+        if (ReadU32(data) != kGLBMagic)
+            return kNotGLB;
+        if (ReadU32(data + 4) != 2)
+            return kWrongVersion;
+
+        // The declared length may be shorter than the file (padding), never longer
+        uint32_t length = ReadU32(data + 8);
+        if (length > size || length < kGLBHeaderSize)
+            return kTruncated;
+
+        size_t offset = kGLBHeaderSize;
+        bool first = true;
+        while (length - offset >= kChunkHeaderSize)
+        {
+            uint32_t chunkLength = ReadU32(data + offset);
+            uint32_t chunkType = ReadU32(data + offset + 4);
+            offset += kChunkHeaderSize;
+            if (chunkLength > length - offset)
+                return kTruncated;
+
+            if (first)
+            {
+                if (chunkType != kChunkJSON)
+                    return kMissingJSON;
+                chunks.Json = (const char*)data + offset;
+                chunks.JsonSize = chunkLength;
+                first = false;
+            }
+            else if (chunkType == kChunkBIN && chunks.Bin == nullptr)
+            {
+                chunks.Bin = data + offset;
+                chunks.BinSize = chunkLength;
+            }
+            // Unknown chunks are skipped as the specification requires
+
+            offset += chunkLength;
+        }
+
+        return first ? kMissingJSON : kOK;
+    }
+
+    bool DecodeURI(const string& uri, string& decoded)
+    {
+        decoded.clear();
+        decoded.reserve(uri.size());
+        for (size_t i = 0; i < uri.size(); ++i)
+        {
+            if (uri[i] != '%')
+            {
+                decoded.push_back(uri[i]);
+                continue;
+            }
+
+            if (i + 2 >= uri.size())
+                return false;
+            int hi = HexValue(uri[i + 1]);
+            int lo = HexValue(uri[i + 2]);
+            if (hi < 0 || lo < 0 || (hi == 0 && lo == 0))
+                return false;
+            decoded.push_back((char)(hi << 4 | lo));
+            i += 2;
+        }
+        return true;
+    }
+
+    bool IsDataURI(const string& uri)
+    {
+        return uri.compare(0, 5, "data:") == 0;
+    }
+
+    bool DecodeDataURI(const string& uri, vector<uint8_t>& data, string* mediaType)
+    {
+        if (!IsDataURI(uri))
+            return false;
+
+        size_t comma = uri.find(',');
+        if (comma == string::npos)
+            return false;
+
+        // Only base64 is used for buffers and images; percent-encoded text is not supported
+        static const char kBase64[] = ";base64";
+        const size_t kBase64Length = sizeof(kBase64) - 1;
+        if (comma < 5 + kBase64Length || uri.compare(comma - kBase64Length, kBase64Length, kBase64) != 0)
+            return false;
+
+        if (mediaType != nullptr)
+            *mediaType = uri.substr(5, comma - kBase64Length - 5);
+
+        return DecodeBase64(uri.data() + comma + 1, uri.size() - comma - 1, data);
+    }
+
+    bool DecodeBase64(const char* text, size_t length, vector<uint8_t>& data)
+    {
+        data.clear();
+        data.reserve(length / 4 * 3 + 3);
+
+        uint32_t bits = 0;
+        uint32_t numBits = 0;
+        size_t padding = 0;
+        for (size_t i = 0; i < length; ++i)
+        {
+            char c = text[i];
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+                continue;
+            if (c == '=')
+            {
+                ++padding;
+                continue;
+            }
+
+            int value = Base64Value(c);
+            if (value < 0 || padding > 0)
+                return false;
+
+            bits = bits << 6 | (uint32_t)value;
+            numBits += 6;
+            if (numBits >= 8)
+            {
+                numBits -= 8;
+                data.push_back((uint8_t)(bits >> numBits));
+                bits &= (1u << numBits) - 1;
+            }
+        }
+
+        // A single leftover character cannot hold a byte, and padding may only complete the
+        // last group of four: "xx==" or "xxx="
+        if (numBits == 6)
+            return false;
+        if (padding > 0 && padding != (numBits == 4 ? 2u : numBits == 2 ? 1u : 0u))
+            return false;
+
+        return true;
+    }
+
+    uint32_t GetComponentSize(uint32_t componentType)
+    {
+        switch (componentType)
+        {
+        case 0: case 1: return 1;   // BYTE, UNSIGNED_BYTE
+        case 2: case 3: return 2;   // SHORT, UNSIGNED_SHORT
+        case 5: case 6: return 4;   // UNSIGNED_INT, FLOAT
+        default: return 0;
+        }
+    }
+
+    uint32_t GetComponentCount(uint32_t type)
+    {
+        static const uint32_t kCounts[] = { 1, 2, 3, 4, 4, 9, 16 };
+        return type < sizeof(kCounts) / sizeof(kCounts[0]) ? kCounts[type] : 0;
+    }
+
+    uint32_t GetElementSize(uint32_t componentType, uint32_t type)
+    {
+        uint32_t componentSize = GetComponentSize(componentType);
+        uint32_t componentCount = GetComponentCount(type);
+        if (componentSize == 0 || componentCount == 0)
+            return 0;
+
+        // MAT2, MAT3 and MAT4 have 2, 3 and 4 columns, each starting on a 4-byte boundary
+        if (type >= 4)
+        {
+            uint32_t columns = type - 2;
+            uint32_t columnSize = (columns * componentSize + 3) & ~3u;
+            return columns * columnSize;
+        }
+
+        return componentSize * componentCount;
+    }
+
+    Status ResolveAccessor(const vector<BufferRange>& buffers, const vector<BufferViewDesc>& views,
+        const AccessorDesc& desc, vector<uint8_t>& storage, ResolvedAccessor& result)
+    {
+        result = ResolvedAccessor{};
+
+        if (GetComponentSize(desc.ComponentType) == 0)
+            return kBadComponentType;
+        if (GetComponentCount(desc.Type) == 0)
+            return kBadType;
+
+        const uint32_t elementSize = GetElementSize(desc.ComponentType, desc.Type);
+        const uint64_t count = desc.Count;
+
+        uint8_t* base = nullptr;
+        uint32_t stride = 0;
+        if (desc.BufferView >= 0)
+        {
+            if ((size_t)desc.BufferView >= views.size())
+                return kBadIndex;
+
+            stride = views[desc.BufferView].ByteStride;
+            if (stride != 0 && (stride < elementSize || stride > kMaxByteStride || stride % 4 != 0))
+                return kBadStride;
+
+            // The last element only needs its own size, not a whole stride
+            uint64_t size = count == 0 ? 0 : (count - 1) * (stride != 0 ? stride : elementSize) + elementSize;
+            Status status = CheckRange(buffers, views, desc.BufferView, desc.ByteOffset, size, base);
+            if (status != kOK)
+                return status;
+        }
+
+        const SparseDesc& sparse = desc.Sparse;
+        if (base != nullptr && sparse.Count == 0)
+        {
+            result.Data = base;
+            result.Stride = stride;
+            return kOK;
+        }
+
+        // Everything else is expanded into tightly packed storage
+        if (sparse.Count > count)
+            return kBadSparseIndices;
+
+        const uint32_t indexSize = GetComponentSize(sparse.IndicesComponentType);
+        const uint8_t* indices = nullptr;
+        const uint8_t* values = nullptr;
+        if (sparse.Count > 0)
+        {
+            if (sparse.IndicesComponentType != 1 && sparse.IndicesComponentType != 3 && sparse.IndicesComponentType != 5)
+                return kBadComponentType;
+
+            uint8_t* data;
+            Status status = CheckRange(buffers, views, sparse.IndicesView, sparse.IndicesOffset, (uint64_t)sparse.Count * indexSize, data);
+            if (status != kOK)
+                return status;
+            indices = data;
+
+            status = CheckRange(buffers, views, sparse.ValuesView, sparse.ValuesOffset, (uint64_t)sparse.Count * elementSize, data);
+            if (status != kOK)
+                return status;
+            values = data;
+
+            // Validated before anything is written so that a bad accessor leaves 'storage' alone
+            uint32_t previous = 0;
+            for (uint32_t i = 0; i < sparse.Count; ++i)
+            {
+                uint32_t index = ReadIndex(indices + i * indexSize, indexSize);
+                if (index >= count || (i > 0 && index <= previous))
+                    return kBadSparseIndices;
+                previous = index;
+            }
+        }
+
+        storage.assign((size_t)(count * elementSize), 0);
+        if (base != nullptr)
+        {
+            if (stride == 0 || stride == elementSize)
+                memcpy(storage.data(), base, storage.size());
+            else
+            {
+                for (uint64_t i = 0; i < count; ++i)
+                    memcpy(storage.data() + i * elementSize, base + i * stride, elementSize);
+            }
+        }
+
+        for (uint32_t i = 0; i < sparse.Count; ++i)
+        {
+            uint32_t index = ReadIndex(indices + i * indexSize, indexSize);
+            memcpy(storage.data() + (size_t)index * elementSize, values + (size_t)i * elementSize, elementSize);
+        }
+
+        result.Data = storage.empty() ? nullptr : storage.data();
+        result.Stride = 0;
+        return kOK;
+    }
+
+    bool FindMaxIndex(const uint8_t* data, uint32_t stride, uint32_t componentType, uint32_t count,
+        uint32_t& maxIndex, uint32_t numThreads)
+    {
+        maxIndex = 0;
+        if (componentType != 1 && componentType != 3 && componentType != 5)
+            return false;
+
+        const uint32_t componentSize = GetComponentSize(componentType);
+        const size_t step = stride != 0 ? stride : componentSize;
+
+        if (numThreads == 0)
+            numThreads = max(thread::hardware_concurrency(), 1u);
+        numThreads = min(numThreads, count / kMinIndicesPerThread);
+
+        if (numThreads <= 1)
+        {
+            FindMaxIndexRange(data, step, componentSize, 0, count, maxIndex);
+            return true;
+        }
+
+        // Each thread scans a contiguous range
+        vector<uint32_t> rangeMax(numThreads);
+        vector<thread> workers;
+        workers.reserve(numThreads - 1);
+
+        auto scanRange = [&](uint32_t t)
+        {
+            uint32_t start = (uint32_t)((uint64_t)count * t / numThreads);
+            uint32_t end = (uint32_t)((uint64_t)count * (t + 1) / numThreads);
+            FindMaxIndexRange(data, step, componentSize, start, end, rangeMax[t]);
+        };
+
+        for (uint32_t t = 1; t < numThreads; ++t)
+            workers.emplace_back(scanRange, t);
+        scanRange(0);
+
+        for (thread& worker : workers)
+            worker.join();
+
+        maxIndex = *max_element(rangeMax.begin(), rangeMax.end());
+        return true;
+    }
+
+    Status CheckInverseBindMatrices(uint32_t componentType, uint32_t type, uint32_t count, uint32_t numJoints)
+    {
+        if (componentType != 6)
+            return kBadComponentType;
+        if (type != 6)
+            return kBadType;
+        return count >= numJoints ? kOK : kBadCount;
+    }
+
+    Status CheckAnimationSampler(uint32_t inputComponentType, uint32_t inputType, uint32_t inputCount,
+        uint32_t outputCount, bool cubicSpline)
+    {
+        if (inputComponentType != 6)
+            return kBadComponentType;
+        if (inputType != 0)
+            return kBadType;
+
+        const uint64_t valuesPerTarget = (uint64_t)inputCount * (cubicSpline ? 3 : 1);
+        if (valuesPerTarget == 0 || outputCount == 0 || outputCount % valuesPerTarget != 0)
+            return kBadCount;
+        return kOK;
+    }
+}
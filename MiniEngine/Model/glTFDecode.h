@@ -0,0 +1,155 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//
+// The binary side of loading glTF 2.0, used by glTF::Asset::Parse.
+//
+// A .glb file is a header followed by a JSON chunk and an optional BIN chunk. ParseGLB()
+// finds the chunks in place, so the file can be memory mapped and its binary data used
+// without a copy. URIs of external files are percent-decoded, and "data:" URIs carry their
+// buffer as base64.
+//
+// ResolveAccessor() bounds checks an accessor against its buffer view and buffer. Accessors
+// normally point straight into a buffer. Sparse accessors, and accessors without a buffer view,
+// are expanded into storage owned by the caller: zeros or a copy of the base data, with the
+// sparse values written over it. FindMaxIndex() reads an index accessor in parallel when it
+// is large, to check that it stays within the vertices. CheckInverseBindMatrices() and
+// CheckAnimationSampler() check that accessors hold as many elements as a skin or an animation
+// reads from them.
+//
+// Component types are the glTF values minus 5120, types are SCALAR, VEC2 to VEC4 and MAT2 to
+// MAT4 in that order, matching glTF::Accessor.
+//
+// This has no engine dependencies so that it can also be built into the standalone check
+// (see Tools/GLTFDecodeCheck).
+//
+namespace glTFDecode
+{
+    enum Status
+    {
+        kOK,
+        kTruncated,             // A header, chunk or range extends past the end of its data
+        kNotGLB,
+        kWrongVersion,
+        kMissingJSON,           // The first chunk must be JSON
+        kBadComponentType,
+        kBadType,
+        kBadIndex,              // A buffer or buffer view that does not exist
+        kBadStride,
+        kBadSparseIndices,      // Out of range or not increasing
+        kBadURI,
+        kBadCount,              // Fewer elements than a skin or animation reads
+    };
+
+    const char* GetStatusString(Status status);
+
+    struct GLBChunks
+    {
+        const char* Json;
+        size_t JsonSize;
+        uint8_t* Bin;           // Null without a BIN chunk
+        size_t BinSize;
+    };
+
+    Status ParseGLB(uint8_t* data, size_t size, GLBChunks& chunks);
+
+    // Decodes %XX escapes.  Returns false for a malformed escape or one that decodes to NUL.
+    bool DecodeURI(const std::string& uri, std::string& decoded);
+
+    bool IsDataURI(const std::string& uri);
+
+    // Decodes "data:[<mediatype>];base64,<data>".  Only base64 data is supported.
+    bool DecodeDataURI(const std::string& uri, std::vector<uint8_t>& data, std::string* mediaType = nullptr);
+
+    // Whitespace is skipped; padding is optional.
+    bool DecodeBase64(const char* text, size_t length, std::vector<uint8_t>& data);
+
+    // Zero for an invalid component type or type
+    uint32_t GetComponentSize(uint32_t componentType);
+    uint32_t GetComponentCount(uint32_t type);
+
+    // Bytes per element, including the padding that aligns each matrix column to four bytes
+    uint32_t GetElementSize(uint32_t componentType, uint32_t type);
+
+    struct BufferRange
+    {
+        uint8_t* Data;
+        uint64_t Size;
+    };
+
+    struct BufferViewDesc
+    {
+        uint32_t Buffer;
+        uint64_t ByteOffset;
+        uint64_t ByteLength;
+        uint32_t ByteStride;    // Zero when tightly packed
+    };
+
+    struct SparseDesc
+    {
+        uint32_t Count = 0;     // Zero when the accessor is not sparse
+        uint32_t IndicesView = 0;
+        uint64_t IndicesOffset = 0;
+        uint32_t IndicesComponentType = 0;
+        uint32_t ValuesView = 0;
+        uint64_t ValuesOffset = 0;
+    };
+
+    struct AccessorDesc
+    {
+        int32_t BufferView = -1;    // Negative for all zeros
+        uint64_t ByteOffset = 0;
+        uint32_t Count = 0;
+        uint32_t ComponentType = 0;
+        uint32_t Type = 0;
+        SparseDesc Sparse;
+    };
+
+    struct ResolvedAccessor
+    {
+        uint8_t* Data;
+        uint32_t Stride;        // Zero when tightly packed
+    };
+
+    // Fills 'storage' only when the data has to be expanded; 'result' then points into it.
+    Status ResolveAccessor(const std::vector<BufferRange>& buffers, const std::vector<BufferViewDesc>& views,
+        const AccessorDesc& desc, std::vector<uint8_t>& storage, ResolvedAccessor& result);
+
+    // Largest value of an index accessor of unsigned bytes, shorts or ints.  'stride' may be
+    // zero when tightly packed.  Returns false for another component type.
+    bool FindMaxIndex(const uint8_t* data, uint32_t stride, uint32_t componentType, uint32_t count,
+        uint32_t& maxIndex, uint32_t numThreads = 0);
+
+    // A skin's inverse bind matrices are float MAT4s, at least one per joint
+    Status CheckInverseBindMatrices(uint32_t componentType, uint32_t type, uint32_t count, uint32_t numJoints);
+
+    // Key frame times are float scalars, at least one.  The output holds a whole number of values
+    // per key frame: one per morph target for weights, times three for the tangents of a cubic spline.
+    Status CheckAnimationSampler(uint32_t inputComponentType, uint32_t inputType, uint32_t inputCount,
+        uint32_t outputCount, bool cubicSpline);
+}
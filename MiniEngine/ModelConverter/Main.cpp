@@ -14,6 +14,8 @@
 #include "ModelAssimp.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <iostream>
 
 void PrintHelp()
@@ -21,7 +23,11 @@ void PrintHelp()
     printf("model_convert\n");
 
     printf("usage:\n");
-    printf("model_convert input_file output_file\n");
+    printf("model_convert [options] input_file output_file\n");
+    printf("options:\n");
+    printf("  -weld_position <epsilon>   merge vertices whose positions are within epsilon\n");
+    printf("  -weld_texcoord <epsilon>   merge vertices whose texcoords are within epsilon\n");
+    printf("  -weld_normal <epsilon>     merge vertices whose normals and tangents are within epsilon\n");
 }
 
 void AssimpModel::PrintModelStats()
@@ -98,20 +104,47 @@ void AssimpModel::PrintModelStats()
 
 int main(int argc, char **argv)
 {
-    if (argc != 3)
+	AssimpModel model;
+
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+    {
+        float epsilon = (float)atof(argv[arg + 1]);
+
+        if (strcmp(argv[arg], "-weld_position") == 0)
+        {
+            model.SetWeldEpsilon(AssimpModel::attrib_position, epsilon);
+        }
+        else if (strcmp(argv[arg], "-weld_texcoord") == 0)
+        {
+            model.SetWeldEpsilon(AssimpModel::attrib_texcoord0, epsilon);
+        }
+        else if (strcmp(argv[arg], "-weld_normal") == 0)
+        {
+            model.SetWeldEpsilon(AssimpModel::attrib_normal, epsilon);
+            model.SetWeldEpsilon(AssimpModel::attrib_tangent, epsilon);
+            model.SetWeldEpsilon(AssimpModel::attrib_bitangent, epsilon);
+        }
+        else
+        {
+            printf("unknown option: %s\n", argv[arg]);
+            PrintHelp();
+            return -1;
+        }
+    }
+
+    if (argc - arg != 2)
     {
         PrintHelp();
         return -1;
     }
 
-    const char *input_file = argv[1];
-    const char *output_file = argv[2];
+    const char *input_file = argv[arg];
+    const char *output_file = argv[arg + 1];
 
     printf("input file %s\n", input_file);
     printf("output file %s\n", output_file);
 
-	AssimpModel model;
-
     printf("loading...\n");
     if (!model.Load(input_file))
     {
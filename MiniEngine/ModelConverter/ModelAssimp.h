@@ -33,6 +33,10 @@ public:
 
     void PrintModelStats();
 
+    // Vertices whose float attribute 'attrib' differs by less than 'epsilon' may be merged.
+    // Zero, the default, only merges exact duplicates.
+    void SetWeldEpsilon(uint32_t attrib, float epsilon);
+
 private:
 
 	bool LoadAssimp(const std::string& filename);
@@ -41,5 +45,7 @@ private:
 	void OptimizeRemoveDuplicateVertices(bool depth);
 	void OptimizePostTransform(bool depth);
 	void OptimizePreTransform(bool depth);
+
+    float m_WeldEpsilon[maxAttribs] = {};
 };
 
@@ -13,7 +13,9 @@
 
 #include "ModelAssimp.h"
 #include "IndexOptimizePostTransform.h"
+#include "../Model/VertexDeduplicate.h"
 
+#include <stdio.h>
 #include <string.h>
 
 void AssimpModel::OptimizeRemoveDuplicateVertices(bool depth)
@@ -21,46 +23,42 @@ void AssimpModel::OptimizeRemoveDuplicateVertices(bool depth)
     unsigned char *deduplicatedVertexData = new unsigned char [depth ? m_Header.vertexDataByteSizeDepth : m_Header.vertexDataByteSize];
     uint32_t deduplicatedVertexDataSize = 0;
 
+    uint32_t totalInput = 0;
+    uint32_t totalOutput = 0;
+    double totalMilliseconds = 0.0;
+
     for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
     {
         Mesh *mesh = m_pMesh + meshIndex;
         unsigned int vertexStride = depth ? mesh->vertexStrideDepth : mesh->vertexStride;
         unsigned char *meshVertexData = depth ? (m_pVertexDataDepth + mesh->vertexDataByteOffsetDepth) : (m_pVertexData + mesh->vertexDataByteOffset);
-
         unsigned char *meshDeduplicatedVertexData = deduplicatedVertexData + deduplicatedVertexDataSize;
-        unsigned int deduplicatedCount = 0;
-
         unsigned int vertexCount = depth ? mesh->vertexCountDepth : mesh->vertexCount;
-        uint32_t *vertexRemap = new uint32_t [vertexCount];
-        memset(vertexRemap, (uint32_t)-1, sizeof(uint32_t) * vertexCount);
-        assert(vertexCount <= (uint32_t)-1);
 
-        for (unsigned int v1 = 0; v1 < vertexCount; v1++)
+        // float attributes with a weld epsilon are merged within that tolerance
+        uint32_t attribsEnabled = depth ? mesh->attribsEnabledDepth : mesh->attribsEnabled;
+        const Attrib *attribs = depth ? mesh->attribDepth : mesh->attrib;
+        VertexDeduplicate::Tolerance tolerances[maxAttribs];
+        uint32_t toleranceCount = 0;
+        for (unsigned int n = 0; n < maxAttribs; n++)
         {
-            if (vertexRemap[v1] != (uint32_t)-1)
-                continue; // this was already found to be a duplicate
-
-            const unsigned char *v1Data = meshVertexData + v1 * vertexStride;
+            if ((attribsEnabled & (1 << n)) == 0 || attribs[n].format != attrib_format_float || m_WeldEpsilon[n] <= 0.0f)
+                continue;
 
-            // this is a new unique vertex
-            uint32_t remappedSlot = deduplicatedCount++;
-            vertexRemap[v1] = remappedSlot;
-            memcpy(meshDeduplicatedVertexData + remappedSlot * vertexStride, v1Data, vertexStride);
-
-            // scan for duplicates
-            for (unsigned int v2 = v1 + 1; v2 < vertexCount; v2++)
-            {
-                if (vertexRemap[v2] != (uint32_t)-1)
-                    continue; // this was already found to be a duplicate of another vertex
+            tolerances[toleranceCount].offset = attribs[n].offset;
+            tolerances[toleranceCount].components = attribs[n].components;
+            tolerances[toleranceCount].epsilon = m_WeldEpsilon[n];
+            toleranceCount++;
+        }
 
-                const unsigned char *v2Data = meshVertexData + v2 * vertexStride;
+        uint32_t *vertexRemap = new uint32_t [vertexCount];
+        VertexDeduplicate::Stats stats;
+        uint32_t deduplicatedCount = VertexDeduplicate::Deduplicate(meshVertexData, vertexCount, vertexStride,
+            tolerances, toleranceCount, meshDeduplicatedVertexData, vertexRemap, &stats);
 
-                if (0 == memcmp(v1Data, v2Data, vertexStride))
-                {
-                    vertexRemap[v2] = remappedSlot;
-                }
-            }
-        }
+        totalInput += stats.inputVertices;
+        totalOutput += stats.outputVertices;
+        totalMilliseconds += stats.milliseconds;
 
         unsigned int indexCount = mesh->indexCount;
         uint16_t *indexArray = (uint16_t*)((depth ? m_pIndexDataDepth : m_pIndexData) + mesh->indexDataByteOffset);
@@ -96,6 +94,15 @@ void AssimpModel::OptimizeRemoveDuplicateVertices(bool depth)
         m_pVertexData = deduplicatedVertexData;
         m_Header.vertexDataByteSize = deduplicatedVertexDataSize;
     }
+
+    printf("removed duplicate vertices%s: %u -> %u (%.1f%% fewer) in %.1f ms\n", depth ? " depth-only" : "",
+        totalInput, totalOutput, totalInput > 0 ? 100.0 * (totalInput - totalOutput) / totalInput : 0.0, totalMilliseconds);
+}
+
+void AssimpModel::SetWeldEpsilon(uint32_t attrib, float epsilon)
+{
+    assert(attrib < maxAttribs);
+    m_WeldEpsilon[attrib] = epsilon;
 }
 
 void AssimpModel::OptimizePostTransform(bool depth)
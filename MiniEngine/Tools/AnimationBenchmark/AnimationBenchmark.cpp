@@ -0,0 +1,446 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+//
+// Checks AnimationSampling against known curves and its one curve at a time reference, then
+// times both on a crowd of skinned characters, e.g.
+//
+//     AnimationBenchmark -characters 256 -joints 64 -frames 100
+//
+// Every joint of a character is keyed on the same frames, as skeletal animation is usually
+// exported, so all the curves of an animation fall into one group.
+//
+
+#include "../../Model/AnimationSampling.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Curves and key frames as they are laid out in a .mini file
+    struct CurveSet
+    {
+        vector<AnimationCurve> Curves;
+        vector<uint8_t> KeyFrameData;
+
+        // 'values' holds every key frame element, with cubic spline tangents around each value
+        template <typename T>
+        void Add(uint32_t path, uint32_t interpolation, uint32_t format, uint32_t numComponents,
+            const vector<T>& values, float startTime, float endTime, uint32_t node = 0, uint32_t firstWeight = 0)
+        {
+            const uint32_t elementsPerKey = interpolation == AnimationCurve::kCubicSpline ? 3 : 1;
+            const uint32_t numKeys = (uint32_t)values.size() / numComponents / elementsPerKey;
+
+            AnimationCurve curve;
+            curve.targetNode = node;
+            curve.targetPath = path;
+            curve.interpolation = interpolation;
+            curve.keyFrameOffset = (uint32_t)KeyFrameData.size();
+            curve.keyFrameFormat = format;
+            curve.keyFrameStride = (uint32_t)(numComponents * sizeof(T) / 4);
+            curve.firstWeight = firstWeight;
+            curve.numSegments = numKeys - 1.0f;
+            curve.startTime = startTime;
+            curve.rangeScale = endTime > startTime ? curve.numSegments / (endTime - startTime) : 0.0f;
+            Curves.push_back(curve);
+
+            const uint8_t* bytes = (const uint8_t*)values.data();
+            KeyFrameData.insert(KeyFrameData.end(), bytes, bytes + values.size() * sizeof(T));
+        }
+    };
+
+    bool Report(const char* name, bool passed)
+    {
+        printf("%s %s\n", passed ? "Passed" : "FAILED", name);
+        return passed;
+    }
+
+    bool Near(float a, float b, float tolerance = 1e-5f)
+    {
+        return fabsf(a - b) <= tolerance * max(1.0f, fabsf(b));
+    }
+
+    // Angle between the rotations of two unit quaternions. Unlike the inverse cosine of their
+    // dot product, this stays accurate for small angles.
+    float RotationError(const float* a, const float* b)
+    {
+        const float sign = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3] < 0.0f ? -1.0f : 1.0f;
+        float diff = 0.0f, sum = 0.0f;
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            diff += (a[i] - sign * b[i]) * (a[i] - sign * b[i]);
+            sum += (a[i] + sign * b[i]) * (a[i] + sign * b[i]);
+        }
+        return 4.0f * atan2f(sqrtf(diff), sqrtf(sum));
+    }
+
+    void RandomQuaternion(mt19937& rng, float* q)
+    {
+        normal_distribution<float> gauss;
+        float lengthSq = 0.0f;
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            q[i] = gauss(rng);
+            lengthSq += q[i] * q[i];
+        }
+        for (uint32_t i = 0; i < 4; ++i)
+            q[i] /= sqrtf(lengthSq);
+    }
+
+    // A quaternion turned by up to 'maxAngle' from 'from', sometimes with the sign flipped
+    void NextQuaternion(mt19937& rng, const float* previous, float maxAngle, float* q)
+    {
+        float from[4], axis[4];
+        memcpy(from, previous, sizeof(from));
+        RandomQuaternion(rng, axis);
+        const float angle = uniform_real_distribution<float>(0.0f, maxAngle)(rng) * 0.5f;
+        const float s = sinf(angle) / sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        const float r[4] = { axis[0] * s, axis[1] * s, axis[2] * s, cosf(angle) };
+
+        q[0] = r[3] * from[0] + r[0] * from[3] + r[1] * from[2] - r[2] * from[1];
+        q[1] = r[3] * from[1] - r[0] * from[2] + r[1] * from[3] + r[2] * from[0];
+        q[2] = r[3] * from[2] + r[0] * from[1] - r[1] * from[0] + r[2] * from[3];
+        q[3] = r[3] * from[3] - r[0] * from[0] - r[1] * from[1] - r[2] * from[2];
+
+        if (rng() % 4 == 0)
+        {
+            for (uint32_t i = 0; i < 4; ++i)
+                q[i] = -q[i];
+        }
+    }
+
+    bool CheckInterpolation()
+    {
+        bool passed = true;
+
+        // Keys every half second from 1s, value x = key time
+        CurveSet set;
+        set.Add(AnimationCurve::kTranslation, AnimationCurve::kLinear, AnimationCurve::kFloat, 3,
+            vector<float>{ 1, 0, 0, 1.5f, 1, 0, 2, 2, 0, 2.5f, 3, 0 }, 1.0f, 2.5f);
+        set.Add(AnimationCurve::kScale, AnimationCurve::kStep, AnimationCurve::kFloat, 3,
+            vector<float>{ 1, 1, 1, 2, 2, 2, 3, 3, 3 }, 1.0f, 2.0f);
+
+        // f(t) = t^3 - 2t with exact derivatives as tangents, which a Hermite spline reproduces
+        vector<float> cubic;
+        for (uint32_t k = 0; k < 5; ++k)
+        {
+            const float t = 1.0f + 0.5f * k;
+            const float f = t * t * t - 2.0f * t, df = 3.0f * t * t - 2.0f;
+            const float element[9] = { df, 0, 0, f, 0, 0, df, 0, 0 };
+            cubic.insert(cubic.end(), element, element + 9);
+        }
+        set.Add(AnimationCurve::kTranslation, AnimationCurve::kCubicSpline, AnimationCurve::kFloat, 3, cubic, 1.0f, 3.0f);
+
+        // A single key frame
+        set.Add(AnimationCurve::kTranslation, AnimationCurve::kLinear, AnimationCurve::kFloat, 3,
+            vector<float>{ 7, 8, 9 }, 0.5f, 0.5f);
+
+        AnimationSampling::Plan plan;
+        AnimationSampling::BuildPlan(set.Curves.data(), (uint32_t)set.Curves.size(), plan);
+        vector<float> output(plan.OutputSize);
+
+        auto sample = [&](float time, uint32_t curve)
+        {
+            AnimationSampling::Sample(plan, set.Curves.data(), set.KeyFrameData.data(), time, output.data());
+            return output.data() + plan.Outputs[curve];
+        };
+
+        const float* v = sample(1.5f, 0);
+        passed &= v[0] == 1.5f && v[1] == 1.0f;
+        v = sample(1.75f, 0);
+        passed &= Near(v[0], 1.75f) && Near(v[1], 1.5f);
+        v = sample(0.0f, 0);
+        passed &= v[0] == 1.0f && v[1] == 0.0f;
+        v = sample(9.0f, 0);
+        passed &= v[0] == 2.5f && v[1] == 3.0f;
+        passed &= Report("linear key frames and clamping", passed);
+
+        bool step = sample(1.49f, 1)[0] == 1.0f && sample(1.5f, 1)[0] == 2.0f && sample(1.99f, 1)[0] == 2.0f;
+        step &= sample(2.0f, 1)[0] == 3.0f && sample(5.0f, 1)[0] == 3.0f;
+        passed &= Report("step key frames", step);
+
+        bool spline = true;
+        for (float t = 1.0f; t <= 3.0f; t += 0.0625f)
+        {
+            const float f = t * t * t - 2.0f * t;
+            spline &= Near(sample(t, 2)[0], f, 1e-4f);
+        }
+        passed &= Report("cubic spline reproduces a cubic", spline);
+
+        v = sample(3.0f, 3);
+        bool single = v[0] == 7.0f && v[1] == 8.0f && v[2] == 9.0f;
+        v = sample(0.0f, 3);
+        single &= v[0] == 7.0f && v[1] == 8.0f && v[2] == 9.0f;
+        passed &= Report("single key frame", single);
+
+        return passed;
+    }
+
+    bool CheckWeights()
+    {
+        // Five targets, linear and cubic, the second curve's weights after the first's
+        const vector<float> linear = { 0, 0.2f, 0.4f, 0.6f, 0.8f,  1, 0.8f, 0.6f, 0.4f, 0.2f };
+        vector<float> cubic;
+        for (uint32_t k = 0; k < 2; ++k)
+        {
+            for (uint32_t e = 0; e < 3; ++e)
+            {
+                for (uint32_t i = 0; i < 5; ++i)
+                    cubic.push_back(e == 1 ? (float)(k + i) : 0.0f);
+            }
+        }
+
+        CurveSet set;
+        set.Add(AnimationCurve::kWeights, AnimationCurve::kLinear, AnimationCurve::kFloat, 5, linear, 0.0f, 1.0f, 3, 0);
+        set.Add(AnimationCurve::kWeights, AnimationCurve::kCubicSpline, AnimationCurve::kFloat, 5, cubic, 0.0f, 2.0f, 4, 5);
+
+        AnimationSampling::Plan plan;
+        AnimationSampling::BuildPlan(set.Curves.data(), 2, plan);
+        vector<float> output(plan.OutputSize);
+        AnimationSampling::Sample(plan, set.Curves.data(), set.KeyFrameData.data(), 0.25f, output.data());
+
+        bool passed = plan.OutputSize == 16 && plan.Outputs[1] == 8;
+        const float* a = output.data() + plan.Outputs[0];
+        const float* b = output.data() + plan.Outputs[1];
+        for (uint32_t i = 0; i < 5; ++i)
+        {
+            // Zero tangents make the cubic a smoothstep between the keys
+            const float s = 0.125f * 0.125f * (3.0f - 2.0f * 0.125f);
+            passed &= Near(a[i], linear[i] + 0.25f * (linear[5 + i] - linear[i]));
+            passed &= Near(b[i], i + s);
+        }
+        return Report("morph target weights", passed);
+    }
+
+    // Random curves in several groups, compared with one curve at a time sampling
+    bool CheckAgainstReference(uint32_t seed)
+    {
+        mt19937 rng(seed);
+        CurveSet set;
+
+        const uint32_t interpolations[] = { AnimationCurve::kLinear, AnimationCurve::kStep, AnimationCurve::kCubicSpline };
+        for (uint32_t group = 0; group < 6; ++group)
+        {
+            const uint32_t interpolation = interpolations[group % 3];
+            const uint32_t elementsPerKey = interpolation == AnimationCurve::kCubicSpline ? 3 : 1;
+            const uint32_t numKeys = 2 + rng() % 20;
+            const float startTime = (float)(rng() % 4) * 0.25f;
+            const float endTime = startTime + 0.1f + (float)(rng() % 100) * 0.05f;
+            const uint32_t numJoints = 1 + rng() % 23;
+
+            for (uint32_t joint = 0; joint < numJoints; ++joint)
+            {
+                vector<float> vec3(numKeys * elementsPerKey * 3);
+                for (float& x : vec3)
+                    x = uniform_real_distribution<float>(-10.0f, 10.0f)(rng);
+                set.Add(rng() % 2 ? AnimationCurve::kTranslation : AnimationCurve::kScale, interpolation,
+                    AnimationCurve::kFloat, 3, vec3, startTime, endTime, joint);
+
+                // Rotations, with large and small steps between keys and quantized variants
+                vector<float> rotations(numKeys * elementsPerKey * 4);
+                float q[4];
+                RandomQuaternion(rng, q);
+                const float maxAngle = rng() % 2 ? 3.1f : 0.3f;
+                for (uint32_t k = 0; k < numKeys * elementsPerKey; ++k)
+                {
+                    NextQuaternion(rng, q, maxAngle, q);
+                    memcpy(&rotations[k * 4], q, sizeof(q));
+                }
+
+                switch (rng() % 3)
+                {
+                case 0:
+                    set.Add(AnimationCurve::kRotation, interpolation, AnimationCurve::kFloat, 4, rotations, startTime, endTime, joint);
+                    break;
+                case 1:
+                {
+                    vector<int16_t> snorm16(rotations.size());
+                    for (size_t i = 0; i < rotations.size(); ++i)
+                        snorm16[i] = (int16_t)lrintf(rotations[i] * 32767.0f);
+                    set.Add(AnimationCurve::kRotation, interpolation, AnimationCurve::kSNorm16, 4, snorm16, startTime, endTime, joint);
+                    break;
+                }
+                default:
+                {
+                    vector<int8_t> snorm8(rotations.size());
+                    for (size_t i = 0; i < rotations.size(); ++i)
+                        snorm8[i] = (int8_t)lrintf(rotations[i] * 127.0f);
+                    set.Add(AnimationCurve::kRotation, interpolation, AnimationCurve::kSNorm8, 4, snorm8, startTime, endTime, joint);
+                    break;
+                }
+                }
+            }
+
+            const uint32_t numTargets = 1 + rng() % 9;
+            vector<float> weights(numKeys * elementsPerKey * numTargets);
+            for (float& w : weights)
+                w = uniform_real_distribution<float>(0.0f, 1.0f)(rng);
+            set.Add(AnimationCurve::kWeights, interpolation, AnimationCurve::kFloat, numTargets, weights, startTime, endTime);
+        }
+
+        shuffle(set.Curves.begin(), set.Curves.end(), rng);
+
+        const uint32_t numCurves = (uint32_t)set.Curves.size();
+        AnimationSampling::Plan plan;
+        AnimationSampling::BuildPlan(set.Curves.data(), numCurves, plan);
+        vector<float> output(plan.OutputSize), reference(16 * 4);
+
+        bool passed = plan.Groups.size() == 6;
+        float maxError = 0.0f, maxRotationError = 0.0f;
+
+        for (uint32_t i = 0; i < 2000 && passed; ++i)
+        {
+            const float time = uniform_real_distribution<float>(-1.0f, 7.0f)(rng);
+            AnimationSampling::Sample(plan, set.Curves.data(), set.KeyFrameData.data(), time, output.data());
+
+            for (uint32_t c = 0; c < numCurves; ++c)
+            {
+                const AnimationCurve& curve = set.Curves[c];
+                const float* value = output.data() + plan.Outputs[c];
+                AnimationSampling::SampleCurve(curve, set.KeyFrameData.data(), time, reference.data());
+
+                if (curve.targetPath == AnimationCurve::kRotation)
+                {
+                    const float error = RotationError(value, reference.data());
+                    const float lengthSq = value[0] * value[0] + value[1] * value[1] + value[2] * value[2] + value[3] * value[3];
+                    maxRotationError = max(maxRotationError, error);
+                    passed &= Near(lengthSq, 1.0f, 1e-5f);
+                }
+                else
+                {
+                    for (uint32_t k = 0; k < AnimationSampling::GetNumComponents(curve); ++k)
+                    {
+                        maxError = max(maxError, fabsf(value[k] - reference[k]) / max(1.0f, fabsf(reference[k])));
+                        passed &= Near(value[k], reference[k], 1e-5f);
+                    }
+                }
+            }
+        }
+
+        printf("  %u curves in %zu groups, largest error %g, largest rotation error %g radians\n",
+            numCurves, plan.Groups.size(), maxError, maxRotationError);
+        return Report("batched sampling matches one curve at a time", passed && maxRotationError < 1e-3f);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numCharacters = 256;
+    uint32_t numJoints = 64;
+    uint32_t numFrames = 100;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (arg + 1 < argc && strcmp("-characters", argv[arg]) == 0)
+            numCharacters = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-joints", argv[arg]) == 0)
+            numJoints = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-frames", argv[arg]) == 0)
+            numFrames = max(atoi(argv[++arg]), 1);
+        else
+        {
+            printf(
+                "Usage:  %s [options]*\n\n"
+                "Options:\n\n"
+                "-characters <integer>\n\tAnimated characters sampled per frame.\n\tDefaults to 256.\n"
+                "-joints <integer>\n\tJoints per character, each with a translation, rotation and scale curve.\n\tDefaults to 64.\n"
+                "-frames <integer>\n\tFrames timed.\n\tDefaults to 100.\n\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    bool passed = CheckInterpolation();
+    passed &= CheckWeights();
+    passed &= CheckAgainstReference(1);
+    passed &= CheckAgainstReference(2);
+
+    // One 30 fps clip of two seconds shared by every character, each at its own time
+    mt19937 rng(3);
+    CurveSet set;
+    const uint32_t numKeys = 61;
+    for (uint32_t joint = 0; joint < numJoints; ++joint)
+    {
+        vector<float> translations(numKeys * 3), scales(numKeys * 3, 1.0f), rotations(numKeys * 4);
+        for (float& x : translations)
+            x = uniform_real_distribution<float>(-1.0f, 1.0f)(rng);
+
+        float q[4];
+        RandomQuaternion(rng, q);
+        for (uint32_t k = 0; k < numKeys; ++k)
+        {
+            NextQuaternion(rng, q, 0.2f, q);
+            memcpy(&rotations[k * 4], q, sizeof(q));
+        }
+
+        set.Add(AnimationCurve::kTranslation, AnimationCurve::kLinear, AnimationCurve::kFloat, 3, translations, 0.0f, 2.0f, joint);
+        set.Add(AnimationCurve::kRotation, AnimationCurve::kLinear, AnimationCurve::kFloat, 4, rotations, 0.0f, 2.0f, joint);
+        set.Add(AnimationCurve::kScale, AnimationCurve::kLinear, AnimationCurve::kFloat, 3, scales, 0.0f, 2.0f, joint);
+    }
+
+    const uint32_t numCurves = (uint32_t)set.Curves.size();
+    AnimationSampling::Plan plan;
+    AnimationSampling::BuildPlan(set.Curves.data(), numCurves, plan);
+    vector<float> output(plan.OutputSize);
+    vector<float> times(numCharacters);
+    for (float& t : times)
+        t = uniform_real_distribution<float>(0.0f, 2.0f)(rng);
+
+    double checksum[2] = {};
+    double ms[2] = {};
+    for (uint32_t method = 0; method < 2; ++method)
+    {
+        auto start = chrono::high_resolution_clock::now();
+        for (uint32_t frame = 0; frame < numFrames; ++frame)
+        {
+            for (uint32_t c = 0; c < numCharacters; ++c)
+            {
+                const float time = fmodf(times[c] + frame / 60.0f, 2.0f);
+                if (method == 0)
+                {
+                    for (uint32_t i = 0; i < numCurves; ++i)
+                        AnimationSampling::SampleCurve(set.Curves[i], set.KeyFrameData.data(), time, output.data() + plan.Outputs[i]);
+                }
+                else
+                    AnimationSampling::Sample(plan, set.Curves.data(), set.KeyFrameData.data(), time, output.data());
+                checksum[method] += output[plan.Outputs[1]];
+            }
+        }
+        ms[method] = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    }
+
+    const double numSampled = (double)numCurves * numCharacters * numFrames;
+    printf("\n%u characters, %u curves each, %u frames:\n", numCharacters, numCurves, numFrames);
+    printf("%-20s %10.3f ms (%.1f M curves/s)\n", "One curve at a time", ms[0], numSampled / ms[0] * 1e-3);
+    printf("%-20s %10.3f ms (%.1f M curves/s)\n", "Batched", ms[1], numSampled / ms[1] * 1e-3);
+    passed &= Report("benchmark results agree", fabs(checksum[0] - checksum[1]) < 1e-2 * numCharacters * numFrames);
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,457 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+//
+// Stress tests BuddyTree and compares its throughput with the std::set free lists that
+// BuddyAllocator used before, e.g.
+//
+//     BuddyBenchmark -order 12 -operations 2000000 -threads 8
+//
+// Offsets and sizes are in units of the minimum block size, 64 KB for placed buffers.
+//
+
+#include "../../Core/BuddyTree.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // The free lists BuddyAllocator kept before, one ordered set of offsets per order
+    class ReferenceBuddy
+    {
+    public:
+        explicit ReferenceBuddy(uint32_t maxOrder) : m_MaxOrder(maxOrder), m_FreeBlocks(maxOrder + 1)
+        {
+            m_FreeBlocks[maxOrder].insert((size_t)0);
+        }
+
+        uint32_t Allocate(uint32_t order)
+        {
+            try
+            {
+                return (uint32_t)AllocateBlock(order);
+            }
+            catch (bad_alloc&)
+            {
+                return BuddyTree::kInvalidOffset;
+            }
+        }
+
+        void Free(uint32_t offset, uint32_t order) { DeallocateBlock(offset, order); }
+
+    private:
+        size_t AllocateBlock(uint32_t order)
+        {
+            if (order > m_MaxOrder)
+                throw bad_alloc();
+
+            auto it = m_FreeBlocks[order].begin();
+            if (it == m_FreeBlocks[order].end())
+            {
+                size_t left = AllocateBlock(order + 1);
+                m_FreeBlocks[order].insert(left + ((size_t)1 << order));
+                return left;
+            }
+
+            size_t offset = *it;
+            m_FreeBlocks[order].erase(it);
+            return offset;
+        }
+
+        void DeallocateBlock(size_t offset, uint32_t order)
+        {
+            size_t buddy = offset ^ ((size_t)1 << order);
+            auto it = m_FreeBlocks[order].find(buddy);
+            if (it != m_FreeBlocks[order].end())
+            {
+                DeallocateBlock(min(offset, buddy), order + 1);
+                m_FreeBlocks[order].erase(it);
+            }
+            else
+                m_FreeBlocks[order].insert(offset);
+        }
+
+        uint32_t m_MaxOrder;
+        vector<set<size_t>> m_FreeBlocks;
+    };
+
+    struct Block
+    {
+        uint32_t Offset;
+        uint32_t Order;
+    };
+
+    // Mostly small buffers, occasionally a large one
+    uint32_t RandomOrder(mt19937& rng, uint32_t maxOrder)
+    {
+        const uint32_t r = rng() % 64;
+        const uint32_t order = r < 32 ? 0 : r < 48 ? 1 : r < 56 ? 2 : r < 60 ? 3 : 4 + rng() % 4;
+        return min(order, maxOrder);
+    }
+
+    bool Report(const char* name, bool passed)
+    {
+        printf("%s %s\n", passed ? "Passed" : "FAILED", name);
+        return passed;
+    }
+
+    // Largest aligned power-of-two run of free units, which a buddy tree always keeps merged
+    uint32_t LargestFreeBlock(const vector<uint8_t>& used)
+    {
+        for (uint32_t size = (uint32_t)used.size(); size > 0; size /= 2)
+        {
+            for (uint32_t offset = 0; offset < used.size(); offset += size)
+            {
+                if (find(used.begin() + offset, used.begin() + offset + size, 1) == used.begin() + offset + size)
+                    return size;
+            }
+        }
+        return 0;
+    }
+
+    bool Fuzz(uint32_t maxOrder, uint32_t numCachedOrders, uint32_t numOperations, uint32_t seed, const char* name)
+    {
+        mt19937 rng(seed);
+        BuddyTree tree(maxOrder, numCachedOrders);
+        vector<uint8_t> used(1u << maxOrder, 0);
+        vector<Block> live;
+        uint32_t failed = 0;
+
+        for (uint32_t op = 0; op < numOperations; ++op)
+        {
+            if (live.empty() || rng() % 2 == 0)
+            {
+                const uint32_t order = RandomOrder(rng, maxOrder);
+                const uint32_t offset = tree.Allocate(order);
+                if (offset == BuddyTree::kInvalidOffset)
+                {
+                    ++failed;
+                    continue;
+                }
+
+                if ((offset & ((1u << order) - 1)) != 0)
+                {
+                    printf("FAILED %s: misaligned block at operation %u\n", name, op);
+                    return false;
+                }
+                for (uint32_t i = offset; i < offset + (1u << order); ++i)
+                {
+                    if (i >= used.size() || used[i])
+                    {
+                        printf("FAILED %s: unit %u handed out twice at operation %u\n", name, i, op);
+                        return false;
+                    }
+                    used[i] = 1;
+                }
+                live.push_back({ offset, order });
+            }
+            else
+            {
+                const size_t index = rng() % live.size();
+                const Block block = live[index];
+                live[index] = live.back();
+                live.pop_back();
+
+                tree.Free(block.Offset, block.Order);
+                fill(used.begin() + block.Offset, used.begin() + block.Offset + (1u << block.Order), (uint8_t)0);
+            }
+
+            if ((op & 255) == 0)
+            {
+                BuddyTree::Stats stats = tree.GetStats();
+                const uint32_t freeUnits = (uint32_t)count(used.begin(), used.end(), 0);
+                bool consistent = stats.FreeUnits == freeUnits && stats.NumAllocations == live.size();
+
+                // Without a cache every free block is merged, so the largest must match the model
+                if (numCachedOrders == 0)
+                    consistent &= stats.LargestFreeBlock == LargestFreeBlock(used) && stats.CachedUnits == 0;
+
+                if (!consistent)
+                {
+                    printf("FAILED %s: statistics differ from the model at operation %u\n", name, op);
+                    return false;
+                }
+            }
+        }
+
+        for (const Block& block : live)
+            tree.Free(block.Offset, block.Order);
+        tree.FlushCache();
+
+        BuddyTree::Stats stats = tree.GetStats();
+        printf("  %u operations, %u failed allocations\n", numOperations, failed);
+        return Report(name, stats.FreeUnits == stats.TotalUnits && stats.LargestFreeBlock == stats.TotalUnits &&
+            stats.NumAllocations == 0 && stats.GetFragmentation() == 0.0f);
+    }
+
+    bool CheckBasics()
+    {
+        bool passed = true;
+
+        // Every unit can be allocated, then the tree is full
+        BuddyTree tree(6, 0);
+        vector<uint32_t> offsets;
+        for (uint32_t i = 0; i < 64; ++i)
+            offsets.push_back(tree.Allocate(0));
+        sort(offsets.begin(), offsets.end());
+        for (uint32_t i = 0; i < 64; ++i)
+            passed &= offsets[i] == i;
+        passed &= tree.Allocate(0) == BuddyTree::kInvalidOffset && tree.Allocate(7) == BuddyTree::kInvalidOffset;
+
+        // Freeing every other unit leaves nothing larger than one unit
+        for (uint32_t i = 0; i < 64; i += 2)
+            tree.Free(i, 0);
+        BuddyTree::Stats stats = tree.GetStats();
+        passed &= stats.FreeUnits == 32 && stats.LargestFreeBlock == 1 && tree.Allocate(1) == BuddyTree::kInvalidOffset;
+        passed &= stats.GetFragmentation() > 0.96f;
+
+        // Freeing the rest merges everything back
+        for (uint32_t i = 1; i < 64; i += 2)
+            tree.Free(i, 0);
+        passed &= tree.GetStats().LargestFreeBlock == 64 && tree.Allocate(6) == 0;
+        passed &= Report("exhaustion, fragmentation and merging", passed);
+
+        // Exact fits are used before larger blocks are split
+        BuddyTree fit(4, 0);
+        uint32_t a = fit.Allocate(2), b = fit.Allocate(2), c = fit.Allocate(3);
+        fit.Free(a, 2);
+        bool bestFit = a == 0 && b == 4 && c == 8 && fit.Allocate(0) == 0;
+        passed &= Report("best fit", bestFit);
+
+        // Cached blocks are flushed back when an allocation would fail
+        BuddyTree cached(4);
+        for (uint32_t i = 0; i < 16; ++i)
+            cached.Allocate(0);
+        for (uint32_t i = 0; i < 16; ++i)
+            cached.Free(i, 0);
+        bool flushed = cached.GetStats().CachedUnits == BuddyTree::kCacheSlots && cached.Allocate(4) == 0;
+        flushed &= cached.GetStats().CachedUnits == 0;
+        passed &= Report("cache flush on failure", flushed);
+
+        return passed;
+    }
+
+    // Threads allocate and free at random. Each unit records its owner, so a block handed to
+    // two threads at once is caught.
+    bool Stress(uint32_t maxOrder, uint32_t numThreads, uint32_t numOperations, const char* name)
+    {
+        BuddyTree tree(maxOrder);
+        vector<atomic<uint32_t>> owners(1u << maxOrder);
+        for (atomic<uint32_t>& owner : owners)
+            owner = 0;
+        atomic<bool> overlap(false);
+
+        vector<thread> threads;
+        for (uint32_t t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&, t]()
+            {
+                mt19937 rng(t + 1);
+                vector<Block> live;
+                const uint32_t id = t + 1;
+
+                for (uint32_t op = 0; op < numOperations; ++op)
+                {
+                    if (live.empty() || rng() % 2 == 0)
+                    {
+                        const uint32_t order = RandomOrder(rng, maxOrder);
+                        const uint32_t offset = tree.Allocate(order);
+                        if (offset == BuddyTree::kInvalidOffset)
+                            continue;
+
+                        for (uint32_t i = offset; i < offset + (1u << order); ++i)
+                        {
+                            uint32_t expected = 0;
+                            if (!owners[i].compare_exchange_strong(expected, id))
+                                overlap = true;
+                        }
+                        live.push_back({ offset, order });
+                    }
+                    else
+                    {
+                        const size_t index = rng() % live.size();
+                        const Block block = live[index];
+                        live[index] = live.back();
+                        live.pop_back();
+
+                        for (uint32_t i = block.Offset; i < block.Offset + (1u << block.Order); ++i)
+                            owners[i] = 0;
+                        tree.Free(block.Offset, block.Order);
+                    }
+                }
+
+                for (const Block& block : live)
+                {
+                    for (uint32_t i = block.Offset; i < block.Offset + (1u << block.Order); ++i)
+                        owners[i] = 0;
+                    tree.Free(block.Offset, block.Order);
+                }
+            });
+        }
+        for (thread& t : threads)
+            t.join();
+
+        tree.FlushCache();
+        BuddyTree::Stats stats = tree.GetStats();
+        printf("  %u threads, %u operations each\n", numThreads, numOperations);
+        return Report(name, !overlap && stats.NumAllocations == 0 && stats.LargestFreeBlock == stats.TotalUnits);
+    }
+
+    // Keeps about half the blocks live, like buffers coming and going while streaming
+    template <typename Allocator>
+    uint32_t RunWorkload(Allocator& allocator, uint32_t maxOrder, uint32_t numOperations, uint32_t seed)
+    {
+        mt19937 rng(seed);
+        vector<Block> live;
+        live.reserve(1u << maxOrder);
+        uint32_t failed = 0;
+
+        for (uint32_t op = 0; op < numOperations; ++op)
+        {
+            if (live.empty() || rng() % 2 == 0)
+            {
+                const uint32_t order = RandomOrder(rng, maxOrder);
+                const uint32_t offset = allocator.Allocate(order);
+                if (offset == BuddyTree::kInvalidOffset)
+                    ++failed;
+                else
+                    live.push_back({ offset, order });
+            }
+            else
+            {
+                const size_t index = rng() % live.size();
+                allocator.Free(live[index].Offset, live[index].Order);
+                live[index] = live.back();
+                live.pop_back();
+            }
+        }
+
+        for (const Block& block : live)
+            allocator.Free(block.Offset, block.Order);
+        return failed;
+    }
+
+    template <typename Allocator>
+    void Benchmark(const char* name, Allocator& allocator, uint32_t maxOrder, uint32_t numThreads, uint32_t numOperations)
+    {
+        auto start = chrono::high_resolution_clock::now();
+
+        vector<thread> threads;
+        atomic<uint32_t> failed(0);
+        for (uint32_t t = 0; t < numThreads; ++t)
+            threads.emplace_back([&, t]() { failed += RunWorkload(allocator, maxOrder, numOperations, t + 1); });
+        for (thread& t : threads)
+            t.join();
+
+        const double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+        printf("%-24s %10.3f ms (%.1f M operations/s, %u failed)\n", name, ms,
+            (double)numOperations * numThreads / ms * 1e-3, failed.load());
+    }
+
+    // The reference free lists are not thread safe, so they are timed under a mutex
+    struct LockedReference
+    {
+        explicit LockedReference(uint32_t maxOrder) : Buddy(maxOrder) {}
+
+        uint32_t Allocate(uint32_t order)
+        {
+            lock_guard<mutex> lock(Mutex);
+            return Buddy.Allocate(order);
+        }
+
+        void Free(uint32_t offset, uint32_t order)
+        {
+            lock_guard<mutex> lock(Mutex);
+            Buddy.Free(offset, order);
+        }
+
+        mutex Mutex;
+        ReferenceBuddy Buddy;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t maxOrder = 12;
+    uint32_t numOperations = 2000000;
+    uint32_t numThreads = max(thread::hardware_concurrency(), 1u);
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (arg + 1 < argc && strcmp("-order", argv[arg]) == 0)
+            maxOrder = min(max(atoi(argv[++arg]), 4), (int)BuddyTree::kMaxOrder);
+        else if (arg + 1 < argc && strcmp("-operations", argv[arg]) == 0)
+            numOperations = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-threads", argv[arg]) == 0)
+            numThreads = max(atoi(argv[++arg]), 1);
+        else
+        {
+            printf(
+                "Usage:  %s [options]*\n\n"
+                "Options:\n\n"
+                "-order <integer>\n\tLog2 of the number of units managed.\n\tDefaults to 12 (256 MB of 64 KB units).\n"
+                "-operations <integer>\n\tAllocations and frees per benchmark thread.\n\tDefaults to 2000000.\n"
+                "-threads <integer>\n\tThreads for the multithreaded benchmark.\n\tDefaults to every hardware thread.\n\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    bool passed = CheckBasics();
+    passed &= Fuzz(8, 0, 200000, 1, "fuzz without cache");
+    passed &= Fuzz(8, BuddyTree::kMaxCachedOrders, 200000, 2, "fuzz with cache");
+    passed &= Fuzz(4, BuddyTree::kMaxCachedOrders, 50000, 3, "fuzz with cache, nearly full");
+    passed &= Stress(10, 4, 200000, "multithreaded stress");
+    passed &= Stress(6, 8, 100000, "multithreaded stress, nearly full");
+
+    printf("\n%u units, %u operations per thread:\n", 1u << maxOrder, numOperations);
+    {
+        ReferenceBuddy reference(maxOrder);
+        BuddyTree uncached(maxOrder, 0), cached(maxOrder);
+        Benchmark("std::set free lists", reference, maxOrder, 1, numOperations);
+        Benchmark("BuddyTree, no cache", uncached, maxOrder, 1, numOperations);
+        Benchmark("BuddyTree", cached, maxOrder, 1, numOperations);
+    }
+    {
+        char name[64];
+        LockedReference reference(maxOrder);
+        BuddyTree cached(maxOrder);
+        snprintf(name, sizeof(name), "std::set, %u threads", numThreads);
+        Benchmark(name, reference, maxOrder, numThreads, numOperations / numThreads);
+        snprintf(name, sizeof(name), "BuddyTree, %u threads", numThreads);
+        Benchmark(name, cached, maxOrder, numThreads, numOperations / numThreads);
+    }
+
+    return passed ? 0 : 1;
+}
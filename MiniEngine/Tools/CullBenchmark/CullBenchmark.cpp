@@ -0,0 +1,312 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+//
+// Checks the SIMD culling path against the scalar one and times both, e.g.
+//
+//     CullBenchmark -spheres 100000 -iterations 200 -threads 8
+//
+// The scene is a camera frustum looking down -Z with spheres scattered around it, so that
+// most of them are culled, plus hand-made cases on and around the frustum planes.
+//
+
+#include "../../Core/Math/SphereCulling.h"
+#include "../../Core/WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace Math;
+
+namespace
+{
+    struct Scene
+    {
+        vector<float> spheres;   // (x, y, z, radius) per sphere
+        vector<float> xforms;    // (tx, ty, tz, scale) per sphere
+        SphereCulling::ViewTransform view;
+        SphereCulling::FrustumPlanes frustum;
+
+        uint32_t Count() const { return (uint32_t)(spheres.size() / 4); }
+        const float (*Spheres() const)[4] { return (const float (*)[4])spheres.data(); }
+        const float (*Xforms() const)[4] { return (const float (*)[4])xforms.data(); }
+
+        void Add(float x, float y, float z, float r, float tx = 0.0f, float ty = 0.0f, float tz = 0.0f, float s = 1.0f)
+        {
+            float sphere[4] = { x, y, z, r }, xform[4] = { tx, ty, tz, s };
+            spheres.insert(spheres.end(), sphere, sphere + 4);
+            xforms.insert(xforms.end(), xform, xform + 4);
+        }
+    };
+
+    // Same planes as Frustum::ConstructPerspectiveFrustum
+    void SetPerspectiveFrustum(SphereCulling::FrustumPlanes& f, float hTan, float vTan, float nearClip, float farClip)
+    {
+        const float nhx = 1.0f / sqrt(1.0f + hTan * hTan), nhz = -nhx * hTan;
+        const float nvy = 1.0f / sqrt(1.0f + vTan * vTan), nvz = -nvy * vTan;
+
+        const float planes[6][4] =
+        {
+            { 0.0f, 0.0f, -1.0f, -nearClip },
+            { 0.0f, 0.0f,  1.0f,  farClip },
+            {  nhx, 0.0f,   nhz,  0.0f },
+            { -nhx, 0.0f,   nhz,  0.0f },
+            { 0.0f, -nvy,   nvz,  0.0f },
+            { 0.0f,  nvy,   nvz,  0.0f },
+        };
+        memcpy(f.Planes, planes, sizeof(planes));
+    }
+
+    // A rotation about Y followed by a translation
+    void SetView(SphereCulling::ViewTransform& v, float angle, float tx, float ty, float tz)
+    {
+        const float c = cos(angle), s = sin(angle);
+        const float columns[4][4] =
+        {
+            {    c, 0.0f,   -s, 0.0f },
+            { 0.0f, 1.0f, 0.0f, 0.0f },
+            {    s, 0.0f,    c, 0.0f },
+            {   tx,   ty,   tz, 1.0f },
+        };
+        memcpy(v.Columns, columns, sizeof(columns));
+    }
+
+    Scene MakeScene(uint32_t numSpheres, uint32_t seed)
+    {
+        Scene scene;
+        SetView(scene.view, 0.3f, 5.0f, -2.0f, -40.0f);
+        SetPerspectiveFrustum(scene.frustum, 0.9f, 0.5f, 1.0f, 400.0f);
+
+        mt19937 rng(seed);
+        uniform_real_distribution<float> pos(-300.0f, 300.0f), radius(0.01f, 20.0f), scale(0.25f, 4.0f);
+
+        for (uint32_t i = 0; i < numSpheres; ++i)
+            scene.Add(pos(rng), pos(rng) * 0.25f, pos(rng), radius(rng), pos(rng) * 0.1f, 0.0f, pos(rng) * 0.1f, scale(rng));
+
+        return scene;
+    }
+
+    // Spheres that touch, straddle or just miss each plane, degenerate radii and NaNs
+    Scene MakeEdgeCases()
+    {
+        Scene scene;
+        SetView(scene.view, 0.0f, 0.0f, 0.0f, 0.0f);
+        SetPerspectiveFrustum(scene.frustum, 1.0f, 1.0f, 1.0f, 100.0f);
+
+        const float offsets[] = { -1e-3f, -1e-6f, 0.0f, 1e-6f, 1e-3f };
+        for (float o : offsets)
+        {
+            scene.Add(0.0f, 0.0f, -1.0f + o, 0.0f);
+            scene.Add(0.0f, 0.0f, -100.0f + o, 0.0f);
+            scene.Add(50.0f + o, 0.0f, -50.0f, 0.0f);
+            scene.Add(0.0f, -50.0f + o, -50.0f, 0.0f);
+            scene.Add(0.0f, 0.0f, 1.0f + o, 2.0f);
+            scene.Add(60.0f, 0.0f, -50.0f, 7.0710678f + o);
+        }
+
+        scene.Add(0.0f, 0.0f, -10.0f, -1.0f);
+        scene.Add(0.0f, 0.0f, -10.0f, numeric_limits<float>::quiet_NaN());
+        scene.Add(numeric_limits<float>::quiet_NaN(), 0.0f, -10.0f, 1.0f);
+        scene.Add(0.0f, 0.0f, -10.0f, numeric_limits<float>::infinity());
+        scene.Add(0.0f, 0.0f, 1e30f, 1.0f, 0.0f, 0.0f, 0.0f, 1e10f);
+        scene.Add(1.0f, 1.0f, -5.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+        return scene;
+    }
+
+    // Returns the number of mismatches between the scalar and SIMD paths
+    uint32_t Check(const Scene& scene, const char* name)
+    {
+        uint32_t failures = 0;
+
+        for (int cull = 0; cull < 2; ++cull)
+        {
+            // Odd counts exercise the scalar tail of the batched path
+            for (uint32_t count : { scene.Count(), scene.Count() - min(scene.Count(), 3u) })
+            {
+                vector<uint32_t> visibleRef(count), visibleSimd(count);
+                vector<float> distRef(count), distSimd(count);
+
+                uint32_t numRef = SphereCulling::TransformAndCullScalar(scene.Spheres(), scene.Xforms(), count,
+                    scene.view, scene.frustum, cull != 0, 7, visibleRef.data(), distRef.data());
+                uint32_t numSimd = SphereCulling::TransformAndCull(scene.Spheres(), scene.Xforms(), count,
+                    scene.view, scene.frustum, cull != 0, 7, visibleSimd.data(), distSimd.data());
+
+                visibleRef.resize(numRef);
+                visibleSimd.resize(numSimd);
+                if (visibleRef != visibleSimd)
+                {
+                    printf("FAILED %s: visible sets differ (cull %d, count %u, %u vs %u visible)\n",
+                        name, cull, count, numRef, numSimd);
+                    ++failures;
+                }
+
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    bool bothNaN = std::isnan(distRef[i]) && std::isnan(distSimd[i]);
+                    if (!bothNaN && memcmp(&distRef[i], &distSimd[i], sizeof(float)) != 0)
+                    {
+                        printf("FAILED %s: distance %u is %g vs %g\n", name, i, distRef[i], distSimd[i]);
+                        ++failures;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (failures == 0)
+            printf("Passed %s (%u spheres)\n", name, scene.Count());
+
+        return failures;
+    }
+
+    typedef uint32_t (*CullFunction)(const float (*)[4], const float (*)[4], uint32_t,
+        const SphereCulling::ViewTransform&, const SphereCulling::FrustumPlanes&, bool, uint32_t, uint32_t*, float*);
+
+    // Splits the spheres into contiguous ranges on the worker pool the way Model::Render does
+    uint32_t CullThreaded(CullFunction cull, const Scene& scene, uint32_t numThreads, uint32_t* visible, float* distances)
+    {
+        const uint32_t count = scene.Count();
+        vector<uint32_t> rangeVisible(numThreads);
+
+        WorkerPool::Run(numThreads, [&](uint32_t t)
+        {
+            uint32_t start = (uint32_t)((uint64_t)count * t / numThreads);
+            uint32_t end = (uint32_t)((uint64_t)count * (t + 1) / numThreads);
+            rangeVisible[t] = cull(scene.Spheres() + start, scene.Xforms() + start, end - start,
+                scene.view, scene.frustum, true, start, visible + start, distances + start);
+        });
+
+        uint32_t numVisible = 0;
+        for (uint32_t t = 0; t < numThreads; ++t)
+        {
+            uint32_t start = (uint32_t)((uint64_t)count * t / numThreads);
+            copy_n(visible + start, rangeVisible[t], visible + numVisible);
+            numVisible += rangeVisible[t];
+        }
+        return numVisible;
+    }
+
+    // Culls on the pool from several threads at once, with more tasks than threads too, and
+    // compares each packed result with a single thread
+    uint32_t CheckThreaded(const Scene& scene)
+    {
+        const uint32_t count = scene.Count();
+        vector<uint32_t> visibleRef(count);
+        vector<float> distRef(count);
+        const uint32_t numRef = CullThreaded(SphereCulling::TransformAndCull, scene, 1, visibleRef.data(), distRef.data());
+        visibleRef.resize(numRef);
+
+        atomic<uint32_t> failures(0);
+        auto caller = [&](uint32_t c)
+        {
+            vector<uint32_t> visible(count);
+            vector<float> distances(count);
+            for (uint32_t i = 0; i < 20; ++i)
+            {
+                const uint32_t numThreads = 2 + (c * 20 + i) % 15;
+                const uint32_t numVisible = CullThreaded(SphereCulling::TransformAndCull, scene, numThreads, visible.data(), distances.data());
+                if (numVisible != numRef || !equal(visibleRef.begin(), visibleRef.end(), visible.begin()) ||
+                    memcmp(distRef.data(), distances.data(), count * sizeof(float)) != 0)
+                {
+                    ++failures;
+                }
+            }
+        };
+
+        vector<thread> callers;
+        for (uint32_t c = 1; c < 4; ++c)
+            callers.emplace_back(caller, c);
+        caller(0);
+        for (thread& t : callers)
+            t.join();
+
+        printf("%s worker pool (%u threads, 4 callers)\n", failures == 0 ? "Passed" : "FAILED", WorkerPool::GetNumThreads());
+        return failures;
+    }
+
+    void Benchmark(const char* name, CullFunction cull, const Scene& scene, uint32_t iterations, uint32_t numThreads)
+    {
+        vector<uint32_t> visible(scene.Count());
+        vector<float> distances(scene.Count());
+        uint32_t numVisible = 0;
+
+        auto start = chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < iterations; ++i)
+            numVisible = CullThreaded(cull, scene, numThreads, visible.data(), distances.data());
+        auto end = chrono::high_resolution_clock::now();
+
+        double ns = chrono::duration<double, nano>(end - start).count() / ((double)iterations * scene.Count());
+        printf("%-8s %2u thread(s): %7.3f ns/sphere, %u of %u visible\n", name, numThreads, ns, numVisible, scene.Count());
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numSpheres = 100000;
+    uint32_t iterations = 100;
+    uint32_t numThreads = max(thread::hardware_concurrency(), 1u);
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (arg + 1 < argc && strcmp("-spheres", argv[arg]) == 0)
+            numSpheres = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-iterations", argv[arg]) == 0)
+            iterations = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-threads", argv[arg]) == 0)
+            numThreads = max(atoi(argv[++arg]), 1);
+        else
+        {
+            printf(
+                "Usage:  %s [options]*\n\n"
+                "Options:\n\n"
+                "-spheres <integer>\n\tNumber of spheres to cull.\n\tDefaults to 100000.\n"
+                "-iterations <integer>\n\tTimed repetitions.\n\tDefaults to 100.\n"
+                "-threads <integer>\n\tLargest thread count to time.\n\tDefaults to every hardware thread.\n\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    printf("SIMD batch width: %u\n", SphereCulling::GetBatchWidth());
+
+    uint32_t failures = Check(MakeEdgeCases(), "edge cases");
+    for (uint32_t seed = 1; seed <= 8; ++seed)
+        failures += Check(MakeScene(1000 + seed, seed), "random scene");
+
+    Scene scene = MakeScene(numSpheres, 0);
+    failures += CheckThreaded(scene);
+
+    Benchmark("scalar", SphereCulling::TransformAndCullScalar, scene, iterations, 1);
+    for (uint32_t t = 1; t <= numThreads; t *= 2)
+        Benchmark("batched", SphereCulling::TransformAndCull, scene, iterations, t);
+
+    return failures == 0 ? 0 : 1;
+}
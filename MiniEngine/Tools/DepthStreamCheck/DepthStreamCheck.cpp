@@ -0,0 +1,445 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+//
+// Checks DepthStream::Build, which welds the depth-only vertices of a primitive. Synthetic
+// meshes have known welded counts. Then every indexed triangle list of a glTF model goes
+// through the builder, and the result is compared against a brute force weld of the same
+// vertices. The welded vertex count must match exactly. The triangles must be the same
+// after the ones that lost their area are dropped, and vertices must be numbered in order
+// of first use. The depth vertices are the float3 position, plus the float2 UV for alpha
+// tested materials, like the unquantized stream OptimizeMesh writes.
+//
+
+#include "../../Model/DepthStream.h"
+#include "../../Model/glTFDecode.h"
+#include "../../Model/json.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+using json = nlohmann::json;
+
+namespace
+{
+    bool Report(const char* name, bool passed)
+    {
+        printf("%s %s\n", passed ? "Passed" : "FAILED", name);
+        return passed;
+    }
+
+    struct Counts
+    {
+        uint32_t vertices = 0;
+        uint32_t weldedVertices = 0;
+        uint32_t triangles = 0;
+        uint32_t depthTriangles = 0;
+    };
+
+    // Compares a depth stream against a brute force weld of its input and adds up the counts
+    bool Verify(const vector<uint32_t>& indices, const vector<uint8_t>& vertices, uint32_t stride,
+        const DepthStream::Result& result, Counts& counts)
+    {
+        auto key = [&](const uint8_t* vertex) { return string((const char*)vertex, stride); };
+
+        // Triangles as vertex contents, rotated so that the smallest vertex comes first
+        auto addTriangle = [](vector<string>& triangles, string a, string b, string c)
+        {
+            while (a > b || a > c)
+            {
+                swap(a, b);
+                swap(b, c);
+            }
+            triangles.push_back(a + b + c);
+        };
+
+        map<string, uint32_t> distinct;
+        vector<string> expected;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            const string a = key(&vertices[(size_t)indices[i] * stride]);
+            const string b = key(&vertices[(size_t)indices[i + 1] * stride]);
+            const string c = key(&vertices[(size_t)indices[i + 2] * stride]);
+            if (a == b || b == c || c == a)
+                continue;
+
+            distinct.emplace(a, 0);
+            distinct.emplace(b, 0);
+            distinct.emplace(c, 0);
+            addTriangle(expected, a, b, c);
+        }
+
+        bool ok = result.vertexCount == distinct.size() && result.vertices.size() == (size_t)result.vertexCount * stride &&
+            result.indices.size() == expected.size() * 3;
+
+        vector<string> actual;
+        uint32_t nextNew = 0;
+        for (size_t i = 0; ok && i < result.indices.size(); ++i)
+        {
+            const uint32_t index = result.indices[i];
+            ok &= index <= nextNew && index < result.vertexCount;
+            nextNew = max(nextNew, index + 1);
+        }
+        for (size_t i = 0; ok && i + 2 < result.indices.size(); i += 3)
+        {
+            addTriangle(actual, key(&result.vertices[(size_t)result.indices[i] * stride]),
+                key(&result.vertices[(size_t)result.indices[i + 1] * stride]),
+                key(&result.vertices[(size_t)result.indices[i + 2] * stride]));
+        }
+
+        sort(expected.begin(), expected.end());
+        sort(actual.begin(), actual.end());
+        ok &= actual == expected;
+
+        counts.vertices += (uint32_t)(vertices.size() / stride);
+        counts.weldedVertices += result.vertexCount;
+        counts.triangles += (uint32_t)(indices.size() / 3);
+        counts.depthTriangles += (uint32_t)(result.indices.size() / 3);
+        return ok;
+    }
+
+    struct Mesh
+    {
+        vector<uint8_t> vertices;
+        vector<uint32_t> indices;
+        vector<float> positions;
+        uint32_t stride = 12;
+
+        uint32_t AddVertex(float x, float y, float z, float u = 0.0f, float v = 0.0f)
+        {
+            const float values[5] = { x, y, z, u, v };
+            const size_t offset = vertices.size();
+            vertices.resize(offset + stride);
+            memcpy(&vertices[offset], values, stride);
+            positions.insert(positions.end(), values, values + 3);
+            return (uint32_t)(offset / stride);
+        }
+    };
+
+    // A cube with four vertices per face, as it would be for per-face normals. With 'uvs' the
+    // corners of each face get their own UVs, so only vertices of one face could weld.
+    Mesh MakeCube(bool uvs)
+    {
+        Mesh mesh;
+        mesh.stride = uvs ? 20 : 12;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            for (int side = 0; side < 2; ++side)
+            {
+                uint32_t first = 0;
+                for (int corner = 0; corner < 4; ++corner)
+                {
+                    float p[3];
+                    p[axis] = (float)side;
+                    p[(axis + 1) % 3] = (float)(corner & 1);
+                    p[(axis + 2) % 3] = (float)(corner >> 1);
+                    const uint32_t v = mesh.AddVertex(p[0], p[1], p[2], (float)(corner & 1), (float)(axis * 2 + side));
+                    if (corner == 0)
+                        first = v;
+                }
+                const uint32_t quad[6] = { 0, 1, 3, 0, 3, 2 };
+                for (uint32_t q : quad)
+                    mesh.indices.push_back(first + q);
+            }
+        }
+        return mesh;
+    }
+
+    bool BuildAndVerify(const Mesh& mesh, const VertexCacheOptimize::Settings& settings, DepthStream::Result& result,
+        Counts& counts)
+    {
+        return DepthStream::Build(mesh.indices.data(), (uint32_t)mesh.indices.size(), mesh.vertices.data(),
+            (uint32_t)(mesh.vertices.size() / mesh.stride), mesh.stride, mesh.positions.data(), 12, settings, result) &&
+            Verify(mesh.indices, mesh.vertices, mesh.stride, result, counts);
+    }
+
+    bool CheckSynthetic()
+    {
+        bool passed = true;
+
+        const VertexCacheOptimize::Algorithm algorithms[] =
+            { VertexCacheOptimize::kForsyth, VertexCacheOptimize::kTipsify, VertexCacheOptimize::kNone };
+        for (VertexCacheOptimize::Algorithm algorithm : algorithms)
+        {
+            for (int reduceOverdraw = 0; reduceOverdraw < 2; ++reduceOverdraw)
+            {
+                VertexCacheOptimize::Settings settings;
+                settings.algorithm = algorithm;
+                settings.reduceOverdraw = reduceOverdraw != 0;
+
+                Counts counts;
+                DepthStream::Result result;
+                bool ok = BuildAndVerify(MakeCube(false), settings, result, counts) &&
+                    counts.vertices == 24 && counts.weldedVertices == 8 && counts.depthTriangles == 12;
+
+                counts = Counts();
+                ok &= BuildAndVerify(MakeCube(true), settings, result, counts) &&
+                    counts.weldedVertices == 24 && counts.depthTriangles == 12;
+
+                char name[128];
+                snprintf(name, sizeof(name), "cube welds 24 to 8 vertices, not with UVs (%s%s)",
+                    VertexCacheOptimize::GetAlgorithmName(algorithm), reduceOverdraw ? " + overdraw" : "");
+                passed &= Report(name, ok);
+            }
+        }
+
+        // A triangle that loses its area is dropped, and its vertices only survive if used
+        {
+            Mesh mesh;
+            mesh.AddVertex(0.0f, 0.0f, 0.0f);
+            mesh.AddVertex(1.0f, 0.0f, 0.0f);
+            mesh.AddVertex(1.0f, 0.0f, 0.0f);   // Welds with the one above
+            mesh.AddVertex(0.0f, 1.0f, 0.0f);
+            mesh.AddVertex(5.0f, 5.0f, 5.0f);   // Only in the degenerate triangle
+            mesh.indices = { 0, 1, 3, 1, 2, 4 };
+
+            Counts counts;
+            DepthStream::Result result;
+            passed &= Report("degenerate triangles dropped", BuildAndVerify(mesh, VertexCacheOptimize::Settings(), result, counts) &&
+                counts.weldedVertices == 3 && counts.depthTriangles == 1 && result.indices == vector<uint32_t>({ 0, 1, 2 }));
+        }
+
+        // The main index buffer has to be shared when the indices can't be remapped
+        {
+            Mesh mesh = MakeCube(false);
+            DepthStream::Result result;
+            const uint32_t vertexCount = (uint32_t)(mesh.vertices.size() / mesh.stride);
+            bool ok = !DepthStream::Build(mesh.indices.data(), 0, mesh.vertices.data(), vertexCount, mesh.stride,
+                mesh.positions.data(), 12, VertexCacheOptimize::Settings(), result);
+            mesh.indices[7] = vertexCount;
+            ok &= !DepthStream::Build(mesh.indices.data(), (uint32_t)mesh.indices.size(), mesh.vertices.data(), vertexCount,
+                mesh.stride, mesh.positions.data(), 12, VertexCacheOptimize::Settings(), result);
+            passed &= Report("empty and out of range indices", ok && result.vertexCount == 0 && result.indices.empty());
+        }
+
+        return passed;
+    }
+
+    bool ReadFile(const string& path, vector<uint8_t>& data)
+    {
+        ifstream file(path, ios::binary);
+        if (!file)
+            return false;
+        data.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        return true;
+    }
+
+    // Every indexed triangle list of the model. Returns false if it can't be read, with the
+    // reason in 'error'.
+    bool CheckModel(const string& path, bool& ok, string& error)
+    {
+        vector<uint8_t> file;
+        if (!ReadFile(path, file))
+        {
+            error = "cannot read " + path;
+            return false;
+        }
+
+        const size_t lastSlash = path.find_last_of("/\\");
+        const string basePath = lastSlash == string::npos ? string() : path.substr(0, lastSlash + 1);
+
+        glTFDecode::GLBChunks chunks = { (const char*)file.data(), file.size(), nullptr, 0 };
+        if (file.size() >= 4 && memcmp(file.data(), "glTF", 4) == 0)
+        {
+            glTFDecode::Status status = glTFDecode::ParseGLB(file.data(), file.size(), chunks);
+            if (status != glTFDecode::kOK)
+            {
+                error = string("bad GLB: ") + glTFDecode::GetStatusString(status);
+                return false;
+            }
+        }
+
+        json root = json::parse(chunks.Json, chunks.Json + chunks.JsonSize, nullptr, false);
+        if (root.is_discarded())
+        {
+            error = "malformed JSON";
+            return false;
+        }
+
+        vector<vector<uint8_t>> bufferData;
+        vector<glTFDecode::BufferRange> buffers;
+        for (json& buffer : root["buffers"])
+        {
+            bufferData.emplace_back();
+            const string uri = buffer.value("uri", string());
+            if (uri.empty())
+            {
+                bufferData.back().assign(chunks.Bin, chunks.Bin + chunks.BinSize);
+            }
+            else if (glTFDecode::IsDataURI(uri))
+            {
+                glTFDecode::DecodeDataURI(uri, bufferData.back());
+            }
+            else
+            {
+                string decoded;
+                if (!glTFDecode::DecodeURI(uri, decoded) || !ReadFile(basePath + decoded, bufferData.back()))
+                {
+                    error = "cannot read buffer " + basePath + uri;
+                    return false;
+                }
+            }
+            buffers.push_back({ bufferData.back().data(), (uint64_t)bufferData.back().size() });
+        }
+
+        vector<glTFDecode::BufferViewDesc> views;
+        for (json& view : root["bufferViews"])
+        {
+            views.push_back({ view.value("buffer", 0u), view.value("byteOffset", (uint64_t)0),
+                view.value("byteLength", (uint64_t)0), view.value("byteStride", 0u) });
+        }
+
+        vector<json> accessors(root["accessors"].begin(), root["accessors"].end());
+        auto resolve = [&](uint32_t idx, vector<uint8_t>& storage, glTFDecode::AccessorDesc& desc,
+            glTFDecode::ResolvedAccessor& resolved)
+        {
+            if (idx >= accessors.size())
+                return false;
+
+            static const char* kTypes[] = { "SCALAR", "VEC2", "VEC3", "VEC4", "MAT2", "MAT3", "MAT4" };
+            const json& accessor = accessors[idx];
+            desc = glTFDecode::AccessorDesc();
+            desc.BufferView = accessor.value("bufferView", -1);
+            desc.ByteOffset = accessor.value("byteOffset", (uint64_t)0);
+            desc.Count = accessor.value("count", 0u);
+            desc.ComponentType = accessor.value("componentType", 0u) - 5120;
+            desc.Type = (uint32_t)(find(begin(kTypes), end(kTypes), accessor.value("type", string())) - begin(kTypes));
+            return glTFDecode::ResolveAccessor(buffers, views, desc, storage, resolved) == glTFDecode::kOK;
+        };
+
+        vector<bool> alphaTested;
+        for (json& material : root["materials"])
+            alphaTested.push_back(material.value("alphaMode", string()) == "MASK");
+
+        Counts counts;
+        uint32_t numPrimitives = 0;
+        double milliseconds = 0.0;
+        ok = true;
+
+        for (json& mesh : root["meshes"])
+        {
+            for (json& primitive : mesh["primitives"])
+            {
+                json& attributes = primitive["attributes"];
+                if (primitive.value("mode", 4) != 4 || !primitive.contains("indices") || !attributes.contains("POSITION"))
+                    continue;
+
+                vector<uint8_t> positionStorage, uvStorage, indexStorage;
+                glTFDecode::AccessorDesc positionDesc, uvDesc, indexDesc;
+                glTFDecode::ResolvedAccessor position, uv, index;
+                if (!resolve(attributes["POSITION"].get<uint32_t>(), positionStorage, positionDesc, position) ||
+                    positionDesc.ComponentType != 6 || positionDesc.Type != 2 ||
+                    !resolve(primitive["indices"].get<uint32_t>(), indexStorage, indexDesc, index))
+                {
+                    error = "bad accessor in " + mesh.value("name", string("a mesh"));
+                    return false;
+                }
+
+                const uint32_t materialIdx = primitive.value("material", 0xFFFFFFFFu);
+                const bool hasUVs = materialIdx < alphaTested.size() && alphaTested[materialIdx] &&
+                    attributes.contains("TEXCOORD_0") && resolve(attributes["TEXCOORD_0"].get<uint32_t>(), uvStorage, uvDesc, uv) &&
+                    uvDesc.ComponentType == 6 && uvDesc.Type == 1 && uvDesc.Count == positionDesc.Count;
+
+                const uint32_t vertexCount = positionDesc.Count;
+                const uint32_t stride = hasUVs ? 20 : 12;
+                vector<uint8_t> vertices((size_t)vertexCount * stride);
+                vector<float> positions((size_t)vertexCount * 3);
+                for (uint32_t v = 0; v < vertexCount; ++v)
+                {
+                    const uint8_t* p = position.Data + (size_t)v * (position.Stride != 0 ? position.Stride : 12);
+                    memcpy(&vertices[(size_t)v * stride], p, 12);
+                    memcpy(&positions[(size_t)v * 3], p, 12);
+                    if (hasUVs)
+                        memcpy(&vertices[(size_t)v * stride + 12], uv.Data + (size_t)v * (uv.Stride != 0 ? uv.Stride : 8), 8);
+                }
+
+                const uint32_t componentSize = glTFDecode::GetComponentSize(indexDesc.ComponentType);
+                const uint32_t indexStride = index.Stride != 0 ? index.Stride : componentSize;
+                vector<uint32_t> indices(indexDesc.Count);
+                for (uint32_t i = 0; i < indexDesc.Count; ++i)
+                {
+                    const uint8_t* src = index.Data + (size_t)i * indexStride;
+                    indices[i] = componentSize == 1 ? *src : componentSize == 2 ? *(const uint16_t*)src : *(const uint32_t*)src;
+                }
+
+                DepthStream::Result result;
+                auto start = chrono::high_resolution_clock::now();
+                const bool built = DepthStream::Build(indices.data(), (uint32_t)indices.size(), vertices.data(), vertexCount,
+                    stride, positions.data(), 12, VertexCacheOptimize::Settings(), result);
+                milliseconds += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+                ok &= built && Verify(indices, vertices, stride, result, counts);
+                ++numPrimitives;
+            }
+        }
+
+        printf("  %u primitives: %u -> %u vertices, %u -> %u triangles in %.1f ms\n", numPrimitives, counts.vertices,
+            counts.weldedVertices, counts.triangles, counts.depthTriangles, milliseconds);
+        ok &= numPrimitives > 0;
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    string model = DEFAULT_MODEL;
+    bool modelGiven = false;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (arg + 1 < argc && strcmp("-model", argv[arg]) == 0)
+        {
+            model = argv[++arg];
+            modelGiven = true;
+        }
+        else
+        {
+            printf(
+                "Usage:  %s [options]*\n\n"
+                "Options:\n\n"
+                "-model <path>\n\tA .gltf or .glb file whose triangle lists are welded.\n\tDefaults to %s.\n\n",
+                argv[0], DEFAULT_MODEL);
+            return 1;
+        }
+    }
+
+    bool passed = CheckSynthetic();
+
+    // The default model is skipped when its data is missing, as in checkouts without the
+    // Sponza geometry. A model given on the command line must load.
+    bool ok = false;
+    string error;
+    const string name = "weld " + model.substr(model.find_last_of("/\\") + 1);
+    if (CheckModel(model, ok, error))
+        passed &= Report(name.c_str(), ok);
+    else if (modelGiven)
+        passed &= Report((name + " (" + error + ")").c_str(), false);
+    else
+        printf("Skipped %s (%s)\n", name.c_str(), error.c_str());
+
+    return passed ? 0 : 1;
+}
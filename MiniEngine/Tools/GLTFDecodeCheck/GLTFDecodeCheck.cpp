@@ -0,0 +1,587 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+//
+// Feeds glTFDecode well formed and malformed input, e.g.
+//
+//     GLTFDecodeCheck -fuzz 20000 -indices 8388608 -seed 1
+//
+// GLB files are built in memory, then every truncation and random byte corruption of them is
+// parsed. Accessors are checked against buffers that end exactly where the data does, so
+// reading one byte too many is caught by a sanitizer build. Sparse accessors are compared with
+// a direct expansion, and the parallel index scan with a single thread. Skin and animation
+// accessors are checked for the counts they are read with.
+//
+
+#include "../../Model/glTFDecode.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace glTFDecode;
+
+namespace
+{
+    bool Report(const char* name, bool passed)
+    {
+        printf("%s %s\n", passed ? "Passed" : "FAILED", name);
+        return passed;
+    }
+
+    void AppendU32(vector<uint8_t>& bytes, uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+            bytes.push_back((uint8_t)(value >> (8 * i)));
+    }
+
+    void AppendChunk(vector<uint8_t>& bytes, const char type[4], const vector<uint8_t>& data)
+    {
+        AppendU32(bytes, (uint32_t)data.size());
+        bytes.insert(bytes.end(), type, type + 4);
+        bytes.insert(bytes.end(), data.begin(), data.end());
+    }
+
+    // Chunks are padded to four bytes like a real exporter would
+    vector<uint8_t> MakeGLB(const string& json, const vector<uint8_t>& bin, bool withBin, uint32_t version = 2)
+    {
+        vector<uint8_t> jsonChunk(json.begin(), json.end());
+        while (jsonChunk.size() % 4 != 0)
+            jsonChunk.push_back(' ');
+        vector<uint8_t> binChunk(bin);
+        while (binChunk.size() % 4 != 0)
+            binChunk.push_back(0);
+
+        vector<uint8_t> bytes;
+        bytes.insert(bytes.end(), { 'g', 'l', 'T', 'F' });
+        AppendU32(bytes, version);
+        AppendU32(bytes, 0);
+        AppendChunk(bytes, "JSON", jsonChunk);
+        if (withBin)
+            AppendChunk(bytes, "BIN\0", binChunk);
+
+        uint32_t length = (uint32_t)bytes.size();
+        memcpy(bytes.data() + 8, &length, 4);
+        return bytes;
+    }
+
+    // Parses a copy sized exactly to the data so that any overread leaves the allocation. The
+    // chunks returned point into 'bytes'.
+    Status ParseCopy(const vector<uint8_t>& bytes, size_t size, GLBChunks& chunks)
+    {
+        vector<uint8_t> copy(bytes.begin(), bytes.begin() + size);
+        Status status = ParseGLB(copy.data(), copy.size(), chunks);
+        if (status == kOK)
+        {
+            // Touch every byte that was handed out
+            volatile uint32_t sum = 0;
+            for (size_t i = 0; i < chunks.JsonSize; ++i)
+                sum += (uint8_t)chunks.Json[i];
+            for (size_t i = 0; i < chunks.BinSize; ++i)
+                sum += chunks.Bin[i];
+            (void)sum;
+
+            chunks.Json = (const char*)bytes.data() + (chunks.Json - (const char*)copy.data());
+            if (chunks.Bin != nullptr)
+                chunks.Bin = (uint8_t*)bytes.data() + (chunks.Bin - copy.data());
+        }
+        return status;
+    }
+
+    string EncodeBase64(const vector<uint8_t>& data, bool pad)
+    {
+        static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        string text;
+        for (size_t i = 0; i < data.size(); i += 3)
+        {
+            uint32_t bits = (uint32_t)data[i] << 16;
+            if (i + 1 < data.size())
+                bits |= (uint32_t)data[i + 1] << 8;
+            if (i + 2 < data.size())
+                bits |= data[i + 2];
+
+            size_t chars = min<size_t>(data.size() - i, 3) + 1;
+            for (size_t c = 0; c < 4; ++c)
+            {
+                if (c < chars)
+                    text.push_back(kAlphabet[(bits >> (18 - 6 * c)) & 63]);
+                else if (pad)
+                    text.push_back('=');
+            }
+        }
+        return text;
+    }
+
+    bool DecodesTo(const string& text, const string& expected)
+    {
+        vector<uint8_t> data;
+        return DecodeBase64(text.data(), text.size(), data) && string(data.begin(), data.end()) == expected;
+    }
+
+    bool Rejects(const string& text)
+    {
+        vector<uint8_t> data;
+        return !DecodeBase64(text.data(), text.size(), data);
+    }
+
+    // One buffer holding 'size' bytes in an allocation of exactly that size
+    struct TestBuffers
+    {
+        vector<uint8_t> bytes;
+        vector<BufferRange> buffers;
+        vector<BufferViewDesc> views;
+
+        explicit TestBuffers(size_t size) : bytes(size)
+        {
+            for (size_t i = 0; i < size; ++i)
+                bytes[i] = (uint8_t)(i * 7 + 1);
+            buffers.push_back({ bytes.data(), bytes.size() });
+        }
+
+        uint32_t AddView(uint64_t offset, uint64_t length, uint32_t stride = 0, uint32_t buffer = 0)
+        {
+            views.push_back({ buffer, offset, length, stride });
+            return (uint32_t)views.size() - 1;
+        }
+
+        Status Resolve(const AccessorDesc& desc, vector<uint8_t>& storage, ResolvedAccessor& result) const
+        {
+            return ResolveAccessor(buffers, views, desc, storage, result);
+        }
+    };
+
+    AccessorDesc MakeAccessor(int32_t view, uint64_t offset, uint32_t count, uint32_t componentType, uint32_t type)
+    {
+        AccessorDesc desc;
+        desc.BufferView = view;
+        desc.ByteOffset = offset;
+        desc.Count = count;
+        desc.ComponentType = componentType;
+        desc.Type = type;
+        return desc;
+    }
+
+    // Reads every element of a resolved accessor, which a sanitizer checks for overreads
+    uint32_t TouchAccessor(const ResolvedAccessor& result, const AccessorDesc& desc)
+    {
+        uint32_t elementSize = GetElementSize(desc.ComponentType, desc.Type);
+        uint32_t step = result.Stride != 0 ? result.Stride : elementSize;
+        uint32_t sum = 0;
+        for (uint32_t i = 0; i < desc.Count; ++i)
+        {
+            for (uint32_t b = 0; b < elementSize; ++b)
+                sum += result.Data[(size_t)i * step + b];
+        }
+        return sum;
+    }
+
+    uint32_t ScalarMaxIndex(const vector<uint8_t>& data, uint32_t stride, uint32_t componentSize, uint32_t count)
+    {
+        uint32_t result = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t value = 0;
+            memcpy(&value, data.data() + (size_t)i * stride, componentSize);
+            result = max(result, value);
+        }
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t fuzzIterations = 20000;
+    uint32_t indexCount = 1u << 23;      // Enough for the scan to split across threads
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (i + 1 < argc && strcmp(argv[i], "-fuzz") == 0)
+            fuzzIterations = (uint32_t)atoi(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "-indices") == 0)
+            indexCount = (uint32_t)max(atoi(argv[++i]), 1);
+        else if (i + 1 < argc && strcmp(argv[i], "-seed") == 0)
+            seed = (uint32_t)atoi(argv[++i]);
+        else
+        {
+            printf("Usage: GLTFDecodeCheck [-fuzz iterations] [-indices count] [-seed n]\n");
+            return 1;
+        }
+    }
+
+    bool passed = true;
+    mt19937 rng(seed);
+
+    const string json = "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":10}]}";
+    const vector<uint8_t> bin = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    const vector<uint8_t> glb = MakeGLB(json, bin, true);
+
+    // Well formed files, with and without the BIN chunk and with trailing bytes past the length
+    {
+        GLBChunks chunks;
+        bool ok = ParseCopy(glb, glb.size(), chunks) == kOK && chunks.JsonSize >= json.size() &&
+            memcmp(chunks.Json, json.data(), json.size()) == 0 && chunks.BinSize == 12 && chunks.Bin[9] == 9;
+
+        vector<uint8_t> jsonOnly = MakeGLB(json, bin, false);
+        ok &= ParseCopy(jsonOnly, jsonOnly.size(), chunks) == kOK && chunks.Bin == nullptr && chunks.BinSize == 0;
+
+        vector<uint8_t> padded(glb);
+        padded.insert(padded.end(), 16, 0xcd);
+        ok &= ParseCopy(padded, padded.size(), chunks) == kOK && chunks.BinSize == 12;
+
+        // Unknown chunks after the JSON are skipped
+        vector<uint8_t> extra = MakeGLB(json, bin, false);
+        AppendChunk(extra, "XTRA", vector<uint8_t>(8, 0xab));
+        AppendChunk(extra, "BIN\0", bin);
+        uint32_t length = (uint32_t)extra.size();
+        memcpy(extra.data() + 8, &length, 4);
+        ok &= ParseCopy(extra, extra.size(), chunks) == kOK && chunks.BinSize == bin.size() && chunks.Bin[0] == 0;
+
+        passed &= Report("GLB chunks", ok);
+    }
+
+    {
+        GLBChunks chunks;
+        vector<uint8_t> badMagic(glb);
+        badMagic[0] = 'G';
+        vector<uint8_t> version1 = MakeGLB(json, bin, true, 1);
+        vector<uint8_t> binFirst;
+        binFirst.insert(binFirst.end(), { 'g', 'l', 'T', 'F' });
+        AppendU32(binFirst, 2);
+        AppendU32(binFirst, 12 + 8 + 12);
+        AppendChunk(binFirst, "BIN\0", vector<uint8_t>(12, 0));
+        vector<uint8_t> longLength(glb);
+        longLength[8] += 4;
+        vector<uint8_t> longChunk(glb);
+        longChunk[12] += 200;
+        vector<uint8_t> noChunks(glb.begin(), glb.begin() + 12);
+        noChunks[8] = 12;
+        noChunks[9] = noChunks[10] = noChunks[11] = 0;
+
+        bool ok = ParseCopy(badMagic, badMagic.size(), chunks) == kNotGLB &&
+            ParseCopy(version1, version1.size(), chunks) == kWrongVersion &&
+            ParseCopy(binFirst, binFirst.size(), chunks) == kMissingJSON &&
+            ParseCopy(longLength, longLength.size(), chunks) == kTruncated &&
+            ParseCopy(longChunk, longChunk.size(), chunks) == kTruncated &&
+            ParseCopy(noChunks, noChunks.size(), chunks) == kMissingJSON;
+
+        // Every truncation of the file is rejected, none is read past its end
+        for (size_t size = 0; size < glb.size(); ++size)
+            ok &= ParseCopy(glb, size, chunks) != kOK;
+
+        passed &= Report("malformed GLB", ok);
+    }
+
+    // Random corruption may still parse, but nothing handed out lies outside the file
+    {
+        uniform_int_distribution<size_t> position(0, glb.size() - 1);
+        uniform_int_distribution<uint32_t> byteValue(0, 255);
+        uint32_t numParsed = 0;
+        for (uint32_t i = 0; i < fuzzIterations; ++i)
+        {
+            vector<uint8_t> corrupt(glb);
+            uint32_t numChanges = 1 + i % 4;
+            for (uint32_t c = 0; c < numChanges; ++c)
+                corrupt[position(rng)] = (uint8_t)byteValue(rng);
+
+            GLBChunks chunks;
+            if (ParseCopy(corrupt, corrupt.size(), chunks) == kOK)
+                ++numParsed;
+        }
+        printf("    %u of %u corrupted files still parsed\n", numParsed, fuzzIterations);
+        passed &= Report("corrupted GLB", true);
+    }
+
+    // Percent-decoding
+    {
+        string decoded;
+        bool ok = DecodeURI("textures/base%20color.png", decoded) && decoded == "textures/base color.png";
+        ok &= DecodeURI("a%2Fb%2fc%25d", decoded) && decoded == "a/b/c%d";
+        ok &= DecodeURI("caf%C3%A9.bin", decoded) && decoded == "caf\xC3\xA9.bin";
+        ok &= DecodeURI("plain+name.bin", decoded) && decoded == "plain+name.bin";
+        ok &= DecodeURI("", decoded) && decoded.empty();
+        ok &= !DecodeURI("100%", decoded) && !DecodeURI("bad%2", decoded) && !DecodeURI("bad%G0", decoded) &&
+            !DecodeURI("nul%00", decoded) && !DecodeURI("%%41", decoded);
+        passed &= Report("URI decoding", ok);
+    }
+
+    // Base64 and data URIs
+    {
+        bool ok = DecodesTo("SGVsbG8=", "Hello") && DecodesTo("SGVsbG8", "Hello") && DecodesTo("SGVsbA==", "Hell") &&
+            DecodesTo("SGVsbA", "Hell") && DecodesTo("SGVs", "Hel") && DecodesTo("", "") &&
+            DecodesTo("SGVs\r\nbG8=", "Hello") && DecodesTo("-_-_", "\xfb\xff\xbf");
+        ok &= Rejects("S") && Rejects("SGVsb") && Rejects("SGV*") && Rejects("SGVsbG8==") && Rejects("SG=VsbG8") &&
+            Rejects("SGVs=") && Rejects("SGVsbA=");
+
+        for (uint32_t length = 0; length < 70; ++length)
+        {
+            vector<uint8_t> data(length), decoded;
+            for (uint8_t& b : data)
+                b = (uint8_t)rng();
+            for (int pad = 0; pad < 2; ++pad)
+            {
+                string text = EncodeBase64(data, pad != 0);
+                ok &= DecodeBase64(text.data(), text.size(), decoded) && decoded == data;
+            }
+        }
+
+        vector<uint8_t> data;
+        string mediaType;
+        ok &= DecodeDataURI("data:application/octet-stream;base64,AAEC", data, &mediaType) &&
+            data == vector<uint8_t>({ 0, 1, 2 }) && mediaType == "application/octet-stream";
+        ok &= DecodeDataURI("data:;base64,/w==", data, &mediaType) && data == vector<uint8_t>(1, 0xff) && mediaType.empty();
+        ok &= IsDataURI("data:,") && !IsDataURI("buffer.bin") && !IsDataURI("dat");
+        ok &= !DecodeDataURI("data:text/plain,hello", data) && !DecodeDataURI("data:base64,AAEC", data) &&
+            !DecodeDataURI("data:application/octet-stream;base64", data) &&
+            !DecodeDataURI("data:application/octet-stream;base64,AA*C", data) && !DecodeDataURI("buffer.bin", data);
+
+        passed &= Report("base64 data URIs", ok);
+    }
+
+    // Element sizes, including the column padding of small matrices
+    {
+        bool ok = GetElementSize(6, 2) == 12 && GetElementSize(1, 2) == 3 && GetElementSize(3, 0) == 2 &&
+            GetElementSize(1, 4) == 8 && GetElementSize(1, 5) == 12 && GetElementSize(2, 5) == 24 &&
+            GetElementSize(3, 4) == 8 && GetElementSize(6, 6) == 64 && GetElementSize(6, 5) == 36 &&
+            GetElementSize(4, 0) == 0 && GetElementSize(7, 0) == 0 && GetElementSize(6, 7) == 0;
+        passed &= Report("element sizes", ok);
+    }
+
+    // Accessors in place and their bounds
+    {
+        TestBuffers t(64);
+        uint32_t packed = t.AddView(0, 64);
+        uint32_t strided = t.AddView(4, 60, 16);
+        uint32_t tail = t.AddView(60, 4);
+        uint32_t pastEnd = t.AddView(32, 33);
+        uint32_t hugeOffset = t.AddView(~0ull - 8, 16);
+        uint32_t badBuffer = t.AddView(0, 4, 0, 1);
+        uint32_t stride2 = t.AddView(0, 64, 2);
+        uint32_t stride14 = t.AddView(0, 64, 14);
+        uint32_t stride256 = t.AddView(0, 64, 256);
+
+        vector<uint8_t> storage;
+        ResolvedAccessor result;
+        AccessorDesc desc = MakeAccessor(packed, 16, 4, 6, 2);
+        bool ok = t.Resolve(desc, storage, result) == kOK && result.Data == t.bytes.data() + 16 &&
+            result.Stride == 0 && storage.empty();
+        TouchAccessor(result, desc);
+
+        // The last element only needs its own size: 4 + 3 * 16 + 12 = 64
+        desc = MakeAccessor(strided, 0, 4, 6, 2);
+        ok &= t.Resolve(desc, storage, result) == kOK && result.Stride == 16 && result.Data == t.bytes.data() + 4;
+        TouchAccessor(result, desc);
+        desc.Count = 5;
+        ok &= t.Resolve(desc, storage, result) == kTruncated;
+        desc = MakeAccessor(strided, 4, 4, 6, 2);
+        ok &= t.Resolve(desc, storage, result) == kTruncated;
+
+        ok &= t.Resolve(MakeAccessor(tail, 0, 1, 6, 0), storage, result) == kOK;
+        ok &= t.Resolve(MakeAccessor(tail, 0, 2, 6, 0), storage, result) == kTruncated;
+        ok &= t.Resolve(MakeAccessor(tail, 4, 0, 6, 0), storage, result) == kOK;
+        ok &= t.Resolve(MakeAccessor(tail, 5, 0, 6, 0), storage, result) == kTruncated;
+        ok &= t.Resolve(MakeAccessor(packed, ~0ull - 2, 1, 6, 0), storage, result) == kTruncated;
+        ok &= t.Resolve(MakeAccessor(packed, 0, 0xffffffffu, 6, 6), storage, result) == kTruncated;
+        ok &= t.Resolve(MakeAccessor(pastEnd, 0, 1, 1, 0), storage, result) == kTruncated;
+        ok &= t.Resolve(MakeAccessor(hugeOffset, 0, 1, 1, 0), storage, result) == kTruncated;
+        ok &= t.Resolve(MakeAccessor(badBuffer, 0, 1, 1, 0), storage, result) == kBadIndex;
+        ok &= t.Resolve(MakeAccessor(99, 0, 1, 1, 0), storage, result) == kBadIndex;
+        ok &= t.Resolve(MakeAccessor(stride2, 0, 2, 6, 2), storage, result) == kBadStride;
+        ok &= t.Resolve(MakeAccessor(stride14, 0, 2, 6, 2), storage, result) == kBadStride;
+        ok &= t.Resolve(MakeAccessor(stride256, 0, 1, 6, 0), storage, result) == kBadStride;
+        ok &= t.Resolve(MakeAccessor(packed, 0, 1, 4, 0), storage, result) == kBadComponentType;
+        ok &= t.Resolve(MakeAccessor(packed, 0, 1, 6, 7), storage, result) == kBadType;
+
+        // A ubyte MAT3 takes 12 bytes, so five of them fill 60 bytes
+        ok &= t.Resolve(MakeAccessor(packed, 4, 5, 1, 5), storage, result) == kOK;
+        ok &= t.Resolve(MakeAccessor(packed, 5, 5, 1, 5), storage, result) == kTruncated;
+
+        passed &= Report("accessor bounds", ok);
+    }
+
+    // Accessors without a buffer view and sparse accessors are expanded
+    {
+        TestBuffers t(48);
+        float base[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+        memcpy(t.bytes.data(), base, sizeof(base));
+        uint16_t indices[4] = { 1, 5, 5, 1 };
+        memcpy(t.bytes.data() + 32, indices, sizeof(indices));
+        float values[2] = { 10, 50 };
+        memcpy(t.bytes.data() + 40, values, sizeof(values));
+
+        uint32_t baseView = t.AddView(0, 32);
+        uint32_t stridedBase = t.AddView(0, 32, 8);
+        uint32_t indexView = t.AddView(32, 8);
+        uint32_t valueView = t.AddView(40, 8);
+
+        auto makeSparse = [&](int32_t view, uint32_t count, uint32_t sparseCount, uint64_t indicesOffset)
+        {
+            AccessorDesc desc = MakeAccessor(view, 0, count, 6, 0);
+            desc.Sparse.Count = sparseCount;
+            desc.Sparse.IndicesView = indexView;
+            desc.Sparse.IndicesOffset = indicesOffset;
+            desc.Sparse.IndicesComponentType = 3;
+            desc.Sparse.ValuesView = valueView;
+            return desc;
+        };
+
+        vector<uint8_t> storage;
+        ResolvedAccessor result;
+        bool ok = t.Resolve(makeSparse(baseView, 8, 2, 0), storage, result) == kOK && result.Stride == 0 &&
+            result.Data == storage.data() && storage.size() == 32;
+        const float expected[8] = { 0, 10, 2, 3, 4, 50, 6, 7 };
+        ok &= memcmp(result.Data, expected, sizeof(expected)) == 0 && memcmp(t.bytes.data(), base, sizeof(base)) == 0;
+
+        // A strided base is packed while it is expanded
+        ok &= t.Resolve(makeSparse(stridedBase, 4, 1, 0), storage, result) == kOK && result.Stride == 0;
+        const float expectedStrided[4] = { 0, 10, 4, 6 };
+        ok &= memcmp(result.Data, expectedStrided, sizeof(expectedStrided)) == 0;
+
+        ok &= t.Resolve(makeSparse(-1, 6, 2, 0), storage, result) == kOK;
+        const float expectedZeros[6] = { 0, 10, 0, 0, 0, 50 };
+        ok &= memcmp(result.Data, expectedZeros, sizeof(expectedZeros)) == 0;
+
+        ok &= t.Resolve(MakeAccessor(-1, 0, 3, 6, 2), storage, result) == kOK && storage.size() == 36 &&
+            count(storage.begin(), storage.end(), 0) == 36;
+        ok &= t.Resolve(MakeAccessor(-1, 0, 0, 6, 2), storage, result) == kOK && result.Data == nullptr;
+
+        // Indices must be increasing and in range, and fit in their view
+        storage.assign(4, 0xee);
+        ok &= t.Resolve(makeSparse(baseView, 8, 2, 4), storage, result) == kBadSparseIndices && storage.size() == 4;
+        ok &= t.Resolve(makeSparse(baseView, 8, 2, 2), storage, result) == kBadSparseIndices;
+        ok &= t.Resolve(makeSparse(baseView, 5, 2, 0), storage, result) == kBadSparseIndices;
+        ok &= t.Resolve(makeSparse(baseView, 1, 2, 0), storage, result) == kBadSparseIndices;
+        ok &= t.Resolve(makeSparse(baseView, 8, 3, 0), storage, result) == kTruncated;
+        AccessorDesc badType = makeSparse(baseView, 8, 2, 0);
+        badType.Sparse.IndicesComponentType = 6;
+        ok &= t.Resolve(badType, storage, result) == kBadComponentType;
+        AccessorDesc badView = makeSparse(baseView, 8, 2, 0);
+        badView.Sparse.ValuesView = 17;
+        ok &= t.Resolve(badView, storage, result) == kBadIndex;
+
+        passed &= Report("sparse accessors", ok);
+    }
+
+    // Random accessors against a small buffer: whatever resolves must stay inside it
+    {
+        TestBuffers t(256);
+        uniform_int_distribution<uint32_t> small(0, 80);
+        for (int v = 0; v < 16; ++v)
+            t.AddView(small(rng), small(rng) * 3, (v % 4) * (4 + small(rng) % 8), v == 15 ? 1 : 0);
+
+        uint32_t numResolved = 0;
+        uint32_t sum = 0;
+        for (uint32_t i = 0; i < fuzzIterations; ++i)
+        {
+            AccessorDesc desc = MakeAccessor((int32_t)(rng() % 18) - 1, small(rng), small(rng), rng() % 8, rng() % 8);
+            if (rng() % 3 == 0)
+            {
+                desc.Sparse.Count = rng() % 6;
+                desc.Sparse.IndicesView = rng() % 17;
+                desc.Sparse.IndicesOffset = small(rng);
+                desc.Sparse.IndicesComponentType = rng() % 7;
+                desc.Sparse.ValuesView = rng() % 17;
+                desc.Sparse.ValuesOffset = small(rng);
+            }
+
+            vector<uint8_t> storage;
+            ResolvedAccessor result;
+            if (t.Resolve(desc, storage, result) == kOK)
+            {
+                sum += TouchAccessor(result, desc);
+                ++numResolved;
+            }
+        }
+        printf("    %u of %u random accessors resolved (checksum %u)\n", numResolved, fuzzIterations, sum);
+        passed &= Report("random accessors", true);
+    }
+
+    // Skins and animations read as many elements as they expect from their accessors
+    {
+        bool ok = CheckInverseBindMatrices(6, 6, 3, 3) == kOK && CheckInverseBindMatrices(6, 6, 4, 3) == kOK &&
+            CheckInverseBindMatrices(6, 6, 0, 0) == kOK;
+        ok &= CheckInverseBindMatrices(6, 6, 2, 3) == kBadCount;
+        ok &= CheckInverseBindMatrices(5, 6, 3, 3) == kBadComponentType;
+        ok &= CheckInverseBindMatrices(6, 5, 3, 3) == kBadType;
+        passed &= Report("inverse bind matrices", ok);
+
+        // Four key frames of two morph weights each, with tangents for the cubic spline
+        ok = CheckAnimationSampler(6, 0, 4, 4, false) == kOK && CheckAnimationSampler(6, 0, 4, 8, false) == kOK &&
+            CheckAnimationSampler(6, 0, 4, 12, true) == kOK && CheckAnimationSampler(6, 0, 4, 24, true) == kOK;
+        ok &= CheckAnimationSampler(6, 0, 4, 3, false) == kBadCount;
+        ok &= CheckAnimationSampler(6, 0, 4, 6, false) == kBadCount;
+        ok &= CheckAnimationSampler(6, 0, 4, 4, true) == kBadCount;
+        ok &= CheckAnimationSampler(6, 0, 4, 0, false) == kBadCount;
+        ok &= CheckAnimationSampler(6, 0, 0, 0, false) == kBadCount && CheckAnimationSampler(6, 0, 0, 4, false) == kBadCount;
+        ok &= CheckAnimationSampler(6, 0, 0x80000000u, 0x80000000u, true) == kBadCount;
+        ok &= CheckAnimationSampler(5, 0, 4, 4, false) == kBadComponentType;
+        ok &= CheckAnimationSampler(6, 1, 4, 4, false) == kBadType;
+        passed &= Report("animation samplers", ok);
+    }
+
+    // The parallel index scan matches a single thread for every index size and stride
+    {
+        bool ok = true;
+        const uint32_t componentTypes[3] = { 1, 3, 5 };
+        double serialMs = 0.0, parallelMs = 0.0;
+        for (uint32_t componentType : componentTypes)
+        {
+            uint32_t componentSize = GetComponentSize(componentType);
+            for (uint32_t stride : { componentSize, 8u })
+            {
+                vector<uint8_t> data((size_t)indexCount * stride);
+                for (uint8_t& b : data)
+                    b = (uint8_t)(rng() & 0x7f);
+                data[(size_t)(indexCount - 1) * stride] = 0xfe;
+                uint32_t expected = ScalarMaxIndex(data, stride, componentSize, indexCount);
+
+                uint32_t maxIndex = 0;
+                ok &= FindMaxIndex(data.data(), stride == componentSize ? 0 : stride, componentType, indexCount, maxIndex, 1) && maxIndex == expected;
+
+                auto start = chrono::high_resolution_clock::now();
+                ok &= FindMaxIndex(data.data(), stride, componentType, indexCount, maxIndex, 1) && maxIndex == expected;
+                auto middle = chrono::high_resolution_clock::now();
+                ok &= FindMaxIndex(data.data(), stride, componentType, indexCount, maxIndex, 8) && maxIndex == expected;
+                auto end = chrono::high_resolution_clock::now();
+                ok &= FindMaxIndex(data.data(), stride, componentType, indexCount, maxIndex) && maxIndex == expected;
+
+                serialMs += chrono::duration<double, milli>(middle - start).count();
+                parallelMs += chrono::duration<double, milli>(end - middle).count();
+            }
+        }
+
+        uint32_t maxIndex = 1;
+        uint8_t empty = 0;
+        ok &= FindMaxIndex(&empty, 0, 5, 0, maxIndex) && maxIndex == 0;
+        ok &= !FindMaxIndex(&empty, 0, 6, 1, maxIndex) && !FindMaxIndex(&empty, 0, 0, 1, maxIndex);
+
+        printf("    %u indices x 6 layouts: %.2f ms on one thread, %.2f ms on up to eight\n", indexCount, serialMs, parallelMs);
+        passed &= Report("index scan", ok);
+    }
+
+    return passed ? 0 : 1;
+}
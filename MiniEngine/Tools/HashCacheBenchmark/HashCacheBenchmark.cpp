@@ -0,0 +1,362 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+//
+// Stress tests Utility::HashCache and compares it with the mutex protected std::map it replaced
+// in PipelineState.cpp and RootSignature.cpp, e.g.
+//
+//     HashCacheBenchmark -threads 8 -keys 1000 -build_us 100
+//
+// A shared_ptr stands in for the ComPtr of a compiled PSO, and building one busy-waits for a
+// while like a pipeline compile would.
+//
+
+#include "../../Core/HashCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    struct Object
+    {
+        size_t Hash;
+        uint32_t Builder;
+    };
+
+    typedef shared_ptr<Object> ObjectRef;
+    typedef Utility::HashCache<ObjectRef> Cache;
+
+    // The find-or-reserve pattern the PSO and root signature caches used before
+    class ReferenceCache
+    {
+    public:
+        template <typename CreateFunction>
+        const ObjectRef& GetOrCreate(size_t hash, CreateFunction create)
+        {
+            ObjectRef* ref = nullptr;
+            bool firstCompile = false;
+            {
+                lock_guard<mutex> lock(m_Mutex);
+                auto iter = m_Map.find(hash);
+                if (iter == m_Map.end())
+                {
+                    firstCompile = true;
+                    ref = &m_Map[hash];
+                }
+                else
+                    ref = &iter->second;
+            }
+
+            if (firstCompile)
+            {
+                ObjectRef object = create();
+                lock_guard<mutex> lock(m_Mutex);
+                *ref = object;
+            }
+            else
+            {
+                // Unsynchronized in the original as well
+                while (*(ObjectRef* volatile)ref == nullptr)
+                {
+                    ++m_NumYields;
+                    this_thread::yield();
+                }
+            }
+            return *ref;
+        }
+
+        size_t GetNumYields() const { return m_NumYields; }
+
+    private:
+        mutex m_Mutex;
+        map<size_t, ObjectRef> m_Map;
+        atomic<size_t> m_NumYields{ 0 };
+    };
+
+    void BusyWait(uint32_t microseconds)
+    {
+        auto end = chrono::high_resolution_clock::now() + chrono::microseconds(microseconds);
+        while (chrono::high_resolution_clock::now() < end)
+            ;
+    }
+
+    // Hashes that share their low bits, so that home slots collide and runs overflow
+    vector<size_t> MakeKeys(uint32_t count, uint32_t seed, bool colliding)
+    {
+        mt19937_64 rng(seed);
+        vector<size_t> keys(count);
+        for (uint32_t i = 0; i < count; ++i)
+            keys[i] = colliding ? ((size_t)i << 24 | 0x5A5A) : (size_t)rng();
+        return keys;
+    }
+
+    bool Report(const char* name, bool passed)
+    {
+        printf("%s %s\n", passed ? "Passed" : "FAILED", name);
+        return passed;
+    }
+
+    bool CheckSingleThread()
+    {
+        Cache cache(16);
+        vector<size_t> keys = MakeKeys(5000, 1, false);
+        keys.push_back(0);
+
+        uint32_t numCreated = 0;
+        bool passed = true;
+        for (size_t key : keys)
+        {
+            const ObjectRef& ref = cache.GetOrCreate(key, [&]() { ++numCreated; return make_shared<Object>(Object{ key, 0 }); });
+            passed &= ref != nullptr && ref->Hash == key;
+        }
+
+        // A second pass finds everything without building
+        for (size_t key : keys)
+        {
+            const ObjectRef& ref = cache.GetOrCreate(key, [&]() { ++numCreated; return ObjectRef(); });
+            const ObjectRef* found = cache.Find(key);
+            passed &= ref != nullptr && ref->Hash == key && found == &ref;
+        }
+
+        passed &= numCreated == keys.size() && cache.GetSize() == keys.size() && cache.GetNumTables() > 1;
+        passed &= cache.Find(0x1234567) == nullptr;
+
+        printf("  %zu entries in %zu tables\n", cache.GetSize(), cache.GetNumTables());
+        passed &= Report("single thread fill, find and growth", passed);
+
+        cache.Clear();
+        bool cleared = cache.GetSize() == 0 && cache.GetNumTables() == 1 && cache.Find(keys[0]) == nullptr;
+        const ObjectRef& ref = cache.GetOrCreate(keys[0], [&]() { return make_shared<Object>(Object{ keys[0], 1 }); });
+        cleared &= ref->Builder == 1 && cache.GetSize() == 1;
+        return Report("clear and rebuild", cleared) && passed;
+    }
+
+    // A second thread asking for a hash that is still being built must sleep, then see the
+    // first thread's result
+    bool CheckInFlight()
+    {
+        Cache cache;
+        atomic<bool> release(false);
+        atomic<uint32_t> numCreated(0);
+        const ObjectRef* results[2] = {};
+
+        auto create = [&]()
+        {
+            ++numCreated;
+            while (!release)
+                this_thread::yield();
+            return make_shared<Object>(Object{ 7, 0 });
+        };
+
+        thread builder([&]() { results[0] = &cache.GetOrCreate(7, create); });
+        while (cache.GetSize() == 0)
+            this_thread::yield();
+
+        bool passed = cache.Find(7) == nullptr;
+
+        thread waiter([&]() { results[1] = &cache.GetOrCreate(7, create); });
+        auto timeout = chrono::steady_clock::now() + chrono::seconds(10);
+        while (cache.GetNumWaits() == 0 && chrono::steady_clock::now() < timeout)
+            this_thread::yield();
+
+        passed &= cache.GetNumWaits() == 1;
+        release = true;
+        builder.join();
+        waiter.join();
+
+        passed &= numCreated == 1 && results[0] == results[1] && cache.Find(7) == results[0];
+        return Report("waiting on an in-flight build", passed);
+    }
+
+    // Every thread asks for every key in its own order. Each key must be built exactly once and
+    // every thread must get the same entry.
+    bool CheckContention(uint32_t numThreads, const vector<size_t>& keys, const char* name)
+    {
+        Cache cache(16);
+        vector<atomic<uint32_t>> numCreated(keys.size());
+        for (atomic<uint32_t>& n : numCreated)
+            n = 0;
+        vector<vector<const ObjectRef*>> results(numThreads, vector<const ObjectRef*>(keys.size()));
+
+        vector<thread> threads;
+        for (uint32_t t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&, t]()
+            {
+                vector<uint32_t> order(keys.size());
+                for (uint32_t i = 0; i < order.size(); ++i)
+                    order[i] = i;
+                shuffle(order.begin(), order.end(), mt19937(t));
+
+                for (uint32_t i : order)
+                {
+                    results[t][i] = &cache.GetOrCreate(keys[i], [&]()
+                    {
+                        ++numCreated[i];
+                        BusyWait(i % 8 == 0 ? 20 : 0);
+                        return make_shared<Object>(Object{ keys[i], t });
+                    });
+                }
+            });
+        }
+        for (thread& t : threads)
+            t.join();
+
+        bool passed = cache.GetSize() == keys.size();
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            passed &= numCreated[i] == 1 && *results[0][i] != nullptr && (*results[0][i])->Hash == keys[i];
+            for (uint32_t t = 1; t < numThreads; ++t)
+                passed &= results[t][i] == results[0][i];
+        }
+
+        printf("  %zu keys, %u threads, %zu tables, %zu waits\n", keys.size(), numThreads,
+            cache.GetNumTables(), cache.GetNumWaits());
+        return Report(name, passed);
+    }
+
+    template <typename CacheType>
+    double TimeBuilds(CacheType& cache, uint32_t numThreads, const vector<size_t>& keys, uint32_t buildMicroseconds)
+    {
+        auto start = chrono::high_resolution_clock::now();
+
+        vector<thread> threads;
+        for (uint32_t t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&, t]()
+            {
+                vector<size_t> order = keys;
+                shuffle(order.begin(), order.end(), mt19937(t));
+                for (size_t key : order)
+                {
+                    cache.GetOrCreate(key, [&]()
+                    {
+                        BusyWait(buildMicroseconds);
+                        return make_shared<Object>(Object{ key, t });
+                    });
+                }
+            });
+        }
+        for (thread& t : threads)
+            t.join();
+
+        return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    }
+
+    template <typename CacheType>
+    double TimeLookups(CacheType& cache, uint32_t numThreads, const vector<size_t>& keys, uint32_t numLookups)
+    {
+        auto start = chrono::high_resolution_clock::now();
+
+        vector<thread> threads;
+        atomic<size_t> checksum(0);
+        for (uint32_t t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&, t]()
+            {
+                mt19937 rng(t);
+                size_t sum = 0;
+                for (uint32_t i = 0; i < numLookups; ++i)
+                {
+                    size_t key = keys[rng() % keys.size()];
+                    sum += cache.GetOrCreate(key, []() { return ObjectRef(); })->Hash;
+                }
+                checksum += sum;
+            });
+        }
+        for (thread& t : threads)
+            t.join();
+
+        return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numThreads = max(thread::hardware_concurrency(), 1u);
+    uint32_t numKeys = 1000;
+    uint32_t numLookups = 1000000;
+    uint32_t buildMicroseconds = 100;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (arg + 1 < argc && strcmp("-threads", argv[arg]) == 0)
+            numThreads = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-keys", argv[arg]) == 0)
+            numKeys = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-lookups", argv[arg]) == 0)
+            numLookups = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-build_us", argv[arg]) == 0)
+            buildMicroseconds = max(atoi(argv[++arg]), 0);
+        else
+        {
+            printf(
+                "Usage:  %s [options]*\n\n"
+                "Options:\n\n"
+                "-threads <integer>\n\tThreads finalizing PSOs at once.\n\tDefaults to every hardware thread.\n"
+                "-keys <integer>\n\tDistinct pipeline states.\n\tDefaults to 1000.\n"
+                "-lookups <integer>\n\tLookups per thread once every state is built.\n\tDefaults to 1000000.\n"
+                "-build_us <integer>\n\tTime to build one state, in microseconds.\n\tDefaults to 100.\n\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    bool passed = true;
+    passed &= CheckSingleThread();
+    passed &= CheckInFlight();
+    for (uint32_t threads : { 2u, 8u, 32u })
+    {
+        passed &= CheckContention(threads, MakeKeys(4000, 2, false), "contention");
+        passed &= CheckContention(threads, MakeKeys(2000, 3, true), "contention with colliding hashes");
+    }
+
+    vector<size_t> keys = MakeKeys(numKeys, 4, false);
+    printf("\n%u states, %u threads, %u us per build:\n", numKeys, numThreads, buildMicroseconds);
+
+    ReferenceCache referenceCache;
+    Cache cache;
+
+    double referenceMs = TimeBuilds(referenceCache, numThreads, keys, buildMicroseconds);
+    double cacheMs = TimeBuilds(cache, numThreads, keys, buildMicroseconds);
+    printf("%-20s %10.3f ms (%zu yields)\n", "map build", referenceMs, referenceCache.GetNumYields());
+    printf("%-20s %10.3f ms (%zu waits)\n", "HashCache build", cacheMs, cache.GetNumWaits());
+
+    referenceMs = TimeLookups(referenceCache, numThreads, keys, numLookups);
+    cacheMs = TimeLookups(cache, numThreads, keys, numLookups);
+    const double totalLookups = (double)numLookups * numThreads;
+    printf("%-20s %10.3f ms (%.1f M lookups/s)\n", "map lookups", referenceMs, totalLookups / referenceMs * 1e-3);
+    printf("%-20s %10.3f ms (%.1f M lookups/s)\n", "HashCache lookups", cacheMs, totalLookups / cacheMs * 1e-3);
+
+    return passed ? 0 : 1;
+}
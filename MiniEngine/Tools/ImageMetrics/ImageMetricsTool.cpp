@@ -0,0 +1,230 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+//
+// Command line front end for ImageMetrics. Compares two PNG files and prints the same
+// metrics VRSTest records, e.g.
+//
+//     ImageMetrics Control.png XeSSQualityValarOff.png -diff XeSSQualityValarOff-diff.png
+//
+
+#include "../../Core/ImageMetrics.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "zlib.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "../../Core/Util/stb_image_write.h"
+
+using namespace std;
+
+namespace
+{
+    uint32_t ReadBigEndian(const uint8_t* p)
+    {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+
+    uint8_t PaethPredictor(int a, int b, int c)
+    {
+        int p = a + b - c;
+        int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+        if (pa <= pb && pa <= pc)
+            return (uint8_t)a;
+        return (uint8_t)(pb <= pc ? b : c);
+    }
+
+    // Minimal PNG reader covering what stb_image_write and most capture tools produce:
+    // non-interlaced, 8 bits per channel, gray, gray+alpha, RGB or RGBA. Output is RGBA.
+    void LoadPNG(const char* filename, uint32_t& width, uint32_t& height, vector<uint8_t>& rgba)
+    {
+        ifstream file(filename, ios::in | ios::binary);
+        if (!file)
+            throw runtime_error(string("Unable to open ") + filename);
+
+        vector<uint8_t> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+        static const uint8_t kSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        if (data.size() < 8 || memcmp(data.data(), kSignature, 8) != 0)
+            throw runtime_error(string(filename) + " is not a PNG file");
+
+        uint32_t bitDepth = 0, colorType = 0, interlace = 0;
+        vector<uint8_t> compressed;
+        width = height = 0;
+
+        for (size_t offset = 8; offset + 12 <= data.size(); )
+        {
+            uint32_t length = ReadBigEndian(&data[offset]);
+            const uint8_t* type = &data[offset + 4];
+            const uint8_t* payload = &data[offset + 8];
+
+            if (offset + 12 + (size_t)length > data.size())
+                throw runtime_error(string(filename) + " is truncated");
+
+            if (memcmp(type, "IHDR", 4) == 0 && length >= 13)
+            {
+                width = ReadBigEndian(payload);
+                height = ReadBigEndian(payload + 4);
+                bitDepth = payload[8];
+                colorType = payload[9];
+                interlace = payload[12];
+            }
+            else if (memcmp(type, "IDAT", 4) == 0)
+                compressed.insert(compressed.end(), payload, payload + length);
+            else if (memcmp(type, "IEND", 4) == 0)
+                break;
+
+            offset += 12 + (size_t)length;
+        }
+
+        uint32_t channels = 0;
+        switch (colorType)
+        {
+        case 0: channels = 1; break;
+        case 2: channels = 3; break;
+        case 4: channels = 2; break;
+        case 6: channels = 4; break;
+        }
+
+        if (width == 0 || height == 0 || bitDepth != 8 || channels == 0 || interlace != 0)
+            throw runtime_error(string(filename) + " uses an unsupported PNG format");
+
+        const size_t stride = (size_t)width * channels;
+        vector<uint8_t> raw((stride + 1) * height);
+        uLongf rawSize = (uLongf)raw.size();
+        if (uncompress(raw.data(), &rawSize, compressed.data(), (uLong)compressed.size()) != Z_OK || rawSize != raw.size())
+            throw runtime_error(string(filename) + " has corrupt image data");
+
+        // Undo the per-scanline filters in place
+        vector<uint8_t> zeroRow(stride, 0);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            uint8_t* line = &raw[y * (stride + 1)];
+            uint8_t filter = line[0];
+            uint8_t* cur = line + 1;
+            const uint8_t* prev = y > 0 ? &raw[(y - 1) * (stride + 1) + 1] : zeroRow.data();
+
+            for (size_t i = 0; i < stride; ++i)
+            {
+                int a = i >= channels ? cur[i - channels] : 0;
+                int b = prev[i];
+                int c = i >= channels ? prev[i - channels] : 0;
+
+                switch (filter)
+                {
+                case 0: break;
+                case 1: cur[i] = (uint8_t)(cur[i] + a); break;
+                case 2: cur[i] = (uint8_t)(cur[i] + b); break;
+                case 3: cur[i] = (uint8_t)(cur[i] + ((a + b) >> 1)); break;
+                case 4: cur[i] = (uint8_t)(cur[i] + PaethPredictor(a, b, c)); break;
+                default: throw runtime_error(string(filename) + " has an invalid scanline filter");
+                }
+            }
+        }
+
+        rgba.resize((size_t)width * height * 4);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const uint8_t* src = &raw[y * (stride + 1) + 1];
+            uint8_t* dst = &rgba[(size_t)y * width * 4];
+
+            for (uint32_t x = 0; x < width; ++x, src += channels, dst += 4)
+            {
+                switch (channels)
+                {
+                case 1: dst[0] = dst[1] = dst[2] = src[0]; dst[3] = 255; break;
+                case 2: dst[0] = dst[1] = dst[2] = src[0]; dst[3] = src[1]; break;
+                case 3: dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = 255; break;
+                case 4: memcpy(dst, src, 4); break;
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* diffName = nullptr;
+    uint32_t numThreads = 0;
+
+    if (argc < 3)
+    {
+        printf(
+            "Usage:  %s <reference.png> <test.png> [options]*\n\n"
+            "Options:\n\n"
+            "-diff <filename>\n\tWrites a difference image highlighting changed pixels.\n"
+            "-threads <integer>\n\tNumber of worker threads.\n\tDefaults to every hardware thread.\n\n",
+            argv[0]);
+        return 1;
+    }
+
+    for (int arg = 3; arg < argc; ++arg)
+    {
+        if (arg + 1 < argc && strcmp("-diff", argv[arg]) == 0)
+            diffName = argv[++arg];
+        else if (arg + 1 < argc && strcmp("-threads", argv[arg]) == 0)
+            numThreads = (uint32_t)atoi(argv[++arg]);
+        else
+        {
+            printf("Invalid option: %s\n", argv[arg]);
+            return 1;
+        }
+    }
+
+    try
+    {
+        uint32_t refWidth, refHeight, testWidth, testHeight;
+        vector<uint8_t> refPixels, testPixels;
+        LoadPNG(argv[1], refWidth, refHeight, refPixels);
+        LoadPNG(argv[2], testWidth, testHeight, testPixels);
+
+        ImageMetrics::Image reference = { refPixels.data(), refWidth, refHeight, refWidth * 4 };
+        ImageMetrics::Image test = { testPixels.data(), testWidth, testHeight, testWidth * 4 };
+
+        ImageMetrics::Results results;
+        vector<uint8_t> diff;
+
+        auto start = chrono::high_resolution_clock::now();
+        if (!ImageMetrics::Compare(reference, test, results, diffName ? &diff : nullptr, numThreads))
+            throw runtime_error("Images must have the same dimensions");
+        auto end = chrono::high_resolution_clock::now();
+
+        printf("%s", ImageMetrics::ToString(results).c_str());
+        printf("Elapsed: %.3f ms\n", chrono::duration<double, milli>(end - start).count());
+
+        if (diffName != nullptr && stbi_write_png(diffName, refWidth, refHeight, 4, diff.data(), refWidth * 4) == 0)
+            throw runtime_error(string("Unable to write ") + diffName);
+    }
+    catch (exception& e)
+    {
+        printf("Failed: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,312 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+//
+// Checks ImageMetrics against synthetic images, e.g.
+//
+//     ImageMetricsCheck -seed 1
+//
+// Constant images and single pixel changes have closed form error metrics and SSIM. Random
+// images are compared with a direct, unoptimized evaluation of the same definitions. Results
+// must not depend on the thread count.
+//
+
+#include "../../Core/ImageMetrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const double kSsimC1 = (0.01 * 255.0) * (0.01 * 255.0);
+    const double kSsimC2 = (0.03 * 255.0) * (0.03 * 255.0);
+
+    bool Report(const char* name, bool passed)
+    {
+        printf("%s %s\n", passed ? "Passed" : "FAILED", name);
+        return passed;
+    }
+
+    bool Near(double a, double b, double tolerance = 1e-9)
+    {
+        return fabs(a - b) <= tolerance * max(1.0, fabs(b));
+    }
+
+    struct TestImage
+    {
+        uint32_t Width;
+        uint32_t Height;
+        vector<uint8_t> Pixels;
+
+        TestImage(uint32_t width, uint32_t height, uint8_t value = 0)
+            : Width(width), Height(height), Pixels((size_t)width * height * 4, value)
+        {
+            for (size_t i = 3; i < Pixels.size(); i += 4)
+                Pixels[i] = 255;
+        }
+
+        uint8_t* At(uint32_t x, uint32_t y) { return Pixels.data() + ((size_t)y * Width + x) * 4; }
+        const uint8_t* At(uint32_t x, uint32_t y) const { return Pixels.data() + ((size_t)y * Width + x) * 4; }
+
+        ImageMetrics::Image View() const { return { Pixels.data(), Width, Height, Width * 4 }; }
+    };
+
+    // Smooth color gradients with noise, a stand-in for a rendered frame
+    TestImage MakeScene(mt19937& rng, uint32_t width, uint32_t height, int noise)
+    {
+        TestImage image(width, height);
+        uniform_int_distribution<int> jitter(-noise, noise);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                uint8_t* p = image.At(x, y);
+                int base[3] = { (int)(x * 255 / width), (int)(y * 255 / height), (int)((x + y) * 127 / (width + height)) + 64 };
+                for (int c = 0; c < 3; ++c)
+                    p[c] = (uint8_t)min(max(base[c] + jitter(rng), 0), 255);
+            }
+        }
+        return image;
+    }
+
+    // The same definitions as ImageMetrics, evaluated pixel by pixel
+    void ReferenceMetrics(const TestImage& a, const TestImage& b, ImageMetrics::Results& results)
+    {
+        double sumAbs = 0.0, sumSq = 0.0, maxAbs = 0.0;
+        uint64_t diffPixels = 0;
+        for (uint32_t y = 0; y < a.Height; ++y)
+        {
+            for (uint32_t x = 0; x < a.Width; ++x)
+            {
+                bool differs = false;
+                for (int c = 0; c < 3; ++c)
+                {
+                    double d = fabs((double)a.At(x, y)[c] - b.At(x, y)[c]);
+                    sumAbs += d;
+                    sumSq += d * d;
+                    maxAbs = max(maxAbs, d);
+                    differs |= d != 0.0;
+                }
+                diffPixels += differs ? 1 : 0;
+            }
+        }
+
+        const double numSamples = (double)a.Width * a.Height * 3;
+        results.AE = diffPixels;
+        results.MAE = sumAbs / (numSamples * 255.0);
+        results.MSE = sumSq / (numSamples * 255.0 * 255.0);
+        results.PAE = maxAbs / 255.0;
+        results.PSNR = 10.0 * log10(1.0 / results.MSE);
+
+        // 8x8 windows every 4 pixels over the part of the image covered by whole 4x4 blocks
+        double ssimSum = 0.0;
+        uint32_t numWindows = 0;
+        const uint32_t blockedWidth = a.Width / 4 * 4, blockedHeight = a.Height / 4 * 4;
+        for (uint32_t wy = 0; wy + 8 <= blockedHeight; wy += 4)
+        {
+            for (uint32_t wx = 0; wx + 8 <= blockedWidth; wx += 4)
+            {
+                double ssim = 0.0;
+                for (int c = 0; c < 3; ++c)
+                {
+                    double muA = 0.0, muB = 0.0;
+                    for (uint32_t y = wy; y < wy + 8; ++y)
+                    {
+                        for (uint32_t x = wx; x < wx + 8; ++x)
+                        {
+                            muA += a.At(x, y)[c];
+                            muB += b.At(x, y)[c];
+                        }
+                    }
+                    muA /= 64.0;
+                    muB /= 64.0;
+
+                    double varA = 0.0, varB = 0.0, cov = 0.0;
+                    for (uint32_t y = wy; y < wy + 8; ++y)
+                    {
+                        for (uint32_t x = wx; x < wx + 8; ++x)
+                        {
+                            double da = a.At(x, y)[c] - muA, db = b.At(x, y)[c] - muB;
+                            varA += da * da;
+                            varB += db * db;
+                            cov += da * db;
+                        }
+                    }
+                    varA /= 64.0;
+                    varB /= 64.0;
+                    cov /= 64.0;
+
+                    ssim += ((2.0 * muA * muB + kSsimC1) * (2.0 * cov + kSsimC2)) /
+                        ((muA * muA + muB * muB + kSsimC1) * (varA + varB + kSsimC2));
+                }
+                ssimSum += ssim / 3.0;
+                ++numWindows;
+            }
+        }
+        results.SSIM = ssimSum / numWindows;
+    }
+
+    bool SameResults(const ImageMetrics::Results& a, const ImageMetrics::Results& b)
+    {
+        return a.AE == b.AE && a.MAE == b.MAE && a.MSE == b.MSE && a.PAE == b.PAE && a.NCC == b.NCC &&
+            a.SSIM == b.SSIM && a.PHASH == b.PHASH && a.MEPP == b.MEPP;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (i + 1 < argc && strcmp(argv[i], "-seed") == 0)
+            seed = (uint32_t)atoi(argv[++i]);
+        else
+        {
+            printf("Usage: ImageMetricsCheck [-seed n]\n");
+            return 1;
+        }
+    }
+
+    bool passed = true;
+    mt19937 rng(seed);
+    ImageMetrics::Results results;
+
+    // Identical images
+    {
+        TestImage image = MakeScene(rng, 96, 64, 20);
+        bool ok = ImageMetrics::Compare(image.View(), image.View(), results) && results.AE == 0 && results.MSE == 0.0 &&
+            isinf(results.PSNR) && Near(results.SSIM, 1.0) && Near(results.NCC, 1.0) && results.PHASH == 0 && results.DSSIM < 1e-9;
+        passed &= Report("identical images", ok);
+    }
+
+    // Constant 100 against constant 116: every error is 16 and SSIM reduces to the luminance term
+    {
+        TestImage a(64, 64, 100), b(64, 64, 116);
+        const double d = 16.0 / 255.0;
+        const double ssim = (2.0 * 100 * 116 + kSsimC1) / (100.0 * 100 + 116.0 * 116 + kSsimC1);
+        bool ok = ImageMetrics::Compare(a.View(), b.View(), results) && results.AE == 64 * 64 &&
+            Near(results.MAE, d) && Near(results.MSE, d * d) && Near(results.RMSE, d) && Near(results.PAE, d) &&
+            Near(results.PSNR, 20.0 * log10(255.0 / 16.0)) && Near(results.MEPP, 16.0) && Near(results.SSIM, ssim) &&
+            Near(results.DSSIM, (1.0 - ssim) / 2);
+        printf("    PSNR %.4f dB, SSIM %.6f\n", results.PSNR, results.SSIM);
+        passed &= Report("constant offset", ok);
+    }
+
+    // One channel of one pixel off by 255 in a 32x32 image: MSE = 1 / (1024 * 3)
+    {
+        TestImage a(32, 32, 128), b(32, 32, 128);
+        b.At(17, 9)[1] = 255;
+        a.At(17, 9)[1] = 0;
+        vector<uint8_t> diff;
+        bool ok = ImageMetrics::Compare(a.View(), b.View(), results, &diff) && results.AE == 1 && Near(results.PAE, 1.0) &&
+            Near(results.MSE, 1.0 / 3072.0) && Near(results.PSNR, 10.0 * log10(3072.0)) && diff.size() == a.Pixels.size();
+        const uint8_t* changed = diff.data() + (9 * 32 + 17) * 4;
+        const uint8_t* same = diff.data() + (9 * 32 + 16) * 4;
+        ok &= changed[0] == 255 && changed[1] == 0 && changed[2] == 0 && same[0] == same[1] && same[1] == same[2] && same[0] > 200;
+        passed &= Report("single pixel", ok);
+    }
+
+    // An inverted image is perfectly anti-correlated
+    {
+        TestImage a = MakeScene(rng, 64, 48, 30), b(64, 48);
+        for (size_t i = 0; i < a.Pixels.size(); ++i)
+            b.Pixels[i] = i % 4 == 3 ? 255 : (uint8_t)(255 - a.Pixels[i]);
+        bool ok = ImageMetrics::Compare(a.View(), b.View(), results) && Near(results.NCC, -1.0, 1e-9) && results.SSIM < 0.0;
+        passed &= Report("inverted image", ok);
+    }
+
+    // Noisy copies against the direct evaluation
+    {
+        bool ok = true;
+        const uint32_t sizes[][2] = { { 100, 68 }, { 64, 64 }, { 256, 132 } };
+        for (const auto& size : sizes)
+        {
+            TestImage a = MakeScene(rng, size[0], size[1], 10), b(a);
+            normal_distribution<double> noise(0.0, 6.0);
+            for (size_t i = 0; i < b.Pixels.size(); ++i)
+            {
+                if (i % 4 != 3)
+                    b.Pixels[i] = (uint8_t)min(max((int)lround(b.Pixels[i] + noise(rng)), 0), 255);
+            }
+
+            ImageMetrics::Results expected;
+            ReferenceMetrics(a, b, expected);
+            ok &= ImageMetrics::Compare(a.View(), b.View(), results) && results.AE == expected.AE &&
+                Near(results.MAE, expected.MAE) && Near(results.MSE, expected.MSE) && Near(results.PAE, expected.PAE) &&
+                Near(results.PSNR, expected.PSNR) && Near(results.SSIM, expected.SSIM, 1e-7);
+            printf("    %ux%u: PSNR %.3f dB (expected %.3f), SSIM %.6f (expected %.6f)\n", size[0], size[1],
+                results.PSNR, expected.PSNR, results.SSIM, expected.SSIM);
+        }
+        passed &= Report("noisy images", ok);
+    }
+
+    // A brightness shift barely moves the perceptual hash, a mirror image moves it a lot
+    {
+        TestImage a = MakeScene(rng, 128, 96, 4), brighter(a), mirrored(a);
+        for (uint32_t y = 0; y < a.Height; ++y)
+        {
+            for (uint32_t x = 0; x < a.Width; ++x)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    brighter.At(x, y)[c] = (uint8_t)min(a.At(x, y)[c] + 12, 255);
+                    mirrored.At(x, y)[c] = a.At(a.Width - 1 - x, y)[c];
+                }
+            }
+        }
+
+        ImageMetrics::Results mirrorResults;
+        bool ok = ImageMetrics::Compare(a.View(), brighter.View(), results) &&
+            ImageMetrics::Compare(a.View(), mirrored.View(), mirrorResults) && results.PHASH <= 12 && mirrorResults.PHASH >= 20;
+        printf("    PHASH %u for a brighter copy, %u for a mirror image\n", results.PHASH, mirrorResults.PHASH);
+        passed &= Report("perceptual hash", ok);
+    }
+
+    // Odd sizes, partial bands and every thread count give bit identical results
+    {
+        TestImage a = MakeScene(rng, 257, 301, 12), b = MakeScene(rng, 257, 301, 12);
+        ImageMetrics::Results single;
+        bool ok = ImageMetrics::Compare(a.View(), b.View(), single, nullptr, 1);
+        for (uint32_t threads : { 2u, 3u, 7u, 16u, 0u })
+        {
+            ok &= ImageMetrics::Compare(a.View(), b.View(), results, nullptr, threads) && SameResults(single, results);
+        }
+        passed &= Report("thread count", ok);
+    }
+
+    // Tiny images have no SSIM window and mismatched sizes are rejected
+    {
+        TestImage a(3, 3, 50), b(3, 3, 50), c(4, 3, 50);
+        bool ok = ImageMetrics::Compare(a.View(), b.View(), results) && results.SSIM == 1.0;
+        b.At(1, 1)[0] = 51;
+        ok &= ImageMetrics::Compare(a.View(), b.View(), results) && results.SSIM == 0.0 && results.AE == 1;
+        ok &= !ImageMetrics::Compare(a.View(), c.View(), results);
+        passed &= Report("small and mismatched images", ok);
+    }
+
+    return passed ? 0 : 1;
+}
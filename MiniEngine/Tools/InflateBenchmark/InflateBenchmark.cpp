@@ -0,0 +1,290 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+//
+// Checks StreamingInflate and times it against the decoder ReadFileSync used before, e.g.
+//
+//     InflateBenchmark -megabytes 64 -iterations 5
+//
+// The payload imitates a model file: binary vertex data interleaved with JSON-like text.
+// Peak memory counts the buffers each path holds at once besides the compressed input.
+//
+
+#include "../../Core/StreamingInflate.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    vector<uint8_t> MakePayload(size_t size, uint32_t seed)
+    {
+        mt19937 rng(seed);
+        uniform_real_distribution<float> jitter(-1.0f, 1.0f);
+        static const char kText[] = "{\"name\": \"mesh\", \"primitives\": [{\"attributes\": {\"POSITION\": 0, \"NORMAL\": 1}}]},\n";
+
+        vector<uint8_t> payload;
+        payload.reserve(size);
+        while (payload.size() < size)
+        {
+            // A block of vertices on a smooth surface, then some text
+            for (uint32_t v = 0; v < 1024; ++v)
+            {
+                const float position[3] = { (float)(v % 32), (float)(v / 32), jitter(rng) * 0.01f };
+                payload.insert(payload.end(), (const uint8_t*)position, (const uint8_t*)(position + 3));
+            }
+            for (uint32_t t = 0; t < 16; ++t)
+                payload.insert(payload.end(), kText, kText + sizeof(kText) - 1);
+        }
+        payload.resize(size);
+        return payload;
+    }
+
+    // 'gzip' selects a gzip wrapper with its size trailer, otherwise a zlib wrapper
+    vector<uint8_t> Compress(const vector<uint8_t>& data, bool gzip)
+    {
+        z_stream strm = {};
+        deflateInit2(&strm, 6, Z_DEFLATED, gzip ? 15 + 16 : 15, 8, Z_DEFAULT_STRATEGY);
+
+        vector<uint8_t> compressed(deflateBound(&strm, (uLong)data.size()) + 32);
+        strm.next_in = const_cast<Bytef*>(data.data());
+        strm.avail_in = (uInt)data.size();
+        strm.next_out = compressed.data();
+        strm.avail_out = (uInt)compressed.size();
+        deflate(&strm, Z_FINISH);
+        compressed.resize(strm.total_out);
+        deflateEnd(&strm);
+        return compressed;
+    }
+
+    // The decoder ReadFileSync used before, which decoded into 1 MB blocks and then copied
+    // them into the result
+    bool InflateReference(const vector<uint8_t>& source, vector<uint8_t>& result, size_t& peakBytes)
+    {
+        const uint32_t ChunkSize = 0x100000;
+        vector<unique_ptr<uint8_t[]> > blocks;
+
+        z_stream strm = {};
+        strm.data_type = Z_BINARY;
+        strm.total_in = strm.avail_in = (uInt)source.size();
+        strm.next_in = const_cast<Bytef*>(source.data());
+
+        int err = inflateInit2(&strm, (15 + 32));
+        while (err == Z_OK || err == Z_BUF_ERROR)
+        {
+            strm.avail_out = ChunkSize;
+            strm.next_out = new uint8_t[ChunkSize];
+            blocks.emplace_back(strm.next_out);
+            err = inflate(&strm, Z_NO_FLUSH);
+        }
+
+        if (err != Z_STREAM_END)
+        {
+            inflateEnd(&strm);
+            return false;
+        }
+
+        result.resize(strm.total_out);
+        uint8_t* curDest = result.data();
+        size_t remaining = result.size();
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            size_t CopySize = remaining < ChunkSize ? remaining : ChunkSize;
+            memcpy(curDest, blocks[i].get(), CopySize);
+            curDest += CopySize;
+            remaining -= CopySize;
+        }
+
+        peakBytes = blocks.size() * ChunkSize + result.size();
+        inflateEnd(&strm);
+        return true;
+    }
+
+    bool Report(const char* name, bool passed)
+    {
+        printf("%s %s\n", passed ? "Passed" : "FAILED", name);
+        return passed;
+    }
+
+    bool CheckBuffer(const vector<uint8_t>& payload, bool gzip, const char* name)
+    {
+        const vector<uint8_t> compressed = Compress(payload, gzip);
+
+        vector<uint8_t> result;
+        StreamingInflate::Status status = StreamingInflate::InflateToBuffer(compressed.data(), compressed.size(), result);
+
+        bool passed = status == StreamingInflate::kSuccess && result == payload;
+
+        // With the trailer the destination is allocated once at its final size
+        if (gzip && !payload.empty())
+            passed &= result.capacity() == payload.size();
+
+        return Report(name, passed);
+    }
+
+    bool CheckChunks(const vector<uint8_t>& payload, size_t chunkSize, const char* name)
+    {
+        const vector<uint8_t> compressed = Compress(payload, true);
+
+        vector<uint8_t> result;
+        bool chunksFit = true;
+        StreamingInflate::Status status = StreamingInflate::InflateChunks(compressed.data(), compressed.size(),
+            [&](const uint8_t* data, size_t size)
+            {
+                chunksFit &= size > 0 && size <= chunkSize;
+                result.insert(result.end(), data, data + size);
+                return true;
+            }, chunkSize);
+
+        return Report(name, status == StreamingInflate::kSuccess && chunksFit && result == payload);
+    }
+
+    template <typename DecodeFunction>
+    void Benchmark(const char* name, uint32_t iterations, size_t size, DecodeFunction decode)
+    {
+        size_t peakBytes = 0;
+        double totalMs = 0.0;
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            auto start = chrono::high_resolution_clock::now();
+            decode(peakBytes);
+            auto end = chrono::high_resolution_clock::now();
+            totalMs += chrono::duration<double, milli>(end - start).count();
+        }
+
+        const double ms = totalMs / iterations;
+        printf("%-24s %9.3f ms %8.1f MB/s   peak %8.2f MB\n", name, ms, size / (1024.0 * 1024.0) / (ms / 1000.0),
+            peakBytes / (1024.0 * 1024.0));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t megabytes = 64;
+    uint32_t iterations = 5;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (arg + 1 < argc && strcmp("-megabytes", argv[arg]) == 0)
+            megabytes = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-iterations", argv[arg]) == 0)
+            iterations = max(atoi(argv[++arg]), 1);
+        else
+        {
+            printf(
+                "Usage:  %s [options]*\n\n"
+                "Options:\n\n"
+                "-megabytes <integer>\n\tUncompressed size of the benchmark payload.\n\tDefaults to 64.\n"
+                "-iterations <integer>\n\tTimed repetitions.\n\tDefaults to 5.\n\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    bool passed = true;
+
+    const vector<uint8_t> small = MakePayload(300000, 1);
+    passed &= CheckBuffer(small, true, "gzip, sized by the trailer");
+    passed &= CheckBuffer(small, false, "zlib, no trailer");
+    passed &= CheckBuffer({}, true, "empty gzip");
+    passed &= CheckBuffer(vector<uint8_t>(4000000, 0), true, "highly compressible");
+    passed &= CheckChunks(small, StreamingInflate::kDefaultChunkSize, "chunks");
+    passed &= CheckChunks(small, 7, "tiny chunks");
+
+    // zlib verifies the trailer, so a wrong size is an error rather than a short result.
+    // Without a trailer, the destination grows past the estimate.
+    {
+        vector<uint8_t> compressed = Compress(small, true);
+        compressed[compressed.size() - 4] ^= 0x5A;
+        vector<uint8_t> result;
+        StreamingInflate::Status status = StreamingInflate::InflateToBuffer(compressed.data(), compressed.size(), result);
+        passed &= Report("wrong trailer size detected", status == StreamingInflate::kCorruptData);
+
+        vector<uint8_t> zlibCompressed = Compress(small, false);
+        result.assign(5, 0);
+        status = StreamingInflate::InflateToBuffer(zlibCompressed.data(), zlibCompressed.size(), result);
+        passed &= Report("buffer grows past the estimate", status == StreamingInflate::kSuccess && result == small);
+    }
+
+    {
+        const vector<uint8_t> compressed = Compress(small, true);
+        vector<uint8_t> result;
+        passed &= Report("truncated", StreamingInflate::InflateToBuffer(compressed.data(), compressed.size() / 2, result) ==
+            StreamingInflate::kTruncated);
+
+        vector<uint8_t> corrupt = compressed;
+        corrupt[corrupt.size() / 2] ^= 0xFF;
+        passed &= Report("corrupt", StreamingInflate::InflateToBuffer(corrupt.data(), corrupt.size(), result) ==
+            StreamingInflate::kCorruptData);
+
+        passed &= Report("not compressed", StreamingInflate::InflateToBuffer(small.data(), small.size(), result) ==
+            StreamingInflate::kCorruptData);
+
+        uint32_t calls = 0;
+        StreamingInflate::Status status = StreamingInflate::InflateChunks(compressed.data(), compressed.size(),
+            [&](const uint8_t*, size_t) { return ++calls < 2; }, 1024);
+        passed &= Report("aborted by the callback", status == StreamingInflate::kAborted && calls == 2);
+    }
+
+    const vector<uint8_t> payload = MakePayload((size_t)megabytes << 20, 2);
+    const vector<uint8_t> compressed = Compress(payload, true);
+    printf("\n%u MB payload, %.2f MB compressed:\n", megabytes, compressed.size() / (1024.0 * 1024.0));
+
+    Benchmark("1 MB blocks and copy", iterations, payload.size(), [&](size_t& peakBytes)
+    {
+        vector<uint8_t> result;
+        passed &= InflateReference(compressed, result, peakBytes) && result.size() == payload.size();
+    });
+
+    Benchmark("InflateToBuffer", iterations, payload.size(), [&](size_t& peakBytes)
+    {
+        vector<uint8_t> result;
+        passed &= StreamingInflate::InflateToBuffer(compressed.data(), compressed.size(), result) == StreamingInflate::kSuccess &&
+            result.size() == payload.size();
+        peakBytes = result.capacity();
+    });
+
+    Benchmark("InflateChunks", iterations, payload.size(), [&](size_t& peakBytes)
+    {
+        uint32_t checksum = adler32(0, nullptr, 0);
+        size_t total = 0;
+        passed &= StreamingInflate::InflateChunks(compressed.data(), compressed.size(), [&](const uint8_t* data, size_t size)
+            {
+                checksum = adler32(checksum, data, (uInt)size);
+                total += size;
+                return true;
+            }) == StreamingInflate::kSuccess && total == payload.size() &&
+            checksum == adler32(adler32(0, nullptr, 0), payload.data(), (uInt)payload.size());
+        peakBytes = StreamingInflate::kDefaultChunkSize;
+    });
+
+    printf("\n%s\n", passed ? "Passed" : "FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,402 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Checks that meshlets cover every triangle in order and within their limits, that their
+// bounds hold their vertices, and that the culler never rejects a meshlet with a visible
+// triangle, then times building and culling.
+//
+
+#include "../../Model/Meshlets.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace Meshlets;
+
+namespace
+{
+    struct Mesh
+    {
+        vector<float> positions;    // float3
+        vector<uint32_t> indices;
+
+        uint32_t VertexCount() const { return (uint32_t)(positions.size() / 3); }
+        const float* Position(uint32_t v) const { return positions.data() + v * 3; }
+
+        uint32_t AddVertex(float x, float y, float z)
+        {
+            positions.push_back(x);
+            positions.push_back(y);
+            positions.push_back(z);
+            return VertexCount() - 1;
+        }
+
+        void AddTriangle(uint32_t a, uint32_t b, uint32_t c)
+        {
+            indices.push_back(a);
+            indices.push_back(b);
+            indices.push_back(c);
+        }
+    };
+
+    // Counter-clockwise seen from outside
+    void AddSphere(Mesh& mesh, float cx, float cy, float cz, float radius, uint32_t rings, uint32_t segments)
+    {
+        const float kPi = 3.14159265f;
+        const uint32_t base = mesh.VertexCount();
+        for (uint32_t r = 0; r <= rings; ++r)
+        {
+            const float theta = kPi * r / rings;
+            for (uint32_t s = 0; s <= segments; ++s)
+            {
+                const float phi = 2.0f * kPi * s / segments;
+                mesh.AddVertex(cx + radius * sin(theta) * cos(phi), cy + radius * sin(theta) * sin(phi), cz + radius * cos(theta));
+            }
+        }
+
+        for (uint32_t r = 0; r < rings; ++r)
+        {
+            for (uint32_t s = 0; s < segments; ++s)
+            {
+                const uint32_t v = base + r * (segments + 1) + s;
+                mesh.AddTriangle(v, v + segments + 1, v + 1);
+                mesh.AddTriangle(v + 1, v + segments + 1, v + segments + 2);
+            }
+        }
+    }
+
+    double Milliseconds(chrono::high_resolution_clock::time_point start)
+    {
+        return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    }
+
+    bool Report(const char* name, bool ok)
+    {
+        printf("%s %s\n", ok ? "Passed" : "FAILED", name);
+        return ok;
+    }
+
+    // Meshlets must be back to back, within the limits, and hold exactly the vertices they use
+    bool CheckPartition(const Mesh& mesh, const vector<Meshlet>& meshlets, uint32_t maxVertices, uint32_t maxTriangles)
+    {
+        uint32_t next = 0;
+        vector<uint32_t> seen(mesh.VertexCount(), ~0u);
+
+        for (uint32_t m = 0; m < meshlets.size(); ++m)
+        {
+            const Meshlet& meshlet = meshlets[m];
+            if (meshlet.startIndex != next || meshlet.primCount == 0 || meshlet.primCount % 3 != 0 ||
+                meshlet.primCount / 3 > maxTriangles || meshlet.vertexCount > maxVertices)
+                return false;
+
+            uint32_t vertexCount = 0;
+            for (uint32_t i = meshlet.startIndex; i < meshlet.startIndex + meshlet.primCount; ++i)
+            {
+                const uint32_t v = mesh.indices[i];
+                if (seen[v] != m)
+                {
+                    seen[v] = m;
+                    ++vertexCount;
+                }
+
+                // Slack for the rounding of the distance itself
+                const float* p = mesh.Position(v);
+                const float dx = p[0] - meshlet.bounds[0], dy = p[1] - meshlet.bounds[1], dz = p[2] - meshlet.bounds[2];
+                if (sqrt(dx * dx + dy * dy + dz * dz) > meshlet.bounds[3] * 1.0001f + 1e-6f)
+                    return false;
+            }
+
+            if (vertexCount != meshlet.vertexCount)
+                return false;
+
+            next += meshlet.primCount;
+        }
+
+        return next == mesh.indices.size();
+    }
+
+    const float kIdentity[12] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+
+    // Rows of R * S plus a translation, for a random rotation R and scale S
+    void MakeRandomTransform(mt19937& rng, float xform[12])
+    {
+        uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+        float q[4], length = 0.0f;
+        do
+        {
+            length = 0.0f;
+            for (float& c : q)
+            {
+                c = value(rng);
+                length += c * c;
+            }
+        } while (length < 0.01f || length > 1.0f);
+        for (float& c : q)
+            c /= sqrt(length);
+
+        const float x = q[0], y = q[1], z = q[2], w = q[3];
+        const float rotation[3][3] = {
+            { 1 - 2 * (y * y + z * z), 2 * (x * y - z * w), 2 * (x * z + y * w) },
+            { 2 * (x * y + z * w), 1 - 2 * (x * x + z * z), 2 * (y * z - x * w) },
+            { 2 * (x * z - y * w), 2 * (y * z + x * w), 1 - 2 * (x * x + y * y) } };
+
+        const float scale[3] = { 1.0f + 0.5f * value(rng), 1.0f + 0.5f * value(rng), 1.0f + 0.5f * value(rng) };
+        for (int r = 0; r < 3; ++r)
+        {
+            for (int c = 0; c < 3; ++c)
+                xform[r * 4 + c] = rotation[r][c] * scale[c];
+            xform[r * 4 + 3] = value(rng);
+        }
+    }
+
+    // A box of planes facing inward
+    CullView MakeBoxView(const float minCorner[3], const float maxCorner[3], const float camera[3])
+    {
+        CullView view = {};
+        for (int k = 0; k < 3; ++k)
+        {
+            view.planes[k * 2][k] = 1.0f;
+            view.planes[k * 2][3] = -minCorner[k];
+            view.planes[k * 2 + 1][k] = -1.0f;
+            view.planes[k * 2 + 1][3] = maxCorner[k];
+            view.cameraPosition[k] = camera[k];
+        }
+        return view;
+    }
+
+    // Every meshlet rejected by the culler must be outside the box or have only triangles
+    // that face away from the camera
+    bool CheckCull(const Mesh& mesh, const vector<Meshlet>& meshlets, const float xform[12], const CullView& view,
+        CullStats& stats)
+    {
+        vector<uint32_t> visible(meshlets.size());
+        const uint32_t numVisible = Cull(meshlets.data(), (uint32_t)meshlets.size(), xform, view, true, visible.data(), &stats);
+
+        vector<bool> isVisible(meshlets.size(), false);
+        for (uint32_t i = 0; i < numVisible; ++i)
+            isVisible[visible[i]] = true;
+
+        auto transform = [&](const float* p, float* out)
+        {
+            for (int k = 0; k < 3; ++k)
+                out[k] = xform[k * 4] * p[0] + xform[k * 4 + 1] * p[1] + xform[k * 4 + 2] * p[2] + xform[k * 4 + 3];
+        };
+
+        for (uint32_t m = 0; m < meshlets.size(); ++m)
+        {
+            if (isVisible[m])
+                continue;
+
+            const Meshlet& meshlet = meshlets[m];
+            for (uint32_t i = meshlet.startIndex; i < meshlet.startIndex + meshlet.primCount; i += 3)
+            {
+                float p[3][3];
+                for (int j = 0; j < 3; ++j)
+                    transform(mesh.Position(mesh.indices[i + j]), p[j]);
+
+                bool inside = false;
+                for (int j = 0; j < 3; ++j)
+                {
+                    bool pointInside = true;
+                    for (int k = 0; k < 6; ++k)
+                    {
+                        const float* plane = view.planes[k];
+                        pointInside &= plane[0] * p[j][0] + plane[1] * p[j][1] + plane[2] * p[j][2] + plane[3] >= 0.0f;
+                    }
+                    inside |= pointInside;
+                }
+
+                const float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+                const float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+                const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+                const float* c = view.cameraPosition;
+                const float facing = n[0] * (c[0] - p[0][0]) + n[1] * (c[1] - p[0][1]) + n[2] * (c[2] - p[0][2]);
+
+                if (inside && facing > 0.0f)
+                    return false;
+            }
+        }
+
+        // Merged ranges must cover exactly the visible meshlets
+        vector<IndexRange> ranges(numVisible);
+        const uint32_t numRanges = MergeRanges(meshlets.data(), visible.data(), numVisible, ranges.data());
+
+        vector<bool> covered(mesh.indices.size(), false);
+        for (uint32_t r = 0; r < numRanges; ++r)
+        {
+            if (r > 0 && ranges[r - 1].startIndex + ranges[r - 1].indexCount >= ranges[r].startIndex)
+                return false;
+            for (uint32_t i = ranges[r].startIndex; i < ranges[r].startIndex + ranges[r].indexCount; ++i)
+                covered[i] = true;
+        }
+
+        for (uint32_t m = 0; m < meshlets.size(); ++m)
+        {
+            for (uint32_t i = meshlets[m].startIndex; i < meshlets[m].startIndex + meshlets[m].primCount; ++i)
+            {
+                if (covered[i] != isVisible[m])
+                    return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+int main()
+{
+    bool passed = true;
+    mt19937 rng(13);
+
+    // Small cases with known answers
+    {
+        Mesh quad;
+        quad.AddVertex(0.0f, 0.0f, 0.0f);
+        quad.AddVertex(1.0f, 0.0f, 0.0f);
+        quad.AddVertex(1.0f, 1.0f, 0.0f);
+        quad.AddVertex(0.0f, 1.0f, 0.0f);
+        quad.AddTriangle(0, 1, 2);
+        quad.AddTriangle(0, 2, 3);
+
+        vector<Meshlet> meshlets;
+        Build(quad.indices.data(), quad.indices.size(), quad.positions.data(), 4, 12, 64, 124, true, meshlets);
+        const bool single = meshlets.size() == 1 && meshlets[0].vertexCount == 4 && meshlets[0].primCount == 6 &&
+            meshlets[0].cone[2] == 1.0f && meshlets[0].cone[3] < 0.01f;
+
+        // One triangle per meshlet, and a flat cone never culls a camera in front of it
+        vector<Meshlet> split;
+        Build(quad.indices.data(), quad.indices.size(), quad.positions.data(), 4, 12, 64, 1, true, split);
+        passed &= Report("single quad meshlet and triangle limit", single && split.size() == 2 && split[1].startIndex == 3);
+
+        const float lo[3] = { -10.0f, -10.0f, -10.0f }, hi[3] = { 10.0f, 10.0f, 10.0f };
+        const float front[3] = { 0.5f, 0.5f, 5.0f }, back[3] = { 0.5f, 0.5f, -5.0f };
+        uint32_t visible[2];
+        const uint32_t fromFront = Cull(meshlets.data(), 1, kIdentity, MakeBoxView(lo, hi, front), true, visible);
+        const uint32_t fromBack = Cull(meshlets.data(), 1, kIdentity, MakeBoxView(lo, hi, back), true, visible);
+        const uint32_t noBackFaceCulling = Cull(meshlets.data(), 1, kIdentity, MakeBoxView(lo, hi, back), false, visible);
+
+        const float awayLo[3] = { 5.0f, 5.0f, 5.0f };
+        const uint32_t outside = Cull(meshlets.data(), 1, kIdentity, MakeBoxView(awayLo, hi, front), true, visible);
+        passed &= Report("quad culled from behind and outside the view",
+            fromFront == 1 && fromBack == 0 && noBackFaceCulling == 1 && outside == 0);
+
+        // Turned around the x axis the quad faces -z, so the sides swap. A mirror keeps it.
+        const float turned[12] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, -1.0f, 0.0f };
+        const float mirrored[12] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f };
+        const uint32_t turnedFront = Cull(meshlets.data(), 1, turned, MakeBoxView(lo, hi, front), true, visible);
+        const uint32_t turnedBack = Cull(meshlets.data(), 1, turned, MakeBoxView(lo, hi, back), true, visible);
+        const uint32_t mirroredFront = Cull(meshlets.data(), 1, mirrored, MakeBoxView(lo, hi, front), true, visible);
+        const uint32_t mirroredBack = Cull(meshlets.data(), 1, mirrored, MakeBoxView(lo, hi, back), true, visible);
+        passed &= Report("rotated quad culled from its new back, mirrored never",
+            turnedFront == 0 && turnedBack == 1 && mirroredFront == 1 && mirroredBack == 1);
+
+        // Without cones, or for a closed shape, nothing is back facing
+        vector<Meshlet> noCones, sphere;
+        Build(quad.indices.data(), quad.indices.size(), quad.positions.data(), 4, 12, 64, 124, false, noCones);
+        Mesh ball;
+        AddSphere(ball, 0.0f, 0.0f, 0.0f, 1.0f, 8, 16);
+        Build(ball.indices.data(), ball.indices.size(), ball.positions.data(), ball.VertexCount(), 12, 256, 512, true, sphere);
+        passed &= Report("never back facing without a cone", noCones[0].cone[3] == 1.0f && sphere.size() == 1 && sphere[0].cone[3] == 1.0f);
+
+        vector<Meshlet> empty;
+        passed &= Report("empty input", Build(nullptr, 0, nullptr, 0, 12, 64, 124, true, empty) == 0 && empty.empty());
+    }
+
+    Mesh spheres;
+    uniform_real_distribution<float> position(-1.0f, 1.0f);
+    for (int i = 0; i < 60; ++i)
+        AddSphere(spheres, position(rng) * 4.0f, position(rng) * 4.0f, position(rng) * 4.0f, 0.5f + 0.3f * position(rng), 64, 128);
+
+    printf("%zu triangles, %u vertices\n", spheres.indices.size() / 3, spheres.VertexCount());
+
+    const uint32_t limits[][2] = { { 64, 124 }, { 64, 64 }, { 128, 256 }, { 32, 32 } };
+    for (const auto& limit : limits)
+    {
+        vector<Meshlet> meshlets;
+        auto start = chrono::high_resolution_clock::now();
+        Build(spheres.indices.data(), spheres.indices.size(), spheres.positions.data(), spheres.VertexCount(),
+            12, limit[0], limit[1], true, meshlets);
+        const double buildMs = Milliseconds(start);
+
+        bool ok = CheckPartition(spheres, meshlets, limit[0], limit[1]);
+
+        uint32_t withCones = 0;
+        for (const Meshlet& meshlet : meshlets)
+            withCones += meshlet.cone[3] < 1.0f;
+
+        // Random cameras looking at random boxes, under a random rotation, non-uniform scale
+        // and translation
+        CullStats stats;
+        for (int trial = 0; trial < 40 && ok; ++trial)
+        {
+            float xform[12];
+            MakeRandomTransform(rng, xform);
+            float lo[3], hi[3], camera[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                lo[k] = position(rng) * 6.0f - 3.0f;
+                hi[k] = lo[k] + 3.0f + 3.0f * position(rng) + 3.0f;
+                camera[k] = position(rng) * 10.0f;
+            }
+            ok &= CheckCull(spheres, meshlets, xform, MakeBoxView(lo, hi, camera), stats);
+        }
+
+        printf("  %s %3u vertices %3u triangles: %6zu meshlets, %5.1f triangles and %5.1f vertices each, "
+            "%4.1f%% with cones, %6.2f ms, %4.1f%% frustum and %4.1f%% back face culled\n", ok ? "Passed" : "FAILED",
+            limit[0], limit[1], meshlets.size(), spheres.indices.size() / 3.0 / meshlets.size(),
+            [&]() { double n = 0; for (const Meshlet& m : meshlets) n += m.vertexCount; return n / meshlets.size(); }(),
+            100.0 * withCones / meshlets.size(), buildMs,
+            100.0 * stats.frustumCulled / max(stats.tested, 1u), 100.0 * stats.backFacing / max(stats.tested, 1u));
+        passed &= ok;
+    }
+
+    // Culling throughput
+    {
+        vector<Meshlet> meshlets;
+        Build(spheres.indices.data(), spheres.indices.size(), spheres.positions.data(), spheres.VertexCount(),
+            12, kDefaultMaxVertices, kDefaultMaxTriangles, true, meshlets);
+
+        const float lo[3] = { -3.0f, -3.0f, -3.0f }, hi[3] = { 3.0f, 3.0f, 3.0f }, camera[3] = { 0.0f, 0.0f, 8.0f };
+        const CullView view = MakeBoxView(lo, hi, camera);
+        vector<uint32_t> visible(meshlets.size());
+        vector<IndexRange> ranges(meshlets.size());
+
+        const int kRepeats = 200;
+        uint32_t numVisible = 0, numRanges = 0;
+        auto start = chrono::high_resolution_clock::now();
+        for (int r = 0; r < kRepeats; ++r)
+        {
+            numVisible = Cull(meshlets.data(), (uint32_t)meshlets.size(), kIdentity, view, true, visible.data());
+            numRanges = MergeRanges(meshlets.data(), visible.data(), numVisible, ranges.data());
+        }
+        const double ms = Milliseconds(start) / kRepeats;
+
+        printf("Culled %zu meshlets in %.3f ms (%.1f ns each): %u visible in %u draws\n", meshlets.size(), ms,
+            ms * 1e6 / meshlets.size(), numVisible, numRanges);
+    }
+
+    return passed ? 0 : 1;
+}
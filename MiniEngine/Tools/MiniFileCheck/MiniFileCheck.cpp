@@ -0,0 +1,283 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+//
+// Writes .mini files with MiniFileWriter and checks that MiniFileView accepts them and
+// rejects every damaged variant: changed header bytes, counts that disagree with their
+// sections (with a correct header checksum), misplaced sections, truncation and corrupt
+// section contents. Every damaged file is attached from an allocation of exactly its size,
+// so reading past the end is caught by a sanitizer build.
+//
+
+#include "../../Core/Crc32c.h"
+#include "../../Model/ModelFile.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Renderer;
+
+namespace
+{
+    bool Report(const char* name, bool passed)
+    {
+        printf("%s %s\n", passed ? "Passed" : "FAILED", name);
+        return passed;
+    }
+
+    struct SectionData
+    {
+        vector<uint8_t> bytes[kNumMiniSections];
+    };
+
+    vector<uint8_t> Pattern(size_t size, uint8_t seed)
+    {
+        vector<uint8_t> bytes(size);
+        for (size_t i = 0; i < size; ++i)
+            bytes[i] = (uint8_t)(i * 31 + seed);
+        return bytes;
+    }
+
+    // A header whose counts match the sections, like SaveModel writes
+    FileHeader MakeModel(SectionData& data, bool withMeshlets)
+    {
+        FileHeader header = {};
+        memcpy(header.id, "MINI", 4);
+        header.version = CURRENT_MINI_FILE_VERSION;
+        header.geometrySize = 1000;
+        header.numNodes = 3;
+        header.meshDataSize = 100;
+        header.numMeshes = 2;
+        header.numMaterials = 2;
+        header.numTextures = 2;
+        header.stringTableSize = 12;
+        header.keyFrameDataSize = 64;
+        header.numAnimationCurves = 2;
+        header.numAnimations = 1;
+        header.numJoints = 4;
+        header.numMeshlets = withMeshlets ? 5 : 0;
+
+        for (uint32_t s = 0; s < kNumMiniSections; ++s)
+            data.bytes[s] = Pattern((size_t)GetExpectedSectionSize(header, (MiniSection)s), (uint8_t)s);
+        const char names[] = "a.dds\0b.dds";
+        memcpy(data.bytes[kMiniStringTable].data(), names, sizeof(names));
+        return header;
+    }
+
+    vector<uint8_t> WriteModel(const FileHeader& source, const SectionData& data)
+    {
+        stringstream stream(ios::in | ios::out | ios::binary);
+        MiniFileWriter writer(stream);
+        for (uint32_t s = 0; s < kNumMiniSections; ++s)
+        {
+            if (data.bytes[s].empty())
+                continue;
+            writer.BeginSection((MiniSection)s);
+            writer.Write(data.bytes[s].data(), data.bytes[s].size());
+            writer.EndSection();
+        }
+
+        FileHeader header = source;
+        if (!writer.Finish(header))
+            return vector<uint8_t>();
+
+        string contents = stream.str();
+        return vector<uint8_t>(contents.begin(), contents.end());
+    }
+
+    MiniFileView::Status AttachCopy(const vector<uint8_t>& file, size_t size, bool verifyChecksums = true)
+    {
+        vector<uint8_t> copy(file.begin(), file.begin() + size);
+        MiniFileView view;
+        return view.Attach(copy.data(), copy.size(), verifyChecksums);
+    }
+
+    FileHeader& HeaderOf(vector<uint8_t>& file)
+    {
+        return *(FileHeader*)file.data();
+    }
+
+    void UpdateHeaderChecksum(vector<uint8_t>& file)
+    {
+        FileHeader& header = HeaderOf(file);
+        header.headerChecksum = Utility::ComputeCrc32c(&header, offsetof(FileHeader, headerChecksum));
+    }
+}
+
+int main()
+{
+    bool passed = true;
+
+    SectionData data;
+    const FileHeader header = MakeModel(data, true);
+    const vector<uint8_t> file = WriteModel(header, data);
+
+    // A written file attaches and every section reads back as written
+    {
+        vector<uint8_t> copy(file);
+        MiniFileView view;
+        bool ok = !file.empty() && file.size() % kMiniSectionAlignment == 0 &&
+            view.Attach(copy.data(), copy.size()) == MiniFileView::kOK && view.GetHeader().fileSize == file.size();
+        for (uint32_t s = 0; ok && s < kNumMiniSections; ++s)
+        {
+            ok &= view.GetSectionSize((MiniSection)s) == data.bytes[s].size() &&
+                (uint64_t)(view.GetSection((MiniSection)s) - copy.data()) % kMiniSectionAlignment == 0 &&
+                memcmp(view.GetSection((MiniSection)s), data.bytes[s].data(), data.bytes[s].size()) == 0;
+        }
+
+        SectionData noMeshletData;
+        FileHeader noMeshlets = MakeModel(noMeshletData, false);
+        vector<uint8_t> noMeshletFile = WriteModel(noMeshlets, noMeshletData);
+        ok &= view.Attach(noMeshletFile.data(), noMeshletFile.size()) == MiniFileView::kOK &&
+            view.GetSection(kMiniMeshlets) == nullptr && view.GetSectionSize(kMiniMeshlets) == 0;
+
+        passed &= Report("round trip", ok);
+    }
+
+    // Any change to the header is caught, even where only padding or bounds would be affected
+    {
+        bool ok = true;
+        for (size_t i = 0; i < sizeof(FileHeader); ++i)
+        {
+            vector<uint8_t> damaged(file);
+            damaged[i] ^= 0x10;
+            ok &= AttachCopy(damaged, damaged.size(), false) != MiniFileView::kOK;
+        }
+        passed &= Report("header checksum", ok);
+    }
+
+    // Counts that disagree with their sections are rejected even with a valid header checksum
+    {
+        uint32_t FileHeader::* counts[] =
+        {
+            &FileHeader::geometrySize, &FileHeader::numNodes, &FileHeader::meshDataSize, &FileHeader::numMaterials,
+            &FileHeader::numTextures, &FileHeader::stringTableSize, &FileHeader::keyFrameDataSize,
+            &FileHeader::numAnimationCurves, &FileHeader::numAnimations, &FileHeader::numJoints, &FileHeader::numMeshlets,
+        };
+
+        bool ok = true;
+        for (auto count : counts)
+        {
+            for (uint32_t value : { 0u, 1u, 0x10000001u, 0xffffffffu })
+            {
+                vector<uint8_t> damaged(file);
+                if (HeaderOf(damaged).*count == value)
+                    continue;
+                HeaderOf(damaged).*count = value;
+                UpdateHeaderChecksum(damaged);
+                ok &= AttachCopy(damaged, damaged.size(), false) == MiniFileView::kCorrupt;
+            }
+        }
+
+        // A count for a section that was never written
+        SectionData noMeshletData;
+        FileHeader noMeshlets = MakeModel(noMeshletData, false);
+        vector<uint8_t> damaged = WriteModel(noMeshlets, noMeshletData);
+        HeaderOf(damaged).numMeshlets = 1;
+        UpdateHeaderChecksum(damaged);
+        ok &= AttachCopy(damaged, damaged.size(), false) == MiniFileView::kCorrupt;
+
+        passed &= Report("counts against sections", ok);
+    }
+
+    // Sections out of place, with a valid header checksum
+    {
+        bool ok = true;
+        for (uint32_t s = 0; s < kNumMiniSections; ++s)
+        {
+            const uint32_t offsets[] = { 0, 16, HeaderOf(const_cast<vector<uint8_t>&>(file)).sections[s].offset + 4,
+                (uint32_t)file.size(), 0xffffff00u };
+            for (uint32_t offset : offsets)
+            {
+                vector<uint8_t> damaged(file);
+                HeaderOf(damaged).sections[s].offset = offset;
+                UpdateHeaderChecksum(damaged);
+                ok &= AttachCopy(damaged, damaged.size(), false) == MiniFileView::kCorrupt;
+            }
+        }
+
+        vector<uint8_t> damaged(file);
+        HeaderOf(damaged).fileSize += kMiniSectionAlignment;
+        UpdateHeaderChecksum(damaged);
+        ok &= AttachCopy(damaged, damaged.size(), false) == MiniFileView::kCorrupt;
+
+        passed &= Report("section placement", ok);
+    }
+
+    // Every truncation fails, and so does a changed byte in any section
+    {
+        bool ok = true;
+        for (size_t size = 0; size < file.size(); ++size)
+            ok &= AttachCopy(file, size) != MiniFileView::kOK;
+
+        for (uint32_t s = 0; s < kNumMiniSections; ++s)
+        {
+            vector<uint8_t> damaged(file);
+            const MiniSectionEntry& entry = HeaderOf(damaged).sections[s];
+            damaged[entry.offset + entry.size / 2] ^= 1;
+            ok &= AttachCopy(damaged, damaged.size()) == MiniFileView::kCorrupt &&
+                AttachCopy(damaged, damaged.size(), false) == MiniFileView::kOK;
+        }
+
+        passed &= Report("truncation and section checksums", ok);
+    }
+
+    // Other files and older versions
+    {
+        vector<uint8_t> other(file);
+        memcpy(other.data(), "MINX", 4);
+        vector<uint8_t> old(file);
+        HeaderOf(old).version = CURRENT_MINI_FILE_VERSION - 1;
+        vector<uint8_t> oldShort(old.begin(), old.begin() + 64);
+
+        bool ok = AttachCopy(other, other.size()) == MiniFileView::kNotMini &&
+            AttachCopy(old, old.size()) == MiniFileView::kWrongVersion &&
+            AttachCopy(oldShort, oldShort.size()) == MiniFileView::kWrongVersion &&
+            AttachCopy(file, 4) == MiniFileView::kNotMini;
+        passed &= Report("other files and versions", ok);
+    }
+
+    // Through a file mapping
+    {
+        const string path = "MiniFileCheck.mini";
+        {
+            ofstream out(path, ios::binary);
+            out.write((const char*)file.data(), (streamsize)file.size());
+        }
+
+        MiniFileView view;
+        bool ok = view.Open(wstring(path.begin(), path.end())) == MiniFileView::kOK &&
+            view.GetHeader().numJoints == header.numJoints &&
+            memcmp(view.GetSection(kMiniJointIBMs), data.bytes[kMiniJointIBMs].data(), data.bytes[kMiniJointIBMs].size()) == 0;
+        view.Close();
+        remove(path.c_str());
+
+        ok &= view.Open(L"MiniFileCheck.missing") == MiniFileView::kMissing;
+        passed &= Report("mapped file", ok);
+    }
+
+    return passed ? 0 : 1;
+}
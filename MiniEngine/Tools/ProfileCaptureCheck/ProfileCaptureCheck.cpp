@@ -0,0 +1,252 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Records synthetic nested scopes from several threads, then checks the captured events, the
+// dropped event count, the Chrome trace JSON and the per-scope percentiles.
+//
+
+#include "../../Core/ProfileCapture.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace ProfileCapture;
+
+namespace
+{
+    const wchar_t* kFrame = L"Frame";
+    const wchar_t* kShadows = L"Shadows";
+    const wchar_t* kOpaque = L"Opaque \"pass\" \\ \u00e9\u4e2d\U0001F600";
+
+    // Per frame: Frame { Shadows {} Opaque { Shadows {} } }, eight events
+    void RecordFrames(Recorder& recorder, uint32_t numFrames)
+    {
+        int64_t tick = 0;
+        for (uint32_t f = 0; f < numFrames; ++f)
+        {
+            recorder.BeginScope(kFrame, tick++);
+            recorder.BeginScope(kShadows, tick++);
+            recorder.EndScope(tick++);
+            recorder.BeginScope(kOpaque, tick++);
+            recorder.BeginScope(kShadows, tick++);
+            recorder.EndScope(tick++);
+            recorder.EndScope(tick++);
+            recorder.EndScope(tick++);
+        }
+    }
+
+    bool Check(bool condition, const char* name)
+    {
+        printf("%s %s\n", condition ? "Passed" : "FAILED", name);
+        return condition;
+    }
+
+    // Objects and arrays balance outside of strings, and strings hold no raw control characters
+    bool IsWellFormedJson(const string& json)
+    {
+        int depth = 0;
+        bool inString = false;
+        for (size_t i = 0; i < json.size(); ++i)
+        {
+            const char c = json[i];
+            if (inString)
+            {
+                if (c == '\\')
+                    ++i;
+                else if (c == '"')
+                    inString = false;
+                else if ((unsigned char)c < 0x20)
+                    return false;
+            }
+            else if (c == '"')
+                inString = true;
+            else if (c == '{' || c == '[')
+                ++depth;
+            else if (c == '}' || c == ']')
+            {
+                if (--depth < 0)
+                    return false;
+            }
+        }
+        return depth == 0 && !inString;
+    }
+
+    size_t CountOf(const string& text, const char* pattern)
+    {
+        size_t count = 0;
+        for (size_t pos = text.find(pattern); pos != string::npos; pos = text.find(pattern, pos + 1))
+            ++count;
+        return count;
+    }
+}
+
+int main()
+{
+    bool passed = true;
+
+    // Several threads record at once
+    {
+        const uint32_t kThreads = 4, kFrames = 5000;
+
+        Recorder recorder;
+        recorder.BeginScope(kFrame, 0);     // Not capturing, ignored
+        recorder.Start(1.0);
+
+        auto start = chrono::high_resolution_clock::now();
+        vector<thread> threads;
+        for (uint32_t t = 0; t < kThreads; ++t)
+            threads.emplace_back([&]() { RecordFrames(recorder, kFrames); });
+        for (thread& t : threads)
+            t.join();
+        double ns = chrono::duration<double, nano>(chrono::high_resolution_clock::now() - start).count();
+
+        Capture capture;
+        recorder.Stop(capture);
+        recorder.EndScope(0);               // Stopped, ignored
+
+        map<uint32_t, int> balance;
+        bool nested = true;
+        for (const Event& e : capture.Events)
+        {
+            balance[e.ThreadId] += e.Type == kBegin ? 1 : -1;
+            nested &= balance[e.ThreadId] >= 0;
+        }
+        for (auto& b : balance)
+            nested &= b.second == 0;
+
+        passed &= Check(capture.Events.size() == kThreads * kFrames * 8 && capture.DroppedEvents == 0, "event count");
+        passed &= Check(balance.size() == kThreads && nested, "per thread nesting");
+
+        printf("  %u threads, %zu events, %.1f ns per event per thread\n", kThreads, capture.Events.size(),
+            ns * kThreads / capture.Events.size());
+    }
+
+    // Full buffers drop events, and a restart gives every thread a fresh buffer
+    {
+        Recorder recorder;
+        Capture capture;
+
+        recorder.Start(1.0, 100);
+        RecordFrames(recorder, 20);
+        recorder.Stop(capture);
+        passed &= Check(capture.Events.size() == 100 && capture.DroppedEvents == 60, "dropped events");
+
+        recorder.Start(1.0, 1000);
+        RecordFrames(recorder, 20);
+        recorder.Stop(capture);
+        passed &= Check(capture.Events.size() == 160 && capture.DroppedEvents == 0, "restarted capture");
+    }
+
+    // Stopping while other threads record, including threads that first record after the stop
+    {
+        const uint32_t kThreads = 4;
+
+        Recorder recorder;
+        Capture capture;
+        atomic<bool> quit(false);
+
+        auto record = [&]()
+        {
+            while (!quit.load())
+                RecordFrames(recorder, 10);
+        };
+
+        recorder.Start(1.0, 1 << 12);
+        vector<thread> threads;
+        for (uint32_t t = 0; t < kThreads; ++t)
+            threads.emplace_back(record);
+
+        this_thread::sleep_for(chrono::milliseconds(20));
+        recorder.Stop(capture);
+        const size_t numEvents = capture.Events.size();
+
+        for (uint32_t t = 0; t < kThreads; ++t)
+            threads.emplace_back(record);
+        this_thread::sleep_for(chrono::milliseconds(20));
+        quit = true;
+        for (thread& t : threads)
+            t.join();
+
+        Capture after;
+        recorder.Start(1.0, 100);
+        recorder.Stop(after);
+        passed &= Check(numEvents > 0 && numEvents <= kThreads * (1 << 12) && after.Events.empty(), "stop while recording");
+    }
+
+    // Chrome trace
+    {
+        Recorder recorder;
+        recorder.Start(0.5);
+        recorder.SetThreadName(GetCurrentThreadId(), "Main \"thread\"");
+        recorder.SetThreadName(1, "GPU");
+        RecordFrames(recorder, 10);
+        recorder.Record(kFrame, 4, 1, kBegin);
+        recorder.Record(nullptr, 6, 1, kEnd);
+
+        Capture capture;
+        recorder.Stop(capture);
+
+        ostringstream stream;
+        passed &= Check(WriteChromeTrace(stream, capture), "trace written");
+
+        const string json = stream.str();
+        passed &= Check(IsWellFormedJson(json), "trace is well formed");
+        passed &= Check(CountOf(json, "\"ph\":\"B\"") == 41 && CountOf(json, "\"ph\":\"E\"") == 41, "trace event count");
+        passed &= Check(CountOf(json, "\"ph\":\"M\"") == 2 && json.find("Main \\\"thread\\\"") != string::npos, "thread names");
+        passed &= Check(json.find("Opaque \\\"pass\\\" \\\\ \xc3\xa9\xe4\xb8\xad\xf0\x9f\x98\x80") != string::npos, "escaped UTF-8 names");
+        passed &= Check(json.find("\"ts\":2.000,\"pid\":1,\"tid\":1}") != string::npos, "GPU timeline in microseconds");
+    }
+
+    // Percentiles: durations of 1 to 100 milliseconds, recorded out of order
+    {
+        Capture capture;
+        capture.MicrosecondsPerTick = 1000.0;
+        int64_t tick = 0;
+        for (int i = 0; i < 100; ++i)
+        {
+            const int64_t duration = (i * 37) % 100 + 1;
+            capture.Events.push_back({ kFrame, tick, 7, kBegin });
+            capture.Events.push_back({ kShadows, tick, 7, kBegin });
+            capture.Events.push_back({ nullptr, tick + duration, 7, kEnd });
+            capture.Events.push_back({ nullptr, tick + duration, 7, kEnd });
+            tick += duration;
+        }
+        capture.Events.push_back({ nullptr, tick, 7, kEnd });     // Unmatched, ignored
+        capture.ThreadNames[7] = "Worker";
+
+        ostringstream stream;
+        passed &= Check(WriteScopeStatistics(stream, capture), "statistics written");
+
+        const string csv = stream.str();
+        passed &= Check(csv.find("\"Worker\",\"Frame\",100,5050.0000,50.5000,1.0000,50.0000,95.0000,99.0000,100.0000\n") != string::npos,
+            "scope percentiles");
+        passed &= Check(csv.find("\"Worker\",\"Frame/Shadows\",100,") != string::npos, "nested scope path");
+        passed &= Check(CountOf(csv, "\n") == 3, "one row per scope");
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,328 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+//
+// Fuzzes RangeAllocator against a per-slot model and times it on a texture streaming
+// workload, e.g.
+//
+//     RangeAllocatorBenchmark -capacity 4096 -operations 1000000 -seed 1
+//
+// The fuzz test allocates, frees and defers frees at random while a fake GPU fence advances,
+// then checks that no slot is handed out twice and that every statistic matches the model.
+//
+
+#include "../../Core/RangeAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    struct Allocation
+    {
+        uint32_t Offset;
+        uint32_t Count;
+    };
+
+    bool Report(const char* name, bool passed)
+    {
+        printf("%s %s\n", passed ? "Passed" : "FAILED", name);
+        return passed;
+    }
+
+    // Slot states of the model
+    enum { kFree, kAllocated, kPending };
+
+    bool CheckAgainstModel(const RangeAllocator& allocator, const vector<uint8_t>& slots, uint32_t numAllocations)
+    {
+        RangeAllocator::Stats stats = allocator.GetStats();
+
+        uint32_t allocated = 0, pending = 0, freeRanges = 0, largest = 0, run = 0;
+        for (size_t i = 0; i < slots.size(); ++i)
+        {
+            allocated += slots[i] == kAllocated;
+            pending += slots[i] == kPending;
+
+            if (slots[i] == kFree)
+            {
+                freeRanges += run == 0;
+                largest = max(largest, ++run);
+            }
+            else
+                run = 0;
+        }
+
+        // Free ranges must be fully merged, so their number and size match the maximal runs
+        return stats.Capacity == slots.size() && stats.Allocated == allocated && stats.Pending == pending &&
+            stats.NumFreeRanges == freeRanges && stats.LargestFreeRange == largest &&
+            stats.NumAllocations == numAllocations && stats.PeakAllocated >= allocated + pending;
+    }
+
+    bool Fuzz(uint32_t capacity, uint32_t numOperations, uint32_t maxCount, uint32_t seed, const char* name)
+    {
+        mt19937 rng(seed);
+        RangeAllocator allocator(capacity);
+
+        vector<uint8_t> slots(capacity, kFree);
+        vector<Allocation> live;
+        vector<pair<Allocation, uint64_t>> pending;
+        uint64_t nextFence = 1, completedFence = 0;
+        uint32_t failedAllocs = 0;
+
+        auto isComplete = [&](uint64_t fence) { return fence <= completedFence; };
+
+        for (uint32_t op = 0; op < numOperations; ++op)
+        {
+            const uint32_t action = rng() % 8;
+
+            if (action < 4 || live.empty())
+            {
+                // Mostly single descriptors, sometimes a table
+                const uint32_t count = rng() % 4 == 0 ? 1 + rng() % maxCount : 1;
+                const bool fits = allocator.CanAllocate(count);
+                const uint32_t offset = allocator.Allocate(count);
+
+                if ((offset == RangeAllocator::kInvalidOffset) == fits)
+                {
+                    printf("FAILED %s: CanAllocate(%u) disagrees with Allocate at operation %u\n", name, count, op);
+                    return false;
+                }
+                if (offset == RangeAllocator::kInvalidOffset)
+                    ++failedAllocs;
+                else
+                {
+                    for (uint32_t i = offset; i < offset + count; ++i)
+                    {
+                        if (i >= capacity || slots[i] != kFree)
+                        {
+                            printf("FAILED %s: slot %u handed out while in use at operation %u\n", name, i, op);
+                            return false;
+                        }
+                        slots[i] = kAllocated;
+                    }
+                    live.push_back({ offset, count });
+                }
+            }
+            else
+            {
+                const size_t index = rng() % live.size();
+                const Allocation a = live[index];
+                live[index] = live.back();
+                live.pop_back();
+
+                if (action < 6)
+                {
+                    allocator.Free(a.Offset, a.Count);
+                    fill(slots.begin() + a.Offset, slots.begin() + a.Offset + a.Count, (uint8_t)kFree);
+                }
+                else
+                {
+                    allocator.FreeDeferred(a.Offset, a.Count, nextFence);
+                    fill(slots.begin() + a.Offset, slots.begin() + a.Offset + a.Count, (uint8_t)kPending);
+                    pending.push_back(make_pair(a, nextFence));
+                }
+            }
+
+            // A frame ends every few operations and the GPU lags a couple of frames behind
+            if (rng() % 16 == 0)
+            {
+                ++nextFence;
+                completedFence = nextFence > 3 ? nextFence - 3 : 0;
+
+                uint32_t expected = 0;
+                auto done = stable_partition(pending.begin(), pending.end(),
+                    [&](const pair<Allocation, uint64_t>& p) { return isComplete(p.second); });
+                for (auto it = pending.begin(); it != done; ++it)
+                {
+                    expected += it->first.Count;
+                    fill(slots.begin() + it->first.Offset, slots.begin() + it->first.Offset + it->first.Count, (uint8_t)kFree);
+                }
+                pending.erase(pending.begin(), done);
+
+                if (allocator.ReleaseCompleted(isComplete) != expected)
+                {
+                    printf("FAILED %s: wrong number of slots released at operation %u\n", name, op);
+                    return false;
+                }
+            }
+
+            if ((op & 1023) == 0 && !CheckAgainstModel(allocator, slots, (uint32_t)live.size()))
+            {
+                printf("FAILED %s: statistics differ from the model at operation %u\n", name, op);
+                return false;
+            }
+        }
+
+        // Draining everything must leave one free range covering the whole capacity
+        for (const Allocation& a : live)
+            allocator.Free(a.Offset, a.Count);
+        completedFence = nextFence;
+        allocator.ReleaseCompleted(isComplete);
+
+        RangeAllocator::Stats stats = allocator.GetStats();
+        bool passed = stats.Allocated == 0 && stats.Pending == 0 && stats.NumFreeRanges == 1 &&
+            stats.LargestFreeRange == capacity && stats.NumAllocations == 0 && stats.GetFragmentation() == 0.0f;
+
+        printf("  %u operations, %u failed allocations, peak %u of %u slots\n",
+            numOperations, failedAllocs, stats.PeakAllocated, capacity);
+        return Report(name, passed);
+    }
+
+    bool CheckBasics()
+    {
+        RangeAllocator allocator(16);
+        bool passed = true;
+
+        // Best fit: the single slot hole is used before the larger one
+        uint32_t a = allocator.Allocate(4), b = allocator.Allocate(1), c = allocator.Allocate(4), d = allocator.Allocate(1);
+        passed &= a == 0 && b == 4 && c == 5 && d == 9;
+        allocator.Free(a, 4);
+        allocator.Free(b, 1);       // merges with a: [0, 5)
+        allocator.Free(d, 1);       // merges with the tail: [9, 16)
+        passed &= allocator.GetStats().NumFreeRanges == 2 && allocator.GetStats().LargestFreeRange == 7;
+        passed &= allocator.Allocate(5) == 0 && allocator.Allocate(7) == 9;
+        passed &= !allocator.CanAllocate(1) && allocator.Allocate(1) == RangeAllocator::kInvalidOffset;
+        passed &= Report("best fit, merging and exhaustion", passed);
+
+        // Deferred frees only come back once their fence completes, in order
+        RangeAllocator deferred(8);
+        uint32_t x = deferred.Allocate(4), y = deferred.Allocate(4);
+        deferred.FreeDeferred(x, 4, 10);
+        deferred.FreeDeferred(y, 4, 11);
+        bool fenced = !deferred.CanAllocate(1) && deferred.GetStats().Pending == 8;
+        fenced &= deferred.ReleaseCompleted([](uint64_t f) { return f <= 9; }) == 0;
+        fenced &= deferred.ReleaseCompleted([](uint64_t f) { return f <= 10; }) == 4;
+        fenced &= deferred.Allocate(4) == 0 && !deferred.CanAllocate(1);
+        fenced &= deferred.ReleaseCompleted([](uint64_t f) { return f <= 11; }) == 4;
+        fenced &= deferred.GetStats().PeakAllocated == 8 && deferred.GetStats().Pending == 0;
+        passed &= Report("fence deferred reuse", fenced);
+
+        // A fragmented free list reports it
+        RangeAllocator fragmented(8);
+        for (uint32_t i = 0; i < 8; ++i)
+            fragmented.Allocate(1);
+        for (uint32_t i = 0; i < 8; i += 2)
+            fragmented.Free(i, 1);
+        RangeAllocator::Stats stats = fragmented.GetStats();
+        passed &= Report("fragmentation", stats.NumFreeRanges == 4 && stats.LargestFreeRange == 1 &&
+            stats.GetFragmentation() == 0.75f && !fragmented.CanAllocate(2));
+
+        return passed;
+    }
+
+    // Textures stream in and out with a descriptor each while materials take tables of five.
+    // Compares descriptors consumed against the linear allocator this replaced, which never
+    // reuses anything.
+    void Benchmark(uint32_t capacity, uint32_t numOperations, uint32_t seed)
+    {
+        mt19937 rng(seed);
+        RangeAllocator allocator(capacity);
+        vector<Allocation> live;
+        live.reserve(capacity);
+
+        uint64_t fence = 1;
+        uint64_t linearConsumed = 0;
+        uint32_t failed = 0;
+
+        auto start = chrono::high_resolution_clock::now();
+        for (uint32_t op = 0; op < numOperations; ++op)
+        {
+            // Keep the heap around three quarters full
+            if (live.empty() || (live.size() < capacity / 2 && rng() % 2 == 0) || rng() % 3 == 0)
+            {
+                const uint32_t count = rng() % 8 == 0 ? 5 : 1;
+                const uint32_t offset = allocator.Allocate(count);
+                linearConsumed += count;
+                if (offset == RangeAllocator::kInvalidOffset)
+                    ++failed;
+                else
+                    live.push_back({ offset, count });
+            }
+            else
+            {
+                const size_t index = rng() % live.size();
+                allocator.FreeDeferred(live[index].Offset, live[index].Count, fence);
+                live[index] = live.back();
+                live.pop_back();
+            }
+
+            if ((op & 63) == 0)
+            {
+                ++fence;
+                allocator.ReleaseCompleted([&](uint64_t f) { return f + 2 <= fence; });
+            }
+        }
+        const double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+        RangeAllocator::Stats stats = allocator.GetStats();
+        printf("\n%u operations on %u slots:\n", numOperations, capacity);
+        printf("%-20s %10.3f ms (%.1f ns per operation)\n", "RangeAllocator", ms, ms * 1e6 / numOperations);
+        printf("%-20s %10u slots (peak), %u failed\n", "  in use", stats.PeakAllocated, failed);
+        printf("%-20s %10u ranges, largest %u, fragmentation %.2f\n", "  free", stats.NumFreeRanges,
+            stats.LargestFreeRange, stats.GetFragmentation());
+        printf("%-20s %10llu slots (%llu heaps of 256)\n", "linear allocator", (unsigned long long)linearConsumed,
+            (unsigned long long)((linearConsumed + 255) / 256));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t capacity = 4096;
+    uint32_t numOperations = 1000000;
+    uint32_t seed = 1;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (arg + 1 < argc && strcmp("-capacity", argv[arg]) == 0)
+            capacity = max(atoi(argv[++arg]), 16);
+        else if (arg + 1 < argc && strcmp("-operations", argv[arg]) == 0)
+            numOperations = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-seed", argv[arg]) == 0)
+            seed = (uint32_t)atoi(argv[++arg]);
+        else
+        {
+            printf(
+                "Usage:  %s [options]*\n\n"
+                "Options:\n\n"
+                "-capacity <integer>\n\tSlots in the benchmarked heap.\n\tDefaults to 4096.\n"
+                "-operations <integer>\n\tAllocations and frees in the benchmark.\n\tDefaults to 1000000.\n"
+                "-seed <integer>\n\tRandom seed of the fuzz test and benchmark.\n\tDefaults to 1.\n\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    bool passed = CheckBasics();
+    passed &= Fuzz(256, 200000, 8, seed, "fuzz, descriptor heap page");
+    passed &= Fuzz(4096, 200000, 64, seed + 1, "fuzz, scene texture heap");
+    passed &= Fuzz(64, 200000, 16, seed + 2, "fuzz, nearly full");
+
+    Benchmark(capacity, numOperations, seed);
+
+    return passed ? 0 : 1;
+}
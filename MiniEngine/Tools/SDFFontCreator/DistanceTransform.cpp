@@ -0,0 +1,288 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "DistanceTransform.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace DistanceTransform;
+
+//
+// Coordinates are in half canvas pixels. The center of output texel x is at 32x + 15, and
+// canvas pixel px is sampled at 2px, so every offset is odd and every squared distance is an
+// exact integer. Only pixels with non-negative coordinates are searched.
+//
+
+namespace
+{
+    const uint32_t kInfinite = 0xFFFFFFFF;
+
+    inline bool IsInside(const Canvas& canvas, uint32_t x, uint32_t y)
+    {
+        uint32_t left = x * 16 + 7;
+        uint32_t top = y * 16 + 7;
+
+        return ReadCanvasBit(canvas, left, top) & ReadCanvasBit(canvas, left + 1, top) &
+            ReadCanvasBit(canvas, left, top + 1) & ReadCanvasBit(canvas, left + 1, top + 1);
+    }
+
+    inline float Normalize(uint32_t bestDistSq, uint32_t radius)
+    {
+        return sqrt((float)bestDistSq) / (float)radius;
+    }
+
+    float DistanceFromInside(const Canvas& canvas, uint32_t xCoord, uint32_t yCoord, uint32_t radius)
+    {
+        const uint32_t x0 =    xCoord * 32 + 15;
+        const uint32_t y0 =    yCoord * 32 + 15;
+
+        uint32_t left =        (uint32_t)max(0, (int32_t)(x0 - radius + 1));
+        uint32_t right =    x0 + radius - 1;
+        uint32_t top =        (uint32_t)max(0, (int32_t)(y0 - radius + 1));
+        uint32_t bottom =    y0 + radius - 1;
+
+        uint32_t bestDistSq = radius * radius;
+
+        for (uint32_t y1 = top; y1 <= bottom; y1 += 2)
+        {
+            int32_t distY = (int32_t)(y1 - y0);
+            uint32_t distYSq = (uint32_t)(distY * distY);
+
+            if (distYSq >= bestDistSq)
+            {
+                if (y1 > y0)
+                    continue;
+                else
+                    break;
+            }
+
+            for (uint32_t x1 = left; x1 <= right; x1 += 2)
+            {
+                int32_t distX = (int32_t)(x1 - x0);
+                uint32_t distXSq = (uint32_t)(distX * distX);
+
+                uint32_t distSq = (uint32_t)(distXSq + distYSq);
+                if (distSq < bestDistSq && !ReadCanvasBit(canvas, x1 >> 1, y1 >> 1))
+                    bestDistSq = distSq;
+            }
+        }
+
+        return Normalize(bestDistSq, radius);
+    }
+
+    float DistanceFromOutside(const Canvas& canvas, uint32_t xCoord, uint32_t yCoord, uint32_t radius)
+    {
+        const uint32_t x0 =    xCoord * 32 + 15;
+        const uint32_t y0 =    yCoord * 32 + 15;
+
+        uint32_t left =        (uint32_t)max(0, (int32_t)(x0 - radius + 1));
+        uint32_t right =    x0 + radius - 1;
+        uint32_t top =        (uint32_t)max(0, (int32_t)(y0 - radius + 1));
+        uint32_t bottom =    y0 + radius - 1;
+
+        uint32_t bestDistSq = radius * radius;
+
+        for (uint32_t y1 = top; y1 <= bottom; y1 += 2)
+        {
+            int32_t distY = (int32_t)(y1 - y0);
+            uint32_t distYSq = (uint32_t)(distY * distY);
+
+            if (distYSq >= bestDistSq)
+            {
+                if (y1 > y0)
+                    continue;
+                else
+                    break;
+            }
+
+            for (uint32_t x1 = left; x1 <= right; x1 += 2)
+            {
+                int32_t distX = (int32_t)(x1 - x0);
+                uint32_t distXSq = (uint32_t)(distX * distX);
+
+                uint32_t distSq = (uint32_t)(distXSq + distYSq);
+                if (distSq < bestDistSq && ReadCanvasBit(canvas, x1 >> 1, y1 >> 1))
+                    bestDistSq = distSq;
+            }
+        }
+
+        return Normalize(bestDistSq, radius);
+    }
+}
+
+void DistanceTransform::ComputeSignedDistancesBruteForce(const Canvas& canvas, uint32_t width, uint32_t height,
+    uint32_t maxDistance, float* output, uint32_t outputPitch)
+{
+    const uint32_t radius = maxDistance * 32;
+
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            if (IsInside(canvas, x, y))
+                output[x + y * outputPitch] = +DistanceFromInside(canvas, x, y, radius);
+            else
+                output[x + y * outputPitch] = -DistanceFromOutside(canvas, x, y, radius);
+        }
+    }
+}
+
+void DistanceTransform::ComputeSignedDistances(const Canvas& canvas, uint32_t width, uint32_t height,
+    uint32_t maxDistance, float* output, uint32_t outputPitch, Scratch& scratch)
+{
+    if (width == 0 || height == 0)
+        return;
+
+    const uint32_t radius = maxDistance * 32;
+    const uint32_t radiusSq = radius * radius;
+
+    // Every pixel that the brute force search window of some texel can reach
+    const uint32_t numColumns = (32 * (width - 1) + 15 + radius - 1) / 2 + 1;
+    const uint32_t numRows = (32 * (height - 1) + 15 + radius - 1) / 2 + 1;
+
+    scratch.pixels.resize((size_t)numColumns * numRows);
+    for (uint32_t py = 0; py < numRows; ++py)
+    {
+        uint8_t* row = scratch.pixels.data() + (size_t)py * numColumns;
+        for (uint32_t px = 0; px < numColumns; ++px)
+            row[px] = ReadCanvasBit(canvas, px, py) ? 1 : 0;
+    }
+
+    // Pass 1: per canvas column and texel row, the squared vertical distance to the nearest
+    // pixel of each kind in that column. Texel row y lies between pixel rows 16y + 7 and 16y + 8.
+    for (int kind = 0; kind < 2; ++kind)
+        scratch.columnDistSq[kind].assign((size_t)height * numColumns, kInfinite);
+
+    for (uint32_t px = 0; px < numColumns; ++px)
+    {
+        int64_t nearestAbove[2] = { -1, -1 };
+        uint32_t y = 0;
+        for (uint32_t py = 0; py < numRows && y < height; ++py)
+        {
+            nearestAbove[scratch.pixels[(size_t)py * numColumns + px]] = py;
+
+            if (py == 16 * y + 7)
+            {
+                for (int kind = 0; kind < 2; ++kind)
+                {
+                    if (nearestAbove[kind] >= 0)
+                    {
+                        const uint32_t d = 32 * y + 15 - 2 * (uint32_t)nearestAbove[kind];
+                        scratch.columnDistSq[kind][(size_t)y * numColumns + px] = d * d;
+                    }
+                }
+                ++y;
+            }
+        }
+
+        int64_t nearestBelow[2] = { -1, -1 };
+        y = height;
+        for (uint32_t py = numRows; py-- > 0 && y > 0; )
+        {
+            nearestBelow[scratch.pixels[(size_t)py * numColumns + px]] = py;
+
+            if (py == 16 * (y - 1) + 8)
+            {
+                --y;
+                for (int kind = 0; kind < 2; ++kind)
+                {
+                    if (nearestBelow[kind] >= 0)
+                    {
+                        const uint32_t d = 2 * (uint32_t)nearestBelow[kind] - (32 * y + 15);
+                        uint32_t& distSq = scratch.columnDistSq[kind][(size_t)y * numColumns + px];
+                        distSq = min(distSq, d * d);
+                    }
+                }
+            }
+        }
+    }
+
+    // Pass 2: per texel row, the lower envelope of the parabolas (q - 2px)^2 + columnDistSq
+    // evaluated at every texel center q
+    scratch.hull.resize(numColumns);
+    scratch.bounds.resize(numColumns);
+    for (int kind = 0; kind < 2; ++kind)
+        scratch.rowDistSq[kind].resize(width);
+    uint32_t* best[2] = { scratch.rowDistSq[0].data(), scratch.rowDistSq[1].data() };
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (int kind = 0; kind < 2; ++kind)
+        {
+            const uint32_t* f = scratch.columnDistSq[kind].data() + (size_t)y * numColumns;
+            uint32_t* hull = scratch.hull.data();
+            double* bounds = scratch.bounds.data();
+
+            // Build the envelope from left to right, skipping columns without pixels of this kind
+            int32_t k = -1;
+            for (uint32_t px = 0; px < numColumns; ++px)
+            {
+                if (f[px] == kInfinite)
+                    continue;
+
+                double s = 0.0;
+                while (k >= 0)
+                {
+                    const uint32_t qx = hull[k];
+                    const double a = (double)f[px] + 4.0 * px * px;
+                    const double b = (double)f[qx] + 4.0 * qx * qx;
+                    s = (a - b) / (4.0 * ((double)px - qx));
+                    if (s > bounds[k])
+                        break;
+                    --k;
+                }
+
+                ++k;
+                hull[k] = px;
+                bounds[k] = k == 0 ? -1e300 : s;
+            }
+
+            // Query texel centers from left to right
+            int32_t h = 0;
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                if (k < 0)
+                {
+                    best[kind][x] = radiusSq;
+                    continue;
+                }
+
+                const double q = 32.0 * x + 15.0;
+                while (h < k && bounds[h + 1] < q)
+                    ++h;
+
+                const int64_t dx = (int64_t)q - 2 * (int64_t)hull[h];
+                const uint64_t distSq = (uint64_t)(dx * dx) + f[hull[h]];
+                best[kind][x] = (uint32_t)min<uint64_t>(distSq, radiusSq);
+            }
+        }
+
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            // Inside texels measure to unset pixels (kind 0), outside texels to set pixels
+            if (IsInside(canvas, x, y))
+                output[x + y * outputPitch] = +Normalize(best[0][x], radius);
+            else
+                output[x + y * outputPitch] = -Normalize(best[1][x], radius);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+//
+// Signed distance fields for SDFFontCreator.
+//
+// Glyphs are rendered at 16 times the output resolution. Every output texel measures the
+// distance from its center to the nearest canvas pixel of the other kind: unset pixels when
+// the texel is inside the glyph, set pixels otherwise. Distances are normalized by the search
+// radius and clamped to 1.
+//
+// ComputeSignedDistances is an exact Euclidean distance transform (Felzenszwalb and
+// Huttenlocher): a pass down every canvas column followed by a lower envelope of parabolas
+// along every output row. Its cost is linear in the number of canvas pixels, independent of
+// the radius. ComputeSignedDistancesBruteForce is the original windowed search, kept as the
+// reference. Both evaluate the same squared distances in the same integer units, so their
+// results are bit identical.
+//
+namespace DistanceTransform
+{
+    struct Canvas
+    {
+        const uint8_t* bitmap;  // 1 bit per pixel, most significant bit first
+        uint32_t pitch;         // Width in bytes of a row in the canvas
+        uint32_t width;         // Width in pixels of a row in the canvas
+        uint32_t rows;          // Number of rows in the canvas
+        uint32_t xOff;          // Amount to offset the x coordinate when reading
+        uint32_t yOff;          // Amount to offset the y coordinate when reading
+    };
+
+    // Access the high res glyph canvas
+    inline bool ReadCanvasBit( const Canvas& canvas, uint32_t x, uint32_t y )
+    {
+        // Notice that negative values have been cast to large positive values
+        x -= canvas.xOff;
+        y -= canvas.yOff;
+        if (x >= canvas.width || y >= canvas.rows)
+            return false;
+
+        uint32_t p = y * canvas.pitch + x / 8;
+        uint32_t k = x & 7;
+        return (canvas.bitmap[p] & (0x80 >> k)) ? true : false;
+    }
+
+    // Buffers reused between glyphs
+    struct Scratch
+    {
+        std::vector<uint8_t> pixels;
+        std::vector<uint32_t> columnDistSq[2];
+        std::vector<uint32_t> rowDistSq[2];
+        std::vector<uint32_t> hull;
+        std::vector<double> bounds;
+    };
+
+    // Writes 'width' x 'height' texels to 'output' with rows 'outputPitch' floats apart.
+    // 'maxDistance' is the search radius in output texels.
+    void ComputeSignedDistances(const Canvas& canvas, uint32_t width, uint32_t height, uint32_t maxDistance,
+        float* output, uint32_t outputPitch, Scratch& scratch);
+
+    void ComputeSignedDistancesBruteForce(const Canvas& canvas, uint32_t width, uint32_t height, uint32_t maxDistance,
+        float* output, uint32_t outputPitch);
+}
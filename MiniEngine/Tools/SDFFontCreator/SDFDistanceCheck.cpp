@@ -0,0 +1,149 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Bakes random glyph canvases with the exact distance transform and the original brute force
+// search. The float results must be bit identical, at several radii and with canvases that
+// are offset, clipped by the border, empty or completely filled.
+//
+
+#include "DistanceTransform.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace DistanceTransform;
+
+namespace
+{
+    struct Glyph
+    {
+        vector<uint8_t> bits;
+        Canvas canvas;
+        uint32_t width;     // Output texels, including the border
+        uint32_t height;
+    };
+
+    // Random blobs at 16 times the output resolution, like a rendered glyph
+    Glyph MakeGlyph(uint32_t width, uint32_t height, uint32_t border, uint32_t numBlobs, mt19937& rng)
+    {
+        Glyph g;
+        g.width = width + border * 2;
+        g.height = height + border * 2;
+
+        const uint32_t canvasWidth = width * 16, canvasRows = height * 16 + 24;
+        g.canvas.pitch = (canvasWidth + 7) / 8;
+        g.canvas.width = canvasWidth;
+        g.canvas.rows = canvasRows;
+        g.canvas.xOff = border * 16;
+        g.canvas.yOff = border * 16 - 12;   // Taller than the box, like glyphs with accents
+        g.bits.assign((size_t)g.canvas.pitch * canvasRows, 0);
+
+        uniform_real_distribution<float> unit(0.0f, 1.0f);
+        for (uint32_t b = 0; b < numBlobs; ++b)
+        {
+            const float cx = unit(rng) * canvasWidth, cy = unit(rng) * canvasRows;
+            const float rx = 4.0f + unit(rng) * canvasWidth / 3, ry = 4.0f + unit(rng) * canvasRows / 3;
+            const bool hole = b > 0 && rng() % 3 == 0;
+
+            for (uint32_t y = 0; y < canvasRows; ++y)
+            {
+                for (uint32_t x = 0; x < canvasWidth; ++x)
+                {
+                    const float dx = (x - cx) / rx, dy = (y - cy) / ry;
+                    if (dx * dx + dy * dy > 1.0f)
+                        continue;
+
+                    uint8_t& byte = g.bits[y * g.canvas.pitch + x / 8];
+                    if (hole)
+                        byte &= ~(0x80 >> (x & 7));
+                    else
+                        byte |= 0x80 >> (x & 7);
+                }
+            }
+        }
+
+        g.canvas.bitmap = g.bits.data();
+        return g;
+    }
+
+    bool Compare(const char* name, const Glyph& g, uint32_t maxDistance, Scratch& scratch,
+        double& exactMs, double& bruteForceMs)
+    {
+        vector<float> exact(g.width * g.height, 2.0f), reference(g.width * g.height, 2.0f);
+
+        auto start = chrono::high_resolution_clock::now();
+        ComputeSignedDistances(g.canvas, g.width, g.height, maxDistance, exact.data(), g.width, scratch);
+        auto mid = chrono::high_resolution_clock::now();
+        ComputeSignedDistancesBruteForce(g.canvas, g.width, g.height, maxDistance, reference.data(), g.width);
+        auto end = chrono::high_resolution_clock::now();
+
+        exactMs += chrono::duration<double, milli>(mid - start).count();
+        bruteForceMs += chrono::duration<double, milli>(end - mid).count();
+
+        if (memcmp(exact.data(), reference.data(), exact.size() * sizeof(float)) == 0)
+            return true;
+
+        float maxError = 0.0f;
+        for (size_t i = 0; i < exact.size(); ++i)
+            maxError = max(maxError, fabs(exact[i] - reference[i]));
+        printf("FAILED %s (radius %u, %ux%u): max error %g\n", name, maxDistance, g.width, g.height, maxError);
+        return false;
+    }
+}
+
+int main()
+{
+    bool passed = true;
+    mt19937 rng(11);
+    Scratch scratch;
+
+    const uint32_t radii[] = { 1, 2, 4, 8 };
+    for (uint32_t maxDistance : radii)
+    {
+        double exactMs = 0.0, bruteForceMs = 0.0;
+        bool allPassed = true;
+
+        for (uint32_t i = 0; i < 40; ++i)
+        {
+            const uint32_t border = i % 5 == 0 ? 0 : maxDistance;
+            Glyph g = MakeGlyph(1 + rng() % 24, 1 + rng() % 32, border, 1 + rng() % 6, rng);
+            allPassed &= Compare("random glyph", g, maxDistance, scratch, exactMs, bruteForceMs);
+        }
+
+        Glyph empty = MakeGlyph(8, 12, maxDistance, 0, rng);
+        allPassed &= Compare("empty glyph", empty, maxDistance, scratch, exactMs, bruteForceMs);
+
+        Glyph full = MakeGlyph(8, 12, 0, 0, rng);
+        for (uint8_t& byte : full.bits)
+            byte = 0xFF;
+        allPassed &= Compare("filled glyph", full, maxDistance, scratch, exactMs, bruteForceMs);
+
+        printf("%s radius %u: exact %.1f ms, brute force %.1f ms\n", allPassed ? "Passed" : "FAILED",
+            maxDistance, exactMs, bruteForceMs);
+        passed &= allPassed;
+    }
+
+    return passed ? 0 : 1;
+}
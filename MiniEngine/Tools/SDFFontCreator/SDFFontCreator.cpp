@@ -3,19 +3,28 @@
 #include <cmath>
 #include <ft2build.h>
 #include <cstdint>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
 #include <thread>
 #include <vector>
 #include <algorithm>
-#include <intrin.h>
 
 #include FT_FREETYPE_H
 
+#include "DistanceTransform.h"
+
 #define kMajorVersion    1
 #define kMinorVersion    0
 
 #define kMaxTextureDimension 4096
 
 using namespace std;
+using namespace DistanceTransform;
 
 template <typename T> inline T align16( T val ) { return (val + 15) & ~15; }
 
@@ -29,8 +38,8 @@ struct GlyphInfo
     uint16_t advance;   // The total distance to advance the pen after printing
 };
 
-__declspec(thread) FT_Library g_FreeTypeLib = 0;    // FreeType2 library wrapper
-__declspec(thread) FT_Face g_FreeTypeFace = 0;      // FreeType2 typeface
+thread_local FT_Library g_FreeTypeLib = 0;     // FreeType2 library wrapper
+thread_local FT_Face g_FreeTypeFace = 0;        // FreeType2 typeface
 uint16_t g_numGlyphs = 0;       // Number of glyphs to process
 GlyphInfo g_glyphs[0xFFFF];     // An array of glyph information
 uint16_t g_borderSize = 0;      // Extra space around each glyph used for effects like glow and drop shadow
@@ -39,12 +48,14 @@ bool g_fixNumberWidths = false; // Prints all numbers with fixed spacing
 uint16_t g_maxGlyphHeight = 0;  // Max height of glyph = ascender - descender
 int16_t g_fontOffset = 0;       // Baseline offset to center the text vertically
 uint16_t g_fontAdvanceY = 0;    // Distance from baseline to baseline (line height)
+bool g_bruteForceSearch = false; // Bake with the original windowed search, for comparison
 
 float* g_DistanceMap = 0;
 uint32_t g_MapWidth = 0;
 uint32_t g_MapHeight = 0;
-volatile int32_t g_nextGlyphIdx = 0;
-volatile bool g_ReadyToPaint = false;
+vector<uint16_t> g_paintOrder;  // Glyph indices, largest first
+atomic<uint32_t> g_nextGlyphIdx(0);
+atomic<bool> g_ReadyToPaint(false);
 
 void PrintAssertMessage( const char* file, uint32_t line, const char* cond, const char* msg, ...)
 {
@@ -59,11 +70,17 @@ void PrintAssertMessage( const char* file, uint32_t line, const char* cond, cons
     }
 }
 
+#ifdef _MSC_VER
+#define DEBUG_BREAK() __debugbreak()
+#else
+#define DEBUG_BREAK() abort()
+#endif
+
 // Assert which allows setting of file and line number
 #define ASSERT_LINE( test, file, line, ... ) \
     if (!(test)) { \
         PrintAssertMessage(file, line, #test, ##__VA_ARGS__); \
-        __debugbreak(); \
+        DEBUG_BREAK(); \
     }
 
 // Assert which automatically detects call location
@@ -90,11 +107,11 @@ void InitializeFont( const char* filename = 0, uint32_t size = 0)
     try
     {
         if (FT_Init_FreeType( &g_FreeTypeLib ))
-            throw exception("Failed to create library\n");
+            throw runtime_error("Failed to create library\n");
         if (FT_New_Face( g_FreeTypeLib, filename, 0, &g_FreeTypeFace ))
-            throw exception("Failed to create face\n");
+            throw runtime_error("Failed to create face\n");
         if (FT_Set_Pixel_Sizes( g_FreeTypeFace, 0, size ))
-            throw exception("Failed to set pixel sizes\n");
+            throw runtime_error("Failed to set pixel sizes\n");
     }
     catch (exception& e)
     {
@@ -118,30 +135,6 @@ void ShutdownFont(void)
         FT_Done_FreeType( g_FreeTypeLib );
 }
 
-struct Canvas
-{
-    uint8_t* bitmap;    // Pointer to rendered glyph memory (from FT_Bitmap)
-    uint32_t pitch;        // Width in bytes of a row in the canvas
-    uint32_t width;        // Width in pixels of a row in the canvas
-    uint32_t rows;        // Number of rows in the canvas
-    uint32_t xOff;        // Amount to offset the x coordinate when reading
-    uint32_t yOff;        // Amount to offset the y coordinate when reading
-};
-
-// Access the high res glyph canvas
-inline bool ReadCanvasBit( const Canvas& canvas, uint32_t x, uint32_t y )
-{
-    // Notice that negative values have been cast to large positive values
-    x -= canvas.xOff;
-    y -= canvas.yOff;
-    if (x >= canvas.width || y >= canvas.rows)
-        return false;
-
-    uint32_t p = y * canvas.pitch + x / 8;
-    uint32_t k = x & 7;
-    return (canvas.bitmap[p] & (0x80 >> k)) ? true : false;
-}
-
 // Setup pixel reads from the glyph canvas
 inline Canvas LoadCanvas(FT_GlyphSlot glyph)
 {
@@ -155,91 +148,11 @@ inline Canvas LoadCanvas(FT_GlyphSlot glyph)
     return ret;
 }
 
-float DistanceFromInside(const Canvas& canvas, uint32_t xCoord, uint32_t yCoord)
-{
-    const uint32_t radius = g_maxDistance * 32;
-    const uint32_t x0 =    xCoord * 32 + 15;
-    const uint32_t y0 =    yCoord * 32 + 15;
-
-    uint32_t left =        (uint32_t)max(0, (int32_t)(x0 - radius + 1));
-    uint32_t right =    x0 + radius - 1;
-    uint32_t top =        (uint32_t)max(0, (int32_t)(y0 - radius + 1));
-    uint32_t bottom =    y0 + radius - 1;
-
-    uint32_t bestDistSq = radius * radius;
-
-    for (uint32_t y1 = top; y1 <= bottom; y1 += 2)
-    {
-        int32_t distY = (int32_t)(y1 - y0);
-        uint32_t distYSq = (uint32_t)(distY * distY);
-
-        if (distYSq >= bestDistSq)
-        {
-            if (y1 > y0)
-                continue;
-            else
-                break;
-        }
-
-        for (uint32_t x1 = left; x1 <= right; x1 += 2)
-        {
-            int32_t distX = (int32_t)(x1 - x0);
-            uint32_t distXSq = (uint32_t)(distX * distX);
-
-            uint32_t distSq = (uint32_t)(distXSq + distYSq);
-            if (distSq < bestDistSq && !ReadCanvasBit(canvas, x1 >> 1, y1 >> 1))
-                bestDistSq = distSq;
-        }
-    }
-
-    return sqrt((float)bestDistSq) / (float)radius;
-}
-
-float DistanceFromOutside(const Canvas& canvas, uint32_t xCoord, uint32_t yCoord)
-{
-    const uint32_t radius = g_maxDistance * 32;
-    const uint32_t x0 =    xCoord * 32 + 15;
-    const uint32_t y0 =    yCoord * 32 + 15;
-
-    uint32_t left =        (uint32_t)max(0, (int32_t)(x0 - radius + 1));
-    uint32_t right =    x0 + radius - 1;
-    uint32_t top =        (uint32_t)max(0, (int32_t)(y0 - radius + 1));
-    uint32_t bottom =    y0 + radius - 1;
-
-    uint32_t bestDistSq = radius * radius;
-
-    for (uint32_t y1 = top; y1 <= bottom; y1 += 2)
-    {
-        int32_t distY = (int32_t)(y1 - y0);
-        uint32_t distYSq = (uint32_t)(distY * distY);
-
-        if (distYSq >= bestDistSq)
-        {
-            if (y1 > y0)
-                continue;
-            else
-                break;
-        }
-
-        for (uint32_t x1 = left; x1 <= right; x1 += 2)
-        {
-            int32_t distX = (int32_t)(x1 - x0);
-            uint32_t distXSq = (uint32_t)(distX * distX);
-
-            uint32_t distSq = (uint32_t)(distXSq + distYSq);
-            if (distSq < bestDistSq && ReadCanvasBit(canvas, x1 >> 1, y1 >> 1))
-                bestDistSq = distSq;
-        }
-    }
-
-    return sqrt((float)bestDistSq) / (float)radius;
-}
-
 // Get width and spacing of a given glyph to compute necessary space and layout in final texture.
 inline uint16_t GetGlyphMetrics( wchar_t c, GlyphInfo& info )
 {
     if (FT_Load_Char( g_FreeTypeFace, c, FT_LOAD_TARGET_MONO ))
-        throw exception("Unable to access glyph data");
+        throw runtime_error("Unable to access glyph data");
 
     FT_Glyph_Metrics& metrics = g_FreeTypeFace->glyph->metrics;
     info.bearing = (int16_t)(metrics.horiBearingX >> 6);
@@ -285,14 +198,18 @@ uint32_t UnwrapUVs(uint32_t textureWidth)
 
 void PaintCharacters( float* distanceMap, uint32_t width, uint32_t /*height*/ )
 {
-    int32_t i = -1;
-    while ((i = _InterlockedExchangeAdd((volatile long*)&g_nextGlyphIdx, 1)) < g_numGlyphs)
+    DistanceTransform::Scratch scratch;
+
+    // Threads take the next glyph when they finish one. Glyphs are handed out largest first, so
+    // a huge glyph is never the last one started while the other threads run out of work.
+    uint32_t i;
+    while ((i = g_nextGlyphIdx++) < g_numGlyphs)
     {
         // Get the character info
-        const GlyphInfo& ch = g_glyphs[i];
+        const GlyphInfo& ch = g_glyphs[g_paintOrder[i]];
 
         if (FT_Load_Char( g_FreeTypeFace, ch.c, FT_LOAD_RENDER | FT_LOAD_MONOCHROME | FT_LOAD_TARGET_MONO ))
-            throw exception("Character bitmap rendering failed internally");
+            throw runtime_error("Character bitmap rendering failed internally");
 
         Canvas canvas = LoadCanvas(g_FreeTypeFace->glyph);
 
@@ -302,22 +219,13 @@ void PaintCharacters( float* distanceMap, uint32_t width, uint32_t /*height*/ )
         uint32_t startY = ch.v / 16 - g_borderSize;
 
         // Convert high-res bitmap to low-res distance map
-        for (uint32_t x = 0; x < charWidth + g_borderSize * 2; ++x)
-        {
-            for (uint32_t y = 0; y < charHeight + g_borderSize * 2; ++y)
-            {
-                uint32_t left = x * 16 + 7;
-                uint32_t top = y * 16 + 7;
-
-                bool inside = ReadCanvasBit(canvas, left, top) & ReadCanvasBit(canvas, left + 1, top) &
-                    ReadCanvasBit(canvas, left, top + 1) & ReadCanvasBit(canvas, left + 1, top + 1);
-
-                if (inside)
-                    distanceMap[startX + x + (startY + y) * width] = +DistanceFromInside(canvas, x, y);
-                else
-                    distanceMap[startX + x + (startY + y) * width] = -DistanceFromOutside(canvas, x, y);
-            }
-        }
+        float* output = distanceMap + startX + startY * width;
+        if (g_bruteForceSearch)
+            ComputeSignedDistancesBruteForce(canvas, charWidth + g_borderSize * 2, charHeight + g_borderSize * 2,
+                g_maxDistance, output, width);
+        else
+            ComputeSignedDistances(canvas, charWidth + g_borderSize * 2, charHeight + g_borderSize * 2,
+                g_maxDistance, output, width, scratch);
     }
 }
 
@@ -361,7 +269,7 @@ void WritePreviewBMP(const string& fileName, const uint8_t* heightMap, uint32_t
 {
     // Append ".bmp" to file name
     char fileWithSuffix[256];
-    sprintf_s(fileWithSuffix, 256, "%s.bmp", fileName.c_str());
+    snprintf(fileWithSuffix, 256, "%s.bmp", fileName.c_str());
 
     // Open file
     ofstream file;
@@ -463,7 +371,14 @@ void CompileFont(const string& outputName)
 
     // We ran through all possibilities and still couldn't fit the font
     if (g_MapHeight > g_MapWidth)
-        throw exception("Texture dimensions exceeded maximum allowable");
+        throw runtime_error("Texture dimensions exceeded maximum allowable");
+
+    // All glyphs are as tall as the tallest, so the widest take the longest to paint
+    g_paintOrder.resize(g_numGlyphs);
+    for (uint16_t i = 0; i < g_numGlyphs; ++i)
+        g_paintOrder[i] = i;
+    stable_sort(g_paintOrder.begin(), g_paintOrder.end(),
+        [](uint16_t a, uint16_t b) { return g_glyphs[a].width > g_glyphs[b].width; });
 
     // Render the glyphs and generate heightmaps.  Place heightmaps in the
     // locations set aside in the texture.
@@ -471,9 +386,9 @@ void CompileFont(const string& outputName)
     for (size_t x = g_MapWidth * g_MapHeight; x > 0; --x)
         g_DistanceMap[x - 1] = -1.0f;
 
-    // Make sure all of the parameters are flushed to memory before we trigger the threads to paint.
-    __faststorefence();
+    auto paintStart = std::chrono::high_resolution_clock::now();
 
+    // The sequentially consistent store publishes all of the parameters to the waiting threads
     g_ReadyToPaint = true;
 
     // Also paint on the main thread
@@ -485,6 +400,9 @@ void CompileFont(const string& outputName)
         for_each( Threads.begin(), Threads.end(), []( std::thread& T ) { T.join(); } );
     }
 
+    printf("Painted %u glyphs in %.2f sec\n", g_numGlyphs,
+        std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - paintStart).count());
+
     uint8_t* compressedMap8 = new uint8_t[g_MapWidth * g_MapHeight];
 
     for (uint32_t i = 0; i < g_MapWidth * g_MapHeight; ++i)
@@ -497,7 +415,7 @@ void CompileFont(const string& outputName)
 
     // Append ".fnt" to file name
     char fileWithSuffix[256];
-    sprintf_s(fileWithSuffix, 256, "%s.fnt", outputName.c_str());
+    snprintf(fileWithSuffix, 256, "%s.fnt", outputName.c_str());
     ofstream file;
     file.exceptions(ios_base::failbit | ios_base::badbit);
     file.open(fileWithSuffix, ios_base::out | ios_base::binary | ios_base::trunc);
@@ -544,7 +462,7 @@ void CompileFont(const string& outputName)
     printf("Finished creating %s\n", fileWithSuffix);
 }
 
-void main( int argc, const char** argv )
+int main( int argc, const char** argv )
 {
     string inputFile = "";
     string outputName = "";
@@ -555,16 +473,16 @@ void main( int argc, const char** argv )
     try
     {
         if (argc < 2)
-            throw exception("No font file specified");
+            throw runtime_error("No font file specified");
         inputFile = argv[1];
 
         for (int arg = 2; arg < argc; ++arg)
         {
             if (argv[arg][0] != '-')
-                throw exception("Malformed option");
+                throw runtime_error("Malformed option");
 
             if (arg + 1 == argc)
-                throw exception("Missing operand");
+                throw runtime_error("Missing operand");
             else if (strcmp("-size", argv[arg]) == 0)
                 size = atoi(argv[++arg]);
             else if (strcmp("-output", argv[arg]) == 0)
@@ -575,8 +493,18 @@ void main( int argc, const char** argv )
                 g_borderSize = (uint16_t)atoi(argv[++arg]);
             else if (strcmp("-radius", argv[arg]) == 0)
                 g_maxDistance = (uint16_t)atoi(argv[++arg]);
+            else if (strcmp("-search", argv[arg]) == 0)
+            {
+                ++arg;
+                if (strcmp("exact", argv[arg]) == 0)
+                    g_bruteForceSearch = false;
+                else if (strcmp("brute_force", argv[arg]) == 0)
+                    g_bruteForceSearch = true;
+                else
+                    throw runtime_error("Invalid search method");
+            }
             else
-                throw exception("Invalid option");
+                throw runtime_error("Invalid option");
         }
     }
     catch (exception& e)
@@ -591,15 +519,16 @@ void main( int argc, const char** argv )
             "-size <integer>\n\tThe font pixel resolution.\n"
             "-radius <integer>\n\tThe search radius.\n\tDefaults to font size / 8.\n"
             "-border_size <integer>\n\tExtra spacing around glyphs for various effects.\n\tDefaults to the search radius.\n"
+            "-search <\"exact\" | \"brute_force\">\n\tThe distance search. Both give identical results; the brute force\n\twindowed search is much slower and kept for comparison.\n\tDefaults to exact.\n"
             "\n\nExample:  %s myfont.ttf -character_set Japanese.txt -output japanese\n\n", e.what(), argv[0], argv[0]);
-        return;
+        return 1;
     }
 
     if (outputName.length() == 0)
     {
         outputName = inputFile.substr(0, inputFile.rfind('.'));
         char sizeAsString[128];
-        sprintf_s(sizeAsString, 128, "%u", size);
+        snprintf(sizeAsString, 128, "%u", size);
         outputName += sizeAsString;
     }
 
@@ -609,7 +538,9 @@ void main( int argc, const char** argv )
     if (g_borderSize == 0)
         g_borderSize = g_maxDistance;
 
-    if (_strcmpi(characterSet.c_str(), "extended") == 0)
+    string lowerCharacterSet = characterSet;
+    transform(lowerCharacterSet.begin(), lowerCharacterSet.end(), lowerCharacterSet.begin(), ::tolower);
+    if (lowerCharacterSet == "extended")
     {
         characterSet = "ASCII";
         extendedASCII = true;
@@ -699,4 +630,5 @@ void main( int argc, const char** argv )
     }
 
     ShutdownFont();
+    return 0;
 }
@@ -0,0 +1,323 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Compares the level order scene graph update against the original depth first traversal
+// with a matrix stack, on random graphs of every shape. World matrices, bounding sphere
+// transforms and joint matrices must match bit for bit, with any number of threads.
+//
+
+#include "../../Model/SceneGraphSchedule.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    struct Matrix
+    {
+        float m[4][4];  // Columns
+    };
+
+    Matrix Multiply(const Matrix& a, const Matrix& b)
+    {
+        Matrix r;
+        for (int c = 0; c < 4; ++c)
+        {
+            for (int i = 0; i < 4; ++i)
+                r.m[c][i] = ((a.m[0][i] * b.m[c][0] + a.m[1][i] * b.m[c][1]) + a.m[2][i] * b.m[c][2]) + a.m[3][i] * b.m[c][3];
+        }
+        return r;
+    }
+
+    // Stands in for the bounding sphere scale of the parent
+    float SphereScale(const Matrix& parent)
+    {
+        float s = 0.0f;
+        for (int c = 0; c < 3; ++c)
+            s = max(s, parent.m[c][0] * parent.m[c][0] + parent.m[c][1] * parent.m[c][1] + parent.m[c][2] * parent.m[c][2]);
+        return sqrt(s);
+    }
+
+    struct Node
+    {
+        Matrix xform;
+        uint32_t matrixIdx;
+        bool hasSibling;
+        bool hasChildren;
+        bool skeletonRoot;
+    };
+
+    struct Result
+    {
+        vector<Matrix> world;   // By matrix index
+        vector<float> scales;
+        vector<Matrix> joints;
+    };
+
+    // Random tree in depth first layout. 'maxChildren' controls the shape: 1 gives a chain.
+    // A depth first walk writes the layout. Entry numNodes of 'children' is the virtual root.
+    vector<Node> LayoutGraph(const vector<vector<uint32_t>>& children, mt19937& rng)
+    {
+        const uint32_t numNodes = (uint32_t)children.size() - 1;
+        uniform_real_distribution<float> value(-1.0f, 1.0f);
+        vector<Node> nodes;
+        nodes.reserve(numNodes);
+
+        vector<pair<uint32_t, uint32_t>> stack = { { numNodes, 0 } };   // Node, next child
+        while (!stack.empty())
+        {
+            pair<uint32_t, uint32_t>& top = stack.back();
+            if (top.second == children[top.first].size())
+            {
+                stack.pop_back();
+                continue;
+            }
+
+            const uint32_t child = children[top.first][top.second++];
+            Node node;
+            for (auto& column : node.xform.m)
+                for (float& v : column)
+                    v = value(rng);
+            node.matrixIdx = 0;
+            node.hasSibling = top.second < children[top.first].size();
+            node.hasChildren = !children[child].empty();
+            node.skeletonRoot = rng() % 16 == 0;
+            nodes.push_back(node);
+            stack.push_back({ child, 0 });
+        }
+
+        // Matrix indices are a permutation, as with models that share meshes between nodes
+        vector<uint32_t> indices(numNodes);
+        for (uint32_t i = 0; i < numNodes; ++i)
+            indices[i] = i;
+        shuffle(indices.begin(), indices.end(), rng);
+        for (uint32_t i = 0; i < numNodes; ++i)
+            nodes[i].matrixIdx = indices[i];
+
+        return nodes;
+    }
+
+    vector<Node> MakeGraph(uint32_t numNodes, uint32_t maxChildren, uint32_t numRoots, mt19937& rng)
+    {
+        vector<vector<uint32_t>> children(numNodes + 1);
+        for (uint32_t i = 0; i < numNodes; ++i)
+        {
+            uint32_t parent = numNodes;
+            if (i >= numRoots)
+            {
+                do
+                    parent = rng() % i;
+                while (children[parent].size() >= maxChildren);
+            }
+            children[parent].push_back(i);
+        }
+        return LayoutGraph(children, rng);
+    }
+
+    // A chain, a wide level under its last node and another chain under the first node of that
+    // level, so levels too small to split come before and after one that is split
+    vector<Node> MakeChainAndWideLevel(uint32_t chainLength, uint32_t width, mt19937& rng)
+    {
+        const uint32_t numNodes = chainLength * 2 + width;
+        vector<vector<uint32_t>> children(numNodes + 1);
+        children[numNodes].push_back(0);
+        for (uint32_t i = 1; i < chainLength; ++i)
+            children[i - 1].push_back(i);
+        for (uint32_t i = 0; i < width; ++i)
+            children[chainLength - 1].push_back(chainLength + i);
+        children[chainLength].push_back(chainLength + width);
+        for (uint32_t i = chainLength + width + 1; i < numNodes; ++i)
+            children[i - 1].push_back(i);
+        return LayoutGraph(children, rng);
+    }
+
+    // The original ModelInstance::Update loop, with an unbounded matrix stack
+    void UpdateReference(const vector<Node>& graph, const Matrix& locator, const vector<uint32_t>& jointNodes, Result& result)
+    {
+        vector<Matrix> matrixStack;
+        Matrix ParentMatrix = locator;
+
+        for (const Node* node = graph.data(); ; ++node)
+        {
+            Matrix xform = node->xform;
+            if (!node->skeletonRoot)
+                xform = Multiply(ParentMatrix, xform);
+
+            result.world[node->matrixIdx] = xform;
+            result.scales[node->matrixIdx] = SphereScale(ParentMatrix);
+
+            if (node->hasChildren)
+            {
+                if (node->hasSibling)
+                    matrixStack.push_back(ParentMatrix);
+                ParentMatrix = xform;
+            }
+            else if (!node->hasSibling)
+            {
+                if (matrixStack.empty())
+                    break;
+
+                ParentMatrix = matrixStack.back();
+                matrixStack.pop_back();
+            }
+        }
+
+        for (size_t j = 0; j < jointNodes.size(); ++j)
+            result.joints[j] = Multiply(result.world[jointNodes[j]], locator);
+    }
+
+    void UpdateScheduled(const vector<Node>& graph, const SceneGraphSchedule::Schedule& schedule, const Matrix& locator,
+        const vector<uint32_t>& jointNodes, uint32_t numThreads, uint32_t minItemsPerThread, Result& result)
+    {
+        SceneGraphSchedule::Execute(schedule, numThreads, minItemsPerThread,
+            [&](const uint32_t* nodes, uint32_t count)
+            {
+                for (uint32_t n = 0; n < count; ++n)
+                {
+                    const Node& node = graph[nodes[n]];
+                    const uint32_t parent = schedule.Parents[nodes[n]];
+                    const Matrix& ParentMatrix = parent == SceneGraphSchedule::kNoParent ?
+                        locator : result.world[graph[parent].matrixIdx];
+
+                    Matrix xform = node.xform;
+                    if (!node.skeletonRoot)
+                        xform = Multiply(ParentMatrix, xform);
+
+                    result.world[node.matrixIdx] = xform;
+                    result.scales[node.matrixIdx] = SphereScale(ParentMatrix);
+                }
+            },
+            (uint32_t)jointNodes.size(),
+            [&](uint32_t begin, uint32_t end)
+            {
+                for (uint32_t j = begin; j < end; ++j)
+                    result.joints[j] = Multiply(result.world[jointNodes[j]], locator);
+            });
+    }
+
+    Result MakeResult(size_t numNodes, size_t numJoints)
+    {
+        Result r;
+        r.world.assign(numNodes, Matrix());
+        r.scales.assign(numNodes, 0.0f);
+        r.joints.assign(numJoints, Matrix());
+        return r;
+    }
+
+    bool Identical(const Result& a, const Result& b)
+    {
+        return a.world.size() == b.world.size() && a.scales.size() == b.scales.size() && a.joints.size() == b.joints.size() &&
+            (a.world.empty() || memcmp(a.world.data(), b.world.data(), a.world.size() * sizeof(Matrix)) == 0) &&
+            (a.scales.empty() || memcmp(a.scales.data(), b.scales.data(), a.scales.size() * sizeof(float)) == 0) &&
+            (a.joints.empty() || memcmp(a.joints.data(), b.joints.data(), a.joints.size() * sizeof(Matrix)) == 0);
+    }
+
+    bool CheckGraph(const char* name, const vector<Node>& graph, mt19937& rng, bool timed = false)
+    {
+        SceneGraphSchedule::Schedule schedule;
+        SceneGraphSchedule::Build(graph.data(), (uint32_t)graph.size(), schedule);
+
+        Matrix locator = {};
+        for (int i = 0; i < 4; ++i)
+            locator.m[i][i] = 1.5f;
+        locator.m[3][3] = 1.0f;
+
+        vector<uint32_t> jointNodes(graph.size() / 4);
+        for (uint32_t& j : jointNodes)
+            j = rng() % graph.size();
+
+        Result expected = MakeResult(graph.size(), jointNodes.size());
+        auto start = chrono::high_resolution_clock::now();
+        UpdateReference(graph, locator, jointNodes, expected);
+        double referenceMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+        bool passed = schedule.Order.size() == graph.size();
+        const uint32_t threadCounts[] = { 1, 3, 8 };
+        for (uint32_t numThreads : threadCounts)
+        {
+            Result actual = MakeResult(graph.size(), jointNodes.size());
+            start = chrono::high_resolution_clock::now();
+            UpdateScheduled(graph, schedule, locator, jointNodes, numThreads, timed ? 1024 : 4, actual);
+            double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+            passed &= Identical(expected, actual);
+            if (timed)
+                printf("  %u threads: %.2f ms (stack traversal %.2f ms)\n", numThreads, ms, referenceMs);
+        }
+
+        printf("%s %s (%zu nodes, %u levels)\n", passed ? "Passed" : "FAILED", name, graph.size(), schedule.GetNumLevels());
+        return passed;
+    }
+}
+
+int main()
+{
+    bool passed = true;
+    mt19937 rng(7);
+
+    passed &= CheckGraph("single node", MakeGraph(1, 4, 1, rng), rng);
+    passed &= CheckGraph("flat", MakeGraph(5000, 4, 5000, rng), rng);
+    passed &= CheckGraph("deep chain", MakeGraph(5000, 1, 1, rng), rng);
+    passed &= CheckGraph("binary tree", MakeGraph(20000, 2, 1, rng), rng);
+    passed &= CheckGraph("bushy forest", MakeGraph(20000, 64, 16, rng), rng);
+    passed &= CheckGraph("chain and wide level", MakeChainAndWideLevel(50, 1000, rng), rng);
+    passed &= CheckGraph("wide tree", MakeGraph(200000, 2000, 4, rng), rng, true);
+
+    // A typical model has no level wide enough to split, so it is updated without threads
+    {
+        vector<Node> graph = MakeGraph(4000, 8, 1, rng);
+        SceneGraphSchedule::Schedule schedule;
+        SceneGraphSchedule::Build(graph.data(), (uint32_t)graph.size(), schedule);
+
+        const thread::id caller = this_thread::get_id();
+        bool onCaller = true;
+        uint32_t numVisits = 0;
+        SceneGraphSchedule::Execute(schedule, 8, 1024,
+            [&](const uint32_t*, uint32_t) { onCaller &= this_thread::get_id() == caller; ++numVisits; },
+            1000, [&](uint32_t, uint32_t) { onCaller &= this_thread::get_id() == caller; });
+
+        bool serial = onCaller && numVisits == 1;
+        printf("%s small graph on the calling thread\n", serial ? "Passed" : "FAILED");
+        passed &= serial;
+    }
+
+    // Nodes after the end of the traversal are not scheduled
+    {
+        vector<Node> graph = MakeGraph(10, 4, 1, rng);
+        vector<Node> extra = MakeGraph(5, 4, 1, rng);
+        graph.insert(graph.end(), extra.begin(), extra.end());
+
+        SceneGraphSchedule::Schedule schedule;
+        SceneGraphSchedule::Build(graph.data(), (uint32_t)graph.size(), schedule);
+        bool stopped = schedule.Order.size() == 10;
+        printf("%s traversal end\n", stopped ? "Passed" : "FAILED");
+        passed &= stopped;
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+//
+// Checks RadixSort against std::sort and times both, e.g.
+//
+//     SortBenchmark -draws 60000 -iterations 100 -threads 8
+//
+// Draw lists are generated the way MeshSorter::AddMesh packs its keys: object index in the
+// low 16 bits, then a PSO index, the distance as float bits and the pass.
+//
+
+#include "../../Core/RadixSort.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Must match MeshSorter::Sort
+    const RadixSort::Digit kSortKeyDigits[] =
+    {
+        { 0, 8 }, { 8, 8 }, { 16, 12 }, { 28, 11 }, { 39, 11 }, { 50, 10 }, { 60, 4 }
+    };
+    const uint32_t kNumSortKeyDigits = sizeof(kSortKeyDigits) / sizeof(kSortKeyDigits[0]);
+
+    const RadixSort::Digit kFullDigits[] =
+    {
+        { 0, 8 }, { 8, 8 }, { 16, 8 }, { 24, 8 }, { 32, 8 }, { 40, 8 }, { 48, 8 }, { 56, 8 }
+    };
+
+    uint64_t MakeKey(uint32_t objectIdx, uint32_t psoIdx, float distance, uint32_t pass)
+    {
+        uint32_t bits;
+        memcpy(&bits, &distance, sizeof(bits));
+        return (uint64_t)(objectIdx & 0xFFFF) | (uint64_t)(psoIdx & 0xFFF) << 16 |
+            (uint64_t)bits << 28 | (uint64_t)(pass & 0xF) << 60;
+    }
+
+    // Mirrors the key layout and pass assignment of MeshSorter::AddMesh with a separate Z pass
+    vector<uint64_t> MakeDrawList(uint32_t numMeshes, uint32_t numPSOs, uint32_t seed)
+    {
+        mt19937 rng(seed);
+        uniform_real_distribution<float> distance(0.0f, 2000.0f);
+        uniform_int_distribution<uint32_t> pso(0, numPSOs - 1), kind(0, 9);
+
+        vector<uint64_t> keys;
+        keys.reserve(numMeshes * 2);
+
+        for (uint32_t i = 0; i < numMeshes; ++i)
+        {
+            float d = distance(rng);
+            uint32_t psoIdx = pso(rng) * 2;
+
+            if (kind(rng) == 0)
+                keys.push_back(MakeKey(i, psoIdx, d, 2) ^ (0xFFFFFFFFull << 28));    // Transparent, far to near
+            else
+            {
+                keys.push_back(MakeKey(i, psoIdx & 7, d, 0));
+                keys.push_back(MakeKey(i, psoIdx + 1, d, 1));
+            }
+        }
+        return keys;
+    }
+
+    bool Check(vector<uint64_t> keys, const RadixSort::Digit* digits, uint32_t numDigits, uint32_t numThreads, const char* name)
+    {
+        vector<uint64_t> expected = keys;
+        sort(expected.begin(), expected.end());
+
+        RadixSort::Scratch scratch;
+        RadixSort::Stats stats;
+        RadixSort::Sort(keys.data(), keys.size(), digits, numDigits, scratch, numThreads, &stats);
+
+        if (keys != expected)
+        {
+            printf("FAILED %s (%zu keys, %u threads)\n", name, keys.size(), stats.NumThreads);
+            return false;
+        }
+
+        printf("Passed %s (%zu keys, %u threads, %u passes, %u uniform and %u presorted skipped)\n",
+            name, keys.size(), stats.NumThreads, stats.PassesRun, stats.PassesSkippedUniform, stats.PassesSkippedPresorted);
+        return true;
+    }
+
+    template <typename SortFunction>
+    void Benchmark(const char* name, const vector<uint64_t>& input, uint32_t iterations, SortFunction sortKeys)
+    {
+        vector<uint64_t> keys;
+        keys.reserve(input.size());
+
+        double totalMs = 0.0;
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            keys = input;
+            auto start = chrono::high_resolution_clock::now();
+            sortKeys(keys);
+            auto end = chrono::high_resolution_clock::now();
+            totalMs += chrono::duration<double, milli>(end - start).count();
+        }
+
+        printf("%-20s %8.3f ms\n", name, totalMs / iterations);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numDraws = 60000;
+    uint32_t iterations = 100;
+    uint32_t numThreads = max(thread::hardware_concurrency(), 1u);
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (arg + 1 < argc && strcmp("-draws", argv[arg]) == 0)
+            numDraws = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-iterations", argv[arg]) == 0)
+            iterations = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-threads", argv[arg]) == 0)
+            numThreads = max(atoi(argv[++arg]), 1);
+        else
+        {
+            printf(
+                "Usage:  %s [options]*\n\n"
+                "Options:\n\n"
+                "-draws <integer>\n\tNumber of meshes added to the sorter.\n\tDefaults to 60000.\n"
+                "-iterations <integer>\n\tTimed repetitions.\n\tDefaults to 100.\n"
+                "-threads <integer>\n\tThreads for the parallel sort.\n\tDefaults to every hardware thread.\n\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    bool passed = true;
+
+    // Edge cases
+    passed &= Check({}, kSortKeyDigits, kNumSortKeyDigits, 1, "empty");
+    passed &= Check({ 42 }, kSortKeyDigits, kNumSortKeyDigits, 1, "single key");
+    passed &= Check(vector<uint64_t>(1000, 0x123456789ABCDEFull), kSortKeyDigits, kNumSortKeyDigits, 1, "identical keys");
+
+    // Draw lists, serial and split across threads. More than 65536 meshes wraps the object
+    // index, which defeats the presorted skip but must still sort correctly.
+    for (uint32_t threads : { 1u, 2u, 3u, 8u })
+    {
+        passed &= Check(MakeDrawList(500, 16, 1), kSortKeyDigits, kNumSortKeyDigits, threads, "small draw list");
+        passed &= Check(MakeDrawList(50000, 64, 2), kSortKeyDigits, kNumSortKeyDigits, threads, "draw list");
+        passed &= Check(MakeDrawList(100000, 256, 3), kSortKeyDigits, kNumSortKeyDigits, threads, "wrapped draw list");
+    }
+
+    // Shadow draw lists only have depth passes, so the pass digit is skipped as uniform
+    {
+        vector<uint64_t> keys = MakeDrawList(20000, 8, 6);
+        for (uint64_t& key : keys)
+            key &= ~(0xFull << 60);
+        passed &= Check(keys, kSortKeyDigits, kNumSortKeyDigits, 1, "shadow draw list");
+    }
+
+    // Arbitrary keys, including a reversed and an already sorted input
+    {
+        mt19937_64 rng(4);
+        vector<uint64_t> keys(200000);
+        for (uint64_t& key : keys)
+            key = rng();
+
+        passed &= Check(keys, kFullDigits, 8, 1, "random keys");
+        passed &= Check(keys, kFullDigits, 8, 4, "random keys");
+
+        sort(keys.begin(), keys.end());
+        passed &= Check(keys, kFullDigits, 8, 4, "sorted keys");
+
+        reverse(keys.begin(), keys.end());
+        passed &= Check(keys, kFullDigits, 8, 4, "reversed keys");
+    }
+
+    vector<uint64_t> drawList = MakeDrawList(numDraws, 64, 5);
+    printf("\n%zu keys from %u draws:\n", drawList.size(), numDraws);
+
+    Benchmark("std::sort", drawList, iterations, [](vector<uint64_t>& keys)
+    {
+        sort(keys.begin(), keys.end());
+    });
+
+    RadixSort::Scratch scratch;
+    Benchmark("radix", drawList, iterations, [&](vector<uint64_t>& keys)
+    {
+        RadixSort::Sort(keys.data(), keys.size(), kSortKeyDigits, kNumSortKeyDigits, scratch, 1);
+    });
+
+    char name[32];
+    snprintf(name, sizeof(name), "radix, %u threads", numThreads);
+    Benchmark(name, drawList, iterations, [&](vector<uint64_t>& keys)
+    {
+        RadixSort::Sort(keys.data(), keys.size(), kSortKeyDigits, kNumSortKeyDigits, scratch, numThreads);
+    });
+
+    return passed ? 0 : 1;
+}
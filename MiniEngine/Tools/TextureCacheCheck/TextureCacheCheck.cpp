@@ -0,0 +1,588 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+//
+// Checks TextureCache lookups, eviction, invalidation and index sharing with synthetic
+// images and a stand-in for the DDS conversion, e.g.
+//
+//     TextureCacheCheck -dir /tmp/texcache
+//
+// Files are created in a new directory below the given one, which defaults to the current
+// directory, and removed afterwards.
+//
+
+#include "../../Model/TextureCache.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+    typedef TextureCache::Result Result;
+
+    string s_Root;
+    uint32_t s_EncoderVersion = 1;
+    atomic<uint32_t> s_NumConversions(0);
+
+    wstring Wide(const string& path) { return wstring(path.begin(), path.end()); }
+
+    bool Report(const char* name, bool passed)
+    {
+        printf("%s %s\n", passed ? "Passed" : "FAILED", name);
+        return passed;
+    }
+
+    void MakeDirectory(const string& path)
+    {
+#ifdef _WIN32
+        _mkdir(path.c_str());
+#else
+        mkdir(path.c_str(), 0777);
+#endif
+    }
+
+    void WriteFile(const string& path, const vector<uint8_t>& data)
+    {
+        FILE* file = fopen(path.c_str(), "wb");
+        if (file != nullptr)
+        {
+            if (!data.empty())
+                fwrite(data.data(), 1, data.size(), file);
+            fclose(file);
+        }
+    }
+
+    vector<uint8_t> ReadFile(const string& path)
+    {
+        vector<uint8_t> data;
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file != nullptr)
+        {
+            uint8_t buffer[4096];
+            size_t count;
+            while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+                data.insert(data.end(), buffer, buffer + count);
+            fclose(file);
+        }
+        return data;
+    }
+
+    bool FileExists(const string& path)
+    {
+        struct stat info;
+        return stat(path.c_str(), &info) == 0;
+    }
+
+    // Moves the modification time, since rewriting a file within a second would not change it
+    void SetModifiedTime(const string& path, int64_t secondsFromNow)
+    {
+#ifdef _WIN32
+        struct _utimbuf times;
+        times.actime = times.modtime = time(nullptr) + secondsFromNow;
+        _utime(path.c_str(), &times);
+#else
+        struct utimbuf times;
+        times.actime = times.modtime = time(nullptr) + secondsFromNow;
+        utime(path.c_str(), &times);
+#endif
+    }
+
+    // A synthetic RGBA image with a small header, like an uncompressed TGA
+    vector<uint8_t> MakeImage(uint32_t seed, uint32_t width, uint32_t height)
+    {
+        mt19937 rng(seed);
+        vector<uint8_t> image(16 + width * height * 4);
+        memcpy(image.data(), &width, 4);
+        memcpy(image.data() + 4, &height, 4);
+        for (size_t i = 16; i < image.size(); ++i)
+            image[i] = (uint8_t)(rng() >> 24);
+        return image;
+    }
+
+    // Stands in for ConvertToDDS. The output depends on the contents, flags and encoder version.
+    bool Convert(const string& source, const string& output, uint32_t flags)
+    {
+        ++s_NumConversions;
+        vector<uint8_t> data = ReadFile(source);
+        if (data.empty())
+            return false;
+
+        const uint8_t key = (uint8_t)(flags * 31 + s_EncoderVersion * 7);
+        for (size_t i = 0; i < data.size(); i += 2)
+            data[i] ^= key;
+        data.resize(data.size() / 2 + 16);
+        WriteFile(output, data);
+        return true;
+    }
+
+    Result Update(TextureCache& cache, const string& source, uint32_t flags = 1)
+    {
+        const string output = source.substr(0, source.rfind('.')) + ".dds";
+        return cache.Update(Wide(source), Wide(output), flags, s_EncoderVersion,
+            [&]() { return Convert(source, output, flags); });
+    }
+
+    bool CheckHash()
+    {
+        const char* text = "Nobody inspects the spammish repetition";
+        bool passed = TextureCache::Hash("", 0) == 0xEF46DB3751D8E999ull;
+        passed &= TextureCache::Hash("a", 1) == 0xD24EC4F1A98C6E5Bull;
+        passed &= TextureCache::Hash("abc", 3) == 0x44BC2CF5AD770999ull;
+        passed &= TextureCache::Hash(text, strlen(text)) == 0xFBCEA83C8A378BF1ull;
+
+        vector<uint8_t> data(64 << 20);
+        for (size_t i = 0; i < data.size(); ++i)
+            data[i] = (uint8_t)(i * 2654435761u >> 24);
+
+        auto start = chrono::high_resolution_clock::now();
+        volatile uint64_t hash = TextureCache::Hash(data.data(), data.size());
+        (void)hash;
+        const double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+        printf("  Hashing %.0f MB/s\n", data.size() / 1048576.0 / ms * 1000.0);
+
+        return Report("xxHash64 test vectors", passed);
+    }
+
+    bool CheckLookups()
+    {
+        const string cacheDir = s_Root + "/cache", rootA = s_Root + "/assetsA", rootB = s_Root + "/assetsB";
+        MakeDirectory(rootA);
+        MakeDirectory(rootB);
+
+        TextureCache cache;
+        bool passed = cache.Open(Wide(cacheDir), 1 << 30);
+
+        const vector<uint8_t> image = MakeImage(1, 64, 64);
+        const string source = rootA + "/albedo.tga", output = rootA + "/albedo.dds";
+        WriteFile(source, image);
+
+        // First use converts, then the output is current
+        s_NumConversions = 0;
+        passed &= Update(cache, source) == Result::kConverted && s_NumConversions == 1;
+        passed &= Update(cache, source) == Result::kUpToDate && s_NumConversions == 1;
+        const vector<uint8_t> converted = ReadFile(output);
+
+        // Touching the source no longer forces a conversion
+        WriteFile(source, image);
+        SetModifiedTime(source, 100);
+        passed &= Update(cache, source) == Result::kUpToDate && s_NumConversions == 1;
+
+        // A deleted or damaged output comes back from the cache
+        remove(output.c_str());
+        passed &= Update(cache, source) == Result::kRestored && ReadFile(output) == converted;
+        WriteFile(output, vector<uint8_t>(converted.size(), 0));
+        passed &= Update(cache, source) == Result::kRestored && ReadFile(output) == converted;
+
+        // The same contents under another asset root, as after a copy to another machine
+        const string copy = rootB + "/renamed.tga";
+        WriteFile(copy, image);
+        passed &= Update(cache, copy) == Result::kRestored && ReadFile(rootB + "/renamed.dds") == converted;
+        passed &= s_NumConversions == 1;
+        passed &= Report("content addressed lookups across asset roots", passed);
+
+        // Flags, encoder version and contents are all part of the key
+        bool keyed = Update(cache, source, 3) == Result::kConverted && s_NumConversions == 2;
+        s_EncoderVersion = 2;
+        keyed &= Update(cache, source, 3) == Result::kConverted && s_NumConversions == 3;
+        s_EncoderVersion = 1;
+        keyed &= Update(cache, source, 3) == Result::kRestored && s_NumConversions == 3;
+        WriteFile(source, MakeImage(2, 64, 64));
+        SetModifiedTime(source, 200);
+        keyed &= Update(cache, source, 3) == Result::kConverted && s_NumConversions == 4;
+        passed &= Report("flags, encoder version and contents", keyed);
+
+        // Outputs newer than their source are adopted, like the old time stamp check, unless
+        // the cache knows they came from another encoder
+        const string legacy = rootA + "/legacy.tga", legacyOutput = rootA + "/legacy.dds";
+        WriteFile(legacy, MakeImage(3, 32, 32));
+        SetModifiedTime(legacy, -100);
+        Convert(legacy, legacyOutput, 1);
+        s_NumConversions = 0;
+        bool adopted = Update(cache, legacy) == Result::kAdopted && s_NumConversions == 0;
+        remove(legacyOutput.c_str());
+        adopted &= Update(cache, legacy) == Result::kRestored;
+        s_EncoderVersion = 2;
+        adopted &= Update(cache, legacy) == Result::kConverted && s_NumConversions == 1;
+        s_EncoderVersion = 1;
+        passed &= Report("adopting existing outputs", adopted);
+
+        // Missing files
+        bool missing = Update(cache, rootA + "/nothing.tga") == Result::kMissing;
+        const string orphan = rootA + "/orphan.dds";
+        WriteFile(orphan, converted);
+        missing &= Update(cache, rootA + "/orphan.tga") == Result::kSourceMissing;
+        passed &= Report("missing sources", missing);
+
+        // Files that have not changed since they were last hashed are not read again, also
+        // after reopening. Files modified just now are, as they may still be written.
+        const string settled = rootA + "/settled.tga";
+        WriteFile(settled, MakeImage(4, 64, 64));
+        SetModifiedTime(settled, -100);
+        uint32_t filesHashed = cache.GetStats().FilesHashed;
+        bool known = Update(cache, settled) == Result::kConverted && cache.GetStats().FilesHashed == filesHashed + 1;
+        SetModifiedTime(rootA + "/settled.dds", -50);
+        filesHashed = cache.GetStats().FilesHashed;
+        known &= Update(cache, settled) == Result::kUpToDate && cache.GetStats().FilesHashed == filesHashed + 1;
+        known &= Update(cache, settled) == Result::kUpToDate && cache.GetStats().FilesHashed == filesHashed + 1;
+        cache.Flush();
+        TextureCache reopened;
+        reopened.Open(Wide(cacheDir), 1 << 30);
+        known &= Update(reopened, settled) == Result::kUpToDate && reopened.GetStats().FilesHashed == 0;
+
+        // A rewrite with the same size is noticed by its time stamp
+        WriteFile(settled, MakeImage(5, 64, 64));
+        SetModifiedTime(settled, -40);
+        s_NumConversions = 0;
+        known &= Update(reopened, settled) == Result::kConverted && s_NumConversions == 1;
+        passed &= Report("hashes of unchanged files are remembered", known);
+
+        // Without a cache the modification times decide
+        TextureCache closed;
+        s_NumConversions = 0;
+        SetModifiedTime(source, 300);
+        bool uncached = Update(closed, source, 3) == Result::kConverted && s_NumConversions == 1;
+        SetModifiedTime(source, -300);
+        uncached &= Update(closed, source, 3) == Result::kUpToDate && s_NumConversions == 1;
+        passed &= Report("no cache", uncached);
+
+        cache.Clear();
+        return passed;
+    }
+
+    TextureCache::Key MakeKey(uint64_t hash)
+    {
+        return { hash, 1000 + hash, 1, s_EncoderVersion };
+    }
+
+    string GetEntryFile(const string& cacheDir, uint64_t hash)
+    {
+        const wstring name = TextureCache::GetEntryName(MakeKey(hash));
+        return cacheDir + "/" + string(name.begin(), name.end());
+    }
+
+    string StoreImage(TextureCache& cache, uint64_t hash, uint32_t size)
+    {
+        const string file = s_Root + "/image" + to_string(hash) + ".dds";
+        WriteFile(file, MakeImage((uint32_t)hash, size, 1));
+        cache.Store(MakeKey(hash), Wide(file));
+        return file;
+    }
+
+    bool CheckEviction()
+    {
+        const string cacheDir = s_Root + "/lru";
+        const uint32_t entrySize = 16 + 256 * 4;
+
+        TextureCache cache;
+        cache.Open(Wide(cacheDir), entrySize * 3);
+
+        StoreImage(cache, 1, 256);
+        StoreImage(cache, 2, 256);
+        StoreImage(cache, 3, 256);
+        const string output = s_Root + "/fetched.dds";
+        bool passed = cache.Fetch(MakeKey(1), Wide(output));
+
+        // Entry 2 is now the least recently used
+        StoreImage(cache, 4, 256);
+        TextureCache::Stats stats = cache.GetStats();
+        passed &= stats.NumEntries == 3 && stats.Evictions == 1 && stats.TotalBytes == entrySize * 3;
+        passed &= cache.Contains(MakeKey(1)) && !cache.Contains(MakeKey(2)) && cache.Contains(MakeKey(3));
+        passed &= !FileExists(GetEntryFile(cacheDir, 2));
+
+        // Larger than the whole cache
+        StoreImage(cache, 5, 1024);
+        passed &= !cache.Contains(MakeKey(5)) && cache.GetStats().NumEntries == 3;
+
+        // Use order survives reopening: 3 is oldest, then 1, then 4
+        cache.Flush();
+        TextureCache reopened;
+        reopened.Open(Wide(cacheDir), entrySize * 3);
+        StoreImage(reopened, 6, 256);
+        passed &= !reopened.Contains(MakeKey(3)) && reopened.Contains(MakeKey(1)) && reopened.Contains(MakeKey(4));
+
+        // A smaller limit evicts on open
+        reopened.Flush();
+        TextureCache smaller;
+        smaller.Open(Wide(cacheDir), entrySize);
+        passed &= smaller.GetStats().NumEntries == 1 && smaller.Contains(MakeKey(6));
+        passed &= Report("least recently used eviction", passed);
+
+        smaller.Clear();
+        return passed;
+    }
+
+    bool CheckInvalidation()
+    {
+        const string cacheDir = s_Root + "/invalid";
+        TextureCache cache;
+        cache.Open(Wide(cacheDir), 1 << 20);
+
+        StoreImage(cache, 1, 64);
+        StoreImage(cache, 2, 64);
+        StoreImage(cache, 3, 64);
+        auto entryPath = [&](uint64_t hash) { return GetEntryFile(cacheDir, hash); };
+
+        // Files deleted or truncated behind the cache's back are dropped on lookup
+        const string output = s_Root + "/fetched.dds";
+        remove(entryPath(1).c_str());
+        WriteFile(entryPath(2), vector<uint8_t>(10, 0));
+        bool passed = !cache.Fetch(MakeKey(1), Wide(output)) && !cache.Fetch(MakeKey(2), Wide(output));
+        passed &= cache.Fetch(MakeKey(3), Wide(output));
+        TextureCache::Stats stats = cache.GetStats();
+        passed &= stats.Invalidations == 2 && stats.NumEntries == 1 && stats.Hits == 1 && stats.Misses == 2;
+
+        // Damaged without changing size is caught by the hash of the copy
+        StoreImage(cache, 5, 64);
+        WriteFile(entryPath(5), vector<uint8_t>(16 + 64 * 4, 0));
+        passed &= !cache.Fetch(MakeKey(5), Wide(output)) && !FileExists(output) && !cache.Contains(MakeKey(5));
+        passed &= cache.GetStats().Invalidations == 3 && cache.GetStats().Misses == 3;
+
+        cache.Invalidate(MakeKey(3));
+        passed &= !cache.Contains(MakeKey(3)) && !FileExists(entryPath(3)) && cache.GetStats().TotalBytes == 0;
+
+        // Entries with missing files are dropped when the index is loaded
+        StoreImage(cache, 4, 64);
+        cache.Flush();
+        remove(entryPath(4).c_str());
+        TextureCache reopened;
+        reopened.Open(Wide(cacheDir), 1 << 20);
+        passed &= reopened.GetStats().NumEntries == 0;
+
+        // A damaged index is ignored rather than trusted
+        WriteFile(cacheDir + "/index.txt", vector<uint8_t>(100, 'x'));
+        TextureCache damaged;
+        passed &= damaged.Open(Wide(cacheDir), 1 << 20) && damaged.GetStats().NumEntries == 0;
+
+        return Report("invalidation", passed);
+    }
+
+    bool CheckSharing()
+    {
+        const string cacheDir = s_Root + "/shared";
+
+        // Two users of one directory, as with two asset roots in separate processes
+        TextureCache a, b;
+        a.Open(Wide(cacheDir), 1 << 20);
+        b.Open(Wide(cacheDir), 1 << 20);
+
+        StoreImage(a, 1, 64);
+        a.Flush();
+        StoreImage(b, 2, 64);
+        StoreImage(a, 3, 64);
+
+        // Each sees the other's entries when it writes the index, which a store alone does not
+        bool passed = !a.Contains(MakeKey(2)) && !b.Contains(MakeKey(1));
+        b.Flush();
+        a.Flush();
+        passed &= a.Contains(MakeKey(2)) && b.Contains(MakeKey(1));
+
+        TextureCache c;
+        c.Open(Wide(cacheDir), 1 << 20);
+        passed &= c.GetStats().NumEntries == 3;
+        passed &= c.Contains(MakeKey(1)) && c.Contains(MakeKey(2)) && c.Contains(MakeKey(3));
+
+        // Clearing removes every entry, including ones this user never loaded
+        b.Clear();
+        TextureCache d;
+        d.Open(Wide(cacheDir), 1 << 20);
+        passed &= d.GetStats().NumEntries == 0 && !FileExists(GetEntryFile(cacheDir, 3));
+
+        passed &= Report("index shared by several users", passed);
+
+        // Users storing at the same time take turns at the index, so none of its entries are
+        // lost and nothing is left for Open to recover
+        const uint32_t numUsers = 4, entriesPerUser = 16;
+        vector<thread> threads;
+        for (uint32_t u = 0; u < numUsers; ++u)
+        {
+            threads.emplace_back([&, u]()
+            {
+                TextureCache user;
+                user.Open(Wide(cacheDir), 1 << 20);
+                for (uint32_t i = 0; i < entriesPerUser; ++i)
+                    StoreImage(user, 100 + u * entriesPerUser + i, 64);
+            });
+        }
+        for (thread& t : threads)
+            t.join();
+
+        TextureCache e;
+        e.Open(Wide(cacheDir), 1 << 20);
+        bool locked = e.GetStats().NumEntries == numUsers * entriesPerUser && e.GetStats().Reconciled == 0;
+        passed &= Report("concurrent users of the index", locked);
+
+        // Entry files the index does not list, as when a user stopped before writing it, are
+        // added back by Open. Temporary files are removed once they are old.
+        const string staleTemp = cacheDir + "/stale.1.0.tmp", freshTemp = cacheDir + "/fresh.1.0.tmp";
+        WriteFile(cacheDir + "/index.txt", vector<uint8_t>());
+        WriteFile(cacheDir + "/unrelated.dds", vector<uint8_t>(64, 0));
+        WriteFile(staleTemp, vector<uint8_t>(64, 0));
+        WriteFile(freshTemp, vector<uint8_t>(64, 0));
+        SetModifiedTime(staleTemp, -2 * 60 * 60);
+
+        TextureCache f;
+        f.Open(Wide(cacheDir), 1 << 20);
+        TextureCache::Stats stats = f.GetStats();
+        bool reconciled = stats.NumEntries == numUsers * entriesPerUser && stats.Reconciled == numUsers * entriesPerUser;
+        const string output = s_Root + "/fetched.dds";
+        reconciled &= f.Fetch(MakeKey(100), Wide(output)) && ReadFile(output) == MakeImage(100, 64, 1);
+        reconciled &= !FileExists(staleTemp) && FileExists(freshTemp);
+
+        // Recovered entries are the first to be evicted
+        const uint32_t entrySize = 16 + 64 * 4;
+        f.Flush();
+        TextureCache g;
+        g.Open(Wide(cacheDir), entrySize * 2);
+        reconciled &= g.GetStats().NumEntries == 2 && g.Contains(MakeKey(100)) && g.GetStats().Reconciled == 0;
+        g.Clear();
+        passed &= Report("entries missing from the index", reconciled);
+
+        return passed;
+    }
+
+    bool CheckThreads()
+    {
+        const string cacheDir = s_Root + "/threads", assets = s_Root + "/threaded";
+        MakeDirectory(assets);
+
+        TextureCache cache;
+        cache.Open(Wide(cacheDir), 64 << 20);
+
+        const uint32_t numThreads = 8, texturesPerThread = 16;
+        atomic<uint32_t> failures(0);
+        s_NumConversions = 0;
+
+        for (uint32_t pass = 0; pass < 2; ++pass)
+        {
+            vector<thread> threads;
+            for (uint32_t t = 0; t < numThreads; ++t)
+            {
+                threads.emplace_back([&, t]()
+                {
+                    for (uint32_t i = 0; i < texturesPerThread; ++i)
+                    {
+                        const string source = assets + "/t" + to_string(t) + "_" + to_string(i) + ".tga";
+                        if (pass == 0)
+                        {
+                            WriteFile(source, MakeImage(t * 100 + i, 64, 64));
+                            failures += Update(cache, source) != Result::kConverted;
+                        }
+                        else
+                        {
+                            remove((source.substr(0, source.size() - 4) + ".dds").c_str());
+                            failures += Update(cache, source) != Result::kRestored;
+                        }
+                    }
+                });
+            }
+            for (thread& t : threads)
+                t.join();
+        }
+
+        cache.Flush();
+        TextureCache reopened;
+        reopened.Open(Wide(cacheDir), 64 << 20);
+        bool passed = failures == 0 && s_NumConversions == numThreads * texturesPerThread;
+        passed &= reopened.GetStats().NumEntries == numThreads * texturesPerThread && reopened.GetStats().Reconciled == 0;
+        reopened.Clear();
+        return Report("concurrent updates", passed);
+    }
+
+    void RemoveTree(const string& path)
+    {
+#ifndef _WIN32
+        DIR* dir = opendir(path.c_str());
+        if (dir == nullptr)
+        {
+            remove(path.c_str());
+            return;
+        }
+        while (dirent* entry = readdir(dir))
+        {
+            if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, ".."))
+                RemoveTree(path + "/" + entry->d_name);
+        }
+        closedir(dir);
+        rmdir(path.c_str());
+#else
+        printf("Test files were left in %s\n", path.c_str());
+#endif
+    }
+}
+
+int main(int argc, char** argv)
+{
+    string parent = ".";
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (arg + 1 < argc && strcmp("-dir", argv[arg]) == 0)
+            parent = argv[++arg];
+        else
+        {
+            printf(
+                "Usage:  %s [options]*\n\n"
+                "Options:\n\n"
+                "-dir <path>\n\tWhere to create the test directory.\n\tDefaults to the current directory.\n\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+#ifdef _WIN32
+    s_Root = parent + "/TextureCacheCheck." + to_string(_getpid());
+#else
+    s_Root = parent + "/TextureCacheCheck." + to_string(getpid());
+#endif
+    MakeDirectory(s_Root);
+
+    bool passed = CheckHash();
+    passed &= CheckLookups();
+    passed &= CheckEviction();
+    passed &= CheckInvalidation();
+    passed &= CheckSharing();
+    passed &= CheckThreads();
+
+    RemoveTree(s_Root);
+    return passed ? 0 : 1;
+}
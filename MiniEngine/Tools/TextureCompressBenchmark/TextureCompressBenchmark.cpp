@@ -0,0 +1,439 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+//
+// Times TextureCompress against a single DirectX::Compress call (and DirectXTex's own OpenMP
+// path when the library was built with it) for every quality tier, checks that the output is
+// identical, and prints the PSNR of each result, e.g.
+//
+//     TextureCompressBenchmark -image Textures/Bricks_Albedo.tga -format bc7
+//
+// Without -image a synthetic material of -size pixels is used, with an alpha mask for BC7
+// and a bright sky for BC6H. Images are loaded from DDS, TGA or HDR files and get a full mip
+// chain, as ConvertToDDS does.
+//
+
+#include "../../Model/TextureCompress.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace DirectX;
+
+namespace
+{
+    bool Report(const char* name, bool passed)
+    {
+        printf("%s %s\n", passed ? "Passed" : "FAILED", name);
+        return passed;
+    }
+
+    double Milliseconds(chrono::steady_clock::time_point start)
+    {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+    // Smooth value noise in [0,1] with a few octaves
+    float Noise(float x, float y)
+    {
+        auto Hash = [](int32_t ix, int32_t iy)
+        {
+            uint32_t h = (uint32_t)ix * 0x8da6b343u ^ (uint32_t)iy * 0xd8163841u;
+            h = (h ^ (h >> 13)) * 0x5bd1e995u;
+            return (float)((h ^ (h >> 15)) & 0xffff) / 65535.0f;
+        };
+
+        float sum = 0.0f, amplitude = 0.5f;
+        for (uint32_t octave = 0; octave < 5; ++octave)
+        {
+            const float fx = floorf(x), fy = floorf(y);
+            const int32_t ix = (int32_t)fx, iy = (int32_t)fy;
+            float u = x - fx, v = y - fy;
+            u = u * u * (3.0f - 2.0f * u);
+            v = v * v * (3.0f - 2.0f * v);
+            const float top = Hash(ix, iy) + (Hash(ix + 1, iy) - Hash(ix, iy)) * u;
+            const float bottom = Hash(ix, iy + 1) + (Hash(ix + 1, iy + 1) - Hash(ix, iy + 1)) * u;
+            sum += amplitude * (top + (bottom - top) * v);
+            amplitude *= 0.5f;
+            x *= 2.0f;
+            y *= 2.0f;
+        }
+        return sum;
+    }
+
+    // Weathered bricks with mortar, colour variation and a cut-out alpha mask
+    void MakeAlbedo(uint32_t size, ScratchImage& image)
+    {
+        image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, size, size, 1, 1);
+        const Image& dest = *image.GetImage(0, 0, 0);
+        const float scale = 16.0f / size;
+
+        for (uint32_t y = 0; y < size; ++y)
+        {
+            uint8_t* row = dest.pixels + y * dest.rowPitch;
+            for (uint32_t x = 0; x < size; ++x)
+            {
+                const float u = x * scale, v = y * scale * 2.0f;
+                const float brickU = u + (((int32_t)v & 1) ? 0.5f : 0.0f);
+                const bool mortar = brickU - floorf(brickU) < 0.06f || v - floorf(v) < 0.12f;
+                const float tint = Noise(floorf(brickU) * 7.1f, floorf(v) * 3.3f);
+                const float grain = Noise(u * 8.0f, v * 4.0f);
+
+                float r, g, b;
+                if (mortar)
+                    r = g = b = 0.55f + 0.3f * grain;
+                else
+                {
+                    r = 0.45f + 0.35f * tint + 0.2f * grain;
+                    g = 0.18f + 0.15f * tint + 0.15f * grain;
+                    b = 0.12f + 0.1f * tint + 0.1f * grain;
+                }
+
+                const float a = Noise(u * 0.5f + 11.0f, v * 0.25f) > 0.45f ? 1.0f : 0.0f;
+                row[x * 4 + 0] = (uint8_t)(min(r, 1.0f) * 255.0f + 0.5f);
+                row[x * 4 + 1] = (uint8_t)(min(g, 1.0f) * 255.0f + 0.5f);
+                row[x * 4 + 2] = (uint8_t)(min(b, 1.0f) * 255.0f + 0.5f);
+                row[x * 4 + 3] = (uint8_t)(a * 255.0f);
+            }
+        }
+    }
+
+    // Sky gradient with clouds and a sun far brighter than 1
+    void MakeSky(uint32_t size, ScratchImage& image)
+    {
+        image.Initialize2D(DXGI_FORMAT_R32G32B32A32_FLOAT, size, size, 1, 1);
+        const Image& dest = *image.GetImage(0, 0, 0);
+
+        for (uint32_t y = 0; y < size; ++y)
+        {
+            float* row = (float*)(dest.pixels + y * dest.rowPitch);
+            for (uint32_t x = 0; x < size; ++x)
+            {
+                const float u = (float)x / size, v = (float)y / size;
+                const float cloud = max(0.0f, Noise(u * 12.0f, v * 6.0f) - 0.45f) * 4.0f;
+                const float dx = u - 0.7f, dy = v - 0.3f;
+                const float sun = 60.0f * expf(-(dx * dx + dy * dy) * 2000.0f);
+                row[x * 4 + 0] = 0.3f + 0.4f * v + cloud + sun;
+                row[x * 4 + 1] = 0.5f + 0.3f * v + cloud + sun * 0.9f;
+                row[x * 4 + 2] = 1.0f + cloud + sun * 0.7f;
+                row[x * 4 + 3] = 1.0f;
+            }
+        }
+    }
+
+    HRESULT LoadImage(const string& path, ScratchImage& image)
+    {
+        const wstring file(path.begin(), path.end());
+        string ext = path.substr(path.find_last_of('.') + 1);
+        transform(ext.begin(), ext.end(), ext.begin(), [](char c) { return (char)tolower(c); });
+
+        if (ext == "dds")
+            return LoadFromDDSFile(file.c_str(), DDS_FLAGS_NONE, nullptr, image);
+        else if (ext == "tga")
+            return LoadFromTGAFile(file.c_str(), TGA_FLAGS_NONE, nullptr, image);
+        else if (ext == "hdr")
+            return LoadFromHDRFile(file.c_str(), nullptr, image);
+
+        return E_INVALIDARG;
+    }
+
+    // Brings an image into the format and mip layout ConvertToDDS compresses from
+    bool PrepareSource(ScratchImage& image, DXGI_FORMAT format)
+    {
+        ScratchImage temp;
+        if (IsCompressed(image.GetMetadata().format))
+        {
+            if (FAILED(Decompress(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DXGI_FORMAT_UNKNOWN, temp)))
+                return false;
+            swap(image, temp);
+        }
+
+        if (image.GetMetadata().format != format)
+        {
+            if (FAILED(Convert(image.GetImages(), image.GetImageCount(), image.GetMetadata(), format,
+                TEX_FILTER_DEFAULT, TEX_THRESHOLD_DEFAULT, temp)))
+            {
+                return false;
+            }
+            swap(image, temp);
+        }
+
+        if (image.GetMetadata().mipLevels == 1)
+        {
+            if (FAILED(GenerateMipMaps(image.GetImages(), image.GetImageCount(), image.GetMetadata(), TEX_FILTER_DEFAULT, 0, temp)))
+                return false;
+            swap(image, temp);
+        }
+
+        return true;
+    }
+
+    bool SameBlocks(const ScratchImage& a, const ScratchImage& b)
+    {
+        return a.GetPixelsSize() == b.GetPixelsSize() && memcmp(a.GetPixels(), b.GetPixels(), a.GetPixelsSize()) == 0;
+    }
+
+    struct FormatInfo
+    {
+        const char* Name;
+        DXGI_FORMAT Format;
+        bool HDR;
+        bool HasTiers;
+    };
+
+    const FormatInfo kFormats[] =
+    {
+        { "bc1", DXGI_FORMAT_BC1_UNORM, false, false },
+        { "bc3", DXGI_FORMAT_BC3_UNORM, false, false },
+        { "bc6h", DXGI_FORMAT_BC6H_UF16, true, false },
+        { "bc7", DXGI_FORMAT_BC7_UNORM, false, true },
+    };
+
+    bool Benchmark(const FormatInfo& info, const ScratchImage& source, uint32_t numThreads, bool reference, bool verbose)
+    {
+        const TexMetadata& metadata = source.GetMetadata();
+        const double megapixels = (double)source.GetPixelsSize() / (BitsPerPixel(metadata.format) / 8) / 1e6;
+        bool passed = true;
+
+        printf("\n%s, %zux%zu with %zu mips, %.2f megapixels\n", info.Name, metadata.width, metadata.height,
+            metadata.mipLevels, megapixels);
+        printf("%-12s %14s %14s %14s %8s %10s %10s %10s\n", "quality", "serial", "DirectXTex MP", "parallel",
+            "speedup", "PSNR", "all mips", "alpha");
+
+        // The other formats ignore the tier, so timing them again would only repeat the same work
+        const uint32_t firstTier = info.HasTiers ? 0 : (uint32_t)TextureCompress::Quality::kBalanced;
+        const uint32_t lastTier = info.HasTiers ? (uint32_t)TextureCompress::Quality::kNumQualities : firstTier + 1;
+
+        for (uint32_t tier = firstTier; tier < lastTier; ++tier)
+        {
+            const TextureCompress::Quality quality = (TextureCompress::Quality)tier;
+            const TEX_COMPRESS_FLAGS flags = TextureCompress::GetCompressFlags(quality);
+
+            ScratchImage serial, openMP, parallel;
+            double serialMs = 0.0, openMPMs = 0.0;
+
+            if (reference)
+            {
+                auto start = chrono::steady_clock::now();
+                if (FAILED(Compress(source.GetImages(), source.GetImageCount(), metadata, info.Format, flags,
+                    TEX_THRESHOLD_DEFAULT, serial)))
+                {
+                    return Report("DirectX::Compress", false);
+                }
+                serialMs = Milliseconds(start);
+
+                // Fails with E_NOTIMPL when DirectXTex was built without OpenMP
+                start = chrono::steady_clock::now();
+                if (SUCCEEDED(Compress(source.GetImages(), source.GetImageCount(), metadata, info.Format,
+                    flags | TEX_COMPRESS_PARALLEL, TEX_THRESHOLD_DEFAULT, openMP)))
+                {
+                    openMPMs = Milliseconds(start);
+                }
+            }
+
+            TextureCompress::Report report;
+            if (FAILED(TextureCompress::Compress(source.GetImages(), source.GetImageCount(), metadata, info.Format,
+                quality, parallel, &report, numThreads)))
+            {
+                return Report("TextureCompress::Compress", false);
+            }
+
+            char serialText[32] = "-", openMPText[32] = "-", speedupText[32] = "-";
+            if (reference)
+            {
+                snprintf(serialText, sizeof(serialText), "%11.1f ms", serialMs);
+                snprintf(speedupText, sizeof(speedupText), "%7.2fx", serialMs / report.Milliseconds);
+            }
+            if (openMPMs > 0.0)
+                snprintf(openMPText, sizeof(openMPText), "%11.1f ms", openMPMs);
+
+            printf("%-12s %14s %14s %11.1f ms %8s %7.2f dB %7.2f dB %7.2f dB  (%u threads, %.2f Mpix/s)\n",
+                TextureCompress::GetQualityName(quality), serialText, openMPText, report.Milliseconds, speedupText,
+                report.PSNR, report.AllMipsPSNR, report.AlphaPSNR, report.NumThreads, megapixels * 1000.0 / report.Milliseconds);
+
+            if (verbose)
+            {
+                for (const TextureCompress::ImageReport& image : report.Images)
+                {
+                    printf("    mip %2u item %u %5ux%-5u %7.2f dB alpha %7.2f dB\n", image.MipLevel, image.Item,
+                        image.Width, image.Height, image.PSNR, image.AlphaPSNR);
+                }
+            }
+
+            if (reference)
+            {
+                string name = string(info.Name) + " " + TextureCompress::GetQualityName(quality) + " matches DirectX::Compress";
+                passed &= Report(name.c_str(), SameBlocks(serial, parallel));
+            }
+
+            // Different thread counts must not change a single block or the report
+            ScratchImage single;
+            TextureCompress::Report singleReport;
+            if (FAILED(TextureCompress::Compress(source.GetImages(), source.GetImageCount(), metadata, info.Format,
+                quality, single, &singleReport, 1)))
+            {
+                return Report("TextureCompress::Compress", false);
+            }
+
+            string name = string(info.Name) + " " + TextureCompress::GetQualityName(quality) + " independent of thread count";
+            passed &= Report(name.c_str(), SameBlocks(single, parallel) && singleReport.PSNR == report.PSNR &&
+                singleReport.AllMipsPSNR == report.AllMipsPSNR);
+
+            // Several calls at once, as the texture pipeline's workers make them, share the cores
+            if (tier == firstTier)
+            {
+                const uint32_t kCalls = 4;
+                ScratchImage concurrent[kCalls];
+                TextureCompress::Report concurrentReports[kCalls];
+                HRESULT results[kCalls];
+
+                vector<thread> callers;
+                for (uint32_t c = 0; c < kCalls; ++c)
+                {
+                    callers.emplace_back([&, c]()
+                    {
+                        results[c] = TextureCompress::Compress(source.GetImages(), source.GetImageCount(), metadata,
+                            info.Format, quality, concurrent[c], &concurrentReports[c]);
+                    });
+                }
+
+                bool same = true;
+                uint32_t totalThreads = 0;
+                for (uint32_t c = 0; c < kCalls; ++c)
+                {
+                    callers[c].join();
+                    same &= SUCCEEDED(results[c]) && SameBlocks(single, concurrent[c]);
+                    totalThreads += concurrentReports[c].NumThreads;
+                }
+                printf("    %u concurrent calls on %u threads in total\n", kCalls, totalThreads);
+
+                name = string(info.Name) + " " + TextureCompress::GetQualityName(quality) + " concurrent calls";
+                passed &= Report(name.c_str(), same);
+            }
+        }
+
+        return passed;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    string imageFile;
+    string formatName = "all";
+    uint32_t size = 1024;
+    uint32_t numThreads = 0;
+    bool reference = true;
+    bool verbose = false;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (arg + 1 < argc && strcmp("-image", argv[arg]) == 0)
+            imageFile = argv[++arg];
+        else if (arg + 1 < argc && strcmp("-format", argv[arg]) == 0)
+            formatName = argv[++arg];
+        else if (arg + 1 < argc && strcmp("-size", argv[arg]) == 0)
+            size = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-threads", argv[arg]) == 0)
+            numThreads = max(atoi(argv[++arg]), 0);
+        else if (strcmp("-noreference", argv[arg]) == 0)
+            reference = false;
+        else if (strcmp("-verbose", argv[arg]) == 0)
+            verbose = true;
+        else
+        {
+            printf(
+                "Usage:  %s [options]*\n\n"
+                "Options:\n\n"
+                "-image <file>\n\tDDS, TGA or HDR image to compress.\n\tDefaults to a synthetic material.\n"
+                "-format bc1|bc3|bc6h|bc7|all\n\tBlock format.\n\tDefaults to all, or to bc6h or bc7 to match -image.\n"
+                "-size <integer>\n\tWidth and height of the synthetic material.\n\tDefaults to 1024.\n"
+                "-threads <integer>\n\tWorker threads, 0 for every idle hardware thread.\n\tDefaults to 0.\n"
+                "-noreference\n\tSkip the DirectX::Compress runs, which are slow for BC6H and BC7.\n"
+                "-verbose\n\tPrint the PSNR of every mip level.\n\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    ScratchImage image;
+    bool imageIsHDR = false;
+    if (!imageFile.empty())
+    {
+        if (FAILED(LoadImage(imageFile, image)))
+        {
+            printf("Could not load \"%s\".\n", imageFile.c_str());
+            return 1;
+        }
+
+        imageIsHDR = FormatDataType(image.GetMetadata().format) == FORMAT_TYPE_FLOAT;
+        if (formatName == "all")
+            formatName = imageIsHDR ? "bc6h" : "bc7";
+    }
+
+    bool passed = true;
+    bool foundFormat = false;
+
+    for (const FormatInfo& info : kFormats)
+    {
+        if (formatName != "all" && formatName != info.Name)
+            continue;
+
+        foundFormat = true;
+
+        ScratchImage source;
+        if (imageFile.empty())
+        {
+            if (info.HDR)
+                MakeSky(size, source);
+            else
+                MakeAlbedo(size, source);
+        }
+        else if (FAILED(source.InitializeFromImage(*image.GetImage(0, 0, 0))))
+        {
+            return 1;
+        }
+
+        // The formats ConvertToDDS compresses from
+        if (!PrepareSource(source, info.HDR ? DXGI_FORMAT_R9G9B9E5_SHAREDEXP : DXGI_FORMAT_R8G8B8A8_UNORM))
+        {
+            printf("Could not prepare the source image for %s.\n", info.Name);
+            return 1;
+        }
+
+        passed &= Benchmark(info, source, numThreads, reference, verbose);
+    }
+
+    if (!foundFormat)
+    {
+        printf("Unknown format \"%s\".\n", formatName.c_str());
+        return 1;
+    }
+
+    return passed ? 0 : 1;
+}
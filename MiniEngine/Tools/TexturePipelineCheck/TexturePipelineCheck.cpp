@@ -0,0 +1,241 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+//
+// Runs TexturePipeline with stub stages. Checks that requests are de-duplicated and remapped
+// the way LoadModel relies on, that every texture goes through Convert, Read and Finish exactly
+// once and in that order, and that Finish only runs on the calling thread. The stages sleep
+// for a fixed time per texture, standing in for conversion and file reads, to measure the
+// speedup over a single worker.
+//
+
+#include "../../Model/TexturePipeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    bool Report(const char* name, bool passed)
+    {
+        printf("%s %s\n", passed ? "Passed" : "FAILED", name);
+        return passed;
+    }
+
+    bool CheckDeduplicate()
+    {
+        vector<TexturePipeline::Request> requests =
+        {
+            { L"textures/a.png", 1 },
+            { L"textures/b.png", 2 },
+            { L"textures\\a.png", 3 },
+            { L"textures/c.png", 4 },
+            { L"textures/b.png", 5 },
+            { L"textures/A.png", 6 },
+        };
+
+        vector<TexturePipeline::Request> unique;
+        vector<uint32_t> remap;
+        TexturePipeline::Deduplicate(requests, unique, remap);
+
+        // Only Windows compares file names without case
+#ifdef _WIN32
+        const vector<uint32_t> expected = { 0, 1, 0, 2, 1, 0 };
+#else
+        const vector<uint32_t> expected = { 0, 1, 0, 2, 1, 3 };
+#endif
+        bool ok = remap == expected && unique.size() == (expected.back() == 0 ? 3 : 4);
+
+        // Unique entries keep the order and flags of their first use
+        for (size_t i = 0; ok && i < requests.size(); ++i)
+        {
+            const TexturePipeline::Request& first = requests[find(expected.begin(), expected.end(), expected[i]) - expected.begin()];
+            ok &= unique[remap[i]].File == first.File && unique[remap[i]].Flags == first.Flags;
+        }
+
+        TexturePipeline::Deduplicate(vector<TexturePipeline::Request>(), unique, remap);
+        ok &= unique.empty() && remap.empty();
+
+        return Report("deduplicate", ok);
+    }
+
+    // Records what each stage did to one texture
+    struct Trace
+    {
+        atomic<uint32_t> converted{0};
+        atomic<uint32_t> read{0};
+        atomic<uint32_t> finished{0};
+        bool inOrder = true;
+    };
+
+    bool CheckRun(uint32_t numTextures, uint32_t numThreads)
+    {
+        vector<TexturePipeline::Request> unique(numTextures);
+        vector<uint32_t> remap;
+        for (uint32_t i = 0; i < numTextures; ++i)
+        {
+            unique[i].File = L"dir/texture" + to_wstring(i) + L".png";
+            unique[i].Flags = i;
+            remap.insert(remap.end(), i % 3 + 1, i);
+        }
+
+        vector<Trace> traces(numTextures);
+        const thread::id caller = this_thread::get_id();
+        atomic<bool> workerOnCaller(false);
+        bool finishOffCaller = false;
+        mutex orderMutex;
+
+        TexturePipeline::Stages stages;
+        stages.Convert = [&](uint32_t idx)
+        {
+            workerOnCaller = workerOnCaller || this_thread::get_id() == caller;
+            ++traces[idx].converted;
+            this_thread::sleep_for(chrono::microseconds(idx % 5 * 100));
+        };
+        stages.Read = [&](uint32_t idx)
+        {
+            if (traces[idx].converted != 1)
+            {
+                lock_guard<mutex> guard(orderMutex);
+                traces[idx].inOrder = false;
+            }
+            ++traces[idx].read;
+        };
+        stages.Finish = [&](uint32_t idx)
+        {
+            finishOffCaller |= this_thread::get_id() != caller;
+            traces[idx].inOrder &= traces[idx].read == 1;
+            ++traces[idx].finished;
+        };
+
+        TexturePipeline::Stats stats;
+        TexturePipeline::Run(unique, remap, stages, stats, numThreads);
+
+        bool ok = !workerOnCaller && !finishOffCaller && stats.NumRequests == remap.size() &&
+            stats.Textures.size() == numTextures && stats.NumThreads <= max(numTextures, 1u);
+        for (uint32_t i = 0; i < numTextures; ++i)
+        {
+            const Trace& trace = traces[i];
+            ok &= trace.converted == 1 && trace.read == 1 && trace.finished == 1 && trace.inOrder &&
+                stats.Textures[i].File == unique[i].File && stats.Textures[i].Flags == i &&
+                stats.Textures[i].NumReferences == i % 3 + 1;
+        }
+
+        char name[128];
+        snprintf(name, sizeof(name), "run (%u textures, %u threads)", numTextures, numThreads);
+        return Report(name, ok);
+    }
+
+    bool CheckMissingStages()
+    {
+        vector<TexturePipeline::Request> unique(4);
+        vector<uint32_t> remap = { 0, 1, 2, 3 };
+        atomic<uint32_t> numRead(0);
+
+        TexturePipeline::Stages stages;
+        stages.Read = [&](uint32_t) { ++numRead; };
+
+        TexturePipeline::Stats stats;
+        TexturePipeline::Run(unique, remap, stages, stats, 2);
+        return Report("missing stages", numRead == 4 && TexturePipeline::ToString(stats).find("4 texture requests") == 0);
+    }
+
+    double TimeRun(uint32_t numTextures, uint32_t numThreads, uint32_t convertMs, uint32_t readMs, uint32_t finishMs)
+    {
+        vector<TexturePipeline::Request> unique(numTextures);
+        vector<uint32_t> remap(numTextures);
+        for (uint32_t i = 0; i < numTextures; ++i)
+        {
+            unique[i].File = L"texture" + to_wstring(i) + L".png";
+            remap[i] = i;
+        }
+
+        TexturePipeline::Stages stages;
+        stages.Convert = [&](uint32_t) { this_thread::sleep_for(chrono::milliseconds(convertMs)); };
+        stages.Read = [&](uint32_t) { this_thread::sleep_for(chrono::milliseconds(readMs)); };
+        stages.Finish = [&](uint32_t) { this_thread::sleep_for(chrono::milliseconds(finishMs)); };
+
+        TexturePipeline::Stats stats;
+        TexturePipeline::Run(unique, remap, stages, stats, numThreads);
+        return stats.TotalMs;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numTextures = 48;
+    uint32_t numThreads = 8;
+    uint32_t convertMs = 20;
+    uint32_t readMs = 5;
+    uint32_t finishMs = 1;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (arg + 1 < argc && strcmp("-textures", argv[arg]) == 0)
+            numTextures = (uint32_t)atoi(argv[++arg]);
+        else if (arg + 1 < argc && strcmp("-threads", argv[arg]) == 0)
+            numThreads = (uint32_t)atoi(argv[++arg]);
+        else if (arg + 1 < argc && strcmp("-convert", argv[arg]) == 0)
+            convertMs = (uint32_t)atoi(argv[++arg]);
+        else if (arg + 1 < argc && strcmp("-read", argv[arg]) == 0)
+            readMs = (uint32_t)atoi(argv[++arg]);
+        else if (arg + 1 < argc && strcmp("-finish", argv[arg]) == 0)
+            finishMs = (uint32_t)atoi(argv[++arg]);
+        else
+        {
+            printf(
+                "Usage:  %s [options]*\n\n"
+                "Options:\n\n"
+                "-textures <count>\n\tUnique textures in the timed load.\n\tDefaults to 48.\n\n"
+                "-threads <count>\n\tWorker threads compared against one worker.\n\tDefaults to 8.\n\n"
+                "-convert <ms>, -read <ms>, -finish <ms>\n\tTime each stub stage sleeps per texture.\n\tDefaults to 20, 5 and 1.\n\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    bool passed = CheckDeduplicate();
+    passed &= CheckRun(0, 0);
+    passed &= CheckRun(1, 4);
+    passed &= CheckRun(37, 1);
+    passed &= CheckRun(37, 5);
+    passed &= CheckRun(200, 0);
+    passed &= CheckMissingStages();
+
+    // The stages sleep rather than compute, so the speedup does not depend on the core count.
+    // It is bounded by Finish, which stays on one thread.
+    const double serialMs = TimeRun(numTextures, 1, convertMs, readMs, finishMs);
+    const double parallelMs = TimeRun(numTextures, numThreads, convertMs, readMs, finishMs);
+    printf("  %u textures: 1 thread %.1f ms, %u threads %.1f ms, %.2fx\n",
+        numTextures, serialMs, numThreads, parallelMs, serialMs / parallelMs);
+    passed &= Report("speedup", numThreads < 2 || serialMs > parallelMs * 1.5);
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,548 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+//
+// Stress tests and a benchmark for TextureRegistry, e.g.
+//
+//     TextureRegistryStress -threads 16 -operations 200000 -textures 512 -upload 200 -seed 1
+//
+// Loader threads acquire, copy and release references to a pool of texture names at random.
+// A texture "loads" by waiting for the stubbed upload time and writing a value derived from
+// its name, which every other thread must see once WaitForLoad() returns. The tests check
+// that each name has at most one live entry, that every entry is deleted with its last
+// reference and that the statistics add up.
+//
+// The benchmark runs the same workload against a copy of the previous TextureManager
+// scheme: one mutex around the map, held while spinning on a texture that is still loading.
+//
+
+#include "../../Core/TextureRegistry.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    bool Report(const char* name, bool passed)
+    {
+        printf("%s %s\n", passed ? "Passed" : "FAILED", name);
+        return passed;
+    }
+
+    double MillisecondsSince(chrono::steady_clock::time_point start)
+    {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+    wstring TextureName(uint32_t index)
+    {
+        return L"Textures/Material" + to_wstring(index) + L"_BaseColor.dds";
+    }
+
+    uint64_t ExpectedValue(const wstring& name)
+    {
+        return hash<wstring>()(name) | 1;
+    }
+
+    // Stands in for reading a file and uploading it to the GPU
+    void StubUpload(uint32_t microseconds)
+    {
+        if (microseconds > 0)
+            this_thread::sleep_for(chrono::microseconds(microseconds));
+    }
+
+    // Counts live entries to catch leaks
+    struct LiveCounts
+    {
+        atomic<int> Total{0};
+        atomic<uint64_t> Created{0};
+        atomic<uint64_t> Deleted{0};
+    };
+
+    class StubTexture : public TextureRegistry::Entry
+    {
+    public:
+        StubTexture(LiveCounts& counts, uint32_t nameIdx) : m_Counts(counts), m_NameIdx(nameIdx), Value(0)
+        {
+            ++m_Counts.Total;
+            ++m_Counts.Created;
+        }
+
+        ~StubTexture()
+        {
+            --m_Counts.Total;
+            ++m_Counts.Deleted;
+        }
+
+        LiveCounts& m_Counts;
+        uint32_t m_NameIdx;
+        uint64_t Value;         // Written by the loading thread before MarkLoaded
+    };
+
+    bool CheckBasics()
+    {
+        bool passed = true;
+        LiveCounts counts;
+        TextureRegistry registry(4);
+        const wstring name = TextureName(0);
+        auto factory = [&counts] { return new StubTexture(counts, 0); };
+
+        bool created = false;
+        TextureRegistry::Entry* a = registry.Acquire(name, factory, created);
+        passed &= created && a->GetKey() == name && a->GetRefCount() == 1 && !a->IsLoaded();
+        registry.MarkLoaded(*a);
+        passed &= a->IsLoaded();
+
+        TextureRegistry::Entry* b = registry.Acquire(name, factory, created);
+        passed &= !created && b == a && a->GetRefCount() == 2;
+        registry.WaitForLoad(*b);
+
+        registry.AddRef(*a);
+        registry.Release(*a);
+        registry.Release(*b);
+        passed &= counts.Total == 1 && registry.GetStats().NumEntries == 1;
+        registry.Release(*a);
+        passed &= counts.Total == 0 && registry.GetStats().NumEntries == 0;
+
+        // A released name is loaded again
+        TextureRegistry::Entry* c = registry.Acquire(name, factory, created);
+        passed &= created && counts.Created == 2;
+        registry.MarkLoaded(*c);
+
+        // Clear deletes whatever is left
+        registry.Acquire(TextureName(1), [&counts] { return new StubTexture(counts, 1); }, created);
+        registry.Clear();
+        passed &= counts.Total == 0 && registry.GetStats().NumEntries == 0;
+
+        TextureRegistry::Stats stats = registry.GetStats();
+        passed &= stats.Hits == 1 && stats.Misses == 3 && stats.Waits == 0 && stats.Removals == 1;
+
+        return Report("basics", passed);
+    }
+
+    // Waiters block until the load completes and then see its result
+    bool CheckWaiters()
+    {
+        const uint32_t kWaiters = 8;
+        const uint32_t kUploadMs = 50;
+
+        LiveCounts counts;
+        TextureRegistry registry;
+        const wstring name = TextureName(0);
+        auto factory = [&counts] { return new StubTexture(counts, 0); };
+
+        bool created = false;
+        StubTexture* loading = static_cast<StubTexture*>(registry.Acquire(name, factory, created));
+
+        atomic<uint32_t> correct(0);
+        vector<thread> waiters;
+        for (uint32_t i = 0; i < kWaiters; ++i)
+        {
+            waiters.emplace_back([&]
+            {
+                bool waiterCreated = true;
+                StubTexture* tex = static_cast<StubTexture*>(registry.Acquire(name, factory, waiterCreated));
+                registry.WaitForLoad(*tex);
+                if (!waiterCreated && tex->Value == ExpectedValue(name))
+                    ++correct;
+                registry.Release(*tex);
+            });
+        }
+
+        this_thread::sleep_for(chrono::milliseconds(kUploadMs));
+        loading->Value = ExpectedValue(name);
+        registry.MarkLoaded(*loading);
+
+        for (thread& waiter : waiters)
+            waiter.join();
+        registry.Release(*loading);
+
+        TextureRegistry::Stats stats = registry.GetStats();
+        return Report("waiters block until the load completes",
+            correct == kWaiters && stats.Hits == kWaiters && stats.Misses == 1 && stats.Waits >= 1 &&
+            counts.Total == 0 && stats.NumEntries == 0);
+    }
+
+    // Threads acquiring and releasing one name as fast as they can, so that an acquire often
+    // races the release of what was the last reference
+    bool CheckChurn(uint32_t numThreads, uint32_t iterations)
+    {
+        LiveCounts counts;
+        TextureRegistry registry;
+        const wstring name = TextureName(0);
+        const uint64_t expected = ExpectedValue(name);
+        atomic<uint64_t> wrongValues(0);
+
+        auto worker = [&]
+        {
+            for (uint32_t i = 0; i < iterations; ++i)
+            {
+                bool created = false;
+                StubTexture* tex = static_cast<StubTexture*>(
+                    registry.Acquire(name, [&counts] { return new StubTexture(counts, 0); }, created));
+                if (created)
+                {
+                    tex->Value = expected;
+                    registry.MarkLoaded(*tex);
+                }
+                else
+                    registry.WaitForLoad(*tex);
+
+                if (tex->Value != expected)
+                    ++wrongValues;
+                registry.Release(*tex);
+            }
+        };
+
+        vector<thread> threads;
+        for (uint32_t t = 1; t < numThreads; ++t)
+            threads.emplace_back(worker);
+        worker();
+        for (thread& t : threads)
+            t.join();
+
+        TextureRegistry::Stats stats = registry.GetStats();
+        return Report("acquires racing the last release", wrongValues == 0 && counts.Total == 0 &&
+            stats.NumEntries == 0 && stats.Hits + stats.Misses == (uint64_t)numThreads * iterations &&
+            stats.Removals == counts.Deleted);
+    }
+
+    struct StressSettings
+    {
+        uint32_t Threads = 8;
+        uint32_t Operations = 200000;   // Per run, split over the threads
+        uint32_t Textures = 512;
+        uint32_t UploadUs = 200;
+        uint32_t MaxHeld = 64;          // References each thread holds at most
+        uint32_t Seed = 1;
+    };
+
+    struct StressResult
+    {
+        double Ms = 0.0;
+        uint64_t Acquires = 0;
+        uint64_t Loads = 0;
+        uint64_t WrongValues = 0;
+        uint64_t Duplicates = 0;        // Acquires that returned another entry than one still held
+    };
+
+    // The entry that threads hold references to, per name.  While any reference is held, an
+    // acquire of the name must return the same entry.  Once the last one is released a new
+    // entry may be created while the old one is still being deleted.
+    class HeldEntries
+    {
+    public:
+        explicit HeldEntries(uint32_t numNames) : m_Names(numNames) {}
+
+        bool Add(StubTexture* tex)
+        {
+            Name& name = m_Names[tex->m_NameIdx];
+            lock_guard<mutex> guard(name.Mutex);
+            const bool same = name.Holders == 0 || name.Held == tex;
+            name.Held = tex;
+            ++name.Holders;
+            return same;
+        }
+
+        void Remove(StubTexture* tex)
+        {
+            Name& name = m_Names[tex->m_NameIdx];
+            lock_guard<mutex> guard(name.Mutex);
+            --name.Holders;
+        }
+
+    private:
+        struct Name
+        {
+            mutex Mutex;
+            StubTexture* Held = nullptr;
+            uint32_t Holders = 0;
+        };
+        vector<Name> m_Names;
+    };
+
+    // Loader threads acquiring, copying and releasing references at random.  'acquire' returns
+    // the texture with a reference added, loaded, and 'release' drops one reference.
+    template <typename Acquire, typename AddRef, typename Release>
+    StressResult RunStress(const StressSettings& settings, const Acquire& acquire, const AddRef& addRef,
+        const Release& release)
+    {
+        atomic<uint64_t> acquires(0);
+        atomic<uint64_t> loads(0);
+        atomic<uint64_t> wrongValues(0);
+        atomic<uint64_t> duplicates(0);
+        HeldEntries heldEntries(settings.Textures);
+
+        auto worker = [&](uint32_t t)
+        {
+            mt19937 rng(settings.Seed * 7919 + t);
+            vector<StubTexture*> held;
+            const uint32_t operations = settings.Operations / settings.Threads;
+
+            for (uint32_t op = 0; op < operations; ++op)
+            {
+                const uint32_t choice = rng() % 8;
+                if (held.size() >= settings.MaxHeld || (choice < 3 && !held.empty()))
+                {
+                    const size_t idx = rng() % held.size();
+                    heldEntries.Remove(held[idx]);
+                    release(held[idx]);
+                    held[idx] = held.back();
+                    held.pop_back();
+                }
+                else if (choice == 3 && !held.empty())
+                {
+                    StubTexture* tex = held[rng() % held.size()];
+                    addRef(tex);
+                    heldEntries.Add(tex);
+                    held.push_back(tex);
+                }
+                else
+                {
+                    // A few popular textures are shared by many materials
+                    const uint32_t nameIdx = rng() % 4 == 0 ? rng() % 8 : rng() % settings.Textures;
+                    bool loaded = false;
+                    StubTexture* tex = acquire(nameIdx, loaded);
+                    if (tex->Value != ExpectedValue(TextureName(nameIdx)))
+                        ++wrongValues;
+                    if (!heldEntries.Add(tex))
+                        ++duplicates;
+                    ++acquires;
+                    if (loaded)
+                        ++loads;
+                    held.push_back(tex);
+                }
+            }
+
+            for (StubTexture* tex : held)
+            {
+                heldEntries.Remove(tex);
+                release(tex);
+            }
+        };
+
+        const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        vector<thread> threads;
+        for (uint32_t t = 1; t < settings.Threads; ++t)
+            threads.emplace_back(worker, t);
+        worker(0);
+        for (thread& t : threads)
+            t.join();
+
+        StressResult result;
+        result.Ms = MillisecondsSince(start);
+        result.Acquires = acquires;
+        result.Loads = loads;
+        result.WrongValues = wrongValues;
+        result.Duplicates = duplicates;
+        return result;
+    }
+
+    StressResult StressRegistry(const StressSettings& settings, LiveCounts& counts, TextureRegistry::Stats& stats)
+    {
+        TextureRegistry registry;
+
+        auto acquire = [&](uint32_t nameIdx, bool& loaded)
+        {
+            const wstring name = TextureName(nameIdx);
+            StubTexture* tex = static_cast<StubTexture*>(
+                registry.Acquire(name, [&counts, nameIdx] { return new StubTexture(counts, nameIdx); }, loaded));
+
+            if (loaded)
+            {
+                StubUpload(settings.UploadUs);
+                tex->Value = ExpectedValue(name);
+                registry.MarkLoaded(*tex);
+            }
+            else
+                registry.WaitForLoad(*tex);
+
+            return tex;
+        };
+        auto addRef = [&](StubTexture* tex) { registry.AddRef(*tex); };
+        auto release = [&](StubTexture* tex) { registry.Release(*tex); };
+
+        StressResult result = RunStress(settings, acquire, addRef, release);
+        stats = registry.GetStats();
+        return result;
+    }
+
+    // The previous TextureManager: one lock around the map, held while spinning on a texture
+    // that another thread is loading.  Its counts are atomic here to keep the test sound.
+    struct LegacyTexture
+    {
+        StubTexture* Texture;
+        atomic<bool> IsLoading{true};
+        atomic<uint32_t> ReferenceCount{0};
+    };
+
+    StressResult StressLegacy(const StressSettings& settings, LiveCounts& counts, uint64_t& spins)
+    {
+        mutex cacheMutex;
+        map<wstring, unique_ptr<LegacyTexture>> cache;
+        atomic<uint64_t> spinCount(0);
+
+        auto acquire = [&](uint32_t nameIdx, bool& loaded)
+        {
+            const wstring name = TextureName(nameIdx);
+            LegacyTexture* tex = nullptr;
+            {
+                lock_guard<mutex> guard(cacheMutex);
+                auto iter = cache.find(name);
+                if (iter != cache.end())
+                {
+                    tex = iter->second.get();
+                    ++tex->ReferenceCount;
+                    while (tex->IsLoading)
+                    {
+                        ++spinCount;
+                        this_thread::yield();
+                    }
+                    loaded = false;
+                    return tex->Texture;
+                }
+
+                tex = new LegacyTexture;
+                tex->Texture = new StubTexture(counts, nameIdx);
+                tex->ReferenceCount = 1;
+                cache[name].reset(tex);
+            }
+
+            StubUpload(settings.UploadUs);
+            tex->Texture->Value = ExpectedValue(name);
+            tex->IsLoading = false;
+            loaded = true;
+            return tex->Texture;
+        };
+        auto addRef = [&](StubTexture* tex)
+        {
+            lock_guard<mutex> guard(cacheMutex);
+            ++cache[TextureName(tex->m_NameIdx)]->ReferenceCount;
+        };
+        auto release = [&](StubTexture* tex)
+        {
+            lock_guard<mutex> guard(cacheMutex);
+            auto iter = cache.find(TextureName(tex->m_NameIdx));
+            if (--iter->second->ReferenceCount == 0)
+            {
+                delete iter->second->Texture;
+                cache.erase(iter);
+            }
+        };
+
+        StressResult result = RunStress(settings, acquire, addRef, release);
+        spins = spinCount;
+        return result;
+    }
+
+    bool CheckStress(const StressSettings& settings, const char* name)
+    {
+        LiveCounts counts;
+        TextureRegistry::Stats stats;
+        StressResult result = StressRegistry(settings, counts, stats);
+
+        return Report(name, result.WrongValues == 0 && result.Duplicates == 0 && counts.Total == 0 &&
+            counts.Created == counts.Deleted && stats.NumEntries == 0 &&
+            stats.Hits + stats.Misses == result.Acquires && stats.Misses == result.Loads &&
+            stats.Removals == counts.Deleted);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    StressSettings settings;
+    settings.Threads = max(thread::hardware_concurrency(), 2u);
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (arg + 1 < argc && strcmp("-threads", argv[arg]) == 0)
+            settings.Threads = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-operations", argv[arg]) == 0)
+            settings.Operations = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-textures", argv[arg]) == 0)
+            settings.Textures = max(atoi(argv[++arg]), 8);
+        else if (arg + 1 < argc && strcmp("-upload", argv[arg]) == 0)
+            settings.UploadUs = max(atoi(argv[++arg]), 0);
+        else if (arg + 1 < argc && strcmp("-seed", argv[arg]) == 0)
+            settings.Seed = (uint32_t)atoi(argv[++arg]);
+        else
+        {
+            printf(
+                "Usage:  %s [options]*\n\n"
+                "Options:\n\n"
+                "-threads <integer>\n\tLoader threads.\n\tDefaults to the number of hardware threads.\n"
+                "-operations <integer>\n\tAcquires, copies and releases per run.\n\tDefaults to 200000.\n"
+                "-textures <integer>\n\tDistinct texture names.\n\tDefaults to 512.\n"
+                "-upload <integer>\n\tStubbed load time of a texture in microseconds.\n\tDefaults to 200.\n"
+                "-seed <integer>\n\tRandom seed.\n\tDefaults to 1.\n\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    bool passed = CheckBasics();
+    passed &= CheckWaiters();
+    passed &= CheckChurn(max(settings.Threads, 4u), 50000);
+
+    StressSettings instant = settings;
+    instant.UploadUs = 0;
+    passed &= CheckStress(instant, "stress, instant loads");
+
+    StressSettings contended = settings;
+    contended.Textures = 16;
+    contended.Operations = min(settings.Operations, 50000u);
+    passed &= CheckStress(contended, "stress, 16 textures");
+
+    passed &= CheckStress(settings, "stress");
+
+    printf("\n%u threads, %u operations over %u textures, %u us per load:\n", settings.Threads,
+        settings.Operations, settings.Textures, settings.UploadUs);
+
+    LiveCounts registryCounts;
+    TextureRegistry::Stats stats;
+    StressResult registry = StressRegistry(settings, registryCounts, stats);
+    printf("  TextureRegistry:  %8.1f ms, %llu hits, %llu misses, %llu waits for %.1f ms\n", registry.Ms,
+        (unsigned long long)stats.Hits, (unsigned long long)stats.Misses, (unsigned long long)stats.Waits, stats.WaitMs);
+
+    LiveCounts legacyCounts;
+    uint64_t spins = 0;
+    StressResult legacy = StressLegacy(settings, legacyCounts, spins);
+    printf("  Single mutex:     %8.1f ms, %llu loads, %llu yields spinning on loads\n", legacy.Ms,
+        (unsigned long long)legacy.Loads, (unsigned long long)spins);
+
+    passed &= Report("benchmark results", registry.WrongValues == 0 && legacy.WrongValues == 0 &&
+        registry.Duplicates == 0 && legacy.Duplicates == 0 &&
+        registryCounts.Total == 0 && legacyCounts.Total == 0);
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,585 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+//
+// Simulation tests and a benchmark for TextureResidency, e.g.
+//
+//     TextureStreamingSim -textures 20000 -frames 600 -budget 512 -seed 1
+//
+// A camera flies down a corridor lined with textured objects. Every frame the objects in view
+// report their screen coverage, loads complete after a few frames and some fail, as file
+// reads would. The tests replay the loads and evictions on their own copy of each texture's
+// resident mips and check that it matches the bookkeeping, that the budget holds and that the
+// mips that end up resident are the ones with the highest priority.
+//
+
+#include "../../Core/TextureResidency.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    typedef TextureResidency::TextureDesc TextureDesc;
+
+    // TextureManager keeps mips of at most this size resident
+    const uint32_t kTailSize = 128;
+
+    bool Report(const char* name, bool passed)
+    {
+        printf("%s %s\n", passed ? "Passed" : "FAILED", name);
+        return passed;
+    }
+
+    // A block compressed texture with a full mip chain
+    TextureDesc MakeDesc(uint32_t width, uint32_t height, uint32_t blockBytes)
+    {
+        TextureDesc desc;
+        desc.Width = width;
+        desc.Height = height;
+        desc.NumMips = 1;
+        while (desc.NumMips < TextureResidency::kMaxMips && max(width, height) >> desc.NumMips != 0)
+            ++desc.NumMips;
+
+        desc.TailMip = desc.NumMips - 1;
+        for (uint32_t mip = 0; mip < desc.NumMips; ++mip)
+        {
+            const uint32_t w = max(width >> mip, 1u);
+            const uint32_t h = max(height >> mip, 1u);
+            desc.MipBytes[mip] = (uint64_t)((w + 3) / 4) * ((h + 3) / 4) * blockBytes;
+            if (max(w, h) <= kTailSize)
+                desc.TailMip = min(desc.TailMip, mip);
+        }
+        return desc;
+    }
+
+    uint64_t BytesFrom(const TextureDesc& desc, uint32_t mip)
+    {
+        uint64_t bytes = 0;
+        for (; mip < desc.NumMips; ++mip)
+            bytes += desc.MipBytes[mip];
+        return bytes;
+    }
+
+    double Texels(const TextureDesc& desc, uint32_t mip)
+    {
+        return (double)max(desc.Width >> mip, 1u) * (double)max(desc.Height >> mip, 1u);
+    }
+
+    bool CheckBasics()
+    {
+        bool passed = true;
+        vector<TextureResidency::Load> loads;
+        vector<TextureResidency::Eviction> evictions;
+
+        const TextureDesc desc = MakeDesc(1024, 1024, 8);
+        const uint64_t tailBytes = BytesFrom(desc, desc.TailMip);
+
+        TextureResidency::Settings settings;
+        settings.BudgetBytes = 64ull << 20;
+        settings.HintFrames = 10;
+        TextureResidency residency(settings);
+
+        const uint32_t tex = residency.AddTexture(desc);
+        passed &= Report("mip tail resident at first",
+            desc.TailMip == 3 && residency.GetResidentMip(tex) == 3 && residency.GetStats().ResidentBytes == tailBytes);
+
+        residency.Update(1, loads, evictions);
+        passed &= Report("nothing loads without a hint", loads.empty() && evictions.empty());
+
+        residency.SetCoverage(tex, 1024.0f * 1024.0f, 2);
+        residency.Update(2, loads, evictions);
+        passed &= Report("full coverage loads every mip at once", loads.size() == 1 && loads[0].Handle == tex &&
+            loads[0].FirstMip == 0 && loads[0].EndMip == 3 && residency.IsLoadPending(tex) &&
+            residency.GetStats().PendingBytes == BytesFrom(desc, 0) - tailBytes);
+
+        residency.Update(3, loads, evictions);
+        passed &= Report("a texture loads once at a time", loads.empty() && evictions.empty());
+
+        residency.CompleteLoad(tex, true);
+        TextureResidency::Stats stats = residency.GetStats();
+        passed &= Report("completed load is resident", residency.GetResidentMip(tex) == 0 &&
+            stats.ResidentBytes == BytesFrom(desc, 0) && stats.PendingBytes == 0 && stats.NumPendingLoads == 0);
+
+        // A quarter of 1080p wants mip 1, but the extra mip stays while there is room
+        residency.SetCoverage(tex, 1920.0f * 1080.0f / 4.0f, 4);
+        residency.Update(4, loads, evictions);
+        passed &= Report("partial coverage wants a coarser mip",
+            residency.GetWantedMip(tex) == 1 && loads.empty() && evictions.empty());
+
+        settings.BudgetBytes = BytesFrom(desc, 1);
+        residency.SetSettings(settings);
+        residency.Update(5, loads, evictions);
+        passed &= Report("smaller budget evicts", evictions.size() == 1 && evictions[0].FirstMip == 1 &&
+            residency.GetResidentMip(tex) == 1 && residency.GetStats().ResidentBytes == BytesFrom(desc, 1));
+
+        // An eviction the caller could not make is put back and tried again
+        residency.CancelEviction(evictions[0]);
+        stats = residency.GetStats();
+        bool cancelled = residency.GetResidentMip(tex) == 0 && stats.ResidentBytes == BytesFrom(desc, 0) &&
+            stats.Evictions == 0 && stats.EvictedBytes == 0;
+        residency.Update(5, loads, evictions);
+        cancelled &= evictions.size() == 1 && evictions[0].FirstMip == 1 && evictions[0].EvictedMip == 0 &&
+            residency.GetResidentMip(tex) == 1 && residency.GetStats().Evictions == 1;
+        passed &= Report("cancelled eviction", cancelled);
+
+        residency.Update(4 + settings.HintFrames, loads, evictions);
+        passed &= Report("hints lapse", residency.GetWantedMip(tex) == desc.TailMip && evictions.empty());
+
+        settings.BudgetBytes = 0;
+        residency.SetSettings(settings);
+        residency.Update(20, loads, evictions);
+        passed &= Report("mip tail is never evicted", evictions.size() == 1 &&
+            residency.GetResidentMip(tex) == desc.TailMip && residency.GetStats().ResidentBytes == tailBytes);
+
+        // Failed loads
+        settings.BudgetBytes = 64ull << 20;
+        residency.SetSettings(settings);
+        residency.SetCoverage(tex, 1e7f, 21);
+        residency.Update(21, loads, evictions);
+        residency.CompleteLoad(tex, false);
+        residency.SetCoverage(tex, 1e7f, 22);
+        residency.Update(22, loads, evictions);
+        stats = residency.GetStats();
+        passed &= Report("failed load is not retried", loads.empty() && stats.FailedLoads == 1 &&
+            stats.PendingBytes == 0 && residency.GetResidentMip(tex) == desc.TailMip);
+
+        // Removal with a load in flight
+        const uint32_t other = residency.AddTexture(desc);
+        residency.SetCoverage(other, 1e7f, 23);
+        residency.Update(23, loads, evictions);
+        residency.RemoveTexture(other);
+        residency.RemoveTexture(tex);
+        stats = residency.GetStats();
+        const uint32_t reused = residency.AddTexture(desc);
+        passed &= Report("removal forgets loads in flight", loads.size() == 1 && stats.NumTextures == 0 &&
+            stats.ResidentBytes == 0 && stats.PendingBytes == 0 && stats.NumPendingLoads == 0 &&
+            reused == tex && !residency.IsLoadPending(reused));
+
+        return passed;
+    }
+
+    bool CheckPriorities()
+    {
+        bool passed = true;
+        vector<TextureResidency::Load> loads;
+        vector<TextureResidency::Eviction> evictions;
+
+        const TextureDesc desc = MakeDesc(1024, 1024, 16);
+        const uint64_t tailBytes = BytesFrom(desc, desc.TailMip);
+        const uint64_t chainBytes = BytesFrom(desc, 0) - tailBytes;
+
+        // Room for one full chain. Both textures fill the screen, so coarse mips of both come
+        // before the finest mip of either.
+        TextureResidency::Settings settings;
+        settings.BudgetBytes = 2 * tailBytes + chainBytes;
+        TextureResidency residency(settings);
+        const uint32_t a = residency.AddTexture(desc);
+        const uint32_t b = residency.AddTexture(desc);
+
+        residency.SetCoverage(a, 1.1e6f, 1);
+        residency.SetCoverage(b, 1.0e6f, 1);
+        residency.Update(1, loads, evictions);
+        for (const TextureResidency::Load& load : loads)
+            residency.CompleteLoad(load.Handle, true);
+        passed &= Report("budget goes to coarse mips first",
+            residency.GetResidentMip(a) == 1 && residency.GetResidentMip(b) == 1);
+
+        // Without its hint b loses its mips to a
+        residency.SetCoverage(a, 1.1e6f, 100);
+        residency.Update(100, loads, evictions);
+        passed &= Report("unseen textures are evicted for seen ones", evictions.size() == 1 &&
+            evictions[0].Handle == b && evictions[0].FirstMip == desc.TailMip &&
+            loads.size() == 1 && loads[0].Handle == a && loads[0].FirstMip == 0 && loads[0].EndMip == 1);
+
+        // Room for one full chain and one without its finest mip. A slightly higher priority
+        // does not take the finest mip from the other texture, it would need twice as much.
+        settings.BudgetBytes = 2 * tailBytes + chainBytes + BytesFrom(desc, 1) - tailBytes;
+        TextureResidency shared(settings);
+        const uint32_t c = shared.AddTexture(desc);
+        const uint32_t d = shared.AddTexture(desc);
+
+        shared.SetCoverage(c, 1.1e6f, 1);
+        shared.Update(1, loads, evictions);
+        for (const TextureResidency::Load& load : loads)
+            shared.CompleteLoad(load.Handle, true);
+
+        shared.SetCoverage(c, 1.1e6f, 2);
+        shared.SetCoverage(d, 1.2e6f, 2);
+        shared.Update(2, loads, evictions);
+        const bool fitted = evictions.empty() && loads.size() == 1 && loads[0].Handle == d &&
+            loads[0].FirstMip == 1 && loads[0].EndMip == desc.TailMip;
+        for (const TextureResidency::Load& load : loads)
+            shared.CompleteLoad(load.Handle, true);
+
+        shared.SetCoverage(c, 1.1e6f, 3);
+        shared.SetCoverage(d, 1.2e6f, 3);
+        shared.Update(3, loads, evictions);
+        passed &= Report("similar priorities do not evict each other",
+            fitted && loads.empty() && evictions.empty() && shared.GetResidentMip(c) == 0);
+
+        // Further away, c needs its finest mip a quarter as much
+        shared.SetCoverage(c, 0.3e6f, 4);
+        shared.SetCoverage(d, 1.2e6f, 4);
+        shared.Update(4, loads, evictions);
+        passed &= Report("much higher priority evicts", evictions.size() == 1 && evictions[0].Handle == c &&
+            evictions[0].FirstMip == 1 && loads.size() == 1 && loads[0].Handle == d && loads[0].FirstMip == 0);
+
+        // Loads in flight are limited
+        settings.BudgetBytes = 1ull << 30;
+        settings.MaxPendingLoads = 3;
+        TextureResidency limited(settings);
+        for (uint32_t i = 0; i < 10; ++i)
+            limited.SetCoverage(limited.AddTexture(desc), 1e6f, 1);
+        limited.Update(1, loads, evictions);
+        const size_t first = loads.size();
+        if (!loads.empty())
+            limited.CompleteLoad(loads[0].Handle, true);
+        limited.Update(1, loads, evictions);
+        passed &= Report("loads in flight are limited", first == 3 && loads.size() == 1 &&
+            limited.GetStats().NumPendingLoads == 3);
+
+        // LOD bias
+        settings.LodBias = 1.0f;
+        TextureResidency biased(settings);
+        const uint32_t tex = biased.AddTexture(desc);
+        biased.SetCoverage(tex, 512.0f * 512.0f, 1);
+        biased.Update(1, loads, evictions);
+        passed &= Report("positive LOD bias wants a sharper mip", biased.GetWantedMip(tex) == 0);
+
+        return passed;
+    }
+
+    struct Scene
+    {
+        vector<TextureDesc> Textures;
+        vector<float> X, Y, Radius;
+    };
+
+    Scene MakeScene(uint32_t numTextures, float length, mt19937& rng)
+    {
+        static const uint32_t sizes[] = { 256, 512, 1024, 1024, 2048, 2048, 4096 };
+
+        Scene scene;
+        for (uint32_t i = 0; i < numTextures; ++i)
+        {
+            const uint32_t width = sizes[rng() % (sizeof(sizes) / sizeof(sizes[0]))];
+            const uint32_t height = rng() % 4 == 0 ? width / 2 : width;
+            scene.Textures.push_back(MakeDesc(width, height, rng() % 2 == 0 ? 8 : 16));
+            scene.X.push_back(uniform_real_distribution<float>(0.0f, length)(rng));
+            scene.Y.push_back(uniform_real_distribution<float>(-10.0f, 10.0f)(rng));
+            scene.Radius.push_back(uniform_real_distribution<float>(1.0f, 8.0f)(rng));
+        }
+        return scene;
+    }
+
+    // Projected area of an object 'distance' away on a 1080p screen with a 60 degree field of view
+    float GetCoverage(float radius, float distance)
+    {
+        const float kFocalPixels = 540.0f / tanf(3.14159265f / 6.0f);
+        const float pixelRadius = kFocalPixels * radius / max(distance, radius);
+        return 3.14159265f * pixelRadius * pixelRadius;
+    }
+
+    struct SimResult
+    {
+        bool Passed = true;
+        double UpdateMs = 0.0;
+        double MaxUpdateMs = 0.0;
+        uint32_t Frames = 0;
+        TextureResidency::Stats Stats;
+    };
+
+    //
+    // Flies the camera down the corridor for 'frames', then holds it still for 'holdFrames'.
+    // While held, the last 'settledFrames' must not load or evict anything, and each texture
+    // still missing a wanted mip must be unable to make room for it.
+    //
+    SimResult Simulate(const char* name, uint32_t numTextures, uint64_t budgetBytes, uint32_t frames,
+        uint32_t holdFrames, uint32_t settledFrames, uint32_t seed, bool shrinkBudget, bool verbose)
+    {
+        const float kLength = 1000.0f;
+        const float kViewDistance = 150.0f;
+
+        mt19937 rng(seed);
+        Scene scene = MakeScene(numTextures, kLength, rng);
+
+        TextureResidency::Settings settings;
+        settings.BudgetBytes = budgetBytes;
+        settings.MaxPendingLoads = 8;
+        settings.HintFrames = 30;
+        TextureResidency residency(settings);
+
+        vector<uint32_t> handles(numTextures), textureOf;
+        for (uint32_t i = 0; i < numTextures; ++i)
+        {
+            handles[i] = residency.AddTexture(scene.Textures[i]);
+            textureOf.resize(max((size_t)handles[i] + 1, textureOf.size()));
+            textureOf[handles[i]] = i;
+        }
+
+        struct InFlight
+        {
+            TextureResidency::Load Load;
+            uint64_t DoneFrame;
+            bool Fails;
+        };
+
+        // The renderer's view of each texture
+        vector<uint32_t> resident(numTextures), coverage(numTextures);
+        vector<float> hint(numTextures, 0.0f);
+        vector<bool> failed(numTextures, false), pending(numTextures, false);
+        vector<InFlight> inFlight;
+        for (uint32_t i = 0; i < numTextures; ++i)
+            resident[i] = scene.Textures[i].TailMip;
+
+        vector<TextureResidency::Load> loads;
+        vector<TextureResidency::Eviction> evictions;
+        SimResult result;
+        uint32_t quietFrames = 0;
+
+        auto fail = [&](uint64_t frame, const char* what)
+        {
+            if (result.Passed)
+                printf("FAILED %s: %s at frame %llu\n", name, what, (unsigned long long)frame);
+            result.Passed = false;
+        };
+
+        const uint32_t totalFrames = frames + holdFrames;
+        for (uint64_t frame = 1; frame <= totalFrames && result.Passed; ++frame)
+        {
+            if (shrinkBudget && frame == frames / 2)
+            {
+                settings.BudgetBytes /= 2;
+                residency.SetSettings(settings);
+            }
+
+            // Reads that finished since the last frame
+            for (size_t i = 0; i < inFlight.size(); )
+            {
+                if (inFlight[i].DoneFrame > frame)
+                {
+                    ++i;
+                    continue;
+                }
+
+                const uint32_t tex = textureOf[inFlight[i].Load.Handle];
+                if (inFlight[i].Fails)
+                    failed[tex] = true;
+                else
+                    resident[tex] = inFlight[i].Load.FirstMip;
+                pending[tex] = false;
+                residency.CompleteLoad(inFlight[i].Load.Handle, !inFlight[i].Fails);
+
+                inFlight[i] = inFlight.back();
+                inFlight.pop_back();
+            }
+
+            // Coverage of what is in view
+            const float camera = min((float)frame, (float)frames) * kLength / frames;
+            for (uint32_t i = 0; i < numTextures; ++i)
+            {
+                const float dx = scene.X[i] - camera;
+                if (dx < -scene.Radius[i] || dx > kViewDistance)
+                    continue;
+
+                hint[i] = GetCoverage(scene.Radius[i], sqrtf(dx * dx + scene.Y[i] * scene.Y[i]));
+                coverage[i] = (uint32_t)frame;
+                residency.SetCoverage(handles[i], hint[i], frame);
+            }
+
+            auto start = chrono::high_resolution_clock::now();
+            residency.Update(frame, loads, evictions);
+            const double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+            result.UpdateMs += ms;
+            result.MaxUpdateMs = max(result.MaxUpdateMs, ms);
+            ++result.Frames;
+
+            for (const TextureResidency::Eviction& eviction : evictions)
+            {
+                const uint32_t tex = textureOf[eviction.Handle];
+                if (pending[tex] || eviction.FirstMip <= resident[tex] || eviction.FirstMip > scene.Textures[tex].TailMip)
+                    fail(frame, "bad eviction");
+                resident[tex] = eviction.FirstMip;
+            }
+
+            for (const TextureResidency::Load& load : loads)
+            {
+                const uint32_t tex = textureOf[load.Handle];
+                if (pending[tex] || failed[tex] || load.EndMip != resident[tex] || load.FirstMip >= load.EndMip)
+                    fail(frame, "bad load");
+                pending[tex] = true;
+                inFlight.push_back({ load, frame + 1 + rng() % 6, rng() % 100 == 0 });
+            }
+
+            quietFrames = loads.empty() && evictions.empty() ? quietFrames + 1 : 0;
+
+            // The bookkeeping matches the renderer
+            uint64_t residentBytes = 0, pendingBytes = 0;
+            bool onlyTails = true;
+            for (uint32_t i = 0; i < numTextures; ++i)
+            {
+                residentBytes += BytesFrom(scene.Textures[i], resident[i]);
+                onlyTails &= pending[i] || resident[i] == scene.Textures[i].TailMip;
+                if (residency.GetResidentMip(handles[i]) != resident[i])
+                    fail(frame, "resident mip differs");
+            }
+            for (const InFlight& load : inFlight)
+            {
+                const TextureDesc& desc = scene.Textures[textureOf[load.Load.Handle]];
+                pendingBytes += BytesFrom(desc, load.Load.FirstMip) - BytesFrom(desc, load.Load.EndMip);
+            }
+
+            const TextureResidency::Stats stats = residency.GetStats();
+            if (stats.ResidentBytes != residentBytes || stats.PendingBytes != pendingBytes ||
+                stats.NumPendingLoads != inFlight.size())
+            {
+                fail(frame, "byte counts differ");
+            }
+
+            // Over budget only while nothing is left to evict
+            if (stats.ResidentBytes + stats.PendingBytes > settings.BudgetBytes && !onlyTails)
+                fail(frame, "over budget");
+
+            if (inFlight.size() > settings.MaxPendingLoads)
+                fail(frame, "too many loads in flight");
+        }
+
+        if (result.Passed && holdFrames > 0)
+        {
+            if (quietFrames < settledFrames)
+                fail(totalFrames, "still loading or evicting after the camera stopped");
+
+            // Each missing wanted mip could neither fit nor evict enough mips of less than half
+            // its priority. That is the most the eviction rule allows.
+            const TextureResidency::Stats stats = residency.GetStats();
+            const uint64_t room = settings.BudgetBytes - min(settings.BudgetBytes, stats.ResidentBytes + stats.PendingBytes);
+            auto priority = [&](uint32_t tex, uint32_t mip)
+            {
+                const float pixels = totalFrames - coverage[tex] < settings.HintFrames ? hint[tex] : 0.0f;
+                return pixels / (float)Texels(scene.Textures[tex], mip);
+            };
+
+            for (uint32_t a = 0; a < numTextures && result.Passed; ++a)
+            {
+                const uint32_t wanted = residency.GetWantedMip(handles[a]);
+                if (failed[a] || pending[a] || resident[a] <= wanted)
+                    continue;
+
+                const uint32_t mip = resident[a] - 1;
+                const float threshold = priority(a, mip) / 2.0f;
+                uint64_t available = room;
+                for (uint32_t b = 0; b < numTextures; ++b)
+                {
+                    for (uint32_t m = resident[b]; b != a && !pending[b] && m < scene.Textures[b].TailMip; ++m)
+                    {
+                        if (priority(b, m) < threshold)
+                            available += scene.Textures[b].MipBytes[m];
+                    }
+                }
+
+                if (available >= scene.Textures[a].MipBytes[mip])
+                    fail(totalFrames, "a wanted mip could have been loaded");
+            }
+        }
+
+        result.Stats = residency.GetStats();
+        if (verbose || !result.Passed)
+        {
+            const TextureResidency::Stats& stats = result.Stats;
+            printf("  %u textures, budget %llu MB: %u loads (%llu MB), %u mips evicted (%llu MB), %u failed\n",
+                numTextures, (unsigned long long)(settings.BudgetBytes >> 20), stats.Loads,
+                (unsigned long long)(stats.LoadedBytes >> 20), stats.Evictions,
+                (unsigned long long)(stats.EvictedBytes >> 20), stats.FailedLoads);
+            printf("  resident %llu MB (tails %llu MB), wanted %llu MB\n", (unsigned long long)(stats.ResidentBytes >> 20),
+                (unsigned long long)(stats.TailBytes >> 20), (unsigned long long)(stats.WantedBytes >> 20));
+        }
+
+        return result;
+    }
+
+    bool CheckSimulations(uint32_t seed)
+    {
+        bool passed = true;
+        passed &= Report("fly-through, tight budget",
+            Simulate("fly-through, tight budget", 2000, 96ull << 20, 1500, 0, 0, seed, false, false).Passed);
+        passed &= Report("fly-through, generous budget",
+            Simulate("fly-through, generous budget", 2000, 1ull << 30, 1500, 0, 0, seed + 1, false, false).Passed);
+        passed &= Report("fly-through, shrinking budget",
+            Simulate("fly-through, shrinking budget", 2000, 256ull << 20, 1500, 0, 0, seed + 2, true, false).Passed);
+        passed &= Report("settles when the camera stops, tight budget",
+            Simulate("settles, tight budget", 2000, 30ull << 20, 500, 300, 100, seed + 3, false, false).Passed);
+        passed &= Report("settles when the camera stops, generous budget",
+            Simulate("settles, generous budget", 2000, 1ull << 30, 500, 300, 100, seed + 4, false, false).Passed);
+        return passed;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numTextures = 20000;
+    uint32_t numFrames = 600;
+    uint32_t budgetMB = 512;
+    uint32_t seed = 1;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (arg + 1 < argc && strcmp("-textures", argv[arg]) == 0)
+            numTextures = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-frames", argv[arg]) == 0)
+            numFrames = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-budget", argv[arg]) == 0)
+            budgetMB = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-seed", argv[arg]) == 0)
+            seed = (uint32_t)atoi(argv[++arg]);
+        else
+        {
+            printf(
+                "Usage:  %s [options]*\n\n"
+                "Options:\n\n"
+                "-textures <integer>\n\tStreamed textures in the benchmark.\n\tDefaults to 20000.\n"
+                "-frames <integer>\n\tFrames of the benchmark fly-through.\n\tDefaults to 600.\n"
+                "-budget <integer>\n\tStreaming budget of the benchmark in MB.\n\tDefaults to 512.\n"
+                "-seed <integer>\n\tRandom seed of the tests and benchmark.\n\tDefaults to 1.\n\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    bool passed = CheckBasics();
+    passed &= CheckPriorities();
+    passed &= CheckSimulations(seed);
+
+    printf("\nFly-through with %u textures over %u frames:\n", numTextures, numFrames);
+    SimResult bench = Simulate("benchmark", numTextures, (uint64_t)budgetMB << 20, numFrames, 0, 0, seed, false, true);
+    printf("  Update %.3f ms per frame on average, %.3f ms at most\n", bench.UpdateMs / bench.Frames, bench.MaxUpdateMs);
+    passed &= bench.Passed;
+
+    return passed ? 0 : 1;
+}
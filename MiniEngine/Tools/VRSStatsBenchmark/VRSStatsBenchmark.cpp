@@ -0,0 +1,205 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Checks the SSE shading rate histogram against the scalar one and times both, e.g.
+//
+//     VRSStatsBenchmark -width 3840 -height 2160 -tile 16 -iterations 1000
+//
+// Tile buffers are laid out like a readback of the shading rate image: one byte per tile and
+// rows padded to 256 bytes.
+//
+
+#include "../../Core/ShadingRateHistogram.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace ShadingRateHistogram;
+
+namespace
+{
+    const uint32_t kRowPitchAlignment = 256;
+
+    struct TileBuffer
+    {
+        vector<uint8_t> Data;
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t RowPitch;
+    };
+
+    // Rates come in blobs like the contrast adaptive output. 'invalidOdds' of every 1000 tiles
+    // get a value that is not a shading rate. Row padding is filled with 1x1 so that reading
+    // past the row shows up as a wrong count.
+    TileBuffer MakeTiles(uint32_t width, uint32_t height, uint32_t rowPitch, uint32_t invalidOdds, uint32_t seed)
+    {
+        TileBuffer tiles;
+        tiles.Width = width;
+        tiles.Height = height;
+        tiles.RowPitch = rowPitch;
+        tiles.Data.assign((size_t)rowPitch * height, kRateValues[k1x1]);
+
+        mt19937 rng(seed);
+        uniform_int_distribution<uint32_t> rate(0, kNumRates - 1), odds(0, 999), blob(1, 24), junk(0, 255);
+
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; )
+            {
+                uint8_t value = kRateValues[rate(rng)];
+                for (uint32_t n = blob(rng); n > 0 && x < width; --n, ++x)
+                    tiles.Data[(size_t)y * rowPitch + x] = odds(rng) < invalidOdds ? (uint8_t)junk(rng) : value;
+            }
+        }
+        return tiles;
+    }
+
+    bool Check(const TileBuffer& tiles, const char* name)
+    {
+        Histogram expected, histogram;
+        BuildScalar(tiles.Data.data(), tiles.Width, tiles.Height, tiles.RowPitch, expected);
+        Build(tiles.Data.data(), tiles.Width, tiles.Height, tiles.RowPitch, histogram);
+
+        if (memcmp(&expected, &histogram, sizeof(Histogram)) != 0)
+        {
+            printf("FAILED %s (%ux%u tiles, pitch %u)\n", name, tiles.Width, tiles.Height, tiles.RowPitch);
+            return false;
+        }
+
+        printf("Passed %s (%ux%u tiles, pitch %u, %llu other)\n", name, tiles.Width, tiles.Height, tiles.RowPitch,
+            (unsigned long long)histogram.Other);
+        return true;
+    }
+
+    bool CheckRollingAverage()
+    {
+        RollingAverage average;
+        average.SetWindow(4);
+
+        Histogram histogram = {};
+        histogram.Total = 100;
+
+        // Ten frames of n% 1x1, so the window holds 6..9
+        for (uint32_t frame = 0; frame < 10; ++frame)
+        {
+            histogram.Counts[k1x1] = frame;
+            average.Add(histogram);
+        }
+
+        bool passed = average.GetSampleCount() == 4 && fabsf(average.GetPercent(k1x1) - 7.5f) < 1e-4f &&
+            average.GetPercent(k4x4) == 0.0f;
+
+        printf("%s rolling average (%.3f%%)\n", passed ? "Passed" : "FAILED", average.GetPercent(k1x1));
+        return passed;
+    }
+
+    template <typename BuildFunction>
+    void Benchmark(const char* name, const TileBuffer& tiles, uint32_t iterations, BuildFunction build)
+    {
+        Histogram histogram;
+
+        auto start = chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < iterations; ++i)
+            build(tiles.Data.data(), tiles.Width, tiles.Height, tiles.RowPitch, histogram);
+        auto end = chrono::high_resolution_clock::now();
+
+        printf("%-10s %8.3f us\n", name, chrono::duration<double, micro>(end - start).count() / iterations);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t width = 3840;
+    uint32_t height = 2160;
+    uint32_t tileSize = 16;
+    uint32_t iterations = 1000;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (arg + 1 < argc && strcmp("-width", argv[arg]) == 0)
+            width = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-height", argv[arg]) == 0)
+            height = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-tile", argv[arg]) == 0)
+            tileSize = max(atoi(argv[++arg]), 1);
+        else if (arg + 1 < argc && strcmp("-iterations", argv[arg]) == 0)
+            iterations = max(atoi(argv[++arg]), 1);
+        else
+        {
+            printf(
+                "Usage:  %s [options]*\n\n"
+                "Options:\n\n"
+                "-width <integer>\n-height <integer>\n\tRender resolution.\n\tDefaults to 3840x2160.\n"
+                "-tile <integer>\n\tShading rate tile size in pixels.\n\tDefaults to 16.\n"
+                "-iterations <integer>\n\tTimed repetitions.\n\tDefaults to 1000.\n\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    bool passed = true;
+
+    // Edge cases
+    passed &= Check(MakeTiles(0, 0, kRowPitchAlignment, 0, 1), "empty");
+    passed &= Check(MakeTiles(1, 1, kRowPitchAlignment, 0, 2), "single tile");
+    passed &= Check(MakeTiles(15, 3, kRowPitchAlignment, 0, 3), "narrow rows");
+
+    // Packed rows are counted as one run, and more than 255 steps must not wrap the byte counters
+    passed &= Check(MakeTiles(4096, 64, 4096, 0, 4), "packed rows");
+    {
+        TileBuffer tiles = MakeTiles(4096, 64, 4096, 0, 5);
+        fill(tiles.Data.begin(), tiles.Data.end(), kRateValues[k4x4]);
+        passed &= Check(tiles, "uniform 4x4");
+    }
+
+    // Common resolutions with 8 and 16 pixel tiles
+    const uint32_t resolutions[][2] = { { 1280, 720 }, { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+    for (const auto& res : resolutions)
+    {
+        for (uint32_t tile : { 8u, 16u })
+        {
+            uint32_t w = (res[0] + tile - 1) / tile, h = (res[1] + tile - 1) / tile;
+            uint32_t pitch = (w + kRowPitchAlignment - 1) & ~(kRowPitchAlignment - 1);
+
+            char name[64];
+            snprintf(name, sizeof(name), "%ux%u, %u pixel tiles", res[0], res[1], tile);
+            passed &= Check(MakeTiles(w, h, pitch, 10, res[0] + tile), name);
+        }
+    }
+
+    passed &= CheckRollingAverage();
+
+    const uint32_t w = (width + tileSize - 1) / tileSize, h = (height + tileSize - 1) / tileSize;
+    const uint32_t pitch = (w + kRowPitchAlignment - 1) & ~(kRowPitchAlignment - 1);
+    TileBuffer tiles = MakeTiles(w, h, pitch, 0, 6);
+    printf("\n%ux%u tiles (%ux%u at %u pixels):\n", w, h, width, height, tileSize);
+
+    Benchmark("scalar", tiles, iterations, BuildScalar);
+    Benchmark("sse", tiles, iterations, Build);
+
+    return passed ? 0 : 1;
+}
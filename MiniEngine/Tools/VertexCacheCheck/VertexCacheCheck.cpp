@@ -0,0 +1,311 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Checks that the vertex cache optimizers only reorder triangles and that they lower the miss
+// ratio of scrambled meshes, checks the analyzers on meshes with known answers, and compares
+// Tipsify with the Forsyth optimizer in time and quality.
+//
+
+#include "../../Model/VertexCacheOptimize.h"
+#include "../../Model/IndexOptimizePostTransform.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace VertexCacheOptimize;
+
+namespace
+{
+    struct Mesh
+    {
+        vector<float> positions;    // float3
+        vector<uint32_t> indices;
+
+        uint32_t VertexCount() const { return (uint32_t)(positions.size() / 3); }
+
+        uint32_t AddVertex(float x, float y, float z)
+        {
+            positions.push_back(x);
+            positions.push_back(y);
+            positions.push_back(z);
+            return VertexCount() - 1;
+        }
+
+        void AddTriangle(uint32_t a, uint32_t b, uint32_t c)
+        {
+            indices.push_back(a);
+            indices.push_back(b);
+            indices.push_back(c);
+        }
+    };
+
+    // Quads of 'size' in the plane z = 'z', facing +z, in row order
+    void AddGrid(Mesh& mesh, uint32_t width, uint32_t height, float size, float z)
+    {
+        const uint32_t base = mesh.VertexCount();
+        for (uint32_t y = 0; y <= height; ++y)
+        {
+            for (uint32_t x = 0; x <= width; ++x)
+                mesh.AddVertex(x * size / width, y * size / height, z);
+        }
+
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                const uint32_t v = base + y * (width + 1) + x;
+                mesh.AddTriangle(v, v + 1, v + width + 2);
+                mesh.AddTriangle(v, v + width + 2, v + width + 1);
+            }
+        }
+    }
+
+    // Counter-clockwise seen from outside
+    void AddSphere(Mesh& mesh, float cx, float cy, float cz, float radius, uint32_t rings, uint32_t segments)
+    {
+        const float kPi = 3.14159265f;
+        const uint32_t base = mesh.VertexCount();
+        for (uint32_t r = 0; r <= rings; ++r)
+        {
+            const float theta = kPi * r / rings;
+            for (uint32_t s = 0; s <= segments; ++s)
+            {
+                const float phi = 2.0f * kPi * s / segments;
+                mesh.AddVertex(cx + radius * sin(theta) * cos(phi), cy + radius * sin(theta) * sin(phi), cz + radius * cos(theta));
+            }
+        }
+
+        for (uint32_t r = 0; r < rings; ++r)
+        {
+            for (uint32_t s = 0; s < segments; ++s)
+            {
+                const uint32_t v = base + r * (segments + 1) + s;
+                mesh.AddTriangle(v, v + segments + 1, v + 1);
+                mesh.AddTriangle(v + 1, v + segments + 1, v + segments + 2);
+            }
+        }
+    }
+
+    vector<uint32_t> ShuffleTriangles(const vector<uint32_t>& indices, mt19937& rng)
+    {
+        vector<uint32_t> order(indices.size() / 3);
+        for (uint32_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+        shuffle(order.begin(), order.end(), rng);
+
+        vector<uint32_t> shuffled;
+        shuffled.reserve(indices.size());
+        for (uint32_t f : order)
+            shuffled.insert(shuffled.end(), indices.begin() + f * 3, indices.begin() + f * 3 + 3);
+        return shuffled;
+    }
+
+    // Same triangles with the same winding and first vertex, in any order
+    bool SameTriangles(const vector<uint32_t>& a, const vector<uint32_t>& b)
+    {
+        if (a.size() != b.size())
+            return false;
+
+        auto triangles = [](const vector<uint32_t>& indices)
+        {
+            vector<array<uint32_t, 3>> tris(indices.size() / 3);
+            for (size_t f = 0; f < tris.size(); ++f)
+                tris[f] = { { indices[f * 3], indices[f * 3 + 1], indices[f * 3 + 2] } };
+            sort(tris.begin(), tris.end());
+            return tris;
+        };
+
+        return triangles(a) == triangles(b);
+    }
+
+    double Milliseconds(chrono::high_resolution_clock::time_point start)
+    {
+        return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    }
+
+    struct Ordering
+    {
+        const char* name;
+        vector<uint32_t> indices;
+        double ms;
+    };
+
+    bool CheckMesh(const char* name, const Mesh& mesh, const vector<uint32_t>& input, bool checkOverdraw)
+    {
+        const uint32_t vertexCount = mesh.VertexCount();
+        const size_t indexCount = input.size();
+        const uint32_t stride = 3 * sizeof(float);
+        vector<Ordering> orderings;
+
+        auto start = chrono::high_resolution_clock::now();
+        vector<uint32_t> forsyth(indexCount);
+        OptimizeFaces(input.data(), indexCount, forsyth.data(), kMaxForsythCacheSize);
+        orderings.push_back({ "Forsyth", forsyth, Milliseconds(start) });
+
+        start = chrono::high_resolution_clock::now();
+        vector<uint32_t> tipsify(indexCount);
+        Tipsify(input.data(), indexCount, vertexCount, kDefaultFifoCacheSize, tipsify.data());
+        orderings.push_back({ "Tipsify", tipsify, Milliseconds(start) });
+        const double tipsifyMs = orderings.back().ms;
+
+        start = chrono::high_resolution_clock::now();
+        vector<uint32_t> clustered(indexCount);
+        ReduceOverdraw(tipsify.data(), indexCount, mesh.positions.data(), vertexCount, stride, kDefaultFifoCacheSize,
+            1.05f, clustered.data());
+        orderings.push_back({ "Tipsify + overdraw", clustered, tipsifyMs + Milliseconds(start) });
+
+        const CacheStatistics inputCache = AnalyzeVertexCache(input.data(), indexCount, vertexCount, kDefaultFifoCacheSize);
+        const OverdrawStatistics inputOverdraw = checkOverdraw ?
+            AnalyzeOverdraw(input.data(), indexCount, mesh.positions.data(), vertexCount, stride) : OverdrawStatistics();
+
+        printf("%s: %u triangles, %u vertices, input ACMR %.3f ATVR %.3f overdraw %.3f\n", name, inputCache.triangles,
+            inputCache.vertices, inputCache.acmr, inputCache.atvr, inputOverdraw.overdraw);
+
+        bool passed = true;
+        CacheStatistics tipsifyCache;
+        float tipsifyOverdraw = 0.0f;
+
+        for (const Ordering& ordering : orderings)
+        {
+            const CacheStatistics cache = AnalyzeVertexCache(ordering.indices.data(), indexCount, vertexCount, kDefaultFifoCacheSize);
+            const OverdrawStatistics overdraw = checkOverdraw ?
+                AnalyzeOverdraw(ordering.indices.data(), indexCount, mesh.positions.data(), vertexCount, stride) : OverdrawStatistics();
+
+            bool ok = SameTriangles(input, ordering.indices) && cache.vertices == inputCache.vertices &&
+                cache.atvr >= 1.0f && cache.acmr < inputCache.acmr;
+
+            if (&ordering == &orderings[1])
+            {
+                tipsifyCache = cache;
+                tipsifyOverdraw = overdraw.overdraw;
+            }
+            else if (&ordering == &orderings[2])
+            {
+                // Clusters are only split where locality stays within the threshold, and
+                // sorting them should not add overdraw
+                ok &= cache.acmr <= tipsifyCache.acmr * 1.1f;
+                ok &= !checkOverdraw || overdraw.overdraw <= tipsifyOverdraw;
+            }
+
+            printf("  %s %-20s %8.2f ms, ACMR %.3f ATVR %.3f overdraw %.3f\n", ok ? "Passed" : "FAILED", ordering.name,
+                ordering.ms, cache.acmr, cache.atvr, overdraw.overdraw);
+            passed &= ok;
+        }
+
+        return passed;
+    }
+
+    bool Report(const char* name, bool ok)
+    {
+        printf("%s %s\n", ok ? "Passed" : "FAILED", name);
+        return ok;
+    }
+}
+
+int main()
+{
+    bool passed = true;
+    mt19937 rng(11);
+
+    // Analyzer results that can be worked out by hand
+    {
+        const uint32_t tri[] = { 0, 1, 2 };
+        const CacheStatistics single = AnalyzeVertexCache(tri, 3, 3, kDefaultFifoCacheSize);
+        passed &= Report("single triangle ACMR 3, ATVR 1", single.acmr == 3.0f && single.atvr == 1.0f);
+
+        // Two passes over a 9 vertex strip: the second pass hits while all of them fit
+        Mesh strip;
+        for (uint32_t v = 0; v < 9; ++v)
+            strip.AddVertex((float)v, 0.0f, 0.0f);
+        vector<uint32_t> twice;
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            for (uint32_t v = 0; v + 2 < 9; ++v)
+                twice.insert(twice.end(), { v, v + 1, v + 2 });
+        }
+        const CacheStatistics fits = AnalyzeVertexCache(twice.data(), twice.size(), 9, 16);
+        const CacheStatistics spills = AnalyzeVertexCache(twice.data(), twice.size(), 9, 4);
+        passed &= Report("FIFO cache hits and evictions", fits.transforms == 9 && fits.atvr == 1.0f && spills.transforms > 9);
+
+        // Two stacked layers facing +z: back to front shades every covered pixel twice
+        Mesh layers;
+        AddGrid(layers, 4, 4, 1.0f, 0.0f);
+        AddGrid(layers, 4, 4, 1.0f, 1.0f);
+        const OverdrawStatistics backToFront = AnalyzeOverdraw(layers.indices.data(), layers.indices.size(),
+            layers.positions.data(), layers.VertexCount(), 3 * sizeof(float));
+
+        vector<uint32_t> frontFirst(layers.indices.begin() + layers.indices.size() / 2, layers.indices.end());
+        frontFirst.insert(frontFirst.end(), layers.indices.begin(), layers.indices.begin() + layers.indices.size() / 2);
+        const OverdrawStatistics frontToBack = AnalyzeOverdraw(frontFirst.data(), frontFirst.size(),
+            layers.positions.data(), layers.VertexCount(), 3 * sizeof(float));
+
+        passed &= Report("overdraw of stacked layers", backToFront.overdraw == 2.0f && frontToBack.overdraw == 1.0f &&
+            backToFront.pixelsCovered == frontToBack.pixelsCovered && backToFront.pixelsCovered > 0);
+
+        // ReduceOverdraw puts the front layer first, as the layers share no vertices
+        vector<uint32_t> clustered(layers.indices.size());
+        ReduceOverdraw(layers.indices.data(), layers.indices.size(), layers.positions.data(), layers.VertexCount(),
+            3 * sizeof(float), kDefaultFifoCacheSize, 1.05f, clustered.data());
+        const OverdrawStatistics reduced = AnalyzeOverdraw(clustered.data(), clustered.size(),
+            layers.positions.data(), layers.VertexCount(), 3 * sizeof(float));
+        passed &= Report("overdraw reduced for stacked layers", reduced.overdraw == 1.0f && SameTriangles(layers.indices, clustered));
+    }
+
+    // Degenerate inputs
+    {
+        uint32_t none = 0;
+        Tipsify(nullptr, 0, 0, kDefaultFifoCacheSize, &none);
+        ReduceOverdraw(nullptr, 0, nullptr, 0, 12, kDefaultFifoCacheSize, 1.05f, &none);
+        const CacheStatistics empty = AnalyzeVertexCache(nullptr, 0, 0, kDefaultFifoCacheSize);
+
+        const uint32_t partial[] = { 0, 1, 2, 2, 1, 3, 0, 1 };
+        uint32_t out[8] = {};
+        Tipsify(partial, 8, 4, kDefaultFifoCacheSize, out);
+        const bool keepsTail = out[6] == 0 && out[7] == 1;
+
+        const uint32_t repeated[] = { 0, 0, 1, 1, 1, 1, 2, 0, 1 };
+        uint32_t outRepeated[9] = {};
+        Tipsify(repeated, 9, 3, kDefaultFifoCacheSize, outRepeated);
+        const bool keepsDegenerate = SameTriangles(vector<uint32_t>(repeated, repeated + 9), vector<uint32_t>(outRepeated, outRepeated + 9));
+
+        passed &= Report("empty, partial and degenerate input", empty.acmr == 0.0f && keepsTail && keepsDegenerate);
+    }
+
+    Mesh grid;
+    AddGrid(grid, 400, 400, 1.0f, 0.0f);
+    passed &= CheckMesh("scrambled grid", grid, ShuffleTriangles(grid.indices, rng), false);
+
+    Mesh spheres;
+    uniform_real_distribution<float> position(-1.0f, 1.0f);
+    for (int i = 0; i < 40; ++i)
+        AddSphere(spheres, position(rng), position(rng), position(rng), 0.3f + 0.2f * position(rng), 48, 96);
+    passed &= CheckMesh("scrambled spheres", spheres, ShuffleTriangles(spheres.indices, rng), true);
+
+    // Already in a good order, where Tipsify must still not lose triangles
+    passed &= CheckMesh("sphere rings", spheres, spheres.indices, true);
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,271 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Checks VertexDeduplicate against the pairwise search the ModelConverter used before and
+// times both, e.g.
+//
+//     VertexDedupBenchmark -vertices 200000 -iterations 5
+//
+// Meshes are generated as triangle lists the way the Assimp importer emits them: every
+// corner is its own vertex with a position, texcoord, normal, tangent and bitangent.
+//
+
+#include "../../Model/VertexDeduplicate.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Matches the layout written by AssimpModel::LoadAssimp
+    struct Vertex
+    {
+        float position[3];
+        float texcoord[2];
+        float normal[3];
+        float tangent[3];
+        float bitangent[3];
+    };
+
+    const uint32_t kStride = sizeof(Vertex);
+
+    // The original O(n^2) ModelConverter code, kept as the reference
+    uint32_t DeduplicateReference(const uint8_t* vertices, uint32_t vertexCount, uint32_t stride,
+        uint8_t* uniqueVertices, uint32_t* remap)
+    {
+        uint32_t uniqueCount = 0;
+        memset(remap, 0xFF, sizeof(uint32_t) * vertexCount);
+
+        for (uint32_t v1 = 0; v1 < vertexCount; v1++)
+        {
+            if (remap[v1] != (uint32_t)-1)
+                continue;
+
+            const uint8_t* v1Data = vertices + (size_t)v1 * stride;
+            uint32_t slot = uniqueCount++;
+            remap[v1] = slot;
+            memcpy(uniqueVertices + (size_t)slot * stride, v1Data, stride);
+
+            for (uint32_t v2 = v1 + 1; v2 < vertexCount; v2++)
+            {
+                if (remap[v2] == (uint32_t)-1 && memcmp(v1Data, vertices + (size_t)v2 * stride, stride) == 0)
+                    remap[v2] = slot;
+            }
+        }
+
+        return uniqueCount;
+    }
+
+    // A triangulated grid with one vertex per triangle corner. Seams repeat positions with
+    // different texcoords, and 'jitter' perturbs positions by up to that much per corner.
+    vector<Vertex> MakeGridMesh(uint32_t targetVertices, float jitter, uint32_t seed)
+    {
+        const uint32_t cells = max(1u, (uint32_t)sqrt(targetVertices / 6.0));
+        mt19937 rng(seed);
+        uniform_real_distribution<float> noise(-jitter, jitter);
+
+        auto corner = [&](uint32_t x, uint32_t y)
+        {
+            Vertex v = {};
+            v.position[0] = (float)x;
+            v.position[1] = sinf(x * 0.1f) * cosf(y * 0.1f);
+            v.position[2] = (float)y;
+            for (float& p : v.position)
+                p += noise(rng);
+
+            // A texture seam every 16 cells
+            v.texcoord[0] = (x % 16) / 16.0f + (x % 16 == 0 && x > 0 ? 1.0f : 0.0f);
+            v.texcoord[1] = y / (float)cells;
+            v.normal[1] = 1.0f;
+            v.tangent[0] = 1.0f;
+            v.bitangent[2] = 1.0f;
+            return v;
+        };
+
+        vector<Vertex> vertices;
+        vertices.reserve(cells * cells * 6);
+        for (uint32_t y = 0; y < cells; ++y)
+        {
+            for (uint32_t x = 0; x < cells; ++x)
+            {
+                for (uint32_t k : { 0u, 1u, 2u, 2u, 1u, 3u })
+                    vertices.push_back(corner(x + (k & 1), y + (k >> 1)));
+            }
+        }
+        return vertices;
+    }
+
+    bool CheckExact(const vector<Vertex>& mesh, const char* name)
+    {
+        const uint32_t count = (uint32_t)mesh.size();
+        const uint8_t* data = (const uint8_t*)mesh.data();
+
+        vector<uint8_t> expectedVertices((size_t)count * kStride), vertices((size_t)count * kStride);
+        vector<uint32_t> expectedRemap(count), remap(count);
+
+        uint32_t expectedCount = DeduplicateReference(data, count, kStride, expectedVertices.data(), expectedRemap.data());
+        uint32_t uniqueCount = VertexDeduplicate::Deduplicate(data, count, kStride, nullptr, 0, vertices.data(), remap.data());
+
+        if (uniqueCount != expectedCount || remap != expectedRemap ||
+            memcmp(vertices.data(), expectedVertices.data(), (size_t)uniqueCount * kStride) != 0)
+        {
+            printf("FAILED %s (%u vertices, %u unique, expected %u)\n", name, count, uniqueCount, expectedCount);
+            return false;
+        }
+
+        printf("Passed %s (%u -> %u vertices)\n", name, count, uniqueCount);
+        return true;
+    }
+
+    // Merged vertices must share every byte outside the position, and have positions less
+    // than epsilon apart
+    bool CheckWelded(const vector<Vertex>& mesh, float epsilon, const char* name)
+    {
+        const uint32_t count = (uint32_t)mesh.size();
+        vector<Vertex> vertices(count);
+        vector<uint32_t> remap(count);
+
+        VertexDeduplicate::Tolerance tolerance = { offsetof(Vertex, position), 3, epsilon };
+        uint32_t exactCount = VertexDeduplicate::Deduplicate((const uint8_t*)mesh.data(), count, kStride,
+            nullptr, 0, (uint8_t*)vertices.data(), remap.data());
+        uint32_t uniqueCount = VertexDeduplicate::Deduplicate((const uint8_t*)mesh.data(), count, kStride,
+            &tolerance, 1, (uint8_t*)vertices.data(), remap.data());
+
+        bool passed = uniqueCount <= exactCount;
+        for (uint32_t v = 0; passed && v < count; ++v)
+        {
+            const Vertex& a = mesh[v];
+            const Vertex& b = vertices[remap[v]];
+            passed = remap[v] < uniqueCount &&
+                memcmp(&a.texcoord, &b.texcoord, kStride - offsetof(Vertex, texcoord)) == 0;
+            for (int c = 0; passed && c < 3; ++c)
+                passed = fabsf(a.position[c] - b.position[c]) < epsilon;
+        }
+
+        printf("%s %s (%u -> %u vertices, %u without epsilon)\n", passed ? "Passed" : "FAILED",
+            name, count, uniqueCount, exactCount);
+        return passed;
+    }
+
+    template <typename DedupFunction>
+    void Benchmark(const char* name, const vector<Vertex>& mesh, uint32_t iterations, DedupFunction dedup)
+    {
+        const uint32_t count = (uint32_t)mesh.size();
+        vector<uint8_t> vertices((size_t)count * kStride);
+        vector<uint32_t> remap(count);
+        uint32_t uniqueCount = 0;
+
+        double totalMs = 0.0;
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            auto start = chrono::high_resolution_clock::now();
+            uniqueCount = dedup((const uint8_t*)mesh.data(), count, vertices.data(), remap.data());
+            auto end = chrono::high_resolution_clock::now();
+            totalMs += chrono::duration<double, milli>(end - start).count();
+        }
+
+        printf("%-20s %10.3f ms (%u -> %u vertices, %.1f%% fewer)\n", name, totalMs / iterations,
+            count, uniqueCount, 100.0 * (count - uniqueCount) / count);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numVertices = 200000;
+    uint32_t iterations = 5;
+    bool reference = true;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (arg + 1 < argc && strcmp("-vertices", argv[arg]) == 0)
+            numVertices = max(atoi(argv[++arg]), 6);
+        else if (arg + 1 < argc && strcmp("-iterations", argv[arg]) == 0)
+            iterations = max(atoi(argv[++arg]), 1);
+        else if (strcmp("-noreference", argv[arg]) == 0)
+            reference = false;
+        else
+        {
+            printf(
+                "Usage:  %s [options]*\n\n"
+                "Options:\n\n"
+                "-vertices <integer>\n\tApproximate number of triangle list vertices.\n\tDefaults to 200000.\n"
+                "-iterations <integer>\n\tTimed repetitions.\n\tDefaults to 5.\n"
+                "-noreference\n\tSkip timing the quadratic reference, which is slow for large meshes.\n\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    bool passed = true;
+
+    // Edge cases
+    passed &= CheckExact({}, "empty");
+    passed &= CheckExact(MakeGridMesh(1, 0.0f, 1), "single quad");
+    passed &= CheckExact(vector<Vertex>(1000, MakeGridMesh(1, 0.0f, 1)[0]), "identical vertices");
+
+    // Exact mode must reproduce the old output, with and without shared corners
+    passed &= CheckExact(MakeGridMesh(20000, 0.0f, 2), "grid");
+    passed &= CheckExact(MakeGridMesh(20000, 0.001f, 3), "jittered grid");
+
+    // Negative zero and NaN compare by bits, as memcmp did
+    {
+        vector<Vertex> mesh = MakeGridMesh(600, 0.0f, 4);
+        for (size_t i = 0; i < mesh.size(); i += 3)
+            mesh[i].normal[0] = (i % 2) ? -0.0f : NAN;
+        passed &= CheckExact(mesh, "signed zero and NaN");
+    }
+
+    // Welding jittered positions
+    passed &= CheckWelded(MakeGridMesh(20000, 0.001f, 5), 0.01f, "welded grid");
+    passed &= CheckWelded(MakeGridMesh(20000, 0.001f, 6), 0.0005f, "welded grid, small epsilon");
+
+    vector<Vertex> mesh = MakeGridMesh(numVertices, 0.0f, 7);
+    printf("\n%zu vertices:\n", mesh.size());
+
+    if (reference)
+    {
+        Benchmark("pairwise memcmp", mesh, 1, [](const uint8_t* data, uint32_t count, uint8_t* out, uint32_t* remap)
+        {
+            return DeduplicateReference(data, count, kStride, out, remap);
+        });
+    }
+
+    Benchmark("hashed", mesh, iterations, [](const uint8_t* data, uint32_t count, uint8_t* out, uint32_t* remap)
+    {
+        return VertexDeduplicate::Deduplicate(data, count, kStride, nullptr, 0, out, remap);
+    });
+
+    VertexDeduplicate::Tolerance tolerance = { offsetof(Vertex, position), 3, 0.001f };
+    Benchmark("hashed, epsilon", mesh, iterations, [&](const uint8_t* data, uint32_t count, uint8_t* out, uint32_t* remap)
+    {
+        return VertexDeduplicate::Deduplicate(data, count, kStride, &tolerance, 1, out, remap);
+    });
+
+    return passed ? 0 : 1;
+}
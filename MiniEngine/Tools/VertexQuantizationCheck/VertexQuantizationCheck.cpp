@@ -0,0 +1,252 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Checks the octahedral mapping, round trips random vertex streams through every quantized
+// profile and compares the worst case errors with the limits of each format.
+//
+
+#include "../../Model/VertexQuantization.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace VertexQuantization;
+
+namespace
+{
+    struct SourceMesh
+    {
+        vector<float> positions;
+        vector<float> normals;
+        vector<float> tangents;
+        vector<float> uvs[2];
+
+        Streams GetStreams(bool withTangents, uint32_t numUVs) const
+        {
+            Streams streams;
+            streams.vertexCount = (uint32_t)(positions.size() / 3);
+            streams.positions = positions.data();
+            streams.normals = normals.data();
+            streams.tangents = withTangents ? tangents.data() : nullptr;
+            for (uint32_t set = 0; set < numUVs; ++set)
+                streams.uvs[set] = uvs[set].data();
+            return streams;
+        }
+    };
+
+    void RandomUnitVector(mt19937& rng, float v[3])
+    {
+        normal_distribution<float> gaussian;
+        float length = 0.0f;
+        while (length < 1e-3f)
+        {
+            for (int k = 0; k < 3; ++k)
+                v[k] = gaussian(rng);
+            length = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        }
+        for (int k = 0; k < 3; ++k)
+            v[k] /= length;
+    }
+
+    // Positions far from the origin show that quantization is relative to the bounds
+    SourceMesh MakeMesh(mt19937& rng, uint32_t vertexCount, const float offset[3], const float extent[3])
+    {
+        SourceMesh mesh;
+        uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        for (uint32_t v = 0; v < vertexCount; ++v)
+        {
+            for (int k = 0; k < 3; ++k)
+                mesh.positions.push_back(offset[k] + extent[k] * unit(rng));
+
+            float n[3], t[3];
+            RandomUnitVector(rng, n);
+            RandomUnitVector(rng, t);
+            mesh.normals.insert(mesh.normals.end(), n, n + 3);
+            mesh.tangents.insert(mesh.tangents.end(), t, t + 3);
+            mesh.tangents.push_back(unit(rng) < 0.5f ? -1.0f : 1.0f);
+
+            // A tiled base color set and a lightmap style set
+            mesh.uvs[0].push_back(-4.0f + 12.0f * unit(rng));
+            mesh.uvs[0].push_back(2.0f * unit(rng));
+            mesh.uvs[1].push_back(unit(rng));
+            mesh.uvs[1].push_back(unit(rng));
+        }
+
+        return mesh;
+    }
+
+    float Ulp(float value)
+    {
+        return nextafter(fabs(value), numeric_limits<float>::max()) - fabs(value);
+    }
+
+    bool Report(const char* name, bool ok)
+    {
+        printf("%s %s\n", ok ? "Passed" : "FAILED", name);
+        return ok;
+    }
+}
+
+int main()
+{
+    bool passed = true;
+    mt19937 rng(17);
+
+    // The octahedral mapping is exact up to float rounding, including on the folds
+    {
+        float worst = 0.0f;
+        const float special[][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+            { 0.577350f, 0.577350f, -0.577350f }, { -0.707107f, 0.0f, -0.707107f } };
+
+        auto check = [&](const float v[3])
+        {
+            float x, y, decoded[3];
+            OctahedralEncode(v, x, y);
+            OctahedralDecode(x, y, decoded);
+            worst = max(worst, fabs(decoded[0] - v[0]) + fabs(decoded[1] - v[1]) + fabs(decoded[2] - v[2]));
+            return fabs(x) <= 1.0f && fabs(y) <= 1.0f;
+        };
+
+        bool inRange = true;
+        for (const auto& v : special)
+            inRange &= check(v);
+        for (int i = 0; i < 100000; ++i)
+        {
+            float v[3];
+            RandomUnitVector(rng, v);
+            inRange &= check(v);
+        }
+
+        float zero[3] = { 0.0f, 0.0f, 0.0f }, x, y;
+        OctahedralEncode(zero, x, y);
+        passed &= Report("octahedral round trip", inRange && worst < 1e-5f && x == 0.0f && y == 0.0f);
+    }
+
+    passed &= Report("profile names", FindProfile("compact") == kCompact && FindProfile("STANDARD") == kStandard &&
+        FindProfile("none") == kNone && FindProfile("half") == kNumProfiles && strcmp(GetProfileName(kCompact), "Compact") == 0);
+
+    const float offset[3] = { 1000.0f, -250.0f, 40.0f };
+    const float extent[3] = { 100.0f, 3.0f, 20.0f };
+    const SourceMesh mesh = MakeMesh(rng, 200000, offset, extent);
+
+    // Theoretical bounds: half a step of the 16-bit grid, plus rounding of the decode
+    float positionLimit = 0.0f;
+    for (int k = 0; k < 3; ++k)
+    {
+        const float axis = 0.5f * extent[k] / 65535.0f + 4.0f * Ulp(fabs(offset[k]) + extent[k]);
+        positionLimit += axis * axis;
+    }
+    positionLimit = sqrt(positionLimit);
+    const float uvLimit = 0.5f * 12.0f / 65535.0f + 4.0f * Ulp(12.0f);
+
+    // Worst case angles, slightly above what half a step of the octahedral grid can reach
+    const float angleLimit[kNumProfiles] = { 0.0f, 0.02f, 1.0f };
+
+    for (uint32_t p = kStandard; p < kNumProfiles; ++p)
+    {
+        const Profile profile = (Profile)p;
+
+        // Extra bytes before and between the attributes must not be touched
+        const uint32_t frameSize = GetFrameSize(profile);
+        Layout layout;
+        layout.position = 4;
+        layout.frame = layout.position + kPositionSize + 4;
+        layout.uv[0] = layout.frame + frameSize;
+        layout.uv[1] = layout.uv[0] + 4;
+        layout.stride = layout.uv[1] + 4 + 4;
+
+        const Streams streams = mesh.GetStreams(true, 2);
+        const Dequantization dequantization = ComputeDequantization(streams);
+        vector<uint8_t> vertices((size_t)layout.stride * streams.vertexCount, 0xCD);
+
+        auto start = chrono::high_resolution_clock::now();
+        Encode(streams, profile, dequantization, layout, vertices.data());
+        const double encodeMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+        const ErrorStatistics error = MeasureError(streams, vertices.data(), profile, dequantization, layout);
+
+        bool untouched = true;
+        for (uint32_t v = 0; v < streams.vertexCount; ++v)
+        {
+            const uint8_t* vertex = vertices.data() + (size_t)v * layout.stride;
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                untouched &= vertex[i] == 0xCD;
+                untouched &= vertex[layout.position + kPositionSize + i] == 0xCD;
+                untouched &= vertex[layout.stride - 4 + i] == 0xCD;
+            }
+        }
+
+        const bool ok = untouched && error.position <= positionLimit && error.uv <= uvLimit &&
+            error.normalDegrees <= angleLimit[p] && error.tangentDegrees <= angleLimit[p] && error.handednessErrors == 0;
+
+        // Tangent and one UV set, as most meshes are drawn
+        const uint32_t unquantizedStride = 12 + 4 + 4 + 4;
+        const uint32_t quantizedStride = kPositionSize + frameSize + 4;
+
+        printf("%s %-8s %u -> %u bytes, %6.2f ms for %u vertices, max error position %.2e (%.2e of extent), "
+            "normal %.4f deg, tangent %.4f deg, UV %.2e\n", ok ? "Passed" : "FAILED", GetProfileName(profile),
+            unquantizedStride, quantizedStride, encodeMs, streams.vertexCount, error.position, error.positionRelative,
+            error.normalDegrees, error.tangentDegrees, error.uv);
+        passed &= ok;
+
+        // Without tangents or UVs the frame holds the normal only and UV slots are skipped
+        {
+            const Streams normalsOnly = mesh.GetStreams(false, 0);
+            const Dequantization noUVs = ComputeDequantization(normalsOnly);
+            vector<uint8_t> packed((size_t)layout.stride * normalsOnly.vertexCount, 0xCD);
+            Encode(normalsOnly, profile, noUVs, layout, packed.data());
+            const ErrorStatistics partial = MeasureError(normalsOnly, packed.data(), profile, noUVs, layout);
+
+            const bool uvSkipped = packed[layout.uv[0]] == 0xCD && packed[layout.uv[1] + 3] == 0xCD;
+            passed &= Report("  normals without tangents or UVs", uvSkipped && noUVs.uvScaleBias[0] == 0.0f &&
+                partial.normalDegrees <= angleLimit[p] && partial.position <= positionLimit);
+        }
+    }
+
+    // Flat and single point streams have a zero scale on some axes and decode exactly
+    {
+        const float points[] = { 5.0f, 1.0f, -2.0f, 7.0f, 1.0f, -2.0f, 6.0f, 1.0f, -2.0f };
+        Streams flat;
+        flat.vertexCount = 3;
+        flat.positions = points;
+
+        const Dequantization dequantization = ComputeDequantization(flat);
+        const Layout layout = { kPositionSize, 0, kNotPresent, { kNotPresent, kNotPresent } };
+        uint8_t packed[3 * kPositionSize];
+        Encode(flat, kCompact, dequantization, layout, packed);
+
+        Vertex middle;
+        Decode(packed + 2 * kPositionSize, kCompact, dequantization, layout, middle);
+        const ErrorStatistics error = MeasureError(flat, packed, kCompact, dequantization, layout);
+
+        passed &= Report("degenerate bounds", dequantization.positionScale[1] == 0.0f && middle.position[1] == 1.0f &&
+            middle.position[2] == -2.0f && fabs(middle.position[0] - 6.0f) < 1e-4f && error.position < 1e-4f);
+    }
+
+    return passed ? 0 : 1;
+}
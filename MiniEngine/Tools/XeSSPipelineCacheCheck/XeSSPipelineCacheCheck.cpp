@@ -0,0 +1,187 @@
+// Copyright (C) 2022 Intel Corporation
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+// OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Checks that XeSS pipeline cache files round trip and that stale, truncated and corrupt
+// files are rejected. A random byte string stands in for the serialized pipeline library.
+//
+
+#include "../../../Source/XeSS/XeSSPipelineCache.h"
+#include "Crc32c.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace XeSS;
+
+namespace
+{
+    // Header field offsets, see FileHeader in XeSSPipelineCache.cpp
+    const size_t kFormatVersionOffset = 4;
+    const size_t kHeaderChecksumOffset = 60;
+    const size_t kHeaderSize = 64;
+
+    PipelineCache::Key MakeKey()
+    {
+        PipelineCache::Key key = {};
+        key.VendorId = 0x8086;
+        key.DeviceId = 0x56A0;
+        key.SubSysId = 0x10208086;
+        key.Revision = 8;
+        key.DriverVersion = 0x001F000F00650F1Bull;
+        key.XeSSMajor = 1;
+        key.XeSSMinor = 0;
+        key.XeSSPatch = 1;
+        key.InitFlags = 0x3;
+        return key;
+    }
+
+    vector<uint8_t> MakeBlob(size_t size, uint32_t seed)
+    {
+        mt19937 rng(seed);
+        vector<uint8_t> blob(size);
+        for (uint8_t& b : blob)
+            b = (uint8_t)rng();
+        return blob;
+    }
+
+    bool Expect(const vector<uint8_t>& file, const PipelineCache::Key& key, PipelineCache::eStatus expected,
+        const char* name, const vector<uint8_t>* expectedBlob = nullptr)
+    {
+        const void* blob = nullptr;
+        size_t blobSize = 0;
+        PipelineCache::eStatus status = PipelineCache::Parse(file.data(), file.size(), key, blob, blobSize);
+
+        bool passed = status == expected;
+        if (passed && expectedBlob != nullptr)
+        {
+            passed = blobSize == expectedBlob->size() &&
+                (blobSize == 0 || memcmp(blob, expectedBlob->data(), blobSize) == 0);
+        }
+        if (passed && status != PipelineCache::kStatusValid)
+            passed = blob == nullptr && blobSize == 0;
+
+        printf("%s %s (%s, expected %s)\n", passed ? "Passed" : "FAILED", name,
+            PipelineCache::StatusToString(status), PipelineCache::StatusToString(expected));
+        return passed;
+    }
+}
+
+int main()
+{
+    bool passed = true;
+
+    const PipelineCache::Key key = MakeKey();
+    const vector<uint8_t> blob = MakeBlob(300000, 1);
+
+    vector<uint8_t> file;
+    PipelineCache::Serialize(key, blob.data(), blob.size(), file);
+
+    // Round trips
+    passed &= Expect(file, key, PipelineCache::kStatusValid, "round trip", &blob);
+    {
+        vector<uint8_t> empty, emptyFile;
+        PipelineCache::Serialize(key, nullptr, 0, emptyFile);
+        passed &= Expect(emptyFile, key, PipelineCache::kStatusValid, "empty blob", &empty);
+    }
+
+    // Not a cache file
+    passed &= Expect({}, key, PipelineCache::kStatusInvalid, "empty file");
+    passed &= Expect(vector<uint8_t>(file.begin(), file.begin() + kHeaderSize - 1), key, PipelineCache::kStatusInvalid, "short header");
+    {
+        vector<uint8_t> bad = file;
+        bad[0] = 'Z';
+        passed &= Expect(bad, key, PipelineCache::kStatusInvalid, "bad magic");
+    }
+
+    // Any change to the key makes the file stale
+    {
+        const char* fields[] = { "vendor", "device", "subsystem", "revision", "driver", "xess major", "xess minor", "xess patch", "init flags" };
+        for (uint32_t field = 0; field < 9; ++field)
+        {
+            PipelineCache::Key other = key;
+            switch (field)
+            {
+            case 0: other.VendorId ^= 1; break;
+            case 1: other.DeviceId ^= 1; break;
+            case 2: other.SubSysId ^= 1; break;
+            case 3: other.Revision ^= 1; break;
+            case 4: other.DriverVersion += 1; break;
+            case 5: other.XeSSMajor += 1; break;
+            case 6: other.XeSSMinor += 1; break;
+            case 7: other.XeSSPatch += 1; break;
+            case 8: other.InitFlags ^= 0x10; break;
+            }
+
+            char name[64];
+            snprintf(name, sizeof(name), "different %s", fields[field]);
+            passed &= Expect(file, other, PipelineCache::kStatusStale, name);
+        }
+    }
+
+    // A well formed file from another format version is stale, not corrupt
+    {
+        vector<uint8_t> old = file;
+        uint32_t version = PipelineCache::kFormatVersion + 1;
+        memcpy(old.data() + kFormatVersionOffset, &version, sizeof(version));
+        uint32_t checksum = Utility::ComputeCrc32c(old.data(), kHeaderChecksumOffset);
+        memcpy(old.data() + kHeaderChecksumOffset, &checksum, sizeof(checksum));
+        passed &= Expect(old, key, PipelineCache::kStatusStale, "other format version");
+    }
+
+    // Damage
+    passed &= Expect(vector<uint8_t>(file.begin(), file.end() - 1), key, PipelineCache::kStatusCorrupt, "truncated blob");
+    {
+        vector<uint8_t> longer = file;
+        longer.push_back(0);
+        passed &= Expect(longer, key, PipelineCache::kStatusCorrupt, "trailing bytes");
+    }
+    {
+        vector<uint8_t> flipped = file;
+        flipped[kHeaderSize + blob.size() / 2] ^= 0x40;
+        passed &= Expect(flipped, key, PipelineCache::kStatusCorrupt, "flipped blob bit");
+    }
+    {
+        vector<uint8_t> flipped = file;
+        flipped[kFormatVersionOffset] ^= 0x01;
+        passed &= Expect(flipped, key, PipelineCache::kStatusCorrupt, "flipped header bit");
+    }
+
+    // No single bit flip anywhere in the header or the first blob bytes may be accepted
+    {
+        bool accepted = false;
+        for (size_t bit = 0; bit < (kHeaderSize + 64) * 8 && !accepted; ++bit)
+        {
+            vector<uint8_t> flipped = file;
+            flipped[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+
+            const void* data = nullptr;
+            size_t size = 0;
+            accepted = PipelineCache::Parse(flipped.data(), flipped.size(), key, data, size) == PipelineCache::kStatusValid;
+        }
+
+        printf("%s single bit flips\n", accepted ? "FAILED" : "Passed");
+        passed &= !accepted;
+    }
+
+    return passed ? 0 : 1;
+}
@@ -158,14 +158,45 @@ void DemoApp::Startup()
     if (CommandLineArgs::GetInteger(L"rebuild", rebuildValue))
         forceRebuild = rebuildValue != 0;
 
+    // Mesh optimization used when the model is rebuilt
+    Renderer::MeshBuildSettings buildSettings;
+    std::wstring vertexCacheName;
+    if (CommandLineArgs::GetString(L"vertex_cache", vertexCacheName))
+    {
+        VertexCacheOptimize::Algorithm algorithm = VertexCacheOptimize::FindAlgorithm(Utility::WideStringToUTF8(vertexCacheName).c_str());
+        if (algorithm != VertexCacheOptimize::kNumAlgorithms)
+            buildSettings.vertexCache.algorithm = algorithm;
+        else
+            LOG_WARNF("Unknown vertex cache optimizer %s.", Utility::WideStringToUTF8(vertexCacheName).c_str());
+    }
+    std::wstring quantizationName;
+    if (CommandLineArgs::GetString(L"vertex_quantization", quantizationName))
+    {
+        VertexQuantization::Profile profile = VertexQuantization::FindProfile(Utility::WideStringToUTF8(quantizationName).c_str());
+        if (profile != VertexQuantization::kNumProfiles)
+            buildSettings.vertexQuantization = profile;
+        else
+            LOG_WARNF("Unknown vertex quantization profile %s.", Utility::WideStringToUTF8(quantizationName).c_str());
+    }
+    uint32_t optimizeValue;
+    if (CommandLineArgs::GetInteger(L"reduce_overdraw", optimizeValue))
+        buildSettings.vertexCache.reduceOverdraw = optimizeValue != 0;
+    if (CommandLineArgs::GetInteger(L"mesh_stats", optimizeValue))
+    {
+        buildSettings.vertexCache.logStatistics = optimizeValue != 0;
+        buildSettings.logQuantizationError = optimizeValue != 0;
+    }
+    if (CommandLineArgs::GetInteger(L"meshlets", optimizeValue))
+        buildSettings.buildMeshlets = optimizeValue != 0;
+
     std::wstring gltfFileName;
     if (CommandLineArgs::GetString(L"model", gltfFileName) == false)
     {
-        m_ModeInstance = Renderer::LoadModel(m_AssetRootDir + L"/Sponza/pbr/sponza2.gltf", forceRebuild);
+        m_ModeInstance = Renderer::LoadModel(m_AssetRootDir + L"/Sponza/pbr/sponza2.gltf", forceRebuild, buildSettings);
     }
     else
     {
-        m_ModeInstance = Renderer::LoadModel(gltfFileName, forceRebuild);
+        m_ModeInstance = Renderer::LoadModel(gltfFileName, forceRebuild, buildSettings);
     }
 
     if (!m_ModeInstance.IsNull())
@@ -25,6 +25,7 @@
 #include "CameraController.h"
 #include "GameInput.h"
 #include "VRSScreenshot.h"
+#include "ImageMetrics.h"
 
 #include <conio.h>
 #include <sys/types.h>
@@ -62,21 +63,18 @@ using namespace std;
 
 #define ACCUMULATE_FRAMES 1000
 
+// Runs a command and returns its combined output. The output is read straight from a
+// pipe rather than being redirected through a temporary file.
 std::string exec(const char* command) {
-    char tmpname[L_tmpnam];
-    std::tmpnam(tmpname);
-    std::string scommand = command;
-    std::string cmd = scommand + " > " + tmpname + " 2>&1";
-    std::system(cmd.c_str());
-    std::ifstream file(tmpname, std::ios::in | std::ios::binary);
+    std::string cmd = std::string(command) + " 2>&1";
     std::string result;
-    if (file) {
-        while (!file.eof()) result.push_back(file.get())
-            ;
-        file.close();
+    FILE* pipe = _popen(cmd.c_str(), "r");
+    if (pipe) {
+        char buffer[256];
+        while (fgets(buffer, sizeof(buffer), pipe) != nullptr)
+            result.append(buffer);
+        _pclose(pipe);
     }
-    remove(tmpname);
-    result.pop_back();
     return result;
 }
 
@@ -101,6 +99,11 @@ namespace VRSTest
     UnitTestMode TestMode = UnitTestMode::TestModeNone;
     UnitTestState TestState = UnitTestState::TestStateNone;
 
+    // The control screenshot is kept in memory so each experiment can be compared against it directly
+    std::vector<uint8_t> controlPixels;
+    uint32_t controlWidth = 0;
+    uint32_t controlHeight = 0;
+
     DemoApp* m_App;
 
     const Location locales[3] = { Location(1.55f, 0.0f, Math::Vector3(100.0f, 150.0f, -40.0f)), //lion head
@@ -698,6 +701,9 @@ void VRSTest::Update(CameraController* camera, float deltaT)
             delete Test;
             Test = nullptr;
 
+            controlPixels.clear();
+            controlPixels.shrink_to_fit();
+
             RunningTest = false;
             TestState = UnitTestState::TestStateNone;
         }
@@ -782,7 +788,7 @@ void VRSTest::ResetExperimentData()
     remove(filename.c_str());
 }
 
-void VRSTest::WriteExperimentData(std::string& AE, std::string& DSSIM, std::string& FUZZ, std::string& MAE, std::string& MEPP, std::string& MSE, std::string& NCC, std::string& PAE, std::string& PHASH, std::string& RMSE, std::string& SSIM, std::string& PSNR, std::string& FLIP)
+void VRSTest::WriteExperimentData(const ImageMetrics::Results& metrics, std::string& FLIP)
 {
     float frameRate = 1.0f / EngineProfiling::GetFrameRate();
 
@@ -807,18 +813,18 @@ void VRSTest::WriteExperimentData(std::string& AE, std::string& DSSIM, std::stri
         << VRS::Percents.num2x4 << ","
         << VRS::Percents.num4x2 << ","
         << VRS::Percents.num4x4 << ","
-        << AE << ","
-        << DSSIM << ","
-        << FUZZ << ","
-        << MAE << ","
-        << MEPP << ","
-        << MSE << ","
-        << NCC << ","
-        << PAE << ","
-        << PHASH << ","
-        << RMSE << ","
-        << SSIM << ","
-        << PSNR << ","
+        << metrics.AE << ","
+        << metrics.DSSIM << ","
+        << metrics.FUZZ << ","
+        << metrics.MAE << ","
+        << metrics.MEPP << " (" << metrics.MEPPNormalizedMean << "; " << metrics.MEPPNormalizedMax << "),"
+        << metrics.MSE << ","
+        << metrics.NCC << ","
+        << metrics.PAE << ","
+        << metrics.PHASH << ","
+        << metrics.RMSE << ","
+        << metrics.SSIM << ","
+        << metrics.PSNR << ","
         << imagePath << std::endl;
     outfile.close();
 
@@ -840,9 +846,18 @@ bool VRSTest::Render(CommandContext& context, ColorBuffer& source, ColorBuffer&
             std::string filename = std::string("c:\\VRSExperiments\\").append(Test->GetName()).append("\\").append(exp->GetName()).append(".png");
             std::string vrsfilename = std::string("c:\\VRSExperiments\\").append(Test->GetName()).append("\\").append(exp->GetName()).append("-VRSBuffer.png");
             
-            Screenshot::TakeScreenshotAndExportVRSBuffer(filename.c_str(), source, vrsfilename.c_str(), vrsBuffer, context, exp->CaptureVRSBuffer());
+            std::vector<uint8_t> pixels;
+            Screenshot::TakeScreenshotAndExportVRSBuffer(filename.c_str(), source, vrsfilename.c_str(), vrsBuffer, context, exp->CaptureVRSBuffer(),
+                exp->CaptureStats() ? &pixels : nullptr);
+
+            if (exp->IsControl())
+            {
+                controlPixels = pixels;
+                controlWidth = (uint32_t)source.GetWidth();
+                controlHeight = (uint32_t)source.GetHeight();
+            }
 
-            std::string AE, DSSIM, FUZZ, MAE, MEPP, MSE, NCC, PAE, PHASH, RMSE, SSIM, PSNR, FLIP;
+            std::string FLIP;
 
             if (exp->CaptureStats())
             {
@@ -854,98 +869,28 @@ bool VRSTest::Render(CommandContext& context, ColorBuffer& source, ColorBuffer&
                 std::string experimentPath("\"C:\\VRSExperiments\\");
                 experimentPath.append(Test->GetName()).append("\\").append(exp->GetName()).append(".png\"");
 
-                std::string differencePath("\"C:\\VRSExperiments\\");
-                differencePath.append(Test->GetName()).append("\\").append(exp->GetName()).append("-diff.png\"");
-
-                std::string cmd("magick compare -metric AE");
-                cmd.append(" ").append(controlPath);
-                cmd.append(" ").append(experimentPath);
-                cmd.append(" ").append(differencePath);
-                AE = exec(cmd.c_str());
-                printf("AE: %s\n", AE.c_str());
-
-                cmd = "magick compare -metric DSSIM";
-                cmd.append(" ").append(controlPath);
-                cmd.append(" ").append(experimentPath);
-                cmd.append(" ").append(differencePath);
-                DSSIM = exec(cmd.c_str());
-                printf("DSSIM: %s\n", DSSIM.c_str());
-
-                cmd = "magick compare -metric FUZZ";
-                cmd.append(" ").append(controlPath);
-                cmd.append(" ").append(experimentPath);
-                cmd.append(" ").append(differencePath);
-                FUZZ = exec(cmd.c_str());
-                printf("FUZZ: %s\n", FUZZ.c_str());
-
-                cmd = "magick compare -metric MAE";
-                cmd.append(" ").append(controlPath);
-                cmd.append(" ").append(experimentPath);
-                cmd.append(" ").append(differencePath);
-                MAE = exec(cmd.c_str());
-                printf("MAE: %s\n", MAE.c_str());
-
-                cmd = "magick compare -metric MEPP";
-                cmd.append(" ").append(controlPath);
-                cmd.append(" ").append(experimentPath);
-                cmd.append(" ").append(differencePath);
-                MEPP = exec(cmd.c_str());
-                std::replace(MEPP.begin(), MEPP.end(), ',', ';');
-                printf("MEPP: %s\n", MEPP.c_str());
+                std::string differencePath("C:\\VRSExperiments\\");
+                differencePath.append(Test->GetName()).append("\\").append(exp->GetName()).append("-diff.png");
 
-                cmd = "magick compare -metric MSE";
-                cmd.append(" ").append(controlPath);
-                cmd.append(" ").append(experimentPath);
-                cmd.append(" ").append(differencePath);
-                MSE = exec(cmd.c_str());
-                printf("MSE: %s\n", MSE.c_str());
+                ImageMetrics::Image controlImage = { controlPixels.data(), controlWidth, controlHeight, controlWidth * 4 };
+                ImageMetrics::Image experimentImage = { pixels.data(), (uint32_t)source.GetWidth(), (uint32_t)source.GetHeight(), (uint32_t)source.GetWidth() * 4 };
 
-                cmd = "magick compare -metric NCC";
-                cmd.append(" ").append(controlPath);
-                cmd.append(" ").append(experimentPath);
-                cmd.append(" ").append(differencePath);
-                NCC = exec(cmd.c_str());
-                printf("NCC: %s\n", NCC.c_str());
-
-                cmd = "magick compare -metric PAE";
-                cmd.append(" ").append(controlPath);
-                cmd.append(" ").append(experimentPath);
-                cmd.append(" ").append(differencePath);
-                PAE = exec(cmd.c_str());
-                printf("PAE: %s\n", PAE.c_str());
-
-                cmd = "magick compare -metric PHASH";
-                cmd.append(" ").append(controlPath);
-                cmd.append(" ").append(experimentPath);
-                cmd.append(" ").append(differencePath);
-                PHASH = exec(cmd.c_str());
-                printf("PHASH: %s\n", PHASH.c_str());
-
-                cmd = "magick compare -metric RMSE";
-                cmd.append(" ").append(controlPath);
-                cmd.append(" ").append(experimentPath);
-                cmd.append(" ").append(differencePath);
-                RMSE = exec(cmd.c_str());
-                printf("RMSE: %s\n", RMSE.c_str());
-
-                cmd = "magick compare -metric SSIM";
-                cmd.append(" ").append(controlPath);
-                cmd.append(" ").append(experimentPath);
-                cmd.append(" ").append(differencePath);
-                SSIM = exec(cmd.c_str());
-                printf("SSIM: %s\n", SSIM.c_str());
-
-                cmd = "magick compare -metric PSNR";
-                cmd.append(" ").append(controlPath);
-                cmd.append(" ").append(experimentPath);
-                cmd.append(" ").append(differencePath);
-                PSNR = exec(cmd.c_str());
-                printf("PSNR: %s\n", PSNR.c_str());
+                ImageMetrics::Results metrics;
+                std::vector<uint8_t> difference;
+                if (!ImageMetrics::Compare(controlImage, experimentImage, metrics, &difference))
+                {
+                    printf("Unable to compare against the control image, capture the control experiment at the same resolution first.\n");
+                }
+                else
+                {
+                    Screenshot::WriteRawToPNG(differencePath, controlWidth, controlHeight, 4, (const char*)difference.data());
+                }
+                printf("%s", ImageMetrics::ToString(metrics).c_str());
 
                 std::string flipCSV("C:\\VRSExperiments\\");
                 flipCSV.append(Test->GetName()).append("\\FLIP.csv");
 
-                cmd = "cd C:\\VRSExperiments\\";
+                std::string cmd("cd C:\\VRSExperiments\\");
                 cmd.append(Test->GetName());
                 cmd.append(" & C:\\VRSExperiments\\FLIP\\flip.exe ");
                 cmd.append(controlPath);
@@ -966,7 +911,7 @@ bool VRSTest::Render(CommandContext& context, ColorBuffer& source, ColorBuffer&
                 //std::system(createFlipPDF.c_str());
                 ////printf("%s\n", result.c_str());
 
-                WriteExperimentData(AE, DSSIM, FUZZ, MAE, MEPP, MSE, NCC, PAE, PHASH, RMSE, SSIM, PSNR, FLIP);
+                WriteExperimentData(metrics, FLIP);
             }
 
             VRSTest::takeScreenshot = false;
@@ -22,6 +22,7 @@
 #include <Math/Vector.h>
 
 class CameraController;
+namespace ImageMetrics { struct Results; }
 class ColorBuffer;
 class DemoApp;
 
@@ -108,12 +109,7 @@ namespace VRSTest
     void MoveCamera(CameraController* camera, UnitTestMode testMode);
     UnitTestMode CheckIfChangeLocationKeyPressed();
     void ResetExperimentData();
-    void WriteExperimentData(
-        std::string& AE, std::string& DSSIM, std::string& FUZZ, 
-        std::string& MAE, std::string& MEPP, std::string& MSE, 
-        std::string& NCC, std::string& PAE, std::string& PHASH, 
-        std::string& RMSE, std::string& SSIM, std::string& PSNR, 
-        std::string& FLIP);
+    void WriteExperimentData(const ImageMetrics::Results& metrics, std::string& FLIP);
 
     extern DemoApp* m_App;
 }
@@ -0,0 +1,114 @@
+/*******************************************************************************
+ * Copyright 2021 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files(the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions :
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+// This file has no engine dependencies so that it can also be built into the standalone
+// cache format check (see MiniEngine/Tools/XeSSPipelineCacheCheck).
+
+#include "XeSSPipelineCache.h"
+#include "Crc32c.h"
+
+#include <cstring>
+
+namespace XeSS
+{
+    namespace PipelineCache
+    {
+        static const char kMagic[4] = { 'X', 'P', 'L', 'C' };
+
+        struct FileHeader
+        {
+            char Magic[4];
+            uint32_t FormatVersion;
+            Key CacheKey;
+            uint64_t BlobSize;
+            uint32_t BlobChecksum;
+            /// Covers every header field above.
+            uint32_t HeaderChecksum;
+        };
+
+        static_assert(sizeof(Key) == 40, "PipelineCache::Key must not contain padding");
+        static_assert(sizeof(FileHeader) == 64, "PipelineCache::FileHeader must not contain padding");
+
+        static uint32_t ComputeHeaderChecksum(const FileHeader& Header)
+        {
+            return Utility::ComputeCrc32c(&Header, offsetof(FileHeader, HeaderChecksum));
+        }
+
+        const char* StatusToString(eStatus Status)
+        {
+            switch (Status)
+            {
+            case kStatusValid: return "Valid";
+            case kStatusInvalid: return "Invalid";
+            case kStatusCorrupt: return "Corrupt";
+            case kStatusStale: return "Stale";
+            default: return "Unknown";
+            }
+        }
+
+        void Serialize(const Key& CacheKey, const void* Blob, size_t BlobSize, std::vector<uint8_t>& File)
+        {
+            FileHeader header;
+            memset(&header, 0, sizeof(header));
+            memcpy(header.Magic, kMagic, sizeof(kMagic));
+            header.FormatVersion = kFormatVersion;
+            header.CacheKey = CacheKey;
+            header.BlobSize = BlobSize;
+            header.BlobChecksum = Utility::ComputeCrc32c(Blob, BlobSize);
+            header.HeaderChecksum = ComputeHeaderChecksum(header);
+
+            File.resize(sizeof(header) + BlobSize);
+            memcpy(File.data(), &header, sizeof(header));
+            if (BlobSize > 0)
+                memcpy(File.data() + sizeof(header), Blob, BlobSize);
+        }
+
+        eStatus Parse(const void* Data, size_t Size, const Key& CacheKey, const void*& Blob, size_t& BlobSize)
+        {
+            Blob = nullptr;
+            BlobSize = 0;
+
+            FileHeader header;
+            if (Data == nullptr || Size < sizeof(header))
+                return kStatusInvalid;
+
+            memcpy(&header, Data, sizeof(header));
+            if (memcmp(header.Magic, kMagic, sizeof(kMagic)) != 0)
+                return kStatusInvalid;
+
+            if (header.HeaderChecksum != ComputeHeaderChecksum(header))
+                return kStatusCorrupt;
+
+            if (header.FormatVersion != kFormatVersion || memcmp(&header.CacheKey, &CacheKey, sizeof(Key)) != 0)
+                return kStatusStale;
+
+            const uint8_t* payload = static_cast<const uint8_t*>(Data) + sizeof(header);
+            if (header.BlobSize != Size - sizeof(header) ||
+                header.BlobChecksum != Utility::ComputeCrc32c(payload, (size_t)header.BlobSize))
+                return kStatusCorrupt;
+
+            Blob = payload;
+            BlobSize = (size_t)header.BlobSize;
+            return kStatusValid;
+        }
+    } // namespace PipelineCache
+} // namespace XeSS
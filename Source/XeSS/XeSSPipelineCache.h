@@ -0,0 +1,86 @@
+/*******************************************************************************
+ * Copyright 2021 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files(the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions :
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// On-disk cache of the XeSS pipeline library.
+///
+/// A cache file is a header followed by the blob from ID3D12PipelineLibrary::Serialize. The
+/// header holds the key the blob was built for and CRC-32C checksums of the header and the blob.
+/// A file is only used when the format version and the whole key match, so a driver update, a
+/// different adapter, a new XeSS runtime or other init flags rebuild the pipelines instead of
+/// handing the driver a library it would reject or, worse, misread.
+///
+/// This has no D3D12 dependency so that the format can be checked on its own (see
+/// MiniEngine/Tools/XeSSPipelineCacheCheck).
+namespace XeSS
+{
+    namespace PipelineCache
+    {
+        /// Bump when the file layout changes.
+        static const uint32_t kFormatVersion = 1;
+
+        /// What a serialized pipeline library depends on.
+        struct Key
+        {
+            /// DXGI_ADAPTER_DESC identity of the adapter.
+            uint32_t VendorId;
+            uint32_t DeviceId;
+            uint32_t SubSysId;
+            uint32_t Revision;
+            /// User mode driver version.
+            uint64_t DriverVersion;
+            /// XeSS runtime version.
+            uint32_t XeSSMajor;
+            uint32_t XeSSMinor;
+            uint32_t XeSSPatch;
+            /// Flags passed to xessD3D12BuildPipelines.
+            uint32_t InitFlags;
+        };
+
+        /// Result of validating a cache file.
+        enum eStatus
+        {
+            kStatusValid = 0,
+            /// Not a cache file, or too short to hold a header.
+            kStatusInvalid,
+            /// The header or the blob does not match its checksum, or the blob is truncated.
+            kStatusCorrupt,
+            /// A well formed file written by another format version or for another key.
+            kStatusStale
+        };
+
+        /// Convert from eStatus to string.
+        const char* StatusToString(eStatus Status);
+
+        /// Build the contents of a cache file for a serialized pipeline library.
+        void Serialize(const Key& CacheKey, const void* Blob, size_t BlobSize, std::vector<uint8_t>& File);
+
+        /// Validate the contents of a cache file against the current key. On success Blob points
+        /// at the serialized library inside Data.
+        eStatus Parse(const void* Data, size_t Size, const Key& CacheKey, const void*& Blob, size_t& BlobSize);
+    } // namespace PipelineCache
+} // namespace XeSS
@@ -30,9 +30,13 @@
 #include "DepthBuffer.h"
 #include "CommandContext.h"
 #include "Log.h"
+#include "FileUtility.h"
 
 #include "xess/xess_d3d12.h"
 
+#include <dxgi1_4.h>
+#include <fstream>
+
 using namespace Graphics;
 
 namespace XeSS
@@ -82,6 +86,9 @@ namespace XeSS
         , m_PipelineBuiltFlag(0)
         , m_Context(nullptr)
         , m_PipelineLibBuilt(false)
+        , m_Version{}
+        , m_PipelineCacheKey{}
+        , m_PipelineCacheDirty(false)
     {
     }
 
@@ -101,6 +108,8 @@ namespace XeSS
             return false;
         }
 
+        m_Version = ver;
+
         char buf[128];
         sprintf_s(buf, "%u.%u.%u", ver.major, ver.minor, ver.patch);
 
@@ -141,11 +150,55 @@ namespace XeSS
             return false;
         }
 
-        HRESULT hr = device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_PipelineLibrary));
-        if (FAILED(hr) || !m_PipelineLibrary)
+        // Write out pipelines of the previous flags before the library is replaced.
+        SavePipelineCache();
+
+        m_PipelineLibrary = nullptr;
+        m_PipelineLibraryData.clear();
+        m_PipelineBuilt = false;
+
+        // Start from the cached library when it was built for this device, driver, runtime and flags.
+        bool useCache = GetPipelineCacheKey(initFlag, m_PipelineCacheKey);
+        if (useCache)
         {
-            LOG_ERROR("XeSS: Create D3D Pipeline library failed.");
-            return false;
+            Utility::ByteArray file = Utility::ReadFileSync(GetPipelineCachePath(initFlag));
+            if (file != Utility::NullFile && !file->empty())
+            {
+                const void* blob = nullptr;
+                size_t blobSize = 0;
+                PipelineCache::eStatus status = PipelineCache::Parse(file->data(), file->size(), m_PipelineCacheKey, blob, blobSize);
+                if (status == PipelineCache::kStatusValid)
+                {
+                    const uint8_t* blobBytes = static_cast<const uint8_t*>(blob);
+                    m_PipelineLibraryData.assign(blobBytes, blobBytes + blobSize);
+
+                    HRESULT hr = device1->CreatePipelineLibrary(m_PipelineLibraryData.data(), m_PipelineLibraryData.size(), IID_PPV_ARGS(&m_PipelineLibrary));
+                    if (FAILED(hr) || !m_PipelineLibrary)
+                    {
+                        LOG_WARNF("XeSS: Driver rejected cached pipeline library (0x%08X), rebuilding.", hr);
+                        m_PipelineLibrary = nullptr;
+                        m_PipelineLibraryData.clear();
+                    }
+                    else
+                    {
+                        LOG_INFOF("XeSS: Loaded cached pipeline library (%zu bytes).", blobSize);
+                    }
+                }
+                else
+                {
+                    LOG_WARNF("XeSS: Dropped %s pipeline cache, rebuilding.", PipelineCache::StatusToString(status));
+                }
+            }
+        }
+
+        if (!m_PipelineLibrary)
+        {
+            HRESULT hr = device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_PipelineLibrary));
+            if (FAILED(hr) || !m_PipelineLibrary)
+            {
+                LOG_ERROR("XeSS: Create D3D Pipeline library failed.");
+                return false;
+            }
         }
 
 #ifndef RELEASE
@@ -164,11 +217,100 @@ namespace XeSS
         m_PipelineBuiltBlocking = blocking;
         m_PipelineBuiltFlag = initFlag;
 
+        // A library loaded from the cache only needs writing back if the build added pipelines.
+        // Non-blocking builds are still compiling, so they are written at shutdown.
+        m_PipelineCacheDirty = useCache &&
+            (m_PipelineLibraryData.empty() || m_PipelineLibrary->GetSerializedSize() != m_PipelineLibraryData.size());
+        if (blocking)
+        {
+            SavePipelineCache();
+        }
+
+        return true;
+    }
+
+    bool XeSSRuntime::GetPipelineCacheKey(uint32_t initFlag, PipelineCache::Key& Key)
+    {
+        Key = {};
+
+        ComPtr<IDXGIFactory4> factory;
+        ComPtr<IDXGIAdapter> adapter;
+        DXGI_ADAPTER_DESC desc;
+        LARGE_INTEGER driverVersion;
+        if (FAILED(CreateDXGIFactory1(IID_PPV_ARGS(&factory))) ||
+            FAILED(factory->EnumAdapterByLuid(g_Device->GetAdapterLuid(), IID_PPV_ARGS(&adapter))) ||
+            FAILED(adapter->GetDesc(&desc)) ||
+            FAILED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion)))
+        {
+            LOG_WARN("XeSS: Could not identify the adapter, pipeline cache disabled.");
+            return false;
+        }
+
+        Key.VendorId = desc.VendorId;
+        Key.DeviceId = desc.DeviceId;
+        Key.SubSysId = desc.SubSysId;
+        Key.Revision = desc.Revision;
+        Key.DriverVersion = static_cast<uint64_t>(driverVersion.QuadPart);
+        Key.XeSSMajor = m_Version.major;
+        Key.XeSSMinor = m_Version.minor;
+        Key.XeSSPatch = m_Version.patch;
+        Key.InitFlags = initFlag;
+
         return true;
     }
 
+    std::wstring XeSSRuntime::GetPipelineCachePath(uint32_t initFlag)
+    {
+        wchar_t name[64];
+        swprintf_s(name, L"xess_pipelines_%08x.cache", initFlag);
+
+        return Utility::GetProgramDirectory() + name;
+    }
+
+    void XeSSRuntime::SavePipelineCache()
+    {
+        if (!m_PipelineCacheDirty || !m_PipelineLibrary)
+            return;
+
+        m_PipelineCacheDirty = false;
+
+        std::vector<uint8_t> blob(m_PipelineLibrary->GetSerializedSize());
+        if (blob.empty() || FAILED(m_PipelineLibrary->Serialize(blob.data(), blob.size())))
+        {
+            LOG_WARN("XeSS: Could not serialize pipeline library.");
+            return;
+        }
+
+        std::vector<uint8_t> file;
+        PipelineCache::Serialize(m_PipelineCacheKey, blob.data(), blob.size(), file);
+
+        // Write to a temporary file first so that an interrupted write never leaves a partial cache.
+        std::wstring path = GetPipelineCachePath(m_PipelineCacheKey.InitFlags);
+        std::wstring tempPath = path + L".tmp";
+        {
+            std::ofstream stream(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+            stream.write(reinterpret_cast<const char*>(file.data()), file.size());
+            if (!stream)
+            {
+                LOG_WARNF("XeSS: Could not write pipeline cache \"%s\".", Utility::WideStringToUTF8(tempPath).c_str());
+                return;
+            }
+        }
+
+        if (!MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+        {
+            LOG_WARNF("XeSS: Could not replace pipeline cache \"%s\".", Utility::WideStringToUTF8(path).c_str());
+            DeleteFileW(tempPath.c_str());
+            return;
+        }
+
+        LOG_INFOF("XeSS: Saved pipeline cache (%zu bytes).", blob.size());
+    }
+
     void XeSSRuntime::Shutdown(void)
     {
+        SavePipelineCache();
+
         if (!m_Initialized)
             return;
 
@@ -179,6 +321,10 @@ namespace XeSS
 
         m_PipelineLibrary = nullptr;
 
+        m_PipelineLibraryData.clear();
+
+        m_PipelineBuilt = false;
+
         m_PipelineLibBuilt = false;
 
         m_Initialized = false;
@@ -222,6 +368,12 @@ namespace XeSS
             params.initFlags |= XESS_INIT_FLAG_RESPONSIVE_PIXEL_MASK;
         }
 
+        // Build through the pipeline library so that the pipelines can be cached across launches.
+        if (!m_PipelineBuilt || m_PipelineBuiltFlag != params.initFlags)
+        {
+            InitializePipeline(params.initFlags, true);
+        }
+
         params.pPipelineLibrary = m_PipelineBuilt ? m_PipelineLibrary.Get() : nullptr;
 
         xess_result_t ret = xessD3D12Init(m_Context, &params);
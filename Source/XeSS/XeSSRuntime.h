@@ -23,6 +23,7 @@
 #pragma once
 
 #include "xess/xess.h"
+#include "XeSSPipelineCache.h"
 
 class ColorBuffer;
 class DepthBuffer;
@@ -149,6 +150,12 @@ namespace XeSS
     private:
         /// Save initialization arguments.
         void SetInitArguments(const InitArguments& Args);
+        /// Fill the key that identifies pipelines built with initFlag on this device.
+        bool GetPipelineCacheKey(uint32_t initFlag, PipelineCache::Key& Key);
+        /// Path of the pipeline cache file for initFlag.
+        std::wstring GetPipelineCachePath(uint32_t initFlag);
+        /// Write the pipeline library to its cache file.
+        void SavePipelineCache();
 
         /// If pipeline is already built.
         bool m_PipelineBuilt;
@@ -174,5 +181,17 @@ namespace XeSS
 
         /// DX12 pipeline library object.
         Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> m_PipelineLibrary;
+
+        /// Serialized library the pipeline library was created from. It must outlive the library.
+        std::vector<uint8_t> m_PipelineLibraryData;
+
+        /// Version of XeSS runtime.
+        xess_version_t m_Version;
+
+        /// Key of the current pipeline library.
+        PipelineCache::Key m_PipelineCacheKey;
+
+        /// If the pipeline library holds pipelines that are not in its cache file yet.
+        bool m_PipelineCacheDirty;
     };
 } // namespace XeSS